@@ -295,6 +295,7 @@ COMPILE_ASSERT(sizeof(ssize_t) == sizeof(int64_t));
 #define ENABLE_MESHOPTIMIZER
 #define ENABLE_THREAD_PERFORMANCE_STATS
 // #define ENABLE_VMA_LOG // Very verbose, prints for each allocation
+// #define ENABLE_BUFFER_CHUNK_ALLOCATOR_TEST // Runs a randomized GeometryBuffer allocator test at resource loader init in debug builds
 
 // ENABLE_FORGE_ANDROID_SHADERC can be disabled if all shaders are compiled offline.
 // This way we also avoid to link to this library
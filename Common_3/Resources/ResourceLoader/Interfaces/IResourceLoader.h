@@ -55,6 +55,8 @@ typedef enum TextureContainerType
     TEXTURE_CONTAINER_KTX,
     /// .gnf
     TEXTURE_CONTAINER_GNF,
+    /// .ktx2, mip levels can be zstd supercompressed
+    TEXTURE_CONTAINER_KTX2,
 } TextureContainerType;
 
 typedef enum RegisterMaterialResult
@@ -67,6 +69,18 @@ typedef enum RegisterMaterialResult
 
 // MARK: - Resource Loading
 
+// Order in which the resource loader processes queued requests. Requests with the same priority are processed in the order they were
+// queued, low priority requests are still processed regularly while higher priority requests keep coming.
+typedef enum ResourceLoadPriority
+{
+    /// Default of zero initialized load descs
+    RESOURCE_LOAD_PRIORITY_NORMAL = 0,
+    /// Latency sensitive loads, resources needed to render the next frames
+    RESOURCE_LOAD_PRIORITY_HIGH = 1,
+    /// Bulk loads (prefetching, texture streaming)
+    RESOURCE_LOAD_PRIORITY_LOW = -1,
+} ResourceLoadPriority;
+
 typedef struct BufferLoadDesc
 {
     Buffer**    ppBuffer;
@@ -80,8 +94,22 @@ typedef struct BufferLoadDesc
     // Optional (if user provides staging buffer memory)
     Buffer*  pSrcBuffer;
     uint64_t mSrcOffset;
+
+    ResourceLoadPriority mPriority;
 } BufferLoadDesc;
 
+// Sharing of textures loaded from file. Cached textures are reference counted, each addResource needs a matching removeResource.
+typedef enum TextureCacheMode
+{
+    /// Always create a new texture
+    TEXTURE_CACHE_MODE_NONE = 0,
+    /// Share the texture with the cached loads of the same file, container, creation flags, ycbcr sampler and node
+    TEXTURE_CACHE_MODE_PATH,
+    /// Same as TEXTURE_CACHE_MODE_PATH, also shares the texture with cached loads of other files with identical content.
+    /// The file is hashed by the resource loader thread the first time it is loaded.
+    TEXTURE_CACHE_MODE_CONTENT,
+} TextureCacheMode;
+
 typedef struct TextureLoadDesc
 {
     Texture** ppTexture;
@@ -105,8 +133,172 @@ typedef struct TextureLoadDesc
     TextureCreationFlags mCreationFlag;
     /// The texture file format (dds/ktx/...)
     TextureContainerType mContainer;
+    ResourceLoadPriority mPriority;
+    /// Ignored if pDesc != NULL. Textures shared through the cache must not be modified.
+    TextureCacheMode     mCacheMode;
 } TextureLoadDesc;
 
+// Texture whose mips are streamed in and out from a DDS/KTX file depending on the mips requested with requestStreamingTextureMip and
+// the global budget set with setTextureStreamingDesc. Residency changes are applied by updateTextureStreaming.
+typedef struct StreamingTexture
+{
+    /// Texture holding the resident mips, NULL until the first load completes. It is replaced by updateTextureStreaming when mips are
+    /// streamed in or evicted, descriptors referencing it need to be updated when mVersion changes
+    Texture* pTexture;
+    uint32_t mVersion;
+    /// Number of mips in the file, valid once pTexture is not NULL
+    uint32_t mMipLevels;
+    /// Number of lowest mips in pTexture, mip 0 of pTexture is mip (mMipLevels - mResidentMipCount) of the file
+    uint32_t mResidentMipCount;
+
+    /// Internal
+    struct
+    {
+        const char*          pFileName;
+        TextureCreationFlags mCreationFlag;
+        TextureContainerType mContainer;
+        uint32_t             mNodeIndex;
+        uint32_t             mMinResidentMipCount;
+        /// Container information, written by the resource loader thread on the first load
+        uint32_t             mWidth;
+        uint32_t             mHeight;
+        uint32_t             mDepth;
+        uint32_t             mArraySize;
+        uint32_t             mFormat;
+        DescriptorType       mDescriptors;
+        uint64_t             mDataOffset;
+        bool                 mCubePadding;
+        /// Feedback
+        uint32_t             mRequestedMipCount;
+        uint64_t             mLastRequestFrame;
+        /// In flight load, pPendingTexture is written by the resource loader thread before mPendingToken completes
+        Texture*             pPendingTexture;
+        /// Texture of a failed load, released by the main thread once no copy can reference it
+        Texture*             pFailedTexture;
+        uint64_t             mPendingToken;
+        uint32_t             mPendingMipCount;
+    } mInternal;
+} StreamingTexture;
+
+typedef struct StreamingTextureLoadDesc
+{
+    StreamingTexture**   ppStreamingTexture;
+    /// Only DDS and KTX containers can be streamed
+    const char*          pFileName;
+    uint32_t             mNodeIndex;
+    TextureCreationFlags mCreationFlag;
+    TextureContainerType mContainer;
+    /// Number of lowest mips loaded by addResource, they are never evicted (0 means 1)
+    uint32_t             mMinResidentMipCount;
+} StreamingTextureLoadDesc;
+
+typedef struct TextureStreamingDesc
+{
+    /// Memory used by the resident mips of all streaming textures is kept under this budget (UINT64_MAX means no limit)
+    uint64_t mMemoryBudget;
+    /// Textures replaced by a streaming update are destroyed after this many calls to updateTextureStreaming
+    uint32_t mRetireFrameCount;
+    /// Mips that are not requested for this many calls to updateTextureStreaming are evicted
+    uint32_t mEvictFrameCount;
+    /// Maximum number of loads queued by a single updateTextureStreaming call
+    uint32_t mMaxRequestsPerUpdate;
+} TextureStreamingDesc;
+
+typedef struct TextureStreamingStats
+{
+    uint64_t mMemoryBudget;
+    /// Memory of the resident mips of all streaming textures
+    uint64_t mResidentSize;
+    /// Memory the requested mips would need, can be higher than mMemoryBudget
+    uint64_t mRequestedSize;
+    /// Totals since the streaming system was initialized
+    uint64_t mUploadedSize;
+    uint64_t mEvictedSize;
+    uint32_t mTextureCount;
+    uint32_t mResidentMipCount;
+    uint32_t mMipCount;
+    uint32_t mPendingRequestCount;
+    uint32_t mRetiredTextureCount;
+} TextureStreamingStats;
+
+typedef enum ResourceLoadType
+{
+    RESOURCE_LOAD_TYPE_BUFFER = 0,
+    RESOURCE_LOAD_TYPE_TEXTURE,
+    RESOURCE_LOAD_TYPE_GEOMETRY,
+    RESOURCE_LOAD_TYPE_GEOMETRY_BATCH,
+    RESOURCE_LOAD_TYPE_STREAMING_TEXTURE,
+    RESOURCE_LOAD_TYPE_TEXTURE_COPY,
+    RESOURCE_LOAD_TYPE_TEXTURE_BARRIER,
+    RESOURCE_LOAD_TYPE_GEOMETRY_SHADOW,
+    RESOURCE_LOAD_TYPE_COUNT,
+} ResourceLoadType;
+
+// Phases of a request processed by the resource loader, times are accumulated in microseconds
+typedef enum ResourceLoadPhase
+{
+    /// Time between queueing the request and the resource loader thread picking it up
+    RESOURCE_LOAD_PHASE_QUEUE = 0,
+    /// Reading the file
+    RESOURCE_LOAD_PHASE_FILE_IO,
+    /// Decompressing file data
+    RESOURCE_LOAD_PHASE_DECOMPRESS,
+    /// Processing time of the resource loader thread that is not part of any other phase (parsing, resource creation, copies to staging
+    /// memory, command recording)
+    RESOURCE_LOAD_PHASE_PROCESS,
+    /// Waiting for staging memory to be available
+    RESOURCE_LOAD_PHASE_STAGING_WAIT,
+    /// Time between the submission of the copy commands and the resource loader thread seeing their completion
+    RESOURCE_LOAD_PHASE_GPU_COPY,
+    RESOURCE_LOAD_PHASE_COUNT,
+} ResourceLoadPhase;
+
+// How the file data of a texture was copied to staging memory
+typedef enum TextureUploadPath
+{
+    /// No file data was read (texture updates, copies, failed loads)
+    TEXTURE_UPLOAD_PATH_NONE = 0,
+    /// Row by row reads, the staging row pitch differs from the file
+    TEXTURE_UPLOAD_PATH_ROWS,
+    /// One read per subresource, the staging layout of each subresource matches the file
+    TEXTURE_UPLOAD_PATH_SUBRESOURCES,
+    /// The staging layout of the whole payload matches the file, copied with a single read
+    TEXTURE_UPLOAD_PATH_SINGLE_READ,
+    /// The staging layout of the whole payload matches the file, copied in one pass from the memory mapped file or archive
+    TEXTURE_UPLOAD_PATH_MAPPED,
+    TEXTURE_UPLOAD_PATH_COUNT,
+} TextureUploadPath;
+
+typedef struct ResourceLoadTypeStats
+{
+    uint64_t mRequestCount;
+    uint64_t mFailedRequestCount;
+    /// Staging memory used by the requests
+    uint64_t mUploadSize;
+    /// Accumulated phase times of the requests in microseconds, RESOURCE_LOAD_PHASE_GPU_COPY is only measured during a load report
+    uint64_t mPhaseTime[RESOURCE_LOAD_PHASE_COUNT];
+} ResourceLoadTypeStats;
+
+// Counters accumulated since initResourceLoaderInterface or the last resetResourceLoaderStats call
+typedef struct ResourceLoaderStats
+{
+    ResourceLoadTypeStats mTypes[RESOURCE_LOAD_TYPE_COUNT];
+    /// Number of times a staging memory allocation had to flush the copy commands and wait for the GPU
+    uint64_t              mStagingStallCount;
+    /// Temporary staging buffers created for requests bigger than the staging buffer
+    uint64_t              mTempStagingBufferCount;
+    uint64_t              mTempStagingBufferSize;
+    /// Copy command submissions of the resource loader thread
+    uint64_t              mSubmitCount;
+    /// Cached texture loads (TextureLoadDesc::mCacheMode) that reused a resident texture or had to load the file
+    uint64_t              mTextureCacheHitCount;
+    uint64_t              mTextureCacheMissCount;
+    /// Texture memory not allocated thanks to texture cache hits
+    uint64_t              mTextureCacheBytesSaved;
+    /// Texture and streaming texture loads that went through each TextureUploadPath
+    uint64_t              mTextureUploadPathCount[TEXTURE_UPLOAD_PATH_COUNT];
+} ResourceLoaderStats;
+
 typedef struct BufferChunk
 {
     uint32_t mOffset;
@@ -114,15 +306,30 @@ typedef struct BufferChunk
 } BufferChunk;
 
 // Structure used to sub-allocate chunks on a buffer, keeps track of free memory to handle new requests.
+// Free memory is tracked with a two-level segregated fit (TLSF) heap so that allocating and releasing chunks is O(1)
+// regardless of how fragmented the buffer is, released chunks are merged with their free neighbours immediately.
 // Interface to add/remove this allocator is currently private, could be made public if needed.
 typedef struct BufferChunkAllocator
 {
-    Buffer*      pBuffer;
-    uint32_t     mUsedChunkCount;
-    uint32_t     mSize;
-    BufferChunk* mUnusedChunks;
+    Buffer*                 pBuffer;
+    uint32_t                mUsedChunkCount;
+    uint32_t                mSize;
+    struct BufferChunkHeap* pHeap;
 } BufferChunkAllocator;
 
+typedef struct BufferChunkAllocatorStats
+{
+    uint32_t mSize;
+    uint32_t mUsedSize;
+    uint32_t mUnusedSize;
+    uint32_t mUsedChunkCount;
+    uint32_t mUnusedChunkCount;
+    uint32_t mLargestUnusedChunkSize;
+    /// 0 when all free memory is contiguous, approaches 1 as free memory gets split into many small chunks.
+    /// Computed as 1 - mLargestUnusedChunkSize / mUnusedSize
+    float    mFragmentation;
+} BufferChunkAllocatorStats;
+
 // Stores huge buffers that are then used to sub-allocate memory for each of the loaded meshes.
 // GeometryBuffer can be provided to GeometryLoadDesc::pGeometryBuffer when loading a mesh, sub-chunks will be allocated
 // by mIndex and mVertex allocators and return the BufferChunk(s) that where used in Geometry::mIndexBufferChunk and
@@ -157,6 +364,20 @@ typedef struct MeshletData
     float  coneCutoff; // = cos(angle/2)
 } MeshletData;
 
+// Compact MeshletData written by the AssetPipeline (ProcessGLTF with --meshletquantize), 16 bytes instead of 48.
+// center and radius are unorm over the meshlet bounds of the geometry (Geometry::mMeshletBoundsMin / mMeshletBoundsExtent), radius
+// relative to the length of the extent. Both are rounded so the sphere still contains the meshlet.
+// The cone is the 8 bit snorm encoding of meshoptimizer, the cutoff is conservative, there is no apex: a meshlet is backfacing when
+// dot(center - cameraPosition, coneAxis) >= coneCutoff * length(center - cameraPosition) + radius
+typedef struct MeshletDataQuantized
+{
+    uint16_t center[3];
+    uint16_t radius;
+    int8_t   coneAxis[3];
+    int8_t   coneCutoff;
+    uint32_t pad;
+} MeshletDataQuantized;
+
 typedef struct GeometryMeshlets
 {
     uint64_t     mMeshletCount;
@@ -170,6 +391,22 @@ typedef struct GeometryMeshlets
     uint8_t* mTriangles;
 } GeometryMeshlets;
 
+#define GEOMETRY_MAX_LODS 8
+
+// One level of detail of a Geometry, generated by the AssetPipeline (see ProcessGLTFParams::mLodCount).
+// Levels share the vertex buffers, each one has its own range of the index buffer per subset. Strand levels of hair geometry
+// (ProcessTFX --lods) draw the first strands of level 0 instead, see GeometryLoadDesc::mStrandLod.
+typedef struct GeometryLod
+{
+    /// First draw argument of this level in Geometry::pDrawArgs, each level has Geometry::mDrawArgCount of them in the same subset order
+    uint32_t mDrawArgOffset;
+    /// Meshlets of this level in Geometry::meshlets, zero count when meshlets were not built for this level
+    uint32_t mMeshletOffset;
+    uint32_t mMeshletCount;
+    /// Largest simplification error of the subsets relative to the mesh extents, 0 for the full resolution level
+    float    mError;
+} GeometryLod;
+
 typedef struct Geometry
 {
     union
@@ -211,12 +448,26 @@ typedef struct Geometry
 
     GeometryMeshlets meshlets;
 
-    uint32_t mPad[20];
+    /// Levels of detail, level 0 is the full resolution mesh. NULL and mLodCount 0 when the file has a single level.
+    /// The indices of every level are stored in the index buffer and counted in mIndexCount, draw a level with its draw arguments.
+    GeometryLod* pLods;
+    uint32_t     mLodCount;
+
+    /// Set when the meshlet bounds were quantized, meshlets.mMeshletsData is then NULL and pMeshletsDataQuantized holds them
+    uint32_t              mMeshletDataQuantized;
+    MeshletDataQuantized* pMeshletsDataQuantized;
+    float                 mMeshletBoundsMin[3];
+    float                 mMeshletBoundsExtent[3];
+
+    uint32_t mPad[8];
 } Geometry;
 
 static_assert(sizeof(Geometry) == 352, "If Geometry size changes we need to rebuild all custom binary meshes");
 static_assert(sizeof(Geometry) % 16 == 0, "Geometry size must be a multiple of 16");
 
+// Location of a shadow copy loaded on request, owned by the resource loader (see GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED)
+typedef struct GeometryShadowSource GeometryShadowSource;
+
 // Outputs data that's only needed in the CPU side, OTOH the Geometry object holds GPU related information and buffers
 typedef struct GeometryData
 {
@@ -224,6 +475,15 @@ typedef struct GeometryData
     {
         uint32_t mVertexCountPerStrand;
         uint32_t mGuideCountPerStrand;
+        /// Set when the strands are ordered for strand levels of detail (ProcessTFX --lods): the guides come first and follow hair k uses
+        /// guide k % mGuideCountPerStrand. Otherwise every guide is directly followed by its follow hairs.
+        uint32_t mGuidesFirst;
+        /// Set when positions are 16 bit unorm (ProcessTFX --quantize): xyz = mPositionMin + unorm.xyz * mPositionExtent, w is the
+        /// inverse mass. The resource loader does this when the vertex layout asks for R32G32B32A32_SFLOAT positions, the shadow data
+        /// keeps the 16 bit ones.
+        uint32_t mQuantizedPositions;
+        float    mPositionMin[3];
+        float    mPositionExtent[3];
     };
 
     struct ShadowData
@@ -270,11 +530,80 @@ typedef struct GeometryData
     void*    pUserData;
     uint32_t mUserDataSize;
 
-    uint32_t mPad1[5];
+    uint32_t mPad1[1];
+
+    /// Set by the resource loader when loaded with GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED, NULL otherwise
+    GeometryShadowSource* pShadowSource;
+
+    uint32_t mPad2[2];
 } GeometryData;
 
 static_assert(sizeof(GeometryData) % 16 == 0, "GeometryData size must be a multiple of 16");
 
+// Versioned geometry container written by the AssetPipeline (ProcessGLTF with --packed). Every section starts at a multiple of
+// GEOMETRY_PACKED_FILE_ALIGNMENT and the index and vertex sections are already laid out as the GPU buffers expect, so the file can be
+// memory mapped and copied to the GPU without parsing. Geometry, GeometryData, ShadowData and meshlet sections store the same data as the
+// original custom mesh format (GEOMETRY_FILE_MAGIC_STR), the ShadowData section is used when the runtime layout doesn't match the
+// layout the file was written with.
+// Index and vertex sections can be encoded with the meshoptimizer vertex/index codecs (ProcessGLTF with --compress), they are then
+// decoded by the resource loader straight into staging memory. The other sections are never encoded.
+FORGE_CONSTEXPR const char GEOMETRY_PACKED_FILE_MAGIC_STR[] = { 'G', 'e', 'o', 'm', 'P', 'a', 'c', 'k', 'T', 'F' };
+#define GEOMETRY_PACKED_FILE_VERSION   3
+#define GEOMETRY_PACKED_FILE_ALIGNMENT 16
+
+typedef enum GeometryPackedEncoding
+{
+    /// Section holds the buffer data as-is
+    GEOMETRY_PACKED_ENCODING_NONE = 0,
+    /// Section was encoded with meshopt_encodeIndexBuffer / meshopt_encodeVertexBuffer
+    GEOMETRY_PACKED_ENCODING_MESHOPT = 1,
+} GeometryPackedEncoding;
+
+typedef enum GeometryPackedFilter
+{
+    GEOMETRY_PACKED_FILTER_NONE = 0,
+    /// Every component of the binding is a 32 bit float quantized with meshopt_encodeFilterExp, undone with meshopt_decodeFilterExp
+    GEOMETRY_PACKED_FILTER_EXP = 1,
+} GeometryPackedFilter;
+
+typedef struct GeometryPackedSection
+{
+    /// Offset from the start of the file, multiple of GEOMETRY_PACKED_FILE_ALIGNMENT
+    uint64_t mOffset;
+    uint64_t mSize;
+} GeometryPackedSection;
+
+typedef struct GeometryPackedFileHeader
+{
+    char     mMagic[16];
+    uint32_t mVersion;
+    uint32_t mHeaderSize;
+
+    /// Stride of the indices in mIndices, might differ from the stride of ShadowData::pIndices
+    uint32_t mIndexStride;
+    /// Strides of the vertex buffers in mVertices, zero for unused bindings
+    uint32_t mVertexStrides[MAX_VERTEX_BINDINGS];
+    /// Binding and offset inside the binding of each semantic, UINT32_MAX when the semantic is not stored in the vertex buffers
+    uint32_t mSemanticBindings[MAX_SEMANTICS];
+    uint32_t mSemanticOffsets[MAX_SEMANTICS];
+
+    GeometryPackedSection mGeometry;
+    GeometryPackedSection mGeometryData;
+    GeometryPackedSection mShadow;
+    GeometryPackedSection mMeshlets;
+    GeometryPackedSection mIndices;
+    GeometryPackedSection mVertices[MAX_VERTEX_BINDINGS];
+
+    /// GeometryPackedEncoding of mIndices and mVertices, the size of the decoded data is always stride * count
+    uint32_t mIndexEncoding;
+    uint32_t mVertexEncodings[MAX_VERTEX_BINDINGS];
+    /// GeometryPackedFilter applied to each vertex binding after decoding
+    uint32_t mVertexFilters[MAX_VERTEX_BINDINGS];
+    uint32_t mPad[1];
+} GeometryPackedFileHeader;
+
+static_assert(sizeof(GeometryPackedFileHeader) % GEOMETRY_PACKED_FILE_ALIGNMENT == 0, "Sections must start aligned after the header");
+
 typedef enum GeometryLoadFlags
 {
     GEOMETRY_LOAD_FLAG_NONE = 0x0,
@@ -284,6 +613,10 @@ typedef enum GeometryLoadFlags
     GEOMETRY_LOAD_FLAG_STRUCTURED_BUFFERS = 0x2,
     /// Geometry buffers can be used as input for ray tracing
     GEOMETRY_LOAD_FLAG_RAYTRACING_INPUT = 0x4,
+    /// Shadow copy is loaded on request with addResource(GeometryShadowLoadDesc*) and can be evicted with evictGeometryShadowData.
+    /// Combined with GEOMETRY_LOAD_FLAG_SHADOWED the copy is kept after the load but can still be evicted.
+    /// Requires GeometryLoadDesc::ppGeometryData, not supported by geometry batches.
+    GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED = 0x8,
 } GeometryLoadFlags;
 MAKE_ENUM_FLAG(uint32_t, GeometryLoadFlags)
 
@@ -334,8 +667,70 @@ typedef struct GeometryLoadDesc
 
     /// Used to convert data to desired state inside GeometryBuffer.
     GeometryBufferLayoutDesc* pGeometryBufferLayoutDesc;
+
+    /// Strand level of detail of hair geometry to load (ProcessTFX --lods), 0 loads every strand. Levels are prefixes of the strands so
+    /// only the vertices and indices of the level are uploaded and Geometry::pLods starts at that level. GeometryData::ShadowData
+    /// still holds every strand.
+    uint32_t mStrandLod;
+
+    ResourceLoadPriority mPriority;
 } GeometryLoadDesc;
 
+// Result of loading several geometry containers with a single request, see GeometryBatchLoadDesc.
+// Geometry and GeometryData objects of all files live in a single allocation owned by the batch, they must not be removed individually,
+// use removeResource(GeometryBatch*) instead.
+typedef struct GeometryBatch
+{
+    /// mGeometryCount entries in the same order as GeometryBatchLoadDesc::ppFileNames, entries are NULL for files that failed to load
+    Geometry**      ppGeometry;
+    GeometryData**  ppGeometryData;
+    /// Size of the allocation holding Geometry, GeometryData, ShadowData and meshlets of all the files
+    uint64_t        mMetadataSize;
+    uint32_t        mGeometryCount;
+    GeometryBuffer* pGeometryBuffer;
+    /// Chunks sub-allocated in bulk for the whole batch, Geometry::mIndexBufferChunk and Geometry::mVertexBufferChunks are sub-ranges of these
+    BufferChunk     mIndexBufferChunk;
+    BufferChunk     mVertexBufferChunks[MAX_VERTEX_BINDINGS];
+} GeometryBatch;
+
+typedef struct GeometryBatchLoadDesc
+{
+    /// Output batch, written by the resource loader once the request is processed (wait for the token before accessing it)
+    GeometryBatch**           ppGeometryBatch;
+    /// Filenames of the geometry containers, array is copied but the strings must stay valid until the token is completed
+    const char* const*        ppFileNames;
+    uint32_t                  mFileCount;
+    /// Loading flags, applied to all files
+    GeometryLoadFlags         mFlags;
+    /// Linked gpu node / Unlinked Renderer index
+    uint32_t                  mNodeIndex;
+    /// Specifies how to arrange the vertex data loaded from the files into GPU memory
+    const VertexLayout*       pVertexLayout;
+    /// Required, index and vertex data of the whole batch is sub-allocated from this buffer with one chunk per buffer
+    GeometryBuffer*           pGeometryBuffer;
+    /// Used to convert data to desired state inside GeometryBuffer.
+    GeometryBufferLayoutDesc* pGeometryBufferLayoutDesc;
+    ResourceLoadPriority      mPriority;
+} GeometryBatchLoadDesc;
+
+typedef struct GeometryShadowLoadDesc
+{
+    /// Geometry loaded with GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED, pGeometryData->pShadow is set once the token completes
+    GeometryData*        pGeometryData;
+    ResourceLoadPriority mPriority;
+} GeometryShadowLoadDesc;
+
+typedef struct GeometryShadowStats
+{
+    /// Deferred shadow copies currently in memory
+    uint64_t mResidentSize;
+    uint32_t mResidentCount;
+    uint32_t mGeometryCount;
+    /// Totals since the resource loader was initialized
+    uint64_t mLoadedSize;
+    uint64_t mEvictedSize;
+} GeometryShadowStats;
+
 typedef struct BufferUpdateDesc
 {
     Buffer*  pBuffer;
@@ -469,6 +864,12 @@ typedef struct ResourceLoaderDesc
     uint64_t mBufferSize;
     uint32_t mBufferCount;
     bool     mSingleThreaded;
+    /// Look up shaders in the shader library packed by fsl.py --library (ShaderLibrary.fsllib in the platform shader binary directory)
+    /// before opening their binary files. The library is memory mapped on the first shader load.
+    bool     mUseShaderLibrary;
+    /// Worker threads decompressing supercompressed texture mips (KTX2 zstd) in parallel.
+    /// Zero decompresses them on the resource loader thread.
+    uint32_t mDecompressThreadCount;
 #ifdef ENABLE_FORGE_MATERIALS
     bool mUseMaterials;
 #endif
@@ -518,8 +919,31 @@ FORGE_RENDERER_API void getResourceSizeAlign(const TextureLoadDesc* pDesc, Resou
 FORGE_RENDERER_API void addResource(BufferLoadDesc* pBufferDesc, SyncToken* token);
 FORGE_RENDERER_API void addResource(TextureLoadDesc* pTextureDesc, SyncToken* token);
 FORGE_RENDERER_API void addResource(GeometryLoadDesc* pGeomDesc, SyncToken* token);
+/// Loads all the files with a single request and a single token, metadata of all files is stored in one allocation and index/vertex
+/// data is sub-allocated from GeometryBatchLoadDesc::pGeometryBuffer in bulk
+FORGE_RENDERER_API void addResource(GeometryBatchLoadDesc* pBatchDesc, SyncToken* token);
 FORGE_RENDERER_API void addGeometryBuffer(GeometryBufferLoadDesc* pDesc);
 
+/// Deferred geometry shadow data, these functions must be called from the same thread.
+/// addResource reads the shadow copy of a geometry loaded with GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED, the token is left untouched when the copy
+/// is already in memory. pGeometryData->pShadow must not be accessed until the token completes.
+FORGE_RENDERER_API void addResource(GeometryShadowLoadDesc* pDesc, SyncToken* token);
+/// Frees the least recently requested deferred shadow copies until at most maxResidentSize bytes are left, returns the evicted size.
+/// pShadow of evicted geometries is set to NULL, they are read again by the next addResource(GeometryShadowLoadDesc*).
+FORGE_RENDERER_API uint64_t evictGeometryShadowData(uint64_t maxResidentSize);
+FORGE_RENDERER_API void     getGeometryShadowStats(GeometryShadowStats* pOutStats);
+
+/// Texture streaming, these functions must be called from the same thread.
+/// addResource loads the lowest mips of the file, token completes once they are uploaded and pTexture is set by the next
+/// updateTextureStreaming call.
+FORGE_RENDERER_API void addResource(StreamingTextureLoadDesc* pDesc, SyncToken* token);
+/// Feedback, most detailed mip needed by the texture this frame. Mips that are not requested any more are eventually evicted
+FORGE_RENDERER_API void requestStreamingTextureMip(StreamingTexture* pTexture, uint32_t mostDetailedMip);
+/// Call once per frame: swaps in the textures of completed loads, destroys retired textures and queues new loads/evictions under the budget
+FORGE_RENDERER_API void updateTextureStreaming();
+FORGE_RENDERER_API void setTextureStreamingDesc(const TextureStreamingDesc* pDesc);
+FORGE_RENDERER_API void getTextureStreamingStats(TextureStreamingStats* pOutStats);
+
 FORGE_RENDERER_API void beginUpdateResource(BufferUpdateDesc* pBufferDesc);
 FORGE_RENDERER_API void beginUpdateResource(TextureUpdateDesc* pTextureDesc);
 FORGE_RENDERER_API void endUpdateResource(BufferUpdateDesc* pBuffer);
@@ -537,6 +961,15 @@ FORGE_RENDERER_API void addGeometryBufferPart(BufferChunkAllocator* buffer, uint
 /// Buffer must be the one passed to claimGeometryBufferPart for this chunk.
 FORGE_RENDERER_API void removeGeometryBufferPart(BufferChunkAllocator* buffer, BufferChunk* chunk);
 
+/// Returns usage and fragmentation statistics of the allocator.
+/// Caller takes care of race conditions with addGeometryBufferPart/removeGeometryBufferPart.
+FORGE_RENDERER_API void getBufferChunkAllocatorStats(const BufferChunkAllocator* buffer, BufferChunkAllocatorStats* pOutStats);
+
+/// Fills pOutChunks with the unused chunks of the allocator sorted by offset, returns the total number of unused chunks.
+/// Call with pOutChunks == NULL to query the count.
+FORGE_RENDERER_API uint32_t getBufferChunkAllocatorUnusedChunks(const BufferChunkAllocator* buffer, BufferChunk* pOutChunks,
+                                                                uint32_t maxChunkCount);
+
 typedef struct FlushResourceUpdateDesc
 {
     uint32_t    mNodeIndex;
@@ -555,11 +988,15 @@ FORGE_RENDERER_API void copyResource(TextureCopyDesc* pTextureDesc, SyncToken* t
 // MARK: removeResource
 
 FORGE_RENDERER_API void removeResource(Buffer* pBuffer);
+/// Textures loaded with a TextureCacheMode are destroyed once the last load sharing them is removed
 FORGE_RENDERER_API void removeResource(Texture* pTexture);
 FORGE_RENDERER_API void removeResource(Geometry* pGeom);
 FORGE_RENDERER_API void removeResource(GeometryData* pGeom);
+FORGE_RENDERER_API void removeResource(GeometryBatch* pBatch);
+FORGE_RENDERER_API void removeResource(StreamingTexture* pTexture);
 FORGE_RENDERER_API void removeGeometryBuffer(GeometryBuffer* pGeomBuffer);
-// Frees pGeom->pShadow in case it was requested with GEOMETRY_LOAD_FLAG_SHADOWED and you are already done with it
+// Frees pGeom->pShadow in case it was requested with GEOMETRY_LOAD_FLAG_SHADOWED and you are already done with it.
+// Deferred shadow copies can be requested again afterwards.
 FORGE_RENDERER_API void removeGeometryShadowData(GeometryData* pGeom);
 
 // MARK: Waiting for Loads
@@ -582,9 +1019,14 @@ FORGE_RENDERER_API bool isResourceLoaderSingleThreaded();
 /// A SyncToken is an array of monotonically increasing integers.
 /// getLastTokenCompleted() returns the last value for which
 /// isTokenCompleted(token) is guaranteed to return true.
+/// Requests can complete out of order when they have different priorities: a token is completed once its request and all the
+/// requests with a smaller token and the same or a higher priority are completed. Only merge tokens (max) of requests with the same
+/// priority.
 FORGE_RENDERER_API SyncToken getLastTokenCompleted();
 FORGE_RENDERER_API bool      isTokenCompleted(const SyncToken* token);
 FORGE_RENDERER_API void      waitForToken(const SyncToken* token);
+/// Raises the priority of the queued request that returned token. Returns false if the request was already processed.
+FORGE_RENDERER_API bool      raiseResourceLoadPriority(const SyncToken* token, ResourceLoadPriority priority);
 
 /// Allows clients to synchronize with the submission of copy commands (as opposed to their completion).
 /// This can reduce the wait time for clients but requires using the Semaphore from getLastSemaphoreCompleted() in a wait
@@ -597,6 +1039,17 @@ FORGE_RENDERER_API void      waitForTokenSubmitted(const SyncToken* token);
 /// Could be NULL if no operations have been executed.
 FORGE_RENDERER_API Semaphore* getLastSemaphoreSubmitted(uint32_t nodeIndex);
 
+// MARK: Statistics
+
+/// Throughput is mUploadSize / (sum of mPhaseTime except RESOURCE_LOAD_PHASE_QUEUE) per resource type.
+/// The same counters are published as Profiler counters under "ResourceLoader/" when the profiler is enabled
+FORGE_RENDERER_API void getResourceLoaderStats(ResourceLoaderStats* pOutStats);
+FORGE_RENDERER_API void resetResourceLoaderStats();
+/// Records the phase timestamps of every request processed by the resource loader until endResourceLoadReport.
+FORGE_RENDERER_API void beginResourceLoadReport();
+/// Waits for all queued loads and writes the recorded requests together with the stats of the report as JSON to RD_LOG/pFileName.
+FORGE_RENDERER_API bool endResourceLoadReport(const char* pFileName);
+
 /// Either loads the cached shader bytecode or compiles the shader to create new bytecode depending on whether source is newer than binary
 FORGE_RENDERER_API void addShader(Renderer* pRenderer, const ShaderLoadDesc* pDesc, Shader** pShader);
 
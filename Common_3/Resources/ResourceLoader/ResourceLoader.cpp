@@ -31,6 +31,10 @@
 
 #include "../../Graphics/GraphicsConfig.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward, _BitScanReverse
+#endif
+
 #define TINYKTX_IMPLEMENTATION
 #include "ThirdParty/OpenSource/tinyktx/tinyktx.h"
 
@@ -41,10 +45,19 @@
 #include "../../Utilities/Interfaces/IFileSystem.h"
 #include "../../Utilities/Interfaces/ILog.h"
 #include "../../Utilities/Interfaces/IThread.h"
+#include "../../Utilities/Interfaces/ITime.h"
+#include "../../Utilities/Threading/ThreadSystem.h"
 #include "Interfaces/IResourceLoader.h"
 
+// This macro enables custom ZSTD allocator features
+#define ZSTD_STATIC_LINKING_ONLY
+#include "../../Utilities/ThirdParty/OpenSource/zstd/zstd.h"
+
 #include "../../Utilities/Math/ShaderUtilities.h" // Packing functions
 
+// Vertex/index codecs of compressed packed geometry files
+#include "../../Tools/ThirdParty/OpenSource/meshoptimizer/src/meshoptimizer.h"
+
 #if defined(GLES)
 #include "../../Graphics/OpenGLES/GLESContextCreator.h"
 #endif
@@ -62,6 +75,8 @@
 
 #include "../../Tools/ReloadServer/ReloadClient.h"
 
+#include "../../Application/Profiler/ProfilerBase.h"
+
 // If facing strange gfx issues, corruption, GPU hangs, enable this for verbose logging of resource loading
 #define RESOURCE_LOADER_VERBOSE 0
 #if RESOURCE_LOADER_VERBOSE
@@ -160,6 +175,28 @@ struct FSLHeader
     FSLMetadata mMetadata;
 };
 
+// Needs to match with shader_library.py
+#define FSL_LIBRARY_FILE_NAME "ShaderLibrary.fsllib"
+#define FSL_LIBRARY_VERSION   1
+
+struct FSLLibraryHeader
+{
+    char     mMagic[4];
+    uint32_t mVersion;
+    uint32_t mEntryCount;
+    uint32_t mNamesSize;
+};
+
+// Entries are sorted by name hash then name, each one points to an unmodified FSL binary
+struct FSLLibraryEntry
+{
+    uint64_t mNameHash;
+    uint32_t mNameOffset;
+    uint32_t mNameSize;
+    uint64_t mOffset;
+    uint64_t mSize;
+};
+
 bool gl_compileShader(Renderer* pRenderer, ShaderStage stage, const char* fileName, uint32_t codeSize, const char* code,
                       BinaryShaderStageDesc* pOut, const char* pEntryPoint);
 
@@ -258,6 +295,55 @@ struct MaterialDesc
     char*    pStringBuffer;
 };
 
+// Binary compiled material written by forge_material_compiler.py, needs to match with it.
+// Records follow the header in this order: FMBShaderSet, FMBTextureSet, FMBTexture, FMBMaterialSet, shader name offsets (uint32_t),
+// binding name offsets (uint32_t) and the null terminated strings. Name offsets are relative to the start of the strings.
+#define FMB_VERSION 1
+
+struct FMBHeader
+{
+    char     mMagic[4];
+    uint32_t mVersion;
+    uint32_t mShaderSetCount;
+    uint32_t mTextureSetCount;
+    uint32_t mMaterialSetCount;
+    uint32_t mShaderCount;
+    uint32_t mTextureCount;
+    uint32_t mBindingCount;
+    uint32_t mMaxShaderSetBindings;
+    uint32_t mMaxTextureSetTextures;
+    uint32_t mStringsSize;
+};
+
+struct FMBShaderSet
+{
+    uint32_t mId;
+    // Indexes into the shader names in MaterialDesc::ShaderSet order, INVALID_MATERIAL_ID for unused stages
+    uint32_t mShaderIdx[6];
+    uint32_t mFirstBinding;
+    uint32_t mBindingCount;
+};
+
+struct FMBTextureSet
+{
+    uint32_t mFirstTexture;
+    uint32_t mTextureCount;
+};
+
+struct FMBTexture
+{
+    uint32_t mNameOffset;
+    uint32_t mFlags;
+    uint32_t mId;
+};
+
+struct FMBMaterialSet
+{
+    uint32_t mNameOffset;
+    uint32_t mShaderSetIdx;
+    uint32_t mTextureSetIdx;
+};
+
 typedef struct Material
 {
     // Contains information about the GPU resources used by this material.
@@ -504,6 +590,7 @@ static inline bool IssueExplicitInitialStateBarrier()
 }
 
 ResourceLoaderDesc          gDefaultResourceLoaderDesc = { 8ull * TF_MB, 2, false };
+TextureStreamingDesc        gDefaultTextureStreamingDesc = { UINT64_MAX, MAX_FRAMES + 1, 60, 8 };
 /************************************************************************/
 // Surface Utils
 /************************************************************************/
@@ -593,8 +680,19 @@ struct TextureLoadDescInternal
         };
     };
     bool mForceReset;
+    // Texture cache key allocated by addResource, released by the resource loader thread
+    char*            pCacheKey;
+    TextureCacheMode mCacheMode;
 };
 
+typedef struct TextureStreamDescInternal
+{
+    StreamingTexture* pStreamingTexture;
+    /// Number of lowest mips the new texture holds
+    uint32_t          mMipCount;
+    uint32_t          mNodeIndex;
+} TextureStreamDescInternal;
+
 typedef struct TextureUpdateDescInternal
 {
     Texture*          pTexture;
@@ -608,6 +706,10 @@ typedef struct TextureUpdateDescInternal
     PreMipStepFn      pPreMipFunc;
     ResourceState     mCurrentState;
     bool              mMipsAfterSlice;
+    // Optional - Reads each subresource from its offset in the container instead of reading the stream sequentially.
+    // Mip levels of the texture map to the container mips starting at mSrcBaseMipLevel (used by texture streaming)
+    const TextureContainerLayout* pContainerLayout;
+    uint32_t                      mSrcBaseMipLevel;
 } TextureUpdateDescInternal;
 
 typedef struct CopyResourceSet
@@ -663,6 +765,9 @@ typedef struct CopyEngine
 
     bool isRecording;
     bool flushOnOverflow;
+
+    /// Request being processed by the resource loader thread, NULL for the upload engines
+    struct ResourceLoadRecord* pActiveRecord;
 } CopyEngine;
 
 typedef enum UpdateRequestType
@@ -672,6 +777,9 @@ typedef enum UpdateRequestType
     UPDATE_REQUEST_LOAD_TEXTURE,
     UPDATE_REQUEST_LOAD_GEOMETRY,
     UPDATE_REQUEST_COPY_TEXTURE,
+    UPDATE_REQUEST_LOAD_GEOMETRY_BATCH,
+    UPDATE_REQUEST_STREAM_TEXTURE,
+    UPDATE_REQUEST_LOAD_GEOMETRY_SHADOW,
     UPDATE_REQUEST_INVALID,
 } UpdateRequestType;
 
@@ -684,14 +792,19 @@ typedef enum UploadFunctionResult
 
 struct UpdateRequest
 {
+    UpdateRequest(): bufLoadDesc() {}
     UpdateRequest(const BufferLoadDescInternal& buffer): mType(UPDATE_REQUEST_LOAD_BUFFER), bufLoadDesc(buffer) {}
     UpdateRequest(const TextureLoadDescInternal& texture): mType(UPDATE_REQUEST_LOAD_TEXTURE), texLoadDesc(texture) {}
     UpdateRequest(const GeometryLoadDesc& geom): mType(UPDATE_REQUEST_LOAD_GEOMETRY), geomLoadDesc(geom) {}
     UpdateRequest(const TextureBarrier& barrier): mType(UPDATE_REQUEST_TEXTURE_BARRIER), textureBarrier(barrier) {}
     UpdateRequest(const TextureCopyDesc& texture): mType(UPDATE_REQUEST_COPY_TEXTURE), texCopyDesc(texture) {}
+    UpdateRequest(const GeometryBatchLoadDesc& batch): mType(UPDATE_REQUEST_LOAD_GEOMETRY_BATCH), geomBatchLoadDesc(batch) {}
+    UpdateRequest(const TextureStreamDescInternal& texture): mType(UPDATE_REQUEST_STREAM_TEXTURE), texStreamDesc(texture) {}
+    UpdateRequest(const GeometryShadowLoadDesc& shadow): mType(UPDATE_REQUEST_LOAD_GEOMETRY_SHADOW), geomShadowLoadDesc(shadow) {}
 
     UpdateRequestType mType = UPDATE_REQUEST_INVALID;
     uint64_t          mWaitIndex = 0;
+    int64_t           mQueueTime = 0;
     union
     {
         BufferLoadDescInternal  bufLoadDesc;
@@ -699,9 +812,169 @@ struct UpdateRequest
         GeometryLoadDesc        geomLoadDesc;
         TextureBarrier          textureBarrier;
         TextureCopyDesc         texCopyDesc;
+        GeometryBatchLoadDesc     geomBatchLoadDesc;
+        TextureStreamDescInternal texStreamDesc;
+        GeometryShadowLoadDesc    geomShadowLoadDesc;
     };
 };
 
+typedef struct RetiredStreamingTexture
+{
+    Texture* pTexture;
+    uint64_t mRetireFrame;
+} RetiredStreamingTexture;
+
+typedef struct StreamingTextureUpdate
+{
+    StreamingTexture* pTexture;
+    uint32_t          mDesiredMipCount;
+} StreamingTextureUpdate;
+
+// Only accessed by the thread calling the texture streaming functions
+typedef struct TextureStreaming
+{
+    TextureStreamingDesc mDesc;
+    // stb_ds arrays
+    StreamingTexture**       pTextures;
+    RetiredStreamingTexture* pRetiredTextures;
+    StreamingTextureUpdate*  pUpdates;
+    uint64_t                 mFrameIndex;
+    uint64_t                 mRequestedSize;
+    uint64_t                 mUploadedSize;
+    uint64_t                 mEvictedSize;
+} TextureStreaming;
+
+typedef struct ResourceLoadRecord
+{
+    char             mName[128];
+    ResourceLoadType mType;
+    uint32_t         mNodeIndex;
+    SyncToken        mToken;
+    uint64_t         mUploadSize;
+    /// Timestamps in microseconds, mSubmitTime and mCompleteTime are only known while a load report is active
+    int64_t          mQueueTime;
+    int64_t          mStartTime;
+    int64_t          mEndTime;
+    int64_t          mSubmitTime;
+    int64_t          mCompleteTime;
+    int64_t           mPhaseTime[RESOURCE_LOAD_PHASE_COUNT];
+    TextureUploadPath mUploadPath;
+    bool              mFailed;
+} ResourceLoadRecord;
+
+typedef struct ResourceLoaderStatistics
+{
+    Mutex               mMutex;
+    ResourceLoaderStats mStats;
+    /// Load report, only accumulated between beginResourceLoadReport and endResourceLoadReport
+    ResourceLoaderStats mReportStats;
+    // stb_ds array
+    ResourceLoadRecord* pRecords;
+    uint32_t            mSubmittedRecordCount;
+    uint32_t            mCompletedRecordCount;
+    int64_t             mReportStartTime;
+    bool                mReportActive;
+#if defined(ENABLE_PROFILER)
+    ProfileToken mUploadSizeCounters[RESOURCE_LOAD_TYPE_COUNT];
+    ProfileToken mRequestCounters[RESOURCE_LOAD_TYPE_COUNT];
+    ProfileToken mStagingStallCounter;
+#endif
+} ResourceLoaderStatistics;
+
+// Priority levels from the lowest to the highest, see getPriorityLevel
+#define RESOURCE_LOAD_PRIORITY_LEVEL_COUNT 3
+// A waiting lower priority request is picked after this many higher priority requests so bulk loads still make progress
+#define RESOURCE_LOAD_STARVATION_LIMIT     8
+
+typedef enum PendingTokenState
+{
+    PENDING_TOKEN_STATE_QUEUED = 0,
+    PENDING_TOKEN_STATE_SUBMITTED,
+    PENDING_TOKEN_STATE_COMPLETED,
+} PendingTokenState;
+
+typedef struct PendingToken
+{
+    SyncToken mToken;
+    uint32_t  mLevel;
+    uint32_t  mState;
+} PendingToken;
+
+static inline uint32_t getPriorityLevel(ResourceLoadPriority priority) { return (uint32_t)(clamp((int)priority, -1, 1) + 1); }
+
+typedef struct ShaderLibrary
+{
+    Mutex                  mMutex;
+    FileStream             mStream;
+    const FSLLibraryEntry* pEntries;
+    const char*            pNames;
+    const uint8_t*         pData;
+    uint64_t               mSize;
+    uint32_t               mEntryCount;
+    // The library is opened on the first shader load
+    bool                   mOpenAttempted;
+} ShaderLibrary;
+
+// Texture shared by the cached loads resolving to it
+typedef struct CachedTexture
+{
+    Texture* pTexture;
+    uint64_t mSize;
+    // Zero when the content was not hashed
+    uint64_t mContentHash;
+    uint64_t mFileSize;
+    uint32_t mRefCount;
+    // stb_ds array of the path keys mapped to this texture
+    char**   ppPathKeys;
+} CachedTexture;
+
+typedef struct TextureCache
+{
+    Mutex mMutex;
+    // stb_ds hash maps, entries are only added by the resource loader thread
+    struct
+    {
+        char*          key;
+        CachedTexture* value;
+    }* pPathMap;
+    struct
+    {
+        uint64_t       key;
+        CachedTexture* value;
+    }* pContentMap;
+    struct
+    {
+        Texture*       key;
+        CachedTexture* value;
+    }* pTextureMap;
+} TextureCache;
+
+// File location of a shadow copy loaded with GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED
+struct GeometryShadowSource
+{
+    // Stored right after the struct, same allocation
+    char*    pFileName;
+    uint64_t mOffset;
+    uint64_t mSize;
+    uint32_t mIndexCount;
+    uint32_t mVertexCount;
+    // GeometryShadowCache::mRequestCounter when the copy was last requested, least recently requested copies are evicted first
+    uint64_t mLastRequest;
+};
+
+// Deferred shadow copies, accessed by the thread requesting them and the resource loader thread
+typedef struct GeometryShadowCache
+{
+    Mutex          mMutex;
+    // stb_ds array of the geometries whose deferred shadow copy is in memory
+    GeometryData** ppResident;
+    uint64_t       mRequestCounter;
+    uint64_t       mResidentSize;
+    uint64_t       mLoadedSize;
+    uint64_t       mEvictedSize;
+    uint32_t       mGeometryCount;
+} GeometryShadowCache;
+
 struct ResourceLoader
 {
     Renderer* ppRenderers[MAX_MULTIPLE_GPUS];
@@ -716,8 +989,14 @@ struct ResourceLoader
     ConditionVariable mQueueCond;
     Mutex             mTokenMutex;
     ConditionVariable mTokenCond;
-    // array of stb_ds arrays
-    UpdateRequest*    mRequestQueue[MAX_MULTIPLE_GPUS];
+    // array of stb_ds arrays, one FIFO per priority level
+    UpdateRequest*    mRequestQueue[MAX_MULTIPLE_GPUS][RESOURCE_LOAD_PRIORITY_LEVEL_COUNT];
+    // Index of the first request not yet consumed by the streamer thread
+    uint32_t          mRequestQueueHead[MAX_MULTIPLE_GPUS][RESOURCE_LOAD_PRIORITY_LEVEL_COUNT];
+    // Number of requests picked from a higher level while this level was waiting
+    uint32_t          mSkippedCount[MAX_MULTIPLE_GPUS][RESOURCE_LOAD_PRIORITY_LEVEL_COUNT];
+    // stb_ds array sorted by token, protected by mQueueMutex
+    PendingToken*     pPendingTokens;
 
     tfrg_atomic64_t mTokenCompleted;
     tfrg_atomic64_t mTokenSubmitted;
@@ -725,16 +1004,66 @@ struct ResourceLoader
 
     Mutex mSemaphoreMutex;
 
-    SyncToken mCurrentTokenState[MAX_FRAMES];
-    SyncToken mMaxToken;
+    // stb_ds arrays only accessed by the streamer thread
+    SyncToken* pProcessedTokens;
+    SyncToken* pSetTokens[MAX_FRAMES];
 
     CopyEngine pCopyEngines[MAX_MULTIPLE_GPUS];
     CopyEngine pUploadEngines[MAX_MULTIPLE_GPUS];
     Mutex      mUploadEngineMutex;
+
+    TextureStreaming mStreaming;
+
+    // Decompresses supercompressed texture mips, runs the tasks on the caller when mDecompressThreadCount is zero
+    ThreadSystem mDecompressThreads;
+
+    ResourceLoaderStatistics mStatistics;
+
+    TextureCache mTextureCache;
+
+    GeometryShadowCache mGeometryShadows;
+
+    ShaderLibrary mShaderLibrary;
 };
 
 static ResourceLoader* pResourceLoader = NULL;
 
+static const char* gResourceLoadTypeNames[RESOURCE_LOAD_TYPE_COUNT] = {
+    "Buffer", "Texture", "Geometry", "GeometryBatch", "StreamingTexture", "TextureCopy", "TextureBarrier", "GeometryShadow",
+};
+
+static const char* gResourceLoadPhaseNames[RESOURCE_LOAD_PHASE_COUNT] = {
+    "Queue", "FileIO", "Decompress", "Process", "StagingWait", "GpuCopy",
+};
+
+static const char* gTextureUploadPathNames[TEXTURE_UPLOAD_PATH_COUNT] = {
+    "None", "Rows", "Subresources", "SingleRead", "Mapped",
+};
+
+// Accumulates the time spent in the scope into a phase of the request processed by the copy engine
+struct LoadPhaseScope
+{
+    ResourceLoadRecord* pRecord;
+    ResourceLoadPhase   mPhase;
+    int64_t             mStart;
+
+    LoadPhaseScope(CopyEngine* pCopyEngine, ResourceLoadPhase phase):
+        pRecord(pCopyEngine->pActiveRecord), mPhase(phase), mStart(pRecord ? getUSec(false) : 0)
+    {
+    }
+    ~LoadPhaseScope()
+    {
+        if (pRecord)
+            pRecord->mPhaseTime[mPhase] += getUSec(false) - mStart;
+    }
+};
+
+static size_t loaderReadFromStream(CopyEngine* pCopyEngine, FileStream* pStream, void* pOutputBuffer, size_t bufferSizeInBytes)
+{
+    LoadPhaseScope ioScope(pCopyEngine, RESOURCE_LOAD_PHASE_FILE_IO);
+    return fsReadFromStream(pStream, pOutputBuffer, bufferSizeInBytes);
+}
+
 static uint32_t util_get_texture_row_alignment(Renderer* pRenderer)
 {
     return max(1u, pRenderer->pGpu->mSettings.mUploadBufferTextureRowAlignment);
@@ -1083,6 +1412,31 @@ static void streamerFlush(CopyEngine* pCopyEngine)
     }
 }
 
+static void addStagingMemoryStats(CopyEngine* pCopyEngine, uint64_t tempBufferSize, bool tempBuffer, int64_t waitTime)
+{
+    ResourceLoaderStatistics* pStatistics = &pResourceLoader->mStatistics;
+    if (pCopyEngine->pActiveRecord)
+    {
+        pCopyEngine->pActiveRecord->mUploadSize += tempBufferSize;
+        pCopyEngine->pActiveRecord->mPhaseTime[RESOURCE_LOAD_PHASE_STAGING_WAIT] += waitTime;
+    }
+
+    acquireMutex(&pStatistics->mMutex);
+    ResourceLoaderStats* ppStats[2] = { &pStatistics->mStats, pStatistics->mReportActive ? &pStatistics->mReportStats : NULL };
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(ppStats) && ppStats[i]; ++i)
+    {
+        ppStats[i]->mTempStagingBufferCount += tempBuffer ? 1 : 0;
+        ppStats[i]->mTempStagingBufferSize += tempBufferSize;
+        ppStats[i]->mStagingStallCount += tempBuffer ? 0 : 1;
+    }
+    releaseMutex(&pStatistics->mMutex);
+
+#if defined(ENABLE_PROFILER)
+    if (!tempBuffer)
+        ProfileCounterAdd(pStatistics->mStagingStallCounter, 1);
+#endif
+}
+
 /// Return memory from pre-allocated staging buffer or create a temporary buffer if the streamer ran out of memory
 static MappedMemoryRange allocateStagingMemory(CopyEngine* pCopyEngine, uint64_t memoryRequirement, uint32_t alignment, uint32_t nodeIndex)
 {
@@ -1103,6 +1457,7 @@ static MappedMemoryRange allocateStagingMemory(CopyEngine* pCopyEngine, uint64_t
             "Allocating temporary staging buffer. Required allocation size of %llu is larger than the staging buffer capacity of %llu",
             memoryRequirement, size);
         arrpush(pResourceSet->mTempBuffers, range.pBuffer);
+        addStagingMemoryStats(pCopyEngine, memoryRequirement, true, 0);
         return range;
     }
 
@@ -1114,6 +1469,8 @@ static MappedMemoryRange allocateStagingMemory(CopyEngine* pCopyEngine, uint64_t
         ASSERT(buffer->pCpuMappedAddress);
         uint8_t* pDstData = (uint8_t*)buffer->pCpuMappedAddress + offset;
         pCopyEngine->resourceSets[pCopyEngine->activeSet].mAllocatedSpace = offset + memoryRequirement;
+        if (pCopyEngine->pActiveRecord)
+            pCopyEngine->pActiveRecord->mUploadSize += memoryRequirement;
         return { pDstData, buffer, offset, memoryRequirement };
     }
     else
@@ -1121,7 +1478,11 @@ static MappedMemoryRange allocateStagingMemory(CopyEngine* pCopyEngine, uint64_t
         if (pCopyEngine->flushOnOverflow)
         {
             ASSERT(pCopyEngine->pFnFlush);
+            const int64_t waitStart = getUSec(false);
             pCopyEngine->pFnFlush(pCopyEngine);
+            // Waits until the next staging buffer is no longer used by the GPU
+            acquireCmd(pCopyEngine);
+            addStagingMemoryStats(pCopyEngine, 0, false, getUSec(false) - waitStart);
             return allocateStagingMemory(pCopyEngine, memoryRequirement, alignment, nodeIndex);
         }
 
@@ -1229,6 +1590,29 @@ static UploadFunctionResult loadBuffer(Renderer* pRenderer, CopyEngine* pCopyEng
     return res;
 }
 
+// Size of the subresources of the update when each one is stored without padding in staging memory, so that the staging memory matches the
+// layout of a file storing them one after the other. Zero when the staging layout adds row or slice padding.
+static uint64_t util_get_packed_texture_size(const Texture* pTexture, uint32_t rowAlignment, uint32_t sliceAlignment,
+                                             const TextureUpdateDescInternal& texUpdateDesc)
+{
+    const TinyImageFormat fmt = (TinyImageFormat)pTexture->mFormat;
+    uint64_t              mipChainSize = 0;
+    for (uint32_t mip = texUpdateDesc.mBaseMipLevel; mip < texUpdateDesc.mBaseMipLevel + texUpdateDesc.mMipLevels; ++mip)
+    {
+        uint32_t numBytes = 0;
+        uint32_t rowBytes = 0;
+        uint32_t numRows = 0;
+        if (!util_get_surface_info(MIP_REDUCE(pTexture->mWidth, mip), MIP_REDUCE(pTexture->mHeight, mip), fmt, &numBytes, &rowBytes,
+                                   &numRows) ||
+            round_up(rowBytes, rowAlignment) != rowBytes || round_up(rowBytes * numRows, sliceAlignment) != rowBytes * numRows)
+        {
+            return 0;
+        }
+        mipChainSize += (uint64_t)rowBytes * numRows * MIP_REDUCE(pTexture->mDepth, mip);
+    }
+    return mipChainSize * texUpdateDesc.mLayerCount;
+}
+
 static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopyEngine, const TextureUpdateDescInternal& texUpdateDesc)
 {
     // When this call comes from updateResource, staging buffer data is already filled
@@ -1283,6 +1667,32 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
         return UPLOAD_FUNCTION_RESULT_STAGING_BUFFER_FULL;
     }
 
+    // Fast path: the file stores the subresources one after the other in the staging layout, so the payload is copied in one pass
+    TextureUploadPath uploadPath = TEXTURE_UPLOAD_PATH_NONE;
+    if (!dataAlreadyFilled && !texUpdateDesc.pPreMipFunc && !texUpdateDesc.pContainerLayout)
+    {
+        const uint64_t packedSize = util_get_packed_texture_size(texture, rowAlignment, sliceAlignment, texUpdateDesc);
+        const ssize_t  position = fsGetStreamSeekPosition(&stream);
+        size_t         mappedSize = 0;
+        const void*    pMapped = NULL;
+        if (packedSize && position >= 0 && fsStreamMemoryMap(&stream, &mappedSize, &pMapped) && pMapped &&
+            (uint64_t)position + packedSize <= mappedSize)
+        {
+            LoadPhaseScope ioScope(pCopyEngine, RESOURCE_LOAD_PHASE_FILE_IO);
+            memcpy(upload.pData, (const uint8_t*)pMapped + position, (size_t)packedSize);
+            uploadPath = TEXTURE_UPLOAD_PATH_MAPPED;
+        }
+        else if (packedSize)
+        {
+            if (loaderReadFromStream(pCopyEngine, &stream, upload.pData, (size_t)packedSize) != packedSize)
+            {
+                return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+            }
+            uploadPath = TEXTURE_UPLOAD_PATH_SINGLE_READ;
+        }
+    }
+    const bool payloadFilled = dataAlreadyFilled || uploadPath != TEXTURE_UPLOAD_PATH_NONE;
+
     uint32_t firstStart = texUpdateDesc.mMipsAfterSlice ? texUpdateDesc.mBaseMipLevel : texUpdateDesc.mBaseArrayLayer;
     uint32_t firstEnd = texUpdateDesc.mMipsAfterSlice ? (texUpdateDesc.mBaseMipLevel + texUpdateDesc.mMipLevels)
                                                       : (texUpdateDesc.mBaseArrayLayer + texUpdateDesc.mLayerCount);
@@ -1329,15 +1739,30 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
                 uint32_t subDepth = d;
                 uint8_t* data = upload.pData + offset;
 
-                if (!dataAlreadyFilled)
+                if (!payloadFilled)
                 {
+                    if (texUpdateDesc.pContainerLayout &&
+                        !fsSeekStream(&stream, SBO_START_OF_FILE,
+                                      (ssize_t)util_get_container_subresource_offset(texUpdateDesc.pContainerLayout,
+                                                                                     mip + texUpdateDesc.mSrcBaseMipLevel, layer)))
+                    {
+                        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+                    }
+
+                    // Rows are only read one by one when the staging row pitch adds padding
+                    const bool     packedRows = subRowPitch == rowBytes;
+                    const uint32_t rowsPerRead = packedRows ? subNumRows : 1;
+                    const size_t   readSize = (size_t)rowBytes * rowsPerRead;
+                    uploadPath = packedRows && uploadPath != TEXTURE_UPLOAD_PATH_ROWS ? TEXTURE_UPLOAD_PATH_SUBRESOURCES
+                                                                                      : TEXTURE_UPLOAD_PATH_ROWS;
+
                     for (uint32_t z = 0; z < subDepth; ++z)
                     {
                         uint8_t* dstData = data + subSlicePitch * z;
-                        for (uint32_t r = 0; r < subNumRows; ++r)
+                        for (uint32_t r = 0; r < subNumRows; r += rowsPerRead)
                         {
-                            ssize_t bytesRead = fsReadFromStream(&stream, dstData + r * subRowPitch, rowBytes);
-                            if (bytesRead != rowBytes)
+                            size_t bytesRead = loaderReadFromStream(pCopyEngine, &stream, dstData + r * subRowPitch, readSize);
+                            if (bytesRead != readSize)
                             {
                                 return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
                             }
@@ -1369,9 +1794,282 @@ static UploadFunctionResult updateTexture(Renderer* pRenderer, CopyEngine* pCopy
         fsCloseStream(&stream);
     }
 
+    if (pCopyEngine->pActiveRecord)
+    {
+        pCopyEngine->pActiveRecord->mUploadPath = uploadPath;
+    }
+
     return UPLOAD_FUNCTION_RESULT_COMPLETED;
 }
 
+/************************************************************************/
+// Supercompressed textures
+/************************************************************************/
+static void* tfAllocForZstd(void* pUser, size_t size)
+{
+    UNREF_PARAM(pUser);
+    return tf_malloc(size);
+}
+
+static void tfFreeForZstd(void* pUser, void* pMemory)
+{
+    UNREF_PARAM(pUser);
+    tf_free(pMemory);
+}
+
+static const ZSTD_customMem gZstdAllocator = {
+    tfAllocForZstd,
+    tfFreeForZstd,
+    NULL,
+};
+
+typedef struct TextureLevelDecompressTask
+{
+    const uint8_t* pSrc;
+    uint64_t       mSrcSize;
+    uint8_t*       pDst;
+    uint64_t       mDstSize;
+    bool           mSucceeded;
+} TextureLevelDecompressTask;
+
+static void decompressTextureLevel(void* pUser, uint64_t threadId)
+{
+    UNREF_PARAM(threadId);
+    TextureLevelDecompressTask* pTask = (TextureLevelDecompressTask*)pUser;
+
+    ZSTD_DCtx*   pCtx = ZSTD_createDCtx_advanced(gZstdAllocator);
+    const size_t size = pCtx ? ZSTD_decompressDCtx(pCtx, pTask->pDst, (size_t)pTask->mDstSize, pTask->pSrc, (size_t)pTask->mSrcSize) : 0;
+    pTask->mSucceeded = pCtx && !ZSTD_isError(size) && size == pTask->mDstSize;
+    ZSTD_freeDCtx(pCtx);
+}
+
+// Reads the supercompressed mips [baseMip, baseMip + mipCount) of the container and decompresses them in parallel, one task per mip.
+// On success pStream is replaced by a memory stream holding the decompressed mips and pLayout addresses them through pLevels.
+static bool decompressContainerLevels(CopyEngine* pCopyEngine, FileStream* pStream, TextureContainerLayout* pLayout,
+                                      KTX2Level pLevels[KTX2_MAX_LEVELS], uint32_t baseMip, uint32_t mipCount)
+{
+    ASSERT(pLayout->pLevels == pLevels && pLayout->mSupercompression == KTX2_SUPERCOMPRESSION_ZSTD);
+    ASSERT(baseMip + mipCount <= pLayout->mMipLevels);
+
+    uint64_t srcSize = 0;
+    uint64_t dstSize = 0;
+    for (uint32_t mip = baseMip; mip < baseMip + mipCount; ++mip)
+    {
+        // Subresources are read from the decompressed mip without further checks
+        if (pLevels[mip].mUncompressedByteLength != util_get_container_mip_size(pLayout, mip) * pLayout->mArraySize)
+        {
+            return false;
+        }
+        srcSize += pLevels[mip].mByteLength;
+        dstSize += pLevels[mip].mUncompressedByteLength;
+    }
+
+    uint8_t* pSrc = (uint8_t*)tf_malloc((size_t)srcSize);
+    uint8_t* pDst = (uint8_t*)tf_malloc((size_t)dstSize);
+    bool     success = pSrc && pDst;
+
+    TextureLevelDecompressTask tasks[KTX2_MAX_LEVELS] = {};
+    uint64_t                   srcOffset = 0;
+    uint64_t                   dstOffset = 0;
+    for (uint32_t i = 0; i < mipCount && success; ++i)
+    {
+        KTX2Level*                  pLevel = &pLevels[baseMip + i];
+        TextureLevelDecompressTask* pTask = &tasks[i];
+        pTask->pSrc = pSrc + srcOffset;
+        pTask->mSrcSize = pLevel->mByteLength;
+        pTask->pDst = pDst + dstOffset;
+        pTask->mDstSize = pLevel->mUncompressedByteLength;
+
+        success = fsSeekStream(pStream, SBO_START_OF_FILE, (ssize_t)pLevel->mByteOffset) &&
+                  loaderReadFromStream(pCopyEngine, pStream, pSrc + srcOffset, (size_t)pLevel->mByteLength) == pLevel->mByteLength;
+
+        srcOffset += pLevel->mByteLength;
+        dstOffset += pLevel->mUncompressedByteLength;
+    }
+
+    if (success)
+    {
+        LoadPhaseScope decompressScope(pCopyEngine, RESOURCE_LOAD_PHASE_DECOMPRESS);
+        ThreadSystem   threads = pResourceLoader->mDecompressThreads;
+        threadSystemAddTaskGroup(threads, decompressTextureLevel, mipCount, tasks);
+        // Decompress on this thread as well instead of only waiting for the workers
+        while (threadSystemAssist(threads))
+        {
+        }
+        threadSystemWaitIdle(threads);
+
+        for (uint32_t i = 0; i < mipCount; ++i)
+        {
+            success = success && tasks[i].mSucceeded;
+        }
+    }
+
+    tf_free(pSrc);
+    if (!success)
+    {
+        tf_free(pDst);
+        return false;
+    }
+
+    dstOffset = 0;
+    for (uint32_t mip = baseMip; mip < baseMip + mipCount; ++mip)
+    {
+        pLevels[mip].mByteOffset = dstOffset;
+        pLevels[mip].mByteLength = pLevels[mip].mUncompressedByteLength;
+        dstOffset += pLevels[mip].mUncompressedByteLength;
+    }
+    pLayout->mSupercompression = KTX2_SUPERCOMPRESSION_NONE;
+
+    // The memory stream owns the decompressed mips
+    fsCloseStream(pStream);
+    return fsOpenStreamFromMemory(pDst, (size_t)dstSize, FM_READ, true, pStream);
+}
+
+/************************************************************************/
+// Texture cache
+/************************************************************************/
+static void addTextureCacheStats(bool hit, uint64_t bytesSaved)
+{
+    ResourceLoaderStatistics* pStatistics = &pResourceLoader->mStatistics;
+    acquireMutex(&pStatistics->mMutex);
+    ResourceLoaderStats* ppStats[2] = { &pStatistics->mStats, pStatistics->mReportActive ? &pStatistics->mReportStats : NULL };
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(ppStats) && ppStats[i]; ++i)
+    {
+        ppStats[i]->mTextureCacheHitCount += hit ? 1 : 0;
+        ppStats[i]->mTextureCacheMissCount += hit ? 0 : 1;
+        ppStats[i]->mTextureCacheBytesSaved += bytesSaved;
+    }
+    releaseMutex(&pStatistics->mMutex);
+}
+
+static char* getTextureCacheKey(const TextureLoadDesc* pTextureDesc)
+{
+    // Loads only share a texture when they would create identical textures
+    char path[FS_MAX_PATH] = {};
+    fsMergeDirAndFileName("", pTextureDesc->pFileName, '/', sizeof(path), path);
+
+    char   prefix[64] = {};
+    int    prefixLength = snprintf(prefix, sizeof(prefix), "%u:%u:%u:%p:", pTextureDesc->mNodeIndex, (uint32_t)pTextureDesc->mCreationFlag,
+                                   (uint32_t)pTextureDesc->mContainer, (void*)pTextureDesc->pYcbcrSampler);
+    size_t pathLength = strlen(path);
+    char*  pKey = (char*)tf_malloc((size_t)prefixLength + pathLength + 1);
+    memcpy(pKey, prefix, (size_t)prefixLength);
+    memcpy(pKey + prefixLength, path, pathLength + 1);
+    return pKey;
+}
+
+static uint64_t hashTextureContent(const TextureLoadDescInternal* pTextureDesc, FileStream* pStream, uint64_t* pOutFileSize)
+{
+    size_t      size = 0;
+    const void* pData = NULL;
+    if (!fsStreamMemoryMap(pStream, &size, &pData) || !pData)
+    {
+        return 0;
+    }
+
+    const size_t seed = (size_t)pTextureDesc->mFlags ^ ((size_t)pTextureDesc->mContainer << 16) ^ ((size_t)pTextureDesc->mNodeIndex << 24) ^
+                        (size_t)pTextureDesc->pYcbcrSampler;
+    const uint64_t hash = (uint64_t)stbds_hash_bytes(pData, size, seed);
+    *pOutFileSize = size;
+    // Zero means the content was not hashed
+    return hash ? hash : 1;
+}
+
+// Returns the cached texture of the path key, or the one with identical content when contentHash is not zero
+static bool acquireCachedTexture(const char* pKey, uint64_t contentHash, uint64_t fileSize, Texture** ppTexture)
+{
+    TextureCache* pCache = &pResourceLoader->mTextureCache;
+    acquireMutex(&pCache->mMutex);
+    CachedTexture* pCached = shget(pCache->pPathMap, pKey);
+    if (!pCached && contentHash)
+    {
+        pCached = hmget(pCache->pContentMap, contentHash);
+        if (pCached && pCached->mFileSize == fileSize)
+        {
+            // Following loads of this path resolve without hashing the file again
+            char* pPathKey = (char*)tf_malloc(strlen(pKey) + 1);
+            strcpy(pPathKey, pKey);
+            arrpush(pCached->ppPathKeys, pPathKey);
+            shput(pCache->pPathMap, pPathKey, pCached);
+        }
+        else
+        {
+            pCached = NULL;
+        }
+    }
+
+    if (pCached)
+    {
+        ++pCached->mRefCount;
+        *ppTexture = pCached->pTexture;
+    }
+    releaseMutex(&pCache->mMutex);
+
+    if (pCached)
+    {
+        addTextureCacheStats(true, pCached->mSize);
+    }
+    return pCached != NULL;
+}
+
+static void addCachedTexture(const char* pKey, Texture* pTexture, uint64_t contentHash, uint64_t fileSize)
+{
+    CachedTexture* pCached = (CachedTexture*)tf_calloc(1, sizeof(CachedTexture));
+    pCached->pTexture = pTexture;
+    pCached->mSize = util_get_surface_size((TinyImageFormat)pTexture->mFormat, pTexture->mWidth, pTexture->mHeight, pTexture->mDepth, 1, 1,
+                                           0, pTexture->mMipLevels, 0, pTexture->mArraySizeMinusOne + 1u);
+    pCached->mContentHash = contentHash;
+    pCached->mFileSize = fileSize;
+    pCached->mRefCount = 1;
+
+    char* pPathKey = (char*)tf_malloc(strlen(pKey) + 1);
+    strcpy(pPathKey, pKey);
+    arrpush(pCached->ppPathKeys, pPathKey);
+
+    TextureCache* pCache = &pResourceLoader->mTextureCache;
+    acquireMutex(&pCache->mMutex);
+    shput(pCache->pPathMap, pPathKey, pCached);
+    hmput(pCache->pTextureMap, pTexture, pCached);
+    if (contentHash)
+    {
+        hmput(pCache->pContentMap, contentHash, pCached);
+    }
+    releaseMutex(&pCache->mMutex);
+
+    addTextureCacheStats(false, 0);
+}
+
+// Returns false while the texture is still referenced by other cached loads
+static bool releaseCachedTexture(Texture* pTexture)
+{
+    TextureCache* pCache = &pResourceLoader->mTextureCache;
+    acquireMutex(&pCache->mMutex);
+    CachedTexture* pCached = hmget(pCache->pTextureMap, pTexture);
+    if (pCached && --pCached->mRefCount)
+    {
+        releaseMutex(&pCache->mMutex);
+        return false;
+    }
+
+    if (pCached)
+    {
+        for (ptrdiff_t i = 0; i < arrlen(pCached->ppPathKeys); ++i)
+        {
+            shdel(pCache->pPathMap, pCached->ppPathKeys[i]);
+            tf_free(pCached->ppPathKeys[i]);
+        }
+        arrfree(pCached->ppPathKeys);
+        if (pCached->mContentHash)
+        {
+            (void)hmdel(pCache->pContentMap, pCached->mContentHash);
+        }
+        (void)hmdel(pCache->pTextureMap, pTexture);
+        tf_free(pCached);
+    }
+    releaseMutex(&pCache->mMutex);
+    return true;
+}
+
 static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEngine, const UpdateRequest& pTextureUpdate)
 {
     const TextureLoadDescInternal* pTextureDesc = &pTextureUpdate.texLoadDesc;
@@ -1420,11 +2118,18 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
 
     if (pTextureDesc->pFileName)
     {
+        if (pTextureDesc->pCacheKey && acquireCachedTexture(pTextureDesc->pCacheKey, 0, 0, pTextureDesc->ppTexture))
+        {
+            return UPLOAD_FUNCTION_RESULT_COMPLETED;
+        }
+
         FileStream stream = {};
         bool       success = false;
 
         TextureUpdateDescInternal updateDesc = {};
         TextureContainerType      container = pTextureDesc->mContainer;
+        TextureContainerLayout    containerLayout = {};
+        KTX2Level                 containerLevels[KTX2_MAX_LEVELS] = {};
 
         if (TEXTURE_CONTAINER_DEFAULT == container)
         {
@@ -1483,15 +2188,51 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
             success = fsOpenStreamFromPath(RD_TEXTURES, pTextureDesc->pFileName, FM_READ, &stream);
             if (success)
             {
-                success = loadKTXTextureDesc(&stream, &textureDesc);
+                success = loadKTXTextureDesc(&stream, &textureDesc, &containerLayout.mCubePadding);
                 updateDesc.mMipsAfterSlice = true;
-                // KTX stores mip size before the mip data
-                // This function gets called to skip the mip size so we read the mip data
-                updateDesc.pPreMipFunc = [](FileStream* pStream, uint32_t)
+                if (containerLayout.mCubePadding)
                 {
-                    uint32_t mipSize = 0;
-                    fsReadFromStream(pStream, &mipSize, sizeof(mipSize));
-                };
+                    // Faces of non array cubemaps are padded, each subresource is read from its offset in the container
+                    updateDesc.pContainerLayout = &containerLayout;
+                    containerLayout.mFormat = textureDesc.mFormat;
+                    containerLayout.mWidth = textureDesc.mWidth;
+                    containerLayout.mHeight = textureDesc.mHeight;
+                    containerLayout.mDepth = textureDesc.mDepth;
+                    containerLayout.mMipLevels = textureDesc.mMipLevels;
+                    containerLayout.mArraySize = textureDesc.mArraySize;
+                    containerLayout.mDataOffset = (uint64_t)fsGetStreamSeekPosition(&stream);
+                    containerLayout.mMipsAfterSlice = true;
+                }
+                else
+                {
+                    // KTX stores mip size before the mip data
+                    // This function gets called to skip the mip size so we read the mip data
+                    updateDesc.pPreMipFunc = [](FileStream* pStream, uint32_t)
+                    {
+                        uint32_t mipSize = 0;
+                        fsReadFromStream(pStream, &mipSize, sizeof(mipSize));
+                    };
+                }
+            }
+            break;
+        }
+        case TEXTURE_CONTAINER_KTX2:
+        {
+            success = fsOpenStreamFromPath(RD_TEXTURES, pTextureDesc->pFileName, FM_READ, &stream);
+            if (success)
+            {
+                success = loadKTX2TextureDesc(&stream, &textureDesc, &containerLayout.mSupercompression, containerLevels);
+                // Each subresource is read from its offset in the level index
+                updateDesc.mMipsAfterSlice = true;
+                updateDesc.pContainerLayout = &containerLayout;
+                containerLayout.mFormat = textureDesc.mFormat;
+                containerLayout.mWidth = textureDesc.mWidth;
+                containerLayout.mHeight = textureDesc.mHeight;
+                containerLayout.mDepth = textureDesc.mDepth;
+                containerLayout.mMipLevels = textureDesc.mMipLevels;
+                containerLayout.mArraySize = textureDesc.mArraySize;
+                containerLayout.mMipsAfterSlice = true;
+                containerLayout.pLevels = containerLevels;
             }
             break;
         }
@@ -1540,6 +2281,27 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
                 textureDesc.pSamplerYcbcrConversionInfo = &pTextureDesc->pYcbcrSampler->mVk.mSamplerYcbcrConversionInfo;
             }
 #endif
+            uint64_t contentHash = 0;
+            uint64_t fileSize = 0;
+            if (pTextureDesc->pCacheKey && pTextureDesc->mCacheMode == TEXTURE_CACHE_MODE_CONTENT)
+            {
+                LoadPhaseScope processScope(pCopyEngine, RESOURCE_LOAD_PHASE_PROCESS);
+                contentHash = hashTextureContent(pTextureDesc, &stream, &fileSize);
+                if (contentHash && acquireCachedTexture(pTextureDesc->pCacheKey, contentHash, fileSize, pTextureDesc->ppTexture))
+                {
+                    fsCloseStream(&stream);
+                    return UPLOAD_FUNCTION_RESULT_COMPLETED;
+                }
+            }
+
+            if (containerLayout.mSupercompression != KTX2_SUPERCOMPRESSION_NONE &&
+                !decompressContainerLevels(pCopyEngine, &stream, &containerLayout, containerLevels, 0, textureDesc.mMipLevels))
+            {
+                LOGF(eERROR, "Failed to decompress texture %s", pTextureDesc->pFileName);
+                fsCloseStream(&stream);
+                return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+            }
+
             addTexture(pRenderer, &textureDesc, pTextureDesc->ppTexture);
 
             updateDesc.mStream = stream;
@@ -1566,6 +2328,11 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
                 cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
             }
 
+            if (pTextureDesc->pCacheKey && UPLOAD_FUNCTION_RESULT_COMPLETED == res)
+            {
+                addCachedTexture(pTextureDesc->pCacheKey, *pTextureDesc->ppTexture, contentHash, fileSize);
+            }
+
             return res;
         }
     }
@@ -1575,219 +2342,235 @@ static UploadFunctionResult loadTexture(Renderer* pRenderer, CopyEngine* pCopyEn
     return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
 }
 
-static void fillGeometryUpdateDesc(Renderer* pRenderer, CopyEngine* pCopyEngine, GeometryLoadDesc* pDesc, Geometry* geom,
-                                   uint32_t* indexStride, BufferUpdateDesc vertexUpdateDesc[MAX_VERTEX_BINDINGS],
-                                   BufferUpdateDesc indexUpdateDesc[1])
+static void getStreamingTextureLayout(const StreamingTexture* pTexture, TextureContainerLayout* pOutLayout)
 {
-    UNREF_PARAM(pCopyEngine);
-    bool     structuredBuffers = (pDesc->mFlags & GEOMETRY_LOAD_FLAG_STRUCTURED_BUFFERS) > 0;
-    uint32_t indexBufferSize = *indexStride * geom->mIndexCount;
+    pOutLayout->mFormat = (TinyImageFormat)pTexture->mInternal.mFormat;
+    pOutLayout->mWidth = pTexture->mInternal.mWidth;
+    pOutLayout->mHeight = pTexture->mInternal.mHeight;
+    pOutLayout->mDepth = pTexture->mInternal.mDepth;
+    pOutLayout->mMipLevels = pTexture->mMipLevels;
+    pOutLayout->mArraySize = pTexture->mInternal.mArraySize;
+    pOutLayout->mDataOffset = pTexture->mInternal.mDataOffset;
+    pOutLayout->mCubePadding = pTexture->mInternal.mCubePadding;
+}
 
-    if (pDesc->pGeometryBuffer)
-    {
-        if (pDesc->pGeometryBufferLayoutDesc)
-        {
-            *indexStride = pDesc->pGeometryBufferLayoutDesc->mIndexType == INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
-            indexBufferSize = *indexStride * geom->mIndexCount;
-        }
+static UploadFunctionResult streamTexture(Renderer* pRenderer, CopyEngine* pCopyEngine, const UpdateRequest& pTextureStream)
+{
+    const TextureStreamDescInternal* pDesc = &pTextureStream.texStreamDesc;
+    StreamingTexture*                pStreaming = pDesc->pStreamingTexture;
 
-        addGeometryBufferPart(&pDesc->pGeometryBuffer->mIndex, indexBufferSize, *indexStride, &geom->mIndexBufferChunk);
-
-        indexUpdateDesc->pBuffer = pDesc->pGeometryBuffer->mIndex.pBuffer;
-        indexUpdateDesc->mDstOffset = geom->mIndexBufferChunk.mOffset;
-    }
-    else
+    TextureContainerType container = pStreaming->mInternal.mContainer;
+    if (TEXTURE_CONTAINER_DEFAULT == container)
     {
-        BufferDesc loadDesc = {};
-        loadDesc.mDescriptors =
-            DESCRIPTOR_TYPE_INDEX_BUFFER | (structuredBuffers ? (DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER)
-                                                              : (DESCRIPTOR_TYPE_BUFFER_RAW | DESCRIPTOR_TYPE_RW_BUFFER_RAW));
-        loadDesc.mFlags |= (pDesc->mFlags & GEOMETRY_LOAD_FLAG_RAYTRACING_INPUT)
-                               ? (BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS | BUFFER_CREATION_FLAG_ACCELERATION_STRUCTURE_BUILD_INPUT)
-                               : BUFFER_CREATION_FLAG_NONE;
-        loadDesc.mSize = indexBufferSize;
-        loadDesc.mElementCount = (uint32_t)(loadDesc.mSize / (structuredBuffers ? *indexStride : sizeof(uint32_t)));
-        loadDesc.mStructStride = *indexStride;
-        loadDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-        loadDesc.mStartState = gUma ? gIndexBufferState : RESOURCE_STATE_COPY_DEST;
-        addBuffer(pRenderer, &loadDesc, &geom->pIndexBuffer);
-        indexUpdateDesc->pBuffer = geom->pIndexBuffer;
-        indexUpdateDesc->mDstOffset = 0;
+#if defined(TARGET_IOS) || defined(__ANDROID__) || defined(NX64)
+        container = TEXTURE_CONTAINER_KTX;
+#else
+        container = TEXTURE_CONTAINER_DDS;
+#endif
     }
 
-    indexUpdateDesc->mSize = geom->mIndexCount * *indexStride;
-
-    // We need to check for pCpuMappedAddress because when we allocate a custom ResourceHeap with GPU_ONLY memory we don't get any CPU
-    // mapped address and we need staging memory
-    if (gUma && indexUpdateDesc->pBuffer->pCpuMappedAddress)
-    {
-        indexUpdateDesc->mInternal.mMappedRange = { (uint8_t*)indexUpdateDesc->pBuffer->pCpuMappedAddress + indexUpdateDesc->mDstOffset };
-    }
-    else
+    FileStream stream = {};
+    if ((container != TEXTURE_CONTAINER_DDS && container != TEXTURE_CONTAINER_KTX && container != TEXTURE_CONTAINER_KTX2) ||
+        !fsOpenStreamFromPath(RD_TEXTURES, pStreaming->mInternal.pFileName, FM_READ, &stream))
     {
-        indexUpdateDesc->mInternal.mMappedRange.pData = (uint8_t*)tf_calloc_memalign(1, 4, indexUpdateDesc->mSize);
+        LOGF(eERROR, "Failed to open streaming texture file %s", pStreaming->mInternal.pFileName);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
-    indexUpdateDesc->pMappedData = indexUpdateDesc->mInternal.mMappedRange.pData;
-
-    // Vertex buffers
-    uint32_t bufferCounter = 0;
-    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
-    {
-        if (!geom->mVertexStrides[i])
-            continue;
 
-        uint32_t size = geom->mVertexStrides[i] * geom->mVertexCount;
+    KTX2Level levels[KTX2_MAX_LEVELS] = {};
+    uint32_t  supercompression = KTX2_SUPERCOMPRESSION_NONE;
 
-        if (pDesc->pGeometryBuffer)
-        {
-            addGeometryBufferPart(&pDesc->pGeometryBuffer->mVertex[i], size, geom->mVertexStrides[i], &geom->mVertexBufferChunks[i]);
-            vertexUpdateDesc[i].pBuffer = pDesc->pGeometryBuffer->mVertex[i].pBuffer;
-            vertexUpdateDesc[i].mDstOffset = geom->mVertexBufferChunks[i].mOffset;
-        }
-        else
+    // Header is only parsed by the first load, next loads seek straight to the mips they need.
+    // KTX2 level index is read by every load as the mips are found through it.
+    if (!pStreaming->mMipLevels || container == TEXTURE_CONTAINER_KTX2)
+    {
+        TextureDesc textureDesc = {};
+        bool*       pCubePadding = &pStreaming->mInternal.mCubePadding;
+        bool        success = container == TEXTURE_CONTAINER_DDS   ? loadDDSTextureDesc(&stream, &textureDesc)
+                              : container == TEXTURE_CONTAINER_KTX ? loadKTXTextureDesc(&stream, &textureDesc, pCubePadding)
+                                                                   : loadKTX2TextureDesc(&stream, &textureDesc, &supercompression, levels);
+        if (!success)
         {
-            BufferDesc vertexBufferDesc = {};
-            vertexBufferDesc.mDescriptors =
-                DESCRIPTOR_TYPE_VERTEX_BUFFER | (structuredBuffers ? (DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER)
-                                                                   : (DESCRIPTOR_TYPE_BUFFER_RAW | DESCRIPTOR_TYPE_RW_BUFFER_RAW));
-            vertexBufferDesc.mFlags |=
-                (pDesc->mFlags & GEOMETRY_LOAD_FLAG_RAYTRACING_INPUT)
-                    ? (BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS | BUFFER_CREATION_FLAG_ACCELERATION_STRUCTURE_BUILD_INPUT)
-                    : BUFFER_CREATION_FLAG_NONE;
-            vertexBufferDesc.mSize = size;
-            vertexBufferDesc.mElementCount =
-                (uint32_t)(vertexBufferDesc.mSize / (structuredBuffers ? geom->mVertexStrides[i] : sizeof(uint32_t)));
-            vertexBufferDesc.mStructStride = geom->mVertexStrides[i];
-            vertexBufferDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-            vertexBufferDesc.mStartState = gUma ? gVertexBufferState : RESOURCE_STATE_COPY_DEST;
-            vertexBufferDesc.pName = "VertexBuffer";
-            addBuffer(pRenderer, &vertexBufferDesc, &geom->pVertexBuffers[bufferCounter]);
-
-            vertexUpdateDesc[i].pBuffer = geom->pVertexBuffers[bufferCounter];
-            vertexUpdateDesc[i].mDstOffset = 0;
+            LOGF(eERROR, "Failed to read header of streaming texture %s", pStreaming->mInternal.pFileName);
+            fsCloseStream(&stream);
+            return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
         }
 
-        vertexUpdateDesc[i].mSize = size;
-
-        // We need to check for pCpuMappedAddress because when we allocate a custom ResourceHeap with GPU_ONLY memory we don't get any CPU
-        // mapped address and we need staging memory
-        if (gUma && vertexUpdateDesc[i].pBuffer->pCpuMappedAddress)
+        if (pStreaming->mInternal.mCreationFlag & TEXTURE_CREATION_FLAG_SRGB)
         {
-            vertexUpdateDesc[i].mInternal.mMappedRange = { (uint8_t*)vertexUpdateDesc[i].pBuffer->pCpuMappedAddress +
-                                                           vertexUpdateDesc[i].mDstOffset };
+            TinyImageFormat srgbFormat = TinyImageFormat_ToSRGB(textureDesc.mFormat);
+            textureDesc.mFormat = srgbFormat != TinyImageFormat_UNDEFINED ? srgbFormat : textureDesc.mFormat;
         }
-        else
+
+        pStreaming->mInternal.mWidth = textureDesc.mWidth;
+        pStreaming->mInternal.mHeight = textureDesc.mHeight;
+        pStreaming->mInternal.mDepth = textureDesc.mDepth;
+        pStreaming->mInternal.mArraySize = textureDesc.mArraySize;
+        pStreaming->mInternal.mFormat = (uint32_t)textureDesc.mFormat;
+        pStreaming->mInternal.mDescriptors = textureDesc.mDescriptors;
+        pStreaming->mInternal.mDataOffset = (uint64_t)fsGetStreamSeekPosition(&stream);
+        pStreaming->mMipLevels = textureDesc.mMipLevels;
+    }
+
+    TextureContainerLayout layout = {};
+    getStreamingTextureLayout(pStreaming, &layout);
+    layout.mMipsAfterSlice = container != TEXTURE_CONTAINER_DDS;
+    layout.pLevels = container == TEXTURE_CONTAINER_KTX2 ? levels : NULL;
+    layout.mSupercompression = supercompression;
+
+    const uint32_t lastMip = layout.mMipLevels - 1;
+    // KTX2 levels are already checked against the file size when reading the level index
+    if (!layout.pLevels)
+    {
+        const uint64_t dataEnd = util_get_container_subresource_offset(&layout, lastMip, layout.mArraySize - 1) +
+                                 util_get_container_mip_size(&layout, lastMip);
+        if (fsGetStreamFileSize(&stream) < (ssize_t)dataEnd)
         {
-            vertexUpdateDesc[i].mInternal.mMappedRange.pData = (uint8_t*)tf_calloc_memalign(1, 4, vertexUpdateDesc[i].mSize);
+            LOGF(eERROR, "Streaming texture %s is truncated", pStreaming->mInternal.pFileName);
+            fsCloseStream(&stream);
+            return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
         }
-        vertexUpdateDesc[i].pMappedData = vertexUpdateDesc[i].mInternal.mMappedRange.pData;
-        ++bufferCounter;
     }
 
-    geom->mVertexBufferCount = bufferCounter;
-}
+    const uint32_t mipCount = clamp(pDesc->mMipCount, 1u, layout.mMipLevels);
+    const uint32_t baseMip = layout.mMipLevels - mipCount;
 
-static UploadFunctionResult loadGeometryCustomMeshFormat(Renderer* pRenderer, CopyEngine* pCopyEngine, GeometryLoadDesc* pDesc,
-                                                         BufferUpdateDesc vertexUpdateDesc[MAX_VERTEX_BINDINGS],
-                                                         BufferUpdateDesc indexUpdateDesc[1])
-{
-    FileStream file = {};
-    if (!fsOpenStreamFromPath(RD_MESHES, pDesc->pFileName, FM_READ, &file))
+    // Only the mips that become resident are decompressed
+    if (layout.mSupercompression != KTX2_SUPERCOMPRESSION_NONE &&
+        !decompressContainerLevels(pCopyEngine, &stream, &layout, levels, baseMip, mipCount))
     {
-        LOGF(eERROR, "Failed to open bin file %s", pDesc->pFileName);
-        ASSERT(false);
+        LOGF(eERROR, "Failed to decompress mips %u-%u of streaming texture %s", baseMip, lastMip, pStreaming->mInternal.pFileName);
+        fsCloseStream(&stream);
         return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
 
-    char magic[TF_ARRAY_COUNT(GEOMETRY_FILE_MAGIC_STR)] = { 0 };
-    COMPILE_ASSERT(sizeof(magic) == sizeof(GEOMETRY_FILE_MAGIC_STR));
-    fsReadFromStream(&file, magic, sizeof(magic));
-
-    if (strncmp(magic, GEOMETRY_FILE_MAGIC_STR, TF_ARRAY_COUNT(magic)) != 0)
-    {
-        LOGF(eERROR, "File '%s' is not a Geometry file.", pDesc->pFileName);
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    // The texture only holds the resident mips, its mip 0 is the most detailed resident mip of the file
+    TextureDesc textureDesc = {};
+    textureDesc.pName = pStreaming->mInternal.pFileName;
+    textureDesc.mFlags = pStreaming->mInternal.mCreationFlag;
+    textureDesc.mWidth = MIP_REDUCE(layout.mWidth, baseMip);
+    textureDesc.mHeight = MIP_REDUCE(layout.mHeight, baseMip);
+    textureDesc.mDepth = MIP_REDUCE(layout.mDepth, baseMip);
+    textureDesc.mArraySize = layout.mArraySize;
+    textureDesc.mMipLevels = mipCount;
+    textureDesc.mFormat = layout.mFormat;
+    textureDesc.mDescriptors = pStreaming->mInternal.mDescriptors;
+    textureDesc.mSampleCount = SAMPLE_COUNT_1;
+    textureDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+    textureDesc.mNodeIndex = pStreaming->mInternal.mNodeIndex;
+
+    Texture* pTexture = NULL;
+    addTexture(pRenderer, &textureDesc, &pTexture);
+
+    if (IssueExplicitInitialStateBarrier())
+    {
+        TextureBarrier barrier = { pTexture, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_COPY_DEST };
+        Cmd*           cmd = acquireCmd(pCopyEngine);
+        cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
     }
 
-    uint32_t geomSize = 0;
-    fsReadFromStream(&file, &geomSize, sizeof(uint32_t));
-    if (!VERIFYMSG(geomSize >= 352, "File '%s': Geometry object must have a size >= 352.", pDesc->pFileName))
+    TextureUpdateDescInternal updateDesc = {};
+    updateDesc.mStream = stream;
+    updateDesc.pTexture = pTexture;
+    updateDesc.mMipLevels = mipCount;
+    updateDesc.mLayerCount = layout.mArraySize;
+    updateDesc.mCurrentState = RESOURCE_STATE_COPY_DEST;
+    updateDesc.mMipsAfterSlice = layout.mMipsAfterSlice;
+    updateDesc.pContainerLayout = &layout;
+    updateDesc.mSrcBaseMipLevel = baseMip;
+
+    UploadFunctionResult res = updateTexture(pRenderer, pCopyEngine, updateDesc);
+    if (UPLOAD_FUNCTION_RESULT_COMPLETED != res)
     {
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+        // Copy commands referencing the texture are already recorded, so it is only removed by updateTextureStreaming
+        // once the token of this request completes. The resident mips stay as they are.
+        LOGF(eERROR, "Failed to stream mips %u-%u of texture %s", baseMip, lastMip, pStreaming->mInternal.pFileName);
+        fsCloseStream(&stream);
+        pStreaming->mInternal.pFailedTexture = pTexture;
+        return res;
     }
 
-    Geometry* geom = (Geometry*)tf_calloc(1, geomSize);
-
-    if (!VERIFYMSG(geom, "File '%s': Geometry object is a nullptr.", pDesc->pFileName))
+    if (IssueTextureCopyBarriers())
     {
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+        TextureBarrier barrier = { pTexture, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE };
+        Cmd*           cmd = acquirePostCopyBarrierCmd(pCopyEngine);
+        cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
     }
 
-    fsReadFromStream(&file, geom, geomSize);
+    // Published to the main thread by updateTextureStreaming once the token of this request completes
+    pStreaming->mInternal.pPendingTexture = pTexture;
+    return res;
+}
 
-    uint32_t geomDataSize = 0;
-    fsReadFromStream(&file, &geomDataSize, sizeof(uint32_t));
-    if (!VERIFYMSG(geomDataSize > 0, "File '%s': Geometry object must have a size greater than 0.", pDesc->pFileName))
-    {
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
-    }
+typedef struct GeometryVertexCopyInfo
+{
+    /// Number of attributes stored in each binding
+    uint32_t mAttribCount[MAX_SEMANTICS];
+    /// Offset of each semantic in the GPU layout, UINT_MAX if pVertexLayout doesn't use it
+    uint32_t mOffsets[MAX_SEMANTICS];
+    /// Binding of each semantic in the GPU layout
+    uint32_t mBindings[MAX_SEMANTICS];
+    /// 16 bit hair positions expanded to the float4 positions requested by pVertexLayout (GeometryData::Hair::mQuantizedPositions)
+    bool     mDequantizePositions;
+    float    mPositionMin[3];
+    float    mPositionExtent[3];
+} GeometryVertexCopyInfo;
+
+// Patches the pointers of a Geometry/GeometryData read from a custom mesh file so that they point to the data that follows each struct
+static void setupGeometryShadowPointers(GeometryData::ShadowData* pShadow, uint32_t indexCount, uint32_t vertexCount)
+{
+    // Determine index stride
+    const uint32_t indexStride = vertexCount > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t);
 
-    GeometryData* geomData = (GeometryData*)tf_calloc(1, geomDataSize);
-    if (!VERIFYMSG(geomData, "File '%s': Geometry object is a nullptr.", pDesc->pFileName))
-    {
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
-    }
+    pShadow->pIndices = pShadow + 1;
 
-    fsReadFromStream(&file, geomData, geomDataSize);
+    pShadow->pAttributes[SEMANTIC_POSITION] = (uint8_t*)pShadow->pIndices + (indexCount * indexStride);
 
-    uint32_t shadowSize = 0;
-    fsReadFromStream(&file, &shadowSize, sizeof(uint32_t));
-    ASSERT(shadowSize > 0);
-    if (shadowSize < sizeof(*geomData->pShadow))
-    {
-        LOGF(eERROR, "File '%s': Geometry object has shadow with size less than %x, got %x", pDesc->pFileName,
-             (int)sizeof(*geomData->pShadow), (int)shadowSize);
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
-    }
+    for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
+        pShadow->pAttributes[s] = (uint8_t*)pShadow->pAttributes[s - 1] + pShadow->mVertexStrides[s - 1] * pShadow->mAttributeCount[s - 1];
 
-    geomData->pShadow = (GeometryData::ShadowData*)tf_malloc(shadowSize);
-    if (!geomData->pShadow)
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(pShadow->mVertexStrides); ++i)
     {
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+        if (pShadow->mVertexStrides[i] == 0)
+            pShadow->pAttributes[i] = nullptr;
     }
+}
 
-    if (!VERIFYMSG(fsReadFromStream(&file, geomData->pShadow, shadowSize) == shadowSize,
-                   "File '%s': Failed to read Geometry object's shadow.", pDesc->pFileName))
+// Meshlets, their bounds (MeshletData or MeshletDataQuantized), vertices and triangles are stored back to back
+static uint64_t getGeometryMeshletsSize(const Geometry* geom)
+{
+    const uint64_t dataSize = geom->mMeshletDataQuantized ? sizeof(MeshletDataQuantized) : sizeof(MeshletData);
+    return geom->meshlets.mMeshletCount * (sizeof(Meshlet) + dataSize) + geom->meshlets.mVertexCount * sizeof(uint32_t) +
+           geom->meshlets.mTriangleCount * sizeof(uint8_t);
+}
+
+static void setupGeometryMeshletPointers(Geometry* geom, void* pMeshlets)
+{
+    geom->meshlets.mMeshlets = (Meshlet*)pMeshlets;
+    uint8_t* pData = (uint8_t*)(geom->meshlets.mMeshlets + geom->meshlets.mMeshletCount);
+    if (geom->mMeshletDataQuantized)
     {
-        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+        geom->meshlets.mMeshletsData = NULL;
+        geom->pMeshletsDataQuantized = (MeshletDataQuantized*)pData;
+        pData += geom->meshlets.mMeshletCount * sizeof(MeshletDataQuantized);
     }
-
-    if (geom->meshlets.mMeshletCount)
+    else
     {
-        uint64_t meshlets_size = geom->meshlets.mMeshletCount * sizeof *geom->meshlets.mMeshlets;
-        uint64_t meshlets_data_size = geom->meshlets.mMeshletCount * sizeof *geom->meshlets.mMeshletsData;
-        uint64_t vertices_size = geom->meshlets.mVertexCount * sizeof *geom->meshlets.mVertices;
-        uint64_t triangles_size = geom->meshlets.mTriangleCount * sizeof *geom->meshlets.mTriangles;
-
-        uint64_t alloc_size = meshlets_size + meshlets_data_size + vertices_size + triangles_size;
-
-        void* mem = tf_malloc(alloc_size);
-
-        geom->meshlets.mMeshlets = (Meshlet*)mem;
-        geom->meshlets.mMeshletsData = (MeshletData*)(geom->meshlets.mMeshlets + geom->meshlets.mMeshletCount);
-        geom->meshlets.mVertices = (uint32_t*)(geom->meshlets.mMeshletsData + geom->meshlets.mMeshletCount);
-        geom->meshlets.mTriangles = (uint8_t*)(geom->meshlets.mVertices + geom->meshlets.mVertexCount);
-
-        size_t read = fsReadFromStream(&file, mem, alloc_size);
-        if (alloc_size != read)
-        {
-            return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
-        }
+        geom->meshlets.mMeshletsData = (MeshletData*)pData;
+        geom->pMeshletsDataQuantized = NULL;
+        pData += geom->meshlets.mMeshletCount * sizeof(MeshletData);
     }
+    geom->meshlets.mVertices = (uint32_t*)pData;
+    geom->meshlets.mTriangles = (uint8_t*)(geom->meshlets.mVertices + geom->meshlets.mVertexCount);
+}
 
-    fsCloseStream(&file);
-
+static void setupGeometryPointers(Geometry* geom, GeometryData* geomData)
+{
     geom->pDrawArgs = (IndirectDrawIndexArguments*)(geom + 1); //-V1027
+    // The level of detail table follows the draw arguments of all levels
+    geom->pLods = geom->mLodCount > 0 ? (GeometryLod*)((uint8_t*)geom->pDrawArgs +
+                                                        round_up(geom->mLodCount * geom->mDrawArgCount * sizeof(*geom->pDrawArgs), 16))
+                                      : NULL;
 
     if (geomData->mJointCount > 0)
     {
@@ -1804,35 +2587,122 @@ static UploadFunctionResult loadGeometryCustomMeshFormat(Renderer* pRenderer, Co
         geomData->pUserData = pUserData;
     }
 
-    // Determine index stride
-    const uint32_t indexStride = geom->mVertexCount > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t);
+    // Shadow data is not always read from the file (see loadGeometryPackedFormat)
+    if (geomData->pShadow)
+        setupGeometryShadowPointers(geomData->pShadow, geom->mIndexCount, geom->mVertexCount);
+}
+
+// Remembers where the shadow copy is stored so it can be read again once freed or evicted (GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED).
+// The counts are the ones of the file, a strand level of detail only reduces the counts of the Geometry.
+static void addGeometryShadowSource(GeometryData* geomData, uint32_t indexCount, uint32_t vertexCount, const char* pFileName,
+                                    uint64_t offset, uint64_t size)
+{
+    GeometryShadowCache*  pCache = &pResourceLoader->mGeometryShadows;
+    const size_t          nameSize = strlen(pFileName) + 1;
+    GeometryShadowSource* pSource = (GeometryShadowSource*)tf_malloc(sizeof(GeometryShadowSource) + nameSize);
+    pSource->pFileName = (char*)(pSource + 1);
+    memcpy(pSource->pFileName, pFileName, nameSize);
+    pSource->mOffset = offset;
+    pSource->mSize = size;
+    pSource->mIndexCount = indexCount;
+    pSource->mVertexCount = vertexCount;
+    pSource->mLastRequest = 0;
+    geomData->pShadowSource = pSource;
+
+    acquireMutex(&pCache->mMutex);
+    ++pCache->mGeometryCount;
+    // Also requested with GEOMETRY_LOAD_FLAG_SHADOWED, the copy stays in memory until evicted
+    if (geomData->pShadow)
+    {
+        pSource->mLastRequest = ++pCache->mRequestCounter;
+        pCache->mResidentSize += size;
+        arrpush(pCache->ppResident, geomData);
+    }
+    releaseMutex(&pCache->mMutex);
+}
 
-    geomData->pShadow->pIndices = geomData->pShadow + 1;
+// Must be called with GeometryShadowCache::mMutex held
+static void removeResidentGeometryShadow(GeometryShadowCache* pCache, GeometryData* pGeom)
+{
+    for (ptrdiff_t i = 0; i < arrlen(pCache->ppResident); ++i)
+    {
+        if (pCache->ppResident[i] == pGeom)
+        {
+            pCache->mResidentSize -= pGeom->pShadowSource->mSize;
+            arrdelswap(pCache->ppResident, i);
+            return;
+        }
+    }
+}
 
-    geomData->pShadow->pAttributes[SEMANTIC_POSITION] = (uint8_t*)geomData->pShadow->pIndices + (geom->mIndexCount * indexStride);
+// Keeps the first strands of hair geometry up to the level requested with GeometryLoadDesc::mStrandLod, levels below it are dropped from
+// Geometry::pLods. Must be called once the pointers of the geometry are set up, the shadow data keeps the counts of the file.
+static void selectGeometryStrandLod(const GeometryLoadDesc* pDesc, Geometry* geom, GeometryData* geomData)
+{
+    if (!pDesc->mStrandLod)
+        return;
 
-    for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
-        geomData->pShadow->pAttributes[s] = (uint8_t*)geomData->pShadow->pAttributes[s - 1] +
-                                            geomData->pShadow->mVertexStrides[s - 1] * geomData->pShadow->mAttributeCount[s - 1];
+    GeometryData::Hair* pHair = &geomData->mHair;
+    if (!pHair->mGuidesFirst || pHair->mVertexCountPerStrand < 2 || geom->mLodCount < 2 || geom->mDrawArgCount != 1)
+    {
+        LOGF(eWARNING, "File '%s' has no strand levels of detail, all strands are loaded.", pDesc->pFileName);
+        return;
+    }
+
+    const uint32_t lod = min(pDesc->mStrandLod, geom->mLodCount - 1);
+    const uint32_t strandIndexCount = 6 * (pHair->mVertexCountPerStrand - 1);
+    const uint32_t strandCount = geom->pDrawArgs[geom->pLods[lod].mDrawArgOffset].mIndexCount / strandIndexCount;
+
+    for (uint32_t l = lod; l < geom->mLodCount; ++l)
+    {
+        geom->pDrawArgs[l - lod] = geom->pDrawArgs[geom->pLods[l].mDrawArgOffset];
+        geom->pLods[l - lod] = geom->pLods[l];
+        geom->pLods[l - lod].mDrawArgOffset = l - lod;
+    }
+    geom->mLodCount -= lod;
+    if (geom->mLodCount == 1)
+    {
+        geom->mLodCount = 0;
+        geom->pLods = NULL;
+    }
 
-    for (uint32_t i = 0; i < TF_ARRAY_COUNT(geomData->pShadow->mVertexStrides); ++i)
+    geom->mIndexCount = strandCount * strandIndexCount;
+    geom->mVertexCount = strandCount * pHair->mVertexCountPerStrand;
+    pHair->mGuideCountPerStrand = min(pHair->mGuideCountPerStrand, strandCount);
+}
+
+// Attribute counts of the shadow data limited to the strands kept by selectGeometryStrandLod, per strand attributes have one element
+// per strand
+static void limitGeometryShadowCounts(const Geometry* geom, const GeometryData* geomData, uint32_t fileVertexCount,
+                                      GeometryData::ShadowData* pShadow)
+{
+    if (geom->mVertexCount == fileVertexCount)
+        return;
+
+    const uint32_t vertexCountPerStrand = geomData->mHair.mVertexCountPerStrand;
+    for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
     {
-        if (geomData->pShadow->mVertexStrides[i] == 0)
-            geomData->pShadow->pAttributes[i] = nullptr;
+        const uint32_t count = pShadow->mAttributeCount[s];
+        pShadow->mAttributeCount[s] =
+            count == fileVertexCount / vertexCountPerStrand ? geom->mVertexCount / vertexCountPerStrand : min(count, geom->mVertexCount);
     }
+}
 
-    uint32_t vertexAttribCount[MAX_SEMANTICS] = {};
-    uint32_t vertexOffsets[MAX_SEMANTICS] = {}; // offset in the GPU layout
-    uint32_t vertexBindings[MAX_SEMANTICS] = {};
-    for (uint32_t i = 0; i < TF_ARRAY_COUNT(vertexOffsets); ++i)
-        vertexOffsets[i] = UINT_MAX;
+// Fills Geometry::mVertexStrides for the requested vertex layout and returns where each attribute of the shadow data goes in GPU memory
+static void getGeometryVertexCopyInfo(const VertexLayout* pVertexLayout, const GeometryBufferLayoutDesc* pGeometryBufferLayoutDesc,
+                                      const GeometryData* geomData, const GeometryData::ShadowData* pShadow, Geometry* geom,
+                                      GeometryVertexCopyInfo* pOut)
+{
+    *pOut = {};
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(pOut->mOffsets); ++i)
+        pOut->mOffsets[i] = UINT_MAX;
 
     uint32_t defaultTexcoordSemantic = SEMANTIC_UNDEFINED;
 
     // Determine vertex stride for each binding
-    for (uint32_t i = 0; i < pDesc->pVertexLayout->mAttribCount; ++i)
+    for (uint32_t i = 0; i < pVertexLayout->mAttribCount; ++i)
     {
-        const VertexAttrib* attr = &pDesc->pVertexLayout->mAttribs[i];
+        const VertexAttrib* attr = &pVertexLayout->mAttribs[i];
 
         const uint32_t dstFormatSize = TinyImageFormat_BitSizeOfBlock(attr->mFormat) / 8;
 
@@ -1846,1606 +2716,3955 @@ static UploadFunctionResult loadGeometryCustomMeshFormat(Renderer* pRenderer, Co
             }
         }
 
-        const uint32_t srcFormatSize = (uint32_t)geomData->pShadow->mVertexStrides[attr->mSemantic]; //-V522
+        const uint32_t srcFormatSize = (uint32_t)pShadow->mVertexStrides[attr->mSemantic]; //-V522
 
-        uint32_t binding =
-            pDesc->pGeometryBufferLayoutDesc ? pDesc->pGeometryBufferLayoutDesc->mSemanticBindings[attr->mSemantic] : attr->mBinding;
+        uint32_t binding = pGeometryBufferLayoutDesc ? pGeometryBufferLayoutDesc->mSemanticBindings[attr->mSemantic] : attr->mBinding;
 
         geom->mVertexStrides[binding] += dstFormatSize ? dstFormatSize : srcFormatSize;
-        vertexOffsets[attr->mSemantic] = attr->mOffset;
-        vertexBindings[attr->mSemantic] = binding;
-        ++vertexAttribCount[binding];
+        pOut->mOffsets[attr->mSemantic] = attr->mOffset;
+        pOut->mBindings[attr->mSemantic] = binding;
+        ++pOut->mAttribCount[binding];
+
+        const GeometryData::Hair* pHair = &geomData->mHair;
+        if (attr->mSemantic == SEMANTIC_POSITION && pHair->mQuantizedPositions && srcFormatSize == sizeof(uint16_t[4]) &&
+            dstFormatSize == sizeof(float[4]))
+        {
+            pOut->mDequantizePositions = true;
+            memcpy(pOut->mPositionMin, pHair->mPositionMin, sizeof(pOut->mPositionMin));
+            memcpy(pOut->mPositionExtent, pHair->mPositionExtent, sizeof(pOut->mPositionExtent));
+            continue;
+        }
 
         // src and dst formats must match because the AssetPipeline converts to the destination formats already
         ASSERT(dstFormatSize == 0 || dstFormatSize == srcFormatSize);
     }
+}
 
-    uint32_t dstIndexStride = indexStride;
-
-    fillGeometryUpdateDesc(pRenderer, pCopyEngine, pDesc, geom, &dstIndexStride, vertexUpdateDesc, indexUpdateDesc);
-
+static void copyGeometryIndices(const Geometry* geom, const GeometryData::ShadowData* pShadow, uint32_t indexStride,
+                                uint32_t dstIndexStride, void* pDst, const char* pFileName)
+{
     if (indexStride == dstIndexStride)
-        memcpy(indexUpdateDesc->pMappedData, geomData->pShadow->pIndices, indexStride * geom->mIndexCount);
+        memcpy(pDst, pShadow->pIndices, indexStride * geom->mIndexCount);
     else
     {
         if (sizeof(uint16_t) == indexStride)
         {
-            uint32_t*       dst = (uint32_t*)indexUpdateDesc->pMappedData;
-            const uint16_t* src = (uint16_t*)geomData->pShadow->pIndices;
+            uint32_t*       dst = (uint32_t*)pDst;
+            const uint16_t* src = (uint16_t*)pShadow->pIndices;
             for (uint32_t idx = 0; idx < geom->mIndexCount; ++idx)
                 dst[idx] = src[idx];
         }
         else
         {
-            LOGF(eERROR, "Trying to copy uint32 indexes into uint16 buffers, data will be lost: '%s'", pDesc->pFileName);
+            LOGF(eERROR, "Trying to copy uint32 indexes into uint16 buffers, data will be lost: '%s'", pFileName);
             ASSERT(false);
         }
     }
+}
 
+// Copies the shadow attributes into the vertex buffers, only attributes going to the given binding are copied unless binding is UINT_MAX
+static void copyGeometryVertices(const Geometry* geom, const GeometryData::ShadowData* pShadow, const GeometryVertexCopyInfo* pInfo,
+                                 uint32_t binding, uint8_t* pDst[MAX_VERTEX_BINDINGS])
+{
     for (uint32_t i = 0; i < MAX_SEMANTICS; ++i)
     {
-        if (!geomData->pShadow->pAttributes[i])
+        if (!pShadow->pAttributes[i])
             continue;
         // Invalid vertexOffset means pVertexLayout doesn't use this attribute, no need to copy it
-        if (vertexOffsets[i] == UINT_MAX)
+        if (pInfo->mOffsets[i] == UINT_MAX)
+            continue;
+        if (binding != UINT_MAX && pInfo->mBindings[i] != binding)
             continue;
 
-        const uint32_t binding = vertexBindings[i];
-        const uint32_t offset = vertexOffsets[i];
-        const uint32_t stride = geom->mVertexStrides[binding];
+        const uint32_t attrBinding = pInfo->mBindings[i];
+        const uint32_t offset = pInfo->mOffsets[i];
+        const uint32_t stride = geom->mVertexStrides[attrBinding];
 
-        const uint8_t* src = (uint8_t*)geomData->pShadow->pAttributes[i];
-        uint8_t*       dst = (uint8_t*)vertexUpdateDesc[binding].pMappedData;
+        const uint8_t* src = (uint8_t*)pShadow->pAttributes[i];
+        uint8_t*       dst = pDst[attrBinding];
         ASSERT(src && dst);
 
+        if (SEMANTIC_POSITION == i && pInfo->mDequantizePositions)
+        {
+            for (uint32_t e = 0; e < pShadow->mAttributeCount[i]; ++e)
+            {
+                const uint16_t* pQuantized = (const uint16_t*)(src + e * pShadow->mVertexStrides[i]);
+                float*          pPosition = (float*)(dst + e * stride + offset);
+                for (uint32_t c = 0; c < 3; ++c)
+                    pPosition[c] = pInfo->mPositionMin[c] + pInfo->mPositionExtent[c] * (pQuantized[c] / 65535.0f);
+                pPosition[3] = pQuantized[3] / 65535.0f;
+            }
+            continue;
+        }
+
         // If this vertex attribute is not interleaved with any other attribute use fast path instead of copying one by one
         // In this case a simple memcpy will be enough to transfer the data to the buffer
-        if (1 == vertexAttribCount[binding])
+        if (1 == pInfo->mAttribCount[attrBinding])
         {
-            memcpy(dst, src, geomData->pShadow->mVertexStrides[i] * geomData->pShadow->mAttributeCount[i]);
+            memcpy(dst, src, pShadow->mVertexStrides[i] * pShadow->mAttributeCount[i]);
         }
         else
         {
             // Loop through all vertices copying into the correct place in the vertex buffer
             // Example:
             // [ POSITION | NORMAL | TEXCOORD ] => [ 0 | 12 | 24 ], [ 32 | 44 | 52 ], ... (vertex stride of 32 => 12 + 12 + 8)
-            for (uint32_t e = 0; e < geomData->pShadow->mAttributeCount[i]; ++e)
-                memcpy(dst + e * stride + offset, src + e * geomData->pShadow->mVertexStrides[i], geomData->pShadow->mVertexStrides[i]);
+            for (uint32_t e = 0; e < pShadow->mAttributeCount[i]; ++e)
+                memcpy(dst + e * stride + offset, src + e * pShadow->mVertexStrides[i], pShadow->mVertexStrides[i]);
         }
     }
+}
 
-    // If the user doesn't want the shadowed data we don't need it any more
-    if ((pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED) != GEOMETRY_LOAD_FLAG_SHADOWED)
-    {
-        tf_free(geomData->pShadow);
-        geomData->pShadow = nullptr;
-    }
+static void fillGeometryUpdateDesc(Renderer* pRenderer, CopyEngine* pCopyEngine, GeometryLoadDesc* pDesc, Geometry* geom,
+                                   uint32_t* indexStride, BufferUpdateDesc vertexUpdateDesc[MAX_VERTEX_BINDINGS],
+                                   BufferUpdateDesc indexUpdateDesc[1])
+{
+    UNREF_PARAM(pCopyEngine);
+    bool     structuredBuffers = (pDesc->mFlags & GEOMETRY_LOAD_FLAG_STRUCTURED_BUFFERS) > 0;
+    uint32_t indexBufferSize = *indexStride * geom->mIndexCount;
 
-    geom->pGeometryBuffer = pDesc->pGeometryBuffer;
-    if (pDesc->pGeometryBufferLayoutDesc)
+    if (pDesc->pGeometryBuffer)
     {
-        geom->mIndexType = pDesc->pGeometryBufferLayoutDesc->mIndexType;
-    }
+        if (pDesc->pGeometryBufferLayoutDesc)
+        {
+            *indexStride = pDesc->pGeometryBufferLayoutDesc->mIndexType == INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+            indexBufferSize = *indexStride * geom->mIndexCount;
+        }
 
-    *pDesc->ppGeometry = geom;
+        addGeometryBufferPart(&pDesc->pGeometryBuffer->mIndex, indexBufferSize, *indexStride, &geom->mIndexBufferChunk);
 
-    if (pDesc->ppGeometryData)
-        *pDesc->ppGeometryData = geomData;
+        indexUpdateDesc->pBuffer = pDesc->pGeometryBuffer->mIndex.pBuffer;
+        indexUpdateDesc->mDstOffset = geom->mIndexBufferChunk.mOffset;
+    }
     else
     {
-        tf_free(geomData->pShadow);
-        tf_free(geomData);
-    }
-
-    tf_free((void*)pDesc->pVertexLayout);
-
-    return UPLOAD_FUNCTION_RESULT_COMPLETED;
-}
-
-static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyEngine, UpdateRequest& pGeometryLoad)
-{
-    GeometryLoadDesc* pDesc = &pGeometryLoad.geomLoadDesc;
-
-    BufferUpdateDesc indexUpdateDesc = {};
-    BufferUpdateDesc vertexUpdateDesc[MAX_VERTEX_BINDINGS] = {};
-
-    UploadFunctionResult res = loadGeometryCustomMeshFormat(pRenderer, pCopyEngine, pDesc, vertexUpdateDesc, &indexUpdateDesc);
-    if (res != UPLOAD_FUNCTION_RESULT_COMPLETED)
-        return res;
+        BufferDesc loadDesc = {};
+        loadDesc.mDescriptors =
+            DESCRIPTOR_TYPE_INDEX_BUFFER | (structuredBuffers ? (DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER)
+                                                              : (DESCRIPTOR_TYPE_BUFFER_RAW | DESCRIPTOR_TYPE_RW_BUFFER_RAW));
+        loadDesc.mFlags |= (pDesc->mFlags & GEOMETRY_LOAD_FLAG_RAYTRACING_INPUT)
+                               ? (BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS | BUFFER_CREATION_FLAG_ACCELERATION_STRUCTURE_BUILD_INPUT)
+                               : BUFFER_CREATION_FLAG_NONE;
+        loadDesc.mSize = indexBufferSize;
+        loadDesc.mElementCount = (uint32_t)(loadDesc.mSize / (structuredBuffers ? *indexStride : sizeof(uint32_t)));
+        loadDesc.mStructStride = *indexStride;
+        loadDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        loadDesc.mStartState = gUma ? gIndexBufferState : RESOURCE_STATE_COPY_DEST;
+        addBuffer(pRenderer, &loadDesc, &geom->pIndexBuffer);
+        indexUpdateDesc->pBuffer = geom->pIndexBuffer;
+        indexUpdateDesc->mDstOffset = 0;
+    }
 
-    // Upload mesh
-    UploadFunctionResult uploadResult = UPLOAD_FUNCTION_RESULT_COMPLETED;
-    BufferBarrier        barriers[MAX_VERTEX_BINDINGS + 1] = {};
-    uint32_t             barrierCount = 0;
+    indexUpdateDesc->mSize = geom->mIndexCount * *indexStride;
 
-    if (!gUma || (indexUpdateDesc.pMappedData && !indexUpdateDesc.pBuffer->pCpuMappedAddress))
+    // Vertex buffers
+    uint32_t bufferCounter = 0;
+    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
     {
-        indexUpdateDesc.mCurrentState = gUma ? indexUpdateDesc.mCurrentState : RESOURCE_STATE_COPY_DEST;
-        indexUpdateDesc.mInternal.mMappedRange = allocateStagingMemory(pCopyEngine, indexUpdateDesc.mSize, 1, pDesc->mNodeIndex);
-        ASSERT(indexUpdateDesc.pMappedData);
-        memcpy(indexUpdateDesc.mInternal.mMappedRange.pData, indexUpdateDesc.pMappedData, indexUpdateDesc.mSize);
-        tf_free(indexUpdateDesc.pMappedData);
-        if (indexUpdateDesc.mInternal.mMappedRange.mFlags & MAPPED_RANGE_FLAG_TEMP_BUFFER)
+        if (!geom->mVertexStrides[i])
+            continue;
+
+        uint32_t size = geom->mVertexStrides[i] * geom->mVertexCount;
+
+        if (pDesc->pGeometryBuffer)
         {
-            setBufferName(pRenderer, indexUpdateDesc.mInternal.mMappedRange.pBuffer, pDesc->pFileName);
+            addGeometryBufferPart(&pDesc->pGeometryBuffer->mVertex[i], size, geom->mVertexStrides[i], &geom->mVertexBufferChunks[i]);
+            vertexUpdateDesc[i].pBuffer = pDesc->pGeometryBuffer->mVertex[i].pBuffer;
+            vertexUpdateDesc[i].mDstOffset = geom->mVertexBufferChunks[i].mOffset;
         }
-        indexUpdateDesc.pMappedData = indexUpdateDesc.mInternal.mMappedRange.pData;
-        uploadResult = updateBuffer(pRenderer, pCopyEngine, indexUpdateDesc);
+        else
+        {
+            BufferDesc vertexBufferDesc = {};
+            vertexBufferDesc.mDescriptors =
+                DESCRIPTOR_TYPE_VERTEX_BUFFER | (structuredBuffers ? (DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER)
+                                                                   : (DESCRIPTOR_TYPE_BUFFER_RAW | DESCRIPTOR_TYPE_RW_BUFFER_RAW));
+            vertexBufferDesc.mFlags |=
+                (pDesc->mFlags & GEOMETRY_LOAD_FLAG_RAYTRACING_INPUT)
+                    ? (BUFFER_CREATION_FLAG_SHADER_DEVICE_ADDRESS | BUFFER_CREATION_FLAG_ACCELERATION_STRUCTURE_BUILD_INPUT)
+                    : BUFFER_CREATION_FLAG_NONE;
+            vertexBufferDesc.mSize = size;
+            vertexBufferDesc.mElementCount =
+                (uint32_t)(vertexBufferDesc.mSize / (structuredBuffers ? geom->mVertexStrides[i] : sizeof(uint32_t)));
+            vertexBufferDesc.mStructStride = geom->mVertexStrides[i];
+            vertexBufferDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+            vertexBufferDesc.mStartState = gUma ? gVertexBufferState : RESOURCE_STATE_COPY_DEST;
+            vertexBufferDesc.pName = "VertexBuffer";
+            addBuffer(pRenderer, &vertexBufferDesc, &geom->pVertexBuffers[bufferCounter]);
+
+            vertexUpdateDesc[i].pBuffer = geom->pVertexBuffers[bufferCounter];
+            vertexUpdateDesc[i].mDstOffset = 0;
+        }
+
+        vertexUpdateDesc[i].mSize = size;
+        ++bufferCounter;
     }
 
-    barriers[barrierCount++] = { indexUpdateDesc.pBuffer, RESOURCE_STATE_COPY_DEST, gIndexBufferState };
+    geom->mVertexBufferCount = bufferCounter;
+}
 
-    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
+// Maps the destination of a geometry buffer update, the data is written directly in the buffer when it's CPU visible, otherwise in a
+// temporary allocation that loadGeometry copies to staging memory
+static void mapGeometryUpdateDesc(BufferUpdateDesc* pUpdateDesc)
+{
+    // We need to check for pCpuMappedAddress because when we allocate a custom ResourceHeap with GPU_ONLY memory we don't get any CPU
+    // mapped address and we need staging memory
+    if (gUma && pUpdateDesc->pBuffer->pCpuMappedAddress)
     {
-        if (vertexUpdateDesc[i].pBuffer)
+        pUpdateDesc->mInternal.mMappedRange = { (uint8_t*)pUpdateDesc->pBuffer->pCpuMappedAddress + pUpdateDesc->mDstOffset };
+    }
+    else
+    {
+        pUpdateDesc->mInternal.mMappedRange.pData = (uint8_t*)tf_calloc_memalign(1, 4, pUpdateDesc->mSize);
+    }
+    pUpdateDesc->pMappedData = pUpdateDesc->mInternal.mMappedRange.pData;
+}
+
+// Gets memory to write the data of a geometry buffer update, either directly in the buffer (UMA) or in staging memory.
+// Staging memory can be flushed by the next allocation so each update has to be filled and recorded before beginning the next one.
+static uint8_t* beginGeometryUpload(Renderer* pRenderer, CopyEngine* pCopyEngine, BufferUpdateDesc* pUpdateDesc, uint32_t nodeIndex,
+                                    const char* pName)
+{
+    // We need to check for pCpuMappedAddress because when we allocate a custom ResourceHeap with GPU_ONLY memory we don't get any CPU
+    // mapped address and we need staging memory
+    if (gUma && pUpdateDesc->pBuffer->pCpuMappedAddress)
+    {
+        pUpdateDesc->pMappedData = (uint8_t*)pUpdateDesc->pBuffer->pCpuMappedAddress + pUpdateDesc->mDstOffset;
+        return (uint8_t*)pUpdateDesc->pMappedData;
+    }
+
+    pUpdateDesc->mCurrentState = gUma ? pUpdateDesc->mCurrentState : RESOURCE_STATE_COPY_DEST;
+    pUpdateDesc->mInternal.mMappedRange = allocateStagingMemory(pCopyEngine, pUpdateDesc->mSize, 1, nodeIndex);
+    if (pUpdateDesc->mInternal.mMappedRange.mFlags & MAPPED_RANGE_FLAG_TEMP_BUFFER)
+    {
+        setBufferName(pRenderer, pUpdateDesc->mInternal.mMappedRange.pBuffer, pName);
+    }
+    pUpdateDesc->pMappedData = pUpdateDesc->mInternal.mMappedRange.pData;
+    return (uint8_t*)pUpdateDesc->pMappedData;
+}
+
+// Gets memory to write the data of the buffer updates of a geometry, either directly in the buffer (UMA) or in staging memory.
+// All updates share one staging allocation, the next allocation could flush the previous one otherwise. This way every update can be
+// written before the first copy is recorded and the load can still be cancelled if the data turns out to be invalid.
+static void beginGeometryUploads(Renderer* pRenderer, CopyEngine* pCopyEngine, uint32_t updateCount, BufferUpdateDesc** ppUpdateDescs,
+                                 uint32_t nodeIndex, const char* pName)
+{
+    const uint64_t alignment = pRenderer->pGpu->mSettings.mUploadBufferAlignment;
+    uint64_t       offsets[MAX_VERTEX_BINDINGS + 1] = {};
+    uint64_t       stagingSize = 0;
+    ASSERT(updateCount <= TF_ARRAY_COUNT(offsets));
+
+    for (uint32_t i = 0; i < updateCount; ++i)
+    {
+        BufferUpdateDesc* pUpdateDesc = ppUpdateDescs[i];
+        // We need to check for pCpuMappedAddress because when we allocate a custom ResourceHeap with GPU_ONLY memory we don't get any
+        // CPU mapped address and we need staging memory
+        if (gUma && pUpdateDesc->pBuffer->pCpuMappedAddress)
         {
-            if (!gUma || (vertexUpdateDesc[i].pMappedData && !vertexUpdateDesc[i].pBuffer->pCpuMappedAddress))
-            {
-                vertexUpdateDesc[i].mCurrentState = gUma ? vertexUpdateDesc[i].mCurrentState : RESOURCE_STATE_COPY_DEST;
-                vertexUpdateDesc[i].mInternal.mMappedRange =
-                    allocateStagingMemory(pCopyEngine, vertexUpdateDesc[i].mSize, 1, pDesc->mNodeIndex);
-                ASSERT(vertexUpdateDesc[i].pMappedData);
-                memcpy(vertexUpdateDesc[i].mInternal.mMappedRange.pData, vertexUpdateDesc[i].pMappedData, vertexUpdateDesc[i].mSize);
-                tf_free(vertexUpdateDesc[i].pMappedData);
-                if (vertexUpdateDesc[i].mInternal.mMappedRange.mFlags & MAPPED_RANGE_FLAG_TEMP_BUFFER)
-                {
-                    setBufferName(pRenderer, vertexUpdateDesc[i].mInternal.mMappedRange.pBuffer, pDesc->pFileName);
-                }
-                vertexUpdateDesc[i].pMappedData = vertexUpdateDesc[i].mInternal.mMappedRange.pData;
-                uploadResult = updateBuffer(pRenderer, pCopyEngine, vertexUpdateDesc[i]);
-            }
-            barriers[barrierCount++] = { vertexUpdateDesc[i].pBuffer, RESOURCE_STATE_COPY_DEST, gVertexBufferState };
+            pUpdateDesc->pMappedData = (uint8_t*)pUpdateDesc->pBuffer->pCpuMappedAddress + pUpdateDesc->mDstOffset;
+            continue;
         }
+
+        offsets[i] = round_up_64(stagingSize, alignment);
+        stagingSize = offsets[i] + pUpdateDesc->mSize;
     }
 
-    if (!gUma && IssueBufferCopyBarriers())
+    if (!stagingSize)
+        return;
+
+    const MappedMemoryRange range = allocateStagingMemory(pCopyEngine, stagingSize, 1, nodeIndex);
+    if (range.mFlags & MAPPED_RANGE_FLAG_TEMP_BUFFER)
     {
-        Cmd* cmd = acquirePostCopyBarrierCmd(pCopyEngine);
-        cmdResourceBarrier(cmd, barrierCount, barriers, 0, NULL, 0, NULL);
+        setBufferName(pRenderer, range.pBuffer, pName);
     }
 
-    return uploadResult;
+    for (uint32_t i = 0; i < updateCount; ++i)
+    {
+        BufferUpdateDesc* pUpdateDesc = ppUpdateDescs[i];
+        if (gUma && pUpdateDesc->pBuffer->pCpuMappedAddress)
+            continue;
+
+        pUpdateDesc->mCurrentState = gUma ? pUpdateDesc->mCurrentState : RESOURCE_STATE_COPY_DEST;
+        pUpdateDesc->mInternal.mMappedRange = { range.pData + offsets[i], range.pBuffer, range.mOffset + offsets[i], pUpdateDesc->mSize,
+                                                range.mFlags };
+        pUpdateDesc->pMappedData = pUpdateDesc->mInternal.mMappedRange.pData;
+    }
 }
 
-static UploadFunctionResult copyTexture(Renderer* pRenderer, CopyEngine* pCopyEngine, TextureCopyDesc& pTextureCopy)
+static UploadFunctionResult endGeometryUpload(Renderer* pRenderer, CopyEngine* pCopyEngine, const BufferUpdateDesc* pUpdateDesc)
 {
-    UNREF_PARAM(pRenderer);
-    Texture*              texture = pTextureCopy.pTexture;
-    const TinyImageFormat fmt = (TinyImageFormat)texture->mFormat;
+    // Data written directly to the buffer, nothing to copy
+    if (!pUpdateDesc->mInternal.mMappedRange.pBuffer)
+        return UPLOAD_FUNCTION_RESULT_COMPLETED;
 
-    Cmd* cmd = acquireCmd(pCopyEngine);
+    return updateBuffer(pRenderer, pCopyEngine, *pUpdateDesc);
+}
 
-    if (pTextureCopy.pWaitSemaphore)
-        arrpush(pCopyEngine->mWaitSemaphores, pTextureCopy.pWaitSemaphore);
+static UploadFunctionResult loadGeometryCustomMeshFormat(Renderer* pRenderer, CopyEngine* pCopyEngine, GeometryLoadDesc* pDesc,
+                                                         FileStream* pFile, BufferUpdateDesc vertexUpdateDesc[MAX_VERTEX_BINDINGS],
+                                                         BufferUpdateDesc indexUpdateDesc[1])
+{
+    FileStream& file = *pFile;
 
-    TextureBarrier barrier = { texture, pTextureCopy.mTextureState, RESOURCE_STATE_COPY_SOURCE };
-    barrier.mAcquire = 1;
-    barrier.mQueueType = pTextureCopy.mQueueType;
-    cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+    char magic[TF_ARRAY_COUNT(GEOMETRY_FILE_MAGIC_STR)] = { 0 };
+    COMPILE_ASSERT(sizeof(magic) == sizeof(GEOMETRY_FILE_MAGIC_STR));
+    loaderReadFromStream(pCopyEngine, &file, magic, sizeof(magic));
 
-    uint32_t numBytes = 0;
-    uint32_t rowBytes = 0;
-    uint32_t numRows = 0;
+    if (strncmp(magic, GEOMETRY_FILE_MAGIC_STR, TF_ARRAY_COUNT(magic)) != 0)
+    {
+        LOGF(eERROR, "File '%s' is not a Geometry file.", pDesc->pFileName);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
 
-    bool ret = util_get_surface_info(texture->mWidth, texture->mHeight, fmt, &numBytes, &rowBytes, &numRows);
-    if (!ret)
+    uint32_t geomSize = 0;
+    loaderReadFromStream(pCopyEngine, &file, &geomSize, sizeof(uint32_t));
+    if (!VERIFYMSG(geomSize >= 352, "File '%s': Geometry object must have a size >= 352.", pDesc->pFileName))
     {
         return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
 
-    SubresourceDataDesc subresourceDesc = {};
-    subresourceDesc.mArrayLayer = pTextureCopy.mTextureArrayLayer;
-    subresourceDesc.mMipLevel = pTextureCopy.mTextureMipLevel;
-    subresourceDesc.mSrcOffset = pTextureCopy.mBufferOffset;
-#if defined(DIRECT3D11) || defined(METAL) || defined(VULKAN) || defined(WEBGPU)
-    const uint32_t sliceAlignment = util_get_texture_subresource_alignment(pRenderer, fmt);
-    const uint32_t rowAlignment = util_get_texture_row_alignment(pRenderer);
-    uint32_t       subRowPitch = round_up(rowBytes, rowAlignment);
-    uint32_t       subSlicePitch = round_up(subRowPitch * numRows, sliceAlignment);
-    subresourceDesc.mRowPitch = subRowPitch;
-    subresourceDesc.mSlicePitch = subSlicePitch;
-#endif
-    cmdCopySubresource(cmd, pTextureCopy.pBuffer, pTextureCopy.pTexture, &subresourceDesc);
+    Geometry* geom = (Geometry*)tf_calloc(1, geomSize);
 
-    barrier = { texture, RESOURCE_STATE_COPY_SOURCE, pTextureCopy.mTextureState };
-    barrier.mRelease = 1;
-    barrier.mQueueType = pTextureCopy.mQueueType;
-    cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+    if (!VERIFYMSG(geom, "File '%s': Geometry object is a nullptr.", pDesc->pFileName))
+    {
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
 
-    return UPLOAD_FUNCTION_RESULT_COMPLETED;
-}
-/************************************************************************/
-// Internal Resource Loader Implementation
-/************************************************************************/
-static bool areTasksAvailable(ResourceLoader* pLoader)
-{
-    for (size_t i = 0; i < MAX_MULTIPLE_GPUS; ++i)
+    loaderReadFromStream(pCopyEngine, &file, geom, geomSize);
+
+    uint32_t geomDataSize = 0;
+    loaderReadFromStream(pCopyEngine, &file, &geomDataSize, sizeof(uint32_t));
+    if (!VERIFYMSG(geomDataSize > 0, "File '%s': Geometry object must have a size greater than 0.", pDesc->pFileName))
     {
-        if (arrlen(pLoader->mRequestQueue[i]))
-        {
-            return true;
-        }
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
 
-    return false;
-}
+    GeometryData* geomData = (GeometryData*)tf_calloc(1, geomDataSize);
+    if (!VERIFYMSG(geomData, "File '%s': Geometry object is a nullptr.", pDesc->pFileName))
+    {
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
 
-static void streamerThreadFunc(void* pThreadData)
-{
-    ResourceLoader* pLoader = (ResourceLoader*)pThreadData;
-    ASSERT(pLoader);
+    loaderReadFromStream(pCopyEngine, &file, geomData, geomDataSize);
+    geomData->pShadowSource = NULL;
 
-#if defined(GLES)
-    GLContext localContext;
-    if (gPlatformParameters.mSelectedRendererApi == RENDERER_API_GLES)
+    uint32_t shadowSize = 0;
+    loaderReadFromStream(pCopyEngine, &file, &shadowSize, sizeof(uint32_t));
+    const ssize_t shadowOffset = fsGetStreamSeekPosition(&file);
+    ASSERT(shadowSize > 0);
+    if (shadowSize < sizeof(*geomData->pShadow))
     {
-        if (!pLoader->mDesc.mSingleThreaded)
-            initGLContext(pLoader->ppRenderers[0]->mGLES.pConfig, &localContext, pLoader->ppRenderers[0]->mGLES.pContext);
+        LOGF(eERROR, "File '%s': Geometry object has shadow with size less than %x, got %x", pDesc->pFileName,
+             (int)sizeof(*geomData->pShadow), (int)shadowSize);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
-#endif
 
-    while (pLoader->mRun)
+    geomData->pShadow = (GeometryData::ShadowData*)tf_malloc(shadowSize);
+    if (!geomData->pShadow)
     {
-        acquireMutex(&pLoader->mQueueMutex);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
 
-        // Check for pending tokens
-        // Safe to use mTokenCounter as we are inside critical section
-        bool allTokensSignaled = (pLoader->mTokenCompleted == tfrg_atomic64_load_relaxed(&pLoader->mTokenCounter));
+    if (!VERIFYMSG(loaderReadFromStream(pCopyEngine, &file, geomData->pShadow, shadowSize) == shadowSize,
+                   "File '%s': Failed to read Geometry object's shadow.", pDesc->pFileName))
+    {
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
 
-        while (!areTasksAvailable(pLoader) && allTokensSignaled && pLoader->mRun)
-        {
-            // No waiting if not running dedicated resource loader thread.
-            if (pLoader->mDesc.mSingleThreaded)
-            {
-                releaseMutex(&pLoader->mQueueMutex);
-                return;
-            }
-            // Sleep until someone adds an update request to the queue
-            waitConditionVariable(&pLoader->mQueueCond, &pLoader->mQueueMutex, TIMEOUT_INFINITE);
-        }
+    if (geom->meshlets.mMeshletCount)
+    {
+        uint64_t alloc_size = getGeometryMeshletsSize(geom);
 
-        releaseMutex(&pLoader->mQueueMutex);
+        void* mem = tf_malloc(alloc_size);
 
-        for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
+        setupGeometryMeshletPointers(geom, mem);
+
+        size_t read = loaderReadFromStream(pCopyEngine, &file, mem, alloc_size);
+        if (alloc_size != read)
         {
-            CopyEngine* copyEngine = &pLoader->pCopyEngines[nodeIndex];
-            waitCopyEngineSet(pLoader->ppRenderers[nodeIndex], copyEngine);
-            resetCopyEngineSet(pLoader->ppRenderers[nodeIndex], copyEngine);
-            copyEngine->activeSet = (copyEngine->activeSet + 1) % pLoader->mDesc.mBufferCount;
+            return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
         }
+    }
 
-        // Signal pending tokens from previous frames
-        acquireMutex(&pLoader->mTokenMutex);
-        tfrg_atomic64_store_release(&pLoader->mTokenCompleted, pLoader->mCurrentTokenState[pLoader->pCopyEngines[0].activeSet]);
-        releaseMutex(&pLoader->mTokenMutex);
-        wakeAllConditionVariable(&pLoader->mTokenCond);
+    setupGeometryPointers(geom, geomData);
 
-        uint64_t completionMask = 0;
-
-        for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
-        {
-            acquireMutex(&pLoader->mQueueMutex);
+    // Determine index stride
+    const uint32_t indexStride = geom->mVertexCount > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t);
 
-            UpdateRequest** pRequestQueue = &pLoader->mRequestQueue[nodeIndex];
-            CopyEngine*     pCopyEngine = &pLoader->pCopyEngines[nodeIndex];
+    const uint32_t fileIndexCount = geom->mIndexCount;
+    const uint32_t fileVertexCount = geom->mVertexCount;
+    selectGeometryStrandLod(pDesc, geom, geomData);
+    GeometryData::ShadowData uploadShadow = *geomData->pShadow;
+    limitGeometryShadowCounts(geom, geomData, fileVertexCount, &uploadShadow);
 
-            if (!arrlen(*pRequestQueue))
-            {
-                releaseMutex(&pLoader->mQueueMutex);
-                continue;
-            }
+    GeometryVertexCopyInfo copyInfo = {};
+    getGeometryVertexCopyInfo(pDesc->pVertexLayout, pDesc->pGeometryBufferLayoutDesc, geomData, geomData->pShadow, geom, &copyInfo);
 
-            UpdateRequest* activeQueue = *pRequestQueue;
-            *pRequestQueue = NULL;
-            releaseMutex(&pLoader->mQueueMutex);
+    uint32_t dstIndexStride = indexStride;
 
-            Renderer* pRenderer = pLoader->ppRenderers[nodeIndex];
-            SyncToken maxNodeToken = {};
+    fillGeometryUpdateDesc(pRenderer, pCopyEngine, pDesc, geom, &dstIndexStride, vertexUpdateDesc, indexUpdateDesc);
 
-            ASSERT(arrlen(activeQueue));
+    mapGeometryUpdateDesc(indexUpdateDesc);
+    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
+    {
+        if (vertexUpdateDesc[i].pBuffer)
+            mapGeometryUpdateDesc(&vertexUpdateDesc[i]);
+    }
 
-            for (ptrdiff_t j = 0; j < arrlen(activeQueue); ++j)
-            {
-                UpdateRequest updateState = activeQueue[j];
-                // #NOTE: acquireCmd also resets copy engine on first use
-                Cmd*          cmd = acquireCmd(pCopyEngine);
+    copyGeometryIndices(geom, &uploadShadow, indexStride, dstIndexStride, indexUpdateDesc->pMappedData, pDesc->pFileName);
 
-                UploadFunctionResult result = UPLOAD_FUNCTION_RESULT_COMPLETED;
-                switch (updateState.mType)
-                {
-                case UPDATE_REQUEST_TEXTURE_BARRIER:
-                    cmdResourceBarrier(cmd, 0, NULL, 1, &updateState.textureBarrier, 0, NULL);
-                    result = UPLOAD_FUNCTION_RESULT_COMPLETED;
-                    break;
-                case UPDATE_REQUEST_LOAD_BUFFER:
-                    result = loadBuffer(pRenderer, pCopyEngine, updateState);
-                    break;
-                case UPDATE_REQUEST_LOAD_TEXTURE:
-                    result = loadTexture(pRenderer, pCopyEngine, updateState);
-                    break;
-                case UPDATE_REQUEST_LOAD_GEOMETRY:
-                    result = loadGeometry(pRenderer, pCopyEngine, updateState);
-                    break;
-                case UPDATE_REQUEST_COPY_TEXTURE:
-                    result = copyTexture(pRenderer, pCopyEngine, updateState.texCopyDesc);
-                    break;
-                case UPDATE_REQUEST_INVALID:
-                    break;
-                }
+    uint8_t* vertexDst[MAX_VERTEX_BINDINGS] = {};
+    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
+        vertexDst[i] = (uint8_t*)vertexUpdateDesc[i].pMappedData;
+    copyGeometryVertices(geom, &uploadShadow, &copyInfo, UINT_MAX, vertexDst);
 
-                bool completed = result == UPLOAD_FUNCTION_RESULT_COMPLETED || result == UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    // If the user doesn't want the shadowed data we don't need it any more
+    if ((pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED) != GEOMETRY_LOAD_FLAG_SHADOWED)
+    {
+        tf_free(geomData->pShadow);
+        geomData->pShadow = nullptr;
+    }
 
-                completionMask |= (uint64_t)completed << nodeIndex;
+    if ((pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED) && pDesc->ppGeometryData && shadowOffset >= 0)
+    {
+        addGeometryShadowSource(geomData, fileIndexCount, fileVertexCount, pDesc->pFileName, (uint64_t)shadowOffset, shadowSize);
+    }
 
-                if (updateState.mWaitIndex && completed)
-                {
-                    ASSERT(maxNodeToken < updateState.mWaitIndex);
-                    maxNodeToken = updateState.mWaitIndex;
-                }
+    geom->pGeometryBuffer = pDesc->pGeometryBuffer;
+    if (pDesc->pGeometryBufferLayoutDesc)
+    {
+        geom->mIndexType = pDesc->pGeometryBufferLayoutDesc->mIndexType;
+    }
 
-                ASSERT(result != UPLOAD_FUNCTION_RESULT_STAGING_BUFFER_FULL);
-            }
+    *pDesc->ppGeometry = geom;
 
-            arrfree(activeQueue);
-            pLoader->mMaxToken = max(pLoader->mMaxToken, maxNodeToken);
-        }
+    if (pDesc->ppGeometryData)
+        *pDesc->ppGeometryData = geomData;
+    else
+    {
+        tf_free(geomData->pShadow);
+        tf_free(geomData);
+    }
 
-        if (completionMask != 0)
-        {
-            for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
-            {
-                if (completionMask & ((uint64_t)1 << nodeIndex))
-                {
-                    CopyEngine* copyEngine = &pLoader->pCopyEngines[nodeIndex];
-                    streamerFlush(copyEngine);
-                    acquireMutex(&pLoader->mSemaphoreMutex);
-                    copyEngine->pLastSubmittedSemaphore = copyEngine->resourceSets[copyEngine->activeSet].pSemaphore;
-                    releaseMutex(&pLoader->mSemaphoreMutex);
-                }
-            }
-        }
+    tf_free((void*)pDesc->pVertexLayout);
 
-        SyncToken nextToken = max(pLoader->mMaxToken, getLastTokenCompleted());
-        pLoader->mCurrentTokenState[pLoader->pCopyEngines[0].activeSet] = nextToken;
+    return UPLOAD_FUNCTION_RESULT_COMPLETED;
+}
 
-        // Signal submitted tokens
-        acquireMutex(&pLoader->mTokenMutex);
-        tfrg_atomic64_store_release(&pLoader->mTokenSubmitted, pLoader->mCurrentTokenState[pLoader->pCopyEngines[0].activeSet]);
-        releaseMutex(&pLoader->mTokenMutex);
-        wakeAllConditionVariable(&pLoader->mTokenCond);
+static bool isGeometryPackedSectionValid(const GeometryPackedSection* pSection, uint64_t fileSize, uint64_t minSize)
+{
+    return pSection->mOffset % GEOMETRY_PACKED_FILE_ALIGNMENT == 0 && pSection->mSize >= minSize && pSection->mOffset <= fileSize &&
+           pSection->mSize <= fileSize - pSection->mOffset;
+}
 
-        if (pResourceLoader->mDesc.mSingleThreaded)
-        {
-            return;
-        }
+static bool isGeometryPackedEncodingValid(const GeometryPackedFileHeader* pHeader)
+{
+    bool valid = pHeader->mIndexEncoding <= GEOMETRY_PACKED_ENCODING_MESHOPT;
+    for (uint32_t i = 0; valid && i < MAX_VERTEX_BINDINGS; ++i)
+    {
+        valid = pHeader->mVertexEncodings[i] <= GEOMETRY_PACKED_ENCODING_MESHOPT &&
+                pHeader->mVertexFilters[i] <= GEOMETRY_PACKED_FILTER_EXP;
     }
+    return valid;
+}
 
-    for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
-    {
-        streamerFlush(&pLoader->pCopyEngines[nodeIndex]);
-#if defined(DIRECT3D11)
-        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_D3D11;
-#elif defined(GLES)
-        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_GLES;
-#else
-        const bool wait = true;
-#endif
-        if (wait)
-        {
-            waitQueueIdle(pLoader->pCopyEngines[nodeIndex].pQueue);
-        }
+// Encoded sections are smaller than the decoded data, their decoded size is validated by the decoder instead
+static bool isGeometryPackedSectionSizeValid(const GeometryPackedSection* pSection, uint32_t encoding, uint64_t decodedSize)
+{
+    return encoding != GEOMETRY_PACKED_ENCODING_NONE || pSection->mSize == decodedSize;
+}
 
-        cleanupCopyEngine(pLoader->ppRenderers[nodeIndex], &pLoader->pCopyEngines[nodeIndex]);
+// Index and vertex sections can be copied as-is only if they were written with the same layout the user requested
+// (sizes are checked against the counts of the file, see selectGeometryStrandLod)
+static bool isGeometryPackedLayoutCompatible(const GeometryPackedFileHeader* pHeader, const Geometry* geom,
+                                             const GeometryVertexCopyInfo* pCopyInfo, uint32_t dstIndexStride, uint32_t indexCount,
+                                             uint32_t vertexCount)
+{
+    if (pHeader->mIndexStride != dstIndexStride ||
+        !isGeometryPackedSectionSizeValid(&pHeader->mIndices, pHeader->mIndexEncoding, (uint64_t)dstIndexStride * indexCount))
+        return false;
+
+    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
+    {
+        if (geom->mVertexStrides[i] &&
+            (geom->mVertexStrides[i] != pHeader->mVertexStrides[i] ||
+             !isGeometryPackedSectionSizeValid(&pHeader->mVertices[i], pHeader->mVertexEncodings[i],
+                                               (uint64_t)geom->mVertexStrides[i] * vertexCount)))
+            return false;
     }
 
-#if defined(GLES)
-    if (gPlatformParameters.mSelectedRendererApi == RENDERER_API_GLES)
+    for (uint32_t i = 0; i < MAX_SEMANTICS; ++i)
     {
-        if (!pResourceLoader->mDesc.mSingleThreaded)
-            removeGLContext(&localContext);
+        if (pCopyInfo->mOffsets[i] == UINT_MAX)
+            continue;
+        if (pHeader->mSemanticBindings[i] != pCopyInfo->mBindings[i] || pHeader->mSemanticOffsets[i] != pCopyInfo->mOffsets[i])
+            return false;
     }
-#endif
+
+    return true;
 }
 
-static void CopyEngineFlush(CopyEngine* pCopyEngine)
+// Copies or decodes an index or vertex section of a packed geometry file into pDst. The section holds count elements of stride bytes,
+// only the first size bytes are copied (less than the whole section for a strand level of detail).
+static bool copyGeometryPackedSection(const uint8_t* pBase, const GeometryPackedSection* pSection, uint32_t encoding, uint32_t filter,
+                                      bool indices, uint32_t count, uint32_t stride, uint8_t* pDst, uint64_t size)
 {
-    streamerFlush(pCopyEngine);
-    acquireMutex(&pResourceLoader->mSemaphoreMutex);
-    pCopyEngine->pLastSubmittedSemaphore = pCopyEngine->resourceSets[pCopyEngine->activeSet].pSemaphore;
-    releaseMutex(&pResourceLoader->mSemaphoreMutex);
+    const uint8_t* pSrc = pBase + pSection->mOffset;
+    if (GEOMETRY_PACKED_ENCODING_NONE == encoding)
+    {
+        memcpy(pDst, pSrc, (size_t)size);
+        return true;
+    }
 
-    SyncToken nextToken = max(pResourceLoader->mMaxToken, getLastTokenCompleted());
-    pResourceLoader->mCurrentTokenState[pResourceLoader->pCopyEngines[0].activeSet] = nextToken;
+    ASSERT(size <= (uint64_t)count * stride);
+    const bool prefix = size < (uint64_t)count * stride;
+    if (indices && !prefix)
+        return 0 == meshopt_decodeIndexBuffer(pDst, count, stride, pSrc, (size_t)pSection->mSize);
 
-    // Signal submitted tokens
-    acquireMutex(&pResourceLoader->mTokenMutex);
-    tfrg_atomic64_store_release(&pResourceLoader->mTokenSubmitted,
-                                pResourceLoader->mCurrentTokenState[pResourceLoader->pCopyEngines[0].activeSet]);
-    releaseMutex(&pResourceLoader->mTokenMutex);
-    wakeAllConditionVariable(&pResourceLoader->mTokenCond);
+    if (GEOMETRY_PACKED_FILTER_NONE == filter && !prefix)
+        return 0 == meshopt_decodeVertexBuffer(pDst, count, stride, pSrc, (size_t)pSection->mSize);
 
-    pCopyEngine->activeSet = (pCopyEngine->activeSet + 1) % pResourceLoader->mDesc.mBufferCount;
-    acquireCmd(pCopyEngine);
+    // Filters run in place and the decoders write the whole section, decode into regular memory first instead of staging memory
+    uint8_t*   pDecoded = (uint8_t*)tf_malloc((size_t)count * stride);
+    const bool success = 0 == (indices ? meshopt_decodeIndexBuffer(pDecoded, count, stride, pSrc, (size_t)pSection->mSize)
+                                       : meshopt_decodeVertexBuffer(pDecoded, count, stride, pSrc, (size_t)pSection->mSize));
+    if (success)
+    {
+        if (GEOMETRY_PACKED_FILTER_EXP == filter)
+            meshopt_decodeFilterExp(pDecoded, (size_t)(size / stride), stride);
+        memcpy(pDst, pDecoded, (size_t)size);
+    }
+    tf_free(pDecoded);
+    return success;
 }
 
-static void initResourceLoader(Renderer** ppRenderers, uint32_t rendererCount, ResourceLoaderDesc* pDesc, ResourceLoader** ppLoader)
+static UploadFunctionResult loadGeometryPackedFormat(Renderer* pRenderer, CopyEngine* pCopyEngine, GeometryLoadDesc* pDesc,
+                                                     FileStream* pFile, BufferUpdateDesc vertexUpdateDesc[MAX_VERTEX_BINDINGS],
+                                                     BufferUpdateDesc indexUpdateDesc[1])
 {
-    ASSERT(rendererCount > 0);
-    ASSERT(rendererCount <= MAX_MULTIPLE_GPUS);
+    size_t      fileSize = 0;
+    const void* pFileData = NULL;
+    void*       pFileCopy = NULL;
+    if (!fsStreamMemoryMap(pFile, &fileSize, &pFileData))
+    {
+        // IO doesn't support memory mapping (archives, ...), read the whole file with a single call instead
+        const ssize_t streamSize = fsGetStreamFileSize(pFile);
+        fileSize = streamSize > 0 ? (size_t)streamSize : 0;
+        pFileCopy = tf_memalign(GEOMETRY_PACKED_FILE_ALIGNMENT, max(fileSize, (size_t)1));
+        if (loaderReadFromStream(pCopyEngine, pFile, pFileCopy, fileSize) != fileSize)
+        {
+            LOGF(eERROR, "File '%s': Failed to read packed Geometry file.", pDesc->pFileName);
+            tf_free(pFileCopy);
+            return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+        }
+        pFileData = pFileCopy;
+    }
 
-    if (!pDesc)
-        pDesc = &gDefaultResourceLoaderDesc;
+    const uint8_t*                  pBase = (const uint8_t*)pFileData;
+    const GeometryPackedFileHeader* pHeader = (const GeometryPackedFileHeader*)pFileData;
 
-    ResourceLoader* pLoader = tf_new(ResourceLoader);
+    bool valid = fileSize >= sizeof(GeometryPackedFileHeader) && pHeader->mVersion == GEOMETRY_PACKED_FILE_VERSION &&
+                 pHeader->mHeaderSize == sizeof(GeometryPackedFileHeader) &&
+                 isGeometryPackedSectionValid(&pHeader->mGeometry, fileSize, sizeof(Geometry)) &&
+                 isGeometryPackedSectionValid(&pHeader->mGeometryData, fileSize, sizeof(GeometryData)) &&
+                 isGeometryPackedSectionValid(&pHeader->mShadow, fileSize, sizeof(GeometryData::ShadowData)) &&
+                 isGeometryPackedSectionValid(&pHeader->mMeshlets, fileSize, 0) &&
+                 isGeometryPackedSectionValid(&pHeader->mIndices, fileSize, 0) && isGeometryPackedEncodingValid(pHeader);
+    for (uint32_t i = 0; valid && i < MAX_VERTEX_BINDINGS; ++i)
+        valid = isGeometryPackedSectionValid(&pHeader->mVertices[i], fileSize, 0);
 
-    uint32_t gpuCount = rendererCount;
-    if (ppRenderers[0]->mGpuMode != GPU_MODE_UNLINKED)
+    if (!valid)
     {
-        ASSERT(rendererCount == 1);
-        gpuCount = ppRenderers[0]->mLinkedNodeCount;
+        LOGF(eERROR, "File '%s' is not a valid packed Geometry file (expected version %u).", pDesc->pFileName,
+             GEOMETRY_PACKED_FILE_VERSION);
+        tf_free(pFileCopy);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
 
-    pLoader->mGpuCount = gpuCount;
+    // Only the metadata is copied out of the file, index and vertex data goes straight to the GPU buffers
+    Geometry*     geom = (Geometry*)tf_calloc(1, pHeader->mGeometry.mSize);
+    GeometryData* geomData = (GeometryData*)tf_calloc(1, pHeader->mGeometryData.mSize);
+    memcpy(geom, pBase + pHeader->mGeometry.mOffset, pHeader->mGeometry.mSize);
+    memcpy(geomData, pBase + pHeader->mGeometryData.mOffset, pHeader->mGeometryData.mSize);
+    geomData->pShadowSource = NULL;
 
-    for (uint32_t i = 0; i < gpuCount; ++i)
+    if (geom->meshlets.mMeshletCount)
     {
-        ASSERT(rendererCount == 1 || ppRenderers[i]->mGpuMode == GPU_MODE_UNLINKED);
-        // Replicate single renderer in linked mode, for uniform handling of linked and unlinked multi gpu.
-        pLoader->ppRenderers[i] = (rendererCount > 1) ? ppRenderers[i] : ppRenderers[0];
+        uint64_t alloc_size = getGeometryMeshletsSize(geom);
+        if (!VERIFYMSG(alloc_size <= pHeader->mMeshlets.mSize, "File '%s': Meshlet section is too small.", pDesc->pFileName))
+        {
+            tf_free(geomData);
+            tf_free(geom);
+            tf_free(pFileCopy);
+            return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+        }
+
+        void* mem = tf_malloc(alloc_size);
+        memcpy(mem, pBase + pHeader->mMeshlets.mOffset, alloc_size);
+
+        setupGeometryMeshletPointers(geom, mem);
     }
 
-    pLoader->mRun = true; //-V601
-    pLoader->mDesc = *pDesc;
+    // Shadow data is only copied out of the file when the user wants to keep it or the buffers have to be repacked from it
+    geomData->pShadow = NULL;
+    setupGeometryPointers(geom, geomData);
 
-    initMutex(&pLoader->mQueueMutex);
-    initMutex(&pLoader->mTokenMutex);
-    initConditionVariable(&pLoader->mQueueCond);
-    initConditionVariable(&pLoader->mTokenCond);
-    initMutex(&pLoader->mSemaphoreMutex);
-    initMutex(&pLoader->mUploadEngineMutex);
+    const uint32_t indexStride = geom->mVertexCount > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t);
+    const uint32_t fileIndexCount = geom->mIndexCount;
+    const uint32_t fileVertexCount = geom->mVertexCount;
+    selectGeometryStrandLod(pDesc, geom, geomData);
 
-    pLoader->mTokenCounter = 0;
-    pLoader->mTokenCompleted = 0;
-    pLoader->mTokenSubmitted = 0;
+    // Vertex strides of the shadow data are enough to know where each attribute goes
+    GeometryData::ShadowData shadowHeader = {};
+    memcpy(&shadowHeader, pBase + pHeader->mShadow.mOffset, sizeof(shadowHeader));
 
-    for (uint32_t i = 0; i < gpuCount; ++i)
+    GeometryVertexCopyInfo copyInfo = {};
+    getGeometryVertexCopyInfo(pDesc->pVertexLayout, pDesc->pGeometryBufferLayoutDesc, geomData, &shadowHeader, geom, &copyInfo);
+
+    uint32_t dstIndexStride = indexStride;
+    fillGeometryUpdateDesc(pRenderer, pCopyEngine, pDesc, geom, &dstIndexStride, vertexUpdateDesc, indexUpdateDesc);
+
+    // Set before any failure return, removeResource needs it to tell GeometryBuffer chunks from owned buffers
+    geom->pGeometryBuffer = pDesc->pGeometryBuffer;
+    if (pDesc->pGeometryBufferLayoutDesc)
     {
-        CopyEngineDesc desc = {};
-        desc.mBufferCount = pLoader->mDesc.mBufferCount;
-        desc.mNodeIndex = i;
-        desc.mQueueType = QUEUE_TYPE_GRAPHICS;
-        desc.mSize = pLoader->mDesc.mBufferSize;
-        desc.pQueueName = "UPLOAD";
-        setupCopyEngine(pLoader->ppRenderers[i], &desc, &pLoader->pUploadEngines[i]);
+        geom->mIndexType = pDesc->pGeometryBufferLayoutDesc->mIndexType;
+    }
 
-        desc = {};
-        desc.mBufferCount = pLoader->mDesc.mBufferCount;
-        desc.mNodeIndex = i;
-        desc.mQueueType = QUEUE_TYPE_TRANSFER;
-        desc.mSize = pLoader->mDesc.mBufferSize;
-        desc.pQueueName = "COPY";
-        setupCopyEngine(pLoader->ppRenderers[i], &desc, &pLoader->pCopyEngines[i]);
+    const bool shadowed = (pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED) == GEOMETRY_LOAD_FLAG_SHADOWED;
+    const bool packed = isGeometryPackedLayoutCompatible(pHeader, geom, &copyInfo, dstIndexStride, fileIndexCount, fileVertexCount);
+    if (!packed)
+    {
+        LOGF(eWARNING, "File '%s': Vertex layout differs from the one used by the AssetPipeline, attributes will be repacked on load.",
+             pDesc->pFileName);
+    }
 
-        CopyEngine* copyEngine = &pLoader->pCopyEngines[i];
-        copyEngine->flushOnOverflow = true;
-        copyEngine->pFnFlush = CopyEngineFlush;
+    GeometryData::ShadowData uploadShadow = {};
+    if (shadowed || !packed)
+    {
+        geomData->pShadow = (GeometryData::ShadowData*)tf_malloc(pHeader->mShadow.mSize);
+        memcpy(geomData->pShadow, pBase + pHeader->mShadow.mOffset, pHeader->mShadow.mSize);
+        setupGeometryShadowPointers(geomData->pShadow, fileIndexCount, fileVertexCount);
+        uploadShadow = *geomData->pShadow;
+        limitGeometryShadowCounts(geom, geomData, fileVertexCount, &uploadShadow);
+    }
 
-#if defined(STRICT_QUEUE_TYPE_BARRIERS)
-        if (StrictQueueTypeBarriers())
+    BufferUpdateDesc* pUpdateDescs[MAX_VERTEX_BINDINGS + 1] = { indexUpdateDesc };
+    uint32_t          updateCount = 1;
+    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
+    {
+        if (vertexUpdateDesc[i].pBuffer)
+            pUpdateDescs[updateCount++] = &vertexUpdateDesc[i];
+    }
+
+    // Encoded sections are decoded here on the loader thread, straight into staging memory
+    beginGeometryUploads(pRenderer, pCopyEngine, updateCount, pUpdateDescs, pDesc->mNodeIndex, pDesc->pFileName);
+
+    bool decoded = true;
+    if (packed)
+        decoded = copyGeometryPackedSection(pBase, &pHeader->mIndices, pHeader->mIndexEncoding, GEOMETRY_PACKED_FILTER_NONE, true,
+                                            fileIndexCount, dstIndexStride, (uint8_t*)indexUpdateDesc->pMappedData,
+                                            indexUpdateDesc->mSize);
+    else
+        copyGeometryIndices(geom, &uploadShadow, indexStride, dstIndexStride, indexUpdateDesc->pMappedData, pDesc->pFileName);
+
+    for (uint32_t i = 0; decoded && i < MAX_VERTEX_BINDINGS; ++i)
+    {
+        if (!vertexUpdateDesc[i].pBuffer)
+            continue;
+
+        uint8_t* pDst = (uint8_t*)vertexUpdateDesc[i].pMappedData;
+        if (packed)
         {
-            for (uint32_t b = 0; b < pDesc->mBufferCount; ++b)
-            {
-                CopyResourceSet& resourceSet = pLoader->pCopyEngines[i].resourceSets[b];
-                CmdPoolDesc      poolDesc = {};
-                poolDesc.pQueue = pLoader->pUploadEngines[i].pQueue;
-                addCmdPool(pLoader->ppRenderers[i], &poolDesc, &resourceSet.pPostCopyBarrierCmdPool);
-                CmdDesc cmdDesc = {};
-                cmdDesc.pPool = resourceSet.pPostCopyBarrierCmdPool;
-#ifdef ENABLE_GRAPHICS_DEBUG
-                static char buffer[MAX_DEBUG_NAME_LENGTH];
-                snprintf(buffer, sizeof(buffer), "Node %u Strict Queue buffer %u Cmd", i, b);
-                cmdDesc.pName = buffer;
-#endif // ENABLE_GRAPHICS_DEBUG
-                addCmd(pLoader->ppRenderers[i], &cmdDesc, &resourceSet.pPostCopyBarrierCmd);
-                addFence(pLoader->ppRenderers[i], &resourceSet.pPostCopyBarrierFence);
-            }
+            decoded = copyGeometryPackedSection(pBase, &pHeader->mVertices[i], pHeader->mVertexEncodings[i], pHeader->mVertexFilters[i],
+                                                false, fileVertexCount, geom->mVertexStrides[i], pDst, vertexUpdateDesc[i].mSize);
+        }
+        else
+        {
+            uint8_t* vertexDst[MAX_VERTEX_BINDINGS] = {};
+            vertexDst[i] = pDst;
+            copyGeometryVertices(geom, &uploadShadow, &copyInfo, i, vertexDst);
         }
-#endif
     }
 
-    ThreadDesc threadDesc = {};
-    threadDesc.pFunc = streamerThreadFunc;
-    threadDesc.pData = pLoader;
-    strncpy(threadDesc.mThreadName, "ResourceLoaderTask", sizeof(threadDesc.mThreadName));
+    tf_free(pFileCopy);
 
-#if defined(NX64)
-    threadDesc.setAffinityMask = true;
-    threadDesc.affinityMask[0] = 1;
-#endif
+    // No copy was recorded yet, the buffers can be removed right away. The staging memory is reclaimed with the rest of the set.
+    if (!decoded)
+    {
+        LOGF(eERROR, "File '%s': Failed to decode compressed index or vertex data.", pDesc->pFileName);
+        removeResource(geomData);
+        removeResource(geom);
+        *pDesc->ppGeometry = NULL;
+        if (pDesc->ppGeometryData)
+            *pDesc->ppGeometryData = NULL;
+        tf_free((void*)pDesc->pVertexLayout);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
 
-#if defined(DIRECT3D11)
-    if (gPlatformParameters.mSelectedRendererApi == RENDERER_API_D3D11)
-        pLoader->mDesc.mSingleThreaded = true;
-#endif
+    UploadFunctionResult uploadResult = UPLOAD_FUNCTION_RESULT_COMPLETED;
+    for (uint32_t i = 0; i < updateCount; ++i)
+        uploadResult = endGeometryUpload(pRenderer, pCopyEngine, pUpdateDescs[i]);
 
-#if defined(ANDROID) && defined(USE_MULTIPLE_RENDER_APIS)
-    gUma = gPlatformParameters.mSelectedRendererApi == RENDERER_API_VULKAN;
-#endif
+    // If the user doesn't want the shadowed data we don't need it any more
+    if (!shadowed)
+    {
+        tf_free(geomData->pShadow);
+        geomData->pShadow = nullptr;
+    }
 
-    // Create dedicated resource loader thread.
-    if (!pLoader->mDesc.mSingleThreaded)
+    if ((pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED) && pDesc->ppGeometryData)
     {
-        initThread(&threadDesc, &pLoader->mThread);
+        addGeometryShadowSource(geomData, fileIndexCount, fileVertexCount, pDesc->pFileName, pHeader->mShadow.mOffset,
+                                pHeader->mShadow.mSize);
     }
 
-    *ppLoader = pLoader;
+    *pDesc->ppGeometry = geom;
+
+    if (pDesc->ppGeometryData)
+        *pDesc->ppGeometryData = geomData;
+    else
+        tf_free(geomData);
+
+    tf_free((void*)pDesc->pVertexLayout);
+
+    return uploadResult;
 }
 
-static void exitResourceLoader(ResourceLoader* pLoader)
+static UploadFunctionResult loadGeometry(Renderer* pRenderer, CopyEngine* pCopyEngine, UpdateRequest& pGeometryLoad)
 {
-    pLoader->mRun = false; //-V601
+    GeometryLoadDesc* pDesc = &pGeometryLoad.geomLoadDesc;
 
-    if (pLoader->mDesc.mSingleThreaded)
+    BufferUpdateDesc indexUpdateDesc = {};
+    BufferUpdateDesc vertexUpdateDesc[MAX_VERTEX_BINDINGS] = {};
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_MESHES, pDesc->pFileName, FM_READ, &file))
     {
-        streamerThreadFunc(pLoader);
+        LOGF(eERROR, "Failed to open bin file %s", pDesc->pFileName);
+        ASSERT(false);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
-    else
+
+    // Both formats start with a magic string of the same size
+    COMPILE_ASSERT(sizeof(GEOMETRY_PACKED_FILE_MAGIC_STR) == sizeof(GEOMETRY_FILE_MAGIC_STR));
+    char magic[TF_ARRAY_COUNT(GEOMETRY_PACKED_FILE_MAGIC_STR)] = { 0 };
+    fsReadFromStream(&file, magic, sizeof(magic));
+    fsSeekStream(&file, SBO_START_OF_FILE, 0);
+
+    const bool packed = strncmp(magic, GEOMETRY_PACKED_FILE_MAGIC_STR, TF_ARRAY_COUNT(magic)) == 0;
+
+    // Packed files are uploaded while the file is mapped, the custom mesh format is parsed into temporary memory first
+    UploadFunctionResult res =
+        packed ? loadGeometryPackedFormat(pRenderer, pCopyEngine, pDesc, &file, vertexUpdateDesc, &indexUpdateDesc)
+               : loadGeometryCustomMeshFormat(pRenderer, pCopyEngine, pDesc, &file, vertexUpdateDesc, &indexUpdateDesc);
+    fsCloseStream(&file);
+    if (res != UPLOAD_FUNCTION_RESULT_COMPLETED)
+        return res;
+
+    // Upload mesh
+    UploadFunctionResult uploadResult = UPLOAD_FUNCTION_RESULT_COMPLETED;
+    BufferBarrier        barriers[MAX_VERTEX_BINDINGS + 1] = {};
+    uint32_t             barrierCount = 0;
+
+    if (!packed && (!gUma || (indexUpdateDesc.pMappedData && !indexUpdateDesc.pBuffer->pCpuMappedAddress)))
     {
-        wakeOneConditionVariable(&pLoader->mQueueCond);
-        joinThread(pLoader->mThread);
+        indexUpdateDesc.mCurrentState = gUma ? indexUpdateDesc.mCurrentState : RESOURCE_STATE_COPY_DEST;
+        indexUpdateDesc.mInternal.mMappedRange = allocateStagingMemory(pCopyEngine, indexUpdateDesc.mSize, 1, pDesc->mNodeIndex);
+        ASSERT(indexUpdateDesc.pMappedData);
+        memcpy(indexUpdateDesc.mInternal.mMappedRange.pData, indexUpdateDesc.pMappedData, indexUpdateDesc.mSize);
+        tf_free(indexUpdateDesc.pMappedData);
+        if (indexUpdateDesc.mInternal.mMappedRange.mFlags & MAPPED_RANGE_FLAG_TEMP_BUFFER)
+        {
+            setBufferName(pRenderer, indexUpdateDesc.mInternal.mMappedRange.pBuffer, pDesc->pFileName);
+        }
+        indexUpdateDesc.pMappedData = indexUpdateDesc.mInternal.mMappedRange.pData;
+        uploadResult = updateBuffer(pRenderer, pCopyEngine, indexUpdateDesc);
     }
 
-    for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
+    barriers[barrierCount++] = { indexUpdateDesc.pBuffer, RESOURCE_STATE_COPY_DEST, gIndexBufferState };
+
+    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
     {
-#if defined(DIRECT3D11)
-        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_D3D11;
-#elif defined(GLES)
-        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_GLES;
-#else
-        const bool wait = true;
-#endif
-        if (wait)
+        if (vertexUpdateDesc[i].pBuffer)
         {
-            waitQueueIdle(pLoader->pUploadEngines[nodeIndex].pQueue);
+            if (!packed && (!gUma || (vertexUpdateDesc[i].pMappedData && !vertexUpdateDesc[i].pBuffer->pCpuMappedAddress)))
+            {
+                vertexUpdateDesc[i].mCurrentState = gUma ? vertexUpdateDesc[i].mCurrentState : RESOURCE_STATE_COPY_DEST;
+                vertexUpdateDesc[i].mInternal.mMappedRange =
+                    allocateStagingMemory(pCopyEngine, vertexUpdateDesc[i].mSize, 1, pDesc->mNodeIndex);
+                ASSERT(vertexUpdateDesc[i].pMappedData);
+                memcpy(vertexUpdateDesc[i].mInternal.mMappedRange.pData, vertexUpdateDesc[i].pMappedData, vertexUpdateDesc[i].mSize);
+                tf_free(vertexUpdateDesc[i].pMappedData);
+                if (vertexUpdateDesc[i].mInternal.mMappedRange.mFlags & MAPPED_RANGE_FLAG_TEMP_BUFFER)
+                {
+                    setBufferName(pRenderer, vertexUpdateDesc[i].mInternal.mMappedRange.pBuffer, pDesc->pFileName);
+                }
+                vertexUpdateDesc[i].pMappedData = vertexUpdateDesc[i].mInternal.mMappedRange.pData;
+                uploadResult = updateBuffer(pRenderer, pCopyEngine, vertexUpdateDesc[i]);
+            }
+            barriers[barrierCount++] = { vertexUpdateDesc[i].pBuffer, RESOURCE_STATE_COPY_DEST, gVertexBufferState };
         }
-
-        Renderer* renderer = pLoader->ppRenderers[nodeIndex];
-        cleanupCopyEngine(renderer, &pLoader->pUploadEngines[nodeIndex]);
     }
 
-    destroyConditionVariable(&pLoader->mQueueCond);
-    destroyConditionVariable(&pLoader->mTokenCond);
-    destroyMutex(&pLoader->mQueueMutex);
-    destroyMutex(&pLoader->mTokenMutex);
-    destroyMutex(&pLoader->mSemaphoreMutex);
-    destroyMutex(&pLoader->mUploadEngineMutex);
+    if (!gUma && IssueBufferCopyBarriers())
+    {
+        Cmd* cmd = acquirePostCopyBarrierCmd(pCopyEngine);
+        cmdResourceBarrier(cmd, barrierCount, barriers, 0, NULL, 0, NULL);
+    }
 
-    tf_delete(pLoader);
+    return uploadResult;
 }
 
-static void queueBufferLoad(ResourceLoader* pLoader, BufferLoadDescInternal* pBufferLoad, SyncToken* token)
+static UploadFunctionResult loadGeometryShadow(CopyEngine* pCopyEngine, const GeometryShadowLoadDesc* pDesc)
 {
-    uint32_t nodeIndex = pBufferLoad->pBuffer->mNodeIndex;
-    acquireMutex(&pLoader->mQueueMutex);
-
-    SyncToken t = tfrg_atomic64_add_relaxed(&pLoader->mTokenCounter, 1) + 1;
-
-    arrpush(pLoader->mRequestQueue[nodeIndex], UpdateRequest(*pBufferLoad));
-    UpdateRequest* pLastRequest = arrback(pLoader->mRequestQueue[nodeIndex]);
-    if (pLastRequest)
-        pLastRequest->mWaitIndex = t;
+    GeometryData*               pGeom = pDesc->pGeometryData;
+    const GeometryShadowSource* pSource = pGeom->pShadowSource;
+    GeometryShadowCache*        pCache = &pResourceLoader->mGeometryShadows;
+
+    // Requested again before the first load completed
+    acquireMutex(&pCache->mMutex);
+    const bool resident = pGeom->pShadow != NULL;
+    releaseMutex(&pCache->mMutex);
+    if (resident)
+        return UPLOAD_FUNCTION_RESULT_COMPLETED;
 
-    releaseMutex(&pLoader->mQueueMutex);
-    wakeOneConditionVariable(&pLoader->mQueueCond);
-    if (token)
-        *token = max(t, *token);
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_MESHES, pSource->pFileName, FM_READ, &file))
+    {
+        LOGF(eERROR, "Failed to open bin file %s", pSource->pFileName);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
 
-    if (pResourceLoader->mDesc.mSingleThreaded)
+    GeometryData::ShadowData* pShadow = (GeometryData::ShadowData*)tf_malloc(pSource->mSize);
+    const bool                read = fsSeekStream(&file, SBO_START_OF_FILE, (ssize_t)pSource->mOffset) &&
+                      loaderReadFromStream(pCopyEngine, &file, pShadow, pSource->mSize) == pSource->mSize;
+    fsCloseStream(&file);
+    if (!read)
     {
-        streamerThreadFunc(pResourceLoader);
+        LOGF(eERROR, "File '%s': Failed to read Geometry object's shadow.", pSource->pFileName);
+        tf_free(pShadow);
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
     }
-}
 
-static void queueTextureLoad(ResourceLoader* pLoader, TextureLoadDescInternal* pTextureLoad, SyncToken* token)
-{
-    uint32_t nodeIndex = pTextureLoad->mNodeIndex;
-    acquireMutex(&pLoader->mQueueMutex);
+    setupGeometryShadowPointers(pShadow, pSource->mIndexCount, pSource->mVertexCount);
 
-    SyncToken t = tfrg_atomic64_add_relaxed(&pLoader->mTokenCounter, 1) + 1;
+    acquireMutex(&pCache->mMutex);
+    pGeom->pShadow = pShadow;
+    pCache->mResidentSize += pSource->mSize;
+    pCache->mLoadedSize += pSource->mSize;
+    arrpush(pCache->ppResident, pGeom);
+    releaseMutex(&pCache->mMutex);
 
-    arrpush(pLoader->mRequestQueue[nodeIndex], UpdateRequest(*pTextureLoad));
-    UpdateRequest* pLastRequest = arrback(pLoader->mRequestQueue[nodeIndex]);
-    if (pLastRequest)
-        pLastRequest->mWaitIndex = t;
+    return UPLOAD_FUNCTION_RESULT_COMPLETED;
+}
 
-    releaseMutex(&pLoader->mQueueMutex);
-    wakeOneConditionVariable(&pLoader->mQueueCond);
-    if (token)
-        *token = max(t, *token);
+typedef struct GeometryFileSizes
+{
+    uint32_t mGeomSize;
+    uint32_t mGeomDataSize;
+    uint32_t mShadowSize;
+    uint64_t mMeshletSize;
+} GeometryFileSizes;
+
+// Reads the size of each section of a custom mesh file without reading the sections themselves
+static bool readGeometryFileSizes(const char* pFileName, GeometryFileSizes* pOut)
+{
+    *pOut = {};
 
-    if (pResourceLoader->mDesc.mSingleThreaded)
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_MESHES, pFileName, FM_READ, &file))
     {
-        streamerThreadFunc(pResourceLoader);
+        LOGF(eERROR, "Failed to open bin file %s", pFileName);
+        return false;
     }
-}
 
-static void queueGeometryLoad(ResourceLoader* pLoader, GeometryLoadDesc* pGeometryLoad, SyncToken* token)
-{
-    uint32_t nodeIndex = pGeometryLoad->mNodeIndex;
-    acquireMutex(&pLoader->mQueueMutex);
+    char magic[TF_ARRAY_COUNT(GEOMETRY_FILE_MAGIC_STR)] = { 0 };
+    bool valid = fsReadFromStream(&file, magic, sizeof(magic)) == sizeof(magic) &&
+                 strncmp(magic, GEOMETRY_FILE_MAGIC_STR, TF_ARRAY_COUNT(magic)) == 0;
 
-    SyncToken t = tfrg_atomic64_add_relaxed(&pLoader->mTokenCounter, 1) + 1;
+    valid = valid && fsReadFromStream(&file, &pOut->mGeomSize, sizeof(uint32_t)) == sizeof(uint32_t) &&
+            pOut->mGeomSize >= sizeof(Geometry) && fsSeekStream(&file, SBO_CURRENT_POSITION, pOut->mGeomSize);
+    valid = valid && fsReadFromStream(&file, &pOut->mGeomDataSize, sizeof(uint32_t)) == sizeof(uint32_t) &&
+            pOut->mGeomDataSize >= sizeof(GeometryData) && fsSeekStream(&file, SBO_CURRENT_POSITION, pOut->mGeomDataSize);
+    valid = valid && fsReadFromStream(&file, &pOut->mShadowSize, sizeof(uint32_t)) == sizeof(uint32_t) &&
+            pOut->mShadowSize >= sizeof(GeometryData::ShadowData) && fsSeekStream(&file, SBO_CURRENT_POSITION, pOut->mShadowSize);
 
-    arrpush(pLoader->mRequestQueue[nodeIndex], UpdateRequest(*pGeometryLoad));
-    UpdateRequest* pLastRequest = arrback(pLoader->mRequestQueue[nodeIndex]);
-    if (pLastRequest)
-        pLastRequest->mWaitIndex = t;
+    if (valid)
+    {
+        // Meshlets are the last section of the file
+        const ssize_t fileSize = fsGetStreamFileSize(&file);
+        const ssize_t position = fsGetStreamSeekPosition(&file);
+        valid = fileSize >= position;
+        pOut->mMeshletSize = valid ? (uint64_t)(fileSize - position) : 0;
+    }
 
-    releaseMutex(&pLoader->mQueueMutex);
-    wakeOneConditionVariable(&pLoader->mQueueCond);
-    if (token)
-        *token = max(t, *token);
+    fsCloseStream(&file);
 
-    if (pResourceLoader->mDesc.mSingleThreaded)
+    if (!valid)
     {
-        streamerThreadFunc(pResourceLoader);
+        LOGF(eERROR, "File '%s' is not a valid Geometry file.", pFileName);
+        *pOut = {};
     }
+
+    return valid;
 }
 
-static void queueTextureBarrier(ResourceLoader* pLoader, Texture* pTexture, ResourceState state, SyncToken* token)
+static bool readGeometryFile(const char* pFileName, const GeometryFileSizes* pSizes, Geometry* geom, GeometryData* geomData,
+                             GeometryData::ShadowData* pShadow, uint8_t* pMeshlets)
 {
-    uint32_t nodeIndex = pTexture->mNodeIndex;
-    acquireMutex(&pLoader->mQueueMutex);
-
-    SyncToken t = tfrg_atomic64_add_relaxed(&pLoader->mTokenCounter, 1) + 1;
-
-    arrpush(pLoader->mRequestQueue[nodeIndex], UpdateRequest(TextureBarrier{ pTexture, RESOURCE_STATE_UNDEFINED, state }));
-    UpdateRequest* pLastRequest = arrback(pLoader->mRequestQueue[nodeIndex]);
-    if (pLastRequest)
-        pLastRequest->mWaitIndex = t;
-
-    releaseMutex(&pLoader->mQueueMutex);
-    wakeOneConditionVariable(&pLoader->mQueueCond);
-    if (token)
-        *token = max(t, *token);
-
-    if (pResourceLoader->mDesc.mSingleThreaded)
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_MESHES, pFileName, FM_READ, &file))
     {
-        streamerThreadFunc(pResourceLoader);
+        LOGF(eERROR, "Failed to open bin file %s", pFileName);
+        return false;
     }
-}
 
-static void queueTextureCopy(ResourceLoader* pLoader, TextureCopyDesc* pTextureCopy, SyncToken* token)
-{
-    ASSERT(pTextureCopy->pTexture->mNodeIndex == pTextureCopy->pBuffer->mNodeIndex);
-    uint32_t nodeIndex = pTextureCopy->pTexture->mNodeIndex;
-    acquireMutex(&pLoader->mQueueMutex);
+    // Skip magic and section sizes, we already know them
+    bool valid = fsSeekStream(&file, SBO_START_OF_FILE, sizeof(GEOMETRY_FILE_MAGIC_STR) + sizeof(uint32_t)) &&
+                 fsReadFromStream(&file, geom, pSizes->mGeomSize) == pSizes->mGeomSize &&
+                 fsSeekStream(&file, SBO_CURRENT_POSITION, sizeof(uint32_t)) &&
+                 fsReadFromStream(&file, geomData, pSizes->mGeomDataSize) == pSizes->mGeomDataSize &&
+                 fsSeekStream(&file, SBO_CURRENT_POSITION, sizeof(uint32_t)) &&
+                 fsReadFromStream(&file, pShadow, pSizes->mShadowSize) == pSizes->mShadowSize;
 
-    SyncToken t = tfrg_atomic64_add_relaxed(&pLoader->mTokenCounter, 1) + 1;
+    if (valid && geom->meshlets.mMeshletCount)
+    {
+        uint64_t alloc_size = getGeometryMeshletsSize(geom);
 
-    arrpush(pLoader->mRequestQueue[nodeIndex], UpdateRequest(*pTextureCopy));
-    UpdateRequest* pLastRequest = arrback(pLoader->mRequestQueue[nodeIndex]);
-    if (pLastRequest)
-        pLastRequest->mWaitIndex = t;
+        setupGeometryMeshletPointers(geom, pMeshlets);
 
-    releaseMutex(&pLoader->mQueueMutex);
-    wakeOneConditionVariable(&pLoader->mQueueCond);
-    if (token)
-        *token = max(t, *token);
+        valid = alloc_size <= pSizes->mMeshletSize && fsReadFromStream(&file, pMeshlets, alloc_size) == alloc_size;
+    }
 
-    if (pResourceLoader->mDesc.mSingleThreaded)
+    fsCloseStream(&file);
+
+    if (!valid)
     {
-        streamerThreadFunc(pResourceLoader);
+        LOGF(eERROR, "File '%s': Failed to read Geometry object.", pFileName);
+        return false;
     }
+
+    geomData->pShadow = pShadow;
+    geomData->pShadowSource = NULL;
+    setupGeometryPointers(geom, geomData);
+    return true;
 }
 
-static void waitForToken(ResourceLoader* pLoader, const SyncToken* token)
+// Sub-allocates one chunk big enough for the given parts, parts are laid out back to back keeping each of them aligned to its stride
+static bool addGeometryBatchBufferPart(BufferChunkAllocator* pAllocator, uint32_t count, const uint32_t* pSizes, const uint32_t* pStrides,
+                                       BufferChunk* pOutChunk, BufferChunk** ppOutParts)
 {
-    if (pLoader->mDesc.mSingleThreaded)
+    uint64_t totalSize = 0;
+    uint32_t firstStride = 0;
+    bool     uniformStride = true;
+    for (uint32_t i = 0; i < count; ++i)
     {
-        return;
+        if (!pSizes[i])
+            continue;
+        firstStride = firstStride ? firstStride : pStrides[i];
+        uniformStride = uniformStride && firstStride == pStrides[i];
+        totalSize += pSizes[i];
     }
-    acquireMutex(&pLoader->mTokenMutex);
-    while (!isTokenCompleted(token))
+
+    if (!totalSize)
+        return true;
+
+    // When all parts use the same stride they stay aligned if the chunk is, otherwise reserve space for the worst case padding
+    if (!uniformStride)
     {
-        waitConditionVariable(&pLoader->mTokenCond, &pLoader->mTokenMutex, TIMEOUT_INFINITE);
+        for (uint32_t i = 0; i < count; ++i)
+            totalSize += pSizes[i] ? pStrides[i] - 1 : 0;
     }
-    releaseMutex(&pLoader->mTokenMutex);
-}
 
-static void waitForTokenSubmitted(ResourceLoader* pLoader, const SyncToken* token)
-{
-    if (pLoader->mDesc.mSingleThreaded)
+    if (totalSize > pAllocator->mSize)
     {
-        return;
+        *pOutChunk = {};
+        return false;
     }
-    acquireMutex(&pLoader->mTokenMutex);
-    while (!isTokenSubmitted(token))
+
+    addGeometryBufferPart(pAllocator, (uint32_t)totalSize, firstStride, pOutChunk);
+    if (!pOutChunk->mSize)
+        return false;
+
+    uint32_t offset = pOutChunk->mOffset;
+    for (uint32_t i = 0; i < count; ++i)
     {
-        waitConditionVariable(&pLoader->mTokenCond, &pLoader->mTokenMutex, TIMEOUT_INFINITE);
+        if (!pSizes[i])
+            continue;
+
+        const uint32_t padding = offset % pStrides[i];
+        offset += padding ? pStrides[i] - padding : 0;
+        *ppOutParts[i] = { offset, pSizes[i] };
+        offset += pSizes[i];
     }
-    releaseMutex(&pLoader->mTokenMutex);
+
+    ASSERT(offset <= pOutChunk->mOffset + pOutChunk->mSize);
+    return true;
 }
 
-/************************************************************************/
-// Resource Loader Interface Implementation
-/************************************************************************/
-void initResourceLoaderInterface(Renderer* pRenderer, ResourceLoaderDesc* pDesc)
+static UploadFunctionResult loadGeometryBatch(Renderer* pRenderer, CopyEngine* pCopyEngine, UpdateRequest& pBatchLoad)
 {
-    initResourceLoader(&pRenderer, 1, pDesc, &pResourceLoader);
+    GeometryBatchLoadDesc* pDesc = &pBatchLoad.geomBatchLoadDesc;
+    const uint32_t         count = pDesc->mFileCount;
+    const bool             shadowed = (pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED) == GEOMETRY_LOAD_FLAG_SHADOWED;
 
-#ifdef ENABLE_FORGE_MATERIALS
-    if (pDesc && pDesc->mUseMaterials)
+    // Parse all the files first so that the metadata of the whole batch can be stored in a single allocation
+    GeometryFileSizes* pFileSizes = (GeometryFileSizes*)tf_calloc(count, sizeof(GeometryFileSizes));
+    uint64_t           metadataSize = round_up_64(sizeof(GeometryBatch) + 2 * count * sizeof(void*), 16);
+    uint64_t           shadowScratchSize = 0;
+    for (uint32_t i = 0; i < count; ++i)
     {
-        uint32_t maxShaders = 0;
-        uint32_t maxTextures = 0;
-
+        bool read = false;
         {
-            // During material compilation we generate an ini file with data to initialize the material library
-            FileStream stream = {};
-            if (fsOpenStreamFromPath(RD_COMPILED_MATERIALS, "material_lib.ini", FM_READ, &stream))
-            {
-                char buffer[256] = {};
-                ASSERT((uint64_t)fsGetStreamFileSize(&stream) <= sizeof(buffer));
-                fsReadFromStream(&stream, buffer, sizeof(buffer));
-                sscanf(buffer, "%u %u", &maxShaders, &maxTextures);
+            LoadPhaseScope ioScope(pCopyEngine, RESOURCE_LOAD_PHASE_FILE_IO);
+            read = readGeometryFileSizes(pDesc->ppFileNames[i], &pFileSizes[i]);
+        }
+        if (!read)
+            continue;
 
-                fsCloseStream(&stream);
-            }
-            else
-            {
-                ASSERT(false);
-                return;
-            }
+        metadataSize += round_up_64(pFileSizes[i].mGeomSize, 16) + round_up_64(pFileSizes[i].mGeomDataSize, 16) +
+                        round_up_64(pFileSizes[i].mMeshletSize, 16);
+        // Shadow data is only needed while uploading unless the user wants to keep it
+        if (shadowed)
+            metadataSize += round_up_64(pFileSizes[i].mShadowSize, 16);
+        else
+            shadowScratchSize += round_up_64(pFileSizes[i].mShadowSize, 16);
+    }
+
+    uint8_t*       pMetadata = (uint8_t*)tf_calloc_memalign(1, 16, metadataSize);
+    uint8_t*       pShadowScratch = shadowScratchSize ? (uint8_t*)tf_memalign(16, shadowScratchSize) : NULL;
+    GeometryBatch* pBatch = (GeometryBatch*)pMetadata;
+    pBatch->ppGeometry = (Geometry**)(pBatch + 1);
+    pBatch->ppGeometryData = (GeometryData**)(pBatch->ppGeometry + count);
+    pBatch->mGeometryCount = count;
+    pBatch->mMetadataSize = metadataSize;
+    pBatch->pGeometryBuffer = pDesc->pGeometryBuffer;
+
+    uint8_t* pMetadataCursor = pMetadata + round_up_64(sizeof(GeometryBatch) + 2 * count * sizeof(void*), 16);
+    uint8_t* pShadowCursor = pShadowScratch;
+
+    GeometryVertexCopyInfo* pCopyInfos = (GeometryVertexCopyInfo*)tf_calloc(count, sizeof(GeometryVertexCopyInfo));
+    // Per file sizes and strides of the index buffer followed by each vertex binding, used to sub-allocate in bulk
+    uint32_t*               pPartSizes = (uint32_t*)tf_calloc((MAX_VERTEX_BINDINGS + 1) * count * 2, sizeof(uint32_t));
+    uint32_t*               pPartStrides = pPartSizes + (MAX_VERTEX_BINDINGS + 1) * count;
+    BufferChunk**           ppParts = (BufferChunk**)tf_calloc(count, sizeof(BufferChunk*));
+    uint32_t*               pSrcIndexStrides = (uint32_t*)tf_calloc(count, sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const GeometryFileSizes* pSizes = &pFileSizes[i];
+        if (!pSizes->mGeomSize)
+            continue;
+
+        Geometry*     geom = (Geometry*)pMetadataCursor;
+        GeometryData* geomData = (GeometryData*)(pMetadataCursor + round_up_64(pSizes->mGeomSize, 16));
+        uint8_t*      pMeshlets = (uint8_t*)geomData + round_up_64(pSizes->mGeomDataSize, 16);
+        pMetadataCursor = pMeshlets + round_up_64(pSizes->mMeshletSize, 16);
+
+        GeometryData::ShadowData* pShadow = NULL;
+        if (shadowed)
+        {
+            pShadow = (GeometryData::ShadowData*)pMetadataCursor;
+            pMetadataCursor += round_up_64(pSizes->mShadowSize, 16);
+        }
+        else
+        {
+            pShadow = (GeometryData::ShadowData*)pShadowCursor;
+            pShadowCursor += round_up_64(pSizes->mShadowSize, 16);
         }
 
-        uint32_t totalSize = sizeof(MaterialLibrary);
-        totalSize += (sizeof(Shader**) + sizeof(uint16_t)) * maxShaders + alignof(Shader**); // Shaders
-        totalSize += (sizeof(Texture**) + sizeof(uint16_t)) * maxTextures;                   // Textures
-        totalSize += sizeof(uint16_t) * maxShaders;                                          // pMaterialShaderRefCount
-        totalSize += sizeof(uint16_t) * maxTextures;                                         // pMaterialTextureRefCount
+        bool read = false;
+        {
+            LoadPhaseScope ioScope(pCopyEngine, RESOURCE_LOAD_PHASE_FILE_IO);
+            read = readGeometryFile(pDesc->ppFileNames[i], pSizes, geom, geomData, pShadow, pMeshlets);
+        }
+        if (!read)
+            continue;
 
-        pMaterialLibrary = (MaterialLibrary*)tf_calloc(1, totalSize);
-        MaterialLibrary* pLib = pMaterialLibrary;
-        pLib->pRenderer = pRenderer;
-        pLib->ppMaterialShaders = (Shader**)alignMemory(pLib + 1, alignof(Shader**));
-        pLib->ppMaterialTextures = (Texture**)(pLib->ppMaterialShaders + maxShaders); //-V1027 // Memory already aligned to pointer
-        pLib->pMaterialShaderRefCount = (uint16_t*)(pLib->ppMaterialTextures + maxTextures);
-        pLib->pMaterialTextureRefCount = (uint16_t*)(pLib->pMaterialShaderRefCount + maxShaders);
-        pLib->mMaxMaterialShaders = maxShaders;
-        pLib->mMaxMaterialTextures = maxTextures;
-        ASSERT((char*)(pLib->pMaterialTextureRefCount + maxTextures) <= ((char*)pLib) + totalSize);
+        getGeometryVertexCopyInfo(pDesc->pVertexLayout, pDesc->pGeometryBufferLayoutDesc, geomData, pShadow, geom, &pCopyInfos[i]);
+
+        pSrcIndexStrides[i] = geom->mVertexCount > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t);
+        const uint32_t dstIndexStride =
+            pDesc->pGeometryBufferLayoutDesc
+                ? (pDesc->pGeometryBufferLayoutDesc->mIndexType == INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t))
+                : pSrcIndexStrides[i];
+        pPartSizes[i] = dstIndexStride * geom->mIndexCount;
+        pPartStrides[i] = dstIndexStride;
+
+        uint32_t bufferCounter = 0;
+        for (uint32_t b = 0; b < MAX_VERTEX_BINDINGS; ++b)
+        {
+            pPartSizes[(b + 1) * count + i] = geom->mVertexStrides[b] * geom->mVertexCount;
+            pPartStrides[(b + 1) * count + i] = geom->mVertexStrides[b];
+            bufferCounter += geom->mVertexStrides[b] ? 1 : 0;
+        }
+
+        geom->mVertexBufferCount = bufferCounter;
+        geom->pGeometryBuffer = pDesc->pGeometryBuffer;
+        if (pDesc->pGeometryBufferLayoutDesc)
+        {
+            geom->mIndexType = pDesc->pGeometryBufferLayoutDesc->mIndexType;
+        }
+
+        pBatch->ppGeometry[i] = geom;
+        pBatch->ppGeometryData[i] = geomData;
     }
-#endif
 
-#if defined(ENABLE_FORGE_RELOAD_SHADER)
-    if (!platformInitReloadClient())
+    // Sub-allocate index and vertex memory for the whole batch, one chunk per buffer
+    bool allocated = true;
+    for (uint32_t i = 0; i < count; ++i)
+        ppParts[i] = pBatch->ppGeometry[i] ? &pBatch->ppGeometry[i]->mIndexBufferChunk : NULL;
+    allocated = addGeometryBatchBufferPart(&pDesc->pGeometryBuffer->mIndex, count, pPartSizes, pPartStrides, &pBatch->mIndexBufferChunk,
+                                           ppParts);
+
+    for (uint32_t b = 0; b < MAX_VERTEX_BINDINGS && allocated; ++b)
     {
-        LOGF(eERROR, "Failed to initialize ReloadServer");
-#ifdef AUTOMATED_TESTING
-        ASSERT(false);
-#endif
+        for (uint32_t i = 0; i < count; ++i)
+            ppParts[i] = pBatch->ppGeometry[i] ? &pBatch->ppGeometry[i]->mVertexBufferChunks[b] : NULL;
+        allocated = addGeometryBatchBufferPart(&pDesc->pGeometryBuffer->mVertex[b], count, pPartSizes + (b + 1) * count,
+                                               pPartStrides + (b + 1) * count, &pBatch->mVertexBufferChunks[b], ppParts);
     }
-#else
-    LOGF(eWARNING, "ReloadServer is DISABLED. Shaders will not be updated dynamically on the device "
-                   "when they are recompiled while App is running. If this behaviour is desired then you can ignore this warning. "
-                   "If you want to re-enable ReloadServer you need to #define ENABLE_FORGE_RELOAD_SHADER in Application/Config.h"
-                   "This message is here to remind everyone to re-enable ReloadServer if it has been disabled for whatever reason.");
-#endif
-}
 
-void exitResourceLoaderInterface(Renderer* pRenderer)
-{
-    UNREF_PARAM(pRenderer);
-#ifdef ENABLE_FORGE_MATERIALS
-    if (pMaterialLibrary)
+    UploadFunctionResult uploadResult = UPLOAD_FUNCTION_RESULT_COMPLETED;
+
+    if (!allocated)
     {
-        MaterialLibrary* pLib = pMaterialLibrary;
-        ASSERT(pLib->mLoadedMaterialCount == 0);
+        LOGF(eERROR, "Not enough memory in the GeometryBuffer to load a batch of %u geometries", count);
+        ASSERT(false);
+        removeResource(pBatch);
+        pBatch = NULL;
+        uploadResult = UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
+    else
+    {
+        // Upload the data of all geometries with one copy per buffer
+        BufferBarrier    barriers[MAX_VERTEX_BINDINGS + 1] = {};
+        uint32_t         barrierCount = 0;
+        BufferUpdateDesc updateDesc = {};
 
-#if defined(FORGE_DEBUG)
-        for (uint32_t i = 0; i < pLib->mMaxMaterialShaders; ++i)
+        if (pBatch->mIndexBufferChunk.mSize)
         {
-            ASSERT(pLib->ppMaterialShaders[i] == NULL);
-            ASSERT(pLib->pMaterialShaderRefCount[i] == 0);
+            updateDesc = {};
+            updateDesc.pBuffer = pDesc->pGeometryBuffer->mIndex.pBuffer;
+            updateDesc.mDstOffset = pBatch->mIndexBufferChunk.mOffset;
+            updateDesc.mSize = pBatch->mIndexBufferChunk.mSize;
+            uint8_t* pDst = beginGeometryUpload(pRenderer, pCopyEngine, &updateDesc, pDesc->mNodeIndex, "GeometryBatch");
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const Geometry* geom = pBatch->ppGeometry[i];
+                if (!geom || !pPartSizes[i])
+                    continue;
+                copyGeometryIndices(geom, pBatch->ppGeometryData[i]->pShadow, pSrcIndexStrides[i], pPartStrides[i],
+                                    pDst + (geom->mIndexBufferChunk.mOffset - pBatch->mIndexBufferChunk.mOffset), pDesc->ppFileNames[i]);
+            }
+            uploadResult = endGeometryUpload(pRenderer, pCopyEngine, &updateDesc);
+            barriers[barrierCount++] = { updateDesc.pBuffer, RESOURCE_STATE_COPY_DEST, gIndexBufferState };
         }
-        for (uint32_t i = 0; i < pLib->mMaxMaterialTextures; ++i)
+
+        for (uint32_t b = 0; b < MAX_VERTEX_BINDINGS; ++b)
         {
-            ASSERT(pLib->ppMaterialTextures[i] == NULL);
-            ASSERT(pLib->pMaterialTextureRefCount[i] == 0);
+            if (!pBatch->mVertexBufferChunks[b].mSize)
+                continue;
+
+            updateDesc = {};
+            updateDesc.pBuffer = pDesc->pGeometryBuffer->mVertex[b].pBuffer;
+            updateDesc.mDstOffset = pBatch->mVertexBufferChunks[b].mOffset;
+            updateDesc.mSize = pBatch->mVertexBufferChunks[b].mSize;
+            uint8_t* pDst = beginGeometryUpload(pRenderer, pCopyEngine, &updateDesc, pDesc->mNodeIndex, "GeometryBatch");
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const Geometry* geom = pBatch->ppGeometry[i];
+                if (!geom || !geom->mVertexStrides[b])
+                    continue;
+                uint8_t* vertexDst[MAX_VERTEX_BINDINGS] = {};
+                vertexDst[b] = pDst + (geom->mVertexBufferChunks[b].mOffset - pBatch->mVertexBufferChunks[b].mOffset);
+                copyGeometryVertices(geom, pBatch->ppGeometryData[i]->pShadow, &pCopyInfos[i], b, vertexDst);
+            }
+            uploadResult = endGeometryUpload(pRenderer, pCopyEngine, &updateDesc);
+            barriers[barrierCount++] = { updateDesc.pBuffer, RESOURCE_STATE_COPY_DEST, gVertexBufferState };
+        }
+
+        if (!gUma && IssueBufferCopyBarriers() && barrierCount)
+        {
+            Cmd* cmd = acquirePostCopyBarrierCmd(pCopyEngine);
+            cmdResourceBarrier(cmd, barrierCount, barriers, 0, NULL, 0, NULL);
+        }
+
+        // If the user doesn't want the shadowed data we don't need it any more
+        if (!shadowed)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (pBatch->ppGeometryData[i])
+                    pBatch->ppGeometryData[i]->pShadow = nullptr;
+            }
         }
-#endif
-        tf_free(pMaterialLibrary);
-        pMaterialLibrary = NULL;
     }
-#endif
 
-    exitResourceLoader(pResourceLoader);
+    *pDesc->ppGeometryBatch = pBatch;
 
-#if defined(ENABLE_FORGE_RELOAD_SHADER)
-    platformExitReloadClient();
+    tf_free(pSrcIndexStrides);
+    tf_free(ppParts);
+    tf_free(pPartSizes);
+    tf_free(pCopyInfos);
+    tf_free(pShadowScratch);
+    tf_free(pFileSizes);
+    // Vertex layout and filename array were copied in a single allocation by addResource
+    tf_free((void*)pDesc->pVertexLayout);
+
+    return uploadResult;
+}
+
+static UploadFunctionResult copyTexture(Renderer* pRenderer, CopyEngine* pCopyEngine, TextureCopyDesc& pTextureCopy)
+{
+    UNREF_PARAM(pRenderer);
+    Texture*              texture = pTextureCopy.pTexture;
+    const TinyImageFormat fmt = (TinyImageFormat)texture->mFormat;
+
+    Cmd* cmd = acquireCmd(pCopyEngine);
+
+    if (pTextureCopy.pWaitSemaphore)
+        arrpush(pCopyEngine->mWaitSemaphores, pTextureCopy.pWaitSemaphore);
+
+    TextureBarrier barrier = { texture, pTextureCopy.mTextureState, RESOURCE_STATE_COPY_SOURCE };
+    barrier.mAcquire = 1;
+    barrier.mQueueType = pTextureCopy.mQueueType;
+    cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+
+    uint32_t numBytes = 0;
+    uint32_t rowBytes = 0;
+    uint32_t numRows = 0;
+
+    bool ret = util_get_surface_info(texture->mWidth, texture->mHeight, fmt, &numBytes, &rowBytes, &numRows);
+    if (!ret)
+    {
+        return UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+    }
+
+    SubresourceDataDesc subresourceDesc = {};
+    subresourceDesc.mArrayLayer = pTextureCopy.mTextureArrayLayer;
+    subresourceDesc.mMipLevel = pTextureCopy.mTextureMipLevel;
+    subresourceDesc.mSrcOffset = pTextureCopy.mBufferOffset;
+#if defined(DIRECT3D11) || defined(METAL) || defined(VULKAN) || defined(WEBGPU)
+    const uint32_t sliceAlignment = util_get_texture_subresource_alignment(pRenderer, fmt);
+    const uint32_t rowAlignment = util_get_texture_row_alignment(pRenderer);
+    uint32_t       subRowPitch = round_up(rowBytes, rowAlignment);
+    uint32_t       subSlicePitch = round_up(subRowPitch * numRows, sliceAlignment);
+    subresourceDesc.mRowPitch = subRowPitch;
+    subresourceDesc.mSlicePitch = subSlicePitch;
 #endif
+    cmdCopySubresource(cmd, pTextureCopy.pBuffer, pTextureCopy.pTexture, &subresourceDesc);
+
+    barrier = { texture, RESOURCE_STATE_COPY_SOURCE, pTextureCopy.mTextureState };
+    barrier.mRelease = 1;
+    barrier.mQueueType = pTextureCopy.mQueueType;
+    cmdResourceBarrier(cmd, 0, NULL, 1, &barrier, 0, NULL);
+
+    return UPLOAD_FUNCTION_RESULT_COMPLETED;
+}
+/************************************************************************/
+// Internal Resource Loader Implementation
+/************************************************************************/
+static uint32_t getQueuedRequestCount(ResourceLoader* pLoader, uint32_t nodeIndex, uint32_t level)
+{
+    return (uint32_t)arrlen(pLoader->mRequestQueue[nodeIndex][level]) - pLoader->mRequestQueueHead[nodeIndex][level];
 }
 
-void initResourceLoaderInterface(Renderer** ppRenderers, uint32_t rendererCount, ResourceLoaderDesc* pDesc)
+static bool areTasksAvailable(ResourceLoader* pLoader)
 {
-    initResourceLoader(ppRenderers, rendererCount, pDesc, &pResourceLoader);
+    for (size_t i = 0; i < MAX_MULTIPLE_GPUS; ++i)
+    {
+        for (uint32_t level = 0; level < RESOURCE_LOAD_PRIORITY_LEVEL_COUNT; ++level)
+        {
+            if (getQueuedRequestCount(pLoader, (uint32_t)i, level))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
 }
 
-void exitResourceLoaderInterface(Renderer** pRenderers, uint32_t rendererCount)
+static void removeQueuedRequest(ResourceLoader* pLoader, uint32_t nodeIndex, uint32_t level, uint32_t index)
 {
-    UNREF_PARAM(pRenderers);
-    UNREF_PARAM(rendererCount);
-    exitResourceLoader(pResourceLoader);
+    UpdateRequest** pRequestQueue = &pLoader->mRequestQueue[nodeIndex][level];
+    uint32_t*       pHead = &pLoader->mRequestQueueHead[nodeIndex][level];
+    if (index == *pHead)
+    {
+        ++(*pHead);
+    }
+    else
+    {
+        arrdel(*pRequestQueue, index);
+    }
+
+    if (*pHead == (uint32_t)arrlen(*pRequestQueue))
+    {
+        arrsetlen(*pRequestQueue, 0);
+        *pHead = 0;
+    }
 }
 
-#ifdef ENABLE_FORGE_MATERIALS
-static void parseMaterial(const char* pFileBuffer, uint64_t fileSize, Material** pOut)
+// Barriers and copies depend on the loads queued before them so they are never reordered with older requests
+static bool isOrderedRequest(const UpdateRequest* pRequest)
 {
-    ASSERT(pOut);
+    return pRequest->mType == UPDATE_REQUEST_TEXTURE_BARRIER || pRequest->mType == UPDATE_REQUEST_COPY_TEXTURE;
+}
 
-    uint64_t offset = 0;
-    uint64_t nextLineOffset = 0;
+// Must be called with mQueueMutex held
+static bool popQueuedRequest(ResourceLoader* pLoader, uint32_t nodeIndex, UpdateRequest* pOutRequest)
+{
+    // Highest priority level with queued requests, unless a lower level waited for too long
+    int32_t level = -1;
+    for (int32_t l = RESOURCE_LOAD_PRIORITY_LEVEL_COUNT - 1; l >= 0; --l)
+    {
+        if (!getQueuedRequestCount(pLoader, nodeIndex, (uint32_t)l))
+        {
+            continue;
+        }
+        if (level < 0 || pLoader->mSkippedCount[nodeIndex][l] >= RESOURCE_LOAD_STARVATION_LIMIT)
+        {
+            level = l;
+        }
+    }
 
-    const bool bCompiled = strncmp(pFileBuffer, ":FMC", 4) == 0;
-    if (!bCompiled)
+    if (level < 0)
     {
-        ASSERT(false && "This file doesn't contain a compiled material");
-        return;
+        return false;
     }
 
-    offset = 4; // Skip ":FMC"
+    for (;;)
+    {
+        const UpdateRequest* pFront = &pLoader->mRequestQueue[nodeIndex][level][pLoader->mRequestQueueHead[nodeIndex][level]];
+        if (!isOrderedRequest(pFront))
+        {
+            break;
+        }
 
-    // Values from material compilation
-    uint32_t precomputedValues[7] = {};
+        int32_t   olderLevel = -1;
+        SyncToken olderToken = pFront->mWaitIndex;
+        for (uint32_t l = 0; l < RESOURCE_LOAD_PRIORITY_LEVEL_COUNT; ++l)
+        {
+            if (!getQueuedRequestCount(pLoader, nodeIndex, l))
+            {
+                continue;
+            }
+            const UpdateRequest* pOther = &pLoader->mRequestQueue[nodeIndex][l][pLoader->mRequestQueueHead[nodeIndex][l]];
+            if (pOther->mWaitIndex < olderToken)
+            {
+                olderLevel = (int32_t)l;
+                olderToken = pOther->mWaitIndex;
+            }
+        }
 
-    for (uint32_t i = 0; i < TF_ARRAY_COUNT(precomputedValues); ++i)
+        if (olderLevel < 0)
+        {
+            break;
+        }
+        level = olderLevel;
+    }
+
+    for (uint32_t l = 0; l < RESOURCE_LOAD_PRIORITY_LEVEL_COUNT; ++l)
     {
-        while (pFileBuffer[offset] == ' ')
+        if ((int32_t)l == level)
         {
-            offset++;
+            pLoader->mSkippedCount[nodeIndex][l] = 0;
+        }
+        else if ((int32_t)l < level && getQueuedRequestCount(pLoader, nodeIndex, l))
+        {
+            ++pLoader->mSkippedCount[nodeIndex][l];
         }
+    }
 
-        precomputedValues[i] = atoi(pFileBuffer + offset);
+    const uint32_t head = pLoader->mRequestQueueHead[nodeIndex][level];
+    *pOutRequest = pLoader->mRequestQueue[nodeIndex][level][head];
+    removeQueuedRequest(pLoader, nodeIndex, (uint32_t)level, head);
+    return true;
+}
 
-        while (pFileBuffer[offset] != '\n' && pFileBuffer[offset] != ' ')
+// Must be called with mQueueMutex held
+static PendingToken* findPendingToken(ResourceLoader* pLoader, SyncToken token)
+{
+    ptrdiff_t first = 0;
+    ptrdiff_t last = arrlen(pLoader->pPendingTokens);
+    while (first < last)
+    {
+        ptrdiff_t mid = first + (last - first) / 2;
+        if (pLoader->pPendingTokens[mid].mToken < token)
         {
-            offset++;
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
         }
     }
-    while (pFileBuffer[offset++] != '\n')
+
+    if (first < arrlen(pLoader->pPendingTokens) && pLoader->pPendingTokens[first].mToken == token)
     {
+        return &pLoader->pPendingTokens[first];
     }
 
-    const uint32_t numShaderSets = precomputedValues[0];
-    const uint32_t numTextureSets = precomputedValues[1];
-    const uint32_t numMaterialSets = precomputedValues[2];
-    const uint32_t numShaders = precomputedValues[3];
-    const uint32_t numTextures = precomputedValues[4];
-    const uint32_t maxShaderSetBindings = precomputedValues[5];
-    const uint32_t maxTextureSetTextures = precomputedValues[6];
+    return NULL;
+}
 
-    uint64_t extraSize = 0;
-    extraSize += sizeof(Material::LoadedMaterial) * numMaterialSets + alignof(Material::LoadedMaterial); // Material::pLoaded
-    extraSize += sizeof(uint32_t) * numMaterialSets * maxTextureSetTextures; // Material::LoadedMaterial::pTextureIndexes;
-    extraSize += sizeof(MaterialDesc::ShaderSet) * numShaderSets + alignof(MaterialDesc::ShaderSet); // MaterialDesc::pShaderSets
-    extraSize +=
-        sizeof(const char*) * numShaderSets * maxShaderSetBindings + alignof(void*); // MaterialDesc::ShaderSet::pTextureBindingNames
-    extraSize += sizeof(MaterialDesc::TextureSet) * numTextureSets + alignof(MaterialDesc::TextureSet); // MaterialDesc::pTextureSets
-    extraSize += sizeof(uint32_t) * numTextureSets * maxTextureSetTextures; // MaterialDesc::TextureSet::pTextureIdxs
-    extraSize += sizeof(MaterialDesc::MaterialSet) * numMaterialSets + alignof(MaterialDesc::MaterialSet); // MaterialDesc::pMaterialSets
-    extraSize += sizeof(uint32_t) * numTextures;                                                           // MaterialDesc::pTextureIds
-    extraSize += sizeof(*MaterialDesc::pTextureFlags) * numTextures;                                       // MaterialDesc::pTextureFlags;
-    extraSize += alignof(void*);                       // Alignment for the pointers below
-    extraSize += sizeof(const char*) * numTextureSets; // MaterialDesc::pMaterialSetNames
-    extraSize += sizeof(const char*) * numTextures;    // MaterialDesc::pTextureNames
-    extraSize += sizeof(const char*) * numShaders;     // MaterialDesc::pShaderNames
+// Advances the state of the given tokens and returns the token up to which every request reached that state
+static SyncToken updatePendingTokens(ResourceLoader* pLoader, const SyncToken* pTokens, uint32_t tokenCount, PendingTokenState state)
+{
+    acquireMutex(&pLoader->mQueueMutex);
+    for (uint32_t i = 0; i < tokenCount; ++i)
+    {
+        PendingToken* pPending = findPendingToken(pLoader, pTokens[i]);
+        ASSERT(pPending);
+        if (pPending)
+        {
+            pPending->mState = max(pPending->mState, (uint32_t)state);
+        }
+    }
 
-    // Note: We use file size for the string buffer size as it won't be bigger than that.
-    //       We could also compute a tighter buffer size during material compilation.
-    extraSize += fileSize;
+    if (state == PENDING_TOKEN_STATE_COMPLETED)
+    {
+        // Completed tokens are only tracked while an older one is still in flight
+        ptrdiff_t completedCount = 0;
+        while (completedCount < arrlen(pLoader->pPendingTokens) &&
+               pLoader->pPendingTokens[completedCount].mState == PENDING_TOKEN_STATE_COMPLETED)
+        {
+            ++completedCount;
+        }
+        if (completedCount)
+        {
+            arrdeln(pLoader->pPendingTokens, 0, completedCount);
+        }
+    }
 
-    const uint64_t totalSize = sizeof(Material) + sizeof(MaterialDesc) + alignof(MaterialDesc) + extraSize;
-    Material*      pMaterial = (Material*)tf_calloc(1, totalSize);
-    pMaterial->pLoaded = (Material::LoadedMaterial*)alignMemory(pMaterial + 1, alignof(Material::LoadedMaterial));
-    for (uint32_t i = 0; i < numMaterialSets; ++i)
+    SyncToken watermark = tfrg_atomic64_load_relaxed(&pLoader->mTokenCounter);
+    for (ptrdiff_t i = 0; i < arrlen(pLoader->pPendingTokens); ++i)
     {
-        pMaterial->pLoaded[i].pTextureIndexes = (uint32_t*)(pMaterial->pLoaded + numMaterialSets) + i * maxTextureSetTextures;
+        if (pLoader->pPendingTokens[i].mState < (uint32_t)state)
+        {
+            watermark = pLoader->pPendingTokens[i].mToken - 1;
+            break;
+        }
     }
-    MaterialDesc* pMaterialDesc =
-        (MaterialDesc*)alignMemory(pMaterial->pLoaded[numMaterialSets - 1].pTextureIndexes + maxTextureSetTextures, alignof(MaterialDesc));
-    pMaterial->pDesc = pMaterialDesc;
-    pMaterialDesc->pShaderSets = (MaterialDesc::ShaderSet*)alignMemory(pMaterialDesc + 1, alignof(MaterialDesc::ShaderSet));
-    for (uint32_t i = 0; i < numShaderSets; ++i)
+    releaseMutex(&pLoader->mQueueMutex);
+
+    return watermark;
+}
+
+// Hands the tokens processed so far to the active copy resource set and signals them as submitted
+static void submitProcessedTokens(ResourceLoader* pLoader)
+{
+    const uint32_t tokenCount = (uint32_t)arrlen(pLoader->pProcessedTokens);
+    SyncToken submittedToken = updatePendingTokens(pLoader, pLoader->pProcessedTokens, tokenCount, PENDING_TOKEN_STATE_SUBMITTED);
+
+    SyncToken** pSetTokens = &pLoader->pSetTokens[pLoader->pCopyEngines[0].activeSet];
+    for (uint32_t i = 0; i < tokenCount; ++i)
     {
-        pMaterialDesc->pShaderSets[i].pTextureBindingNames =
-            (const char**)alignMemory((pMaterialDesc->pShaderSets + numShaderSets) + i * maxShaderSetBindings, alignof(void*));
+        arrpush(*pSetTokens, pLoader->pProcessedTokens[i]);
     }
-    pMaterialDesc->pTextureSets = (MaterialDesc::TextureSet*)alignMemory(
-        pMaterialDesc->pShaderSets[numShaderSets - 1].pTextureBindingNames + maxShaderSetBindings, alignof(MaterialDesc::TextureSet));
-    for (uint32_t i = 0; i < numTextureSets; ++i)
+    arrsetlen(pLoader->pProcessedTokens, 0);
+
+    acquireMutex(&pLoader->mTokenMutex);
+    tfrg_atomic64_store_release(&pLoader->mTokenSubmitted, submittedToken);
+    releaseMutex(&pLoader->mTokenMutex);
+    wakeAllConditionVariable(&pLoader->mTokenCond);
+}
+
+/************************************************************************/
+// Load statistics
+/************************************************************************/
+static void beginLoadRecord(CopyEngine* pCopyEngine, const UpdateRequest& request, uint32_t nodeIndex, ResourceLoadRecord* pRecord)
+{
+    *pRecord = {};
+    const char* pName = NULL;
+    switch (request.mType)
     {
-        pMaterialDesc->pTextureSets[i].pTextureIdxs = (uint32_t*)(pMaterialDesc->pTextureSets + numTextureSets) + i * maxTextureSetTextures;
+    case UPDATE_REQUEST_TEXTURE_BARRIER:
+        pRecord->mType = RESOURCE_LOAD_TYPE_TEXTURE_BARRIER;
+        break;
+    case UPDATE_REQUEST_LOAD_BUFFER:
+        pRecord->mType = RESOURCE_LOAD_TYPE_BUFFER;
+        break;
+    case UPDATE_REQUEST_LOAD_TEXTURE:
+        pRecord->mType = RESOURCE_LOAD_TYPE_TEXTURE;
+        pName = request.texLoadDesc.mForceReset ? NULL : request.texLoadDesc.pFileName;
+        break;
+    case UPDATE_REQUEST_LOAD_GEOMETRY:
+        pRecord->mType = RESOURCE_LOAD_TYPE_GEOMETRY;
+        pName = request.geomLoadDesc.pFileName;
+        break;
+    case UPDATE_REQUEST_COPY_TEXTURE:
+        pRecord->mType = RESOURCE_LOAD_TYPE_TEXTURE_COPY;
+        break;
+    case UPDATE_REQUEST_LOAD_GEOMETRY_BATCH:
+        pRecord->mType = RESOURCE_LOAD_TYPE_GEOMETRY_BATCH;
+        pName = request.geomBatchLoadDesc.mFileCount ? request.geomBatchLoadDesc.ppFileNames[0] : NULL;
+        break;
+    case UPDATE_REQUEST_STREAM_TEXTURE:
+        pRecord->mType = RESOURCE_LOAD_TYPE_STREAMING_TEXTURE;
+        pName = request.texStreamDesc.pStreamingTexture->mInternal.pFileName;
+        break;
+    case UPDATE_REQUEST_LOAD_GEOMETRY_SHADOW:
+        pRecord->mType = RESOURCE_LOAD_TYPE_GEOMETRY_SHADOW;
+        pName = request.geomShadowLoadDesc.pGeometryData->pShadowSource->pFileName;
+        break;
+    case UPDATE_REQUEST_INVALID:
+        break;
     }
-    pMaterialDesc->pMaterialSets = (MaterialDesc::MaterialSet*)alignMemory(
-        pMaterialDesc->pTextureSets[numTextureSets - 1].pTextureIdxs + maxTextureSetTextures, alignof(MaterialDesc::MaterialSet));
-    pMaterialDesc->pTextureIds = (uint32_t*)(pMaterialDesc->pMaterialSets + numMaterialSets);
-    pMaterialDesc->pTextureFlags = (uint8_t*)(pMaterialDesc->pTextureIds + numTextures);
-    pMaterialDesc->pMaterialSetNames = (const char**)alignMemory(pMaterialDesc->pTextureFlags + numTextures, alignof(void*));
-    pMaterialDesc->pTextureNames = (const char**)pMaterialDesc->pMaterialSetNames + numMaterialSets;
-    pMaterialDesc->pShaderNames = (const char**)(pMaterialDesc->pTextureNames + numTextures);
-    pMaterialDesc->pStringBuffer = (char*)(pMaterialDesc->pShaderNames + numShaders);
-    pMaterialDesc->mStringBufferSize = (uint32_t)fileSize;
-    ASSERT(pMaterialDesc->pStringBuffer + fileSize <= ((const char*)pMaterial) + totalSize);
 
-    pMaterialDesc->mMaxShaderSetBindings = maxShaderSetBindings;
-    pMaterialDesc->mMaxTextureSetTextures = maxTextureSetTextures;
+    if (pName)
+        strncpy(pRecord->mName, pName, sizeof(pRecord->mName) - 1);
+    pRecord->mNodeIndex = nodeIndex;
+    pRecord->mToken = request.mWaitIndex;
+    pRecord->mQueueTime = request.mQueueTime;
+    pRecord->mStartTime = getUSec(false);
+    pCopyEngine->pActiveRecord = pRecord;
+}
 
-    // Parse material file
-    while (materialNextFileLine(pFileBuffer, fileSize, offset, &nextLineOffset))
+static void accumulateLoadRecord(ResourceLoaderStats* pStats, const ResourceLoadRecord* pRecord)
+{
+    ResourceLoadTypeStats* pTypeStats = &pStats->mTypes[pRecord->mType];
+    ++pTypeStats->mRequestCount;
+    pTypeStats->mFailedRequestCount += pRecord->mFailed ? 1 : 0;
+    pTypeStats->mUploadSize += pRecord->mUploadSize;
+    if (pRecord->mUploadPath != TEXTURE_UPLOAD_PATH_NONE)
+        ++pStats->mTextureUploadPathCount[pRecord->mUploadPath];
+    // GPU copy time is added once the request completes
+    for (uint32_t phase = 0; phase < RESOURCE_LOAD_PHASE_GPU_COPY; ++phase)
     {
-        MaterialDesc::TextureSet*  pTextureSet = NULL;
-        MaterialDesc::ShaderSet*   pShaderSet = NULL;
-        MaterialDesc::MaterialSet* pMaterialSet = NULL;
+        pTypeStats->mPhaseTime[phase] += (uint64_t)max(pRecord->mPhaseTime[phase], (int64_t)0);
+    }
+}
 
-        const char* pSetLine = pFileBuffer + offset;
-        switch (pSetLine[0])
-        {
-        case 'S':
-        {
-            pShaderSet = pMaterialDesc->pShaderSets + pMaterialDesc->mShaderSetCount;
-            pShaderSet->mVertIdx = INVALID_MATERIAL_ID;
-            pShaderSet->mFragIdx = INVALID_MATERIAL_ID;
-            pShaderSet->mHullIdx = INVALID_MATERIAL_ID;
-            pShaderSet->mDomainIdx = INVALID_MATERIAL_ID;
-            pShaderSet->mGeomIdx = INVALID_MATERIAL_ID;
-            pShaderSet->mCompIdx = INVALID_MATERIAL_ID;
+static void endLoadRecord(ResourceLoader* pLoader, CopyEngine* pCopyEngine, ResourceLoadRecord* pRecord, UploadFunctionResult result)
+{
+    pCopyEngine->pActiveRecord = NULL;
+    pRecord->mEndTime = getUSec(false);
+    pRecord->mFailed = UPLOAD_FUNCTION_RESULT_INVALID_REQUEST == result;
+    pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_QUEUE] = pRecord->mStartTime - pRecord->mQueueTime;
+    pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_PROCESS] =
+        max((int64_t)0, pRecord->mEndTime - pRecord->mStartTime - pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_FILE_IO] -
+                            pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_DECOMPRESS] - pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_STAGING_WAIT]);
+
+    ResourceLoaderStatistics* pStatistics = &pLoader->mStatistics;
+    acquireMutex(&pStatistics->mMutex);
+    accumulateLoadRecord(&pStatistics->mStats, pRecord);
+    if (pStatistics->mReportActive)
+    {
+        accumulateLoadRecord(&pStatistics->mReportStats, pRecord);
+        arrpush(pStatistics->pRecords, *pRecord);
+    }
+    releaseMutex(&pStatistics->mMutex);
+
+#if defined(ENABLE_PROFILER)
+    ProfileCounterAdd(pStatistics->mRequestCounters[pRecord->mType], 1);
+    ProfileCounterAdd(pStatistics->mUploadSizeCounters[pRecord->mType], (int64_t)pRecord->mUploadSize);
+#endif
+}
 
-            ASSERT(pSetLine[0] == 'S' && pSetLine[1] == ' ' && pSetLine[2] != ' ');
-            pShaderSet->mId = atoi(pSetLine + 2);
+// Called after the copy commands of the processed requests are submitted
+static void markSubmittedLoadRecords(ResourceLoader* pLoader)
+{
+    ResourceLoaderStatistics* pStatistics = &pLoader->mStatistics;
+    const int64_t             time = getUSec(false);
 
-            ASSERT(pMaterialDesc->mShaderSetCount < numShaderSets);
-            pMaterialDesc->mShaderSetCount++;
-            break;
-        }
-        case 'T':
+    acquireMutex(&pStatistics->mMutex);
+    ++pStatistics->mStats.mSubmitCount;
+    if (pStatistics->mReportActive)
+    {
+        ++pStatistics->mReportStats.mSubmitCount;
+        for (; pStatistics->mSubmittedRecordCount < (uint32_t)arrlen(pStatistics->pRecords); ++pStatistics->mSubmittedRecordCount)
         {
-            pTextureSet = pMaterialDesc->pTextureSets + pMaterialDesc->mTextureSetCount;
-            pTextureSet->pTextureIdxs[0] = INVALID_MATERIAL_ID;
-
-            ASSERT(pMaterialDesc->mTextureSetCount < numTextureSets);
-            pMaterialDesc->mTextureSetCount++;
-            break;
+            pStatistics->pRecords[pStatistics->mSubmittedRecordCount].mSubmitTime = time;
         }
-        case 'M':
-        {
-            pMaterialSet = pMaterialDesc->pMaterialSets + pMaterialDesc->mMaterialCount;
-            pMaterialSet->mShaderSetIdx = INVALID_MATERIAL_ID;
-            pMaterialSet->mTextureSetIdx = INVALID_MATERIAL_ID;
+    }
+    releaseMutex(&pStatistics->mMutex);
+}
 
-            uint32_t offset32 = 0;
-            pMaterialDesc->pMaterialSetNames[pMaterialDesc->mMaterialCount] =
-                materialParseAndStoreString(pMaterialDesc, pSetLine + 2, &offset32);
+// Called before publishing completedToken so that waiting for a token guarantees the completion time of its requests is recorded
+static void markCompletedLoadRecords(ResourceLoader* pLoader, SyncToken completedToken)
+{
+    ResourceLoaderStatistics* pStatistics = &pLoader->mStatistics;
+    const int64_t             time = getUSec(false);
 
-            ASSERT(pMaterialDesc->mMaterialCount < numMaterialSets);
-            pMaterialDesc->mMaterialCount++;
-            break;
-        }
-        case '#': // Comment
-        default:
+    acquireMutex(&pStatistics->mMutex);
+    for (; pStatistics->mReportActive && pStatistics->mCompletedRecordCount < pStatistics->mSubmittedRecordCount;
+         ++pStatistics->mCompletedRecordCount)
+    {
+        ResourceLoadRecord* pRecord = &pStatistics->pRecords[pStatistics->mCompletedRecordCount];
+        if (pRecord->mToken > completedToken)
             break;
-        }
 
-        if (pTextureSet || pShaderSet || pMaterialSet)
-        {
-            offset = nextLineOffset + 1;
+        pRecord->mCompleteTime = time;
+        pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_GPU_COPY] = time - pRecord->mSubmitTime;
+        pStatistics->mReportStats.mTypes[pRecord->mType].mPhaseTime[RESOURCE_LOAD_PHASE_GPU_COPY] +=
+            (uint64_t)pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_GPU_COPY];
+        pStatistics->mStats.mTypes[pRecord->mType].mPhaseTime[RESOURCE_LOAD_PHASE_GPU_COPY] +=
+            (uint64_t)pRecord->mPhaseTime[RESOURCE_LOAD_PHASE_GPU_COPY];
+    }
+    releaseMutex(&pStatistics->mMutex);
+}
 
-            while (materialNextFileLine(pFileBuffer, fileSize, offset, &nextLineOffset))
+static void streamerThreadFunc(void* pThreadData)
+{
+    ResourceLoader* pLoader = (ResourceLoader*)pThreadData;
+    ASSERT(pLoader);
+
+#if defined(GLES)
+    GLContext localContext;
+    if (gPlatformParameters.mSelectedRendererApi == RENDERER_API_GLES)
+    {
+        if (!pLoader->mDesc.mSingleThreaded)
+            initGLContext(pLoader->ppRenderers[0]->mGLES.pConfig, &localContext, pLoader->ppRenderers[0]->mGLES.pContext);
+    }
+#endif
+
+    while (pLoader->mRun)
+    {
+        acquireMutex(&pLoader->mQueueMutex);
+
+        // Check for pending tokens
+        // Safe to use mTokenCounter as we are inside critical section
+        bool allTokensSignaled = (pLoader->mTokenCompleted == tfrg_atomic64_load_relaxed(&pLoader->mTokenCounter));
+
+        while (!areTasksAvailable(pLoader) && allTokensSignaled && pLoader->mRun)
+        {
+            // No waiting if not running dedicated resource loader thread.
+            if (pLoader->mDesc.mSingleThreaded)
             {
-                const char* pLine = pFileBuffer + offset;
-                char        prefix = pLine[0];
+                releaseMutex(&pLoader->mQueueMutex);
+                return;
+            }
+            // Sleep until someone adds an update request to the queue
+            waitConditionVariable(&pLoader->mQueueCond, &pLoader->mQueueMutex, TIMEOUT_INFINITE);
+        }
 
-                if (prefix >= 'A' && prefix <= 'Z')
-                    break;
+        releaseMutex(&pLoader->mQueueMutex);
 
-                switch (prefix)
-                {
-                case 's':
-                {
-                    if (pShaderSet) // Shader that belongs to a ShaderSet
-                    {
-                        ASSERT(pMaterialDesc->mShaderCount < numShaders);
+        for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
+        {
+            CopyEngine* copyEngine = &pLoader->pCopyEngines[nodeIndex];
+            waitCopyEngineSet(pLoader->ppRenderers[nodeIndex], copyEngine);
+            resetCopyEngineSet(pLoader->ppRenderers[nodeIndex], copyEngine);
+            copyEngine->activeSet = (copyEngine->activeSet + 1) % pLoader->mDesc.mBufferCount;
+        }
 
-                        const uint32_t shaderIdx = pMaterialDesc->mShaderCount++;
+        // Signal pending tokens from previous frames
+        SyncToken** pSetTokens = &pLoader->pSetTokens[pLoader->pCopyEngines[0].activeSet];
+        SyncToken   completedToken =
+            updatePendingTokens(pLoader, *pSetTokens, (uint32_t)arrlen(*pSetTokens), PENDING_TOKEN_STATE_COMPLETED);
+        arrsetlen(*pSetTokens, 0);
+        markCompletedLoadRecords(pLoader, completedToken);
+        acquireMutex(&pLoader->mTokenMutex);
+        tfrg_atomic64_store_release(&pLoader->mTokenCompleted, completedToken);
+        releaseMutex(&pLoader->mTokenMutex);
+        wakeAllConditionVariable(&pLoader->mTokenCond);
 
-                        // Parse shader stage
-                        const char stage = pLine[2]; // stage comes after "s "
-                        switch (stage)
-                        {
-                        case 'v':
-                            pShaderSet->mVertIdx = shaderIdx;
-                            break;
-                        case 'f':
-                            pShaderSet->mFragIdx = shaderIdx;
-                            break;
-                        case 'h':
-                            pShaderSet->mHullIdx = shaderIdx;
-                            break;
-                        case 'd':
-                            pShaderSet->mDomainIdx = shaderIdx;
-                            break;
-                        case 'g':
-                            pShaderSet->mGeomIdx = shaderIdx;
-                            break;
-                        case 'c':
-                            pShaderSet->mCompIdx = shaderIdx;
-                            break;
-                        default:
-                            ASSERT(false);
-                            break;
-                        }
+        uint64_t completionMask = 0;
 
-                        uint32_t shaderNameOffset = 4; // Name comes after "s X " where X is the stage
-                        pMaterialDesc->pShaderNames[shaderIdx] = materialParseAndStoreString(pMaterialDesc, pLine, &shaderNameOffset);
-                    }
-                    else if (pMaterialSet) // ShaderSet reference from a MaterialSet
-                    {
-                        ASSERT(pLine[0] == 's' && pLine[1] == ' ' && pLine[2] != ' ');
-                        pMaterialSet->mShaderSetIdx = atoi(pLine + 2); // Skip "s "
-                    }
-                    else
-                        ASSERT(false);
+        for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
+        {
+            CopyEngine* pCopyEngine = &pLoader->pCopyEngines[nodeIndex];
+            Renderer*   pRenderer = pLoader->ppRenderers[nodeIndex];
+
+            // Only process what is queued now, requests queued meanwhile are picked up next iteration.
+            // A request raised to a higher priority is still picked before the lower priority ones in this batch.
+            acquireMutex(&pLoader->mQueueMutex);
+            uint32_t requestCount = 0;
+            for (uint32_t level = 0; level < RESOURCE_LOAD_PRIORITY_LEVEL_COUNT; ++level)
+            {
+                requestCount += getQueuedRequestCount(pLoader, nodeIndex, level);
+            }
+            releaseMutex(&pLoader->mQueueMutex);
 
+            for (uint32_t j = 0; j < requestCount; ++j)
+            {
+                UpdateRequest updateState;
+                acquireMutex(&pLoader->mQueueMutex);
+                bool popped = popQueuedRequest(pLoader, nodeIndex, &updateState);
+                releaseMutex(&pLoader->mQueueMutex);
+                if (!popped)
+                {
                     break;
                 }
-                case 'b':
-                {
-                    ASSERT(pShaderSet);
 
-                    // We store all bindings in the same line
-                    uint32_t parseBindingsOffset = 1;
-                    while (pLine[parseBindingsOffset] == ' ')
-                    {
-                        parseBindingsOffset++;
+                // #NOTE: acquireCmd also resets copy engine on first use
+                Cmd*          cmd = acquireCmd(pCopyEngine);
 
-                        ASSERT(pShaderSet->mTextureBindingCount < pMaterialDesc->mMaxShaderSetBindings);
-                        pShaderSet->pTextureBindingNames[pShaderSet->mTextureBindingCount++] =
-                            materialParseAndStoreString(pMaterialDesc, pLine, &parseBindingsOffset); //-V522
-                    }
+                ResourceLoadRecord record;
+                beginLoadRecord(pCopyEngine, updateState, nodeIndex, &record);
+
+                UploadFunctionResult result = UPLOAD_FUNCTION_RESULT_COMPLETED;
+                switch (updateState.mType)
+                {
+                case UPDATE_REQUEST_TEXTURE_BARRIER:
+                    cmdResourceBarrier(cmd, 0, NULL, 1, &updateState.textureBarrier, 0, NULL);
+                    result = UPLOAD_FUNCTION_RESULT_COMPLETED;
+                    break;
+                case UPDATE_REQUEST_LOAD_BUFFER:
+                    result = loadBuffer(pRenderer, pCopyEngine, updateState);
+                    break;
+                case UPDATE_REQUEST_LOAD_TEXTURE:
+                    result = loadTexture(pRenderer, pCopyEngine, updateState);
+                    tf_free(updateState.texLoadDesc.pCacheKey);
+                    break;
+                case UPDATE_REQUEST_LOAD_GEOMETRY:
+                    result = loadGeometry(pRenderer, pCopyEngine, updateState);
+                    break;
+                case UPDATE_REQUEST_COPY_TEXTURE:
+                    result = copyTexture(pRenderer, pCopyEngine, updateState.texCopyDesc);
+                    break;
+                case UPDATE_REQUEST_LOAD_GEOMETRY_BATCH:
+                    result = loadGeometryBatch(pRenderer, pCopyEngine, updateState);
+                    break;
+                case UPDATE_REQUEST_STREAM_TEXTURE:
+                    result = streamTexture(pRenderer, pCopyEngine, updateState);
+                    break;
+                case UPDATE_REQUEST_LOAD_GEOMETRY_SHADOW:
+                    result = loadGeometryShadow(pCopyEngine, &updateState.geomShadowLoadDesc);
+                    break;
+                case UPDATE_REQUEST_INVALID:
                     break;
                 }
-                case 't':
+
+                endLoadRecord(pLoader, pCopyEngine, &record, result);
+
+                bool completed = result == UPLOAD_FUNCTION_RESULT_COMPLETED || result == UPLOAD_FUNCTION_RESULT_INVALID_REQUEST;
+
+                completionMask |= (uint64_t)completed << nodeIndex;
+
+                if (updateState.mWaitIndex)
                 {
-                    if (pTextureSet) // Parsing a texture that belongs to a TextureSet
-                    {
-                        ASSERT(pMaterialDesc->mTextureCount < numTextures);
+                    arrpush(pLoader->pProcessedTokens, updateState.mWaitIndex);
+                }
 
-                        // Copy the texture name to our buffer in pMaterial
-                        const uint32_t textureIdxInMaterial = pMaterialDesc->mTextureCount++;
+                ASSERT(result != UPLOAD_FUNCTION_RESULT_STAGING_BUFFER_FULL);
+            }
+        }
 
-                        uint32_t textureLineOffset = 2; // Skip "t "
-                        pMaterialDesc->pTextureNames[textureIdxInMaterial] =
-                            materialParseAndStoreString(pMaterialDesc, pLine, &textureLineOffset);
+        if (completionMask != 0)
+        {
+            for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
+            {
+                if (completionMask & ((uint64_t)1 << nodeIndex))
+                {
+                    CopyEngine* copyEngine = &pLoader->pCopyEngines[nodeIndex];
+                    streamerFlush(copyEngine);
+                    acquireMutex(&pLoader->mSemaphoreMutex);
+                    copyEngine->pLastSubmittedSemaphore = copyEngine->resourceSets[copyEngine->activeSet].pSemaphore;
+                    releaseMutex(&pLoader->mSemaphoreMutex);
+                }
+            }
 
-                        // Move to flags
-                        textureLineOffset += 1; // Skip space
-                        const int32_t flags = atoi(pLine + textureLineOffset);
-                        ASSERT(flags < 256);
-                        pMaterialDesc->pTextureFlags[textureIdxInMaterial] = (uint8_t)flags;
+            markSubmittedLoadRecords(pLoader);
+        }
 
-                        // Move to global ID
-                        while (pLine[textureLineOffset++] != ' ')
-                        {
-                        }
-                        pMaterialDesc->pTextureIds[textureIdxInMaterial] = atoi(pLine + textureLineOffset);
+        // Signal submitted tokens
+        submitProcessedTokens(pLoader);
 
-                        ASSERT(pTextureSet->mTextureCount < pMaterialDesc->mMaxTextureSetTextures);
-                        const uint32_t textureIdxInSet = pTextureSet->mTextureCount++;
-                        pTextureSet->pTextureIdxs[textureIdxInSet] = textureIdxInMaterial;
+        if (pResourceLoader->mDesc.mSingleThreaded)
+        {
+            return;
+        }
+    }
 
-                        // materialParseLineTexture(pMaterialDesc, pTextureSet, pLine);
-                    }
-                    else if (pMaterialSet) // TextureSet reference from a MaterialSet
-                    {
-                        ASSERT(pLine[0] == 't' && pLine[1] == ' ' && pLine[2] != ' ');
-                        pMaterialSet->mTextureSetIdx = atoi(pLine + 2); // Skip "t "
-                    }
-                    else
-                        ASSERT(false);
+    for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
+    {
+        streamerFlush(&pLoader->pCopyEngines[nodeIndex]);
+#if defined(DIRECT3D11)
+        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_D3D11;
+#elif defined(GLES)
+        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_GLES;
+#else
+        const bool wait = true;
+#endif
+        if (wait)
+        {
+            waitQueueIdle(pLoader->pCopyEngines[nodeIndex].pQueue);
+        }
 
-                    break;
-                }
-                case '#':
-                    break; // Comment
-                default:
-                    break;
-                }
+        cleanupCopyEngine(pLoader->ppRenderers[nodeIndex], &pLoader->pCopyEngines[nodeIndex]);
+    }
 
-                offset = nextLineOffset + 1;
+#if defined(GLES)
+    if (gPlatformParameters.mSelectedRendererApi == RENDERER_API_GLES)
+    {
+        if (!pResourceLoader->mDesc.mSingleThreaded)
+            removeGLContext(&localContext);
+    }
+#endif
+}
+
+static void CopyEngineFlush(CopyEngine* pCopyEngine)
+{
+    streamerFlush(pCopyEngine);
+    acquireMutex(&pResourceLoader->mSemaphoreMutex);
+    pCopyEngine->pLastSubmittedSemaphore = pCopyEngine->resourceSets[pCopyEngine->activeSet].pSemaphore;
+    releaseMutex(&pResourceLoader->mSemaphoreMutex);
+
+    // Signal submitted tokens
+    submitProcessedTokens(pResourceLoader);
+
+    pCopyEngine->activeSet = (pCopyEngine->activeSet + 1) % pResourceLoader->mDesc.mBufferCount;
+    acquireCmd(pCopyEngine);
+}
+
+#if defined(FORGE_DEBUG) && defined(ENABLE_BUFFER_CHUNK_ALLOCATOR_TEST)
+static bool testBufferChunkAllocator(uint32_t size, uint32_t operationCount, uint32_t seed);
+#endif
+
+static void initResourceLoader(Renderer** ppRenderers, uint32_t rendererCount, ResourceLoaderDesc* pDesc, ResourceLoader** ppLoader)
+{
+    ASSERT(rendererCount > 0);
+    ASSERT(rendererCount <= MAX_MULTIPLE_GPUS);
+
+#if defined(FORGE_DEBUG) && defined(ENABLE_BUFFER_CHUNK_ALLOCATOR_TEST)
+    // CPU only, covers the GeometryBuffer allocators before any geometry relies on them
+    const bool allocatorTestPassed = testBufferChunkAllocator(1024 * 1024, 4096, 0x9E3779B9u);
+    ASSERTMSG(allocatorTestPassed, "BufferChunkAllocator test failed, see the log");
+#endif
+
+    if (!pDesc)
+        pDesc = &gDefaultResourceLoaderDesc;
+
+    ResourceLoader* pLoader = tf_new(ResourceLoader);
+
+    uint32_t gpuCount = rendererCount;
+    if (ppRenderers[0]->mGpuMode != GPU_MODE_UNLINKED)
+    {
+        ASSERT(rendererCount == 1);
+        gpuCount = ppRenderers[0]->mLinkedNodeCount;
+    }
+
+    pLoader->mGpuCount = gpuCount;
+
+    for (uint32_t i = 0; i < gpuCount; ++i)
+    {
+        ASSERT(rendererCount == 1 || ppRenderers[i]->mGpuMode == GPU_MODE_UNLINKED);
+        // Replicate single renderer in linked mode, for uniform handling of linked and unlinked multi gpu.
+        pLoader->ppRenderers[i] = (rendererCount > 1) ? ppRenderers[i] : ppRenderers[0];
+    }
+
+    pLoader->mRun = true; //-V601
+    pLoader->mDesc = *pDesc;
+
+    initMutex(&pLoader->mQueueMutex);
+    initMutex(&pLoader->mTokenMutex);
+    initConditionVariable(&pLoader->mQueueCond);
+    initConditionVariable(&pLoader->mTokenCond);
+    initMutex(&pLoader->mSemaphoreMutex);
+    initMutex(&pLoader->mUploadEngineMutex);
+
+    pLoader->mTokenCounter = 0;
+    pLoader->mTokenCompleted = 0;
+    pLoader->mTokenSubmitted = 0;
+    memset(pLoader->mRequestQueue, 0, sizeof(pLoader->mRequestQueue));
+    memset(pLoader->mRequestQueueHead, 0, sizeof(pLoader->mRequestQueueHead));
+    memset(pLoader->mSkippedCount, 0, sizeof(pLoader->mSkippedCount));
+    memset(pLoader->pSetTokens, 0, sizeof(pLoader->pSetTokens));
+    pLoader->pProcessedTokens = NULL;
+    pLoader->pPendingTokens = NULL;
+
+    pLoader->mStreaming = {};
+    pLoader->mStreaming.mDesc = gDefaultTextureStreamingDesc;
+
+    pLoader->mStatistics = {};
+    initMutex(&pLoader->mStatistics.mMutex);
+
+    pLoader->mTextureCache = {};
+    initMutex(&pLoader->mTextureCache.mMutex);
+
+    pLoader->mGeometryShadows = {};
+    initMutex(&pLoader->mGeometryShadows.mMutex);
+
+    pLoader->mShaderLibrary = {};
+    initMutex(&pLoader->mShaderLibrary.mMutex);
+
+    ThreadSystemInitDesc decompressThreadsDesc = gThreadSystemInitDescDefault;
+    decompressThreadsDesc.threadCount = pLoader->mDesc.mDecompressThreadCount;
+    decompressThreadsDesc.threadName = "ResourceLoaderDecompress";
+    if (!threadSystemInit(&pLoader->mDecompressThreads, &decompressThreadsDesc))
+    {
+        LOGF(eWARNING, "Failed to create %u resource loader decompression threads, decompressing on the loader thread",
+             pLoader->mDesc.mDecompressThreadCount);
+    }
+#if defined(ENABLE_PROFILER)
+    for (uint32_t i = 0; i < RESOURCE_LOAD_TYPE_COUNT; ++i)
+    {
+        char counterName[128] = {};
+        snprintf(counterName, sizeof(counterName), "ResourceLoader/%s/UploadSize", gResourceLoadTypeNames[i]);
+        pLoader->mStatistics.mUploadSizeCounters[i] = ProfileGetCounterToken(counterName);
+        ProfileCounterConfig(counterName, PROFILE_COUNTER_FORMAT_BYTES, 0, PROFILE_COUNTER_FLAG_NONE);
+        snprintf(counterName, sizeof(counterName), "ResourceLoader/%s/Requests", gResourceLoadTypeNames[i]);
+        pLoader->mStatistics.mRequestCounters[i] = ProfileGetCounterToken(counterName);
+    }
+    pLoader->mStatistics.mStagingStallCounter = ProfileGetCounterToken("ResourceLoader/StagingStalls");
+#endif
+
+    for (uint32_t i = 0; i < gpuCount; ++i)
+    {
+        CopyEngineDesc desc = {};
+        desc.mBufferCount = pLoader->mDesc.mBufferCount;
+        desc.mNodeIndex = i;
+        desc.mQueueType = QUEUE_TYPE_GRAPHICS;
+        desc.mSize = pLoader->mDesc.mBufferSize;
+        desc.pQueueName = "UPLOAD";
+        setupCopyEngine(pLoader->ppRenderers[i], &desc, &pLoader->pUploadEngines[i]);
+
+        desc = {};
+        desc.mBufferCount = pLoader->mDesc.mBufferCount;
+        desc.mNodeIndex = i;
+        desc.mQueueType = QUEUE_TYPE_TRANSFER;
+        desc.mSize = pLoader->mDesc.mBufferSize;
+        desc.pQueueName = "COPY";
+        setupCopyEngine(pLoader->ppRenderers[i], &desc, &pLoader->pCopyEngines[i]);
+
+        CopyEngine* copyEngine = &pLoader->pCopyEngines[i];
+        copyEngine->flushOnOverflow = true;
+        copyEngine->pFnFlush = CopyEngineFlush;
+
+#if defined(STRICT_QUEUE_TYPE_BARRIERS)
+        if (StrictQueueTypeBarriers())
+        {
+            for (uint32_t b = 0; b < pDesc->mBufferCount; ++b)
+            {
+                CopyResourceSet& resourceSet = pLoader->pCopyEngines[i].resourceSets[b];
+                CmdPoolDesc      poolDesc = {};
+                poolDesc.pQueue = pLoader->pUploadEngines[i].pQueue;
+                addCmdPool(pLoader->ppRenderers[i], &poolDesc, &resourceSet.pPostCopyBarrierCmdPool);
+                CmdDesc cmdDesc = {};
+                cmdDesc.pPool = resourceSet.pPostCopyBarrierCmdPool;
+#ifdef ENABLE_GRAPHICS_DEBUG
+                static char buffer[MAX_DEBUG_NAME_LENGTH];
+                snprintf(buffer, sizeof(buffer), "Node %u Strict Queue buffer %u Cmd", i, b);
+                cmdDesc.pName = buffer;
+#endif // ENABLE_GRAPHICS_DEBUG
+                addCmd(pLoader->ppRenderers[i], &cmdDesc, &resourceSet.pPostCopyBarrierCmd);
+                addFence(pLoader->ppRenderers[i], &resourceSet.pPostCopyBarrierFence);
             }
         }
-        else
-            offset = nextLineOffset + 1;
+#endif
+    }
+
+    ThreadDesc threadDesc = {};
+    threadDesc.pFunc = streamerThreadFunc;
+    threadDesc.pData = pLoader;
+    strncpy(threadDesc.mThreadName, "ResourceLoaderTask", sizeof(threadDesc.mThreadName));
+
+#if defined(NX64)
+    threadDesc.setAffinityMask = true;
+    threadDesc.affinityMask[0] = 1;
+#endif
+
+#if defined(DIRECT3D11)
+    if (gPlatformParameters.mSelectedRendererApi == RENDERER_API_D3D11)
+        pLoader->mDesc.mSingleThreaded = true;
+#endif
+
+#if defined(ANDROID) && defined(USE_MULTIPLE_RENDER_APIS)
+    gUma = gPlatformParameters.mSelectedRendererApi == RENDERER_API_VULKAN;
+#endif
+
+    // Create dedicated resource loader thread.
+    if (!pLoader->mDesc.mSingleThreaded)
+    {
+        initThread(&threadDesc, &pLoader->mThread);
     }
 
-    ASSERT(pMaterialDesc->mShaderCount == numShaders);
-    ASSERT(pMaterialDesc->mShaderSetCount == numShaderSets);
-    ASSERT(pMaterialDesc->mTextureSetCount == numTextureSets);
-    ASSERT(pMaterialDesc->mStringBufferUsed < pMaterialDesc->mStringBufferSize);
+    *ppLoader = pLoader;
+}
+
+static void exitResourceLoader(ResourceLoader* pLoader)
+{
+    pLoader->mRun = false; //-V601
+
+    if (pLoader->mDesc.mSingleThreaded)
+    {
+        streamerThreadFunc(pLoader);
+    }
+    else
+    {
+        wakeOneConditionVariable(&pLoader->mQueueCond);
+        joinThread(pLoader->mThread);
+    }
+
+    for (uint32_t nodeIndex = 0; nodeIndex < pLoader->mGpuCount; ++nodeIndex)
+    {
+#if defined(DIRECT3D11)
+        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_D3D11;
+#elif defined(GLES)
+        const bool wait = gPlatformParameters.mSelectedRendererApi != RENDERER_API_GLES;
+#else
+        const bool wait = true;
+#endif
+        if (wait)
+        {
+            waitQueueIdle(pLoader->pUploadEngines[nodeIndex].pQueue);
+        }
+
+        Renderer* renderer = pLoader->ppRenderers[nodeIndex];
+        cleanupCopyEngine(renderer, &pLoader->pUploadEngines[nodeIndex]);
+    }
+
+    ASSERT(!arrlen(pLoader->mStreaming.pTextures) && "Streaming textures need to be removed before exiting the resource loader");
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pLoader->mStreaming.pRetiredTextures); ++i)
+    {
+        Texture* pTexture = pLoader->mStreaming.pRetiredTextures[i].pTexture;
+        removeTexture(pLoader->ppRenderers[pTexture->mNodeIndex], pTexture);
+    }
+    arrfree(pLoader->mStreaming.pTextures);
+    arrfree(pLoader->mStreaming.pRetiredTextures);
+    arrfree(pLoader->mStreaming.pUpdates);
+    arrfree(pLoader->mStatistics.pRecords);
+    destroyMutex(&pLoader->mStatistics.mMutex);
+
+    ASSERT(!hmlen(pLoader->mTextureCache.pTextureMap) && "Cached textures need to be removed before exiting the resource loader");
+    shfree(pLoader->mTextureCache.pPathMap);
+    hmfree(pLoader->mTextureCache.pContentMap);
+    hmfree(pLoader->mTextureCache.pTextureMap);
+    destroyMutex(&pLoader->mTextureCache.mMutex);
+
+    ASSERT(!pLoader->mGeometryShadows.mGeometryCount && "Deferred shadow geometries need to be removed before exiting the resource loader");
+    arrfree(pLoader->mGeometryShadows.ppResident);
+    destroyMutex(&pLoader->mGeometryShadows.mMutex);
+
+    if (pLoader->mShaderLibrary.pData)
+    {
+        fsCloseStream(&pLoader->mShaderLibrary.mStream);
+    }
+    destroyMutex(&pLoader->mShaderLibrary.mMutex);
+
+    threadSystemExit(&pLoader->mDecompressThreads, &gThreadSystemExitDescDefault);
+
+    for (uint32_t nodeIndex = 0; nodeIndex < MAX_MULTIPLE_GPUS; ++nodeIndex)
+    {
+        for (uint32_t level = 0; level < RESOURCE_LOAD_PRIORITY_LEVEL_COUNT; ++level)
+        {
+            arrfree(pLoader->mRequestQueue[nodeIndex][level]);
+        }
+    }
+    for (uint32_t i = 0; i < MAX_FRAMES; ++i)
+    {
+        arrfree(pLoader->pSetTokens[i]);
+    }
+    arrfree(pLoader->pProcessedTokens);
+    arrfree(pLoader->pPendingTokens);
+
+    destroyConditionVariable(&pLoader->mQueueCond);
+    destroyConditionVariable(&pLoader->mTokenCond);
+    destroyMutex(&pLoader->mQueueMutex);
+    destroyMutex(&pLoader->mTokenMutex);
+    destroyMutex(&pLoader->mSemaphoreMutex);
+    destroyMutex(&pLoader->mUploadEngineMutex);
+
+    tf_delete(pLoader);
+}
+
+static void queueRequest(ResourceLoader* pLoader, uint32_t nodeIndex, const UpdateRequest& request, ResourceLoadPriority priority,
+                         SyncToken* token)
+{
+    const uint32_t level = getPriorityLevel(priority);
+    acquireMutex(&pLoader->mQueueMutex);
+
+    SyncToken t = tfrg_atomic64_add_relaxed(&pLoader->mTokenCounter, 1) + 1;
+
+    arrpush(pLoader->mRequestQueue[nodeIndex][level], request);
+    UpdateRequest* pLastRequest = arrback(pLoader->mRequestQueue[nodeIndex][level]);
+    if (pLastRequest)
+    {
+        pLastRequest->mWaitIndex = t;
+        pLastRequest->mQueueTime = getUSec(false);
+    }
+
+    // Tokens are generated inside the critical section so the array stays sorted
+    PendingToken pending = { t, level, PENDING_TOKEN_STATE_QUEUED };
+    arrpush(pLoader->pPendingTokens, pending);
+
+    releaseMutex(&pLoader->mQueueMutex);
+    wakeOneConditionVariable(&pLoader->mQueueCond);
+    if (token)
+        *token = max(t, *token);
+
+    if (pResourceLoader->mDesc.mSingleThreaded)
+    {
+        streamerThreadFunc(pResourceLoader);
+    }
+}
+
+static void queueBufferLoad(ResourceLoader* pLoader, BufferLoadDescInternal* pBufferLoad, ResourceLoadPriority priority, SyncToken* token)
+{
+    queueRequest(pLoader, pBufferLoad->pBuffer->mNodeIndex, UpdateRequest(*pBufferLoad), priority, token);
+}
+
+static void queueTextureLoad(ResourceLoader* pLoader, TextureLoadDescInternal* pTextureLoad, ResourceLoadPriority priority,
+                             SyncToken* token)
+{
+    queueRequest(pLoader, pTextureLoad->mNodeIndex, UpdateRequest(*pTextureLoad), priority, token);
+}
+
+static void queueGeometryLoad(ResourceLoader* pLoader, GeometryLoadDesc* pGeometryLoad, SyncToken* token)
+{
+    queueRequest(pLoader, pGeometryLoad->mNodeIndex, UpdateRequest(*pGeometryLoad), pGeometryLoad->mPriority, token);
+}
+
+static void queueGeometryBatchLoad(ResourceLoader* pLoader, GeometryBatchLoadDesc* pBatchLoad, SyncToken* token)
+{
+    queueRequest(pLoader, pBatchLoad->mNodeIndex, UpdateRequest(*pBatchLoad), pBatchLoad->mPriority, token);
+}
+
+static void queueGeometryShadowLoad(ResourceLoader* pLoader, GeometryShadowLoadDesc* pShadowLoad, SyncToken* token)
+{
+    // CPU only request, processed by the first node
+    queueRequest(pLoader, 0, UpdateRequest(*pShadowLoad), pShadowLoad->mPriority, token);
+}
+
+static void queueTextureStream(ResourceLoader* pLoader, TextureStreamDescInternal* pTextureStream, ResourceLoadPriority priority,
+                               SyncToken* token)
+{
+    queueRequest(pLoader, pTextureStream->mNodeIndex, UpdateRequest(*pTextureStream), priority, token);
+}
+
+static void queueTextureBarrier(ResourceLoader* pLoader, Texture* pTexture, ResourceState state, SyncToken* token)
+{
+    queueRequest(pLoader, pTexture->mNodeIndex, UpdateRequest(TextureBarrier{ pTexture, RESOURCE_STATE_UNDEFINED, state }),
+                 RESOURCE_LOAD_PRIORITY_NORMAL, token);
+}
+
+static void queueTextureCopy(ResourceLoader* pLoader, TextureCopyDesc* pTextureCopy, SyncToken* token)
+{
+    ASSERT(pTextureCopy->pTexture->mNodeIndex == pTextureCopy->pBuffer->mNodeIndex);
+    queueRequest(pLoader, pTextureCopy->pTexture->mNodeIndex, UpdateRequest(*pTextureCopy), RESOURCE_LOAD_PRIORITY_NORMAL, token);
+}
+
+static void waitForToken(ResourceLoader* pLoader, const SyncToken* token)
+{
+    if (pLoader->mDesc.mSingleThreaded)
+    {
+        return;
+    }
+    acquireMutex(&pLoader->mTokenMutex);
+    while (!isTokenCompleted(token))
+    {
+        waitConditionVariable(&pLoader->mTokenCond, &pLoader->mTokenMutex, TIMEOUT_INFINITE);
+    }
+    releaseMutex(&pLoader->mTokenMutex);
+}
+
+static void waitForTokenSubmitted(ResourceLoader* pLoader, const SyncToken* token)
+{
+    if (pLoader->mDesc.mSingleThreaded)
+    {
+        return;
+    }
+    acquireMutex(&pLoader->mTokenMutex);
+    while (!isTokenSubmitted(token))
+    {
+        waitConditionVariable(&pLoader->mTokenCond, &pLoader->mTokenMutex, TIMEOUT_INFINITE);
+    }
+    releaseMutex(&pLoader->mTokenMutex);
+}
+
+/************************************************************************/
+// Resource Loader Interface Implementation
+/************************************************************************/
+void initResourceLoaderInterface(Renderer* pRenderer, ResourceLoaderDesc* pDesc)
+{
+    initResourceLoader(&pRenderer, 1, pDesc, &pResourceLoader);
+
+#ifdef ENABLE_FORGE_MATERIALS
+    if (pDesc && pDesc->mUseMaterials)
+    {
+        uint32_t maxShaders = 0;
+        uint32_t maxTextures = 0;
+
+        {
+            // During material compilation we generate an ini file with data to initialize the material library
+            FileStream stream = {};
+            if (fsOpenStreamFromPath(RD_COMPILED_MATERIALS, "material_lib.ini", FM_READ, &stream))
+            {
+                char buffer[256] = {};
+                ASSERT((uint64_t)fsGetStreamFileSize(&stream) <= sizeof(buffer));
+                fsReadFromStream(&stream, buffer, sizeof(buffer));
+                sscanf(buffer, "%u %u", &maxShaders, &maxTextures);
+
+                fsCloseStream(&stream);
+            }
+            else
+            {
+                ASSERT(false);
+                return;
+            }
+        }
+
+        uint32_t totalSize = sizeof(MaterialLibrary);
+        totalSize += (sizeof(Shader**) + sizeof(uint16_t)) * maxShaders + alignof(Shader**); // Shaders
+        totalSize += (sizeof(Texture**) + sizeof(uint16_t)) * maxTextures;                   // Textures
+        totalSize += sizeof(uint16_t) * maxShaders;                                          // pMaterialShaderRefCount
+        totalSize += sizeof(uint16_t) * maxTextures;                                         // pMaterialTextureRefCount
+
+        pMaterialLibrary = (MaterialLibrary*)tf_calloc(1, totalSize);
+        MaterialLibrary* pLib = pMaterialLibrary;
+        pLib->pRenderer = pRenderer;
+        pLib->ppMaterialShaders = (Shader**)alignMemory(pLib + 1, alignof(Shader**));
+        pLib->ppMaterialTextures = (Texture**)(pLib->ppMaterialShaders + maxShaders); //-V1027 // Memory already aligned to pointer
+        pLib->pMaterialShaderRefCount = (uint16_t*)(pLib->ppMaterialTextures + maxTextures);
+        pLib->pMaterialTextureRefCount = (uint16_t*)(pLib->pMaterialShaderRefCount + maxShaders);
+        pLib->mMaxMaterialShaders = maxShaders;
+        pLib->mMaxMaterialTextures = maxTextures;
+        ASSERT((char*)(pLib->pMaterialTextureRefCount + maxTextures) <= ((char*)pLib) + totalSize);
+    }
+#endif
+
+#if defined(ENABLE_FORGE_RELOAD_SHADER)
+    if (!platformInitReloadClient())
+    {
+        LOGF(eERROR, "Failed to initialize ReloadServer");
+#ifdef AUTOMATED_TESTING
+        ASSERT(false);
+#endif
+    }
+#else
+    LOGF(eWARNING, "ReloadServer is DISABLED. Shaders will not be updated dynamically on the device "
+                   "when they are recompiled while App is running. If this behaviour is desired then you can ignore this warning. "
+                   "If you want to re-enable ReloadServer you need to #define ENABLE_FORGE_RELOAD_SHADER in Application/Config.h"
+                   "This message is here to remind everyone to re-enable ReloadServer if it has been disabled for whatever reason.");
+#endif
+}
+
+void exitResourceLoaderInterface(Renderer* pRenderer)
+{
+    UNREF_PARAM(pRenderer);
+#ifdef ENABLE_FORGE_MATERIALS
+    if (pMaterialLibrary)
+    {
+        MaterialLibrary* pLib = pMaterialLibrary;
+        ASSERT(pLib->mLoadedMaterialCount == 0);
+
+#if defined(FORGE_DEBUG)
+        for (uint32_t i = 0; i < pLib->mMaxMaterialShaders; ++i)
+        {
+            ASSERT(pLib->ppMaterialShaders[i] == NULL);
+            ASSERT(pLib->pMaterialShaderRefCount[i] == 0);
+        }
+        for (uint32_t i = 0; i < pLib->mMaxMaterialTextures; ++i)
+        {
+            ASSERT(pLib->ppMaterialTextures[i] == NULL);
+            ASSERT(pLib->pMaterialTextureRefCount[i] == 0);
+        }
+#endif
+        tf_free(pMaterialLibrary);
+        pMaterialLibrary = NULL;
+    }
+#endif
+
+    exitResourceLoader(pResourceLoader);
+
+#if defined(ENABLE_FORGE_RELOAD_SHADER)
+    platformExitReloadClient();
+#endif
+}
+
+void initResourceLoaderInterface(Renderer** ppRenderers, uint32_t rendererCount, ResourceLoaderDesc* pDesc)
+{
+    initResourceLoader(ppRenderers, rendererCount, pDesc, &pResourceLoader);
+}
+
+void exitResourceLoaderInterface(Renderer** pRenderers, uint32_t rendererCount)
+{
+    UNREF_PARAM(pRenderers);
+    UNREF_PARAM(rendererCount);
+    exitResourceLoader(pResourceLoader);
+}
+
+#ifdef ENABLE_FORGE_MATERIALS
+// Allocates a Material and its MaterialDesc arrays in a single allocation
+static Material* allocMaterial(uint32_t numShaderSets, uint32_t numTextureSets, uint32_t numMaterialSets, uint32_t numShaders,
+                               uint32_t numTextures, uint32_t maxShaderSetBindings, uint32_t maxTextureSetTextures, uint64_t stringBufferSize)
+{
+    uint64_t extraSize = 0;
+    extraSize += sizeof(Material::LoadedMaterial) * numMaterialSets + alignof(Material::LoadedMaterial); // Material::pLoaded
+    extraSize += sizeof(uint32_t) * numMaterialSets * maxTextureSetTextures; // Material::LoadedMaterial::pTextureIndexes;
+    extraSize += sizeof(MaterialDesc::ShaderSet) * numShaderSets + alignof(MaterialDesc::ShaderSet); // MaterialDesc::pShaderSets
+    extraSize +=
+        sizeof(const char*) * numShaderSets * maxShaderSetBindings + alignof(void*); // MaterialDesc::ShaderSet::pTextureBindingNames
+    extraSize += sizeof(MaterialDesc::TextureSet) * numTextureSets + alignof(MaterialDesc::TextureSet); // MaterialDesc::pTextureSets
+    extraSize += sizeof(uint32_t) * numTextureSets * maxTextureSetTextures; // MaterialDesc::TextureSet::pTextureIdxs
+    extraSize += sizeof(MaterialDesc::MaterialSet) * numMaterialSets + alignof(MaterialDesc::MaterialSet); // MaterialDesc::pMaterialSets
+    extraSize += sizeof(uint32_t) * numTextures;                                                           // MaterialDesc::pTextureIds
+    extraSize += sizeof(*MaterialDesc::pTextureFlags) * numTextures;                                       // MaterialDesc::pTextureFlags;
+    extraSize += alignof(void*);                        // Alignment for the pointers below
+    extraSize += sizeof(const char*) * numMaterialSets; // MaterialDesc::pMaterialSetNames
+    extraSize += sizeof(const char*) * numTextures;     // MaterialDesc::pTextureNames
+    extraSize += sizeof(const char*) * numShaders;      // MaterialDesc::pShaderNames
+
+    extraSize += stringBufferSize;
+
+    const uint64_t totalSize = sizeof(Material) + sizeof(MaterialDesc) + alignof(MaterialDesc) + extraSize;
+    Material*      pMaterial = (Material*)tf_calloc(1, totalSize);
+    pMaterial->pLoaded = (Material::LoadedMaterial*)alignMemory(pMaterial + 1, alignof(Material::LoadedMaterial));
+    for (uint32_t i = 0; i < numMaterialSets; ++i)
+    {
+        pMaterial->pLoaded[i].pTextureIndexes = (uint32_t*)(pMaterial->pLoaded + numMaterialSets) + i * maxTextureSetTextures;
+    }
+    MaterialDesc* pMaterialDesc =
+        (MaterialDesc*)alignMemory(pMaterial->pLoaded[numMaterialSets - 1].pTextureIndexes + maxTextureSetTextures, alignof(MaterialDesc));
+    pMaterial->pDesc = pMaterialDesc;
+    pMaterialDesc->pShaderSets = (MaterialDesc::ShaderSet*)alignMemory(pMaterialDesc + 1, alignof(MaterialDesc::ShaderSet));
+    for (uint32_t i = 0; i < numShaderSets; ++i)
+    {
+        pMaterialDesc->pShaderSets[i].pTextureBindingNames =
+            (const char**)alignMemory((pMaterialDesc->pShaderSets + numShaderSets) + i * maxShaderSetBindings, alignof(void*));
+    }
+    pMaterialDesc->pTextureSets = (MaterialDesc::TextureSet*)alignMemory(
+        pMaterialDesc->pShaderSets[numShaderSets - 1].pTextureBindingNames + maxShaderSetBindings, alignof(MaterialDesc::TextureSet));
+    for (uint32_t i = 0; i < numTextureSets; ++i)
+    {
+        pMaterialDesc->pTextureSets[i].pTextureIdxs = (uint32_t*)(pMaterialDesc->pTextureSets + numTextureSets) + i * maxTextureSetTextures;
+    }
+    pMaterialDesc->pMaterialSets = (MaterialDesc::MaterialSet*)alignMemory(
+        pMaterialDesc->pTextureSets[numTextureSets - 1].pTextureIdxs + maxTextureSetTextures, alignof(MaterialDesc::MaterialSet));
+    pMaterialDesc->pTextureIds = (uint32_t*)(pMaterialDesc->pMaterialSets + numMaterialSets);
+    pMaterialDesc->pTextureFlags = (uint8_t*)(pMaterialDesc->pTextureIds + numTextures);
+    pMaterialDesc->pMaterialSetNames = (const char**)alignMemory(pMaterialDesc->pTextureFlags + numTextures, alignof(void*));
+    pMaterialDesc->pTextureNames = (const char**)pMaterialDesc->pMaterialSetNames + numMaterialSets;
+    pMaterialDesc->pShaderNames = (const char**)(pMaterialDesc->pTextureNames + numTextures);
+    pMaterialDesc->pStringBuffer = (char*)(pMaterialDesc->pShaderNames + numShaders);
+    pMaterialDesc->mStringBufferSize = (uint32_t)stringBufferSize;
+    ASSERT(pMaterialDesc->pStringBuffer + stringBufferSize <= ((const char*)pMaterial) + totalSize);
+
+    pMaterialDesc->mMaxShaderSetBindings = maxShaderSetBindings;
+    pMaterialDesc->mMaxTextureSetTextures = maxTextureSetTextures;
+
+    return pMaterial;
+}
+
+static void parseMaterial(const char* pFileBuffer, uint64_t fileSize, Material** pOut)
+{
+    ASSERT(pOut);
+
+    uint64_t offset = 0;
+    uint64_t nextLineOffset = 0;
+
+    const bool bCompiled = strncmp(pFileBuffer, ":FMC", 4) == 0;
+    if (!bCompiled)
+    {
+        ASSERT(false && "This file doesn't contain a compiled material");
+        return;
+    }
+
+    offset = 4; // Skip ":FMC"
+
+    // Values from material compilation
+    uint32_t precomputedValues[7] = {};
+
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(precomputedValues); ++i)
+    {
+        while (pFileBuffer[offset] == ' ')
+        {
+            offset++;
+        }
+
+        precomputedValues[i] = atoi(pFileBuffer + offset);
+
+        while (pFileBuffer[offset] != '\n' && pFileBuffer[offset] != ' ')
+        {
+            offset++;
+        }
+    }
+    while (pFileBuffer[offset++] != '\n')
+    {
+    }
+
+    const uint32_t numShaderSets = precomputedValues[0];
+    const uint32_t numTextureSets = precomputedValues[1];
+    const uint32_t numMaterialSets = precomputedValues[2];
+    const uint32_t numShaders = precomputedValues[3];
+    const uint32_t numTextures = precomputedValues[4];
+    const uint32_t maxShaderSetBindings = precomputedValues[5];
+    const uint32_t maxTextureSetTextures = precomputedValues[6];
+
+    // Note: We use file size for the string buffer size as it won't be bigger than that.
+    //       We could also compute a tighter buffer size during material compilation.
+    Material*     pMaterial = allocMaterial(numShaderSets, numTextureSets, numMaterialSets, numShaders, numTextures, maxShaderSetBindings,
+                                            maxTextureSetTextures, fileSize);
+    MaterialDesc* pMaterialDesc = pMaterial->pDesc;
+
+    // Parse material file
+    while (materialNextFileLine(pFileBuffer, fileSize, offset, &nextLineOffset))
+    {
+        MaterialDesc::TextureSet*  pTextureSet = NULL;
+        MaterialDesc::ShaderSet*   pShaderSet = NULL;
+        MaterialDesc::MaterialSet* pMaterialSet = NULL;
+
+        const char* pSetLine = pFileBuffer + offset;
+        switch (pSetLine[0])
+        {
+        case 'S':
+        {
+            pShaderSet = pMaterialDesc->pShaderSets + pMaterialDesc->mShaderSetCount;
+            pShaderSet->mVertIdx = INVALID_MATERIAL_ID;
+            pShaderSet->mFragIdx = INVALID_MATERIAL_ID;
+            pShaderSet->mHullIdx = INVALID_MATERIAL_ID;
+            pShaderSet->mDomainIdx = INVALID_MATERIAL_ID;
+            pShaderSet->mGeomIdx = INVALID_MATERIAL_ID;
+            pShaderSet->mCompIdx = INVALID_MATERIAL_ID;
+
+            ASSERT(pSetLine[0] == 'S' && pSetLine[1] == ' ' && pSetLine[2] != ' ');
+            pShaderSet->mId = atoi(pSetLine + 2);
+
+            ASSERT(pMaterialDesc->mShaderSetCount < numShaderSets);
+            pMaterialDesc->mShaderSetCount++;
+            break;
+        }
+        case 'T':
+        {
+            pTextureSet = pMaterialDesc->pTextureSets + pMaterialDesc->mTextureSetCount;
+            pTextureSet->pTextureIdxs[0] = INVALID_MATERIAL_ID;
+
+            ASSERT(pMaterialDesc->mTextureSetCount < numTextureSets);
+            pMaterialDesc->mTextureSetCount++;
+            break;
+        }
+        case 'M':
+        {
+            pMaterialSet = pMaterialDesc->pMaterialSets + pMaterialDesc->mMaterialCount;
+            pMaterialSet->mShaderSetIdx = INVALID_MATERIAL_ID;
+            pMaterialSet->mTextureSetIdx = INVALID_MATERIAL_ID;
+
+            uint32_t offset32 = 0;
+            pMaterialDesc->pMaterialSetNames[pMaterialDesc->mMaterialCount] =
+                materialParseAndStoreString(pMaterialDesc, pSetLine + 2, &offset32);
+
+            ASSERT(pMaterialDesc->mMaterialCount < numMaterialSets);
+            pMaterialDesc->mMaterialCount++;
+            break;
+        }
+        case '#': // Comment
+        default:
+            break;
+        }
+
+        if (pTextureSet || pShaderSet || pMaterialSet)
+        {
+            offset = nextLineOffset + 1;
+
+            while (materialNextFileLine(pFileBuffer, fileSize, offset, &nextLineOffset))
+            {
+                const char* pLine = pFileBuffer + offset;
+                char        prefix = pLine[0];
+
+                if (prefix >= 'A' && prefix <= 'Z')
+                    break;
+
+                switch (prefix)
+                {
+                case 's':
+                {
+                    if (pShaderSet) // Shader that belongs to a ShaderSet
+                    {
+                        ASSERT(pMaterialDesc->mShaderCount < numShaders);
+
+                        const uint32_t shaderIdx = pMaterialDesc->mShaderCount++;
+
+                        // Parse shader stage
+                        const char stage = pLine[2]; // stage comes after "s "
+                        switch (stage)
+                        {
+                        case 'v':
+                            pShaderSet->mVertIdx = shaderIdx;
+                            break;
+                        case 'f':
+                            pShaderSet->mFragIdx = shaderIdx;
+                            break;
+                        case 'h':
+                            pShaderSet->mHullIdx = shaderIdx;
+                            break;
+                        case 'd':
+                            pShaderSet->mDomainIdx = shaderIdx;
+                            break;
+                        case 'g':
+                            pShaderSet->mGeomIdx = shaderIdx;
+                            break;
+                        case 'c':
+                            pShaderSet->mCompIdx = shaderIdx;
+                            break;
+                        default:
+                            ASSERT(false);
+                            break;
+                        }
+
+                        uint32_t shaderNameOffset = 4; // Name comes after "s X " where X is the stage
+                        pMaterialDesc->pShaderNames[shaderIdx] = materialParseAndStoreString(pMaterialDesc, pLine, &shaderNameOffset);
+                    }
+                    else if (pMaterialSet) // ShaderSet reference from a MaterialSet
+                    {
+                        ASSERT(pLine[0] == 's' && pLine[1] == ' ' && pLine[2] != ' ');
+                        pMaterialSet->mShaderSetIdx = atoi(pLine + 2); // Skip "s "
+                    }
+                    else
+                        ASSERT(false);
+
+                    break;
+                }
+                case 'b':
+                {
+                    ASSERT(pShaderSet);
+
+                    // We store all bindings in the same line
+                    uint32_t parseBindingsOffset = 1;
+                    while (pLine[parseBindingsOffset] == ' ')
+                    {
+                        parseBindingsOffset++;
+
+                        ASSERT(pShaderSet->mTextureBindingCount < pMaterialDesc->mMaxShaderSetBindings);
+                        pShaderSet->pTextureBindingNames[pShaderSet->mTextureBindingCount++] =
+                            materialParseAndStoreString(pMaterialDesc, pLine, &parseBindingsOffset); //-V522
+                    }
+                    break;
+                }
+                case 't':
+                {
+                    if (pTextureSet) // Parsing a texture that belongs to a TextureSet
+                    {
+                        ASSERT(pMaterialDesc->mTextureCount < numTextures);
+
+                        // Copy the texture name to our buffer in pMaterial
+                        const uint32_t textureIdxInMaterial = pMaterialDesc->mTextureCount++;
+
+                        uint32_t textureLineOffset = 2; // Skip "t "
+                        pMaterialDesc->pTextureNames[textureIdxInMaterial] =
+                            materialParseAndStoreString(pMaterialDesc, pLine, &textureLineOffset);
+
+                        // Move to flags
+                        textureLineOffset += 1; // Skip space
+                        const int32_t flags = atoi(pLine + textureLineOffset);
+                        ASSERT(flags < 256);
+                        pMaterialDesc->pTextureFlags[textureIdxInMaterial] = (uint8_t)flags;
+
+                        // Move to global ID
+                        while (pLine[textureLineOffset++] != ' ')
+                        {
+                        }
+                        pMaterialDesc->pTextureIds[textureIdxInMaterial] = atoi(pLine + textureLineOffset);
+
+                        ASSERT(pTextureSet->mTextureCount < pMaterialDesc->mMaxTextureSetTextures);
+                        const uint32_t textureIdxInSet = pTextureSet->mTextureCount++;
+                        pTextureSet->pTextureIdxs[textureIdxInSet] = textureIdxInMaterial;
+
+                        // materialParseLineTexture(pMaterialDesc, pTextureSet, pLine);
+                    }
+                    else if (pMaterialSet) // TextureSet reference from a MaterialSet
+                    {
+                        ASSERT(pLine[0] == 't' && pLine[1] == ' ' && pLine[2] != ' ');
+                        pMaterialSet->mTextureSetIdx = atoi(pLine + 2); // Skip "t "
+                    }
+                    else
+                        ASSERT(false);
+
+                    break;
+                }
+                case '#':
+                    break; // Comment
+                default:
+                    break;
+                }
+
+                offset = nextLineOffset + 1;
+            }
+        }
+        else
+            offset = nextLineOffset + 1;
+    }
+
+    ASSERT(pMaterialDesc->mShaderCount == numShaders);
+    ASSERT(pMaterialDesc->mShaderSetCount == numShaderSets);
+    ASSERT(pMaterialDesc->mTextureSetCount == numTextureSets);
+    ASSERT(pMaterialDesc->mStringBufferUsed < pMaterialDesc->mStringBufferSize);
+
+    *pOut = pMaterial;
+}
+
+// Builds the material from the fixed layout records of a binary compiled material, only the string table is copied
+static bool parseBinaryMaterial(const uint8_t* pData, uint64_t size, Material** pOut)
+{
+    ASSERT(pOut);
+    *pOut = NULL;
+
+    FMBHeader header = {};
+    if (size < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, pData, sizeof(header));
+
+    const uint64_t shaderSetsOffset = sizeof(FMBHeader);
+    const uint64_t textureSetsOffset = shaderSetsOffset + sizeof(FMBShaderSet) * (uint64_t)header.mShaderSetCount;
+    const uint64_t texturesOffset = textureSetsOffset + sizeof(FMBTextureSet) * (uint64_t)header.mTextureSetCount;
+    const uint64_t materialSetsOffset = texturesOffset + sizeof(FMBTexture) * (uint64_t)header.mTextureCount;
+    const uint64_t shaderNamesOffset = materialSetsOffset + sizeof(FMBMaterialSet) * (uint64_t)header.mMaterialSetCount;
+    const uint64_t bindingNamesOffset = shaderNamesOffset + sizeof(uint32_t) * (uint64_t)header.mShaderCount;
+    const uint64_t stringsOffset = bindingNamesOffset + sizeof(uint32_t) * (uint64_t)header.mBindingCount;
+
+    if (strncmp("@FMB", header.mMagic, 4) != 0 || header.mVersion != FMB_VERSION || stringsOffset + header.mStringsSize > size ||
+        !header.mShaderSetCount || !header.mTextureSetCount || !header.mMaterialSetCount || !header.mStringsSize ||
+        pData[stringsOffset + header.mStringsSize - 1] != '\0')
+    {
+        return false;
+    }
+
+    const FMBShaderSet*   pShaderSets = (const FMBShaderSet*)(pData + shaderSetsOffset);
+    const FMBTextureSet*  pTextureSets = (const FMBTextureSet*)(pData + textureSetsOffset);
+    const FMBTexture*     pTextures = (const FMBTexture*)(pData + texturesOffset);
+    const FMBMaterialSet* pMaterialSets = (const FMBMaterialSet*)(pData + materialSetsOffset);
+    const uint32_t*       pShaderNameOffsets = (const uint32_t*)(pData + shaderNamesOffset);
+    const uint32_t*       pBindingNameOffsets = (const uint32_t*)(pData + bindingNamesOffset);
+
+    Material*     pMaterial = allocMaterial(header.mShaderSetCount, header.mTextureSetCount, header.mMaterialSetCount, header.mShaderCount,
+                                            header.mTextureCount, header.mMaxShaderSetBindings, header.mMaxTextureSetTextures,
+                                            header.mStringsSize);
+    MaterialDesc* pMaterialDesc = pMaterial->pDesc;
+    memcpy(pMaterialDesc->pStringBuffer, pData + stringsOffset, header.mStringsSize);
+    pMaterialDesc->mStringBufferUsed = header.mStringsSize;
+
+    bool valid = true;
+#define FMB_STRING(offset) (valid &= (offset) < header.mStringsSize, pMaterialDesc->pStringBuffer + ((offset) < header.mStringsSize ? (offset) : 0))
+
+    pMaterialDesc->mShaderCount = header.mShaderCount;
+    for (uint32_t i = 0; i < header.mShaderCount; ++i)
+    {
+        pMaterialDesc->pShaderNames[i] = FMB_STRING(pShaderNameOffsets[i]);
+    }
+
+    pMaterialDesc->mShaderSetCount = header.mShaderSetCount;
+    for (uint32_t i = 0; i < header.mShaderSetCount && valid; ++i)
+    {
+        const FMBShaderSet*      pSrc = &pShaderSets[i];
+        MaterialDesc::ShaderSet* pShaderSet = &pMaterialDesc->pShaderSets[i];
+        valid &= pSrc->mBindingCount <= header.mMaxShaderSetBindings && (uint64_t)pSrc->mFirstBinding + pSrc->mBindingCount <= header.mBindingCount;
+        for (uint32_t stage = 0; stage < TF_ARRAY_COUNT(pSrc->mShaderIdx); ++stage)
+        {
+            valid &= pSrc->mShaderIdx[stage] == INVALID_MATERIAL_ID || pSrc->mShaderIdx[stage] < header.mShaderCount;
+        }
+        if (!valid)
+        {
+            break;
+        }
+
+        pShaderSet->mId = pSrc->mId;
+        pShaderSet->mVertIdx = pSrc->mShaderIdx[0];
+        pShaderSet->mFragIdx = pSrc->mShaderIdx[1];
+        pShaderSet->mHullIdx = pSrc->mShaderIdx[2];
+        pShaderSet->mDomainIdx = pSrc->mShaderIdx[3];
+        pShaderSet->mGeomIdx = pSrc->mShaderIdx[4];
+        pShaderSet->mCompIdx = pSrc->mShaderIdx[5];
+        pShaderSet->mTextureBindingCount = pSrc->mBindingCount;
+        for (uint32_t j = 0; j < pSrc->mBindingCount; ++j)
+        {
+            pShaderSet->pTextureBindingNames[j] = FMB_STRING(pBindingNameOffsets[pSrc->mFirstBinding + j]);
+        }
+    }
+
+    pMaterialDesc->mTextureCount = header.mTextureCount;
+    for (uint32_t i = 0; i < header.mTextureCount; ++i)
+    {
+        valid &= pTextures[i].mFlags < 256;
+        pMaterialDesc->pTextureNames[i] = FMB_STRING(pTextures[i].mNameOffset);
+        pMaterialDesc->pTextureFlags[i] = (uint8_t)pTextures[i].mFlags;
+        pMaterialDesc->pTextureIds[i] = pTextures[i].mId;
+    }
+
+    pMaterialDesc->mTextureSetCount = header.mTextureSetCount;
+    for (uint32_t i = 0; i < header.mTextureSetCount && valid; ++i)
+    {
+        const FMBTextureSet*      pSrc = &pTextureSets[i];
+        MaterialDesc::TextureSet* pTextureSet = &pMaterialDesc->pTextureSets[i];
+        valid &= pSrc->mTextureCount <= header.mMaxTextureSetTextures && (uint64_t)pSrc->mFirstTexture + pSrc->mTextureCount <= header.mTextureCount;
+        if (!valid)
+        {
+            break;
+        }
+
+        if (header.mMaxTextureSetTextures)
+        {
+            pTextureSet->pTextureIdxs[0] = INVALID_MATERIAL_ID;
+        }
+        pTextureSet->mTextureCount = pSrc->mTextureCount;
+        for (uint32_t j = 0; j < pSrc->mTextureCount; ++j)
+        {
+            pTextureSet->pTextureIdxs[j] = pSrc->mFirstTexture + j;
+        }
+    }
+
+    pMaterialDesc->mMaterialCount = header.mMaterialSetCount;
+    for (uint32_t i = 0; i < header.mMaterialSetCount && valid; ++i)
+    {
+        const FMBMaterialSet* pSrc = &pMaterialSets[i];
+        valid &= pSrc->mShaderSetIdx < header.mShaderSetCount && pSrc->mTextureSetIdx < header.mTextureSetCount;
+        pMaterialDesc->pMaterialSetNames[i] = FMB_STRING(pSrc->mNameOffset);
+        pMaterialDesc->pMaterialSets[i].mShaderSetIdx = pSrc->mShaderSetIdx;
+        pMaterialDesc->pMaterialSets[i].mTextureSetIdx = pSrc->mTextureSetIdx;
+    }
+#undef FMB_STRING
+
+    if (!valid)
+    {
+        tf_free(pMaterial);
+        return false;
+    }
+
+    *pOut = pMaterial;
+    return true;
+}
+
+uint32_t addMaterial(const char* pMaterialFileName, Material** pOutMaterial, SyncToken* pSyncToken)
+{
+    MaterialLibrary* pLib = pMaterialLibrary;
+    ASSERT(pLib);
+
+    // Aligned for the records of binary materials
+    alignas(uint64_t) char materialFileStackBuffer[ShaderByteCodeBuffer::kStackSize];
+
+    char*      materialFileBuffer = NULL;
+    uint64_t   fileSize = 0;
+    FileStream stream = {};
+    Material*  pMaterial = nullptr;
+
+    if (fsOpenStreamFromPath(RD_COMPILED_MATERIALS, pMaterialFileName, FM_READ, &stream))
+    {
+        fileSize = fsGetStreamFileSize(&stream);
+
+        // Binary materials are read in place from the memory mapped file
+        size_t      mappedSize = 0;
+        const void* pMapped = NULL;
+        if (fsStreamMemoryMap(&stream, &mappedSize, &pMapped) && pMapped && mappedSize >= 4 && !strncmp((const char*)pMapped, "@FMB", 4))
+        {
+            const bool parsed = parseBinaryMaterial((const uint8_t*)pMapped, mappedSize, &pMaterial);
+            fsCloseStream(&stream);
+            if (!parsed)
+            {
+                LOGF(eERROR, "Invalid binary material file '%s'", pMaterialFileName);
+                return REGISTER_MATERIAL_BADFILE;
+            }
+        }
+    }
+    else
+    {
+        return REGISTER_MATERIAL_BADFILE;
+    }
+
+    if (!pMaterial)
+    {
+        if (fileSize < sizeof(materialFileStackBuffer))
+            materialFileBuffer = materialFileStackBuffer;
+        else
+            materialFileBuffer = (char*)tf_malloc(fileSize + 1);
+
+        const uint64_t readSize = fsReadFromStream(&stream, materialFileBuffer, fileSize);
+        ASSERT(readSize <= fileSize);
+        materialFileBuffer[readSize] = '\0';
+
+        fsCloseStream(&stream);
+
+        if (readSize >= 4 && !strncmp(materialFileBuffer, "@FMB", 4))
+        {
+            if (!parseBinaryMaterial((const uint8_t*)materialFileBuffer, readSize, &pMaterial))
+                LOGF(eERROR, "Invalid binary material file '%s'", pMaterialFileName);
+        }
+        else
+        {
+            parseMaterial(materialFileBuffer, fileSize, &pMaterial);
+        }
+
+        if (materialFileBuffer != materialFileStackBuffer)
+            tf_free(materialFileBuffer);
+
+        materialFileBuffer = nullptr;
+
+        if (!pMaterial)
+            return REGISTER_MATERIAL_BADFILE;
+    }
+
+    ASSERT(pMaterial && pMaterial->pDesc);
+    MaterialDesc* pMaterialDesc = pMaterial->pDesc;
+
+    // Load all resources
+    // (this step could be delayed in time, by extending the API we could allow the user to only load specific MaterialSets)
+
+    ShaderByteCodeBuffer shaderByteCodeBuffer = {};
+#if !defined(PROSPERO)
+    char bytecodeStack[ShaderByteCodeBuffer::kStackSize] = {};
+    shaderByteCodeBuffer.pStackMemory = bytecodeStack;
+#endif
+
+    SyncToken token = {};
+
+    for (uint32_t i = 0; i < pMaterialDesc->mMaterialCount; ++i)
+    {
+        Material::LoadedMaterial*        pLoadedMaterial = pMaterial->pLoaded + i;
+        const MaterialDesc::MaterialSet* pMaterialSet = pMaterialDesc->pMaterialSets + i;
+
+        // Load Shader
+
+        ASSERT(pMaterialSet->mShaderSetIdx < pMaterialDesc->mShaderSetCount);
+        const MaterialDesc::ShaderSet* pShaderSet = pMaterialDesc->pShaderSets + pMaterialSet->mShaderSetIdx;
+
+        // If the shader is not loaded we need to load it
+        const uint32_t shaderIndex = pShaderSet->mId;
+        ASSERT(shaderIndex < pLib->mMaxMaterialShaders);
+
+        // Check refcount because ppMaterialShaders[shaderIndex] might still be null in case the loading is still queued in another thread
+        if (pLib->pMaterialShaderRefCount[shaderIndex] == 0)
+        {
+            ASSERT(pLib->mLoadedShaderCount <= pLib->mMaxMaterialShaders && "Seems like we loaded some shader multiple times");
+            pLib->mLoadedShaderCount++;
+
+            Shader** ppOutShader = &pLib->ppMaterialShaders[shaderIndex];
+
+            BinaryShaderDesc shaderDesc = {};
+            materialLoadBinaryShader(pLib->pRenderer, pMaterialDesc, pShaderSet, &shaderDesc, &shaderByteCodeBuffer);
+
+#if defined(PROSPERO)
+            shaderDesc.mOwnByteCode = true;
+#endif
+            addShaderBinary(pLib->pRenderer, &shaderDesc, ppOutShader);
+            freeShaderByteCode(&shaderByteCodeBuffer, &shaderDesc);
+        }
+
+        pLib->pMaterialShaderRefCount[shaderIndex]++;
+        pLoadedMaterial->mShaderIndex = shaderIndex;
+
+        // Load Textutes
+
+        ASSERT(pMaterialSet->mTextureSetIdx < pMaterialDesc->mTextureSetCount);
+        const MaterialDesc::TextureSet* pTextureSet = pMaterialDesc->pTextureSets + pMaterialSet->mTextureSetIdx;
+
+        const uint32_t textureCount = pTextureSet->mTextureCount;
+        for (uint32_t j = 0; j < textureCount; ++j)
+        {
+            // Try to get the texture from the global cache
+            const uint32_t textureIndex = pMaterialDesc->pTextureIds[pTextureSet->pTextureIdxs[j]];
+            ASSERT(textureIndex < pLib->mMaxMaterialTextures);
+
+            // Check refcount because ppMaterialTextures[textureIndex] might still be null in case the loading is still queued in another
+            // thread
+            if (pLib->pMaterialTextureRefCount[textureIndex] == 0)
+            {
+                ASSERT(pLib->mLoadedTextureCount < pLib->mMaxMaterialTextures && "Seems like we loaded some texture multiple times");
+                pLib->mLoadedTextureCount++;
+
+                // Texture is not in the cache yet, load it into the cache
+                TextureLoadDesc desc = {};
+                desc.pFileName = pMaterialDesc->pTextureNames[pTextureSet->pTextureIdxs[j]];
+                desc.ppTexture = &pLib->ppMaterialTextures[textureIndex];
+                if (pMaterialDesc->pTextureFlags[j] & MaterialDesc::TextureFlags::SRGB)
+                    desc.mCreationFlag |= TEXTURE_CREATION_FLAG_SRGB;
+                addResource(&desc, &token);
+#ifdef TARGET_IOS
+                // Wait here to prevent overloading the staging buffer on iOS.
+                waitForToken(&token);
+#endif
+            }
+
+            pLib->pMaterialTextureRefCount[textureIndex]++;
+            pLoadedMaterial->pTextureIndexes[j] = textureIndex;
+        }
+
+        pLoadedMaterial->mTextureCount = textureCount;
+    }
+
+    ++pLib->mLoadedMaterialCount;
+
+    if (pSyncToken)
+        *pSyncToken = max(*pSyncToken, token);
+
+    pLib->mSyncToken = max(pLib->mSyncToken, token);
+
+    *pOutMaterial = pMaterial;
+    return REGISTER_MATERIAL_SUCCESS;
+}
+
+void removeMaterial(Material* pMaterial)
+{
+    MaterialLibrary* pLib = pMaterialLibrary;
+    ASSERT(pLib);
+    ASSERT(pMaterial && pMaterial->pDesc);
+
+    // We wait for all material related requests before we unload this material.
+    // This is needed in case pMaterial resources are still queued to upload to the GPU.
+    // A better approach might be to store one sync token per request (but that might me a lot of SyncTokens), to be decided in the future
+    waitForToken(&pLib->mSyncToken);
+
+    for (uint32_t i = 0; i < pMaterial->pDesc->mMaterialCount; ++i)
+    {
+        Material::LoadedMaterial* pLoadedMaterial = pMaterial->pLoaded + i;
+        const uint32_t            shaderIndex = pLoadedMaterial->mShaderIndex;
+        pLoadedMaterial->mShaderIndex = INVALID_MATERIAL_ID;
+
+        // Right now we are loading all material resources when we add them.
+        ASSERT(shaderIndex < pLib->mMaxMaterialShaders);
+        ASSERT(pLib->ppMaterialShaders[shaderIndex] != NULL);
+        ASSERT(pLib->pMaterialShaderRefCount[shaderIndex] > 0);
+
+        if (--pLib->pMaterialShaderRefCount[shaderIndex] == 0)
+        {
+            // Make sure pointer is valid, if removeMaterial is called before the ResourceLoader thread can process requests from
+            // addMaterial this pointer will still be nullptr
+            ASSERT(pLib->ppMaterialShaders[shaderIndex] != nullptr);
+
+            // Last Material using this shader
+            removeShader(pLib->pRenderer, pLib->ppMaterialShaders[shaderIndex]);
+            pLib->ppMaterialShaders[shaderIndex] = NULL;
+            ASSERT(pLib->mLoadedShaderCount > 0);
+            pLib->mLoadedShaderCount--;
+        }
+
+        for (uint32_t j = 0; j < pLoadedMaterial->mTextureCount; ++j)
+        {
+            const uint32_t textureIndex = pLoadedMaterial->pTextureIndexes[j];
+            pLoadedMaterial->pTextureIndexes[j] = INVALID_MATERIAL_ID;
+            ASSERT(textureIndex < pLib->mMaxMaterialTextures);
+            ASSERT(pLib->ppMaterialTextures[textureIndex] != NULL);
+            ASSERT(pLib->pMaterialTextureRefCount[textureIndex] > 0);
+
+            if (--pLib->pMaterialTextureRefCount[textureIndex] == 0)
+            {
+                // Make sure pointer is valid, if removeMaterial is called before the ResourceLoader thread can process requests from
+                // addMaterial this pointer will still be nullptr
+                ASSERT(pLib->ppMaterialTextures[textureIndex] != nullptr);
+
+                // Last material using this texture
+                removeResource(pLib->ppMaterialTextures[textureIndex]);
+                pLib->ppMaterialTextures[textureIndex] = NULL;
+
+                ASSERT(pLib->mLoadedTextureCount > 0);
+                pLib->mLoadedTextureCount--;
+            }
+        }
+
+        pLoadedMaterial->mTextureCount = 0;
+    }
+
+    --pLib->mLoadedMaterialCount;
+    tf_free(pMaterial);
+}
+
+uint32_t getMaterialSetIndex(Material* pMaterial, const char* name)
+{
+    ASSERT(pMaterial && pMaterial->pDesc);
+    ASSERT(pMaterial && name && name[0] != '\0');
+
+    for (uint32_t i = 0; i < pMaterial->pDesc->mMaterialCount; ++i)
+    {
+        if (strcmp(name, pMaterial->pDesc->pMaterialSetNames[i]) == 0)
+            return i;
+    }
+
+    return INVALID_MATERIAL_ID;
+}
+
+void getMaterialShader(Material* pMaterial, uint32_t materialSetIndex, Shader** ppOutShader)
+{
+    MaterialLibrary* pLib = pMaterialLibrary;
+    ASSERT(pLib);
+    ASSERT(pMaterial && pMaterial->pDesc);
+    ASSERT(materialSetIndex < pMaterial->pDesc->mMaterialCount);
+
+    (*ppOutShader) = pLib->ppMaterialShaders[pMaterial->pLoaded[materialSetIndex].mShaderIndex];
+}
+
+void getMaterialTextures(Material* pMaterial, uint32_t materialSetIndex, const char** ppOutTextureBindingNames, Texture** ppOutTextures,
+                         uint32_t outTexturesSize)
+{
+    MaterialLibrary* pLib = pMaterialLibrary;
+    ASSERT(pLib);
+    ASSERT(pMaterial && pMaterial->pDesc);
+    ASSERT(materialSetIndex < pMaterial->pDesc->mMaterialCount);
+
+    const Material::LoadedMaterial* pLoadedMaterial = pMaterial->pLoaded + materialSetIndex;
+    ASSERT(outTexturesSize ==
+           pLoadedMaterial
+               ->mTextureCount); // Probably should be >= but at this point we want to make sure the user knows how many textures is getting
+
+    const MaterialDesc::MaterialSet* pMaterialSet = pMaterial->pDesc->pMaterialSets + materialSetIndex;
+    const MaterialDesc::ShaderSet*   pShaderSet = pMaterial->pDesc->pShaderSets + pMaterialSet->mShaderSetIdx;
+    ASSERT(pShaderSet->mTextureBindingCount == pLoadedMaterial->mTextureCount);
+
+    for (uint32_t i = 0; i < pLoadedMaterial->mTextureCount; ++i)
+    {
+        ppOutTextureBindingNames[i] = pShaderSet->pTextureBindingNames[i];
+
+        ASSERT(pLoadedMaterial->pTextureIndexes[i] < pLib->mMaxMaterialTextures);
+        ppOutTextures[i] = pLib->ppMaterialTextures[pLoadedMaterial->pTextureIndexes[i]];
+    }
+}
+#endif // ENABLE_FORGE_MATERIALS
+
+void getResourceSizeAlign(const BufferLoadDesc* pDesc, ResourceSizeAlign* pOut)
+{
+    getBufferSizeAlign(pResourceLoader->ppRenderers[pDesc->mDesc.mNodeIndex], &pDesc->mDesc, pOut);
+}
+
+void getResourceSizeAlign(const TextureLoadDesc* pDesc, ResourceSizeAlign* pOut)
+{
+    getTextureSizeAlign(pResourceLoader->ppRenderers[pDesc->mNodeIndex], pDesc->pDesc, pOut);
+}
+
+void addResource(BufferLoadDesc* pBufferDesc, SyncToken* token)
+{
+    if (token)
+    {
+        *token = max<uint64_t>(0, *token);
+    }
+
+    if (pBufferDesc->pData && !token)
+    {
+        LOADER_LOGF(eWARNING,
+                    "addResource : BufferLoadDesc(%s)::pData is non NULL but token is NULL. It is undefined behavior if pData is freed "
+                    "before the buffer load has completed on the ResourceLoader thread. Use waitForAllResourceLoads before freeing pData "
+                    "when explicit token was not passed",
+                    pBufferDesc->mDesc.pName ? pBufferDesc->mDesc.pName : "Unnamed");
+    }
+
+    ResourceState startState = pBufferDesc->mDesc.mStartState;
+    if (RESOURCE_MEMORY_USAGE_GPU_ONLY == pBufferDesc->mDesc.mMemoryUsage && !pBufferDesc->mDesc.mStartState)
+    {
+        startState = ResourceStartState(&pBufferDesc->mDesc);
+        LOADER_LOGF(eWARNING, "Buffer start state not provided. Determined the start state as (%u) based on the provided BufferDesc",
+                    (uint32_t)pBufferDesc->mDesc.mStartState);
+    }
+
+    Renderer*  pRenderer = pResourceLoader->ppRenderers[pBufferDesc->mDesc.mNodeIndex];
+    const bool update = pBufferDesc->pData || pBufferDesc->mForceReset;
+    const bool gpuUpdate = pBufferDesc->mDesc.mMemoryUsage == RESOURCE_MEMORY_USAGE_GPU_ONLY && update && !gUma;
+
+    if (gpuUpdate)
+    {
+        pBufferDesc->mDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+    }
+    else
+    {
+        pBufferDesc->mDesc.mStartState = startState;
+    }
+
+    const uint64_t bufferSize = pBufferDesc->mDesc.mSize;
+    addBuffer(pRenderer, &pBufferDesc->mDesc, pBufferDesc->ppBuffer);
+
+    if (update)
+    {
+        BufferLoadDescInternal loadDesc = {};
+        loadDesc.mForceReset = pBufferDesc->mForceReset;
+        loadDesc.mStartState = startState;
+        loadDesc.pBuffer = *pBufferDesc->ppBuffer;
+        loadDesc.pData = pBufferDesc->pData;
+        loadDesc.mDataSize = bufferSize;
+        if (gpuUpdate && RESOURCE_MEMORY_USAGE_GPU_ONLY == loadDesc.pBuffer->mMemoryUsage)
+        {
+            loadDesc.pSrcBuffer = pBufferDesc->pSrcBuffer;
+            loadDesc.mSrcOffset = pBufferDesc->mSrcOffset;
+        }
+        else
+        {
+            ASSERT(!pBufferDesc->pSrcBuffer);
+            loadDesc.pSrcBuffer = loadDesc.pBuffer;
+            loadDesc.mSrcOffset = 0;
+        }
+        queueBufferLoad(pResourceLoader, &loadDesc, pBufferDesc->mPriority, token);
+    }
+}
+
+void addResource(TextureLoadDesc* pTextureDesc, SyncToken* token)
+{
+    ASSERT(pTextureDesc->ppTexture);
+
+    if (token)
+    {
+        *token = max<uint64_t>(0, *token);
+    }
+
+    if (!pTextureDesc->pFileName && pTextureDesc->pDesc)
+    {
+        ASSERT(pTextureDesc->pDesc->mStartState);
+
+        TextureDesc textureDesc = *pTextureDesc->pDesc;
+#if defined(GFX_DRIVER_MANAGED_VIDEO_MEMORY)
+        if (pTextureDesc->mForceReset)
+        {
+            // If we are going to mem zero using staging buffer set start state to copy dest to avoid one barrier in the beginning
+            textureDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+        }
+#endif
+        // If texture is supposed to be filled later (UAV / Update later / ...) proceed with the mStartState provided by the user in the
+        // texture description
+        addTexture(pResourceLoader->ppRenderers[pTextureDesc->mNodeIndex], &textureDesc, pTextureDesc->ppTexture);
+
+        if (pTextureDesc->mForceReset)
+        {
+#if !defined(GFX_DRIVER_MANAGED_VIDEO_MEMORY)
+            Texture* texture = *pTextureDesc->ppTexture;
+#if defined(ORBIS)
+            void*    ptr = texture->mStruct.mSrvDescriptor.getBaseAddress();
+            uint64_t size = texture->mStruct.mSrvDescriptor.getSizeAlign().m_size;
+#elif defined(PROSPERO)
+            void*    ptr = texture->mStruct.mSrv.getDataAddress();
+            uint64_t size = PROSPERO_RENDERER_NAMESPACE::getSize(&texture->mStruct.mSrv).m_size;
+#elif defined(XBOX)
+            void*               ptr = (void*)texture->mDx.pResource->GetGPUVirtualAddress();
+            D3D12_RESOURCE_DESC desc = texture->mDx.pResource->GetDesc();
+            uint64_t            size = 0;
+            pResourceLoader->ppRenderers[pTextureDesc->mNodeIndex]->mDx.pDevice->GetCopyableFootprints(
+                &desc, 0, desc.MipLevels * desc.DepthOrArraySize, 0, NULL, NULL, NULL, &size);
+#else
+#error : Not implemented
+#endif
+            memset(ptr, 0, size);
+#else
+            TextureLoadDescInternal loadDesc = {};
+            loadDesc.ppTexture = pTextureDesc->ppTexture;
+            loadDesc.mForceReset = true;
+            loadDesc.mStartState = pTextureDesc->pDesc->mStartState;
+            queueTextureLoad(pResourceLoader, &loadDesc, pTextureDesc->mPriority, token);
+#endif
+            return;
+        }
+
+        if (IssueExplicitInitialStateBarrier())
+        {
+            ResourceState startState = pTextureDesc->pDesc->mStartState;
+            // Check whether this is required (user specified a state other than undefined / common)
+            if (startState == RESOURCE_STATE_UNDEFINED || startState == RESOURCE_STATE_COMMON) //-V560
+            {
+                startState = ResourceStartState(pTextureDesc->pDesc->mDescriptors & DESCRIPTOR_TYPE_RW_TEXTURE);
+            }
+            queueTextureBarrier(pResourceLoader, *pTextureDesc->ppTexture, startState, token);
+        }
+    }
+    else
+    {
+        TextureLoadDescInternal loadDesc = {};
+        loadDesc.ppTexture = pTextureDesc->ppTexture;
+        loadDesc.mContainer = pTextureDesc->mContainer;
+        loadDesc.mFlags = pTextureDesc->mCreationFlag;
+        loadDesc.mNodeIndex = pTextureDesc->mNodeIndex;
+        loadDesc.pFileName = pTextureDesc->pFileName;
+        loadDesc.pYcbcrSampler = pTextureDesc->pYcbcrSampler;
+        loadDesc.mCacheMode = pTextureDesc->mCacheMode;
+        if (pTextureDesc->mCacheMode != TEXTURE_CACHE_MODE_NONE && pTextureDesc->pFileName)
+        {
+            loadDesc.pCacheKey = getTextureCacheKey(pTextureDesc);
+        }
+        queueTextureLoad(pResourceLoader, &loadDesc, pTextureDesc->mPriority, token);
+    }
+}
+
+void addResource(GeometryLoadDesc* pDesc, SyncToken* token)
+{
+    ASSERT(pDesc->pVertexLayout);
+    ASSERT(pDesc->ppGeometry);
+    ASSERT((!(pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED) || pDesc->ppGeometryData) &&
+           "Deferred shadow data is stored in GeometryData");
+
+    GeometryLoadDesc updateDesc = *pDesc;
+    updateDesc.pFileName = pDesc->pFileName;
 
-    *pOut = pMaterial;
+    uint32_t extraSize = sizeof(VertexLayout);
+
+    VertexLayout* pCopyVertexLayout = (VertexLayout*)tf_malloc(extraSize);
+    memcpy(pCopyVertexLayout, pDesc->pVertexLayout, sizeof(VertexLayout));
+    updateDesc.pVertexLayout = pCopyVertexLayout;
+
+    queueGeometryLoad(pResourceLoader, &updateDesc, token);
 }
 
-uint32_t addMaterial(const char* pMaterialFileName, Material** pOutMaterial, SyncToken* pSyncToken)
+void addResource(GeometryBatchLoadDesc* pDesc, SyncToken* token)
 {
-    MaterialLibrary* pLib = pMaterialLibrary;
-    ASSERT(pLib);
+    ASSERT(pDesc->pVertexLayout);
+    ASSERT(pDesc->ppGeometryBatch);
+    ASSERT(pDesc->ppFileNames || !pDesc->mFileCount);
+    ASSERT(!(pDesc->mFlags & GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED) && "Deferred shadow data is not supported by geometry batches");
 
-    char materialFileStackBuffer[ShaderByteCodeBuffer::kStackSize];
+    if (!VERIFYMSG(pDesc->pGeometryBuffer, "Geometry batches need a GeometryBuffer to sub-allocate the index and vertex data"))
+        return;
 
-    char*      materialFileBuffer = NULL;
-    uint64_t   fileSize = 0;
-    FileStream stream = {};
+    GeometryBatchLoadDesc updateDesc = *pDesc;
 
-    if (fsOpenStreamFromPath(RD_COMPILED_MATERIALS, pMaterialFileName, FM_READ, &stream))
-    {
-        fileSize = fsGetStreamFileSize(&stream);
+    // Copy vertex layout and filename array in a single allocation, released by the resource loader thread
+    const size_t layoutSize = round_up_64(sizeof(VertexLayout), sizeof(const char*));
+    uint8_t*     pCopy = (uint8_t*)tf_malloc(layoutSize + sizeof(const char*) * pDesc->mFileCount);
+    memcpy(pCopy, pDesc->pVertexLayout, sizeof(VertexLayout));
+    memcpy(pCopy + layoutSize, pDesc->ppFileNames, sizeof(const char*) * pDesc->mFileCount);
+    updateDesc.pVertexLayout = (VertexLayout*)pCopy;
+    updateDesc.ppFileNames = (const char* const*)(pCopy + layoutSize);
 
-        if (fileSize < sizeof(materialFileStackBuffer))
-            materialFileBuffer = materialFileStackBuffer;
-        else
-            materialFileBuffer = (char*)tf_malloc(fileSize + 1);
+    queueGeometryBatchLoad(pResourceLoader, &updateDesc, token);
+}
 
-        const uint64_t readSize = fsReadFromStream(&stream, materialFileBuffer, fileSize);
-        ASSERT(readSize <= fileSize);
-        materialFileBuffer[readSize] = '\0';
+void addResource(GeometryShadowLoadDesc* pDesc, SyncToken* token)
+{
+    ASSERT(pDesc->pGeometryData);
+    GeometryData* pGeom = pDesc->pGeometryData;
+    if (!VERIFYMSG(pGeom->pShadowSource, "Geometry was not loaded with GEOMETRY_LOAD_FLAG_SHADOWED_DEFERRED"))
+        return;
 
-        fsCloseStream(&stream);
-    }
-    else
+    GeometryShadowCache* pCache = &pResourceLoader->mGeometryShadows;
+    acquireMutex(&pCache->mMutex);
+    pGeom->pShadowSource->mLastRequest = ++pCache->mRequestCounter;
+    const bool resident = pGeom->pShadow != NULL;
+    releaseMutex(&pCache->mMutex);
+
+    if (!resident)
     {
-        return REGISTER_MATERIAL_BADFILE;
+        queueGeometryShadowLoad(pResourceLoader, pDesc, token);
     }
+}
 
-    Material* pMaterial = nullptr;
-    parseMaterial(materialFileBuffer, fileSize, &pMaterial);
+static int compareGeometryShadowRequest(const void* pLhs, const void* pRhs)
+{
+    const GeometryShadowSource* pA = (*(GeometryData* const*)pLhs)->pShadowSource;
+    const GeometryShadowSource* pB = (*(GeometryData* const*)pRhs)->pShadowSource;
+    if (pA->mLastRequest != pB->mLastRequest)
+        return pA->mLastRequest < pB->mLastRequest ? -1 : 1;
+    return 0;
+}
 
-    if (materialFileBuffer != materialFileStackBuffer)
-        tf_free(materialFileBuffer);
+uint64_t evictGeometryShadowData(uint64_t maxResidentSize)
+{
+    GeometryShadowCache* pCache = &pResourceLoader->mGeometryShadows;
+    uint64_t             evictedSize = 0;
 
-    materialFileBuffer = nullptr;
+    acquireMutex(&pCache->mMutex);
+    if (pCache->mResidentSize > maxResidentSize)
+    {
+        // Least recently requested copies come first
+        qsort(pCache->ppResident, arrlenu(pCache->ppResident), sizeof(GeometryData*), compareGeometryShadowRequest);
 
-    ASSERT(pMaterial && pMaterial->pDesc);
-    MaterialDesc* pMaterialDesc = pMaterial->pDesc;
+        const uint32_t residentCount = (uint32_t)arrlen(pCache->ppResident);
+        uint32_t       evictedCount = 0;
+        while (evictedCount < residentCount && pCache->mResidentSize > maxResidentSize)
+        {
+            GeometryData* pGeom = pCache->ppResident[evictedCount++];
+            pCache->mResidentSize -= pGeom->pShadowSource->mSize;
+            evictedSize += pGeom->pShadowSource->mSize;
+            tf_free(pGeom->pShadow);
+            pGeom->pShadow = nullptr;
+        }
+        arrdeln(pCache->ppResident, 0, evictedCount);
+        pCache->mEvictedSize += evictedSize;
+    }
+    releaseMutex(&pCache->mMutex);
 
-    // Load all resources
-    // (this step could be delayed in time, by extending the API we could allow the user to only load specific MaterialSets)
+    return evictedSize;
+}
 
-    ShaderByteCodeBuffer shaderByteCodeBuffer = {};
-#if !defined(PROSPERO)
-    char bytecodeStack[ShaderByteCodeBuffer::kStackSize] = {};
-    shaderByteCodeBuffer.pStackMemory = bytecodeStack;
-#endif
+void getGeometryShadowStats(GeometryShadowStats* pOutStats)
+{
+    ASSERT(pOutStats);
+    GeometryShadowCache* pCache = &pResourceLoader->mGeometryShadows;
+
+    acquireMutex(&pCache->mMutex);
+    GeometryShadowStats stats = {};
+    stats.mResidentSize = pCache->mResidentSize;
+    stats.mResidentCount = (uint32_t)arrlen(pCache->ppResident);
+    stats.mGeometryCount = pCache->mGeometryCount;
+    stats.mLoadedSize = pCache->mLoadedSize;
+    stats.mEvictedSize = pCache->mEvictedSize;
+    releaseMutex(&pCache->mMutex);
+
+    *pOutStats = stats;
+}
 
-    SyncToken token = {};
+void removeResource(Buffer* pBuffer) { removeBuffer(pResourceLoader->ppRenderers[pBuffer->mNodeIndex], pBuffer); }
 
-    for (uint32_t i = 0; i < pMaterialDesc->mMaterialCount; ++i)
+void removeResource(Texture* pTexture)
+{
+    if (!releaseCachedTexture(pTexture))
     {
-        Material::LoadedMaterial*        pLoadedMaterial = pMaterial->pLoaded + i;
-        const MaterialDesc::MaterialSet* pMaterialSet = pMaterialDesc->pMaterialSets + i;
+        return;
+    }
 
-        // Load Shader
+    removeTexture(pResourceLoader->ppRenderers[pTexture->mNodeIndex], pTexture);
+}
 
-        ASSERT(pMaterialSet->mShaderSetIdx < pMaterialDesc->mShaderSetCount);
-        const MaterialDesc::ShaderSet* pShaderSet = pMaterialDesc->pShaderSets + pMaterialSet->mShaderSetIdx;
+void removeResource(Geometry* pGeom)
+{
+    if (!pGeom)
+        return;
 
-        // If the shader is not loaded we need to load it
-        const uint32_t shaderIndex = pShaderSet->mId;
-        ASSERT(shaderIndex < pLib->mMaxMaterialShaders);
+    if (pGeom->pGeometryBuffer)
+    {
+        removeGeometryBufferPart(&pGeom->pGeometryBuffer->mIndex, &pGeom->mIndexBufferChunk);
 
-        // Check refcount because ppMaterialShaders[shaderIndex] might still be null in case the loading is still queued in another thread
-        if (pLib->pMaterialShaderRefCount[shaderIndex] == 0)
+        for (uint32_t i = 0; i < pGeom->mVertexBufferCount; ++i)
         {
-            ASSERT(pLib->mLoadedShaderCount <= pLib->mMaxMaterialShaders && "Seems like we loaded some shader multiple times");
-            pLib->mLoadedShaderCount++;
+            removeGeometryBufferPart(&pGeom->pGeometryBuffer->mVertex[i], &pGeom->mVertexBufferChunks[i]);
+        }
+    }
+    else
+    {
+        removeResource(pGeom->pIndexBuffer);
 
-            Shader** ppOutShader = &pLib->ppMaterialShaders[shaderIndex];
+        for (uint32_t i = 0; i < pGeom->mVertexBufferCount; ++i)
+        {
+            removeResource(pGeom->pVertexBuffers[i]);
+        }
+    }
 
-            BinaryShaderDesc shaderDesc = {};
-            materialLoadBinaryShader(pLib->pRenderer, pMaterialDesc, pShaderSet, &shaderDesc, &shaderByteCodeBuffer);
+    tf_free(pGeom->meshlets.mMeshlets);
+    tf_free(pGeom);
+}
 
-#if defined(PROSPERO)
-            shaderDesc.mOwnByteCode = true;
-#endif
-            addShaderBinary(pLib->pRenderer, &shaderDesc, ppOutShader);
-            freeShaderByteCode(&shaderByteCodeBuffer, &shaderDesc);
+void removeResource(GeometryData* pGeom)
+{
+    removeGeometryShadowData(pGeom);
+    if (pGeom->pShadowSource)
+    {
+        GeometryShadowCache* pCache = &pResourceLoader->mGeometryShadows;
+        acquireMutex(&pCache->mMutex);
+        --pCache->mGeometryCount;
+        releaseMutex(&pCache->mMutex);
+        tf_free(pGeom->pShadowSource);
+    }
+    tf_free(pGeom);
+}
+
+void removeResource(GeometryBatch* pBatch)
+{
+    if (!pBatch)
+        return;
+
+    if (pBatch->pGeometryBuffer)
+    {
+        removeGeometryBufferPart(&pBatch->pGeometryBuffer->mIndex, &pBatch->mIndexBufferChunk);
+
+        for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i)
+        {
+            removeGeometryBufferPart(&pBatch->pGeometryBuffer->mVertex[i], &pBatch->mVertexBufferChunks[i]);
         }
+    }
 
-        pLib->pMaterialShaderRefCount[shaderIndex]++;
-        pLoadedMaterial->mShaderIndex = shaderIndex;
+    // Geometry, GeometryData, shadow and meshlet data of every file live in the same allocation as the batch
+    tf_free(pBatch);
+}
 
-        // Load Textutes
+/************************************************************************/
+// Texture streaming
+/************************************************************************/
+static uint64_t getStreamingTextureSize(const StreamingTexture* pTexture, uint32_t mipCount)
+{
+    TextureContainerLayout layout = {};
+    getStreamingTextureLayout(pTexture, &layout);
 
-        ASSERT(pMaterialSet->mTextureSetIdx < pMaterialDesc->mTextureSetCount);
-        const MaterialDesc::TextureSet* pTextureSet = pMaterialDesc->pTextureSets + pMaterialSet->mTextureSetIdx;
+    uint64_t size = 0;
+    mipCount = min(mipCount, pTexture->mMipLevels);
+    for (uint32_t mip = pTexture->mMipLevels - mipCount; mip < pTexture->mMipLevels; ++mip)
+    {
+        size += util_get_container_mip_size(&layout, mip) * layout.mArraySize;
+    }
+    return size;
+}
 
-        const uint32_t textureCount = pTextureSet->mTextureCount;
-        for (uint32_t j = 0; j < textureCount; ++j)
-        {
-            // Try to get the texture from the global cache
-            const uint32_t textureIndex = pMaterialDesc->pTextureIds[pTextureSet->pTextureIdxs[j]];
-            ASSERT(textureIndex < pLib->mMaxMaterialTextures);
+static void queueStreamingTextureLoad(StreamingTexture* pTexture, uint32_t mipCount, ResourceLoadPriority priority)
+{
+    TextureStreamDescInternal streamDesc = {};
+    streamDesc.pStreamingTexture = pTexture;
+    streamDesc.mMipCount = mipCount;
+    streamDesc.mNodeIndex = pTexture->mInternal.mNodeIndex;
+
+    pTexture->mInternal.pPendingTexture = NULL;
+    pTexture->mInternal.pFailedTexture = NULL;
+    pTexture->mInternal.mPendingMipCount = mipCount;
+    pTexture->mInternal.mPendingToken = 0;
+    queueTextureStream(pResourceLoader, &streamDesc, priority, &pTexture->mInternal.mPendingToken);
+}
 
-            // Check refcount because ppMaterialTextures[textureIndex] might still be null in case the loading is still queued in another
-            // thread
-            if (pLib->pMaterialTextureRefCount[textureIndex] == 0)
-            {
-                ASSERT(pLib->mLoadedTextureCount < pLib->mMaxMaterialTextures && "Seems like we loaded some texture multiple times");
-                pLib->mLoadedTextureCount++;
+static int compareStreamingTextureUpdate(const void* pLhs, const void* pRhs)
+{
+    const StreamingTexture* pA = ((const StreamingTextureUpdate*)pLhs)->pTexture;
+    const StreamingTexture* pB = ((const StreamingTextureUpdate*)pRhs)->pTexture;
+    // Least recently requested textures come first so they are the first ones to give up their mips
+    if (pA->mInternal.mLastRequestFrame != pB->mInternal.mLastRequestFrame)
+        return pA->mInternal.mLastRequestFrame < pB->mInternal.mLastRequestFrame ? -1 : 1;
+    return 0;
+}
 
-                // Texture is not in the cache yet, load it into the cache
-                TextureLoadDesc desc = {};
-                desc.pFileName = pMaterialDesc->pTextureNames[pTextureSet->pTextureIdxs[j]];
-                desc.ppTexture = &pLib->ppMaterialTextures[textureIndex];
-                if (pMaterialDesc->pTextureFlags[j] & MaterialDesc::TextureFlags::SRGB)
-                    desc.mCreationFlag |= TEXTURE_CREATION_FLAG_SRGB;
-                addResource(&desc, &token);
-#ifdef TARGET_IOS
-                // Wait here to prevent overloading the staging buffer on iOS.
-                waitForToken(&token);
-#endif
-            }
+void addResource(StreamingTextureLoadDesc* pDesc, SyncToken* token)
+{
+    ASSERT(pDesc->ppStreamingTexture);
+    ASSERT(pDesc->pFileName);
+
+    // File name lives in the same allocation as the texture
+    const size_t      nameSize = strlen(pDesc->pFileName) + 1;
+    StreamingTexture* pTexture = (StreamingTexture*)tf_calloc(1, sizeof(StreamingTexture) + nameSize);
+    char*             pFileName = (char*)(pTexture + 1);
+    memcpy(pFileName, pDesc->pFileName, nameSize);
+
+    pTexture->mInternal.pFileName = pFileName;
+    pTexture->mInternal.mCreationFlag = pDesc->mCreationFlag;
+    pTexture->mInternal.mContainer = pDesc->mContainer;
+    pTexture->mInternal.mNodeIndex = pDesc->mNodeIndex;
+    pTexture->mInternal.mMinResidentMipCount = max(1u, pDesc->mMinResidentMipCount);
+
+    TextureStreaming* pStreaming = &pResourceLoader->mStreaming;
+    pTexture->mInternal.mLastRequestFrame = pStreaming->mFrameIndex;
+    arrpush(pStreaming->pTextures, pTexture);
+
+    queueStreamingTextureLoad(pTexture, pTexture->mInternal.mMinResidentMipCount, RESOURCE_LOAD_PRIORITY_NORMAL);
+    if (token)
+        *token = max(pTexture->mInternal.mPendingToken, *token);
 
-            pLib->pMaterialTextureRefCount[textureIndex]++;
-            pLoadedMaterial->pTextureIndexes[j] = textureIndex;
-        }
+    *pDesc->ppStreamingTexture = pTexture;
+}
 
-        pLoadedMaterial->mTextureCount = textureCount;
-    }
+void removeResource(StreamingTexture* pTexture)
+{
+    if (!pTexture)
+        return;
 
-    ++pLib->mLoadedMaterialCount;
+    Renderer* pRenderer = pResourceLoader->ppRenderers[pTexture->mInternal.mNodeIndex];
+    if (pTexture->mInternal.mPendingMipCount)
+    {
+        waitForToken(pResourceLoader, &pTexture->mInternal.mPendingToken);
+        if (pTexture->mInternal.pPendingTexture)
+            removeTexture(pRenderer, pTexture->mInternal.pPendingTexture);
+        if (pTexture->mInternal.pFailedTexture)
+            removeTexture(pRenderer, pTexture->mInternal.pFailedTexture);
+    }
 
-    if (pSyncToken)
-        *pSyncToken = max(*pSyncToken, token);
+    if (pTexture->pTexture)
+        removeTexture(pRenderer, pTexture->pTexture);
 
-    pLib->mSyncToken = max(pLib->mSyncToken, token);
+    TextureStreaming* pStreaming = &pResourceLoader->mStreaming;
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pStreaming->pTextures); ++i)
+    {
+        if (pStreaming->pTextures[i] == pTexture)
+        {
+            arrdelswap(pStreaming->pTextures, i);
+            break;
+        }
+    }
 
-    *pOutMaterial = pMaterial;
-    return REGISTER_MATERIAL_SUCCESS;
+    tf_free(pTexture);
 }
 
-void removeMaterial(Material* pMaterial)
+void requestStreamingTextureMip(StreamingTexture* pTexture, uint32_t mostDetailedMip)
 {
-    MaterialLibrary* pLib = pMaterialLibrary;
-    ASSERT(pLib);
-    ASSERT(pMaterial && pMaterial->pDesc);
+    // Mip count is unknown until the first load completes, the request is clamped by updateTextureStreaming
+    const uint32_t mipCount = pTexture->pTexture ? pTexture->mMipLevels - min(mostDetailedMip, pTexture->mMipLevels - 1) : UINT32_MAX;
 
-    // We wait for all material related requests before we unload this material.
-    // This is needed in case pMaterial resources are still queued to upload to the GPU.
-    // A better approach might be to store one sync token per request (but that might me a lot of SyncTokens), to be decided in the future
-    waitForToken(&pLib->mSyncToken);
+    const uint64_t frame = pResourceLoader->mStreaming.mFrameIndex;
+    if (pTexture->mInternal.mLastRequestFrame != frame)
+        pTexture->mInternal.mRequestedMipCount = mipCount;
+    else
+        pTexture->mInternal.mRequestedMipCount = max(mipCount, pTexture->mInternal.mRequestedMipCount);
+    pTexture->mInternal.mLastRequestFrame = frame;
+}
 
-    for (uint32_t i = 0; i < pMaterial->pDesc->mMaterialCount; ++i)
+void updateTextureStreaming()
+{
+    TextureStreaming*           pStreaming = &pResourceLoader->mStreaming;
+    const TextureStreamingDesc* pDesc = &pStreaming->mDesc;
+    const uint64_t              frame = pStreaming->mFrameIndex;
+
+    // Swap in the textures of completed loads, the replaced textures can still be used by frames in flight
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pStreaming->pTextures); ++i)
     {
-        Material::LoadedMaterial* pLoadedMaterial = pMaterial->pLoaded + i;
-        const uint32_t            shaderIndex = pLoadedMaterial->mShaderIndex;
-        pLoadedMaterial->mShaderIndex = INVALID_MATERIAL_ID;
+        StreamingTexture* pTexture = pStreaming->pTextures[i];
+        if (!pTexture->mInternal.mPendingMipCount || !isTokenCompleted(&pTexture->mInternal.mPendingToken))
+            continue;
 
-        // Right now we are loading all material resources when we add them.
-        ASSERT(shaderIndex < pLib->mMaxMaterialShaders);
-        ASSERT(pLib->ppMaterialShaders[shaderIndex] != NULL);
-        ASSERT(pLib->pMaterialShaderRefCount[shaderIndex] > 0);
+        pTexture->mInternal.mPendingMipCount = 0;
+        if (pTexture->mInternal.pFailedTexture)
+        {
+            // Retired as a replaced texture would be, the GPU might still be executing the copies of the failed load
+            RetiredStreamingTexture retired = { pTexture->mInternal.pFailedTexture, frame };
+            arrpush(pStreaming->pRetiredTextures, retired);
+            pTexture->mInternal.pFailedTexture = NULL;
+        }
+        if (!pTexture->mInternal.pPendingTexture)
+            continue;
 
-        if (--pLib->pMaterialShaderRefCount[shaderIndex] == 0)
+        // Requested mip count was clamped to the mips of the file by the resource loader thread
+        const uint32_t mipCount = pTexture->mInternal.pPendingTexture->mMipLevels;
+
+        const uint64_t newSize = getStreamingTextureSize(pTexture, mipCount);
+        if (pTexture->pTexture)
         {
-            // Make sure pointer is valid, if removeMaterial is called before the ResourceLoader thread can process requests from
-            // addMaterial this pointer will still be nullptr
-            ASSERT(pLib->ppMaterialShaders[shaderIndex] != nullptr);
+            const uint64_t oldSize = getStreamingTextureSize(pTexture, pTexture->mResidentMipCount);
+            pStreaming->mEvictedSize += oldSize > newSize ? oldSize - newSize : 0;
 
-            // Last Material using this shader
-            removeShader(pLib->pRenderer, pLib->ppMaterialShaders[shaderIndex]);
-            pLib->ppMaterialShaders[shaderIndex] = NULL;
-            ASSERT(pLib->mLoadedShaderCount > 0);
-            pLib->mLoadedShaderCount--;
+            RetiredStreamingTexture retired = { pTexture->pTexture, frame };
+            arrpush(pStreaming->pRetiredTextures, retired);
         }
+        pStreaming->mUploadedSize += newSize;
 
-        for (uint32_t j = 0; j < pLoadedMaterial->mTextureCount; ++j)
+        pTexture->pTexture = pTexture->mInternal.pPendingTexture;
+        pTexture->mInternal.pPendingTexture = NULL;
+        pTexture->mResidentMipCount = mipCount;
+        ++pTexture->mVersion;
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pStreaming->pRetiredTextures);)
+    {
+        const RetiredStreamingTexture* pRetired = &pStreaming->pRetiredTextures[i];
+        if (frame - pRetired->mRetireFrame < pDesc->mRetireFrameCount)
         {
-            const uint32_t textureIndex = pLoadedMaterial->pTextureIndexes[j];
-            pLoadedMaterial->pTextureIndexes[j] = INVALID_MATERIAL_ID;
-            ASSERT(textureIndex < pLib->mMaxMaterialTextures);
-            ASSERT(pLib->ppMaterialTextures[textureIndex] != NULL);
-            ASSERT(pLib->pMaterialTextureRefCount[textureIndex] > 0);
+            ++i;
+            continue;
+        }
 
-            if (--pLib->pMaterialTextureRefCount[textureIndex] == 0)
-            {
-                // Make sure pointer is valid, if removeMaterial is called before the ResourceLoader thread can process requests from
-                // addMaterial this pointer will still be nullptr
-                ASSERT(pLib->ppMaterialTextures[textureIndex] != nullptr);
+        removeTexture(pResourceLoader->ppRenderers[pRetired->pTexture->mNodeIndex], pRetired->pTexture);
+        arrdelswap(pStreaming->pRetiredTextures, i);
+    }
 
-                // Last material using this texture
-                removeResource(pLib->ppMaterialTextures[textureIndex]);
-                pLib->ppMaterialTextures[textureIndex] = NULL;
+    // Mips each texture should have, textures with a load in flight keep the mip count of that load
+    arrsetlen(pStreaming->pUpdates, 0);
+    uint64_t requestedSize = 0;
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pStreaming->pTextures); ++i)
+    {
+        StreamingTexture* pTexture = pStreaming->pTextures[i];
+        if (!pTexture->pTexture)
+            continue;
 
-                ASSERT(pLib->mLoadedTextureCount > 0);
-                pLib->mLoadedTextureCount--;
+        if (pTexture->mInternal.mPendingMipCount)
+        {
+            requestedSize += getStreamingTextureSize(pTexture, pTexture->mInternal.mPendingMipCount);
+            continue;
+        }
+
+        const uint32_t minMipCount = min(pTexture->mInternal.mMinResidentMipCount, pTexture->mMipLevels);
+        uint32_t       mipCount = minMipCount;
+        if (frame - pTexture->mInternal.mLastRequestFrame < pDesc->mEvictFrameCount)
+            mipCount = clamp(pTexture->mInternal.mRequestedMipCount, minMipCount, pTexture->mMipLevels);
+
+        StreamingTextureUpdate update = { pTexture, mipCount };
+        arrpush(pStreaming->pUpdates, update);
+        requestedSize += getStreamingTextureSize(pTexture, mipCount);
+    }
+    pStreaming->mRequestedSize = requestedSize;
+
+    if (requestedSize > pDesc->mMemoryBudget)
+    {
+        qsort(pStreaming->pUpdates, arrlenu(pStreaming->pUpdates), sizeof(StreamingTextureUpdate), compareStreamingTextureUpdate);
+
+        for (uint32_t i = 0; i < (uint32_t)arrlen(pStreaming->pUpdates) && requestedSize > pDesc->mMemoryBudget; ++i)
+        {
+            StreamingTextureUpdate* pUpdate = &pStreaming->pUpdates[i];
+            const uint32_t          minMipCount = min(pUpdate->pTexture->mInternal.mMinResidentMipCount, pUpdate->pTexture->mMipLevels);
+            while (pUpdate->mDesiredMipCount > minMipCount && requestedSize > pDesc->mMemoryBudget)
+            {
+                requestedSize -= getStreamingTextureSize(pUpdate->pTexture, pUpdate->mDesiredMipCount);
+                --pUpdate->mDesiredMipCount;
+                requestedSize += getStreamingTextureSize(pUpdate->pTexture, pUpdate->mDesiredMipCount);
             }
         }
-
-        pLoadedMaterial->mTextureCount = 0;
     }
 
-    --pLib->mLoadedMaterialCount;
-    tf_free(pMaterial);
-}
-
-uint32_t getMaterialSetIndex(Material* pMaterial, const char* name)
-{
-    ASSERT(pMaterial && pMaterial->pDesc);
-    ASSERT(pMaterial && name && name[0] != '\0');
-
-    for (uint32_t i = 0; i < pMaterial->pDesc->mMaterialCount; ++i)
+    // Evictions are queued before loads so that memory is given back before new mips are streamed in
+    uint32_t requestCount = 0;
+    for (uint32_t pass = 0; pass < 2; ++pass)
     {
-        if (strcmp(name, pMaterial->pDesc->pMaterialSetNames[i]) == 0)
-            return i;
+        for (uint32_t i = 0; i < (uint32_t)arrlen(pStreaming->pUpdates) && requestCount < pDesc->mMaxRequestsPerUpdate; ++i)
+        {
+            const StreamingTextureUpdate* pUpdate = &pStreaming->pUpdates[i];
+            const uint32_t                residentMipCount = pUpdate->pTexture->mResidentMipCount;
+            const bool evict = pUpdate->mDesiredMipCount < residentMipCount;
+            const bool load = pUpdate->mDesiredMipCount > residentMipCount;
+            if ((pass == 0 && evict) || (pass == 1 && load))
+            {
+                // Additional mips are bulk work, evictions give memory back and go first
+                queueStreamingTextureLoad(pUpdate->pTexture, pUpdate->mDesiredMipCount,
+                                          evict ? RESOURCE_LOAD_PRIORITY_NORMAL : RESOURCE_LOAD_PRIORITY_LOW);
+                ++requestCount;
+            }
+        }
     }
 
-    return INVALID_MATERIAL_ID;
+    ++pStreaming->mFrameIndex;
 }
 
-void getMaterialShader(Material* pMaterial, uint32_t materialSetIndex, Shader** ppOutShader)
+void setTextureStreamingDesc(const TextureStreamingDesc* pDesc)
 {
-    MaterialLibrary* pLib = pMaterialLibrary;
-    ASSERT(pLib);
-    ASSERT(pMaterial && pMaterial->pDesc);
-    ASSERT(materialSetIndex < pMaterial->pDesc->mMaterialCount);
-
-    (*ppOutShader) = pLib->ppMaterialShaders[pMaterial->pLoaded[materialSetIndex].mShaderIndex];
+    ASSERT(pDesc);
+    ASSERT(pDesc->mRetireFrameCount > 0);
+    pResourceLoader->mStreaming.mDesc = *pDesc;
 }
 
-void getMaterialTextures(Material* pMaterial, uint32_t materialSetIndex, const char** ppOutTextureBindingNames, Texture** ppOutTextures,
-                         uint32_t outTexturesSize)
+void getTextureStreamingStats(TextureStreamingStats* pOutStats)
 {
-    MaterialLibrary* pLib = pMaterialLibrary;
-    ASSERT(pLib);
-    ASSERT(pMaterial && pMaterial->pDesc);
-    ASSERT(materialSetIndex < pMaterial->pDesc->mMaterialCount);
+    ASSERT(pOutStats);
+    const TextureStreaming* pStreaming = &pResourceLoader->mStreaming;
+
+    TextureStreamingStats stats = {};
+    stats.mMemoryBudget = pStreaming->mDesc.mMemoryBudget;
+    stats.mRequestedSize = pStreaming->mRequestedSize;
+    stats.mUploadedSize = pStreaming->mUploadedSize;
+    stats.mEvictedSize = pStreaming->mEvictedSize;
+    stats.mTextureCount = (uint32_t)arrlen(pStreaming->pTextures);
+    stats.mRetiredTextureCount = (uint32_t)arrlen(pStreaming->pRetiredTextures);
+    for (uint32_t i = 0; i < stats.mTextureCount; ++i)
+    {
+        const StreamingTexture* pTexture = pStreaming->pTextures[i];
+        stats.mPendingRequestCount += pTexture->mInternal.mPendingMipCount ? 1 : 0;
+        if (!pTexture->pTexture)
+            continue;
 
-    const Material::LoadedMaterial* pLoadedMaterial = pMaterial->pLoaded + materialSetIndex;
-    ASSERT(outTexturesSize ==
-           pLoadedMaterial
-               ->mTextureCount); // Probably should be >= but at this point we want to make sure the user knows how many textures is getting
+        stats.mResidentSize += getStreamingTextureSize(pTexture, pTexture->mResidentMipCount);
+        stats.mResidentMipCount += pTexture->mResidentMipCount;
+        stats.mMipCount += pTexture->mMipLevels;
+    }
 
-    const MaterialDesc::MaterialSet* pMaterialSet = pMaterial->pDesc->pMaterialSets + materialSetIndex;
-    const MaterialDesc::ShaderSet*   pShaderSet = pMaterial->pDesc->pShaderSets + pMaterialSet->mShaderSetIdx;
-    ASSERT(pShaderSet->mTextureBindingCount == pLoadedMaterial->mTextureCount);
+    *pOutStats = stats;
+}
 
-    for (uint32_t i = 0; i < pLoadedMaterial->mTextureCount; ++i)
+void removeGeometryShadowData(GeometryData* pGeom)
+{
+    // Deferred copies are also written by the resource loader thread
+    if (pGeom->pShadowSource)
     {
-        ppOutTextureBindingNames[i] = pShaderSet->pTextureBindingNames[i];
+        GeometryShadowCache* pCache = &pResourceLoader->mGeometryShadows;
+        acquireMutex(&pCache->mMutex);
+        if (pGeom->pShadow)
+        {
+            removeResidentGeometryShadow(pCache, pGeom);
+            tf_free(pGeom->pShadow);
+            pGeom->pShadow = nullptr;
+        }
+        releaseMutex(&pCache->mMutex);
+        return;
+    }
 
-        ASSERT(pLoadedMaterial->pTextureIndexes[i] < pLib->mMaxMaterialTextures);
-        ppOutTextures[i] = pLib->ppMaterialTextures[pLoadedMaterial->pTextureIndexes[i]];
+    if (pGeom->pShadow)
+    {
+        tf_free(pGeom->pShadow);
+        pGeom->pShadow = nullptr;
     }
 }
-#endif // ENABLE_FORGE_MATERIALS
 
-void getResourceSizeAlign(const BufferLoadDesc* pDesc, ResourceSizeAlign* pOut)
+/************************************************************************/
+// Buffer Chunk Allocator
+/************************************************************************/
+// Two-level segregated fit heap used to track the free memory of a BufferChunkAllocator.
+// First level splits sizes in power of two classes, second level linearly splits each class in BCA_SL_COUNT buckets.
+// Sizes smaller than BCA_SMALL_CHUNK_SIZE go to the first class and map 1:1 to second level buckets.
+#define BCA_SL_COUNT_LOG2    5
+#define BCA_SL_COUNT         (1u << BCA_SL_COUNT_LOG2)
+#define BCA_FL_SHIFT         BCA_SL_COUNT_LOG2
+#define BCA_FL_COUNT         (32 - BCA_FL_SHIFT + 1)
+#define BCA_SMALL_CHUNK_SIZE (1u << BCA_FL_SHIFT)
+#define BCA_INVALID_NODE     UINT32_MAX
+
+COMPILE_ASSERT(BCA_SL_COUNT <= 32); // Second level bitmaps are 32 bits
+
+typedef struct BufferChunkNode
 {
-    getBufferSizeAlign(pResourceLoader->ppRenderers[pDesc->mDesc.mNodeIndex], &pDesc->mDesc, pOut);
+    BufferChunk mChunk;
+    uint32_t    mPrevPhysical;
+    uint32_t    mNextPhysical;
+    // Links in the free list of the node's size class, mNextFree also links recycled nodes
+    uint32_t    mPrevFree;
+    uint32_t    mNextFree;
+    bool        mUnused;
+} BufferChunkNode;
+
+typedef struct BufferChunkOffsetNode
+{
+    uint32_t key;
+    uint32_t value;
+} BufferChunkOffsetNode;
+
+typedef struct BufferChunkHeap
+{
+    // Node 0 always starts at offset 0, nodes only merge into their previous physical neighbour
+    BufferChunkNode*       mNodes;
+    // Maps the offset of used chunks to their node so that removeGeometryBufferPart doesn't need to search
+    BufferChunkOffsetNode* mUsedNodes;
+    uint32_t               mRecycledNodes;
+    uint32_t               mUnusedChunkCount;
+    uint32_t               mUnusedSize;
+    uint32_t               mFlBitmap;
+    uint32_t               mSlBitmap[BCA_FL_COUNT];
+    uint32_t               mFreeHeads[BCA_FL_COUNT][BCA_SL_COUNT];
+} BufferChunkHeap;
+
+// Index of the most significant set bit, value must not be 0
+static inline uint32_t bcaFls(uint32_t value)
+{
+    ASSERT(value);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse(&index, value);
+    return (uint32_t)index;
+#else
+    return 31u - (uint32_t)__builtin_clz(value);
+#endif
 }
 
-void getResourceSizeAlign(const TextureLoadDesc* pDesc, ResourceSizeAlign* pOut)
+// Index of the least significant set bit, value must not be 0
+static inline uint32_t bcaFfs(uint32_t value)
 {
-    getTextureSizeAlign(pResourceLoader->ppRenderers[pDesc->mNodeIndex], pDesc->pDesc, pOut);
+    ASSERT(value);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctz(value);
+#endif
 }
 
-void addResource(BufferLoadDesc* pBufferDesc, SyncToken* token)
+static inline void bcaMappingInsert(uint32_t size, uint32_t* pFl, uint32_t* pSl)
 {
-    if (token)
+    if (size < BCA_SMALL_CHUNK_SIZE)
     {
-        *token = max<uint64_t>(0, *token);
+        *pFl = 0;
+        *pSl = size;
+        return;
     }
 
-    if (pBufferDesc->pData && !token)
+    const uint32_t fl = bcaFls(size);
+    *pSl = (size >> (fl - BCA_SL_COUNT_LOG2)) ^ BCA_SL_COUNT;
+    *pFl = fl - (BCA_FL_SHIFT - 1);
+}
+
+// Rounds size up to the next bucket so that any chunk in the returned bucket is big enough
+static inline bool bcaMappingSearch(uint32_t size, uint32_t* pFl, uint32_t* pSl)
+{
+    uint64_t roundedSize = size;
+    if (size >= BCA_SMALL_CHUNK_SIZE)
     {
-        LOADER_LOGF(eWARNING,
-                    "addResource : BufferLoadDesc(%s)::pData is non NULL but token is NULL. It is undefined behavior if pData is freed "
-                    "before the buffer load has completed on the ResourceLoader thread. Use waitForAllResourceLoads before freeing pData "
-                    "when explicit token was not passed",
-                    pBufferDesc->mDesc.pName ? pBufferDesc->mDesc.pName : "Unnamed");
+        roundedSize += (1ull << (bcaFls(size) - BCA_SL_COUNT_LOG2)) - 1;
+        if (roundedSize > UINT32_MAX)
+            return false;
     }
 
-    ResourceState startState = pBufferDesc->mDesc.mStartState;
-    if (RESOURCE_MEMORY_USAGE_GPU_ONLY == pBufferDesc->mDesc.mMemoryUsage && !pBufferDesc->mDesc.mStartState)
+    bcaMappingInsert((uint32_t)roundedSize, pFl, pSl);
+    return true;
+}
+
+static uint32_t bcaFindSuitableNode(BufferChunkHeap* pHeap, uint32_t* pFl, uint32_t* pSl)
+{
+    uint32_t fl = *pFl;
+    uint32_t slMap = pHeap->mSlBitmap[fl] & (~0u << *pSl);
+    if (!slMap)
     {
-        startState = ResourceStartState(&pBufferDesc->mDesc);
-        LOADER_LOGF(eWARNING, "Buffer start state not provided. Determined the start state as (%u) based on the provided BufferDesc",
-                    (uint32_t)pBufferDesc->mDesc.mStartState);
+        const uint32_t flMap = fl + 1 < BCA_FL_COUNT ? pHeap->mFlBitmap & (~0u << (fl + 1)) : 0;
+        if (!flMap)
+            return BCA_INVALID_NODE;
+
+        fl = bcaFfs(flMap);
+        slMap = pHeap->mSlBitmap[fl];
+        ASSERT(slMap);
     }
 
-    Renderer*  pRenderer = pResourceLoader->ppRenderers[pBufferDesc->mDesc.mNodeIndex];
-    const bool update = pBufferDesc->pData || pBufferDesc->mForceReset;
-    const bool gpuUpdate = pBufferDesc->mDesc.mMemoryUsage == RESOURCE_MEMORY_USAGE_GPU_ONLY && update && !gUma;
+    *pFl = fl;
+    *pSl = bcaFfs(slMap);
+    return pHeap->mFreeHeads[fl][*pSl];
+}
 
-    if (gpuUpdate)
+static uint32_t bcaAllocNode(BufferChunkHeap* pHeap)
+{
+    uint32_t index = pHeap->mRecycledNodes;
+    if (index != BCA_INVALID_NODE)
     {
-        pBufferDesc->mDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+        pHeap->mRecycledNodes = pHeap->mNodes[index].mNextFree;
     }
     else
     {
-        pBufferDesc->mDesc.mStartState = startState;
+        index = (uint32_t)arrlenu(pHeap->mNodes);
+        arrsetlen(pHeap->mNodes, index + 1);
     }
 
-    const uint64_t bufferSize = pBufferDesc->mDesc.mSize;
-    addBuffer(pRenderer, &pBufferDesc->mDesc, pBufferDesc->ppBuffer);
-
-    if (update)
-    {
-        BufferLoadDescInternal loadDesc = {};
-        loadDesc.mForceReset = pBufferDesc->mForceReset;
-        loadDesc.mStartState = startState;
-        loadDesc.pBuffer = *pBufferDesc->ppBuffer;
-        loadDesc.pData = pBufferDesc->pData;
-        loadDesc.mDataSize = bufferSize;
-        if (gpuUpdate && RESOURCE_MEMORY_USAGE_GPU_ONLY == loadDesc.pBuffer->mMemoryUsage)
-        {
-            loadDesc.pSrcBuffer = pBufferDesc->pSrcBuffer;
-            loadDesc.mSrcOffset = pBufferDesc->mSrcOffset;
-        }
-        else
-        {
-            ASSERT(!pBufferDesc->pSrcBuffer);
-            loadDesc.pSrcBuffer = loadDesc.pBuffer;
-            loadDesc.mSrcOffset = 0;
-        }
-        queueBufferLoad(pResourceLoader, &loadDesc, token);
-    }
+    BufferChunkNode* pNode = &pHeap->mNodes[index];
+    *pNode = {};
+    pNode->mPrevPhysical = BCA_INVALID_NODE;
+    pNode->mNextPhysical = BCA_INVALID_NODE;
+    pNode->mPrevFree = BCA_INVALID_NODE;
+    pNode->mNextFree = BCA_INVALID_NODE;
+    return index;
 }
 
-void addResource(TextureLoadDesc* pTextureDesc, SyncToken* token)
+static void bcaRecycleNode(BufferChunkHeap* pHeap, uint32_t index)
 {
-    ASSERT(pTextureDesc->ppTexture);
+    pHeap->mNodes[index].mNextFree = pHeap->mRecycledNodes;
+    pHeap->mRecycledNodes = index;
+}
 
-    if (token)
-    {
-        *token = max<uint64_t>(0, *token);
-    }
+static void bcaInsertFreeNode(BufferChunkHeap* pHeap, uint32_t index)
+{
+    BufferChunkNode* pNode = &pHeap->mNodes[index];
+    ASSERT(pNode->mChunk.mSize > 0);
+
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    bcaMappingInsert(pNode->mChunk.mSize, &fl, &sl);
+
+    const uint32_t head = pHeap->mFreeHeads[fl][sl];
+    pNode->mUnused = true;
+    pNode->mPrevFree = BCA_INVALID_NODE;
+    pNode->mNextFree = head;
+    if (head != BCA_INVALID_NODE)
+        pHeap->mNodes[head].mPrevFree = index;
+
+    pHeap->mFreeHeads[fl][sl] = index;
+    pHeap->mFlBitmap |= 1u << fl;
+    pHeap->mSlBitmap[fl] |= 1u << sl;
+
+    ++pHeap->mUnusedChunkCount;
+    pHeap->mUnusedSize += pNode->mChunk.mSize;
+}
 
-    if (!pTextureDesc->pFileName && pTextureDesc->pDesc)
-    {
-        ASSERT(pTextureDesc->pDesc->mStartState);
+static void bcaRemoveFreeNode(BufferChunkHeap* pHeap, uint32_t index)
+{
+    BufferChunkNode* pNode = &pHeap->mNodes[index];
+    ASSERT(pNode->mUnused);
 
-        TextureDesc textureDesc = *pTextureDesc->pDesc;
-#if defined(GFX_DRIVER_MANAGED_VIDEO_MEMORY)
-        if (pTextureDesc->mForceReset)
-        {
-            // If we are going to mem zero using staging buffer set start state to copy dest to avoid one barrier in the beginning
-            textureDesc.mStartState = RESOURCE_STATE_COPY_DEST;
-        }
-#endif
-        // If texture is supposed to be filled later (UAV / Update later / ...) proceed with the mStartState provided by the user in the
-        // texture description
-        addTexture(pResourceLoader->ppRenderers[pTextureDesc->mNodeIndex], &textureDesc, pTextureDesc->ppTexture);
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    bcaMappingInsert(pNode->mChunk.mSize, &fl, &sl);
 
-        if (pTextureDesc->mForceReset)
-        {
-#if !defined(GFX_DRIVER_MANAGED_VIDEO_MEMORY)
-            Texture* texture = *pTextureDesc->ppTexture;
-#if defined(ORBIS)
-            void*    ptr = texture->mStruct.mSrvDescriptor.getBaseAddress();
-            uint64_t size = texture->mStruct.mSrvDescriptor.getSizeAlign().m_size;
-#elif defined(PROSPERO)
-            void*    ptr = texture->mStruct.mSrv.getDataAddress();
-            uint64_t size = PROSPERO_RENDERER_NAMESPACE::getSize(&texture->mStruct.mSrv).m_size;
-#elif defined(XBOX)
-            void*               ptr = (void*)texture->mDx.pResource->GetGPUVirtualAddress();
-            D3D12_RESOURCE_DESC desc = texture->mDx.pResource->GetDesc();
-            uint64_t            size = 0;
-            pResourceLoader->ppRenderers[pTextureDesc->mNodeIndex]->mDx.pDevice->GetCopyableFootprints(
-                &desc, 0, desc.MipLevels * desc.DepthOrArraySize, 0, NULL, NULL, NULL, &size);
-#else
-#error : Not implemented
-#endif
-            memset(ptr, 0, size);
-#else
-            TextureLoadDescInternal loadDesc = {};
-            loadDesc.ppTexture = pTextureDesc->ppTexture;
-            loadDesc.mForceReset = true;
-            loadDesc.mStartState = pTextureDesc->pDesc->mStartState;
-            queueTextureLoad(pResourceLoader, &loadDesc, token);
-#endif
-            return;
-        }
+    if (pNode->mPrevFree != BCA_INVALID_NODE)
+        pHeap->mNodes[pNode->mPrevFree].mNextFree = pNode->mNextFree;
+    if (pNode->mNextFree != BCA_INVALID_NODE)
+        pHeap->mNodes[pNode->mNextFree].mPrevFree = pNode->mPrevFree;
 
-        if (IssueExplicitInitialStateBarrier())
+    if (pHeap->mFreeHeads[fl][sl] == index)
+    {
+        pHeap->mFreeHeads[fl][sl] = pNode->mNextFree;
+        if (pNode->mNextFree == BCA_INVALID_NODE)
         {
-            ResourceState startState = pTextureDesc->pDesc->mStartState;
-            // Check whether this is required (user specified a state other than undefined / common)
-            if (startState == RESOURCE_STATE_UNDEFINED || startState == RESOURCE_STATE_COMMON) //-V560
-            {
-                startState = ResourceStartState(pTextureDesc->pDesc->mDescriptors & DESCRIPTOR_TYPE_RW_TEXTURE);
-            }
-            queueTextureBarrier(pResourceLoader, *pTextureDesc->ppTexture, startState, token);
+            pHeap->mSlBitmap[fl] &= ~(1u << sl);
+            if (!pHeap->mSlBitmap[fl])
+                pHeap->mFlBitmap &= ~(1u << fl);
         }
     }
-    else
-    {
-        TextureLoadDescInternal loadDesc = {};
-        loadDesc.ppTexture = pTextureDesc->ppTexture;
-        loadDesc.mContainer = pTextureDesc->mContainer;
-        loadDesc.mFlags = pTextureDesc->mCreationFlag;
-        loadDesc.mNodeIndex = pTextureDesc->mNodeIndex;
-        loadDesc.pFileName = pTextureDesc->pFileName;
-        loadDesc.pYcbcrSampler = pTextureDesc->pYcbcrSampler;
-        queueTextureLoad(pResourceLoader, &loadDesc, token);
-    }
+
+    pNode->mUnused = false;
+    pNode->mPrevFree = BCA_INVALID_NODE;
+    pNode->mNextFree = BCA_INVALID_NODE;
+
+    ASSERT(pHeap->mUnusedChunkCount);
+    --pHeap->mUnusedChunkCount;
+    pHeap->mUnusedSize -= pNode->mChunk.mSize;
 }
 
-void addResource(GeometryLoadDesc* pDesc, SyncToken* token)
+// Splits the node at the given offset (relative to the node start), returns the node covering the second half.
+// The node keeps its index and covers the first half.
+static uint32_t bcaSplitNode(BufferChunkHeap* pHeap, uint32_t index, uint32_t splitOffset)
 {
-    ASSERT(pDesc->pVertexLayout);
-    ASSERT(pDesc->ppGeometry);
-
-    GeometryLoadDesc updateDesc = *pDesc;
-    updateDesc.pFileName = pDesc->pFileName;
+    const uint32_t newIndex = bcaAllocNode(pHeap);
+    // bcaAllocNode may have reallocated the node array
+    BufferChunkNode* pNode = &pHeap->mNodes[index];
+    BufferChunkNode* pNewNode = &pHeap->mNodes[newIndex];
+    ASSERT(splitOffset > 0 && splitOffset < pNode->mChunk.mSize);
+
+    pNewNode->mChunk.mOffset = pNode->mChunk.mOffset + splitOffset;
+    pNewNode->mChunk.mSize = pNode->mChunk.mSize - splitOffset;
+    pNewNode->mPrevPhysical = index;
+    pNewNode->mNextPhysical = pNode->mNextPhysical;
+    if (pNode->mNextPhysical != BCA_INVALID_NODE)
+        pHeap->mNodes[pNode->mNextPhysical].mPrevPhysical = newIndex;
+
+    pNode->mChunk.mSize = splitOffset;
+    pNode->mNextPhysical = newIndex;
+    return newIndex;
+}
 
-    uint32_t extraSize = sizeof(VertexLayout);
+// Merges the node with its next physical neighbour, the neighbour node gets recycled
+static void bcaMergeWithNext(BufferChunkHeap* pHeap, uint32_t index)
+{
+    BufferChunkNode* pNode = &pHeap->mNodes[index];
+    const uint32_t   nextIndex = pNode->mNextPhysical;
+    BufferChunkNode* pNext = &pHeap->mNodes[nextIndex];
+    ASSERT(pNode->mChunk.mOffset + pNode->mChunk.mSize == pNext->mChunk.mOffset);
 
-    VertexLayout* pCopyVertexLayout = (VertexLayout*)tf_malloc(extraSize);
-    memcpy(pCopyVertexLayout, pDesc->pVertexLayout, sizeof(VertexLayout));
-    updateDesc.pVertexLayout = pCopyVertexLayout;
+    pNode->mChunk.mSize += pNext->mChunk.mSize;
+    pNode->mNextPhysical = pNext->mNextPhysical;
+    if (pNext->mNextPhysical != BCA_INVALID_NODE)
+        pHeap->mNodes[pNext->mNextPhysical].mPrevPhysical = index;
 
-    queueGeometryLoad(pResourceLoader, &updateDesc, token);
+    bcaRecycleNode(pHeap, nextIndex);
 }
 
-void removeResource(Buffer* pBuffer) { removeBuffer(pResourceLoader->ppRenderers[pBuffer->mNodeIndex], pBuffer); }
-
-void removeResource(Texture* pTexture) { removeTexture(pResourceLoader->ppRenderers[pTexture->mNodeIndex], pTexture); }
-
-void removeResource(Geometry* pGeom)
+// Takes [offset, offset + size) out of the unused node, any memory left before or after goes back to the free lists
+static void bcaClaimNode(BufferChunkAllocator* pBuffer, uint32_t index, uint32_t offset, uint32_t size, BufferChunk* pOut)
 {
-    if (!pGeom)
-        return;
+    BufferChunkHeap* pHeap = pBuffer->pHeap;
+    bcaRemoveFreeNode(pHeap, index);
 
-    if (pGeom->pGeometryBuffer)
-    {
-        removeGeometryBufferPart(&pGeom->pGeometryBuffer->mIndex, &pGeom->mIndexBufferChunk);
+    const BufferChunk chunk = pHeap->mNodes[index].mChunk;
+    ASSERT(offset >= chunk.mOffset && offset + size <= chunk.mOffset + chunk.mSize);
 
-        for (uint32_t i = 0; i < pGeom->mVertexBufferCount; ++i)
-        {
-            removeGeometryBufferPart(&pGeom->pGeometryBuffer->mVertex[i], &pGeom->mVertexBufferChunks[i]);
-        }
-    }
-    else
+    if (offset > chunk.mOffset)
     {
-        removeResource(pGeom->pIndexBuffer);
+        // There's unnused memory before the claimed chunk
+        const uint32_t claimedIndex = bcaSplitNode(pHeap, index, offset - chunk.mOffset);
+        bcaInsertFreeNode(pHeap, index);
+        index = claimedIndex;
+    }
 
-        for (uint32_t i = 0; i < pGeom->mVertexBufferCount; ++i)
-        {
-            removeResource(pGeom->pVertexBuffers[i]);
-        }
+    if (offset + size < chunk.mOffset + chunk.mSize)
+    {
+        // There's unnused memory after the claimed chunk
+        const uint32_t remainderIndex = bcaSplitNode(pHeap, index, size);
+        bcaInsertFreeNode(pHeap, remainderIndex);
     }
 
-    tf_free(pGeom->meshlets.mMeshlets);
-    tf_free(pGeom);
+    BufferChunkOffsetNode usedNode = { offset, index };
+    hmputs(pHeap->mUsedNodes, usedNode);
+
+    pOut->mOffset = offset;
+    pOut->mSize = size;
+    ++pBuffer->mUsedChunkCount;
 }
 
-void removeResource(GeometryData* pGeom)
+static inline uint32_t bcaAlignedOffset(uint32_t offset, uint32_t alignment)
 {
-    removeGeometryShadowData(pGeom);
-    tf_free(pGeom);
+    if (alignment <= 1)
+        return offset;
+
+    const uint32_t padding = offset % alignment;
+    return padding > 0 ? offset + (alignment - padding) : offset;
 }
 
-void removeGeometryShadowData(GeometryData* pGeom)
+static inline bool bcaNodeFits(const BufferChunkNode* pNode, uint32_t size, uint32_t alignment, uint32_t* pOutOffset)
 {
-    if (pGeom->pShadow)
-    {
-        tf_free(pGeom->pShadow);
-        pGeom->pShadow = nullptr;
+    const uint64_t alignedOffset = bcaAlignedOffset(pNode->mChunk.mOffset, alignment);
+    if (alignedOffset + size > (uint64_t)pNode->mChunk.mOffset + pNode->mChunk.mSize)
+        return false;
+
+    *pOutOffset = (uint32_t)alignedOffset;
+    return true;
+}
+
+// The whole [0, size) range starts as a single unused chunk
+static void bcaInitHeap(BufferChunkAllocator* pOut, uint32_t size)
+{
+    pOut->mSize = size;
+    pOut->mUsedChunkCount = 0;
+
+    BufferChunkHeap* pHeap = (BufferChunkHeap*)tf_calloc(1, sizeof(BufferChunkHeap));
+    ASSERT(pHeap);
+    memset(pHeap->mFreeHeads, 0xFF, sizeof(pHeap->mFreeHeads));
+    pHeap->mRecycledNodes = BCA_INVALID_NODE;
+    pOut->pHeap = pHeap;
+
+    if (pOut->mSize)
+    {
+        const uint32_t firstNode = bcaAllocNode(pHeap);
+        ASSERT(firstNode == 0);
+        pHeap->mNodes[firstNode].mChunk = { 0, pOut->mSize };
+        bcaInsertFreeNode(pHeap, firstNode);
     }
 }
 
+static void bcaExitHeap(BufferChunkAllocator* pBuffer)
+{
+    BufferChunkHeap* pHeap = pBuffer->pHeap;
+    arrfree(pHeap->mNodes);
+    hmfree(pHeap->mUsedNodes);
+    tf_free(pHeap);
+    pBuffer->pHeap = NULL;
+}
+
 // Interface to add/remove BufferChunkAllocators is currently private but we could expose it in the IResourceLoader interface if needed
 typedef struct BufferChunkAllocatorDesc
 {
@@ -3456,12 +6675,10 @@ static void addBufferChunkAllocator(BufferChunkAllocatorDesc* pDesc, BufferChunk
 {
     ASSERT(pDesc);
     ASSERT(pOut);
+    ASSERT(pDesc->pBuffer->mSize <= UINT32_MAX);
 
     pOut->pBuffer = pDesc->pBuffer;
-    pOut->mSize = (uint32_t)pDesc->pBuffer->mSize;
-
-    BufferChunk firstUnusedChunk{ 0, (uint32_t)pDesc->pBuffer->mSize };
-    arrpush(pOut->mUnusedChunks, firstUnusedChunk);
+    bcaInitHeap(pOut, (uint32_t)pDesc->pBuffer->mSize);
 }
 
 static void removeBufferChunkAllocator(BufferChunkAllocator* pBuffer)
@@ -3471,7 +6688,9 @@ static void removeBufferChunkAllocator(BufferChunkAllocator* pBuffer)
 
     if (pBuffer->pBuffer)
     {
-        ASSERT(arrlen(pBuffer->mUnusedChunks) == 1 && "Expecting just one chunk since the buffer is completely empty");
+        BufferChunkHeap* pHeap = pBuffer->pHeap;
+        ASSERT(pHeap);
+        ASSERT(pHeap->mUnusedChunkCount <= 1 && "Expecting just one chunk since the buffer is completely empty");
 
         // We are checking that the unnused chunk offset is 0 because we currently assume that a BufferChunkAllocator covers the entire
         // buffer, but we could change this to allow to have several BufferChunkAllocators over the same buffer, each working on a fixed
@@ -3489,10 +6708,11 @@ static void removeBufferChunkAllocator(BufferChunkAllocator* pBuffer)
         //       if mSize is 0 we would use the size of the buffer.
         //       We would also need to consider if we want to expose the add/removeBufferChunkAllocator interface to the user and let him
         //       allocate the BufferChunkAllocator or we want to include this splitting logic in addGeometryBuffer.
-        ASSERT(pBuffer->mUnusedChunks && (pBuffer->mUnusedChunks[0].mOffset == 0) && (pBuffer->mUnusedChunks[0].mSize == pBuffer->mSize) &&
+        ASSERT((!pBuffer->mSize || (pHeap->mNodes[0].mUnused && pHeap->mNodes[0].mChunk.mOffset == 0 &&
+                                    pHeap->mNodes[0].mChunk.mSize == pBuffer->mSize)) &&
                "Expecting just one chunk since the buffer is completely empty");
 
-        arrfree(pBuffer->mUnusedChunks);
+        bcaExitHeap(pBuffer);
     }
 }
 
@@ -3579,157 +6799,316 @@ void addGeometryBufferPart(BufferChunkAllocator* pBuffer, uint32_t size, uint32_
         return;
     }
 
+    BufferChunkHeap* pHeap = pBuffer->pHeap;
+    ASSERT(pHeap);
+
     if (pRequestedChunk)
     {
         ASSERT(pRequestedChunk->mOffset + pRequestedChunk->mSize <= pBuffer->mSize);
 
-        // Try to allocate the requested slot
-        for (uint32_t i = 0; i < arrlenu(pBuffer->mUnusedChunks); ++i)
+        // Requested slots are only used to reserve fixed memory ranges, walk the chunks in address order to find the one containing it
+        for (uint32_t i = arrlenu(pHeap->mNodes) ? 0 : BCA_INVALID_NODE; i != BCA_INVALID_NODE; i = pHeap->mNodes[i].mNextPhysical)
         {
-            BufferChunk* chunk = &pBuffer->mUnusedChunks[i];
+            const BufferChunkNode* pNode = &pHeap->mNodes[i];
+            const uint32_t         chunkEnd = pNode->mChunk.mOffset + pNode->mChunk.mSize;
+            const uint32_t         requestedEnd = pRequestedChunk->mOffset + pRequestedChunk->mSize;
+            if (pNode->mChunk.mOffset > pRequestedChunk->mOffset)
+                break;
+            if (!pNode->mUnused || chunkEnd < requestedEnd)
+                continue;
 
-            const uint32_t chunkEnd = chunk->mOffset + chunk->mSize;
-            const uint32_t requestedEnd = pRequestedChunk->mOffset + pRequestedChunk->mSize;
-            if (chunk->mOffset <= pRequestedChunk->mOffset && chunkEnd >= requestedEnd)
-            {
-                ++pBuffer->mUsedChunkCount;
+            bcaClaimNode(pBuffer, i, pRequestedChunk->mOffset, pRequestedChunk->mSize, pOut);
+            return;
+        }
 
-                *pOut = *pRequestedChunk;
+        ASSERT(false && "Failed to allocate the requested chunk");
+        return;
+    }
 
-                if (chunk->mOffset == pRequestedChunk->mOffset && chunkEnd == requestedEnd)
-                {
-                    // Exact chunk
-                    arrdel(pBuffer->mUnusedChunks, i);
-                    return;
-                }
+    // Search for a bucket where every chunk can hold the size plus the worst case alignment padding, this is O(1)
+    uint32_t       fl = 0;
+    uint32_t       sl = 0;
+    const uint64_t worstCaseSize = (uint64_t)size + (alignment > 1 ? alignment - 1 : 0);
+    if (worstCaseSize <= pBuffer->mSize && bcaMappingSearch((uint32_t)worstCaseSize, &fl, &sl))
+    {
+        const uint32_t index = bcaFindSuitableNode(pHeap, &fl, &sl);
+        uint32_t       offset = 0;
+        if (index != BCA_INVALID_NODE && bcaNodeFits(&pHeap->mNodes[index], size, alignment, &offset))
+        {
+            bcaClaimNode(pBuffer, index, offset, size, pOut);
+            return;
+        }
+    }
 
-                // There's unnused memory before the requested chunk
-                if (chunk->mOffset < pRequestedChunk->mOffset)
-                {
-                    BufferChunk prevChunk = { chunk->mOffset, pRequestedChunk->mOffset - chunk->mOffset };
-                    arrins(pBuffer->mUnusedChunks, i, prevChunk);
-                    i++;
-                    chunk = &pBuffer->mUnusedChunks[i];
-                }
+    // When the buffer is almost full there might still be a chunk in lower buckets that fits, check every chunk that could hold size
+    bcaMappingInsert(size, &fl, &sl);
+    for (uint32_t flMap = pHeap->mFlBitmap & (~0u << fl); flMap; flMap &= flMap - 1)
+    {
+        const uint32_t curFl = bcaFfs(flMap);
+        uint32_t       slMap = pHeap->mSlBitmap[curFl];
+        if (curFl == fl)
+            slMap &= ~0u << sl;
 
-                if (chunkEnd == requestedEnd)
-                {
-                    // We consummed the full chunk
-                    arrdel(pBuffer->mUnusedChunks, i);
-                }
-                else
+        for (; slMap; slMap &= slMap - 1)
+        {
+            for (uint32_t i = pHeap->mFreeHeads[curFl][bcaFfs(slMap)]; i != BCA_INVALID_NODE; i = pHeap->mNodes[i].mNextFree)
+            {
+                uint32_t offset = 0;
+                if (bcaNodeFits(&pHeap->mNodes[i], size, alignment, &offset))
                 {
-                    // There's unnused memory after the requested chunk
-                    chunk->mSize = chunkEnd - requestedEnd;
-                    chunk->mOffset = pRequestedChunk->mOffset + pRequestedChunk->mSize;
-                    ASSERT(chunk->mSize > 0);
+                    bcaClaimNode(pBuffer, i, offset, size, pOut);
+                    return;
                 }
-
-                return;
             }
         }
+    }
 
-        ASSERT(false && "Failed to allocate the requested chunk");
+    *pOut = {};
+    ASSERT(false);
+}
+
+void removeGeometryBufferPart(BufferChunkAllocator* pBuffer, BufferChunk* pChunk)
+{
+    ASSERT(pChunk->mSize ? pBuffer != NULL : true);
+    if (!pBuffer || pChunk->mSize == 0)
+        return;
+
+    ASSERT(pBuffer->mUsedChunkCount);
+
+    BufferChunkHeap* pHeap = pBuffer->pHeap;
+    ASSERT(pHeap);
+
+    const ptrdiff_t usedIndex = hmgeti(pHeap->mUsedNodes, pChunk->mOffset);
+    if (!VERIFYMSG(usedIndex >= 0, "Chunk at offset %u was not allocated from this buffer", pChunk->mOffset))
         return;
+
+    uint32_t index = pHeap->mUsedNodes[usedIndex].value;
+    (void)hmdel(pHeap->mUsedNodes, pChunk->mOffset);
+    ASSERT(!pHeap->mNodes[index].mUnused && pHeap->mNodes[index].mChunk.mSize == pChunk->mSize);
+
+    --pBuffer->mUsedChunkCount;
+
+    // Merge with free neighbours right away so that free memory is always made of the biggest possible chunks
+    const uint32_t prevIndex = pHeap->mNodes[index].mPrevPhysical;
+    if (prevIndex != BCA_INVALID_NODE && pHeap->mNodes[prevIndex].mUnused)
+    {
+        bcaRemoveFreeNode(pHeap, prevIndex);
+        bcaMergeWithNext(pHeap, prevIndex);
+        index = prevIndex;
     }
 
-    // TODO binary search. (unused chunk array is sorted already)
-    for (uint32_t i = 0; i < arrlenu(pBuffer->mUnusedChunks); ++i)
+    const uint32_t nextIndex = pHeap->mNodes[index].mNextPhysical;
+    if (nextIndex != BCA_INVALID_NODE && pHeap->mNodes[nextIndex].mUnused)
     {
-        BufferChunk* chunk = &pBuffer->mUnusedChunks[i];
+        bcaRemoveFreeNode(pHeap, nextIndex);
+        bcaMergeWithNext(pHeap, index);
+    }
 
-        if (chunk->mSize < size)
-            continue;
+    bcaInsertFreeNode(pHeap, index);
+}
 
-        if (alignment > 0)
-        {
-            uint32_t padding = chunk->mOffset % alignment;
-            if (padding > 0)
-                padding = alignment - padding;
+void getBufferChunkAllocatorStats(const BufferChunkAllocator* pBuffer, BufferChunkAllocatorStats* pOutStats)
+{
+    ASSERT(pBuffer);
+    ASSERT(pOutStats);
 
-            if (chunk->mSize - padding < size)
-                continue;
+    *pOutStats = {};
+    const BufferChunkHeap* pHeap = pBuffer->pHeap;
+    if (!pHeap)
+        return;
 
-            if (padding > 0)
-            {
-                BufferChunk paddingChunk = {
-                    chunk->mOffset,
-                    padding,
-                };
+    pOutStats->mSize = pBuffer->mSize;
+    pOutStats->mUsedChunkCount = pBuffer->mUsedChunkCount;
+    pOutStats->mUnusedChunkCount = pHeap->mUnusedChunkCount;
+    pOutStats->mUnusedSize = pHeap->mUnusedSize;
+    pOutStats->mUsedSize = pBuffer->mSize - pHeap->mUnusedSize;
 
-                arrins(pBuffer->mUnusedChunks, i, paddingChunk);
-                i++;
+    if (!pHeap->mFlBitmap)
+        return;
 
-                chunk = &pBuffer->mUnusedChunks[i];
-                chunk->mOffset += padding;
-                chunk->mSize -= padding;
-            }
-        }
+    // The largest chunk lives in the highest non empty bucket, buckets cover a range of sizes so we still need to check its list
+    const uint32_t fl = bcaFls(pHeap->mFlBitmap);
+    const uint32_t sl = bcaFls(pHeap->mSlBitmap[fl]);
+    for (uint32_t i = pHeap->mFreeHeads[fl][sl]; i != BCA_INVALID_NODE; i = pHeap->mNodes[i].mNextFree)
+        pOutStats->mLargestUnusedChunkSize = max(pOutStats->mLargestUnusedChunkSize, pHeap->mNodes[i].mChunk.mSize);
 
-        pOut->mOffset = chunk->mOffset;
-        pOut->mSize = size;
+    pOutStats->mFragmentation = 1.0f - (float)pOutStats->mLargestUnusedChunkSize / (float)pOutStats->mUnusedSize;
+}
 
-        chunk->mOffset += size;
-        chunk->mSize -= size;
+uint32_t getBufferChunkAllocatorUnusedChunks(const BufferChunkAllocator* pBuffer, BufferChunk* pOutChunks, uint32_t maxChunkCount)
+{
+    ASSERT(pBuffer);
+    const BufferChunkHeap* pHeap = pBuffer->pHeap;
+    if (!pHeap)
+        return 0;
 
-        if (chunk->mSize == 0)
+    if (pOutChunks)
+    {
+        uint32_t count = 0;
+        for (uint32_t i = arrlenu(pHeap->mNodes) ? 0 : BCA_INVALID_NODE; i != BCA_INVALID_NODE && count < maxChunkCount;
+             i = pHeap->mNodes[i].mNextPhysical)
         {
-            arrdel(pBuffer->mUnusedChunks, i);
+            if (pHeap->mNodes[i].mUnused)
+                pOutChunks[count++] = pHeap->mNodes[i].mChunk;
         }
-
-        ++pBuffer->mUsedChunkCount;
-        return;
     }
 
-    *pOut = {};
-    ASSERT(false);
+    return pHeap->mUnusedChunkCount;
 }
 
-void removeGeometryBufferPart(BufferChunkAllocator* pBuffer, BufferChunk* pChunk)
+#if defined(FORGE_DEBUG) && defined(ENABLE_BUFFER_CHUNK_ALLOCATOR_TEST)
+#define BCA_TEST_MAX_CHUNKS 256
+
+static inline uint32_t bcaTestRandom(uint32_t* pState)
 {
-    ASSERT(pChunk->mSize ? pBuffer != NULL : true);
-    if (!pBuffer || pChunk->mSize == 0)
-        return;
+    // xorshift32, the sequence only depends on the seed
+    uint32_t x = *pState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pState = x;
+    return x;
+}
 
-    ASSERT(pBuffer->mUsedChunkCount);
+// Offset where size fits with alignment in the unused memory, UINT32_MAX when it doesn't fit anywhere.
+// Walks the unused chunks reported by the allocator so it doesn't rely on its buckets.
+static uint32_t bcaTestFindFit(const BufferChunk* pUnused, uint32_t unusedCount, uint32_t size, uint32_t alignment)
+{
+    for (uint32_t i = 0; i < unusedCount; ++i)
+    {
+        const uint64_t offset = bcaAlignedOffset(pUnused[i].mOffset, alignment);
+        if (offset + size <= (uint64_t)pUnused[i].mOffset + pUnused[i].mSize)
+            return (uint32_t)offset;
+    }
+    return UINT32_MAX;
+}
 
-    --pBuffer->mUsedChunkCount;
+// Checks the live chunks against each other and against the unused chunks reported by the allocator
+static bool bcaTestValidate(const BufferChunkAllocator* pBuffer, const BufferChunk* pLive, const uint32_t* pLiveAlignments,
+                            uint32_t liveCount, BufferChunk* pUnused, uint32_t* pUnusedCount)
+{
+    uint64_t liveSize = 0;
+    for (uint32_t i = 0; i < liveCount; ++i)
+    {
+        const BufferChunk* pChunk = &pLive[i];
+        if (pChunk->mOffset % pLiveAlignments[i] != 0 || (uint64_t)pChunk->mOffset + pChunk->mSize > pBuffer->mSize)
+        {
+            LOGF(eERROR, "BufferChunkAllocator test: chunk [%u, %u) is misaligned (%u) or out of the buffer", pChunk->mOffset,
+                 pChunk->mOffset + pChunk->mSize, pLiveAlignments[i]);
+            return false;
+        }
+        for (uint32_t j = i + 1; j < liveCount; ++j)
+        {
+            if (pChunk->mOffset < pLive[j].mOffset + pLive[j].mSize && pLive[j].mOffset < pChunk->mOffset + pChunk->mSize)
+            {
+                LOGF(eERROR, "BufferChunkAllocator test: chunks [%u, %u) and [%u, %u) overlap", pChunk->mOffset,
+                     pChunk->mOffset + pChunk->mSize, pLive[j].mOffset, pLive[j].mOffset + pLive[j].mSize);
+                return false;
+            }
+        }
+        liveSize += pChunk->mSize;
+    }
 
-    const uint64_t partEnd = pChunk->mOffset + pChunk->mSize;
+    BufferChunkAllocatorStats stats = {};
+    getBufferChunkAllocatorStats(pBuffer, &stats);
+    if (stats.mUsedChunkCount != liveCount || stats.mUsedSize != liveSize || stats.mUsedSize + stats.mUnusedSize != pBuffer->mSize)
+    {
+        LOGF(eERROR, "BufferChunkAllocator test: %u chunks of %llu bytes are live but the allocator reports %u chunks of %u bytes",
+             liveCount, (unsigned long long)liveSize, stats.mUsedChunkCount, stats.mUsedSize);
+        return false;
+    }
 
-    // TODO binary search. (unused chunk array is sorted already)
-    uint64_t i = 0;
-    for (; i < arrlenu(pBuffer->mUnusedChunks); ++i)
+    // Released chunks merge with their unused neighbours right away, two unused chunks are never adjacent
+    const uint32_t unusedCount = getBufferChunkAllocatorUnusedChunks(pBuffer, pUnused, BCA_TEST_MAX_CHUNKS + 1);
+    for (uint32_t i = 1; i < unusedCount; ++i)
     {
-        BufferChunk* chunk = &pBuffer->mUnusedChunks[i];
-        if (partEnd < chunk->mOffset)
-            break;
+        if (pUnused[i - 1].mOffset + pUnused[i - 1].mSize >= pUnused[i].mOffset)
+        {
+            LOGF(eERROR, "BufferChunkAllocator test: unused chunks [%u, %u) and [%u, %u) were not coalesced", pUnused[i - 1].mOffset,
+                 pUnused[i - 1].mOffset + pUnused[i - 1].mSize, pUnused[i].mOffset, pUnused[i].mOffset + pUnused[i].mSize);
+            return false;
+        }
+    }
+    *pUnusedCount = unusedCount;
+    return true;
+}
+
+// Randomized allocation and release sequence on a CPU only allocator. Every allocation is checked for alignment and overlap, the
+// allocator must succeed whenever some unused chunk fits the request and releasing everything has to give back a single chunk.
+// Part of the requests take exactly the size of an unused chunk with alignment padding, those can only be found by the walk of
+// the lower buckets in addGeometryBufferPart.
+static bool testBufferChunkAllocator(uint32_t size, uint32_t operationCount, uint32_t seed)
+{
+    BufferChunkAllocator allocator = {};
+    bcaInitHeap(&allocator, size);
 
-        auto chunkEnd = chunk->mOffset + chunk->mSize;
-        if (chunkEnd == pChunk->mOffset) // if pChunk goes after chunk, merge both
+    BufferChunk live[BCA_TEST_MAX_CHUNKS] = {};
+    uint32_t    liveAlignments[BCA_TEST_MAX_CHUNKS] = {};
+    uint32_t    liveCount = 0;
+    BufferChunk unused[BCA_TEST_MAX_CHUNKS + 1] = {};
+    uint32_t    unusedCount = 0;
+    uint32_t    state = seed ? seed : 1;
+    bool        success = bcaTestValidate(&allocator, live, liveAlignments, liveCount, unused, &unusedCount);
+
+    for (uint32_t op = 0; success && op < operationCount; ++op)
+    {
+        const uint32_t action = bcaTestRandom(&state) % 8;
+        if (liveCount > 0 && (action < 3 || liveCount == BCA_TEST_MAX_CHUNKS))
+        {
+            const uint32_t index = bcaTestRandom(&state) % liveCount;
+            removeGeometryBufferPart(&allocator, &live[index]);
+            live[index] = live[liveCount - 1];
+            liveAlignments[index] = liveAlignments[liveCount - 1];
+            --liveCount;
+        }
+        else
         {
-            chunk->mSize += pChunk->mSize;
-            if (i + 1 < arrlenu(pBuffer->mUnusedChunks)) // If there's another empty chunk after pChunk, merge that one too
+            uint32_t alignment = 1u << (bcaTestRandom(&state) % 9);
+            uint32_t requestSize = 1 + bcaTestRandom(&state) % (size / 16);
+            if (action == 7 && unusedCount > 0)
             {
-                if (partEnd == pBuffer->mUnusedChunks[i + 1].mOffset)
-                {
-                    chunk->mSize += pBuffer->mUnusedChunks[i + 1].mSize;
-                    arrdel(pBuffer->mUnusedChunks, i + 1);
-                }
+                // Tight fit: the worst case alignment padding makes the bucket search skip the only chunk that fits
+                const BufferChunk* pTarget = &unused[bcaTestRandom(&state) % unusedCount];
+                alignment = pTarget->mOffset ? min(1u << bcaFfs(pTarget->mOffset), 256u) : 256u;
+                requestSize = pTarget->mSize;
             }
-            return;
-        }
 
-        if (partEnd == chunk->mOffset) // If pChunk goes after chunk, merge both
-        {
-            chunk->mOffset = pChunk->mOffset;
-            chunk->mSize += pChunk->mSize;
-            return;
+            if (bcaTestFindFit(unused, unusedCount, requestSize, alignment) == UINT32_MAX)
+                continue;
+
+            BufferChunk chunk = {};
+            addGeometryBufferPart(&allocator, requestSize, alignment, &chunk);
+            if (chunk.mSize != requestSize)
+            {
+                LOGF(eERROR, "BufferChunkAllocator test: failed to allocate %u bytes aligned to %u although they fit", requestSize,
+                     alignment);
+                success = false;
+                break;
+            }
+            live[liveCount] = chunk;
+            liveAlignments[liveCount] = alignment;
+            ++liveCount;
         }
+
+        success = bcaTestValidate(&allocator, live, liveAlignments, liveCount, unused, &unusedCount);
+    }
+
+    while (liveCount > 0)
+        removeGeometryBufferPart(&allocator, &live[--liveCount]);
+
+    BufferChunkAllocatorStats stats = {};
+    getBufferChunkAllocatorStats(&allocator, &stats);
+    if (success && (stats.mUnusedChunkCount != 1 || stats.mLargestUnusedChunkSize != size))
+    {
+        LOGF(eERROR, "BufferChunkAllocator test: %u unused chunks left after releasing everything, the largest has %u of %u bytes",
+             stats.mUnusedChunkCount, stats.mLargestUnusedChunkSize, size);
+        success = false;
     }
 
-    arrins(pBuffer->mUnusedChunks, i, *pChunk);
+    bcaExitHeap(&allocator);
+    return success;
 }
+#endif
 
 void beginUpdateResource(BufferUpdateDesc* pBufferUpdate)
 {
@@ -3935,7 +7314,82 @@ void flushResourceUpdates(FlushResourceUpdateDesc* pDesc)
 
 SyncToken getLastTokenCompleted() { return tfrg_atomic64_load_acquire(&pResourceLoader->mTokenCompleted); }
 
-bool isTokenCompleted(const SyncToken* token) { return *token <= tfrg_atomic64_load_acquire(&pResourceLoader->mTokenCompleted); }
+bool isTokenCompleted(const SyncToken* token)
+{
+    if (*token <= tfrg_atomic64_load_acquire(&pResourceLoader->mTokenCompleted))
+    {
+        return true;
+    }
+
+    // Requests with different priorities complete out of order. A completed token is only reported once every older
+    // request of the same or a higher priority completed as well, which keeps the FIFO guarantee within a priority level.
+    bool completed = false;
+    acquireMutex(&pResourceLoader->mQueueMutex);
+    const PendingToken* pPending = findPendingToken(pResourceLoader, *token);
+    if (pPending && pPending->mState == PENDING_TOKEN_STATE_COMPLETED)
+    {
+        completed = true;
+        for (const PendingToken* pOlder = pResourceLoader->pPendingTokens; pOlder != pPending; ++pOlder)
+        {
+            if (pOlder->mState != PENDING_TOKEN_STATE_COMPLETED && pOlder->mLevel >= pPending->mLevel)
+            {
+                completed = false;
+                break;
+            }
+        }
+    }
+    releaseMutex(&pResourceLoader->mQueueMutex);
+
+    return completed;
+}
+
+bool raiseResourceLoadPriority(const SyncToken* token, ResourceLoadPriority priority)
+{
+    ASSERT(token);
+    const uint32_t level = getPriorityLevel(priority);
+    bool           raised = false;
+
+    acquireMutex(&pResourceLoader->mQueueMutex);
+    for (uint32_t nodeIndex = 0; nodeIndex < pResourceLoader->mGpuCount && !raised; ++nodeIndex)
+    {
+        for (uint32_t l = 0; l < level && !raised; ++l)
+        {
+            UpdateRequest* pRequestQueue = pResourceLoader->mRequestQueue[nodeIndex][l];
+            for (uint32_t i = pResourceLoader->mRequestQueueHead[nodeIndex][l]; i < (uint32_t)arrlen(pRequestQueue); ++i)
+            {
+                if (pRequestQueue[i].mWaitIndex != *token)
+                {
+                    continue;
+                }
+
+                UpdateRequest request = pRequestQueue[i];
+                removeQueuedRequest(pResourceLoader, nodeIndex, l, i);
+
+                // Keep the target level sorted by token so it stays FIFO
+                UpdateRequest** pTargetQueue = &pResourceLoader->mRequestQueue[nodeIndex][level];
+                uint32_t        insertIndex = (uint32_t)arrlen(*pTargetQueue);
+                while (insertIndex > pResourceLoader->mRequestQueueHead[nodeIndex][level] &&
+                       (*pTargetQueue)[insertIndex - 1].mWaitIndex > request.mWaitIndex)
+                {
+                    --insertIndex;
+                }
+                arrins(*pTargetQueue, insertIndex, request);
+
+                PendingToken* pPending = findPendingToken(pResourceLoader, *token);
+                ASSERT(pPending);
+                if (pPending)
+                {
+                    pPending->mLevel = level;
+                }
+                raised = true;
+                break;
+            }
+        }
+    }
+    releaseMutex(&pResourceLoader->mQueueMutex);
+
+    return raised;
+}
 
 void waitForToken(const SyncToken* token) { waitForToken(pResourceLoader, token); }
 
@@ -3971,9 +7425,266 @@ Semaphore* getLastSemaphoreSubmitted(uint32_t nodeIndex)
     return sem;
 }
 
+void getResourceLoaderStats(ResourceLoaderStats* pOutStats)
+{
+    ASSERT(pOutStats);
+    acquireMutex(&pResourceLoader->mStatistics.mMutex);
+    *pOutStats = pResourceLoader->mStatistics.mStats;
+    releaseMutex(&pResourceLoader->mStatistics.mMutex);
+}
+
+void resetResourceLoaderStats()
+{
+    acquireMutex(&pResourceLoader->mStatistics.mMutex);
+    pResourceLoader->mStatistics.mStats = {};
+    releaseMutex(&pResourceLoader->mStatistics.mMutex);
+}
+
+void beginResourceLoadReport()
+{
+    ResourceLoaderStatistics* pStatistics = &pResourceLoader->mStatistics;
+    acquireMutex(&pStatistics->mMutex);
+    ASSERT(!pStatistics->mReportActive);
+    pStatistics->mReportStats = {};
+    arrsetlen(pStatistics->pRecords, 0);
+    pStatistics->mSubmittedRecordCount = 0;
+    pStatistics->mCompletedRecordCount = 0;
+    pStatistics->mReportStartTime = getUSec(false);
+    pStatistics->mReportActive = true;
+    releaseMutex(&pStatistics->mMutex);
+}
+
+static void writeLoadPhasesJson(bstring* pOutput, const int64_t* pPhaseTimes)
+{
+    bcatliteral(pOutput, "{ ");
+    for (uint32_t phase = 0; phase < RESOURCE_LOAD_PHASE_COUNT; ++phase)
+    {
+        bformata(pOutput, "\"%s\": %lld%s", gResourceLoadPhaseNames[phase], (long long)pPhaseTimes[phase],
+                 phase + 1 < RESOURCE_LOAD_PHASE_COUNT ? ", " : " }");
+    }
+}
+
+bool endResourceLoadReport(const char* pFileName)
+{
+    ASSERT(pFileName);
+    waitForAllResourceLoads();
+
+    ResourceLoaderStatistics* pStatistics = &pResourceLoader->mStatistics;
+    acquireMutex(&pStatistics->mMutex);
+    ASSERT(pStatistics->mReportActive);
+    pStatistics->mReportActive = false;
+
+    const ResourceLoaderStats* pStats = &pStatistics->mReportStats;
+    const int64_t              startTime = pStatistics->mReportStartTime;
+
+    bstring output = bempty();
+    balloc(&output, 4096);
+    bassignliteral(&output, "{\n");
+    bformata(&output, "\"Duration\": %lld,\n", (long long)(getUSec(false) - startTime));
+    bformata(&output, "\"StagingStallCount\": %llu,\n", (unsigned long long)pStats->mStagingStallCount);
+    bformata(&output, "\"TempStagingBufferCount\": %llu,\n", (unsigned long long)pStats->mTempStagingBufferCount);
+    bformata(&output, "\"TempStagingBufferSize\": %llu,\n", (unsigned long long)pStats->mTempStagingBufferSize);
+    bformata(&output, "\"SubmitCount\": %llu,\n", (unsigned long long)pStats->mSubmitCount);
+    bformata(&output, "\"TextureCacheHitCount\": %llu,\n", (unsigned long long)pStats->mTextureCacheHitCount);
+    bformata(&output, "\"TextureCacheMissCount\": %llu,\n", (unsigned long long)pStats->mTextureCacheMissCount);
+    bformata(&output, "\"TextureCacheBytesSaved\": %llu,\n", (unsigned long long)pStats->mTextureCacheBytesSaved);
+    bcatliteral(&output, "\"TextureUploadPaths\": { ");
+    for (uint32_t path = TEXTURE_UPLOAD_PATH_NONE + 1; path < TEXTURE_UPLOAD_PATH_COUNT; ++path)
+    {
+        bformata(&output, "\"%s\": %llu%s", gTextureUploadPathNames[path], (unsigned long long)pStats->mTextureUploadPathCount[path],
+                 path + 1 < TEXTURE_UPLOAD_PATH_COUNT ? ", " : " },\n");
+    }
+
+    bcatliteral(&output, "\"Types\": {\n");
+    for (uint32_t type = 0; type < RESOURCE_LOAD_TYPE_COUNT; ++type)
+    {
+        const ResourceLoadTypeStats* pTypeStats = &pStats->mTypes[type];
+        int64_t                      phaseTimes[RESOURCE_LOAD_PHASE_COUNT] = {};
+        uint64_t                     busyTime = 0;
+        for (uint32_t phase = 0; phase < RESOURCE_LOAD_PHASE_COUNT; ++phase)
+        {
+            phaseTimes[phase] = (int64_t)pTypeStats->mPhaseTime[phase];
+            busyTime += phase != RESOURCE_LOAD_PHASE_QUEUE ? pTypeStats->mPhaseTime[phase] : 0;
+        }
+
+        bformata(&output, "\"%s\": { \"RequestCount\": %llu, \"FailedRequestCount\": %llu, \"UploadSize\": %llu, ",
+                 gResourceLoadTypeNames[type], (unsigned long long)pTypeStats->mRequestCount,
+                 (unsigned long long)pTypeStats->mFailedRequestCount, (unsigned long long)pTypeStats->mUploadSize);
+        bformata(&output, "\"BytesPerSecond\": %.1f, \"Phases\": ", busyTime ? pTypeStats->mUploadSize * 1e6 / (double)busyTime : 0.0);
+        writeLoadPhasesJson(&output, phaseTimes);
+        bformata(&output, " }%s\n", type + 1 < RESOURCE_LOAD_TYPE_COUNT ? "," : "");
+    }
+    bcatliteral(&output, "},\n");
+
+    // Timestamps are relative to beginResourceLoadReport, requests queued before it have a negative queue time
+    bcatliteral(&output, "\"Requests\": [\n");
+    const uint32_t recordCount = (uint32_t)arrlen(pStatistics->pRecords);
+    for (uint32_t i = 0; i < recordCount; ++i)
+    {
+        const ResourceLoadRecord* pRecord = &pStatistics->pRecords[i];
+        bcatliteral(&output, "{ \"Name\": \"");
+        for (const char* c = pRecord->mName; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                bconchar(&output, '\\');
+            bconchar(&output, *c);
+        }
+        bformata(&output, "\", \"Type\": \"%s\", \"Node\": %u, \"Token\": %llu, \"Failed\": %s, \"UploadSize\": %llu, ",
+                 gResourceLoadTypeNames[pRecord->mType], pRecord->mNodeIndex, (unsigned long long)pRecord->mToken,
+                 pRecord->mFailed ? "true" : "false", (unsigned long long)pRecord->mUploadSize);
+        bformata(&output, "\"Queue\": %lld, \"Start\": %lld, \"End\": %lld, ", (long long)(pRecord->mQueueTime - startTime),
+                 (long long)(pRecord->mStartTime - startTime), (long long)(pRecord->mEndTime - startTime));
+        // Submission and completion are unknown for requests still in flight (single threaded resource loader)
+        if (pRecord->mSubmitTime)
+            bformata(&output, "\"Submit\": %lld, ", (long long)(pRecord->mSubmitTime - startTime));
+        if (pRecord->mCompleteTime)
+            bformata(&output, "\"Complete\": %lld, ", (long long)(pRecord->mCompleteTime - startTime));
+        if (pRecord->mUploadPath != TEXTURE_UPLOAD_PATH_NONE)
+            bformata(&output, "\"UploadPath\": \"%s\", ", gTextureUploadPathNames[pRecord->mUploadPath]);
+        bcatliteral(&output, "\"Phases\": ");
+        writeLoadPhasesJson(&output, pRecord->mPhaseTime);
+        bformata(&output, " }%s\n", i + 1 < recordCount ? "," : "");
+    }
+    bcatliteral(&output, "]\n}\n");
+
+    arrfree(pStatistics->pRecords);
+    releaseMutex(&pStatistics->mMutex);
+
+    FileStream reportFile = {};
+    bool       success = fsOpenStreamFromPath(RD_LOG, pFileName, FM_WRITE, &reportFile);
+    if (success)
+    {
+        success = fsWriteToStream(&reportFile, output.data, (size_t)output.slen) == (size_t)output.slen;
+        fsCloseStream(&reportFile);
+    }
+    else
+    {
+        LOGF(eERROR, "Failed to open resource load report file %s", pFileName);
+    }
+
+    bdestroy(&output);
+    return success;
+}
+
 /************************************************************************/
 // Shader loading
 /************************************************************************/
+static uint64_t shaderLibraryNameHash(const char* pName, size_t nameSize)
+{
+    // 64 bit FNV-1a, needs to match with shader_library.py
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < nameSize; ++i)
+    {
+        hash ^= (uint8_t)pName[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void openShaderLibrary(ShaderLibrary* pLibrary)
+{
+    const char* rendererApi = getShaderPlatformName();
+    char        libraryPath[FS_MAX_PATH] = {};
+    if (rendererApi[0])
+    {
+        snprintf(libraryPath, sizeof libraryPath, "%s/%s", rendererApi, FSL_LIBRARY_FILE_NAME);
+    }
+    else
+    {
+        snprintf(libraryPath, sizeof libraryPath, "%s", FSL_LIBRARY_FILE_NAME);
+    }
+
+    if (!fsOpenStreamFromPath(RD_SHADER_BINARIES, libraryPath, FM_READ, &pLibrary->mStream))
+    {
+        LOGF(eWARNING, "Shader library '%s' not found, loading shaders from their binary files", libraryPath);
+        return;
+    }
+
+    size_t      size = 0;
+    const void* pData = NULL;
+    if (!fsStreamMemoryMap(&pLibrary->mStream, &size, &pData) || size < sizeof(FSLLibraryHeader))
+    {
+        LOGF(eERROR, "Failed to memory map shader library '%s'", libraryPath);
+        fsCloseStream(&pLibrary->mStream);
+        return;
+    }
+
+    const FSLLibraryHeader* pHeader = (const FSLLibraryHeader*)pData;
+    const uint64_t          namesOffset = sizeof(FSLLibraryHeader) + (uint64_t)sizeof(FSLLibraryEntry) * pHeader->mEntryCount;
+    if (strncmp("@FSB", pHeader->mMagic, 4) != 0 || pHeader->mVersion != FSL_LIBRARY_VERSION || namesOffset + pHeader->mNamesSize > size)
+    {
+        LOGF(eERROR, "Shader library '%s' is invalid or was packed by a different version of shader_library.py", libraryPath);
+        fsCloseStream(&pLibrary->mStream);
+        return;
+    }
+
+    pLibrary->pData = (const uint8_t*)pData;
+    pLibrary->mSize = size;
+    pLibrary->pEntries = (const FSLLibraryEntry*)(pLibrary->pData + sizeof(FSLLibraryHeader));
+    pLibrary->pNames = (const char*)(pLibrary->pData + namesOffset);
+    pLibrary->mEntryCount = pHeader->mEntryCount;
+}
+
+// Returns the FSL binary of pName (path relative to the platform directory) from the shader library
+static bool getShaderLibraryByteCode(const char* pName, const void** ppData, uint64_t* pSize)
+{
+    if (!pResourceLoader || !pResourceLoader->mDesc.mUseShaderLibrary)
+    {
+        return false;
+    }
+
+    ShaderLibrary* pLibrary = &pResourceLoader->mShaderLibrary;
+    acquireMutex(&pLibrary->mMutex);
+    if (!pLibrary->mOpenAttempted)
+    {
+        pLibrary->mOpenAttempted = true;
+        openShaderLibrary(pLibrary);
+    }
+    releaseMutex(&pLibrary->mMutex);
+
+    if (!pLibrary->pData)
+    {
+        return false;
+    }
+
+    const size_t   nameSize = strlen(pName);
+    const uint64_t hash = shaderLibraryNameHash(pName, nameSize);
+
+    uint32_t first = 0;
+    uint32_t last = pLibrary->mEntryCount;
+    while (first < last)
+    {
+        uint32_t mid = first + (last - first) / 2;
+        if (pLibrary->pEntries[mid].mNameHash < hash)
+        {
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+
+    for (uint32_t i = first; i < pLibrary->mEntryCount && pLibrary->pEntries[i].mNameHash == hash; ++i)
+    {
+        const FSLLibraryEntry* pEntry = &pLibrary->pEntries[i];
+        if (pEntry->mNameSize == nameSize && !strncmp(pLibrary->pNames + pEntry->mNameOffset, pName, nameSize))
+        {
+            if (pEntry->mOffset + pEntry->mSize > pLibrary->mSize)
+            {
+                LOGF(eERROR, "Shader library entry '%s' is out of bounds", pName);
+                return false;
+            }
+
+            *ppData = pLibrary->pData + pEntry->mOffset;
+            *pSize = pEntry->mSize;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static bool load_shader_stage_byte_code(Renderer* pRenderer, const char* name, ShaderStage stage, BinaryShaderStageDesc* pOut,
                                         ShaderByteCodeBuffer* pShaderByteCodeBuffer, FSLMetadata* pOutMetadata)
 {
@@ -4011,11 +7722,20 @@ static bool load_shader_stage_byte_code(Renderer* pRenderer, const char* name, S
     // NOTE: On some platforms, we might not be allowed to write in the `RD_SHADER_BINARIES` directory.
     // If we want to load re-compiled binaries, then they must be cached elsewhere and queried here.
 
-    void*      pCachedByteCode = NULL;
-    uint32_t   cachedByteCodeSize = 0;
-    const bool result = platformReloadClientGetShaderBinary(binaryShaderPath, &pCachedByteCode, &cachedByteCodeSize)
-                            ? fsOpenStreamFromMemory(pCachedByteCode, cachedByteCodeSize, FM_READ, false, &binaryFileStream)
-                            : fsOpenStreamFromPath(RD_SHADER_BINARIES, binaryShaderPath, FM_READ, &binaryFileStream);
+    // Shaders found in the shader library are read from its memory mapping without opening their files
+    void*       pCachedByteCode = NULL;
+    uint32_t    cachedByteCodeSize = 0;
+    const void* pLibraryByteCode = NULL;
+    uint64_t    libraryByteCodeSize = 0;
+    const size_t apiNameLength = strlen(getShaderPlatformName());
+    const char*  libraryShaderName = apiNameLength ? binaryShaderPath + apiNameLength + 1 : binaryShaderPath;
+
+    const bool result =
+        platformReloadClientGetShaderBinary(binaryShaderPath, &pCachedByteCode, &cachedByteCodeSize)
+            ? fsOpenStreamFromMemory(pCachedByteCode, cachedByteCodeSize, FM_READ, false, &binaryFileStream)
+        : getShaderLibraryByteCode(libraryShaderName, &pLibraryByteCode, &libraryByteCodeSize)
+            ? fsOpenStreamFromMemory(pLibraryByteCode, (size_t)libraryByteCodeSize, FM_READ, false, &binaryFileStream)
+            : fsOpenStreamFromPath(RD_SHADER_BINARIES, binaryShaderPath, FM_READ, &binaryFileStream);
 
     ASSERT(result);
     if (!result)
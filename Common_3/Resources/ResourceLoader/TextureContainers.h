@@ -239,7 +239,8 @@ static inline bool loadDDSTextureDesc(FileStream* pStream, TextureDesc* pOutDesc
 /************************************************************************/
 // KTX Loading
 /************************************************************************/
-static inline bool loadKTXTextureDesc(FileStream* pStream, TextureDesc* pOutDesc)
+// pOutCubePadding is set for non array cubemaps, each face of these is padded to 4 bytes and the image size only covers one face
+static inline bool loadKTXTextureDesc(FileStream* pStream, TextureDesc* pOutDesc, bool* pOutCubePadding = NULL)
 {
     RETURN_IF_FAILED(pStream);
 
@@ -297,7 +298,183 @@ static inline bool loadKTXTextureDesc(FileStream* pStream, TextureDesc* pOutDesc
         textureDesc.mDescriptors |= DESCRIPTOR_TYPE_TEXTURE_CUBE;
     }
 
+    if (pOutCubePadding)
+    {
+        *pOutCubePadding = TinyKtx_IsCubemap(ctx) && !TinyKtx_ArraySlices(ctx);
+    }
+
     TinyKtx_DestroyContext(ctx);
 
     return true;
 }
+
+/************************************************************************/
+// KTX2 Loading
+/************************************************************************/
+// Mip levels of textures up to 32k
+#define KTX2_MAX_LEVELS 16
+
+typedef enum KTX2Supercompression
+{
+    KTX2_SUPERCOMPRESSION_NONE = 0,
+    KTX2_SUPERCOMPRESSION_BASISLZ = 1,
+    KTX2_SUPERCOMPRESSION_ZSTD = 2,
+    KTX2_SUPERCOMPRESSION_ZLIB = 3,
+} KTX2Supercompression;
+
+static const uint8_t gKTX2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+typedef struct KTX2Header
+{
+    uint8_t  mIdentifier[12];
+    uint32_t mVkFormat;
+    uint32_t mTypeSize;
+    uint32_t mPixelWidth;
+    uint32_t mPixelHeight;
+    uint32_t mPixelDepth;
+    uint32_t mLayerCount;
+    uint32_t mFaceCount;
+    uint32_t mLevelCount;
+    uint32_t mSupercompressionScheme;
+    uint32_t mDfdByteOffset;
+    uint32_t mDfdByteLength;
+    uint32_t mKvdByteOffset;
+    uint32_t mKvdByteLength;
+    uint64_t mSgdByteOffset;
+    uint64_t mSgdByteLength;
+} KTX2Header;
+
+// Entry of the level index that follows the header, level 0 is the most detailed mip
+typedef struct KTX2Level
+{
+    uint64_t mByteOffset;
+    uint64_t mByteLength;
+    uint64_t mUncompressedByteLength;
+} KTX2Level;
+
+// Only formats with a VkFormat are supported (no BasisLZ), mip levels can be stored uncompressed or zstd supercompressed
+static inline bool loadKTX2TextureDesc(FileStream* pStream, TextureDesc* pOutDesc, uint32_t* pOutSupercompression,
+                                       KTX2Level pOutLevels[KTX2_MAX_LEVELS])
+{
+    RETURN_IF_FAILED(pStream);
+
+    const ssize_t fileSize = fsGetStreamFileSize(pStream);
+    KTX2Header    header = {};
+    RETURN_IF_FAILED(fsSeekStream(pStream, SBO_START_OF_FILE, 0));
+    RETURN_IF_FAILED(fsReadFromStream(pStream, &header, sizeof(header)) == sizeof(header));
+    RETURN_IF_FAILED(memcmp(header.mIdentifier, gKTX2Identifier, sizeof(gKTX2Identifier)) == 0);
+
+    if (header.mSupercompressionScheme != KTX2_SUPERCOMPRESSION_NONE && header.mSupercompressionScheme != KTX2_SUPERCOMPRESSION_ZSTD)
+    {
+        LOGF(eERROR, "KTX2 supercompression scheme %u is not supported", header.mSupercompressionScheme);
+        return false;
+    }
+
+    TextureDesc& textureDesc = *pOutDesc;
+    textureDesc.mWidth = header.mPixelWidth;
+    textureDesc.mHeight = max(1U, header.mPixelHeight);
+    textureDesc.mDepth = max(1U, header.mPixelDepth);
+    textureDesc.mArraySize = max(1U, header.mLayerCount);
+    // Level count of zero asks to generate the mips at runtime, only the base level is stored
+    textureDesc.mMipLevels = max(1U, header.mLevelCount);
+    textureDesc.mFormat = TinyImageFormat_FromVkFormat((TinyImageFormat_VkFormat)header.mVkFormat);
+    textureDesc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+    textureDesc.mSampleCount = SAMPLE_COUNT_1;
+
+    RETURN_IF_FAILED(textureDesc.mWidth && textureDesc.mFormat != TinyImageFormat_UNDEFINED);
+    RETURN_IF_FAILED(textureDesc.mMipLevels <= KTX2_MAX_LEVELS && (header.mFaceCount == 1 || header.mFaceCount == 6));
+
+    if (header.mFaceCount == 6)
+    {
+        textureDesc.mArraySize *= 6;
+        textureDesc.mDescriptors |= DESCRIPTOR_TYPE_TEXTURE_CUBE;
+    }
+
+    const size_t levelIndexSize = sizeof(KTX2Level) * textureDesc.mMipLevels;
+    RETURN_IF_FAILED(fsReadFromStream(pStream, pOutLevels, levelIndexSize) == levelIndexSize);
+    for (uint32_t i = 0; i < textureDesc.mMipLevels; ++i)
+    {
+        const KTX2Level* pLevel = &pOutLevels[i];
+        RETURN_IF_FAILED(pLevel->mByteLength && pLevel->mByteOffset + pLevel->mByteLength <= (uint64_t)fileSize);
+        RETURN_IF_FAILED(header.mSupercompressionScheme != KTX2_SUPERCOMPRESSION_NONE ||
+                         pLevel->mByteLength == pLevel->mUncompressedByteLength);
+    }
+
+    *pOutSupercompression = header.mSupercompressionScheme;
+    return true;
+}
+
+/************************************************************************/
+// Partial reads
+/************************************************************************/
+// Describes where the subresources of a DDS/KTX container are stored, so that a range of mips can be read without reading the whole file
+typedef struct TextureContainerLayout
+{
+    TinyImageFormat  mFormat;
+    uint32_t         mWidth;
+    uint32_t         mHeight;
+    uint32_t         mDepth;
+    uint32_t         mMipLevels;
+    uint32_t         mArraySize;
+    /// Offset of the first subresource in the file, right after the header
+    uint64_t         mDataOffset;
+    /// KTX layout: each mip is prefixed by its size and stores all the layers, otherwise (DDS) each layer stores all the mips
+    bool             mMipsAfterSlice;
+    /// KTX layout of non array cubemaps: each face is padded to 4 bytes, the mip size prefix only covers one face
+    bool             mCubePadding;
+    /// KTX2 layout: each mip stores all the layers at the offset of its entry in the level index
+    const KTX2Level* pLevels;
+    /// KTX2Supercompression of the levels, they have to be decompressed before reading subresources
+    uint32_t         mSupercompression;
+} TextureContainerLayout;
+
+// Size of one layer of the given mip as stored in the container
+static inline uint64_t util_get_container_mip_size(const TextureContainerLayout* pLayout, uint32_t mip)
+{
+    uint32_t numBytes = 0;
+    uint32_t rowBytes = 0;
+    uint32_t numRows = 0;
+    if (!util_get_surface_info(max(1u, pLayout->mWidth >> mip), max(1u, pLayout->mHeight >> mip), pLayout->mFormat, &numBytes, &rowBytes,
+                               &numRows))
+    {
+        return 0;
+    }
+
+    return (uint64_t)numBytes * max(1u, pLayout->mDepth >> mip);
+}
+
+static inline uint64_t util_get_container_subresource_offset(const TextureContainerLayout* pLayout, uint32_t mip, uint32_t layer)
+{
+    ASSERT(mip < pLayout->mMipLevels && layer < pLayout->mArraySize);
+
+    if (pLayout->pLevels)
+    {
+        ASSERT(pLayout->mSupercompression == KTX2_SUPERCOMPRESSION_NONE);
+        return pLayout->pLevels[mip].mByteOffset + layer * util_get_container_mip_size(pLayout, mip);
+    }
+
+    uint64_t offset = pLayout->mDataOffset;
+    if (pLayout->mMipsAfterSlice)
+    {
+        // [imageSize][layer 0 ... layer n] padded to 4 bytes, for each mip
+        // Non array cubemaps: [imageSize][face 0 ... face 5] with each face padded to 4 bytes, for each mip
+        for (uint32_t m = 0; m < mip; ++m)
+        {
+            const uint64_t mipSize = util_get_container_mip_size(pLayout, m);
+            offset += sizeof(uint32_t) + (pLayout->mCubePadding ? ((mipSize + 3) & ~3ull) * pLayout->mArraySize
+                                                                : (mipSize * pLayout->mArraySize + 3) & ~3ull);
+        }
+        const uint64_t mipSize = util_get_container_mip_size(pLayout, mip);
+        return offset + sizeof(uint32_t) + layer * (pLayout->mCubePadding ? (mipSize + 3) & ~3ull : mipSize);
+    }
+
+    // [mip 0 ... mip n] for each layer
+    uint64_t layerSize = 0;
+    for (uint32_t m = 0; m < pLayout->mMipLevels; ++m)
+    {
+        const uint64_t mipSize = util_get_container_mip_size(pLayout, m);
+        offset += m < mip ? mipSize : 0;
+        layerSize += mipSize;
+    }
+    return offset + layer * layerSize;
+}
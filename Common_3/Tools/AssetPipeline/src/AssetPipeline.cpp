@@ -64,7 +64,12 @@
 #include "../../../OS/Interfaces/IOperatingSystem.h"
 #include "../../../Utilities/Interfaces/IFileSystem.h"
 #include "../../../Utilities/Interfaces/ILog.h"
+#include "../../../Utilities/Interfaces/IThread.h"
+#include "../../../Utilities/Interfaces/ITime.h"
 #include "../../../Utilities/Interfaces/IToolFileSystem.h"
+#include "../../../Utilities/ThirdParty/OpenSource/Nothings/stb_ds.h"
+#include "../../../Utilities/Threading/Atomics.h"
+#include "../../../Utilities/Threading/ThreadSystem.h"
 
 #include "../../../Resources/ResourceLoader/TextureContainers.h"
 
@@ -163,509 +168,1579 @@ void DirectorySearch(ResourceDirectory resourceDir, const char* subDir, const ch
     }
 }
 
-void ReleaseSkeletonAndAnimationParams(SkeletonAndAnimations* pArray, uint32_t count)
+/************************************************************************/
+// Output comparison
+/************************************************************************/
+#define COMPARE_OUTPUTS_CHUNK_SIZE (64 * 1024)
+
+typedef struct CompareOutputsContext
 {
-    for (uint32_t i = 0; i < count; ++i)
-    {
-        bdestroy(&pArray[i].mSkeletonInFile);
-        bdestroy(&pArray[i].mSkeletonOutFile);
+    ResourceDirectory mRDActual;
+    uint8_t*          pChunks; // Two chunks, expected then actual
+    uint32_t          mFileCount;
+    uint32_t          mMismatchCount;
+} CompareOutputsContext;
 
-        for (uint32_t a = 0, end = (uint32_t)arrlen(pArray[i].mAnimations); a < end; ++a)
-        {
-            bdestroy(&pArray[i].mAnimations[a].mInputAnim);
-            bdestroy(&pArray[i].mAnimations[a].mOutputAnimPath);
-        }
+// The build cache database depends on the modification times of the run, not on its outputs
+static bool IsComparedOutput(const char* fileName) { return !strstr(fileName, BUILD_CACHE_DATABASE_FILE_NAME); }
 
-        arrfree(pArray[i].mAnimations);
-    }
+static void OnCompareOutputsCount(ResourceDirectory resourceDir, const char* fileName, void* pUserData)
+{
+    UNREF_PARAM(resourceDir);
+    *(uint32_t*)pUserData += IsComparedOutput(fileName) ? 1 : 0;
 }
 
-void ReleaseSkeletonAndAnimationParams(SkeletonAndAnimations* pStbdsArray)
+static void OnCompareOutputsFind(ResourceDirectory resourceDir, const char* fileName, void* pUserData)
 {
-    ReleaseSkeletonAndAnimationParams(pStbdsArray, (uint32_t)arrlen(pStbdsArray));
-    arrfree(pStbdsArray);
+    CompareOutputsContext* pContext = (CompareOutputsContext*)pUserData;
+    if (!IsComparedOutput(fileName))
+        return;
+    ++pContext->mFileCount;
+
+    FileStream expected = {};
+    FileStream actual = {};
+    bool       expectedOpen = fsOpenStreamFromPath(resourceDir, fileName, FM_READ, &expected);
+    bool       actualOpen = fsOpenStreamFromPath(pContext->mRDActual, fileName, FM_READ, &actual);
+    bool       same = expectedOpen && actualOpen && fsGetStreamFileSize(&expected) == fsGetStreamFileSize(&actual);
+    for (ssize_t remaining = same ? fsGetStreamFileSize(&expected) : 0; same && remaining > 0;)
+    {
+        const size_t chunkSize = (size_t)min(remaining, (ssize_t)COMPARE_OUTPUTS_CHUNK_SIZE);
+        same = fsReadFromStream(&expected, pContext->pChunks, chunkSize) == chunkSize &&
+               fsReadFromStream(&actual, pContext->pChunks + COMPARE_OUTPUTS_CHUNK_SIZE, chunkSize) == chunkSize &&
+               !memcmp(pContext->pChunks, pContext->pChunks + COMPARE_OUTPUTS_CHUNK_SIZE, chunkSize);
+        remaining -= (ssize_t)chunkSize;
+    }
+    if (expectedOpen)
+        fsCloseStream(&expected);
+    if (actualOpen)
+        fsCloseStream(&actual);
+
+    if (!same)
+    {
+        LOGF(eERROR, "%s %s", fileName, actualOpen ? "differs between the outputs" : "is missing from the second output");
+        ++pContext->mMismatchCount;
+    }
 }
 
-cgltf_result cgltf_parse_and_load(ResourceDirectory resourceDir, const char* skeletonAsset, cgltf_data** ppData, void** ppFileData)
+bool CompareAssetPipelineOutputs(ResourceDirectory expectedDir, ResourceDirectory actualDir, uint32_t* pFileCount)
 {
-    // Import the glTF with the animation
-    FileStream file = {};
-    if (!fsOpenStreamFromPath(resourceDir, skeletonAsset, FM_READ, &file))
+    CompareOutputsContext context = {};
+    context.mRDActual = actualDir;
+    context.pChunks = (uint8_t*)tf_malloc(2 * COMPARE_OUTPUTS_CHUNK_SIZE);
+    DirectorySearch(expectedDir, NULL, "*", OnCompareOutputsFind, &context, true);
+    tf_free(context.pChunks);
+
+    uint32_t actualCount = 0;
+    DirectorySearch(actualDir, NULL, "*", OnCompareOutputsCount, &actualCount, true);
+    if (actualCount != context.mFileCount)
     {
-        LOGF(eERROR, "Failed to open gltf file %s", skeletonAsset);
-        ASSERT(false);
-        return cgltf_result_file_not_found;
+        LOGF(eERROR, "The outputs have %u and %u files", context.mFileCount, actualCount);
     }
 
-    ssize_t fileSize = fsGetStreamFileSize(&file);
-    void*   fileData = tf_malloc(fileSize);
+    if (pFileCount)
+        *pFileCount = context.mFileCount;
+    return context.mMismatchCount || actualCount != context.mFileCount;
+}
 
-    fsReadFromStream(&file, fileData, fileSize);
+/************************************************************************/
+// Directory scan cache
+/************************************************************************/
+typedef struct DirectoryScanCacheEntry
+{
+    char*  key;   // "<directory>|<extension>|<recursive>"
+    char** value; // stbds array of the files found
+} DirectoryScanCacheEntry;
 
-    cgltf_data*   data = NULL;
-    cgltf_options options = {};
-    options.memory_alloc = [](void* user, cgltf_size size)
-    {
-        UNREF_PARAM(user);
-        return tf_malloc(size);
-    };
-    options.memory_free = [](void* user, void* ptr)
-    {
-        UNREF_PARAM(user);
-        tf_free(ptr);
-    };
-    options.rd = resourceDir;
-    cgltf_result result = cgltf_parse(&options, fileData, fileSize, &data);
-    fsCloseStream(&file);
+struct DirectoryScanCache
+{
+    DirectoryScanCacheEntry* pEntries; // stbds string hashmap
+    uint32_t                 mHitCount;
+    uint32_t                 mMissCount;
+};
 
-    if (!VERIFYMSG(cgltf_result_success == result, "Failed to parse gltf file %s with error %u", skeletonAsset, (uint32_t)result))
+static void OnDirectoryScanCacheFind(ResourceDirectory resourceDir, const char* fileName, void* pUserData)
+{
+    UNREF_PARAM(resourceDir);
+    const size_t size = strlen(fileName) + 1;
+    char*        pFileName = (char*)tf_malloc(size);
+    memcpy(pFileName, fileName, size);
+    arrpush(*(char***)pUserData, pFileName);
+}
+
+static void FreeDirectoryScanCacheFiles(char** pFiles)
+{
+    for (size_t i = 0, count = arrlenu(pFiles); i < count; ++i)
+        tf_free(pFiles[i]);
+    arrfree(pFiles);
+}
+
+void InputDirectorySearch(AssetPipelineParams* assetParams, const char* ext, OnFind onFindCallback, void* pUserData)
+{
+    const bool          recursive = assetParams->mPathMode == PROCESS_MODE_DIRECTORY_RECURSIVE;
+    DirectoryScanCache* pCache = assetParams->pDirectoryScanCache;
+    if (!pCache)
     {
-        tf_free(fileData);
-        return result;
+        DirectorySearch(assetParams->mRDInput, NULL, ext, onFindCallback, pUserData, recursive);
+        return;
     }
 
-    result = cgltf_validate(data);
-    if (cgltf_result_success != result)
+    char key[FS_MAX_PATH + 64] = {};
+    snprintf(key, sizeof(key), "%s|%s|%d", fsGetResourceDirectory(assetParams->mRDInput), ext ? ext : "", (int)recursive);
+
+    DirectoryScanCacheEntry* pEntry = shgetp_null(pCache->pEntries, key);
+    if (pEntry)
     {
-        LOGF(eWARNING, "GLTF validation finished with error %u for file %s", (uint32_t)result, skeletonAsset);
+        ++pCache->mHitCount;
     }
-
-    // Load buffers located in separate files (.bin) using our file system
-    for (uint32_t i = 0; i < data->buffers_count; ++i)
+    else
     {
-        const char* uri = data->buffers[i].uri;
+        ++pCache->mMissCount;
+        char** pFiles = NULL;
+        DirectorySearch(assetParams->mRDInput, NULL, ext, OnDirectoryScanCacheFind, &pFiles, recursive);
+        shput(pCache->pEntries, key, pFiles);
+        pEntry = shgetp(pCache->pEntries, key);
+    }
 
-        if (!uri || data->buffers[i].data)
-        {
-            continue;
-        }
+    for (size_t i = 0, count = arrlenu(pEntry->value); i < count; ++i)
+        onFindCallback(assetParams->mRDInput, pEntry->value[i], pUserData);
+}
 
-        if (strncmp(uri, "data:", 5) != 0 && !strstr(uri, "://"))
+DirectoryScanCache* CreateDirectoryScanCache()
+{
+    DirectoryScanCache* pCache = (DirectoryScanCache*)tf_calloc(1, sizeof(DirectoryScanCache));
+    sh_new_strdup(pCache->pEntries);
+    return pCache;
+}
+
+void InvalidateDirectoryScanCache(DirectoryScanCache* pCache, const char* directory)
+{
+    const size_t directoryLength = strlen(directory);
+    // Backwards since shdel moves the last entry into the deleted one
+    for (ptrdiff_t i = (ptrdiff_t)shlen(pCache->pEntries) - 1; i >= 0; --i)
+    {
+        if (strncmp(pCache->pEntries[i].key, directory, directoryLength) == 0)
         {
-            char parent[FS_MAX_PATH] = { 0 };
-            fsGetParentPath(skeletonAsset, parent);
-            char path[FS_MAX_PATH] = { 0 };
-            fsAppendPathComponent(parent, uri, path);
-            FileStream fs = {};
-            if (fsOpenStreamFromPath(resourceDir, path, FM_READ, &fs))
-            {
-                ASSERT(fsGetStreamFileSize(&fs) >= (ssize_t)data->buffers[i].size);
-                data->buffers[i].data = tf_malloc(data->buffers[i].size);
-                fsReadFromStream(&fs, data->buffers[i].data, data->buffers[i].size);
-                fsCloseStream(&fs);
-            }
+            FreeDirectoryScanCacheFiles(pCache->pEntries[i].value);
+            shdel(pCache->pEntries, pCache->pEntries[i].key);
         }
     }
+}
 
-    result = cgltf_load_buffers(&options, data, skeletonAsset);
-    if (!VERIFYMSG(cgltf_result_success == result, "Failed to load buffers from gltf file %s with error %u", skeletonAsset,
-                   (uint32_t)result))
+void GetDirectoryScanCacheStats(const DirectoryScanCache* pCache, uint32_t* pHitCount, uint32_t* pMissCount)
+{
+    *pHitCount = pCache->mHitCount;
+    *pMissCount = pCache->mMissCount;
+}
+
+void DestroyDirectoryScanCache(DirectoryScanCache* pCache)
+{
+    for (size_t i = 0, count = shlenu(pCache->pEntries); i < count; ++i)
+        FreeDirectoryScanCacheFiles(pCache->pEntries[i].value);
+    shfree(pCache->pEntries);
+    tf_free(pCache);
+}
+
+/************************************************************************/
+// Shared resources of the processes
+/************************************************************************/
+ThreadSystem AcquireAssetPipelineThreadSystem(AssetPipelineParams* assetParams, const char* threadName)
+{
+    if (assetParams->mThreadSystem)
+        return assetParams->mThreadSystem;
+
+    ThreadSystemInitDesc threadSystemDesc = gThreadSystemInitDescDefault;
+    threadSystemDesc.threadCount = assetParams->mSettings.threadCount;
+    threadSystemDesc.threadName = threadName;
+    ThreadSystem threadSystem = NULL;
+    if (!threadSystemInit(&threadSystem, &threadSystemDesc))
     {
-        tf_free(fileData);
-        return result;
+        LOGF(eWARNING, "Failed to create %u %s threads, processing on the calling thread", assetParams->mSettings.threadCount,
+             threadName);
+        threadSystem = NULL;
     }
+    return threadSystem;
+}
 
-    *ppData = data;
-    *ppFileData = fileData;
+void ReleaseAssetPipelineThreadSystem(AssetPipelineParams* assetParams, ThreadSystem* pThreadSystem)
+{
+    // Shared threads are owned by the caller of the process
+    if (*pThreadSystem != assetParams->mThreadSystem)
+        threadSystemExit(pThreadSystem, &gThreadSystemExitDescDefault);
+    *pThreadSystem = NULL;
+}
 
-    return result;
+void BeginAssetPipelineTaskGroup(AssetPipelineTaskGroup* pGroup, uint32_t taskCount)
+{
+    initMutex(&pGroup->mMutex);
+    initConditionVariable(&pGroup->mDone);
+    pGroup->mRemaining = taskCount;
 }
 
-cgltf_result cgltf_write(ResourceDirectory resourceDir, const char* skeletonAsset, cgltf_data* data)
+void EndAssetPipelineTask(AssetPipelineTaskGroup* pGroup)
 {
-    cgltf_options options = {};
-    options.memory_alloc = [](void* user, cgltf_size size)
-    {
-        UNREF_PARAM(user);
-        return tf_malloc(size);
-    };
-    options.memory_free = [](void* user, void* ptr)
-    {
-        UNREF_PARAM(user);
-        tf_free(ptr);
-    };
-    options.rd = resourceDir;
-    cgltf_size expected = cgltf_write(&options, NULL, 0, data);
-    char*      writeBuffer = (char*)tf_malloc(expected);
-    cgltf_size actual = cgltf_write(&options, writeBuffer, expected, data);
-    if (expected != actual)
-    {
-        LOGF(eERROR, "Error: expected %zu bytes but wrote %zu bytes.\n", expected, actual);
-        return cgltf_result_invalid_gltf;
-    }
+    acquireMutex(&pGroup->mMutex);
+    ASSERT(pGroup->mRemaining);
+    if (!--pGroup->mRemaining)
+        wakeAllConditionVariable(&pGroup->mDone);
+    releaseMutex(&pGroup->mMutex);
+}
 
-    FileStream file = {};
-    if (!fsOpenStreamFromPath(resourceDir, skeletonAsset, FM_WRITE, &file))
-    {
-        tf_free(writeBuffer);
-        return cgltf_result_io_error;
-    }
+void WaitAssetPipelineTaskGroup(ThreadSystem threadSystem, AssetPipelineTaskGroup* pGroup)
+{
+    // Once the queue is empty the remaining tasks of the group are running on other threads
+    while (threadSystemAssist(threadSystem))
+        ;
 
-    fsWriteToStream(&file, writeBuffer, actual - 1);
-    fsCloseStream(&file);
-    tf_free(writeBuffer);
+    acquireMutex(&pGroup->mMutex);
+    while (pGroup->mRemaining)
+        waitConditionVariable(&pGroup->mDone, &pGroup->mMutex, TIMEOUT_INFINITE);
+    releaseMutex(&pGroup->mMutex);
 
-    return cgltf_result_success;
+    destroyConditionVariable(&pGroup->mDone);
+    destroyMutex(&pGroup->mMutex);
 }
 
-static void DiscoverExtraAnimationsForMesh(ResourceDirectory resourceDirInput, const char* searchRootDir,
-                                           const char* extraAnimationsSubdirName, SkeletonAndAnimations* pSkeletonAndAnimations)
+void RecordAssetPipelineAsset(AssetPipelineParams* assetParams, const char* fileName, bool rebuilt)
 {
-    // Find sub directory called animations
-    char** assetSubDirectories = NULL;
-    int    assetSubDirectoryCount = 0;
-    fsGetSubDirectories(resourceDirInput, searchRootDir, &assetSubDirectories, &assetSubDirectoryCount);
-    if (assetSubDirectories)
+    AssetPipelineStats* pStats = assetParams->pStats;
+    if (!pStats)
+        return;
+
+    ++pStats->mCheckedCount;
+    if (rebuilt)
     {
-        for (int k = 0; k < assetSubDirectoryCount; ++k)
-        {
-            const char* assetSubDir = assetSubDirectories[k];
+        ++pStats->mRebuiltCount;
+        arrpush(pStats->pRebuiltFiles, bdynfromcstr(fileName));
+    }
+}
 
-            char subDir[FS_MAX_PATH] = {};
-            fsGetPathFileName(assetSubDir, subDir);
-            if (!stricmp(subDir, extraAnimationsSubdirName))
-            {
-                // Add all files in animations to the animation asset
-                char** animationFiles = NULL;
-                int    animationFileCount = 0;
-                fsGetFilesWithExtension(resourceDirInput, assetSubDir, ".gltf", &animationFiles, &animationFileCount);
-                if (animationFiles)
-                {
-                    for (int curAnim = 0; curAnim < animationFileCount; ++curAnim)
-                    {
-                        // Create animation output file name
-                        bstring animOutputFileString = bempty();
-                        bcatcstr(&animOutputFileString, "/");
-                        bcatcstr(&animOutputFileString, extraAnimationsSubdirName);
-                        bcatcstr(&animOutputFileString, "/");
+/************************************************************************/
+// Profile
+/************************************************************************/
+typedef struct AssetPipelineProfileEvent
+{
+    const char* pStage;
+    char*       pFileName;
+    uint32_t    mThreadIndex;
+    // Microseconds, the start time is relative to the creation of the profile
+    int64_t     mStartTime;
+    int64_t     mTime;
+    int64_t     mCpuTime;
+    uint64_t    mBytesIn;
+    uint64_t    mBytesOut;
+} AssetPipelineProfileEvent;
+
+struct AssetPipelineProfile
+{
+    // Scopes end on the worker threads of the processes
+    Mutex                      mMutex;
+    int64_t                    mStartTime;
+    AssetPipelineProfileEvent* pEvents;    // stbds array
+    ThreadID*                  pThreadIds; // stbds array, events store the index of their thread to get short trace ids
+};
 
-                        SkeletonAndAnimations::AnimationFile anim = {};
-                        anim.mInputAnim = bdynfromcstr(animationFiles[curAnim]);
-                        anim.mOutputAnimPath = animOutputFileString;
-                        arrpush(pSkeletonAndAnimations->mAnimations, anim);
+// Totals of the scopes of one stage in the report
+typedef struct AssetPipelineProfileStage
+{
+    const char* pStage;
+    uint32_t    mCount;
+    int64_t     mFirstStart;
+    int64_t     mLastEnd;
+    int64_t     mTime;
+    int64_t     mCpuTime;
+    uint64_t    mBytesIn;
+    uint64_t    mBytesOut;
+    uint32_t    mSlowestEvent;
+} AssetPipelineProfileStage;
+
+// CPU time of the calling thread in microseconds
+static int64_t GetThreadCpuTime()
+{
+#if defined(_WINDOWS)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0;
+    // In 100 nanoseconds
+    const uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+    const uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+    return (int64_t)((kernel + user) / 10);
+#else
+    struct timespec ts = {};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
 
-                        LOGF(eINFO, "Found extra animation file '%s'", (const char*)anim.mInputAnim.data);
-                    }
-                    tf_free(animationFiles);
-                }
-                break;
-            }
-        }
+AssetPipelineProfile* CreateAssetPipelineProfile()
+{
+    AssetPipelineProfile* pProfile = (AssetPipelineProfile*)tf_calloc(1, sizeof(AssetPipelineProfile));
+    initMutex(&pProfile->mMutex);
+    pProfile->mStartTime = getUSec(false);
+    return pProfile;
+}
 
-        tf_free(assetSubDirectories);
-    }
+void DestroyAssetPipelineProfile(AssetPipelineProfile* pProfile)
+{
+    if (!pProfile)
+        return;
+
+    for (uint32_t i = 0; i < (uint32_t)arrlenu(pProfile->pEvents); ++i)
+        tf_free(pProfile->pEvents[i].pFileName);
+    arrfree(pProfile->pEvents);
+    arrfree(pProfile->pThreadIds);
+    destroyMutex(&pProfile->mMutex);
+    tf_free(pProfile);
 }
 
-bool ProcessAnimations(AssetPipelineParams* assetParams, ProcessAnimationsParams* pProcessAnimationsParams)
+AssetPipelineScope BeginAssetPipelineScope(AssetPipelineParams* assetParams, const char* stage, const char* fileName)
 {
-    LOGF(eINFO, "Processing animations and writing to directory: %s", fsGetResourceDirectory(assetParams->mRDOutput));
+    AssetPipelineScope scope = {};
+    scope.pStage = stage;
+    scope.pFileName = fileName;
+    scope.mStartTime = getUSec(false);
+    scope.mStartCpuTime = assetParams->pProfile ? GetThreadCpuTime() : 0;
+    return scope;
+}
 
-    const SkeletonAndAnimations* pSkeletonAndAnims = pProcessAnimationsParams->pSkeletonAndAnims;
-    for (uint32_t i = 0; i < (uint32_t)arrlen(pSkeletonAndAnims); ++i)
+int64_t EndAssetPipelineScope(AssetPipelineParams* assetParams, const AssetPipelineScope* pScope, uint64_t bytesIn, uint64_t bytesOut)
+{
+    const int64_t time = getUSec(false) - pScope->mStartTime;
+
+    AssetPipelineProfile* pProfile = assetParams->pProfile;
+    if (!pProfile)
+        return time;
+
+    AssetPipelineProfileEvent event = {};
+    event.pStage = pScope->pStage;
+    event.mTime = time;
+    event.mCpuTime = GetThreadCpuTime() - pScope->mStartCpuTime;
+    event.mBytesIn = bytesIn;
+    event.mBytesOut = bytesOut;
+
+    const char*  fileName = pScope->pFileName ? pScope->pFileName : "";
+    const size_t fileNameSize = strlen(fileName) + 1;
+    event.pFileName = (char*)tf_malloc(fileNameSize);
+    memcpy(event.pFileName, fileName, fileNameSize);
+
+    const ThreadID threadId = getCurrentThreadID();
+
+    acquireMutex(&pProfile->mMutex);
+    event.mStartTime = pScope->mStartTime - pProfile->mStartTime;
+    event.mThreadIndex = (uint32_t)arrlenu(pProfile->pThreadIds);
+    for (uint32_t i = 0; i < (uint32_t)arrlenu(pProfile->pThreadIds); ++i)
     {
-        if (arrlen(pSkeletonAndAnims[i].mAnimations) == 0)
-            LOGF(LogLevel::eWARNING, "Skeleton '%s' has no associated animations.", (char*)pSkeletonAndAnims[i].mSkeletonInFile.data);
+        if (pProfile->pThreadIds[i] == threadId)
+        {
+            event.mThreadIndex = i;
+            break;
+        }
     }
+    if (event.mThreadIndex == (uint32_t)arrlenu(pProfile->pThreadIds))
+        arrpush(pProfile->pThreadIds, threadId);
+    arrpush(pProfile->pEvents, event);
+    releaseMutex(&pProfile->mMutex);
 
-    // No assets found. Return.
-    if (arrlen(pSkeletonAndAnims) == 0)
+    return time;
+}
+
+uint64_t GetAssetPipelineProfileFileSize(AssetPipelineParams* assetParams, ResourceDirectory resourceDir, const char* fileName)
+{
+    if (!assetParams->pProfile)
+        return 0;
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, fileName, FM_READ, &file))
+        return 0;
+    const ssize_t fileSize = fsGetStreamFileSize(&file);
+    fsCloseStream(&file);
+    return fileSize > 0 ? (uint64_t)fileSize : 0;
+}
+
+void WriteJsonString(FileStream* pFile, const char* pString)
+{
+    fsWriteToStream(pFile, "\"", 1);
+    for (const char* pChar = pString; *pChar; ++pChar)
     {
-        LOGF(eINFO, "No animation files found to process");
-        return true;
+        char escaped[8] = {};
+        int  size = 0;
+        if (*pChar == '"' || *pChar == '\\')
+            size = snprintf(escaped, sizeof(escaped), "\\%c", *pChar);
+        else if ((unsigned char)*pChar < 0x20)
+            size = snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)*pChar);
+        fsWriteToStream(pFile, size ? escaped : pChar, size ? (size_t)size : 1);
     }
+    fsWriteToStream(pFile, "\"", 1);
+}
 
-    LOGF(eINFO, "Processing %u skeleton assets and their animations...", (uint32_t)arrlen(pSkeletonAndAnims));
+static const AssetPipelineProfileEvent* gSortedProfileEvents = NULL;
 
-    // Process the found assets
-    uint32_t assetsProcessed = 0;
-    uint32_t assetsChecked = 0;
-    bool     success = true;
-    for (uint32_t i = 0, end = (uint32_t)arrlen(pSkeletonAndAnims); i < end; ++i)
+// Slowest first, then by start time so that the order doesn't depend on which thread ended first
+static int CompareProfileEvents(const void* pLhs, const void* pRhs)
+{
+    const AssetPipelineProfileEvent* pA = &gSortedProfileEvents[*(const uint32_t*)pLhs];
+    const AssetPipelineProfileEvent* pB = &gSortedProfileEvents[*(const uint32_t*)pRhs];
+    if (pA->mTime != pB->mTime)
+        return pA->mTime > pB->mTime ? -1 : 1;
+    if (pA->mStartTime != pB->mStartTime)
+        return pA->mStartTime < pB->mStartTime ? -1 : 1;
+    return strcmp(pA->pFileName, pB->pFileName);
+}
+
+static int CompareProfileStages(const void* pLhs, const void* pRhs)
+{
+    const AssetPipelineProfileStage* pA = (const AssetPipelineProfileStage*)pLhs;
+    const AssetPipelineProfileStage* pB = (const AssetPipelineProfileStage*)pRhs;
+    if (pA->mTime != pB->mTime)
+        return pA->mTime > pB->mTime ? -1 : 1;
+    return strcmp(pA->pStage, pB->pStage);
+}
+
+bool WriteAssetPipelineProfileReport(AssetPipelineProfile* pProfile, ResourceDirectory resourceDir, const char* fileName)
+{
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, fileName, FM_WRITE, &file))
     {
-        const SkeletonAndAnimations* skeletonAndAnims = &pSkeletonAndAnims[i];
-        const char*                  skeletonInputFile = (char*)skeletonAndAnims->mSkeletonInFile.data;
+        LOGF(eERROR, "Couldn't open profile report '%s' for write", fileName);
+        return false;
+    }
 
-        // Create skeleton output file name
-        const char* skeletonOutput = (char*)skeletonAndAnims->mSkeletonOutFile.data;
+    acquireMutex(&pProfile->mMutex);
 
-        assetsChecked++;
+    const AssetPipelineProfileEvent* pEvents = pProfile->pEvents;
+    const uint32_t                   eventCount = (uint32_t)arrlenu(pEvents);
 
-        // Check if the skeleton is already up-to-date
-        bool processSkeleton = true;
-        if (!assetParams->mSettings.force)
+    // Totals of every stage
+    AssetPipelineProfileStage* pStages = NULL;
+    int64_t                    endTime = 0;
+    for (uint32_t i = 0; i < eventCount; ++i)
+    {
+        const AssetPipelineProfileEvent* pEvent = &pEvents[i];
+        AssetPipelineProfileStage*       pStage = NULL;
+        for (uint32_t s = 0; s < (uint32_t)arrlenu(pStages) && !pStage; ++s)
         {
-            time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, skeletonInputFile);
-            if (assetParams->mAdditionalModifiedTime != 0)
-                lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
-            time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, skeletonOutput);
-
-            if (lastModified < lastProcessed && lastProcessed != ~0u && lastProcessed > assetParams->mSettings.minLastModifiedTime)
-                processSkeleton = false;
+            if (strcmp(pStages[s].pStage, pEvent->pStage) == 0)
+                pStage = &pStages[s];
         }
-
-        ozz::animation::Skeleton skeleton;
-        if (processSkeleton)
+        if (!pStage)
         {
-            LOGF(eINFO, "Regenerating Skeleton: %s -> %s", skeletonInputFile, skeletonOutput);
+            AssetPipelineProfileStage stage = {};
+            stage.pStage = pEvent->pStage;
+            stage.mFirstStart = pEvent->mStartTime;
+            stage.mSlowestEvent = i;
+            arrpush(pStages, stage);
+            pStage = &arrlast(pStages);
+        }
 
-            // Process the skeleton
-            if (CreateRuntimeSkeleton(assetParams->mRDInput, skeletonInputFile, assetParams->mRDOutput,
-                                      pProcessAnimationsParams->mAnimationSettings.mSkeletonAndAnimOutRd, skeletonOutput, &skeleton,
-                                      &assetParams->mSettings))
-            {
-                LOGF(eERROR, "Couldn't create Skeleton for mesh '%s' in %s. Skipping asset and all it's animations", skeletonInputFile,
-                     skeletonOutput);
-                success = false;
-                continue;
-            }
+        ++pStage->mCount;
+        pStage->mFirstStart = min(pStage->mFirstStart, pEvent->mStartTime);
+        pStage->mLastEnd = max(pStage->mLastEnd, pEvent->mStartTime + pEvent->mTime);
+        pStage->mTime += pEvent->mTime;
+        pStage->mCpuTime += pEvent->mCpuTime;
+        pStage->mBytesIn += pEvent->mBytesIn;
+        pStage->mBytesOut += pEvent->mBytesOut;
+        if (pEvent->mTime > pEvents[pStage->mSlowestEvent].mTime)
+            pStage->mSlowestEvent = i;
+        endTime = max(endTime, pEvent->mStartTime + pEvent->mTime);
+    }
+    qsort(pStages, arrlenu(pStages), sizeof(AssetPipelineProfileStage), CompareProfileStages);
+
+    uint32_t* pOrder = (uint32_t*)tf_malloc(max(eventCount, 1u) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < eventCount; ++i)
+        pOrder[i] = i;
+    gSortedProfileEvents = pEvents;
+    qsort(pOrder, eventCount, sizeof(uint32_t), CompareProfileEvents);
+    gSortedProfileEvents = NULL;
+
+    char text[512] = {};
+    int  size = snprintf(text, sizeof(text), "{\n  \"timeMs\": %.3f,\n  \"threads\": %u,\n  \"stages\": [", endTime / 1000.0,
+                         (uint32_t)arrlenu(pProfile->pThreadIds));
+    fsWriteToStream(&file, text, (size_t)size);
+
+    // Parallelism is the summed time of the scopes over the time between the first start and the last end of the stage, stages that
+    // take long with a parallelism close to 1 are the ones worth spreading over more threads
+    for (uint32_t s = 0; s < (uint32_t)arrlenu(pStages); ++s)
+    {
+        const AssetPipelineProfileStage* pStage = &pStages[s];
+        const int64_t                    span = max(pStage->mLastEnd - pStage->mFirstStart, (int64_t)1);
+        const char*                      stageStart = s ? ",\n    { \"stage\": " : "\n    { \"stage\": ";
+        fsWriteToStream(&file, stageStart, strlen(stageStart));
+        WriteJsonString(&file, pStage->pStage);
+        size = snprintf(text, sizeof(text),
+                        ", \"count\": %u, \"wallMs\": %.3f, \"cpuMs\": %.3f, \"spanMs\": %.3f, \"parallelism\": %.2f, \"bytesIn\": %llu, "
+                        "\"bytesOut\": %llu, \"slowestMs\": %.3f, \"slowestFile\": ",
+                        pStage->mCount, pStage->mTime / 1000.0, pStage->mCpuTime / 1000.0, span / 1000.0,
+                        (double)pStage->mTime / (double)span, (unsigned long long)pStage->mBytesIn, (unsigned long long)pStage->mBytesOut,
+                        pEvents[pStage->mSlowestEvent].mTime / 1000.0);
+        fsWriteToStream(&file, text, (size_t)size);
+        WriteJsonString(&file, pEvents[pStage->mSlowestEvent].pFileName);
+        fsWriteToStream(&file, " }", 2);
+    }
 
-            ++assetsProcessed;
-        }
-        else
-        {
-            LOGF(eINFO, "Skeleton for mesh '%s' up to date, loading from disk: %s", skeletonInputFile, skeletonOutput);
+    const char* scopesStart = "\n  ],\n  \"scopes\": [";
+    fsWriteToStream(&file, scopesStart, strlen(scopesStart));
+    for (uint32_t i = 0; i < eventCount; ++i)
+    {
+        const AssetPipelineProfileEvent* pEvent = &pEvents[pOrder[i]];
+        const char*                      eventStart = i ? ",\n    { \"stage\": " : "\n    { \"stage\": ";
+        fsWriteToStream(&file, eventStart, strlen(eventStart));
+        WriteJsonString(&file, pEvent->pStage);
+        fsWriteToStream(&file, ", \"file\": ", strlen(", \"file\": "));
+        WriteJsonString(&file, pEvent->pFileName);
+        size = snprintf(text, sizeof(text),
+                        ", \"thread\": %u, \"startMs\": %.3f, \"wallMs\": %.3f, \"cpuMs\": %.3f, \"bytesIn\": %llu, \"bytesOut\": %llu }",
+                        pEvent->mThreadIndex, pEvent->mStartTime / 1000.0, pEvent->mTime / 1000.0, pEvent->mCpuTime / 1000.0,
+                        (unsigned long long)pEvent->mBytesIn, (unsigned long long)pEvent->mBytesOut);
+        fsWriteToStream(&file, text, (size_t)size);
+    }
+    fsWriteToStream(&file, "\n  ]\n}\n", strlen("\n  ]\n}\n"));
 
-            // Load skeleton from disk
-            FileStream file = {};
-            if (!fsOpenStreamFromPath(assetParams->mRDOutput, skeletonOutput, FM_READ, &file))
-            {
-                LOGF(eERROR, "Couldn't load Skeleton for mesh '%s' in %s. Skipping asset and all it's animations", skeletonInputFile,
-                     skeletonOutput);
-                success = false;
-                continue; // TODO: We could add a parameter so that the user can select whether to stop processing more assets or not when
-                          // encountering an error
-            }
-            ozz::io::IArchive archive(&file);
-            archive >> skeleton;
-            fsCloseStream(&file);
-        }
+    releaseMutex(&pProfile->mMutex);
 
-        // Process animations
-        for (uint32_t a = 0, animEnd = (uint32_t)arrlen(skeletonAndAnims->mAnimations); a < animEnd; ++a)
-        {
-            const SkeletonAndAnimations::AnimationFile* anim = &skeletonAndAnims->mAnimations[a];
-            const char*                                 animInputFile = (char*)anim->mInputAnim.data;
-            const char*                                 animOutputPath = (char*)anim->mOutputAnimPath.data;
+    tf_free(pOrder);
+    arrfree(pStages);
+    fsCloseStream(&file);
+    return true;
+}
 
-            assetsChecked++;
+bool WriteAssetPipelineProfileTrace(AssetPipelineProfile* pProfile, ResourceDirectory resourceDir, const char* fileName)
+{
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, fileName, FM_WRITE, &file))
+    {
+        LOGF(eERROR, "Couldn't open profile trace '%s' for write", fileName);
+        return false;
+    }
 
-            // Check if the animation is already up-to-date
-            bool processAnimation = true;
-            if (!assetParams->mSettings.force && !processSkeleton)
-            {
-                time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, animInputFile);
-                if (assetParams->mAdditionalModifiedTime != 0)
-                    lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
-                time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, animOutputPath);
+    acquireMutex(&pProfile->mMutex);
 
-                if (lastModified < lastProcessed && lastProcessed != ~0u && lastModified > assetParams->mSettings.minLastModifiedTime)
-                    processAnimation = false;
-            }
+    const char* traceStart = "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [";
+    fsWriteToStream(&file, traceStart, strlen(traceStart));
 
-            if (processAnimation)
-            {
-                LOGF(eINFO, "Processing animations for mesh '%s': %s -> %s", skeletonInputFile, animInputFile, animOutputPath);
+    // Complete events, scopes of the same thread nest when a thread assisted other tasks while waiting
+    char text[512] = {};
+    for (uint32_t i = 0; i < (uint32_t)arrlenu(pProfile->pEvents); ++i)
+    {
+        const AssetPipelineProfileEvent* pEvent = &pProfile->pEvents[i];
+        const char*                      eventStart = i ? ",\n    { \"name\": " : "\n    { \"name\": ";
+        fsWriteToStream(&file, eventStart, strlen(eventStart));
+        WriteJsonString(&file, pEvent->pStage);
+        int size = snprintf(text, sizeof(text),
+                            ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %lld, \"dur\": %lld, \"args\": { \"file\": ",
+                            pEvent->mThreadIndex, (long long)pEvent->mStartTime, (long long)pEvent->mTime);
+        fsWriteToStream(&file, text, (size_t)size);
+        WriteJsonString(&file, pEvent->pFileName);
+        size = snprintf(text, sizeof(text), ", \"cpuMs\": %.3f, \"bytesIn\": %llu, \"bytesOut\": %llu } }", pEvent->mCpuTime / 1000.0,
+                        (unsigned long long)pEvent->mBytesIn, (unsigned long long)pEvent->mBytesOut);
+        fsWriteToStream(&file, text, (size_t)size);
+    }
+    fsWriteToStream(&file, "\n  ]\n}\n", strlen("\n  ]\n}\n"));
 
-                // Process the animation
-                if (CreateRuntimeAnimations(assetParams->mRDInput, animInputFile, animOutputPath, &skeleton,
-                                            &pProcessAnimationsParams->mAnimationSettings, &assetParams->mSettings))
-                {
-                    LOGF(eERROR, "Failed to process animation for mesh '%s': %s -> %s", skeletonInputFile, animInputFile, animOutputPath);
-                    success = false;
-                    continue;
-                }
+    releaseMutex(&pProfile->mMutex);
 
-                ++assetsProcessed;
-            }
-        }
+    fsCloseStream(&file);
+    return true;
+}
+
+/************************************************************************/
+// Build cache
+/************************************************************************/
+// Bump when a process changes its output for the same inputs and settings so outputs built by older versions are rebuilt
+#define BUILD_CACHE_VERSION     1u
+#define BUILD_CACHE_HEADER      "# AssetPipeline build cache"
+#define BUILD_CACHE_READ_CHUNK  (64 * 1024)
+
+typedef struct BuildCacheEntry
+{
+    char*    key; // Output file name
+    uint64_t value;
+} BuildCacheEntry;
+
+struct BuildCache
+{
+    // Processes like ProcessTextures query and store from their worker threads
+    Mutex            mMutex;
+    BuildCacheEntry* pEntries; // stbds string hashmap
+    bool             mDirty;
+};
 
-        skeleton.Deallocate();
+uint64_t BuildCacheHash(uint64_t hash, const void* pData, size_t size)
+{
+    const uint8_t* pBytes = (const uint8_t*)pData;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= pBytes[i];
+        hash *= 0x100000001b3ull;
     }
+    return hash;
+}
 
-    LOGF(LogLevel::eINFO, "ProcessAnimations: checked %u assets, regenerated %u assets.", assetsChecked, assetsProcessed);
-    return !success;
+bool BuildCacheHashFile(ResourceDirectory resourceDir, const char* fileName, uint64_t* pHash)
+{
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, fileName, FM_READ, &file))
+    {
+        return false;
+    }
+
+    const ssize_t  fileSize = fsGetStreamFileSize(&file);
+    const uint64_t hashedSize = (uint64_t)fileSize;
+    uint64_t       hash = BuildCacheHash(*pHash, &hashedSize, sizeof(hashedSize));
+    uint8_t*       pChunk = (uint8_t*)tf_malloc(BUILD_CACHE_READ_CHUNK);
+    ssize_t        remaining = fileSize;
+    while (remaining > 0)
+    {
+        const size_t readSize = fsReadFromStream(&file, pChunk, (size_t)min(remaining, (ssize_t)BUILD_CACHE_READ_CHUNK));
+        if (!readSize)
+        {
+            break;
+        }
+        hash = BuildCacheHash(hash, pChunk, readSize);
+        remaining -= (ssize_t)readSize;
+    }
+    tf_free(pChunk);
+    fsCloseStream(&file);
+
+    *pHash = hash;
+    return remaining == 0;
 }
 
-bool ProcessTFX(AssetPipelineParams* assetParams, ProcessTressFXParams* tfxParams)
+static void GetSharedBuildCacheFileName(const char* outFileName, uint64_t hash, char* pOutName)
 {
-    cgltf_result result = cgltf_result_success;
+    // Outputs are content addressed, the extension only helps to inspect the directory
+    char extension[FS_MAX_PATH] = {};
+    fsGetPathExtension(outFileName, extension);
+    snprintf(pOutName, FS_MAX_PATH, "%016llx.%s", (unsigned long long)hash, extension);
+}
 
-    // Get all tfx files
-    char** tfxFiles = NULL;
-    int    tfxFileCount = 0;
-    if (assetParams->mPathMode == PROCESS_MODE_DIRECTORY)
+bool BuildCacheIsUpToDate(AssetPipelineParams* assetParams, const char* outFileName, uint64_t hash)
+{
+    BuildCache* pCache = assetParams->pBuildCache;
+    if (!pCache)
     {
-        fsGetFilesWithExtension(assetParams->mRDInput, "", "tfx", &tfxFiles, &tfxFileCount);
+        return false;
     }
-    else
+
+    acquireMutex(&pCache->mMutex);
+    const ptrdiff_t index = shgeti(pCache->pEntries, outFileName);
+    const bool      sameHash = index >= 0 && pCache->pEntries[index].value == hash;
+    releaseMutex(&pCache->mMutex);
+
+    if (sameHash && fsFileExist(assetParams->mRDOutput, outFileName))
     {
-        tfxFiles = (char**)tf_malloc(sizeof(char**));
-        tfxFiles[0] = (char*)assetParams->mInFilePath;
-        tfxFileCount = 1;
+        return true;
     }
 
-#define RETURN_IF_TFX_ERROR(expression)     \
-    if (!(expression))                      \
-    {                                       \
-        LOGF(eERROR, "Failed to load tfx"); \
-        return false;                       \
+    if (!assetParams->mSettings.useSharedBuildCache)
+    {
+        return false;
     }
 
-    for (int i = 0; i < tfxFileCount; ++i)
+    char sharedFileName[FS_MAX_PATH] = {};
+    GetSharedBuildCacheFileName(outFileName, hash, sharedFileName);
+    if (!fsFileExist(assetParams->mRDSharedBuildCache, sharedFileName))
     {
-        const char* input = tfxFiles[i];
-        char        outputTemp[FS_MAX_PATH] = {};
-        fsGetPathFileName(input, outputTemp);
-        char output[FS_MAX_PATH] = {};
-        fsAppendPathExtension(outputTemp, "gltf", output);
+        return false;
+    }
 
-        char binFilePath[FS_MAX_PATH] = {};
-        fsAppendPathExtension(outputTemp, "bin", binFilePath);
+    CreateDirectoryForFile(assetParams->mRDOutput, outFileName);
+    if (!fsCopyFile(assetParams->mRDSharedBuildCache, sharedFileName, assetParams->mRDOutput, outFileName))
+    {
+        LOGF(eWARNING, "Failed to copy '%s' from the shared build cache to '%s'", sharedFileName, outFileName);
+        fsRemoveFile(assetParams->mRDOutput, outFileName);
+        return false;
+    }
 
-        FileStream tfxFile = {};
-        fsOpenStreamFromPath(assetParams->mRDInput, input, FM_READ, &tfxFile);
-        AMD::TressFXAsset tressFXAsset = {};
-        RETURN_IF_TFX_ERROR(tressFXAsset.LoadHairData(&tfxFile))
-        fsCloseStream(&tfxFile);
+    LOGF(eINFO, "Fetched %s from the shared build cache", outFileName);
 
-        if (tfxParams->mFollowHairCount)
-        {
-            RETURN_IF_TFX_ERROR(tressFXAsset.GenerateFollowHairs(tfxParams->mFollowHairCount, tfxParams->mTipSeperationFactor,
-                                                                 tfxParams->mMaxRadiusAroundGuideHair))
-        }
+    acquireMutex(&pCache->mMutex);
+    shput(pCache->pEntries, outFileName, hash);
+    pCache->mDirty = true;
+    releaseMutex(&pCache->mMutex);
+    return true;
+}
 
-        RETURN_IF_TFX_ERROR(tressFXAsset.ProcessAsset())
+void BuildCacheStore(AssetPipelineParams* assetParams, const char* outFileName, uint64_t hash)
+{
+    BuildCache* pCache = assetParams->pBuildCache;
+    if (!pCache)
+    {
+        return;
+    }
 
-        struct TypePair
-        {
-            cgltf_type           type;
-            cgltf_component_type comp;
-        };
-        const TypePair vertexTypes[] = {
-            { cgltf_type_scalar, cgltf_component_type_r_32u }, // Indices
-            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Position
-            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Tangents
-            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Global rotations
-            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Local rotations
-            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Ref vectors
-            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Follow root offsets
-            { cgltf_type_vec2, cgltf_component_type_r_32f },   // Strand UVs
-            { cgltf_type_scalar, cgltf_component_type_r_32u }, // Strand types
-            { cgltf_type_scalar, cgltf_component_type_r_32f }, // Thickness coeffs
-            { cgltf_type_scalar, cgltf_component_type_r_32f }, // Rest lengths
-        };
-        const uint32_t vertexStrides[] = {
-            sizeof(uint32_t), // Indices
-            sizeof(float4),   // Position
-            sizeof(float4),   // Tangents
-            sizeof(float4),   // Global rotations
-            sizeof(float4),   // Local rotations
-            sizeof(float4),   // Ref vectors
-            sizeof(float4),   // Follow root offsets
-            sizeof(float2),   // Strand UVs
-            sizeof(uint32_t), // Strand types
-            sizeof(float),    // Thickness coeffs
-            sizeof(float),    // Rest lengths
-        };
-        const uint32_t vertexCounts[] = {
-            (uint32_t)tressFXAsset.GetNumHairTriangleIndices(), // Indices
-            (uint32_t)tressFXAsset.m_numTotalVertices,          // Position
-            (uint32_t)tressFXAsset.m_numTotalVertices,          // Tangents
-            (uint32_t)tressFXAsset.m_numTotalVertices,          // Global rotations
-            (uint32_t)tressFXAsset.m_numTotalVertices,          // Local rotations
-            (uint32_t)tressFXAsset.m_numTotalVertices,          // Ref vectors
-            (uint32_t)tressFXAsset.m_numTotalStrands,           // Follow root offsets
-            (uint32_t)tressFXAsset.m_numTotalStrands,           // Strand UVs
-            (uint32_t)tressFXAsset.m_numTotalStrands,           // Strand types
-            (uint32_t)tressFXAsset.m_numTotalVertices,          // Thickness coeffs
-            (uint32_t)tressFXAsset.m_numTotalVertices,          // Rest lengths
-        };
-        const void* vertexData[] = {
-            tressFXAsset.m_triangleIndices,   // Indices
-            tressFXAsset.m_positions,         // Position
-            tressFXAsset.m_tangents,          // Tangents
-            tressFXAsset.m_globalRotations,   // Global rotations
-            tressFXAsset.m_localRotations,    // Local rotations
-            tressFXAsset.m_refVectors,        // Ref vectors
-            tressFXAsset.m_followRootOffsets, // Follow root offsets
-            tressFXAsset.m_strandUV,          // Strand UVs
-            tressFXAsset.m_strandTypes,       // Strand types
-            tressFXAsset.m_thicknessCoeffs,   // Thickness coeffs
-            tressFXAsset.m_restLengths,       // Rest lengths
-        };
-        const char* vertexNames[] = {
-            "INDEX",      // Indices
-            "POSITION",   // Position
-            "TANGENT",    // Tangents
-            "TEXCOORD_0", // Global rotations
-            "TEXCOORD_1", // Local rotations
-            "TEXCOORD_2", // Ref vectors
-            "TEXCOORD_3", // Follow root offsets
-            "TEXCOORD_4", // Strand UVs
-            "TEXCOORD_5", // Strand types
-            "TEXCOORD_6", // Thickness coeffs
-            "TEXCOORD_7", // Rest lengths
-        };
-        const uint32_t count = sizeof(vertexData) / sizeof(vertexData[0]);
+    acquireMutex(&pCache->mMutex);
+    shput(pCache->pEntries, outFileName, hash);
+    pCache->mDirty = true;
+    releaseMutex(&pCache->mMutex);
 
-        cgltf_buffer      buffer = {};
-        cgltf_accessor    accessors[count] = {};
-        cgltf_buffer_view views[count] = {};
-        cgltf_attribute   attribs[count] = {};
-        cgltf_mesh        mesh = {};
-        cgltf_primitive   prim = {};
-        cgltf_size        offset = 0;
-        FileStream        binFile = {};
-        fsOpenStreamFromPath(assetParams->mRDOutput, binFilePath, FM_WRITE, &binFile);
-        size_t fileSize = 0;
+    if (!assetParams->mSettings.useSharedBuildCache)
+    {
+        return;
+    }
 
-        for (uint32_t j = 0; j < count; ++j)
+    char sharedFileName[FS_MAX_PATH] = {};
+    GetSharedBuildCacheFileName(outFileName, hash, sharedFileName);
+    if (fsFileExist(assetParams->mRDSharedBuildCache, sharedFileName))
+    {
+        return;
+    }
+
+    // Copy under a unique name and rename so other machines never see a partially written file
+    char tempFileName[FS_MAX_PATH] = {};
+    snprintf(tempFileName, sizeof(tempFileName), "%s.%llx.%llx.tmp", sharedFileName, (unsigned long long)getCurrentThreadID(),
+             (unsigned long long)getUSec(false));
+    if (!fsCopyFile(assetParams->mRDOutput, outFileName, assetParams->mRDSharedBuildCache, tempFileName) ||
+        !fsRenameFile(assetParams->mRDSharedBuildCache, tempFileName, sharedFileName))
+    {
+        // Another process might have stored the same output in the meantime
+        if (!fsFileExist(assetParams->mRDSharedBuildCache, sharedFileName))
         {
-            views[j].type = (j ? cgltf_buffer_view_type_vertices : cgltf_buffer_view_type_indices);
-            views[j].buffer = &buffer;
-            views[j].offset = offset;
-            views[j].size = vertexCounts[j] * vertexStrides[j];
-            accessors[j].component_type = vertexTypes[j].comp;
-            accessors[j].stride = vertexStrides[j];
-            accessors[j].count = vertexCounts[j];
-            accessors[j].offset = 0;
-            accessors[j].type = vertexTypes[j].type;
-            accessors[j].buffer_view = &views[j];
+            LOGF(eWARNING, "Failed to store '%s' in the shared build cache", outFileName);
+        }
+        fsRemoveFile(assetParams->mRDSharedBuildCache, tempFileName);
+    }
+}
 
-            attribs[j].name = (char*)vertexNames[j];
-            attribs[j].data = &accessors[j];
+static BuildCache* LoadBuildCache(AssetPipelineParams* assetParams)
+{
+    BuildCache* pCache = (BuildCache*)tf_calloc(1, sizeof(BuildCache));
+    initMutex(&pCache->mMutex);
+    sh_new_strdup(pCache->pEntries);
 
-            fileSize += fsWriteToStream(&binFile, vertexData[j], views[j].size);
-            offset += views[j].size;
-        }
-        fsCloseStream(&binFile);
+    FileStream file = {};
+    if (!fsFileExist(assetParams->mRDOutput, BUILD_CACHE_DATABASE_FILE_NAME) ||
+        !fsOpenStreamFromPath(assetParams->mRDOutput, BUILD_CACHE_DATABASE_FILE_NAME, FM_READ, &file))
+    {
+        return pCache;
+    }
 
-        char uri[FS_MAX_PATH] = {};
-        fsGetPathFileName(binFilePath, uri);
-        // sprintf(uri, "%s", fn.buffer);
-        buffer.uri = uri;
-        buffer.size = fileSize;
+    const ssize_t fileSize = fsGetStreamFileSize(&file);
+    char*         pText = (char*)tf_malloc((size_t)fileSize + 1);
+    pText[fsReadFromStream(&file, pText, (size_t)fileSize)] = 0;
+    fsCloseStream(&file);
 
-        prim.indices = accessors;
-        prim.attributes_count = count - 1;
-        prim.attributes = attribs + 1;
-        prim.type = cgltf_primitive_type_triangles;
+    // One "<hash> <output file>" pair per line, the header also stores the version
+    unsigned int version = 0;
+    if (sscanf(pText, BUILD_CACHE_HEADER " v%u", &version) == 1 && version == BUILD_CACHE_VERSION)
+    {
+        char* pLine = strchr(pText, '\n');
+        while (pLine && *++pLine)
+        {
+            char* pLineEnd = strchr(pLine, '\n');
+            if (pLineEnd)
+            {
+                *pLineEnd = 0;
+                if (pLineEnd > pLine && pLineEnd[-1] == '\r')
+                    pLineEnd[-1] = 0;
+            }
 
-        mesh.primitives_count = 1;
-        mesh.primitives = &prim;
+            char*    pPath = NULL;
+            uint64_t hash = strtoull(pLine, &pPath, 16);
+            if (pPath != pLine && *pPath == ' ' && pPath[1])
+            {
+                shput(pCache->pEntries, pPath + 1, hash);
+            }
+            pLine = pLineEnd;
+        }
+    }
+    else
+    {
+        LOGF(eINFO, "Build cache database was written by another version, all outputs are rebuilt");
+    }
+    tf_free(pText);
 
-        char extras[128] = {};
-        snprintf(extras, sizeof extras, "{ \"%s\" : %d, \"%s\" : %d }", "mVertexCountPerStrand", tressFXAsset.m_numVerticesPerStrand,
-                 "mGuideCountPerStrand", tressFXAsset.m_numGuideStrands);
+    LOGF(eINFO, "Loaded %u entries from the build cache database", (uint32_t)shlenu(pCache->pEntries));
+    return pCache;
+}
 
-        char       generator[] = "TressFX";
-        cgltf_data data = {};
-        data.asset.generator = generator;
-        data.buffers_count = 1;
-        data.buffers = &buffer;
-        data.buffer_views_count = count;
-        data.buffer_views = views;
-        data.accessors_count = count;
+static void SaveAndFreeBuildCache(AssetPipelineParams* assetParams, BuildCache* pCache)
+{
+    if (pCache->mDirty)
+    {
+        FileStream file = {};
+        if (fsOpenStreamFromPath(assetParams->mRDOutput, BUILD_CACHE_DATABASE_FILE_NAME, FM_WRITE, &file))
+        {
+            char line[FS_MAX_PATH + 32] = {};
+            int  lineSize = snprintf(line, sizeof(line), BUILD_CACHE_HEADER " v%u\n", BUILD_CACHE_VERSION);
+            fsWriteToStream(&file, line, (size_t)lineSize);
+            for (size_t i = 0, count = shlenu(pCache->pEntries); i < count; ++i)
+            {
+                lineSize = snprintf(line, sizeof(line), "%016llx %s\n", (unsigned long long)pCache->pEntries[i].value,
+                                    pCache->pEntries[i].key);
+                fsWriteToStream(&file, line, (size_t)min(lineSize, (int)sizeof(line) - 1));
+            }
+            fsCloseStream(&file);
+        }
+        else
+        {
+            LOGF(eERROR, "Couldn't open build cache database '%s' for write", BUILD_CACHE_DATABASE_FILE_NAME);
+        }
+    }
+
+    shfree(pCache->pEntries);
+    destroyMutex(&pCache->mMutex);
+    tf_free(pCache);
+}
+
+void ReleaseSkeletonAndAnimationParams(SkeletonAndAnimations* pArray, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bdestroy(&pArray[i].mSkeletonInFile);
+        bdestroy(&pArray[i].mSkeletonOutFile);
+
+        for (uint32_t a = 0, end = (uint32_t)arrlen(pArray[i].mAnimations); a < end; ++a)
+        {
+            bdestroy(&pArray[i].mAnimations[a].mInputAnim);
+            bdestroy(&pArray[i].mAnimations[a].mOutputAnimPath);
+        }
+
+        arrfree(pArray[i].mAnimations);
+    }
+}
+
+void ReleaseSkeletonAndAnimationParams(SkeletonAndAnimations* pStbdsArray)
+{
+    ReleaseSkeletonAndAnimationParams(pStbdsArray, (uint32_t)arrlen(pStbdsArray));
+    arrfree(pStbdsArray);
+}
+
+cgltf_result cgltf_parse_and_load(ResourceDirectory resourceDir, const char* skeletonAsset, cgltf_data** ppData, void** ppFileData)
+{
+    // Import the glTF with the animation
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, skeletonAsset, FM_READ, &file))
+    {
+        LOGF(eERROR, "Failed to open gltf file %s", skeletonAsset);
+        ASSERT(false);
+        return cgltf_result_file_not_found;
+    }
+
+    ssize_t fileSize = fsGetStreamFileSize(&file);
+    void*   fileData = tf_malloc(fileSize);
+
+    fsReadFromStream(&file, fileData, fileSize);
+
+    cgltf_data*   data = NULL;
+    cgltf_options options = {};
+    options.memory_alloc = [](void* user, cgltf_size size)
+    {
+        UNREF_PARAM(user);
+        return tf_malloc(size);
+    };
+    options.memory_free = [](void* user, void* ptr)
+    {
+        UNREF_PARAM(user);
+        tf_free(ptr);
+    };
+    options.rd = resourceDir;
+    cgltf_result result = cgltf_parse(&options, fileData, fileSize, &data);
+    fsCloseStream(&file);
+
+    if (!VERIFYMSG(cgltf_result_success == result, "Failed to parse gltf file %s with error %u", skeletonAsset, (uint32_t)result))
+    {
+        tf_free(fileData);
+        return result;
+    }
+
+    result = cgltf_validate(data);
+    if (cgltf_result_success != result)
+    {
+        LOGF(eWARNING, "GLTF validation finished with error %u for file %s", (uint32_t)result, skeletonAsset);
+    }
+
+    // Load buffers located in separate files (.bin) using our file system
+    for (uint32_t i = 0; i < data->buffers_count; ++i)
+    {
+        const char* uri = data->buffers[i].uri;
+
+        if (!uri || data->buffers[i].data)
+        {
+            continue;
+        }
+
+        if (strncmp(uri, "data:", 5) != 0 && !strstr(uri, "://"))
+        {
+            char parent[FS_MAX_PATH] = { 0 };
+            fsGetParentPath(skeletonAsset, parent);
+            char path[FS_MAX_PATH] = { 0 };
+            fsAppendPathComponent(parent, uri, path);
+            FileStream fs = {};
+            if (fsOpenStreamFromPath(resourceDir, path, FM_READ, &fs))
+            {
+                ASSERT(fsGetStreamFileSize(&fs) >= (ssize_t)data->buffers[i].size);
+                data->buffers[i].data = tf_malloc(data->buffers[i].size);
+                fsReadFromStream(&fs, data->buffers[i].data, data->buffers[i].size);
+                fsCloseStream(&fs);
+            }
+        }
+    }
+
+    result = cgltf_load_buffers(&options, data, skeletonAsset);
+    if (!VERIFYMSG(cgltf_result_success == result, "Failed to load buffers from gltf file %s with error %u", skeletonAsset,
+                   (uint32_t)result))
+    {
+        tf_free(fileData);
+        return result;
+    }
+
+    *ppData = data;
+    *ppFileData = fileData;
+
+    return result;
+}
+
+cgltf_result cgltf_write(ResourceDirectory resourceDir, const char* skeletonAsset, cgltf_data* data)
+{
+    cgltf_options options = {};
+    options.memory_alloc = [](void* user, cgltf_size size)
+    {
+        UNREF_PARAM(user);
+        return tf_malloc(size);
+    };
+    options.memory_free = [](void* user, void* ptr)
+    {
+        UNREF_PARAM(user);
+        tf_free(ptr);
+    };
+    options.rd = resourceDir;
+    cgltf_size expected = cgltf_write(&options, NULL, 0, data);
+    char*      writeBuffer = (char*)tf_malloc(expected);
+    cgltf_size actual = cgltf_write(&options, writeBuffer, expected, data);
+    if (expected != actual)
+    {
+        LOGF(eERROR, "Error: expected %zu bytes but wrote %zu bytes.\n", expected, actual);
+        return cgltf_result_invalid_gltf;
+    }
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, skeletonAsset, FM_WRITE, &file))
+    {
+        tf_free(writeBuffer);
+        return cgltf_result_io_error;
+    }
+
+    fsWriteToStream(&file, writeBuffer, actual - 1);
+    fsCloseStream(&file);
+    tf_free(writeBuffer);
+
+    return cgltf_result_success;
+}
+
+static void DiscoverExtraAnimationsForMesh(ResourceDirectory resourceDirInput, const char* searchRootDir,
+                                           const char* extraAnimationsSubdirName, SkeletonAndAnimations* pSkeletonAndAnimations)
+{
+    // Find sub directory called animations
+    char** assetSubDirectories = NULL;
+    int    assetSubDirectoryCount = 0;
+    fsGetSubDirectories(resourceDirInput, searchRootDir, &assetSubDirectories, &assetSubDirectoryCount);
+    if (assetSubDirectories)
+    {
+        for (int k = 0; k < assetSubDirectoryCount; ++k)
+        {
+            const char* assetSubDir = assetSubDirectories[k];
+
+            char subDir[FS_MAX_PATH] = {};
+            fsGetPathFileName(assetSubDir, subDir);
+            if (!stricmp(subDir, extraAnimationsSubdirName))
+            {
+                // Add all files in animations to the animation asset
+                char** animationFiles = NULL;
+                int    animationFileCount = 0;
+                fsGetFilesWithExtension(resourceDirInput, assetSubDir, ".gltf", &animationFiles, &animationFileCount);
+                if (animationFiles)
+                {
+                    for (int curAnim = 0; curAnim < animationFileCount; ++curAnim)
+                    {
+                        // Create animation output file name
+                        bstring animOutputFileString = bempty();
+                        bcatcstr(&animOutputFileString, "/");
+                        bcatcstr(&animOutputFileString, extraAnimationsSubdirName);
+                        bcatcstr(&animOutputFileString, "/");
+
+                        SkeletonAndAnimations::AnimationFile anim = {};
+                        anim.mInputAnim = bdynfromcstr(animationFiles[curAnim]);
+                        anim.mOutputAnimPath = animOutputFileString;
+                        arrpush(pSkeletonAndAnimations->mAnimations, anim);
+
+                        LOGF(eINFO, "Found extra animation file '%s'", (const char*)anim.mInputAnim.data);
+                    }
+                    tf_free(animationFiles);
+                }
+                break;
+            }
+        }
+
+        tf_free(assetSubDirectories);
+    }
+}
+
+// One animation file of a skeleton, the files only read the skeleton so all of them are baked concurrently
+typedef struct AnimationClipTask
+{
+    AssetPipelineParams*                        pAssetParams;
+    ProcessAnimationsParams*                    pAnimationsParams;
+    const ozz::animation::Skeleton*             pSkeleton;
+    const SkeletonAndAnimations::AnimationFile* pAnimation;
+    bool                                        mProcess;
+    bool                                        mError;
+    // Microseconds spent baking the file
+    int64_t                                     mTime;
+    AssetPipelineTaskGroup*                     pGroup;
+} AnimationClipTask;
+
+// One skeleton and its animations, the skeleton is built or loaded first since every clip is sampled against it
+typedef struct SkeletonTask
+{
+    AssetPipelineParams*         pAssetParams;
+    ProcessAnimationsParams*     pAnimationsParams;
+    ThreadSystem                 mThreadSystem;
+    const SkeletonAndAnimations* pSkeletonAndAnims;
+    AnimationClipTask*           pClipTasks;
+    bool                         mProcess;
+    bool                         mError;
+    // Microseconds spent building or loading the skeleton
+    int64_t                      mTime;
+} SkeletonTask;
+
+static void ProcessAnimationClipTask(void* pUser, uint64_t)
+{
+    AnimationClipTask* pTask = (AnimationClipTask*)pUser;
+    if (pTask->mProcess)
+    {
+        AssetPipelineParams* assetParams = pTask->pAssetParams;
+        const char*          animInputFile = (char*)pTask->pAnimation->mInputAnim.data;
+        AssetPipelineScope   scope = BeginAssetPipelineScope(assetParams, "Animation", animInputFile);
+        // CreateRuntimeAnimations doesn't modify the skeleton, it only takes a non const pointer
+        pTask->mError = CreateRuntimeAnimations(assetParams->mRDInput, animInputFile, (char*)pTask->pAnimation->mOutputAnimPath.data,
+                                                (ozz::animation::Skeleton*)pTask->pSkeleton,
+                                                &pTask->pAnimationsParams->mAnimationSettings, &assetParams->mSettings);
+        // Files with several animations write one output per animation to the output path, only the input is measured
+        pTask->mTime = EndAssetPipelineScope(assetParams, &scope, GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDInput,
+                                                                                                  animInputFile), 0);
+    }
+    EndAssetPipelineTask(pTask->pGroup);
+}
+
+static void ProcessSkeleton(SkeletonTask* pTask)
+{
+    AssetPipelineParams*         assetParams = pTask->pAssetParams;
+    const SkeletonAndAnimations* skeletonAndAnims = pTask->pSkeletonAndAnims;
+    const char*                  skeletonInputFile = (char*)skeletonAndAnims->mSkeletonInFile.data;
+    const char*                  skeletonOutput = (char*)skeletonAndAnims->mSkeletonOutFile.data;
+
+    // Check if the skeleton is already up-to-date
+    pTask->mProcess = true;
+    if (!assetParams->mSettings.force)
+    {
+        time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, skeletonInputFile);
+        if (assetParams->mAdditionalModifiedTime != 0)
+            lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
+        time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, skeletonOutput);
+
+        if (lastModified < lastProcessed && lastProcessed != ~0u && lastProcessed > assetParams->mSettings.minLastModifiedTime)
+            pTask->mProcess = false;
+    }
+
+    AssetPipelineScope       scope = BeginAssetPipelineScope(assetParams, "Skeleton", skeletonInputFile);
+    ozz::animation::Skeleton skeleton;
+    if (pTask->mProcess)
+    {
+        // Process the skeleton
+        if (CreateRuntimeSkeleton(assetParams->mRDInput, skeletonInputFile, assetParams->mRDOutput,
+                                  pTask->pAnimationsParams->mAnimationSettings.mSkeletonAndAnimOutRd, skeletonOutput, &skeleton,
+                                  &assetParams->mSettings))
+        {
+            pTask->mError = true;
+            return;
+        }
+    }
+    else
+    {
+        // Load skeleton from disk
+        FileStream file = {};
+        if (!fsOpenStreamFromPath(assetParams->mRDOutput, skeletonOutput, FM_READ, &file))
+        {
+            pTask->mError = true;
+            return;
+        }
+        ozz::io::IArchive archive(&file);
+        archive >> skeleton;
+        fsCloseStream(&file);
+    }
+    // Loading an up to date skeleton reads the output
+    const uint64_t inputSize = pTask->mProcess ? GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDInput, skeletonInputFile)
+                                               : GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDOutput, skeletonOutput);
+    const uint64_t outputSize = pTask->mProcess ? GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDOutput, skeletonOutput) : 0;
+    pTask->mTime = EndAssetPipelineScope(assetParams, &scope, inputSize, outputSize);
+
+    const uint32_t         animCount = (uint32_t)arrlen(skeletonAndAnims->mAnimations);
+    AssetPipelineTaskGroup group = {};
+    for (uint32_t a = 0; a < animCount; ++a)
+    {
+        const SkeletonAndAnimations::AnimationFile* anim = &skeletonAndAnims->mAnimations[a];
+        AnimationClipTask*                          pClipTask = &pTask->pClipTasks[a];
+        pClipTask->pAssetParams = assetParams;
+        pClipTask->pAnimationsParams = pTask->pAnimationsParams;
+        pClipTask->pSkeleton = &skeleton;
+        pClipTask->pAnimation = anim;
+        pClipTask->pGroup = &group;
+
+        // Check if the animation is already up-to-date
+        pClipTask->mProcess = true;
+        if (!assetParams->mSettings.force && !pTask->mProcess)
+        {
+            time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, (char*)anim->mInputAnim.data);
+            if (assetParams->mAdditionalModifiedTime != 0)
+                lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
+            time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, (char*)anim->mOutputAnimPath.data);
+
+            if (lastModified < lastProcessed && lastProcessed != ~0u && lastModified > assetParams->mSettings.minLastModifiedTime)
+                pClipTask->mProcess = false;
+        }
+    }
+
+    // The calling thread might be a worker of the same thread system (one task per skeleton). The skeleton lives on this stack so it has
+    // to outlive all the clips.
+    BeginAssetPipelineTaskGroup(&group, animCount);
+    threadSystemAddTaskGroup(pTask->mThreadSystem, ProcessAnimationClipTask, animCount, pTask->pClipTasks);
+    WaitAssetPipelineTaskGroup(pTask->mThreadSystem, &group);
+
+    skeleton.Deallocate();
+}
+
+static void ProcessSkeletonTask(void* pUser, uint64_t) { ProcessSkeleton((SkeletonTask*)pUser); }
+
+bool ProcessAnimations(AssetPipelineParams* assetParams, ProcessAnimationsParams* pProcessAnimationsParams)
+{
+    LOGF(eINFO, "Processing animations and writing to directory: %s", fsGetResourceDirectory(assetParams->mRDOutput));
+
+    const SkeletonAndAnimations* pSkeletonAndAnims = pProcessAnimationsParams->pSkeletonAndAnims;
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pSkeletonAndAnims); ++i)
+    {
+        if (arrlen(pSkeletonAndAnims[i].mAnimations) == 0)
+            LOGF(LogLevel::eWARNING, "Skeleton '%s' has no associated animations.", (char*)pSkeletonAndAnims[i].mSkeletonInFile.data);
+    }
+
+    // No assets found. Return.
+    if (arrlen(pSkeletonAndAnims) == 0)
+    {
+        LOGF(eINFO, "No animation files found to process");
+        return true;
+    }
+
+    const uint32_t skeletonCount = (uint32_t)arrlen(pSkeletonAndAnims);
+    LOGF(eINFO, "Processing %u skeleton assets and their animations...", skeletonCount);
+
+    ThreadSystem threadSystem = AcquireAssetPipelineThreadSystem(assetParams, "ProcessAnimations");
+
+    // Clip tasks of all the skeletons are allocated up front so that results can be reported in input order once everything is done
+    uint32_t clipCount = 0;
+    for (uint32_t i = 0; i < skeletonCount; ++i)
+        clipCount += (uint32_t)arrlen(pSkeletonAndAnims[i].mAnimations);
+
+    SkeletonTask*      pTasks = (SkeletonTask*)tf_calloc(skeletonCount, sizeof(SkeletonTask));
+    AnimationClipTask* pClipTasks = (AnimationClipTask*)tf_calloc(max(clipCount, 1u), sizeof(AnimationClipTask));
+    for (uint32_t i = 0, clipOffset = 0; i < skeletonCount; ++i)
+    {
+        pTasks[i].pAssetParams = assetParams;
+        pTasks[i].pAnimationsParams = pProcessAnimationsParams;
+        pTasks[i].mThreadSystem = threadSystem;
+        pTasks[i].pSkeletonAndAnims = &pSkeletonAndAnims[i];
+        pTasks[i].pClipTasks = pClipTasks + clipOffset;
+        clipOffset += (uint32_t)arrlen(pSkeletonAndAnims[i].mAnimations);
+    }
+
+    const int64_t startTime = getUSec(false);
+    threadSystemAddTaskGroup(threadSystem, ProcessSkeletonTask, skeletonCount, pTasks);
+    while (threadSystemAssist(threadSystem))
+        ;
+    threadSystemWaitIdle(threadSystem);
+    const int64_t totalTime = getUSec(false) - startTime;
+
+    ReleaseAssetPipelineThreadSystem(assetParams, &threadSystem);
+
+    // Report the results in input order
+    uint32_t assetsProcessed = 0;
+    uint32_t assetsChecked = 0;
+    int64_t  clipTime = 0;
+    bool     success = true;
+    for (uint32_t i = 0; i < skeletonCount; ++i)
+    {
+        const SkeletonTask* pTask = &pTasks[i];
+        const char*         skeletonInputFile = (char*)pTask->pSkeletonAndAnims->mSkeletonInFile.data;
+        const char*         skeletonOutput = (char*)pTask->pSkeletonAndAnims->mSkeletonOutFile.data;
+
+        assetsChecked++;
+
+        if (pTask->mError)
+        {
+            LOGF(eERROR, "Couldn't %s Skeleton for mesh '%s' in %s. Skipping asset and all it's animations",
+                 pTask->mProcess ? "create" : "load", skeletonInputFile, skeletonOutput);
+            success = false;
+            continue;
+        }
+
+        if (pTask->mProcess)
+        {
+            LOGF(eINFO, "Regenerated Skeleton in %.2f ms: %s -> %s", pTask->mTime / 1000.0, skeletonInputFile, skeletonOutput);
+            ++assetsProcessed;
+        }
+        else
+        {
+            LOGF(eINFO, "Skeleton for mesh '%s' up to date, loaded from disk: %s", skeletonInputFile, skeletonOutput);
+        }
+        RecordAssetPipelineAsset(assetParams, skeletonInputFile, pTask->mProcess);
+
+        for (uint32_t a = 0, animEnd = (uint32_t)arrlen(pTask->pSkeletonAndAnims->mAnimations); a < animEnd; ++a)
+        {
+            const AnimationClipTask* pClipTask = &pTask->pClipTasks[a];
+            const char*              animInputFile = (char*)pClipTask->pAnimation->mInputAnim.data;
+            const char*              animOutputPath = (char*)pClipTask->pAnimation->mOutputAnimPath.data;
+
+            assetsChecked++;
+
+            if (pClipTask->mError)
+            {
+                LOGF(eERROR, "Failed to process animation for mesh '%s': %s -> %s", skeletonInputFile, animInputFile, animOutputPath);
+                success = false;
+                continue;
+            }
+
+            if (pClipTask->mProcess)
+            {
+                LOGF(eINFO, "Processed animations for mesh '%s' in %.2f ms: %s -> %s", skeletonInputFile, pClipTask->mTime / 1000.0,
+                     animInputFile, animOutputPath);
+                clipTime += pClipTask->mTime;
+                ++assetsProcessed;
+            }
+            RecordAssetPipelineAsset(assetParams, animInputFile, pClipTask->mProcess);
+        }
+    }
+    tf_free(pClipTasks);
+    tf_free(pTasks);
+
+    LOGF(LogLevel::eINFO,
+         "ProcessAnimations: checked %u assets, regenerated %u assets in %.2f ms with %u threads (summed over animation files: %.2f ms).",
+         assetsChecked, assetsProcessed, totalTime / 1000.0, assetParams->mSettings.threadCount, clipTime / 1000.0);
+    return !success;
+}
+
+// Strands from the first to be drawn to the last: the guides, then the first follow hair of every guide and so on. Guides of the same
+// rank are visited in bit reversed order so that every prefix is spread over the whole asset.
+static void GetTressFXStrandOrder(uint32_t guideCount, uint32_t followCount, uint32_t* pOrder)
+{
+    uint32_t bits = 0;
+    while ((1u << bits) < guideCount)
+        ++bits;
+
+    uint32_t count = 0;
+    for (uint32_t rank = 0; rank <= followCount; ++rank)
+    {
+        for (uint32_t i = 0; i < (1u << bits); ++i)
+        {
+            uint32_t guide = 0;
+            for (uint32_t b = 0; b < bits; ++b)
+                guide |= ((i >> b) & 1u) << (bits - 1 - b);
+            if (guide < guideCount)
+                pOrder[count++] = guide * (followCount + 1) + rank;
+        }
+    }
+}
+
+// Moves strand pOrder[k] of pData to position k, every strand takes strandSize bytes
+static void ReorderTressFXStrands(void* pData, uint32_t strandCount, uint32_t strandSize, const uint32_t* pOrder)
+{
+    uint8_t* pCopy = (uint8_t*)tf_malloc((size_t)strandCount * strandSize);
+    memcpy(pCopy, pData, (size_t)strandCount * strandSize);
+    for (uint32_t k = 0; k < strandCount; ++k)
+        memcpy((uint8_t*)pData + (size_t)k * strandSize, pCopy + (size_t)pOrder[k] * strandSize, strandSize);
+    tf_free(pCopy);
+}
+
+bool ProcessTFX(AssetPipelineParams* assetParams, ProcessTressFXParams* tfxParams)
+{
+    cgltf_result result = cgltf_result_success;
+
+    // Get all tfx files
+    char** tfxFiles = NULL;
+    int    tfxFileCount = 0;
+    if (assetParams->mPathMode == PROCESS_MODE_DIRECTORY)
+    {
+        fsGetFilesWithExtension(assetParams->mRDInput, "", "tfx", &tfxFiles, &tfxFileCount);
+    }
+    else
+    {
+        tfxFiles = (char**)tf_malloc(sizeof(char**));
+        tfxFiles[0] = (char*)assetParams->mInFilePath;
+        tfxFileCount = 1;
+    }
+
+#define RETURN_IF_TFX_ERROR(expression)     \
+    if (!(expression))                      \
+    {                                       \
+        LOGF(eERROR, "Failed to load tfx"); \
+        return false;                       \
+    }
+
+    for (int i = 0; i < tfxFileCount; ++i)
+    {
+        const char* input = tfxFiles[i];
+        char        outputTemp[FS_MAX_PATH] = {};
+        fsGetPathFileName(input, outputTemp);
+        char output[FS_MAX_PATH] = {};
+        fsAppendPathExtension(outputTemp, "gltf", output);
+
+        char binFilePath[FS_MAX_PATH] = {};
+        fsAppendPathExtension(outputTemp, "bin", binFilePath);
+
+        AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, "TressFX", input);
+
+        FileStream tfxFile = {};
+        fsOpenStreamFromPath(assetParams->mRDInput, input, FM_READ, &tfxFile);
+        AMD::TressFXAsset tressFXAsset = {};
+        RETURN_IF_TFX_ERROR(tressFXAsset.LoadHairData(&tfxFile))
+        fsCloseStream(&tfxFile);
+
+        if (tfxParams->mFollowHairCount)
+        {
+            RETURN_IF_TFX_ERROR(tressFXAsset.GenerateFollowHairs(tfxParams->mFollowHairCount, tfxParams->mTipSeperationFactor,
+                                                                 tfxParams->mMaxRadiusAroundGuideHair))
+        }
+
+        RETURN_IF_TFX_ERROR(tressFXAsset.ProcessAsset())
+
+        // Levels of detail are the first strands of the vertex and index buffers, every strand array is stored in the draw order. The
+        // guides come first so that a level can be simulated on its own.
+        const uint32_t strandCount = (uint32_t)tressFXAsset.m_numTotalStrands;
+        const uint32_t vertexCountPerStrand = (uint32_t)tressFXAsset.m_numVerticesPerStrand;
+        const uint32_t strandIndexCount = 6 * (vertexCountPerStrand - 1);
+        const uint32_t lodCount = min(tfxParams->mLodCount, (uint32_t)GEOMETRY_MAX_LODS - 1);
+        uint32_t       lodStrandCounts[GEOMETRY_MAX_LODS] = { strandCount };
+        if (lodCount > 0)
+        {
+            uint32_t* pOrder = (uint32_t*)tf_malloc(strandCount * sizeof(uint32_t) * 2);
+            uint32_t* pNewIndices = pOrder + strandCount;
+            GetTressFXStrandOrder((uint32_t)tressFXAsset.m_numGuideStrands, (uint32_t)tressFXAsset.m_numFollowStrandsPerGuide, pOrder);
+            for (uint32_t k = 0; k < strandCount; ++k)
+                pNewIndices[pOrder[k]] = k;
+
+            const uint32_t vertexStrandSize = vertexCountPerStrand * (uint32_t)sizeof(float4);
+            ReorderTressFXStrands(tressFXAsset.m_positions, strandCount, vertexStrandSize, pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_tangents, strandCount, vertexStrandSize, pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_globalRotations, strandCount, vertexStrandSize, pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_localRotations, strandCount, vertexStrandSize, pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_refVectors, strandCount, vertexStrandSize, pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_thicknessCoeffs, strandCount, vertexCountPerStrand * (uint32_t)sizeof(float), pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_restLengths, strandCount, vertexCountPerStrand * (uint32_t)sizeof(float), pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_followRootOffsets, strandCount, (uint32_t)sizeof(float4), pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_strandUV, strandCount, (uint32_t)sizeof(float2), pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_strandTypes, strandCount, (uint32_t)sizeof(int32_t), pOrder);
+            ReorderTressFXStrands(tressFXAsset.m_triangleIndices, strandCount, strandIndexCount * (uint32_t)sizeof(int32_t), pOrder);
+
+            // Indices and the guide strand in w of the root offsets still point to the strands before the reorder
+            for (uint32_t k = 0; k < strandCount; ++k)
+            {
+                const int32_t shift = ((int32_t)k - (int32_t)pOrder[k]) * (int32_t)vertexCountPerStrand;
+                for (uint32_t t = 0; t < strandIndexCount; ++t)
+                    tressFXAsset.m_triangleIndices[(size_t)k * strandIndexCount + t] += shift;
+
+                float* pRootOffset = (float*)&tressFXAsset.m_followRootOffsets[k];
+                pRootOffset[3] = (float)pNewIndices[(uint32_t)pRootOffset[3]];
+            }
+            tf_free(pOrder);
+
+            for (uint32_t l = 1; l <= lodCount; ++l)
+                lodStrandCounts[l] = max((uint32_t)(lodStrandCounts[l - 1] * tfxParams->mLodStrandRatio + 0.5f), 1u);
+        }
+
+        // xyz relative to the bounds, w is the inverse mass in [0, 1]
+        const uint32_t totalVertexCount = (uint32_t)tressFXAsset.m_numTotalVertices;
+        uint16_t*      pQuantizedPositions = NULL;
+        float          positionMin[3] = {};
+        float          positionMax[3] = {};
+        if (tfxParams->mQuantizePositions)
+        {
+            const float* pPositions = (const float*)tressFXAsset.m_positions;
+            for (uint32_t c = 0; c < 3; ++c)
+                positionMin[c] = positionMax[c] = pPositions[c];
+            for (uint32_t v = 1; v < totalVertexCount; ++v)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    positionMin[c] = min(positionMin[c], pPositions[v * 4 + c]);
+                    positionMax[c] = max(positionMax[c], pPositions[v * 4 + c]);
+                }
+            }
+
+            pQuantizedPositions = (uint16_t*)tf_malloc(totalVertexCount * sizeof(uint16_t[4]));
+            for (uint32_t v = 0; v < totalVertexCount; ++v)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    const float extent = positionMax[c] - positionMin[c];
+                    const float t = extent > 0.0f ? (pPositions[v * 4 + c] - positionMin[c]) / extent : 0.0f;
+                    pQuantizedPositions[v * 4 + c] = (uint16_t)(clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+                }
+                pQuantizedPositions[v * 4 + 3] = (uint16_t)(clamp(pPositions[v * 4 + 3], 0.0f, 1.0f) * 65535.0f + 0.5f);
+            }
+        }
+
+        const cgltf_component_type positionType = pQuantizedPositions ? cgltf_component_type_r_16u : cgltf_component_type_r_32f;
+        const uint32_t             positionStride = pQuantizedPositions ? (uint32_t)sizeof(uint16_t[4]) : (uint32_t)sizeof(float4);
+        const void*                pPositionData =
+            pQuantizedPositions ? (const void*)pQuantizedPositions : (const void*)tressFXAsset.m_positions;
+
+        struct TypePair
+        {
+            cgltf_type           type;
+            cgltf_component_type comp;
+        };
+        const TypePair vertexTypes[] = {
+            { cgltf_type_scalar, cgltf_component_type_r_32u }, // Indices
+            { cgltf_type_vec4, positionType },                 // Position
+            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Tangents
+            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Global rotations
+            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Local rotations
+            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Ref vectors
+            { cgltf_type_vec4, cgltf_component_type_r_32f },   // Follow root offsets
+            { cgltf_type_vec2, cgltf_component_type_r_32f },   // Strand UVs
+            { cgltf_type_scalar, cgltf_component_type_r_32u }, // Strand types
+            { cgltf_type_scalar, cgltf_component_type_r_32f }, // Thickness coeffs
+            { cgltf_type_scalar, cgltf_component_type_r_32f }, // Rest lengths
+        };
+        const uint32_t vertexStrides[] = {
+            sizeof(uint32_t), // Indices
+            positionStride,   // Position
+            sizeof(float4),   // Tangents
+            sizeof(float4),   // Global rotations
+            sizeof(float4),   // Local rotations
+            sizeof(float4),   // Ref vectors
+            sizeof(float4),   // Follow root offsets
+            sizeof(float2),   // Strand UVs
+            sizeof(uint32_t), // Strand types
+            sizeof(float),    // Thickness coeffs
+            sizeof(float),    // Rest lengths
+        };
+        const uint32_t vertexCounts[] = {
+            (uint32_t)tressFXAsset.GetNumHairTriangleIndices(), // Indices
+            (uint32_t)tressFXAsset.m_numTotalVertices,          // Position
+            (uint32_t)tressFXAsset.m_numTotalVertices,          // Tangents
+            (uint32_t)tressFXAsset.m_numTotalVertices,          // Global rotations
+            (uint32_t)tressFXAsset.m_numTotalVertices,          // Local rotations
+            (uint32_t)tressFXAsset.m_numTotalVertices,          // Ref vectors
+            (uint32_t)tressFXAsset.m_numTotalStrands,           // Follow root offsets
+            (uint32_t)tressFXAsset.m_numTotalStrands,           // Strand UVs
+            (uint32_t)tressFXAsset.m_numTotalStrands,           // Strand types
+            (uint32_t)tressFXAsset.m_numTotalVertices,          // Thickness coeffs
+            (uint32_t)tressFXAsset.m_numTotalVertices,          // Rest lengths
+        };
+        const void* vertexData[] = {
+            tressFXAsset.m_triangleIndices,   // Indices
+            pPositionData,                    // Position
+            tressFXAsset.m_tangents,          // Tangents
+            tressFXAsset.m_globalRotations,   // Global rotations
+            tressFXAsset.m_localRotations,    // Local rotations
+            tressFXAsset.m_refVectors,        // Ref vectors
+            tressFXAsset.m_followRootOffsets, // Follow root offsets
+            tressFXAsset.m_strandUV,          // Strand UVs
+            tressFXAsset.m_strandTypes,       // Strand types
+            tressFXAsset.m_thicknessCoeffs,   // Thickness coeffs
+            tressFXAsset.m_restLengths,       // Rest lengths
+        };
+        const char* vertexNames[] = {
+            "INDEX",      // Indices
+            "POSITION",   // Position
+            "TANGENT",    // Tangents
+            "TEXCOORD_0", // Global rotations
+            "TEXCOORD_1", // Local rotations
+            "TEXCOORD_2", // Ref vectors
+            "TEXCOORD_3", // Follow root offsets
+            "TEXCOORD_4", // Strand UVs
+            "TEXCOORD_5", // Strand types
+            "TEXCOORD_6", // Thickness coeffs
+            "TEXCOORD_7", // Rest lengths
+        };
+        const uint32_t count = sizeof(vertexData) / sizeof(vertexData[0]);
+
+        cgltf_buffer      buffer = {};
+        cgltf_accessor    accessors[count] = {};
+        cgltf_buffer_view views[count] = {};
+        cgltf_attribute   attribs[count] = {};
+        cgltf_mesh        mesh = {};
+        cgltf_primitive   prim = {};
+        cgltf_size        offset = 0;
+        FileStream        binFile = {};
+        fsOpenStreamFromPath(assetParams->mRDOutput, binFilePath, FM_WRITE, &binFile);
+        size_t fileSize = 0;
+
+        for (uint32_t j = 0; j < count; ++j)
+        {
+            views[j].type = (j ? cgltf_buffer_view_type_vertices : cgltf_buffer_view_type_indices);
+            views[j].buffer = &buffer;
+            views[j].offset = offset;
+            views[j].size = vertexCounts[j] * vertexStrides[j];
+            accessors[j].component_type = vertexTypes[j].comp;
+            accessors[j].stride = vertexStrides[j];
+            accessors[j].count = vertexCounts[j];
+            accessors[j].offset = 0;
+            accessors[j].type = vertexTypes[j].type;
+            accessors[j].normalized = vertexTypes[j].comp == cgltf_component_type_r_16u;
+            accessors[j].buffer_view = &views[j];
+
+            attribs[j].name = (char*)vertexNames[j];
+            attribs[j].data = &accessors[j];
+
+            fileSize += fsWriteToStream(&binFile, vertexData[j], views[j].size);
+            offset += views[j].size;
+        }
+        fsCloseStream(&binFile);
+        tf_free(pQuantizedPositions);
+
+        char uri[FS_MAX_PATH] = {};
+        fsGetPathFileName(binFilePath, uri);
+        // sprintf(uri, "%s", fn.buffer);
+        buffer.uri = uri;
+        buffer.size = fileSize;
+
+        prim.indices = accessors;
+        prim.attributes_count = count - 1;
+        prim.attributes = attribs + 1;
+        prim.type = cgltf_primitive_type_triangles;
+
+        mesh.primitives_count = 1;
+        mesh.primitives = &prim;
+
+        // Read by ProcessGLTF (ReadTressFXExtras), the first two keys have to stay first for older readers
+        char extras[512] = {};
+        int  extrasSize = snprintf(extras, sizeof extras, "{ \"%s\" : %d, \"%s\" : %d", "mVertexCountPerStrand",
+                                   tressFXAsset.m_numVerticesPerStrand, "mGuideCountPerStrand", tressFXAsset.m_numGuideStrands);
+        if (lodCount > 0)
+        {
+            extrasSize += snprintf(extras + extrasSize, sizeof extras - extrasSize, ", \"mLodStrandCounts\" : [");
+            for (uint32_t l = 0; l <= lodCount; ++l)
+                extrasSize += snprintf(extras + extrasSize, sizeof extras - extrasSize, "%s %u", l ? "," : "", lodStrandCounts[l]);
+            extrasSize += snprintf(extras + extrasSize, sizeof extras - extrasSize, " ], \"mGuidesFirst\" : 1");
+        }
+        if (tfxParams->mQuantizePositions)
+        {
+            extrasSize += snprintf(extras + extrasSize, sizeof extras - extrasSize,
+                                   ", \"mPositionMin\" : [ %.9g, %.9g, %.9g ], \"mPositionMax\" : [ %.9g, %.9g, %.9g ]", positionMin[0],
+                                   positionMin[1], positionMin[2], positionMax[0], positionMax[1], positionMax[2]);
+        }
+        snprintf(extras + extrasSize, sizeof extras - extrasSize, " }");
+
+        LOGF(eINFO, "TressFX %s: %u strands, %u levels of detail (%u strands in the last one), %s positions", input, strandCount,
+             lodCount + 1, lodStrandCounts[lodCount], tfxParams->mQuantizePositions ? "16 bit" : "float");
+
+        char       generator[] = "TressFX";
+        cgltf_data data = {};
+        data.asset.generator = generator;
+        data.buffers_count = 1;
+        data.buffers = &buffer;
+        data.buffer_views_count = count;
+        data.buffer_views = views;
+        data.accessors_count = count;
         data.accessors = accessors;
         data.meshes_count = 1;
         data.meshes = &mesh;
@@ -673,709 +1748,1830 @@ bool ProcessTFX(AssetPipelineParams* assetParams, ProcessTressFXParams* tfxParam
         data.asset.extras.start_offset = 0;
         data.asset.extras.end_offset = strlen(extras);
         result = cgltf_write(assetParams->mRDOutput, output, &data);
+        RecordAssetPipelineAsset(assetParams, input, result == cgltf_result_success);
+
+        EndAssetPipelineScope(assetParams, &scope, GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDInput, input),
+                              fileSize + GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDOutput, output));
+    }
+
+    if (tfxFiles)
+    {
+        tf_free(tfxFiles);
+    }
+
+    return result != cgltf_result_success;
+}
+
+static uint32_t FindJoint(ozz::animation::Skeleton* skeleton, const char* name)
+{
+    for (int i = 0; i < skeleton->num_joints(); i++)
+    {
+        if (strcmp(skeleton->joint_names()[i], name) == 0)
+            return i;
+    }
+    return UINT_MAX;
+}
+
+static bool isTrsDecomposable(const Matrix4& matrix)
+{
+    if (matrix.getCol0().getW() != 0.0 || matrix.getCol1().getW() != 0.0 || matrix.getCol2().getW() != 0.0 ||
+        matrix.getCol3().getW() != 1.0)
+    {
+        return false;
+    }
+
+    if (determinant(matrix) == 0.0)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool CreateRuntimeSkeleton(ResourceDirectory resourceDirInput, const char* skeletonInputfile, ResourceDirectory resourceDirGltfOutput,
+                           ResourceDirectory resourceDirOzzOutput, const char* skeletonOutputFile, ozz::animation::Skeleton* pOutSkeleton,
+                           ProcessAssetsSettings* settings)
+{
+    UNREF_PARAM(settings);
+    cgltf_data*  data = NULL;
+    void*        srcFileData = NULL;
+    cgltf_result result = cgltf_parse_and_load(resourceDirInput, skeletonInputfile, &data, &srcFileData);
+    if (cgltf_result_success != result)
+    {
+        LOGF(LogLevel::eERROR, "gltf parsing failed: %s", skeletonInputfile);
+        return true;
+    }
+
+    if (data->skins_count == 0)
+    {
+        data->file_data = srcFileData;
+        cgltf_free(data);
+        LOGF(LogLevel::eERROR, "Rigged mesh %s has no bones. Skeleton can not be created.", skeletonInputfile);
+        return true;
+    }
+
+    // Gather node info
+    // Used to mark nodes that should be included in the skeleton
+    SkeletonNodeInfo*      nodeData = nullptr;
+    size_t                 startIndex = data->nodes_count - 1;
+    const SkeletonNodeInfo startNode{ bdynfromcstr(data->nodes[startIndex].name), &data->nodes[startIndex] };
+    arrpush(nodeData, startNode);
+
+    const uint32_t queueSize = (uint32_t)(data->nodes_count + 1);
+    int32_t*       nodeQueue = nullptr; // Simple queue because tinystl doesn't have one
+    arrsetlen(nodeQueue, queueSize);
+    for (uint32_t i = 0; i < queueSize; ++i)
+        nodeQueue[i] = -1;
+    nodeQueue[0] = 0;
+    uint32_t nodeQueueStart = 0;
+    uint32_t nodeQueueEnd = 1;
+    while (nodeQueue[nodeQueueStart] != -1)
+    {
+        // Pop
+        int32_t     nodeIndex = nodeQueue[nodeQueueStart];
+        cgltf_node* node = nodeData[nodeIndex].pNode;
+        nodeQueue[nodeQueueStart] = -1;
+
+        for (uint i = 0; i < node->children_count; ++i)
+        {
+            SkeletonNodeInfo childNode = {};
+            childNode.mName = bdynfromcstr(node->children[i]->name);
+            childNode.pParentNodeIndex = nodeIndex;
+            const int32_t childNodeIndex = (int32_t)arrlen(nodeData);
+            childNode.pNode = node->children[i];
+            arrpush(nodeData, childNode);
+
+            arrpush(nodeData[nodeIndex].mChildNodeIndices, childNodeIndex);
+
+            const uint32_t queueIdx = nodeQueueEnd;
+            ASSERT(queueIdx != nodeQueueStart && "Seems like we didn't allocate enough space for the queue");
+            if (queueIdx == nodeQueueStart)
+            {
+                LOGF(LogLevel::eERROR, "Too many nodes in scene. Skeleton '%s' can not be created.", skeletonInputfile);
+                return true;
+            }
+
+            nodeQueueEnd = (nodeQueueEnd + 1) % queueSize;
+
+            // Push
+            nodeQueue[queueIdx] = childNodeIndex;
+        }
+
+        nodeQueueStart++;
+        ASSERT(nodeQueueStart < (uint32_t)arrlen(nodeQueue) && "Seems like we didn't allocate enough space for the queue");
+    }
+
+    arrfree(nodeQueue);
+    nodeQueue = nullptr;
+
+    // Mark all nodes that are required to be in the skeleton
+    for (cgltf_size i = 0; i < data->skins_count; ++i)
+    {
+        cgltf_skin* skin = &data->skins[i];
+        for (cgltf_size j = 0; j < skin->joints_count; ++j)
+        {
+            cgltf_node* bone = skin->joints[j];
+            for (cgltf_size k = 0; k < (cgltf_size)arrlen(nodeData); ++k)
+            {
+                if (strcmp((const char*)nodeData[k].mName.data, bone->name) == 0)
+                {
+                    int32_t nodeIndex = (int32_t)k;
+                    while (nodeIndex != -1)
+                    {
+                        if (nodeData[nodeIndex].mUsedInSkeleton)
+                            break; // Remaining part of the tree is already marked
+                        nodeData[nodeIndex].mUsedInSkeleton = true;
+                        nodeIndex = nodeData[nodeIndex].pParentNodeIndex;
+                    }
+                }
+            }
+        }
+    }
+
+    // Create raw skeleton
+    ozz::animation::offline::RawSkeleton rawSkeleton = {};
+
+    SkeletonBoneInfo*      boneData = nullptr;
+    const SkeletonBoneInfo firstBone{ 0, -1, NULL };
+    arrpush(boneData, firstBone);
+
+    while (arrlen(boneData) != 0)
+    {
+        SkeletonBoneInfo boneInfo = arrlast(boneData);
+        arrpop(boneData);
+        SkeletonNodeInfo* nodeInfo = &nodeData[boneInfo.mNodeIndex];
+        cgltf_node*       node = nodeInfo->pNode;
+
+        // Get node transform
+
+        // Create joint from node
+        ozz::animation::offline::RawSkeleton::Joint joint;
+
+        if (!node->has_matrix)
+        {
+            joint.transform.translation = vec3(node->translation[0], node->translation[1], node->translation[2]);
+            joint.transform.rotation = Quat(node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3]);
+            joint.transform.scale =
+                vec3(node->scale[0], node->scale[1], node->scale[2]); // *(boneInfo.mParentNodeIndex == -1 ? 0.01f : 1.f);
+        }
+        else
+        {
+            // Matrix Decomposition
+            Matrix4 mat;
+            mat.setCol0(vec4(node->matrix[0], node->matrix[1], node->matrix[2], node->matrix[3]));
+            mat.setCol1(vec4(node->matrix[4], node->matrix[5], node->matrix[6], node->matrix[7]));
+            mat.setCol2(vec4(node->matrix[8], node->matrix[9], node->matrix[10], node->matrix[11]));
+            mat.setCol3(vec4(node->matrix[12], node->matrix[13], node->matrix[14], node->matrix[15]));
+
+            if (isTrsDecomposable(mat))
+            {
+                // extract translation
+                joint.transform.translation = mat.getTranslation();
+
+                // extract the scaling factors from columns of the matrix
+                Matrix3 upperMat = mat.getUpper3x3();
+                vec3    pScaling = vec3(length(upperMat.getCol0()), length(upperMat.getCol1()), length(upperMat.getCol2()));
+
+                // and the sign of the scaling
+                if (determinant(mat) < 0)
+                    pScaling = -pScaling;
+                joint.transform.scale = pScaling; //*(boneInfo.mParentNodeIndex == -1 ? 0.01f : 1.f);
+
+                // and remove all scaling from the matrix
+                if (pScaling.getX())
+                    upperMat.setCol0(upperMat.getCol0() / pScaling.getX());
+                if (pScaling.getY())
+                    upperMat.setCol1(upperMat.getCol1() / pScaling.getY());
+                if (pScaling.getZ())
+                    upperMat.setCol2(upperMat.getCol2() / pScaling.getZ());
+
+                // and generate the rotation quaternion from it
+                joint.transform.rotation = Quat(upperMat);
+            }
+        }
+
+        bassign(&joint.name, &nodeInfo->mName);
+
+        // Add node to raw skeleton
+        ozz::animation::offline::RawSkeleton::Joint* newParentJoint = NULL;
+        if (boneInfo.pParentJoint == NULL)
+        {
+            arrpush(rawSkeleton.roots, joint);
+            newParentJoint = &arrlast(rawSkeleton.roots);
+        }
+        else
+        {
+            arrpush(boneInfo.pParentJoint->children, joint);
+            newParentJoint = &arrlast(boneInfo.pParentJoint->children);
+        }
+
+        // Count the child nodes that are required to be in the skeleton
+        int requiredChildCount = 0;
+        for (uint i = 0; i < (uint)arrlen(nodeInfo->mChildNodeIndices); ++i)
+        {
+            SkeletonNodeInfo* childNodeInfo = &nodeData[nodeInfo->mChildNodeIndices[i]];
+            if (childNodeInfo->mUsedInSkeleton)
+                ++requiredChildCount;
+        }
+
+        // Add child nodes to the list of nodes to process
+        arrsetcap(newParentJoint->children, requiredChildCount); // Reserve to make sure memory isn't reallocated later.
+        for (uint i = 0; i < (uint)arrlen(nodeInfo->mChildNodeIndices); ++i)
+        {
+            SkeletonNodeInfo* childNodeInfo = &nodeData[nodeInfo->mChildNodeIndices[i]];
+            if (childNodeInfo->mUsedInSkeleton)
+            {
+                boneInfo.mNodeIndex = nodeInfo->mChildNodeIndices[i];
+                boneInfo.mParentNodeIndex = boneInfo.mNodeIndex;
+                boneInfo.pParentJoint = newParentJoint;
+                arrpush(boneData, boneInfo);
+            }
+        }
+    }
+
+    for (uint32_t i = 0, end = (uint32_t)arrlen(nodeData); i < end; ++i)
+    {
+        bdestroy(&nodeData[i].mName);
+        arrfree(nodeData[i].mChildNodeIndices);
+    }
+
+    arrfree(boneData);
+    boneData = nullptr;
+    arrfree(nodeData);
+    nodeData = nullptr;
+
+    // Validate raw skeleton
+    if (!rawSkeleton.Validate())
+    {
+        LOGF(LogLevel::eERROR, "Skeleton created for %s is invalid. Skeleton can not be created.", skeletonInputfile);
+        return true;
+    }
+
+    // Build runtime skeleton from raw skeleton
+    if (!ozz::animation::offline::SkeletonBuilder::Build(rawSkeleton, pOutSkeleton))
+    {
+        LOGF(LogLevel::eERROR, "Failed to build Skeleton: %s", skeletonInputfile);
+        return true;
+    }
+
+    // Ensure output dir exists before we write the skeleton to disk
+    {
+        char directory[FS_MAX_PATH] = {};
+        fsGetParentPath(skeletonOutputFile, directory);
+        fsCreateDirectory(resourceDirOzzOutput, directory, true);
+    }
+
+    // Write skeleton to disk
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDirOzzOutput, skeletonOutputFile, FM_WRITE, &file))
+        return true;
+
+    ozz::io::OArchive archive(&file);
+    archive << *pOutSkeleton;
+    fsCloseStream(&file);
+
+    // Generate joint remaps in the gltf
+    {
+        char*    buffer = nullptr;
+        uint32_t size = 0;
+
+        for (uint32_t i = 0; i < data->meshes_count; ++i)
+        {
+            cgltf_mesh* mesh = &data->meshes[i];
+            cgltf_node* node = NULL;
+            for (uint32_t n = 0; n < data->nodes_count; ++n)
+            {
+                if (data->nodes[n].mesh == mesh)
+                {
+                    node = &data->nodes[n];
+                    break;
+                }
+            }
+
+            if (node && node->mesh && node->skin)
+            {
+                cgltf_skin* skin = node->skin;
+
+                char     jointRemaps[1024] = {};
+                uint32_t offset = 0;
+                offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, "[ ");
+
+                for (uint32_t j = 0; j < skin->joints_count; ++j)
+                {
+                    const cgltf_node* jointNode = skin->joints[j];
+                    uint32_t          jointIndex = FindJoint(pOutSkeleton, jointNode->name);
+                    if (j == 0)
+                        offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, "%u", jointIndex);
+                    else
+                        offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, ", %u", jointIndex);
+                }
+
+                offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, " ]");
+                skin->extras.start_offset = size;
+                size += (uint32_t)strlen(jointRemaps) + 1;
+                skin->extras.end_offset = size - 1;
+
+                const size_t iterCount = strlen(jointRemaps) + 1;
+                for (uint32_t j = 0; j < iterCount; ++j)
+                    arrpush(buffer, jointRemaps[j]);
+            }
+        }
+
+        for (uint32_t i = 0; i < data->buffers_count; ++i)
+        {
+            if (strncmp(data->buffers[i].uri, "://", 3) == 0)
+            {
+                char parentPath[FS_MAX_PATH] = {};
+                fsGetParentPath(skeletonInputfile, parentPath);
+                char bufferOut[FS_MAX_PATH] = {};
+                fsAppendPathComponent(parentPath, data->buffers[i].uri, bufferOut);
+
+                LOGF(eINFO, "Writing binary gltf data: %s -> %s", skeletonInputfile, bufferOut);
+
+                FileStream fs = {};
+                fsOpenStreamFromPath(resourceDirGltfOutput, bufferOut, FM_WRITE, &fs);
+                fsWriteToStream(&fs, data->buffers[i].data, data->buffers[i].size);
+                fsCloseStream(&fs);
+            }
+        }
+
+        LOGF(eINFO, "Writing text gltf data: %s -> %s", skeletonInputfile, skeletonInputfile);
+
+        data->file_data = buffer;
+        if (cgltf_result_success != cgltf_write(resourceDirGltfOutput, skeletonInputfile, data))
+        {
+            LOGF(eERROR, "Couldn't write the gltf file with the remapped joint data for it's skeleton.");
+            arrfree(buffer);
+            return true;
+        }
+
+        arrfree(buffer);
+    }
+
+    data->file_data = srcFileData;
+    cgltf_free(data);
+
+    const bool error = false;
+    return error;
+}
+
+static bool CreateRuntimeAnimation(RuntimeAnimationSettings* animationSettings, cgltf_animation* animationData, const char* animOutFile,
+                                   ozz::animation::Skeleton* skeleton, const char* animationSourceFile)
+{
+    ASSERT(animationData && skeleton);
+
+    // Create raw animation
+    ozz::animation::offline::RawAnimation rawAnimation = {};
+    rawAnimation.name = bdynfromcstr(animationData->name);
+    rawAnimation.duration = 0.f;
+
+    arrsetlen(rawAnimation.tracks, skeleton->num_joints());
+    memset(rawAnimation.tracks, 0, sizeof(*rawAnimation.tracks) * skeleton->num_joints());
+
+    for (uint i = 0; i < (uint)skeleton->num_joints(); ++i)
+    {
+        const char* jointName = skeleton->joint_names()[i];
+
+        ozz::animation::offline::RawAnimation::JointTrack* track = &rawAnimation.tracks[i];
+
+        for (cgltf_size channelIndex = 0; channelIndex < animationData->channels_count; channelIndex += 1)
+        {
+            cgltf_animation_channel* channel = &animationData->channels[channelIndex];
+
+            if (strcmp(channel->target_node->name, jointName) != 0)
+                continue;
+
+            if (channel->target_path == cgltf_animation_path_type_translation)
+            {
+                arrsetlen(track->translations, channel->sampler->output->count);
+                memset((char*)track->translations, 0, sizeof(*track->translations) * channel->sampler->output->count);
+                for (cgltf_size j = 0; j < channel->sampler->output->count; j += 1)
+                {
+                    float time = 0.0;
+                    vec3  translation = vec3(0.0f);
+                    cgltf_accessor_read_float(channel->sampler->input, j, &time, 1);
+                    cgltf_accessor_read_float(channel->sampler->output, j, (float*)&translation, 3);
+
+                    track->translations[j] = { time, translation };
+                }
+            }
+
+            if (channel->target_path == cgltf_animation_path_type_rotation)
+            {
+                arrsetlen(track->rotations, channel->sampler->output->count);
+                memset((char*)track->rotations, 0, sizeof(*track->rotations) * channel->sampler->output->count);
+                for (cgltf_size j = 0; j < channel->sampler->output->count; j += 1)
+                {
+                    float time = 0.0;
+                    Quat  rotation = Quat(0.0f);
+                    cgltf_accessor_read_float(channel->sampler->input, j, &time, 1);
+                    cgltf_accessor_read_float(channel->sampler->output, j, (float*)&rotation, 4);
+
+                    track->rotations[j] = { time, rotation };
+                }
+            }
+
+            if (channel->target_path == cgltf_animation_path_type_scale)
+            {
+                arrsetlen(track->scales, channel->sampler->output->count);
+                memset((char*)track->scales, 0, sizeof(*track->scales) * channel->sampler->output->count);
+                for (cgltf_size j = 0; j < channel->sampler->output->count; j += 1)
+                {
+                    float time = 0.0;
+                    vec3  scale = vec3(0.0f);
+                    cgltf_accessor_read_float(channel->sampler->input, j, &time, 1);
+                    cgltf_accessor_read_float(channel->sampler->output, j, (float*)&scale, 3);
+
+                    track->scales[j] = { time, scale };
+                }
+            }
+        }
+
+        if (arrlen(track->translations) != 0)
+            rawAnimation.duration = max(rawAnimation.duration, arrlast(track->translations).time);
+
+        if (arrlen(track->rotations) != 0)
+            rawAnimation.duration = max(rawAnimation.duration, arrlast(track->rotations).time);
+
+        if (arrlen(track->scales) != 0)
+            rawAnimation.duration = max(rawAnimation.duration, arrlast(track->scales).time);
+    }
+
+    // Validate raw animation
+    if (!rawAnimation.Validate())
+    {
+        LOGF(LogLevel::eERROR, "Animation %s:%s is invalid. Animation can not be created.", animationSourceFile, animationData->name);
+        return true;
+    }
+
+    ozz::animation::offline::RawAnimation* rawAnimToBuild = &rawAnimation;
+
+    ozz::animation::offline::RawAnimation optimizedRawAnimation = {};
+    if (animationSettings->mOptimizeTracks)
+    {
+        LOGF(eINFO, "Optimizing tracks...");
+        ozz::animation::offline::AnimationOptimizer optimizer = {};
+        optimizer.setting.tolerance = animationSettings->mOptimizationTolerance;
+        optimizer.setting.distance = animationSettings->mOptimizationDistance;
+        if (!optimizer(rawAnimation, *skeleton, &optimizedRawAnimation))
+        {
+            LOGF(LogLevel::eERROR, "Animation %s:%s could not be optimized for skeleton.", animationSourceFile, animationData->name);
+            return true;
+        }
+
+        rawAnimToBuild = &optimizedRawAnimation;
+    }
+
+    // Build runtime animation from raw animation
+    ozz::animation::Animation animation = {};
+    if (!ozz::animation::offline::AnimationBuilder::Build(*rawAnimToBuild, &animation))
+    {
+        LOGF(LogLevel::eERROR, "Animation %s:%s can not be created.", animationSourceFile, animationData->name);
+        return true;
+    }
+
+    // Ensure output dir exists before we write the animations to disk
+    {
+        char directory[FS_MAX_PATH] = {};
+        fsGetParentPath(animOutFile, directory);
+        fsCreateDirectory(animationSettings->mSkeletonAndAnimOutRd, directory, true);
+    }
+
+    // Write animation to disk
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(animationSettings->mSkeletonAndAnimOutRd, animOutFile, FM_WRITE, &file))
+    {
+        LOGF(LogLevel::eERROR, "Animation %s:%s can not be saved to %s/%s", animationSourceFile, animationData->name,
+             fsGetResourceDirectory(animationSettings->mSkeletonAndAnimOutRd), animOutFile);
+        animation.Deallocate();
+        return true;
+    }
+
+    ozz::io::OArchive archive(&file);
+    archive << animation;
+    fsCloseStream(&file);
+    // Deallocate animation
+    animation.Deallocate();
+
+    return false;
+}
+
+bool CreateRuntimeAnimations(ResourceDirectory resourceDirInput, const char* animationInputFile, const char* animationOutputPath,
+                             ozz::animation::Skeleton* skeleton, RuntimeAnimationSettings* animationSettings,
+                             ProcessAssetsSettings* settings)
+{
+    UNREF_PARAM(settings);
+    // Import the glTF with the animation
+    cgltf_data*  data = NULL;
+    void*        srcFileData = NULL;
+    cgltf_result result = cgltf_parse_and_load(resourceDirInput, animationInputFile, &data, &srcFileData);
+    if (result != cgltf_result_success)
+    {
+        return true;
+    }
+
+    // Check if the asset contains any animations
+    if (data->animations_count == 0)
+    {
+        LOGF(LogLevel::eWARNING, "Animation asset %s contains no animations.", animationInputFile);
+
+        tf_free(srcFileData);
+        cgltf_free(data);
+        return true;
+    }
+
+    LOGF(eINFO, "Processing %u animations from file '%s'", (uint32_t)data->animations_count, animationInputFile);
+
+    bool error = false;
+    for (cgltf_size animationIndex = 0; animationIndex < data->animations_count; animationIndex += 1)
+    {
+        cgltf_animation* animationData = &data->animations[animationIndex];
+
+        LOGF(eINFO, "Processing animation %u: %s", (uint32_t)animationIndex, animationData->name);
+
+        char buffer[FS_MAX_PATH] = {};
+        if (data->animations_count == 1)
+        {
+            // If the file only contains one animation we use the name of the input file as the output file
+            char inAnimFilename[FS_MAX_PATH / 2] = {};
+            fsGetPathFileName(animationInputFile, inAnimFilename);
+            snprintf(buffer, sizeof(buffer), "%s/%s.ozz", animationOutputPath, inAnimFilename);
+        }
+        else
+        {
+            // When the input file contains more than one animation we use the name of the animation so that we don't have collisions
+            snprintf(buffer, sizeof(buffer), "%s/%s.ozz", animationOutputPath, animationData->name);
+        }
+
+        const char*   animOutFilePath = buffer;
+        const int64_t startTime = getUSec(false);
+        if (CreateRuntimeAnimation(animationSettings, animationData, animOutFilePath, skeleton, animationInputFile))
+            error = true;
+        else
+            LOGF(eINFO, "Baked animation %u: %s in %.2f ms", (uint32_t)animationIndex, animationData->name,
+                 (getUSec(false) - startTime) / 1000.0);
+    }
+
+    tf_free(srcFileData);
+    cgltf_free(data);
+
+    return error;
+}
+
+static inline constexpr ShaderSemantic util_cgltf_attrib_type_to_semantic(cgltf_attribute_type type, uint32_t index)
+{
+    switch (type)
+    {
+    case cgltf_attribute_type_position:
+        return SEMANTIC_POSITION;
+    case cgltf_attribute_type_normal:
+        return SEMANTIC_NORMAL;
+    case cgltf_attribute_type_tangent:
+        return SEMANTIC_TANGENT;
+    case cgltf_attribute_type_color:
+        return SEMANTIC_COLOR;
+    case cgltf_attribute_type_joints:
+        return SEMANTIC_JOINTS;
+    case cgltf_attribute_type_weights:
+        return SEMANTIC_WEIGHTS;
+    case cgltf_attribute_type_texcoord:
+        return (ShaderSemantic)(SEMANTIC_TEXCOORD0 + index);
+    default:
+        return SEMANTIC_TEXCOORD0;
+    }
+}
+
+static inline constexpr TinyImageFormat util_cgltf_type_to_image_format(cgltf_type type, cgltf_component_type compType)
+{
+    switch (type)
+    {
+    case cgltf_type_scalar:
+        if (cgltf_component_type_r_8 == compType)
+            return TinyImageFormat_R8_SINT;
+        else if (cgltf_component_type_r_16 == compType)
+            return TinyImageFormat_R16_SINT;
+        else if (cgltf_component_type_r_16u == compType)
+            return TinyImageFormat_R16_UINT;
+        else if (cgltf_component_type_r_32f == compType)
+            return TinyImageFormat_R32_SFLOAT;
+        else if (cgltf_component_type_r_32u == compType)
+            return TinyImageFormat_R32_UINT;
+    case cgltf_type_vec2:
+        if (cgltf_component_type_r_8 == compType)
+            return TinyImageFormat_R8G8_SINT;
+        else if (cgltf_component_type_r_16 == compType)
+            return TinyImageFormat_R16G16_SINT;
+        else if (cgltf_component_type_r_16u == compType)
+            return TinyImageFormat_R16G16_UINT;
+        else if (cgltf_component_type_r_32f == compType)
+            return TinyImageFormat_R32G32_SFLOAT;
+        else if (cgltf_component_type_r_32u == compType)
+            return TinyImageFormat_R32G32_UINT;
+    case cgltf_type_vec3:
+        if (cgltf_component_type_r_8 == compType)
+            return TinyImageFormat_R8G8B8_SINT;
+        else if (cgltf_component_type_r_16 == compType)
+            return TinyImageFormat_R16G16B16_SINT;
+        else if (cgltf_component_type_r_16u == compType)
+            return TinyImageFormat_R16G16B16_UINT;
+        else if (cgltf_component_type_r_32f == compType)
+            return TinyImageFormat_R32G32B32_SFLOAT;
+        else if (cgltf_component_type_r_32u == compType)
+            return TinyImageFormat_R32G32B32_UINT;
+    case cgltf_type_vec4:
+        if (cgltf_component_type_r_8 == compType)
+            return TinyImageFormat_R8G8B8A8_SINT;
+        else if (cgltf_component_type_r_8u == compType)
+            return TinyImageFormat_R8G8B8A8_UINT;
+        else if (cgltf_component_type_r_16 == compType)
+            return TinyImageFormat_R16G16B16A16_SINT;
+        else if (cgltf_component_type_r_16u == compType)
+            return TinyImageFormat_R16G16B16A16_UINT;
+        else if (cgltf_component_type_r_32f == compType)
+            return TinyImageFormat_R32G32B32A32_SFLOAT;
+        else if (cgltf_component_type_r_32u == compType)
+            return TinyImageFormat_R32G32B32A32_UINT;
+        // #NOTE: Not applicable to vertex formats
+    case cgltf_type_mat2:
+    case cgltf_type_mat3:
+    case cgltf_type_mat4:
+    default:
+        return TinyImageFormat_UNDEFINED;
+    }
+}
+
+typedef void (*PackingFunction)(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset, const uint8_t* src, uint8_t* dst);
+
+static inline void util_pack_float2_to_half2(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset, const uint8_t* src,
+                                             uint8_t* dst)
+{
+    COMPILE_ASSERT(sizeof(float2) == sizeof(float[2]));
+    ASSERT(srcStride == sizeof(float2));
+    ASSERT(dstStride == sizeof(uint32_t));
+
+    float2* f = (float2*)src;
+    for (uint32_t e = 0; e < count; ++e)
+    {
+        *(uint32_t*)(dst + e * sizeof(uint32_t) + offset) = packFloat2ToHalf2(f[e]);
+    }
+}
+
+static inline void util_pack_float3_direction_to_half2(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset,
+                                                       const uint8_t* src, uint8_t* dst)
+{
+    COMPILE_ASSERT(sizeof(float3) == sizeof(float[3]));
+    ASSERT(dstStride == sizeof(uint32_t));
+    for (uint32_t e = 0; e < count; ++e)
+    {
+        float3 f = *(float3*)(src + e * srcStride);
+        *(uint32_t*)(dst + e * dstStride + offset) = packFloat3DirectionToHalf2(f);
+    }
+}
+
+static inline void util_unpack_uint8_to_uint16_joints(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset,
+                                                      const uint8_t* src, uint8_t* dst)
+{
+    ASSERT(srcStride == 4 && "Expecting stride of 4 (sizeof(uint8_t) * 4 joints)");
+
+    for (uint32_t e = 0; e < count; ++e)
+    {
+        const uint8_t* srcBase = (const uint8_t*)(src + e * srcStride);
+        uint16_t*      dstBase = (uint16_t*)(dst + e * dstStride + offset);
+        dstBase[0] = srcBase[0];
+        dstBase[1] = srcBase[1];
+        dstBase[2] = srcBase[2];
+        dstBase[3] = srcBase[3];
+    }
+}
+
+void OnGLTFFind(ResourceDirectory resourceDir, const char* filename, void* pUserData)
+{
+    UNREF_PARAM(resourceDir);
+    bstring** inputFileNames = (bstring**)pUserData;
+    arrpush(*inputFileNames, bdynfromcstr(filename));
+}
+
+void CheckIfGltfHasAnimations(ResourceDirectory resourceDirInput, const char* gltfFileName, uint32_t& numAnimationsOut)
+{
+    numAnimationsOut = 0;
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDirInput, gltfFileName, FM_READ, &file))
+    {
+        LOGF(eERROR, "Failed to open gltf file %s", gltfFileName);
+        return;
     }
 
-    if (tfxFiles)
+    ssize_t fileSize = fsGetStreamFileSize(&file);
+    void*   fileData = tf_malloc(fileSize);
+
+    fsReadFromStream(&file, fileData, fileSize);
+
+    cgltf_options options = {};
+    cgltf_data*   data = NULL;
+    options.memory_alloc = [](void* user, cgltf_size size)
     {
-        tf_free(tfxFiles);
+        UNREF_PARAM(user);
+        return tf_malloc(size);
+    };
+    options.memory_free = [](void* user, void* ptr)
+    {
+        UNREF_PARAM(user);
+        tf_free(ptr);
+    };
+    options.rd = resourceDirInput;
+    cgltf_result result = cgltf_parse(&options, fileData, fileSize, &data);
+    fsCloseStream(&file);
+
+    if (cgltf_result_success != result)
+    {
+        LOGF(eERROR, "Failed to parse gltf file %s with error %u", gltfFileName, (uint32_t)result);
+        tf_free(fileData);
+        return;
     }
 
-    return result != cgltf_result_success;
+    numAnimationsOut = (uint32_t)data->animations_count;
+
+    cgltf_free(data);
+    tf_free(fileData);
 }
 
-static uint32_t FindJoint(ozz::animation::Skeleton* skeleton, const char* name)
+/************************************************************************/
+// meshoptimizer scratch memory
+/************************************************************************/
+// Initial size of the blocks, they grow when a mesh needs more and keep that size
+#define MESHOPT_SCRATCH_INITIAL_SIZE (16 * 1024 * 1024)
+
+// Memory used by the meshoptimizer calls of one thread, returned to the pool once the primitive is processed
+typedef struct MeshoptScratch
 {
-    for (int i = 0; i < skeleton->num_joints(); i++)
-    {
-        if (strcmp(skeleton->joint_names()[i], name) == 0)
-            return i;
-    }
-    return UINT_MAX;
+    // Temporary allocations of meshoptimizer, installed with meshopt_SetScratchMemory
+    void*            pMemory;
+    size_t           mSize;
+    // Worst case outputs of meshopt_buildMeshlets (stbds arrays), the meshlets are copied out at their final size
+    meshopt_Meshlet* pMeshlets;
+    uint32_t*        pMeshletVertices;
+    uint8_t*         pMeshletTriangles;
+} MeshoptScratch;
+
+// Primitives of all the files of ProcessGLTF take their scratch from the pool, so there are never more blocks than threads
+typedef struct MeshoptScratchPool
+{
+    Mutex            mMutex;
+    MeshoptScratch** ppFreeScratches; // stbds array
+} MeshoptScratchPool;
+
+// Call before the tasks start, the allocator callbacks of meshoptimizer are globals shared by all threads
+static void InitMeshoptScratchPool(MeshoptScratchPool* pPool)
+{
+    initMutex(&pPool->mMutex);
+    pPool->ppFreeScratches = NULL;
+    meshopt_setAllocator();
 }
 
-static bool isTrsDecomposable(const Matrix4& matrix)
+static void ExitMeshoptScratchPool(MeshoptScratchPool* pPool)
 {
-    if (matrix.getCol0().getW() != 0.0 || matrix.getCol1().getW() != 0.0 || matrix.getCol2().getW() != 0.0 ||
-        matrix.getCol3().getW() != 1.0)
+    for (uint32_t i = 0; i < (uint32_t)arrlenu(pPool->ppFreeScratches); ++i)
     {
-        return false;
+        MeshoptScratch* pScratch = pPool->ppFreeScratches[i];
+        arrfree(pScratch->pMeshlets);
+        arrfree(pScratch->pMeshletVertices);
+        arrfree(pScratch->pMeshletTriangles);
+        tf_free(pScratch->pMemory);
+        tf_free(pScratch);
     }
+    arrfree(pPool->ppFreeScratches);
+    destroyMutex(&pPool->mMutex);
+}
 
-    if (determinant(matrix) == 0.0)
+// Installs a scratch of the pool as the meshoptimizer scratch memory of the calling thread
+static MeshoptScratch* AcquireMeshoptScratch(MeshoptScratchPool* pPool)
+{
+    acquireMutex(&pPool->mMutex);
+    MeshoptScratch* pScratch = arrlenu(pPool->ppFreeScratches) ? arrpop(pPool->ppFreeScratches) : NULL;
+    releaseMutex(&pPool->mMutex);
+
+    if (!pScratch)
     {
-        return false;
+        pScratch = (MeshoptScratch*)tf_calloc(1, sizeof(MeshoptScratch));
+        pScratch->mSize = MESHOPT_SCRATCH_INITIAL_SIZE;
+        pScratch->pMemory = tf_malloc(pScratch->mSize);
     }
 
-    return true;
+    meshopt_SetScratchMemory(pScratch->mSize, pScratch->pMemory);
+    return pScratch;
 }
 
-bool CreateRuntimeSkeleton(ResourceDirectory resourceDirInput, const char* skeletonInputfile, ResourceDirectory resourceDirGltfOutput,
-                           ResourceDirectory resourceDirOzzOutput, const char* skeletonOutputFile, ozz::animation::Skeleton* pOutSkeleton,
-                           ProcessAssetsSettings* settings)
+static void ReleaseMeshoptScratch(MeshoptScratchPool* pPool, MeshoptScratch* pScratch)
 {
-    UNREF_PARAM(settings);
-    cgltf_data*  data = NULL;
-    void*        srcFileData = NULL;
-    cgltf_result result = cgltf_parse_and_load(resourceDirInput, skeletonInputfile, &data, &srcFileData);
-    if (cgltf_result_success != result)
+    // meshoptimizer might have outgrown the block, it keeps the largest one
+    pScratch->pMemory = meshopt_ReleaseScratchMemory(&pScratch->mSize);
+
+    acquireMutex(&pPool->mMutex);
+    arrpush(pPool->ppFreeScratches, pScratch);
+    releaseMutex(&pPool->mMutex);
+}
+
+// Uses the scratch memory of the calling thread (AcquireMeshoptScratch)
+static void buildMeshlets(MeshoptScratch* pScratch, const uint* indices, size_t indexCount, const float3* vertexPositions,
+                          size_t vertexCount, size_t vertexPositionsStride, size_t maxVertices, size_t maxTriangles, float coneWeight,
+                          uint** meshletVertices, uint8_t** meshletTriangles, Meshlet** meshlets, MeshletData** meshletsData)
+{
+    const size_t maxMeshlets = meshopt_buildMeshletsBound(indexCount, maxVertices, maxTriangles);
+    arrsetlen(pScratch->pMeshlets, maxMeshlets);
+    arrsetlen(pScratch->pMeshletVertices, maxMeshlets * maxVertices);
+    arrsetlen(pScratch->pMeshletTriangles, maxMeshlets * maxTriangles * 3);
+
+    const size_t meshletCount =
+        meshopt_buildMeshlets(pScratch->pMeshlets, pScratch->pMeshletVertices, pScratch->pMeshletTriangles, indices, indexCount,
+                              (const float*)vertexPositions, vertexCount, vertexPositionsStride, maxVertices, maxTriangles, coneWeight);
+    if (meshletCount == 0)
     {
-        LOGF(LogLevel::eERROR, "gltf parsing failed: %s", skeletonInputfile);
-        return true;
+        if (indexCount > 0)
+            LOGF(eERROR, "Failed to build meshlets");
+        return;
     }
 
-    if (data->skins_count == 0)
+    const meshopt_Meshlet& last = pScratch->pMeshlets[meshletCount - 1];
+    const size_t           vertexTotal = last.vertex_offset + last.vertex_count;
+    const size_t           triangleTotal = last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3);
+
+    Meshlet*     meshletsOut = NULL;
+    MeshletData* meshletsDataOut = NULL;
+    uint*        meshletVerticesOut = NULL;
+    uint8_t*     meshletTrianglesOut = NULL;
+    arrsetlen(meshletsOut, meshletCount);
+    arrsetlen(meshletsDataOut, meshletCount);
+    arrsetlen(meshletVerticesOut, vertexTotal);
+    arrsetlen(meshletTrianglesOut, triangleTotal);
+    memcpy(meshletsOut, pScratch->pMeshlets, meshletCount * sizeof(*meshletsOut));
+    memcpy(meshletVerticesOut, pScratch->pMeshletVertices, vertexTotal * sizeof(*meshletVerticesOut));
+    memcpy(meshletTrianglesOut, pScratch->pMeshletTriangles, triangleTotal);
+
+    for (size_t m = 0; m < meshletCount; m++)
     {
-        data->file_data = srcFileData;
-        cgltf_free(data);
-        LOGF(LogLevel::eERROR, "Rigged mesh %s has no bones. Skeleton can not be created.", skeletonInputfile);
-        return true;
+        const meshopt_Meshlet* meshlet = &pScratch->pMeshlets[m];
+        meshopt_Bounds         bounds =
+            meshopt_computeMeshletBounds(&meshletVerticesOut[meshlet->vertex_offset], &meshletTrianglesOut[meshlet->triangle_offset],
+                                         meshlet->triangle_count, (const float*)vertexPositions, vertexCount, vertexPositionsStride);
+
+        MeshletData* meshletData = &meshletsDataOut[m];
+        meshletData->center = float3(bounds.center[0], bounds.center[1], bounds.center[2]);
+        meshletData->radius = bounds.radius;
+        meshletData->coneApex = float3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+        meshletData->coneAxis = float3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+        meshletData->coneCutoff = bounds.cone_cutoff;
     }
 
-    // Gather node info
-    // Used to mark nodes that should be included in the skeleton
-    SkeletonNodeInfo*      nodeData = nullptr;
-    size_t                 startIndex = data->nodes_count - 1;
-    const SkeletonNodeInfo startNode{ bdynfromcstr(data->nodes[startIndex].name), &data->nodes[startIndex] };
-    arrpush(nodeData, startNode);
+    *meshlets = meshletsOut;
+    *meshletsData = meshletsDataOut;
+    *meshletVertices = meshletVerticesOut;
+    *meshletTriangles = meshletTrianglesOut;
+}
 
-    const uint32_t queueSize = (uint32_t)(data->nodes_count + 1);
-    int32_t*       nodeQueue = nullptr; // Simple queue because tinystl doesn't have one
-    arrsetlen(nodeQueue, queueSize);
-    for (uint32_t i = 0; i < queueSize; ++i)
-        nodeQueue[i] = -1;
-    nodeQueue[0] = 0;
-    uint32_t nodeQueueStart = 0;
-    uint32_t nodeQueueEnd = 1;
-    while (nodeQueue[nodeQueueStart] != -1)
+// Simplifies the indices into lodCount levels, level i targets indexRatio^(i + 1) of the indices with an error of at most
+// pTargetErrors[i]. Levels that can't remove more triangles than the previous one are left NULL so that they reuse it.
+// Uses the scratch memory of the calling thread (AcquireMeshoptScratch).
+static void simplifyLods(const uint32_t* indices, size_t indexCount, const float3* vertexPositions, size_t vertexCount,
+                         size_t vertexPositionsStride, uint32_t lodCount, float indexRatio, const float* pTargetErrors,
+                         uint32_t** ppLodIndices, float* pLodErrors)
+{
+    size_t previousCount = indexCount;
+    float  previousError = 0.0f;
+    float  targetRatio = 1.0f;
+    for (uint32_t i = 0; i < lodCount; ++i)
     {
-        // Pop
-        int32_t     nodeIndex = nodeQueue[nodeQueueStart];
-        cgltf_node* node = nodeData[nodeIndex].pNode;
-        nodeQueue[nodeQueueStart] = -1;
-
-        for (uint i = 0; i < node->children_count; ++i)
-        {
-            SkeletonNodeInfo childNode = {};
-            childNode.mName = bdynfromcstr(node->children[i]->name);
-            childNode.pParentNodeIndex = nodeIndex;
-            const int32_t childNodeIndex = (int32_t)arrlen(nodeData);
-            childNode.pNode = node->children[i];
-            arrpush(nodeData, childNode);
-
-            arrpush(nodeData[nodeIndex].mChildNodeIndices, childNodeIndex);
-
-            const uint32_t queueIdx = nodeQueueEnd;
-            ASSERT(queueIdx != nodeQueueStart && "Seems like we didn't allocate enough space for the queue");
-            if (queueIdx == nodeQueueStart)
-            {
-                LOGF(LogLevel::eERROR, "Too many nodes in scene. Skeleton '%s' can not be created.", skeletonInputfile);
-                return true;
-            }
+        targetRatio *= indexRatio;
+        const size_t targetCount = (size_t)((float)indexCount * targetRatio) / 3 * 3;
 
-            nodeQueueEnd = (nodeQueueEnd + 1) % queueSize;
+        // Every level starts from the full resolution indices so that the error is relative to it
+        uint32_t* lodIndices = NULL;
+        arrsetlen(lodIndices, indexCount);
+        float        error = 0.0f;
+        const size_t count = meshopt_simplify(lodIndices, indices, indexCount, (const float*)vertexPositions, vertexCount,
+                                              vertexPositionsStride, targetCount, pTargetErrors[i], &error);
 
-            // Push
-            nodeQueue[queueIdx] = childNodeIndex;
+        if (count == 0 || count >= previousCount)
+        {
+            arrfree(lodIndices);
+            ppLodIndices[i] = NULL;
+            pLodErrors[i] = previousError;
+            continue;
         }
 
-        nodeQueueStart++;
-        ASSERT(nodeQueueStart < (uint32_t)arrlen(nodeQueue) && "Seems like we didn't allocate enough space for the queue");
+        arrsetlen(lodIndices, count);
+        ppLodIndices[i] = lodIndices;
+        pLodErrors[i] = error;
+        previousCount = count;
+        previousError = error;
     }
+}
 
-    arrfree(nodeQueue);
-    nodeQueue = nullptr;
+// Uses the scratch memory of the calling thread (AcquireMeshoptScratch)
+static void geomOptimize(GeometryData* geomData, MeshOptimizerFlags optimizationFlags, IndexType indexType, uint32_t indexOffset,
+                         uint32_t indexCount, uint32_t vertexOffset, uint32_t* vertexCount)
+{
+    if (optimizationFlags == MESH_OPTIMIZATION_FLAG_OFF)
+        return;
 
-    // Mark all nodes that are required to be in the skeleton
-    for (cgltf_size i = 0; i < data->skins_count; ++i)
+    size_t    remapSize = (*vertexCount * sizeof(uint32_t));
+    uint32_t* remap = (uint32_t*)tf_malloc(remapSize);
+
+    meshopt_Stream streams[MAX_SEMANTICS];
+    uint32_t       validStreamCount = 0;
+    int32_t        posAttributeIdx = -1;
+    for (size_t i = 0; i < MAX_SEMANTICS; i++)
     {
-        cgltf_skin* skin = &data->skins[i];
-        for (cgltf_size j = 0; j < skin->joints_count; ++j)
+        if (!geomData->pShadow->mVertexStrides[i])
+            continue;
+
+        if (i == SEMANTIC_POSITION)
         {
-            cgltf_node* bone = skin->joints[j];
-            for (cgltf_size k = 0; k < (cgltf_size)arrlen(nodeData); ++k)
-            {
-                if (strcmp((const char*)nodeData[k].mName.data, bone->name) == 0)
-                {
-                    int32_t nodeIndex = (int32_t)k;
-                    while (nodeIndex != -1)
-                    {
-                        if (nodeData[nodeIndex].mUsedInSkeleton)
-                            break; // Remaining part of the tree is already marked
-                        nodeData[nodeIndex].mUsedInSkeleton = true;
-                        nodeIndex = nodeData[nodeIndex].pParentNodeIndex;
-                    }
-                }
-            }
+            posAttributeIdx = (int32_t)i;
         }
+
+        streams[validStreamCount].data = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
+        streams[validStreamCount].size = geomData->pShadow->mVertexStrides[i];
+        streams[validStreamCount].stride = geomData->pShadow->mVertexStrides[i];
+
+        validStreamCount++;
     }
 
-    // Create raw skeleton
-    ozz::animation::offline::RawSkeleton rawSkeleton = {};
+    // Remap functions expect the same vertex count passed when generating the map, so we have to set the new vertex count later on
+    uint32_t newVertCount = 0;
 
-    SkeletonBoneInfo*      boneData = nullptr;
-    const SkeletonBoneInfo firstBone{ 0, -1, NULL };
-    arrpush(boneData, firstBone);
+    // generating remap & new vertex/index sets
+    if (indexType == INDEX_TYPE_UINT16)
+    {
+        newVertCount = (uint32_t)meshopt_generateVertexRemapMulti(remap, (uint16_t*)geomData->pShadow->pIndices + indexOffset, indexCount,
+                                                                  *vertexCount, streams, validStreamCount);
+        meshopt_remapIndexBuffer((uint16_t*)geomData->pShadow->pIndices + indexOffset, (uint16_t*)geomData->pShadow->pIndices + indexOffset,
+                                 indexCount, remap);
+    }
+    else
+    {
+        newVertCount = (uint32_t)meshopt_generateVertexRemapMulti(remap, (uint32_t*)geomData->pShadow->pIndices + indexOffset, indexCount,
+                                                                  *vertexCount, streams, validStreamCount);
+        meshopt_remapIndexBuffer((uint32_t*)geomData->pShadow->pIndices + indexOffset, (uint32_t*)geomData->pShadow->pIndices + indexOffset,
+                                 indexCount, remap);
+    }
 
-    while (arrlen(boneData) != 0)
+    for (size_t i = 0; i < MAX_SEMANTICS; i++)
     {
-        SkeletonBoneInfo boneInfo = arrlast(boneData);
-        arrpop(boneData);
-        SkeletonNodeInfo* nodeInfo = &nodeData[boneInfo.mNodeIndex];
-        cgltf_node*       node = nodeInfo->pNode;
+        if (!geomData->pShadow->mVertexStrides[i])
+            continue;
 
-        // Get node transform
+        uint8_t* buffer = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
+        meshopt_remapVertexBuffer(buffer, buffer, *vertexCount, geomData->pShadow->mVertexStrides[i], remap);
+    }
 
-        // Create joint from node
-        ozz::animation::offline::RawSkeleton::Joint joint;
+    *vertexCount = newVertCount;
 
-        if (!node->has_matrix)
+    // optimize
+    // do we need to optmize per primitive ?
+    /// optmizations like overdraw clearly can alter across primitives. but can vertex cache & vertex fetch do it ?
+    if (indexType == INDEX_TYPE_UINT16)
+    {
+        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXCACHE)
         {
-            joint.transform.translation = vec3(node->translation[0], node->translation[1], node->translation[2]);
-            joint.transform.rotation = Quat(node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3]);
-            joint.transform.scale =
-                vec3(node->scale[0], node->scale[1], node->scale[2]); // *(boneInfo.mParentNodeIndex == -1 ? 0.01f : 1.f);
+            uint16_t* src = (uint16_t*)geomData->pShadow->pIndices + indexOffset;
+            meshopt_optimizeVertexCache(src, src, indexCount, *vertexCount);
         }
-        else
+        // we can only run this if position data is not packed
+        if ((optimizationFlags & MESH_OPTIMIZATION_FLAG_OVERDRAW) && posAttributeIdx >= 0)
         {
-            // Matrix Decomposition
-            Matrix4 mat;
-            mat.setCol0(vec4(node->matrix[0], node->matrix[1], node->matrix[2], node->matrix[3]));
-            mat.setCol1(vec4(node->matrix[4], node->matrix[5], node->matrix[6], node->matrix[7]));
-            mat.setCol2(vec4(node->matrix[8], node->matrix[9], node->matrix[10], node->matrix[11]));
-            mat.setCol3(vec4(node->matrix[12], node->matrix[13], node->matrix[14], node->matrix[15]));
-
-            if (isTrsDecomposable(mat))
-            {
-                // extract translation
-                joint.transform.translation = mat.getTranslation();
-
-                // extract the scaling factors from columns of the matrix
-                Matrix3 upperMat = mat.getUpper3x3();
-                vec3    pScaling = vec3(length(upperMat.getCol0()), length(upperMat.getCol1()), length(upperMat.getCol2()));
-
-                // and the sign of the scaling
-                if (determinant(mat) < 0)
-                    pScaling = -pScaling;
-                joint.transform.scale = pScaling; //*(boneInfo.mParentNodeIndex == -1 ? 0.01f : 1.f);
-
-                // and remove all scaling from the matrix
-                if (pScaling.getX())
-                    upperMat.setCol0(upperMat.getCol0() / pScaling.getX());
-                if (pScaling.getY())
-                    upperMat.setCol1(upperMat.getCol1() / pScaling.getY());
-                if (pScaling.getZ())
-                    upperMat.setCol2(upperMat.getCol2() / pScaling.getZ());
+            uint16_t* src = (uint16_t*)geomData->pShadow->pIndices + indexOffset;
+            float*    pos = (float*)((uint8_t*)geomData->pShadow->pAttributes[posAttributeIdx] +
+                                  vertexOffset * geomData->pShadow->mVertexStrides[posAttributeIdx]);
 
-                // and generate the rotation quaternion from it
-                joint.transform.rotation = Quat(upperMat);
-            }
+            const float kThreshold = 1.01f;
+            meshopt_optimizeOverdraw(src, src, indexCount, pos, *vertexCount, geomData->pShadow->mVertexStrides[posAttributeIdx],
+                                     kThreshold);
         }
 
-        bassign(&joint.name, &nodeInfo->mName);
-
-        // Add node to raw skeleton
-        ozz::animation::offline::RawSkeleton::Joint* newParentJoint = NULL;
-        if (boneInfo.pParentJoint == NULL)
+        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXFETCH)
         {
-            arrpush(rawSkeleton.roots, joint);
-            newParentJoint = &arrlast(rawSkeleton.roots);
+            uint16_t* indices = (uint16_t*)geomData->pShadow->pIndices + indexOffset;
+            newVertCount = (uint32_t)meshopt_optimizeVertexFetchRemap(remap, indices, indexCount, *vertexCount);
+            meshopt_remapIndexBuffer(indices, indices, indexCount, remap);
+
+            for (size_t i = 0; i < MAX_SEMANTICS; i++)
+            {
+                if (!geomData->pShadow->mVertexStrides[i])
+                    continue;
+
+                uint8_t* buffer = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
+                meshopt_remapVertexBuffer(buffer, buffer, *vertexCount, geomData->pShadow->mVertexStrides[i], remap);
+            }
         }
-        else
+    }
+    else
+    {
+        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXCACHE)
         {
-            arrpush(boneInfo.pParentJoint->children, joint);
-            newParentJoint = &arrlast(boneInfo.pParentJoint->children);
+            uint32_t* src = (uint32_t*)geomData->pShadow->pIndices + indexOffset;
+            meshopt_optimizeVertexCache(src, src, indexCount, *vertexCount);
         }
 
-        // Count the child nodes that are required to be in the skeleton
-        int requiredChildCount = 0;
-        for (uint i = 0; i < (uint)arrlen(nodeInfo->mChildNodeIndices); ++i)
+        // we can only run this if position data is not packed
+        if ((optimizationFlags & MESH_OPTIMIZATION_FLAG_OVERDRAW) && posAttributeIdx >= 0)
         {
-            SkeletonNodeInfo* childNodeInfo = &nodeData[nodeInfo->mChildNodeIndices[i]];
-            if (childNodeInfo->mUsedInSkeleton)
-                ++requiredChildCount;
+            uint32_t* src = (uint32_t*)geomData->pShadow->pIndices + indexOffset;
+            float*    pos = (float*)((uint8_t*)geomData->pShadow->pAttributes[posAttributeIdx] +
+                                  vertexOffset * geomData->pShadow->mVertexStrides[posAttributeIdx]);
+
+            const float kThreshold = 1.01f;
+            meshopt_optimizeOverdraw(src, src, indexCount, pos, *vertexCount, geomData->pShadow->mVertexStrides[posAttributeIdx],
+                                     kThreshold);
         }
 
-        // Add child nodes to the list of nodes to process
-        arrsetcap(newParentJoint->children, requiredChildCount); // Reserve to make sure memory isn't reallocated later.
-        for (uint i = 0; i < (uint)arrlen(nodeInfo->mChildNodeIndices); ++i)
+        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXFETCH)
         {
-            SkeletonNodeInfo* childNodeInfo = &nodeData[nodeInfo->mChildNodeIndices[i]];
-            if (childNodeInfo->mUsedInSkeleton)
+            uint32_t* indices = (uint32_t*)geomData->pShadow->pIndices + indexOffset;
+            newVertCount = (uint32_t)meshopt_optimizeVertexFetchRemap(remap, indices, indexCount, *vertexCount);
+            meshopt_remapIndexBuffer(indices, indices, indexCount, remap);
+
+            for (size_t i = 0; i < MAX_SEMANTICS; i++)
             {
-                boneInfo.mNodeIndex = nodeInfo->mChildNodeIndices[i];
-                boneInfo.mParentNodeIndex = boneInfo.mNodeIndex;
-                boneInfo.pParentJoint = newParentJoint;
-                arrpush(boneData, boneInfo);
+                if (!geomData->pShadow->mVertexStrides[i])
+                    continue;
+
+                uint8_t* buffer = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
+                meshopt_remapVertexBuffer(buffer, buffer, *vertexCount, geomData->pShadow->mVertexStrides[i], remap);
             }
         }
     }
 
-    for (uint32_t i = 0, end = (uint32_t)arrlen(nodeData); i < end; ++i)
-    {
-        bdestroy(&nodeData[i].mName);
-        arrfree(nodeData[i].mChildNodeIndices);
-    }
+    *vertexCount = newVertCount;
+    tf_free(remap);
+}
 
-    arrfree(boneData);
-    boneData = nullptr;
-    arrfree(nodeData);
-    nodeData = nullptr;
+// Pads the stream with zeros up to the start of the next section
+static bool WritePackedSectionPadding(FileStream* pStream, uint64_t* pPosition, uint64_t sectionOffset)
+{
+    static const uint8_t zeros[GEOMETRY_PACKED_FILE_ALIGNMENT] = {};
+    ASSERT(sectionOffset >= *pPosition && sectionOffset - *pPosition < GEOMETRY_PACKED_FILE_ALIGNMENT);
+    const size_t padding = (size_t)(sectionOffset - *pPosition);
+    *pPosition = sectionOffset;
+    return fsWriteToStream(pStream, zeros, padding) == padding;
+}
 
-    // Validate raw skeleton
-    if (!rawSkeleton.Validate())
+static bool WritePackedSectionData(FileStream* pStream, uint64_t* pPosition, const void* pData, uint64_t size)
+{
+    *pPosition += size;
+    return fsWriteToStream(pStream, pData, (size_t)size) == size;
+}
+
+static void SetPackedSection(GeometryPackedSection* pSection, uint64_t* pOffset, uint64_t size)
+{
+    pSection->mOffset = *pOffset;
+    pSection->mSize = size;
+    *pOffset = round_up_64(*pOffset + size, GEOMETRY_PACKED_FILE_ALIGNMENT);
+}
+
+// Quantizes every attribute of the binding with the exponential filter, each attribute of a vertex gets its own exponent.
+// Only valid when all the attributes of the binding are made of 32 bit floats.
+static void EncodePackedVertexFilterExp(uint8_t* pVertices, uint32_t vertexCount, uint32_t stride, const uint32_t attribOffsets[],
+                                        const uint32_t attribSizes[], uint32_t attribCount, uint32_t bits)
+{
+    float* pAttrib = (float*)tf_malloc((size_t)stride * vertexCount);
+    for (uint32_t a = 0; a < attribCount; ++a)
     {
-        LOGF(LogLevel::eERROR, "Skeleton created for %s is invalid. Skeleton can not be created.", skeletonInputfile);
-        return true;
+        const uint32_t size = attribSizes[a];
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            memcpy((uint8_t*)pAttrib + (size_t)v * size, pVertices + (size_t)v * stride + attribOffsets[a], size);
+
+        meshopt_encodeFilterExp(pAttrib, vertexCount, size, (int)bits, pAttrib);
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            memcpy(pVertices + (size_t)v * stride + attribOffsets[a], (uint8_t*)pAttrib + (size_t)v * size, size);
     }
+    tf_free(pAttrib);
+}
 
-    // Build runtime skeleton from raw skeleton
-    if (!ozz::animation::offline::SkeletonBuilder::Build(rawSkeleton, pOutSkeleton))
+// Replaces the meshlet bounds of the geometry with MeshletDataQuantized, see it for the encoding
+static void QuantizeMeshletData(Geometry* geom)
+{
+    const GeometryMeshlets* pMeshlets = &geom->meshlets;
+    float                   boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float                   boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint64_t m = 0; m < pMeshlets->mMeshletCount; ++m)
     {
-        LOGF(LogLevel::eERROR, "Failed to build Skeleton: %s", skeletonInputfile);
-        return true;
+        const MeshletData* pData = &pMeshlets->mMeshletsData[m];
+        for (int c = 0; c < 3; ++c)
+        {
+            boundsMin[c] = min(boundsMin[c], pData->center[c] - pData->radius);
+            boundsMax[c] = max(boundsMax[c], pData->center[c] + pData->radius);
+        }
     }
 
-    // Ensure output dir exists before we write the skeleton to disk
+    float extentLength = 0.0f;
+    for (int c = 0; c < 3; ++c)
     {
-        char directory[FS_MAX_PATH] = {};
-        fsGetParentPath(skeletonOutputFile, directory);
-        fsCreateDirectory(resourceDirOzzOutput, directory, true);
+        geom->mMeshletBoundsMin[c] = boundsMin[c];
+        geom->mMeshletBoundsExtent[c] = boundsMax[c] - boundsMin[c];
+        extentLength += geom->mMeshletBoundsExtent[c] * geom->mMeshletBoundsExtent[c];
     }
+    extentLength = sqrtf(extentLength);
+    // Rounding moves the center by up to half a step on every axis, the radius grows by that distance
+    const float centerError = 0.5f * extentLength / 65535.0f;
 
-    // Write skeleton to disk
-    FileStream file = {};
-    if (!fsOpenStreamFromPath(resourceDirOzzOutput, skeletonOutputFile, FM_WRITE, &file))
-        return true;
-
-    ozz::io::OArchive archive(&file);
-    archive << *pOutSkeleton;
-    fsCloseStream(&file);
-
-    // Generate joint remaps in the gltf
+    MeshletDataQuantized* pQuantized = (MeshletDataQuantized*)tf_calloc((size_t)pMeshlets->mMeshletCount, sizeof(MeshletDataQuantized));
+    for (uint64_t m = 0; m < pMeshlets->mMeshletCount; ++m)
     {
-        char*    buffer = nullptr;
-        uint32_t size = 0;
-
-        for (uint32_t i = 0; i < data->meshes_count; ++i)
+        const MeshletData*    pData = &pMeshlets->mMeshletsData[m];
+        MeshletDataQuantized* pOut = &pQuantized[m];
+        for (int c = 0; c < 3; ++c)
         {
-            cgltf_mesh* mesh = &data->meshes[i];
-            cgltf_node* node = NULL;
-            for (uint32_t n = 0; n < data->nodes_count; ++n)
-            {
-                if (data->nodes[n].mesh == mesh)
-                {
-                    node = &data->nodes[n];
-                    break;
-                }
-            }
-
-            if (node && node->mesh && node->skin)
-            {
-                cgltf_skin* skin = node->skin;
-
-                char     jointRemaps[1024] = {};
-                uint32_t offset = 0;
-                offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, "[ ");
-
-                for (uint32_t j = 0; j < skin->joints_count; ++j)
-                {
-                    const cgltf_node* jointNode = skin->joints[j];
-                    uint32_t          jointIndex = FindJoint(pOutSkeleton, jointNode->name);
-                    if (j == 0)
-                        offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, "%u", jointIndex);
-                    else
-                        offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, ", %u", jointIndex);
-                }
-
-                offset += snprintf(jointRemaps + offset, sizeof(jointRemaps) - offset, " ]");
-                skin->extras.start_offset = size;
-                size += (uint32_t)strlen(jointRemaps) + 1;
-                skin->extras.end_offset = size - 1;
-
-                const size_t iterCount = strlen(jointRemaps) + 1;
-                for (uint32_t j = 0; j < iterCount; ++j)
-                    arrpush(buffer, jointRemaps[j]);
-            }
+            const float extent = geom->mMeshletBoundsExtent[c];
+            const float t = extent > 0.0f ? (pData->center[c] - boundsMin[c]) / extent : 0.0f;
+            pOut->center[c] = (uint16_t)(clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
         }
+        const float radius = extentLength > 0.0f ? ceilf((pData->radius + centerError) / extentLength * 65535.0f) : 0.0f;
+        pOut->radius = (uint16_t)min(radius, 65535.0f);
 
-        for (uint32_t i = 0; i < data->buffers_count; ++i)
+        // Same conservative 8 bit cone as meshopt_computeMeshletBounds, the cutoff is rounded up by the error of the axis
+        float axisError = 0.0f;
+        for (int c = 0; c < 3; ++c)
         {
-            if (strncmp(data->buffers[i].uri, "://", 3) == 0)
-            {
-                char parentPath[FS_MAX_PATH] = {};
-                fsGetParentPath(skeletonInputfile, parentPath);
-                char bufferOut[FS_MAX_PATH] = {};
-                fsAppendPathComponent(parentPath, data->buffers[i].uri, bufferOut);
-
-                LOGF(eINFO, "Writing binary gltf data: %s -> %s", skeletonInputfile, bufferOut);
-
-                FileStream fs = {};
-                fsOpenStreamFromPath(resourceDirGltfOutput, bufferOut, FM_WRITE, &fs);
-                fsWriteToStream(&fs, data->buffers[i].data, data->buffers[i].size);
-                fsCloseStream(&fs);
-            }
+            pOut->coneAxis[c] = (int8_t)meshopt_quantizeSnorm(pData->coneAxis[c], 8);
+            axisError += fabsf(pOut->coneAxis[c] / 127.0f - pData->coneAxis[c]);
         }
+        const int cutoff = pData->coneCutoff >= 1.0f ? 127 : (int)(127.0f * (pData->coneCutoff + axisError) + 1.0f);
+        pOut->coneCutoff = (int8_t)min(cutoff, 127);
+    }
 
-        LOGF(eINFO, "Writing text gltf data: %s -> %s", skeletonInputfile, skeletonInputfile);
-
-        data->file_data = buffer;
-        if (cgltf_result_success != cgltf_write(resourceDirGltfOutput, skeletonInputfile, data))
-        {
-            LOGF(eERROR, "Couldn't write the gltf file with the remapped joint data for it's skeleton.");
-            arrfree(buffer);
-            return true;
-        }
+    geom->mMeshletDataQuantized = 1;
+    geom->pMeshletsDataQuantized = pQuantized;
+}
 
-        arrfree(buffer);
+// Meshlet bounds in the layout they are written with, MeshletDataQuantized when QuantizeMeshletData ran
+static const void* GetMeshletDataToWrite(const Geometry* geom, size_t* pSize)
+{
+    if (geom->mMeshletDataQuantized)
+    {
+        *pSize = (size_t)geom->meshlets.mMeshletCount * sizeof(MeshletDataQuantized);
+        return geom->pMeshletsDataQuantized;
     }
+    *pSize = (size_t)geom->meshlets.mMeshletCount * sizeof(MeshletData);
+    return geom->meshlets.mMeshletsData;
+}
 
-    data->file_data = srcFileData;
-    cgltf_free(data);
+// Copies of the structures at the start of the geometry and shadow sections without their pointers, the ResourceLoader sets them when
+// loading. Written as they are, the heap addresses would make the outputs of two runs differ.
+static Geometry GetGeometryToWrite(const Geometry* geom)
+{
+    Geometry header = *geom;
+    header.pDrawArgs = NULL;
+    header.pGeometryBuffer = NULL;
+    header.meshlets.mMeshlets = NULL;
+    header.meshlets.mMeshletsData = NULL;
+    header.meshlets.mVertices = NULL;
+    header.meshlets.mTriangles = NULL;
+    header.pLods = NULL;
+    header.pMeshletsDataQuantized = NULL;
+    return header;
+}
 
-    const bool error = false;
-    return error;
+static GeometryData::ShadowData GetShadowDataToWrite(const GeometryData::ShadowData* pShadow)
+{
+    GeometryData::ShadowData header = *pShadow;
+    header.pIndices = NULL;
+    memset(header.pAttributes, 0, sizeof(header.pAttributes));
+    return header;
 }
 
-static bool CreateRuntimeAnimation(RuntimeAnimationSettings* animationSettings, cgltf_animation* animationData, const char* animOutFile,
-                                   ozz::animation::Skeleton* skeleton, const char* animationSourceFile)
+// Writes a GeometryPackedFileHeader container. Index and vertex buffers are interleaved following pVertexLayout exactly like the
+// ResourceLoader does it at runtime, so that loading a file that matches the runtime layout is a plain copy of each section.
+// With mCompressStreams the index and vertex sections are encoded with the meshoptimizer codecs, sections the codecs can't handle
+// are stored as-is. pGeomData must have its pointers cleared, pShadow is the shadow data of the geometry.
+// pStreamSize and pEncodedStreamSize receive the size of the index and vertex sections before and after encoding.
+static bool WriteGeometryPackedFile(FileStream* pStream, const ProcessGLTFParams* glTFParams, const Geometry* geom, uint32_t geomSize,
+                                    const GeometryData* pGeomData, uint32_t geomDataSize, const GeometryData::ShadowData* pShadow,
+                                    uint32_t shadowSize, uint64_t* pStreamSize, uint64_t* pEncodedStreamSize)
 {
-    ASSERT(animationData && skeleton);
+    const VertexLayout* pVertexLayout = glTFParams->pVertexLayout;
 
-    // Create raw animation
-    ozz::animation::offline::RawAnimation rawAnimation = {};
-    rawAnimation.name = bdynfromcstr(animationData->name);
-    rawAnimation.duration = 0.f;
+    GeometryPackedFileHeader header = {};
+    COMPILE_ASSERT(sizeof(GEOMETRY_PACKED_FILE_MAGIC_STR) <= sizeof(header.mMagic));
+    memcpy(header.mMagic, GEOMETRY_PACKED_FILE_MAGIC_STR, sizeof(GEOMETRY_PACKED_FILE_MAGIC_STR));
+    header.mVersion = GEOMETRY_PACKED_FILE_VERSION;
+    header.mHeaderSize = sizeof(GeometryPackedFileHeader);
+    header.mIndexStride = geom->mIndexType == INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
 
-    arrsetlen(rawAnimation.tracks, skeleton->num_joints());
-    memset(rawAnimation.tracks, 0, sizeof(*rawAnimation.tracks) * skeleton->num_joints());
+    for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+    {
+        header.mSemanticBindings[s] = UINT32_MAX;
+        header.mSemanticOffsets[s] = UINT32_MAX;
+    }
 
-    for (uint i = 0; i < (uint)skeleton->num_joints(); ++i)
+    uint32_t attribCount[MAX_VERTEX_BINDINGS] = {};
+    bool     floatBinding[MAX_VERTEX_BINDINGS] = {};
+    for (uint32_t b = 0; b < MAX_VERTEX_BINDINGS; ++b)
+        floatBinding[b] = true;
+
+    for (uint32_t i = 0; i < pVertexLayout->mAttribCount; ++i)
     {
-        const char* jointName = skeleton->joint_names()[i];
+        const VertexAttrib* attr = &pVertexLayout->mAttribs[i];
+        const uint32_t      dstFormatSize = TinyImageFormat_BitSizeOfBlock(attr->mFormat) >> 3;
 
-        ozz::animation::offline::RawAnimation::JointTrack* track = &rawAnimation.tracks[i];
+        header.mVertexStrides[attr->mBinding] += dstFormatSize ? dstFormatSize : pShadow->mVertexStrides[attr->mSemantic];
+        header.mSemanticBindings[attr->mSemantic] = attr->mBinding;
+        header.mSemanticOffsets[attr->mSemantic] = attr->mOffset;
+        ++attribCount[attr->mBinding];
 
-        for (cgltf_size channelIndex = 0; channelIndex < animationData->channels_count; channelIndex += 1)
-        {
-            cgltf_animation_channel* channel = &animationData->channels[channelIndex];
+        floatBinding[attr->mBinding] = floatBinding[attr->mBinding] && TinyImageFormat_IsFloat(attr->mFormat) &&
+                                       dstFormatSize == TinyImageFormat_ChannelCount(attr->mFormat) * sizeof(float);
+    }
 
-            if (strcmp(channel->target_node->name, jointName) != 0)
+    // Interleave the vertex buffers up front, encoded section sizes are needed for the header
+    const uint8_t* pIndexData = (const uint8_t*)pShadow->pIndices;
+    uint8_t*       pEncodedIndices = NULL;
+    uint64_t       indexDataSize = (uint64_t)header.mIndexStride * geom->mIndexCount;
+    uint8_t*       pVertexData[MAX_VERTEX_BINDINGS] = {};
+    uint64_t       vertexDataSizes[MAX_VERTEX_BINDINGS] = {};
+    *pStreamSize = indexDataSize;
+
+    for (uint32_t b = 0; b < MAX_VERTEX_BINDINGS; ++b)
+    {
+        if (!header.mVertexStrides[b])
+            continue;
+
+        const uint32_t stride = header.mVertexStrides[b];
+        vertexDataSizes[b] = (uint64_t)stride * geom->mVertexCount;
+        pVertexData[b] = (uint8_t*)tf_calloc(1, max((size_t)vertexDataSizes[b], (size_t)1));
+        *pStreamSize += vertexDataSizes[b];
+
+        uint32_t attribOffsets[MAX_SEMANTICS] = {};
+        uint32_t attribSizes[MAX_SEMANTICS] = {};
+        uint32_t bindingAttribCount = 0;
+
+        for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+        {
+            if (header.mSemanticBindings[s] != b || !pShadow->pAttributes[s])
                 continue;
 
-            if (channel->target_path == cgltf_animation_path_type_translation)
-            {
-                arrsetlen(track->translations, channel->sampler->output->count);
-                memset((char*)track->translations, 0, sizeof(*track->translations) * channel->sampler->output->count);
-                for (cgltf_size j = 0; j < channel->sampler->output->count; j += 1)
-                {
-                    float time = 0.0;
-                    vec3  translation = vec3(0.0f);
-                    cgltf_accessor_read_float(channel->sampler->input, j, &time, 1);
-                    cgltf_accessor_read_float(channel->sampler->output, j, (float*)&translation, 3);
+            const uint8_t* src = (const uint8_t*)pShadow->pAttributes[s];
+            const uint32_t srcStride = pShadow->mVertexStrides[s];
+            const uint32_t count = min(pShadow->mAttributeCount[s], geom->mVertexCount);
 
-                    track->translations[j] = { time, translation };
-                }
-            }
+            attribOffsets[bindingAttribCount] = header.mSemanticOffsets[s];
+            attribSizes[bindingAttribCount] = srcStride;
+            ++bindingAttribCount;
 
-            if (channel->target_path == cgltf_animation_path_type_rotation)
+            // Same interleaving as the ResourceLoader, attributes that are alone in their binding are copied in one go
+            if (1 == attribCount[b])
+                memcpy(pVertexData[b], src, (size_t)srcStride * count);
+            else
             {
-                arrsetlen(track->rotations, channel->sampler->output->count);
-                memset((char*)track->rotations, 0, sizeof(*track->rotations) * channel->sampler->output->count);
-                for (cgltf_size j = 0; j < channel->sampler->output->count; j += 1)
-                {
-                    float time = 0.0;
-                    Quat  rotation = Quat(0.0f);
-                    cgltf_accessor_read_float(channel->sampler->input, j, &time, 1);
-                    cgltf_accessor_read_float(channel->sampler->output, j, (float*)&rotation, 4);
-
-                    track->rotations[j] = { time, rotation };
-                }
+                for (uint32_t e = 0; e < count; ++e)
+                    memcpy(pVertexData[b] + e * stride + header.mSemanticOffsets[s], src + e * srcStride, srcStride);
             }
+        }
 
-            if (channel->target_path == cgltf_animation_path_type_scale)
-            {
-                arrsetlen(track->scales, channel->sampler->output->count);
-                memset((char*)track->scales, 0, sizeof(*track->scales) * channel->sampler->output->count);
-                for (cgltf_size j = 0; j < channel->sampler->output->count; j += 1)
-                {
-                    float time = 0.0;
-                    vec3  scale = vec3(0.0f);
-                    cgltf_accessor_read_float(channel->sampler->input, j, &time, 1);
-                    cgltf_accessor_read_float(channel->sampler->output, j, (float*)&scale, 3);
+        // The vertex codec works on 4 byte aligned vertices of at most 256 bytes
+        if (!glTFParams->mCompressStreams || stride % 4 != 0 || stride > 256)
+            continue;
 
-                    track->scales[j] = { time, scale };
-                }
-            }
+        if (glTFParams->mQuantizationBits && floatBinding[b])
+        {
+            EncodePackedVertexFilterExp(pVertexData[b], geom->mVertexCount, stride, attribOffsets, attribSizes, bindingAttribCount,
+                                        glTFParams->mQuantizationBits);
+            header.mVertexFilters[b] = GEOMETRY_PACKED_FILTER_EXP;
         }
 
-        if (arrlen(track->translations) != 0)
-            rawAnimation.duration = max(rawAnimation.duration, arrlast(track->translations).time);
+        const size_t bound = meshopt_encodeVertexBufferBound(geom->mVertexCount, stride);
+        uint8_t*     pEncoded = (uint8_t*)tf_malloc(bound);
+        vertexDataSizes[b] = meshopt_encodeVertexBuffer(pEncoded, bound, pVertexData[b], geom->mVertexCount, stride);
+        tf_free(pVertexData[b]);
+        pVertexData[b] = pEncoded;
+        header.mVertexEncodings[b] = GEOMETRY_PACKED_ENCODING_MESHOPT;
+    }
 
-        if (arrlen(track->rotations) != 0)
-            rawAnimation.duration = max(rawAnimation.duration, arrlast(track->rotations).time);
+    // The index codec only handles triangle lists
+    if (glTFParams->mCompressStreams && geom->mIndexCount % 3 == 0)
+    {
+        uint32_t* pIndices = (uint32_t*)tf_malloc(max(geom->mIndexCount, 1u) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < geom->mIndexCount; ++i)
+            pIndices[i] = sizeof(uint16_t) == header.mIndexStride ? ((const uint16_t*)pShadow->pIndices)[i]
+                                                                  : ((const uint32_t*)pShadow->pIndices)[i];
+
+        const size_t bound = meshopt_encodeIndexBufferBound(geom->mIndexCount, geom->mVertexCount);
+        pEncodedIndices = (uint8_t*)tf_malloc(bound);
+        indexDataSize = meshopt_encodeIndexBuffer(pEncodedIndices, bound, pIndices, geom->mIndexCount);
+        pIndexData = pEncodedIndices;
+        header.mIndexEncoding = GEOMETRY_PACKED_ENCODING_MESHOPT;
+        tf_free(pIndices);
+    }
 
-        if (arrlen(track->scales) != 0)
-            rawAnimation.duration = max(rawAnimation.duration, arrlast(track->scales).time);
+    size_t         meshletDataSize = 0;
+    const void*    pMeshletData = GetMeshletDataToWrite(geom, &meshletDataSize);
+    uint64_t       meshletSize = 0;
+    if (geom->meshlets.mMeshletCount)
+    {
+        meshletSize = geom->meshlets.mMeshletCount * sizeof(*geom->meshlets.mMeshlets) + meshletDataSize +
+                      geom->meshlets.mVertexCount * sizeof(*geom->meshlets.mVertices) +
+                      geom->meshlets.mTriangleCount * sizeof(*geom->meshlets.mTriangles);
     }
 
-    // Validate raw animation
-    if (!rawAnimation.Validate())
+    uint64_t offset = sizeof(GeometryPackedFileHeader);
+    SetPackedSection(&header.mGeometry, &offset, geomSize);
+    SetPackedSection(&header.mGeometryData, &offset, geomDataSize);
+    SetPackedSection(&header.mShadow, &offset, shadowSize);
+    SetPackedSection(&header.mMeshlets, &offset, meshletSize);
+    SetPackedSection(&header.mIndices, &offset, indexDataSize);
+    *pEncodedStreamSize = indexDataSize;
+    for (uint32_t b = 0; b < MAX_VERTEX_BINDINGS; ++b)
     {
-        LOGF(LogLevel::eERROR, "Animation %s:%s is invalid. Animation can not be created.", animationSourceFile, animationData->name);
-        return true;
+        SetPackedSection(&header.mVertices[b], &offset, vertexDataSizes[b]);
+        *pEncodedStreamSize += vertexDataSizes[b];
     }
 
-    ozz::animation::offline::RawAnimation* rawAnimToBuild = &rawAnimation;
+    const Geometry                 geomHeader = GetGeometryToWrite(geom);
+    const GeometryData::ShadowData shadowHeader = GetShadowDataToWrite(pShadow);
 
-    ozz::animation::offline::RawAnimation optimizedRawAnimation = {};
-    if (animationSettings->mOptimizeTracks)
+    uint64_t position = 0;
+    bool     success = WritePackedSectionData(pStream, &position, &header, sizeof(header));
+
+    success = success && WritePackedSectionPadding(pStream, &position, header.mGeometry.mOffset) &&
+              WritePackedSectionData(pStream, &position, &geomHeader, sizeof(geomHeader)) &&
+              WritePackedSectionData(pStream, &position, geom + 1, geomSize - sizeof(geomHeader));
+    success = success && WritePackedSectionPadding(pStream, &position, header.mGeometryData.mOffset) &&
+              WritePackedSectionData(pStream, &position, pGeomData, geomDataSize);
+    success = success && WritePackedSectionPadding(pStream, &position, header.mShadow.mOffset) &&
+              WritePackedSectionData(pStream, &position, &shadowHeader, sizeof(shadowHeader)) &&
+              WritePackedSectionData(pStream, &position, pShadow + 1, shadowSize - sizeof(shadowHeader));
+
+    success = success && WritePackedSectionPadding(pStream, &position, header.mMeshlets.mOffset);
+    if (success && meshletSize)
     {
-        LOGF(eINFO, "Optimizing tracks...");
-        ozz::animation::offline::AnimationOptimizer optimizer = {};
-        optimizer.setting.tolerance = animationSettings->mOptimizationTolerance;
-        optimizer.setting.distance = animationSettings->mOptimizationDistance;
-        if (!optimizer(rawAnimation, *skeleton, &optimizedRawAnimation))
+        success = WritePackedSectionData(pStream, &position, geom->meshlets.mMeshlets,
+                                         sizeof(*geom->meshlets.mMeshlets) * geom->meshlets.mMeshletCount) &&
+                  WritePackedSectionData(pStream, &position, pMeshletData, meshletDataSize) &&
+                  WritePackedSectionData(pStream, &position, geom->meshlets.mVertices,
+                                         sizeof(*geom->meshlets.mVertices) * geom->meshlets.mVertexCount) &&
+                  WritePackedSectionData(pStream, &position, geom->meshlets.mTriangles,
+                                         sizeof(*geom->meshlets.mTriangles) * geom->meshlets.mTriangleCount);
+    }
+
+    // Shadow indices already use the stride of the index buffer
+    success = success && WritePackedSectionPadding(pStream, &position, header.mIndices.mOffset) &&
+              WritePackedSectionData(pStream, &position, pIndexData, header.mIndices.mSize);
+    tf_free(pEncodedIndices);
+
+    for (uint32_t b = 0; b < MAX_VERTEX_BINDINGS; ++b)
+    {
+        if (success && pVertexData[b])
         {
-            LOGF(LogLevel::eERROR, "Animation %s:%s could not be optimized for skeleton.", animationSourceFile, animationData->name);
-            return true;
+            success = WritePackedSectionPadding(pStream, &position, header.mVertices[b].mOffset) &&
+                      WritePackedSectionData(pStream, &position, pVertexData[b], header.mVertices[b].mSize);
         }
-
-        rawAnimToBuild = &optimizedRawAnimation;
+        tf_free(pVertexData[b]);
     }
 
-    // Build runtime animation from raw animation
-    ozz::animation::Animation animation = {};
-    if (!ozz::animation::offline::AnimationBuilder::Build(*rawAnimToBuild, &animation))
+    return success;
+}
+
+// Build cache hash of the gltf, the buffers it references and the settings of ProcessGLTF
+static uint64_t HashGLTFInputs(const AssetPipelineParams* assetParams, const ProcessGLTFParams* glTFParams, const void* pFileData,
+                               size_t fileSize, const cgltf_data* data)
+{
+    const VertexLayout* pVertexLayout = glTFParams->pVertexLayout;
+    const int32_t       settings[] = {
+        (int32_t)glTFParams->mIgnoreMissingAttributes, (int32_t)glTFParams->mProcessMeshlets,   glTFParams->mNumMaxVertices,
+        glTFParams->mNumMaxTriangles,                  (int32_t)glTFParams->mOptimizationFlags, (int32_t)glTFParams->mWritePackedFormat,
+        glTFParams->pReadExtrasCallback != NULL,       glTFParams->pWriteExtrasCallback != NULL, (int32_t)glTFParams->mLodCount,
+        (int32_t)glTFParams->mLodMeshlets,             (int32_t)glTFParams->mCompressStreams,   (int32_t)glTFParams->mQuantizationBits,
+        (int32_t)glTFParams->mQuantizeMeshletData,
+    };
+    // Extras callbacks can't be hashed, callers bump mAdditionalModifiedTime when they change like with the modification time checks
+    const int64_t additionalModifiedTime = (int64_t)assetParams->mAdditionalModifiedTime;
+
+    uint64_t hash = BuildCacheHash(BUILD_CACHE_HASH_SEED, "ProcessGLTF", strlen("ProcessGLTF"));
+    hash = BuildCacheHash(hash, settings, sizeof(settings));
+    hash = BuildCacheHash(hash, &glTFParams->mLodIndexRatio, sizeof(glTFParams->mLodIndexRatio));
+    hash = BuildCacheHash(hash, glTFParams->mLodTargetErrors, sizeof(glTFParams->mLodTargetErrors));
+    hash = BuildCacheHash(hash, &additionalModifiedTime, sizeof(additionalModifiedTime));
+
+    // Field by field, the layout might come with uninitialized padding or names
+    for (uint32_t b = 0; b < pVertexLayout->mBindingCount; ++b)
     {
-        LOGF(LogLevel::eERROR, "Animation %s:%s can not be created.", animationSourceFile, animationData->name);
-        return true;
+        const uint32_t binding[] = { pVertexLayout->mBindings[b].mStride, (uint32_t)pVertexLayout->mBindings[b].mRate };
+        hash = BuildCacheHash(hash, binding, sizeof(binding));
     }
-
-    // Ensure output dir exists before we write the animations to disk
+    for (uint32_t a = 0; a < pVertexLayout->mAttribCount; ++a)
     {
-        char directory[FS_MAX_PATH] = {};
-        fsGetParentPath(animOutFile, directory);
-        fsCreateDirectory(animationSettings->mSkeletonAndAnimOutRd, directory, true);
+        const VertexAttrib* attr = &pVertexLayout->mAttribs[a];
+        const uint32_t      attrib[] = { (uint32_t)attr->mSemantic, (uint32_t)attr->mFormat, attr->mBinding, attr->mLocation, attr->mOffset };
+        hash = BuildCacheHash(hash, attrib, sizeof(attrib));
     }
 
-    // Write animation to disk
-    FileStream file = {};
-    if (!fsOpenStreamFromPath(animationSettings->mSkeletonAndAnimOutRd, animOutFile, FM_WRITE, &file))
+    hash = BuildCacheHash(hash, pFileData, fileSize);
+    for (cgltf_size b = 0; b < data->buffers_count; ++b)
     {
-        LOGF(LogLevel::eERROR, "Animation %s:%s can not be saved to %s/%s", animationSourceFile, animationData->name,
-             fsGetResourceDirectory(animationSettings->mSkeletonAndAnimOutRd), animOutFile);
-        animation.Deallocate();
-        return true;
+        const uint64_t bufferSize = data->buffers[b].data ? (uint64_t)data->buffers[b].size : 0;
+        hash = BuildCacheHash(hash, &bufferSize, sizeof(bufferSize));
+        hash = BuildCacheHash(hash, data->buffers[b].data, (size_t)bufferSize);
     }
-
-    ozz::io::OArchive archive(&file);
-    archive << animation;
-    fsCloseStream(&file);
-    // Deallocate animation
-    animation.Deallocate();
-
-    return false;
+    return hash;
 }
 
-bool CreateRuntimeAnimations(ResourceDirectory resourceDirInput, const char* animationInputFile, const char* animationOutputPath,
-                             ozz::animation::Skeleton* skeleton, RuntimeAnimationSettings* animationSettings,
-                             ProcessAssetsSettings* settings)
+// One level of detail of a glTF primitive, indices and meshlet vertices are relative to the first vertex of the primitive
+typedef struct GLTFPrimitiveLevel
 {
-    UNREF_PARAM(settings);
-    // Import the glTF with the animation
-    cgltf_data*  data = NULL;
-    void*        srcFileData = NULL;
-    cgltf_result result = cgltf_parse_and_load(resourceDirInput, animationInputFile, &data, &srcFileData);
-    if (result != cgltf_result_success)
+    // Simplified indices, NULL for level 0 (stored in the shadow index buffer) and for levels that reuse the previous one
+    uint32_t*    pIndices;
+    float        mError;
+    Meshlet*     pMeshlets;
+    MeshletData* pMeshletsData;
+    uint*        pMeshletVertices;
+    uint8_t*     pMeshletTriangles;
+} GLTFPrimitiveLevel;
+
+// One primitive of a glTF file. Primitives own disjoint ranges of the index buffer and of the vertex buffers, so they can be optimized
+// and split into meshlets concurrently. The ranges are then moved to their compacted offsets in primitive order.
+typedef struct GLTFPrimitiveTask
+{
+    AssetPipelineParams*     pAssetParams;
+    const char*              pFileName;
+    const ProcessGLTFParams* pGLTFParams;
+    const cgltf_primitive*   pPrimitive;
+    const cgltf_attribute*   pPositionAttr;
+    GeometryData*            pGeomData;
+    const PackingFunction*   pVertexPacking;
+    IndexType                mIndexType;
+    uint32_t                 mIndexOffset;
+    uint32_t                 mVertexOffset;
+    uint32_t                 mOptimizedVertexCount;
+    uint32_t                 mCompactedVertexOffset;
+    // Simplified levels after level 0
+    uint32_t                 mLodCount;
+    GLTFPrimitiveLevel       mLevels[GEOMETRY_MAX_LODS];
+    MeshoptScratchPool*      pScratchPool;
+    // Microseconds spent in each stage
+    int64_t                  mPackTime;
+    int64_t                  mOptimizeTime;
+    int64_t                  mLodTime;
+    int64_t                  mMeshletTime;
+    AssetPipelineTaskGroup*  pGroup;
+} GLTFPrimitiveTask;
+
+// One input file of ProcessGLTF, files are independent so each one is processed by its own task
+typedef struct GLTFFileTask
+{
+    AssetPipelineParams* pAssetParams;
+    ProcessGLTFParams*   pGLTFParams;
+    ThreadSystem         mThreadSystem;
+    MeshoptScratchPool*  pScratchPool;
+    const char*          pInFileName;
+    bool                 mSkipped;
+    bool                 mError;
+    // Microseconds spent in each stage, primitive stages are summed over primitives
+    int64_t              mLoadTime;
+    int64_t              mPackTime;
+    int64_t              mOptimizeTime;
+    int64_t              mLodTime;
+    int64_t              mMeshletTime;
+    int64_t              mWriteTime;
+    // Bytes of the index and vertex sections before and after encoding, packed format only
+    uint64_t             mStreamSize;
+    uint64_t             mEncodedStreamSize;
+} GLTFFileTask;
+
+static void ProcessGLTFPrimitive(GLTFPrimitiveTask* pTask)
+{
+    const cgltf_primitive*    prim = pTask->pPrimitive;
+    GeometryData::ShadowData* pShadow = pTask->pGeomData->pShadow;
+    const uint32_t            indexOffset = pTask->mIndexOffset;
+    const uint32_t            vertexOffset = pTask->mVertexOffset;
+    AssetPipelineParams*      assetParams = pTask->pAssetParams;
+    const uint64_t indexBytes = prim->indices->count * (INDEX_TYPE_UINT16 == pTask->mIndexType ? sizeof(uint16_t) : sizeof(uint32_t));
+
+    AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, "glTF pack", pTask->pFileName);
+    MeshoptScratch*    pScratch = AcquireMeshoptScratch(pTask->pScratchPool);
+
+    /************************************************************************/
+    // Fill index buffer for this primitive
+    /************************************************************************/
+    if (INDEX_TYPE_UINT16 == pTask->mIndexType)
     {
-        return true;
+        uint16_t* dst = (uint16_t*)pShadow->pIndices;
+        for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
+            dst[indexOffset + idx] = (uint16_t)cgltf_accessor_read_index(prim->indices, idx);
+    }
+    else
+    {
+        uint32_t* dst = (uint32_t*)pShadow->pIndices;
+        for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
+            dst[indexOffset + idx] = (uint32_t)cgltf_accessor_read_index(prim->indices, idx);
     }
 
-    // Check if the asset contains any animations
-    if (data->animations_count == 0)
+    /************************************************************************/
+    // Fill vertex buffers for this primitive
+    /************************************************************************/
+    for (uint32_t a = 0; a < prim->attributes_count; ++a)
     {
-        LOGF(LogLevel::eWARNING, "Animation asset %s contains no animations.", animationInputFile);
+        const cgltf_attribute* attr = &prim->attributes[a];
+        const uint32_t         semanticIdx = (uint32_t)util_cgltf_attrib_type_to_semantic(attr->type, attr->index);
+        ASSERT(semanticIdx < TF_ARRAY_COUNT(pShadow->pAttributes));
 
-        tf_free(srcFileData);
-        cgltf_free(data);
-        return true;
+        // TODO: this should probably be an ASSERT, we don't want to loose data when using pShadow
+        if (pShadow->mVertexStrides[semanticIdx] != 0)
+        {
+            const uint32_t stride = pShadow->mVertexStrides[semanticIdx];
+
+            const uint8_t* src = (uint8_t*)attr->data->buffer_view->buffer->data + attr->data->offset + attr->data->buffer_view->offset;
+            uint8_t*       dst = (uint8_t*)pShadow->pAttributes[semanticIdx] + (uint64_t)vertexOffset * stride;
+
+            // For now we just copy attributes to it's own buffer, in case of interleaved attributes we pack them in the
+            // ResourceLoader during load
+            // TODO: Consider adding an option to make the attributes interleaved here in the AssetPipeline so that we don't
+            // have to do it in runtime.
+            //       The inconvenience in that case would be that in order to get the pShadow data we would have to unpack the
+            //       interleaved attributes, another option would be to store interleaved buffers AND pShadow buffers (duplicate
+            //       some data). If we duplicate data would be better to only store pShadow data for the meshes that require it
+            //       rather than all of them, that would require more configuration parameters per mesh while running the
+            //       AssetPipeline.
+            if (pTask->pVertexPacking[semanticIdx])
+                pTask->pVertexPacking[semanticIdx]((uint32_t)attr->data->count, (uint32_t)attr->data->stride, stride, 0, src, dst);
+            else
+                memcpy(dst, src, attr->data->count * attr->data->stride);
+        }
     }
 
-    LOGF(eINFO, "Processing %u animations from file '%s'", (uint32_t)data->animations_count, animationInputFile);
+    pTask->mPackTime = EndAssetPipelineScope(assetParams, &scope, indexBytes, indexBytes);
+    scope = BeginAssetPipelineScope(assetParams, "glTF optimize", pTask->pFileName);
 
-    bool error = false;
-    for (cgltf_size animationIndex = 0; animationIndex < data->animations_count; animationIndex += 1)
+    /************************************************************************/
+    // Optimize mesh
+    /************************************************************************/
+    pTask->mOptimizedVertexCount = (uint32_t)prim->attributes[0].data->count;
+    if (pTask->pGLTFParams->mOptimizationFlags != MESH_OPTIMIZATION_FLAG_OFF)
     {
-        cgltf_animation* animationData = &data->animations[animationIndex];
+        geomOptimize(pTask->pGeomData, MESH_OPTIMIZATION_FLAG_ALL, pTask->mIndexType, indexOffset, (uint32_t)(prim->indices->count),
+                     vertexOffset, &pTask->mOptimizedVertexCount);
+    }
 
-        LOGF(eINFO, "Processing animation %u: %s", (uint32_t)animationIndex, animationData->name);
+    pTask->mOptimizeTime = EndAssetPipelineScope(assetParams, &scope, indexBytes, indexBytes);
+    scope = BeginAssetPipelineScope(assetParams, "glTF lods", pTask->pFileName);
 
-        char buffer[FS_MAX_PATH] = {};
-        if (data->animations_count == 1)
+    /************************************************************************/
+    // Simplify the primitive into the level of detail chain, ProcessGLTFFile validated the positions layout
+    /************************************************************************/
+    if (pTask->mLodCount > 0)
+    {
+        const ProcessGLTFParams* pParams = pTask->pGLTFParams;
+        const size_t             indexCount = prim->indices->count;
+
+        uint32_t* pIndices = (uint32_t*)pShadow->pIndices + indexOffset;
+        uint32_t* pConvertedIndices = NULL;
+        if (INDEX_TYPE_UINT16 == pTask->mIndexType)
         {
-            // If the file only contains one animation we use the name of the input file as the output file
-            char inAnimFilename[FS_MAX_PATH / 2] = {};
-            fsGetPathFileName(animationInputFile, inAnimFilename);
-            snprintf(buffer, sizeof(buffer), "%s/%s.ozz", animationOutputPath, inAnimFilename);
+            arrsetlen(pConvertedIndices, indexCount);
+            for (size_t idx = 0; idx < indexCount; ++idx)
+                pConvertedIndices[idx] = ((uint16_t*)pShadow->pIndices)[indexOffset + idx];
+            pIndices = pConvertedIndices;
         }
-        else
+
+        float targetErrors[GEOMETRY_MAX_LODS - 1] = {};
+        for (uint32_t i = 0; i < pTask->mLodCount; ++i)
+            targetErrors[i] = pParams->mLodTargetErrors[i] > 0.0f ? pParams->mLodTargetErrors[i] : 0.01f;
+
+        uint32_t* lodIndices[GEOMETRY_MAX_LODS - 1] = {};
+        float     lodErrors[GEOMETRY_MAX_LODS - 1] = {};
+        const uint32_t positionStride = pShadow->mVertexStrides[SEMANTIC_POSITION];
+        simplifyLods(pIndices, indexCount, (float3*)((uint8_t*)pShadow->pAttributes[SEMANTIC_POSITION] + vertexOffset * positionStride),
+                     pTask->mOptimizedVertexCount, positionStride, pTask->mLodCount,
+                     pParams->mLodIndexRatio > 0.0f ? pParams->mLodIndexRatio : 0.5f, targetErrors, lodIndices, lodErrors);
+
+        for (uint32_t i = 0; i < pTask->mLodCount; ++i)
         {
-            // When the input file contains more than one animation we use the name of the animation so that we don't have collisions
-            snprintf(buffer, sizeof(buffer), "%s/%s.ozz", animationOutputPath, animationData->name);
+            pTask->mLevels[i + 1].pIndices = lodIndices[i];
+            pTask->mLevels[i + 1].mError = lodErrors[i];
         }
 
-        const char* animOutFilePath = buffer;
-        if (CreateRuntimeAnimation(animationSettings, animationData, animOutFilePath, skeleton, animationInputFile))
-            error = true;
+        arrfree(pConvertedIndices);
     }
 
-    tf_free(srcFileData);
-    cgltf_free(data);
+    uint64_t lodBytes = 0;
+    for (uint32_t l = 1; l <= pTask->mLodCount; ++l)
+        lodBytes += arrlenu(pTask->mLevels[l].pIndices) * sizeof(uint32_t);
+    pTask->mLodTime = EndAssetPipelineScope(assetParams, &scope, indexBytes, lodBytes);
+    scope = BeginAssetPipelineScope(assetParams, "glTF meshlets", pTask->pFileName);
 
-    return error;
-}
+    /************************************************************************/
+    // Build meshlets for this primitive, ProcessGLTFFile validated the index type and the positions layout
+    /************************************************************************/
+    if (pTask->pGLTFParams->mProcessMeshlets)
+    {
+        const cgltf_attribute* pos_attr = pTask->pPositionAttr;
+        float3* positions = (float3*)((uint8_t*)pShadow->pAttributes[SEMANTIC_POSITION] + vertexOffset * pos_attr->data->stride);
+
+        const uint64_t maxVertices = (uint64_t)pTask->pGLTFParams->mNumMaxVertices;
+        const uint64_t maxTriangles = (uint64_t)pTask->pGLTFParams->mNumMaxTriangles;
+        // 0.0 had better results overall
+        const float    coneWeight = 0.0f;
+
+        // Levels that reuse the previous one get a copy of its meshlets so that every level has the meshlets of all primitives
+        const uint32_t  levelCount = pTask->pGLTFParams->mLodMeshlets ? pTask->mLodCount + 1 : 1;
+        const uint32_t* pLevelIndices = (uint32_t*)pShadow->pIndices + indexOffset;
+        size_t          levelIndexCount = prim->indices->count;
+        for (uint32_t l = 0; l < levelCount; ++l)
+        {
+            GLTFPrimitiveLevel* pLevel = &pTask->mLevels[l];
+            if (pLevel->pIndices)
+            {
+                pLevelIndices = pLevel->pIndices;
+                levelIndexCount = arrlenu(pLevel->pIndices);
+            }
 
-static inline constexpr ShaderSemantic util_cgltf_attrib_type_to_semantic(cgltf_attribute_type type, uint32_t index)
-{
-    switch (type)
+            buildMeshlets(pScratch, pLevelIndices, levelIndexCount, positions, pos_attr->data->count, pos_attr->data->stride,
+                          maxVertices, maxTriangles, coneWeight, &pLevel->pMeshletVertices, &pLevel->pMeshletTriangles,
+                          &pLevel->pMeshlets, &pLevel->pMeshletsData);
+        }
+    }
+
+    uint64_t meshletBytes = 0;
+    for (uint32_t l = 0; l <= pTask->mLodCount; ++l)
     {
-    case cgltf_attribute_type_position:
-        return SEMANTIC_POSITION;
-    case cgltf_attribute_type_normal:
-        return SEMANTIC_NORMAL;
-    case cgltf_attribute_type_tangent:
-        return SEMANTIC_TANGENT;
-    case cgltf_attribute_type_color:
-        return SEMANTIC_COLOR;
-    case cgltf_attribute_type_joints:
-        return SEMANTIC_JOINTS;
-    case cgltf_attribute_type_weights:
-        return SEMANTIC_WEIGHTS;
-    case cgltf_attribute_type_texcoord:
-        return (ShaderSemantic)(SEMANTIC_TEXCOORD0 + index);
-    default:
-        return SEMANTIC_TEXCOORD0;
+        const GLTFPrimitiveLevel* pLevel = &pTask->mLevels[l];
+        meshletBytes += arrlenu(pLevel->pMeshlets) * (sizeof(Meshlet) + sizeof(MeshletData)) +
+                        arrlenu(pLevel->pMeshletVertices) * sizeof(uint) + arrlenu(pLevel->pMeshletTriangles);
     }
+    pTask->mMeshletTime = EndAssetPipelineScope(assetParams, &scope, indexBytes + lodBytes, meshletBytes);
+
+    ReleaseMeshoptScratch(pTask->pScratchPool, pScratch);
 }
 
-static inline constexpr TinyImageFormat util_cgltf_type_to_image_format(cgltf_type type, cgltf_component_type compType)
+// Appends the meshlets of one primitive level to the geometry and releases them
+static void AppendPrimitiveMeshlets(GeometryMeshlets* pMeshlets, GLTFPrimitiveLevel* pLevel, uint32_t vertexOffset)
 {
-    switch (type)
+    Meshlet*     subMeshlets = pLevel->pMeshlets;
+    MeshletData* meshletsData = pLevel->pMeshletsData;
+    // indices for positions
+    uint*        meshletVertices = pLevel->pMeshletVertices;
+    uint8_t*     meshletTriangles = pLevel->pMeshletTriangles;
+
+    arrsetlen(pMeshlets->mVertices, pMeshlets->mVertexCount + arrlenu(meshletVertices));
+    for (uint64_t index_id = 0; index_id < arrlenu(meshletVertices); ++index_id)
     {
-    case cgltf_type_scalar:
-        if (cgltf_component_type_r_8 == compType)
-            return TinyImageFormat_R8_SINT;
-        else if (cgltf_component_type_r_16 == compType)
-            return TinyImageFormat_R16_SINT;
-        else if (cgltf_component_type_r_16u == compType)
-            return TinyImageFormat_R16_UINT;
-        else if (cgltf_component_type_r_32f == compType)
-            return TinyImageFormat_R32_SFLOAT;
-        else if (cgltf_component_type_r_32u == compType)
-            return TinyImageFormat_R32_UINT;
-    case cgltf_type_vec2:
-        if (cgltf_component_type_r_8 == compType)
-            return TinyImageFormat_R8G8_SINT;
-        else if (cgltf_component_type_r_16 == compType)
-            return TinyImageFormat_R16G16_SINT;
-        else if (cgltf_component_type_r_16u == compType)
-            return TinyImageFormat_R16G16_UINT;
-        else if (cgltf_component_type_r_32f == compType)
-            return TinyImageFormat_R32G32_SFLOAT;
-        else if (cgltf_component_type_r_32u == compType)
-            return TinyImageFormat_R32G32_UINT;
-    case cgltf_type_vec3:
-        if (cgltf_component_type_r_8 == compType)
-            return TinyImageFormat_R8G8B8_SINT;
-        else if (cgltf_component_type_r_16 == compType)
-            return TinyImageFormat_R16G16B16_SINT;
-        else if (cgltf_component_type_r_16u == compType)
-            return TinyImageFormat_R16G16B16_UINT;
-        else if (cgltf_component_type_r_32f == compType)
-            return TinyImageFormat_R32G32B32_SFLOAT;
-        else if (cgltf_component_type_r_32u == compType)
-            return TinyImageFormat_R32G32B32_UINT;
-    case cgltf_type_vec4:
-        if (cgltf_component_type_r_8 == compType)
-            return TinyImageFormat_R8G8B8A8_SINT;
-        else if (cgltf_component_type_r_8u == compType)
-            return TinyImageFormat_R8G8B8A8_UINT;
-        else if (cgltf_component_type_r_16 == compType)
-            return TinyImageFormat_R16G16B16A16_SINT;
-        else if (cgltf_component_type_r_16u == compType)
-            return TinyImageFormat_R16G16B16A16_UINT;
-        else if (cgltf_component_type_r_32f == compType)
-            return TinyImageFormat_R32G32B32A32_SFLOAT;
-        else if (cgltf_component_type_r_32u == compType)
-            return TinyImageFormat_R32G32B32A32_UINT;
-        // #NOTE: Not applicable to vertex formats
-    case cgltf_type_mat2:
-    case cgltf_type_mat3:
-    case cgltf_type_mat4:
-    default:
-        return TinyImageFormat_UNDEFINED;
+        pMeshlets->mVertices[pMeshlets->mVertexCount + index_id] = meshletVertices[index_id] + vertexOffset;
     }
-}
 
-typedef void (*PackingFunction)(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset, const uint8_t* src, uint8_t* dst);
+    arrsetlen(pMeshlets->mTriangles, pMeshlets->mTriangleCount + arrlenu(meshletTriangles));
+    memcpy(pMeshlets->mTriangles + pMeshlets->mTriangleCount, meshletTriangles, arrlenu(meshletTriangles) * sizeof *meshletTriangles);
 
-static inline void util_pack_float2_to_half2(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset, const uint8_t* src,
-                                             uint8_t* dst)
-{
-    COMPILE_ASSERT(sizeof(float2) == sizeof(float[2]));
-    ASSERT(srcStride == sizeof(float2));
-    ASSERT(dstStride == sizeof(uint32_t));
+    arrsetlen(pMeshlets->mMeshletsData, pMeshlets->mMeshletCount + arrlenu(subMeshlets));
+    memcpy((void*)(pMeshlets->mMeshletsData + pMeshlets->mMeshletCount), meshletsData, //-V595
+           arrlenu(subMeshlets) * sizeof *meshletsData);
 
-    float2* f = (float2*)src;
-    for (uint32_t e = 0; e < count; ++e)
+    arrsetlen(pMeshlets->mMeshlets, pMeshlets->mMeshletCount + arrlenu(subMeshlets));
+    memcpy(pMeshlets->mMeshlets + pMeshlets->mMeshletCount, subMeshlets, arrlenu(subMeshlets) * sizeof *subMeshlets);
+
+    for (uint64_t meshlet_id = 0; meshlet_id < arrlenu(subMeshlets); ++meshlet_id)
     {
-        *(uint32_t*)(dst + e * sizeof(uint32_t) + offset) = packFloat2ToHalf2(f[e]);
+        pMeshlets->mMeshlets[pMeshlets->mMeshletCount + meshlet_id].triangleOffset += (uint)pMeshlets->mTriangleCount;
+        pMeshlets->mMeshlets[pMeshlets->mMeshletCount + meshlet_id].vertexOffset += (uint)pMeshlets->mVertexCount;
     }
+
+    pMeshlets->mVertexCount += arrlenu(meshletVertices);
+    pMeshlets->mTriangleCount += arrlenu(meshletTriangles);
+    pMeshlets->mMeshletCount += arrlenu(subMeshlets);
+
+    arrfree(subMeshlets);
+    arrfree(meshletsData);
+    arrfree(meshletVertices);
+    arrfree(meshletTriangles);
+    pLevel->pMeshlets = NULL;
+    pLevel->pMeshletsData = NULL;
+    pLevel->pMeshletVertices = NULL;
+    pLevel->pMeshletTriangles = NULL;
 }
 
-static inline void util_pack_float3_direction_to_half2(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset,
-                                                       const uint8_t* src, uint8_t* dst)
+static void ProcessGLTFPrimitiveTask(void* pUser, uint64_t)
 {
-    COMPILE_ASSERT(sizeof(float3) == sizeof(float[3]));
-    ASSERT(dstStride == sizeof(uint32_t));
-    for (uint32_t e = 0; e < count; ++e)
-    {
-        float3 f = *(float3*)(src + e * srcStride);
-        *(uint32_t*)(dst + e * dstStride + offset) = packFloat3DirectionToHalf2(f);
-    }
+    GLTFPrimitiveTask* pTask = (GLTFPrimitiveTask*)pUser;
+    ProcessGLTFPrimitive(pTask);
+    EndAssetPipelineTask(pTask->pGroup);
 }
 
-static inline void util_unpack_uint8_to_uint16_joints(uint32_t count, uint32_t srcStride, uint32_t dstStride, uint32_t offset,
-                                                      const uint8_t* src, uint8_t* dst)
+// Hair data that ProcessTFX writes in the asset extras
+typedef struct TressFXExtras
 {
-    ASSERT(srcStride == 4 && "Expecting stride of 4 (sizeof(uint8_t) * 4 joints)");
+    uint32_t mVertexCountPerStrand;
+    uint32_t mGuideCount;
+    // Strands drawn by every level of detail, the first level draws all of them. 0 levels when the asset has none.
+    uint32_t mLodStrandCounts[GEOMETRY_MAX_LODS];
+    uint32_t mLodCount;
+    // Strands are stored guides first, the levels of detail are prefixes of the vertex buffers
+    bool     mGuidesFirst;
+    // Bounds of the 16 bit unorm positions
+    bool     mQuantizedPositions;
+    float    mPositionMin[3];
+    float    mPositionMax[3];
+} TressFXExtras;
+
+static bool IsJsonKey(const char* json, const jsmntok_t* pToken, const char* key)
+{
+    const int length = (int)strlen(key);
+    return pToken->type == JSMN_STRING && pToken->end - pToken->start == length && strncmp(json + pToken->start, key, length) == 0;
+}
 
-    for (uint32_t e = 0; e < count; ++e)
+// { "mVertexCountPerStrand" : 16, "mGuideCountPerStrand" : 3456, "mLodStrandCounts" : [ 221184, 110592 ], "mGuidesFirst" : 1,
+//   "mPositionMin" : [ x, y, z ], "mPositionMax" : [ x, y, z ] }, the keys after the first two are optional
+static void ReadTressFXExtras(const cgltf_data* data, TressFXExtras* pOut)
+{
+    *pOut = {};
+
+    const uint32_t extrasSize = (uint32_t)(data->asset.extras.end_offset - data->asset.extras.start_offset);
+    const char*    json = data->json + data->asset.extras.start_offset;
+    jsmn_parser    parser = {};
+    jsmntok_t      tokens[64] = {};
+    const int      tokenCount = jsmn_parse(&parser, json, extrasSize, tokens, TF_ARRAY_COUNT(tokens));
+
+    uint32_t boundCount = 0;
+    for (int i = 1; i + 1 < tokenCount;)
     {
-        const uint8_t* srcBase = (const uint8_t*)(src + e * srcStride);
-        uint16_t*      dstBase = (uint16_t*)(dst + e * dstStride + offset);
-        dstBase[0] = srcBase[0];
-        dstBase[1] = srcBase[1];
-        dstBase[2] = srcBase[2];
-        dstBase[3] = srcBase[3];
+        const jsmntok_t* pKey = &tokens[i];
+        const jsmntok_t* pValue = &tokens[i + 1];
+        const int        elementCount = pValue->type == JSMN_ARRAY ? pValue->size : 0;
+        if (i + 2 + elementCount > tokenCount)
+            break;
+
+        if (IsJsonKey(json, pKey, "mVertexCountPerStrand"))
+            pOut->mVertexCountPerStrand = (uint32_t)atoi(json + pValue->start);
+        else if (IsJsonKey(json, pKey, "mGuideCountPerStrand"))
+            pOut->mGuideCount = (uint32_t)atoi(json + pValue->start);
+        else if (IsJsonKey(json, pKey, "mLodStrandCounts"))
+        {
+            pOut->mLodCount = min((uint32_t)elementCount, (uint32_t)GEOMETRY_MAX_LODS);
+            for (uint32_t l = 0; l < pOut->mLodCount; ++l)
+                pOut->mLodStrandCounts[l] = (uint32_t)atoi(json + pValue[1 + l].start);
+        }
+        else if (IsJsonKey(json, pKey, "mGuidesFirst"))
+            pOut->mGuidesFirst = atoi(json + pValue->start) != 0;
+        else if ((IsJsonKey(json, pKey, "mPositionMin") || IsJsonKey(json, pKey, "mPositionMax")) && elementCount == 3)
+        {
+            float* pBound = IsJsonKey(json, pKey, "mPositionMin") ? pOut->mPositionMin : pOut->mPositionMax;
+            for (uint32_t c = 0; c < 3; ++c)
+                pBound[c] = (float)atof(json + pValue[1 + c].start);
+            ++boundCount;
+        }
+
+        i += 2 + elementCount;
     }
+
+    pOut->mQuantizedPositions = boundCount == 2;
 }
 
-void OnGLTFFind(ResourceDirectory resourceDir, const char* filename, void* pUserData)
+static void ProcessGLTFFile(GLTFFileTask* pTask)
 {
-    UNREF_PARAM(resourceDir);
-    bstring** inputFileNames = (bstring**)pUserData;
-    arrpush(*inputFileNames, bdynfromcstr(filename));
-}
+    AssetPipelineParams* assetParams = pTask->pAssetParams;
+    ProcessGLTFParams*   glTFParams = pTask->pGLTFParams;
+    VertexLayout*        pVertexLayout = glTFParams->pVertexLayout;
+    const char*          fileName = pTask->pInFileName;
+    bool                 error = false;
+
+    char newFileName[FS_MAX_PATH] = { 0 };
+    if (assetParams->mOutSubdir)
+    {
+        char extractedFileName[FS_MAX_PATH] = {};
+        fsGetPathFileName(fileName, extractedFileName);
+
+        strcat(extractedFileName, ".bin");
+        fsAppendPathComponent(assetParams->mOutSubdir, extractedFileName, newFileName);
+    }
+    else
+    {
+        fsReplacePathExtension(fileName, "bin", newFileName);
+    }
+
+    // The build cache checks content hashes once the buffers are loaded
+    if (!assetParams->pBuildCache && !assetParams->mSettings.force && fsFileExist(assetParams->mRDOutput, newFileName))
+    {
+        time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, fileName);
+        if (assetParams->mAdditionalModifiedTime != 0)
+            lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
+        time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, newFileName);
+
+        if (lastModified < lastProcessed)
+        {
+            LOGF(eINFO, "Skipping %s", fileName);
+            pTask->mSkipped = true;
+            return;
+        }
+    }
 
-void CheckIfGltfHasAnimations(ResourceDirectory resourceDirInput, const char* gltfFileName, uint32_t& numAnimationsOut)
-{
-    numAnimationsOut = 0;
+    LOGF(eINFO, "Converting %s to TF custom binary file", fileName);
+
+    AssetPipelineScope fileScope = BeginAssetPipelineScope(assetParams, "glTF", fileName);
+    AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, "glTF load", fileName);
 
     FileStream file = {};
-    if (!fsOpenStreamFromPath(resourceDirInput, gltfFileName, FM_READ, &file))
+    if (!fsOpenStreamFromPath(assetParams->mRDInput, fileName, FM_READ, &file))
     {
-        LOGF(eERROR, "Failed to open gltf file %s", gltfFileName);
+        LOGF(eERROR, "Failed to open gltf file %s", fileName);
+        pTask->mError = true;
         return;
     }
 
@@ -1396,901 +3592,895 @@ void CheckIfGltfHasAnimations(ResourceDirectory resourceDirInput, const char* gl
         UNREF_PARAM(user);
         tf_free(ptr);
     };
-    options.rd = resourceDirInput;
+    options.rd = assetParams->mRDInput;
     cgltf_result result = cgltf_parse(&options, fileData, fileSize, &data);
     fsCloseStream(&file);
 
     if (cgltf_result_success != result)
     {
-        LOGF(eERROR, "Failed to parse gltf file %s with error %u", gltfFileName, (uint32_t)result);
+        LOGF(eERROR, "Failed to parse gltf file %s with error %u", fileName, (uint32_t)result);
         tf_free(fileData);
+        pTask->mError = true;
         return;
     }
 
-    numAnimationsOut = (uint32_t)data->animations_count;
-
-    cgltf_free(data);
-    tf_free(fileData);
-}
-
-void buildMeshlets(const uint* indices, size_t indexCount, const float3* vertexPositions, size_t vertexCount, size_t vertexPositionsStride,
-                   size_t maxVertices, size_t maxTriangles, float coneWeight, uint** meshletVertices, uint8_t** meshletTriangles,
-                   Meshlet** meshlets, MeshletData** meshletsData)
-{
-    size_t    optimizerScratchSize = 128 * 1024 * 1024;
-    uint32_t* optimizerScratch = (uint32_t*)tf_malloc(optimizerScratchSize);
-    meshopt_SetScratchMemory(optimizerScratchSize, optimizerScratch);
-
-    uint64_t maxMeshlets = meshopt_buildMeshletsBound(indexCount, maxVertices, maxTriangles);
-
-    meshopt_Meshlet* meshletsTmp = NULL;
-    arrsetlen(meshletsTmp, maxMeshlets);
-
-    MeshletData* meshletsDataTmp = NULL;
-    arrsetlen(meshletsDataTmp, maxMeshlets);
-
-    uint* meshletVerticesTmp = NULL;
-    arrsetlen(meshletVerticesTmp, maxMeshlets * maxVertices);
-
-    uint8_t* meshletTrianglesTmp = NULL;
-    arrsetlen(meshletTrianglesTmp, maxMeshlets * maxTriangles * 3);
-
-    uint64_t meshletCount =
-        meshopt_buildMeshlets(meshletsTmp, meshletVerticesTmp, meshletTrianglesTmp, indices, indexCount, (float*)vertexPositions,
-                              vertexCount, vertexPositionsStride, maxVertices, maxTriangles, coneWeight);
-
-    if (meshletsTmp && meshletsDataTmp && meshletVerticesTmp && meshletTrianglesTmp)
+#if defined(FORGE_DEBUG)
+    result = cgltf_validate(data);
+    if (cgltf_result_success != result)
     {
-        const meshopt_Meshlet& last = meshletsTmp[meshletCount - 1];
+        LOGF(eWARNING, "GLTF validation finished with error %u for file %s", (uint32_t)result, fileName);
+    }
+#endif
 
-        arrsetlen(meshletVerticesTmp, last.vertex_offset + last.vertex_count);
-        arrsetlen(meshletTrianglesTmp, last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
-        arrsetlen(meshletsTmp, meshletCount);
+    // Load buffers located in separate files (.bin) using our file system
+    for (uint32_t j = 0; j < data->buffers_count; ++j)
+    {
+        const char* uri = data->buffers[j].uri;
 
-        for (uint m = 0; m < arrlenu(meshletsTmp); m++)
+        if (!uri || data->buffers[j].data)
         {
-            meshopt_Meshlet* meshlet = &meshletsTmp[m];
-            meshopt_Bounds   bounds =
-                meshopt_computeMeshletBounds(&meshletVerticesTmp[meshlet->vertex_offset], &meshletTrianglesTmp[meshlet->triangle_offset],
-                                             meshlet->triangle_count, (float*)vertexPositions, vertexCount, vertexPositionsStride);
-
-            MeshletData* meshletData = &meshletsDataTmp[m];
-            meshletData->center = float3(bounds.center[0], bounds.center[1], bounds.center[2]);
-            meshletData->radius = bounds.radius;
-            meshletData->coneApex = float3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
-            meshletData->coneAxis = float3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
-            meshletData->coneCutoff = bounds.cone_cutoff;
+            continue;
         }
 
-        *meshlets = (Meshlet*)meshletsTmp;
-        *meshletsData = meshletsDataTmp;
-        *meshletVertices = meshletVerticesTmp;
-        *meshletTriangles = meshletTrianglesTmp;
-    }
-    else
-    {
-        LOGF(eERROR, "Failed to build meshlets");
+        if (strncmp(uri, "data:", 5) != 0 && !strstr(uri, "://"))
+        {
+            char parent[FS_MAX_PATH] = { 0 };
+            fsGetParentPath(fileName, parent);
+            char path[FS_MAX_PATH] = { 0 };
+            fsAppendPathComponent(parent, uri, path);
+            FileStream fs = {};
+            if (fsOpenStreamFromPath(assetParams->mRDInput, path, FM_READ, &fs))
+            {
+                ASSERT(fsGetStreamFileSize(&fs) >= (ssize_t)data->buffers[j].size);
+                data->buffers[j].data = tf_malloc(data->buffers[j].size);
+                fsReadFromStream(&fs, data->buffers[j].data, data->buffers[j].size);
+                fsCloseStream(&fs);
+            }
+        }
     }
 
-    meshopt_FreeScratchMemory();
-}
-
-static void geomOptimize(GeometryData* geomData, MeshOptimizerFlags optimizationFlags, IndexType indexType, uint32_t indexOffset,
-                         uint32_t indexCount, uint32_t vertexOffset, uint32_t* vertexCount)
-{
-    if (optimizationFlags == MESH_OPTIMIZATION_FLAG_OFF)
+    result = cgltf_load_buffers(&options, data, fileName);
+    if (cgltf_result_success != result)
+    {
+        LOGF(eERROR, "Failed to load buffers from gltf file %s with error %u", fileName, (uint32_t)result);
+        tf_free(fileData);
         return;
+    }
 
-    size_t optimizerScratchSize = 128 * 1024 * 1024;
-    size_t remapSize = (*vertexCount * sizeof(uint32_t));
-
-    uint32_t* optimizerScratch = (uint32_t*)tf_malloc(optimizerScratchSize);
-    uint32_t* remap = (uint32_t*)tf_malloc(remapSize);
-
-    meshopt_SetScratchMemory(optimizerScratchSize, optimizerScratch);
-
-    meshopt_Stream streams[MAX_SEMANTICS];
-    uint32_t       validStreamCount = 0;
-    int32_t        posAttributeIdx = -1;
-    for (size_t i = 0; i < MAX_SEMANTICS; i++)
+    uint64_t buildHash = 0;
+    if (assetParams->pBuildCache)
     {
-        if (!geomData->pShadow->mVertexStrides[i])
-            continue;
-
-        if (i == SEMANTIC_POSITION)
+        buildHash = HashGLTFInputs(assetParams, glTFParams, fileData, (size_t)fileSize, data);
+        if (!assetParams->mSettings.force && BuildCacheIsUpToDate(assetParams, newFileName, buildHash))
         {
-            posAttributeIdx = (int32_t)i;
+            LOGF(eINFO, "Skipping %s", fileName);
+            data->file_data = fileData;
+            cgltf_free(data);
+            pTask->mSkipped = true;
+            return;
         }
-
-        streams[validStreamCount].data = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
-        streams[validStreamCount].size = geomData->pShadow->mVertexStrides[i];
-        streams[validStreamCount].stride = geomData->pShadow->mVertexStrides[i];
-
-        validStreamCount++;
     }
 
-    // Remap functions expect the same vertex count passed when generating the map, so we have to set the new vertex count later on
-    uint32_t newVertCount = 0;
+    // Load the tressfx specific data generated in the offline process
+    TressFXExtras tressFXExtras = {};
+    if (data->asset.generator && stricmp(data->asset.generator, "tressfx") == 0)
+        ReadTressFXExtras(data, &tressFXExtras);
 
-    // generating remap & new vertex/index sets
-    if (indexType == INDEX_TYPE_UINT16)
+    // The buffers of external files are read in addition to the gltf
+    uint64_t inputSize = (uint64_t)fileSize;
+    uint64_t bufferSize = 0;
+    for (uint32_t j = 0; j < data->buffers_count; ++j)
     {
-        newVertCount = (uint32_t)meshopt_generateVertexRemapMulti(remap, (uint16_t*)geomData->pShadow->pIndices + indexOffset, indexCount,
-                                                                  *vertexCount, streams, validStreamCount);
-        meshopt_remapIndexBuffer((uint16_t*)geomData->pShadow->pIndices + indexOffset, (uint16_t*)geomData->pShadow->pIndices + indexOffset,
-                                 indexCount, remap);
-    }
-    else
-    {
-        newVertCount = (uint32_t)meshopt_generateVertexRemapMulti(remap, (uint32_t*)geomData->pShadow->pIndices + indexOffset, indexCount,
-                                                                  *vertexCount, streams, validStreamCount);
-        meshopt_remapIndexBuffer((uint32_t*)geomData->pShadow->pIndices + indexOffset, (uint32_t*)geomData->pShadow->pIndices + indexOffset,
-                                 indexCount, remap);
+        const char* uri = data->buffers[j].uri;
+        if (uri && strncmp(uri, "data:", 5) != 0)
+            inputSize += data->buffers[j].size;
+        bufferSize += data->buffers[j].size;
     }
+    pTask->mLoadTime = EndAssetPipelineScope(assetParams, &scope, inputSize, bufferSize);
 
-    for (size_t i = 0; i < MAX_SEMANTICS; i++)
-    {
-        if (!geomData->pShadow->mVertexStrides[i])
-            continue;
-
-        uint8_t* buffer = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
-        meshopt_remapVertexBuffer(buffer, buffer, *vertexCount, geomData->pShadow->mVertexStrides[i], remap);
-    }
+    cgltf_attribute* vertexAttribs[MAX_SEMANTICS] = {};
 
-    *vertexCount = newVertCount;
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+    uint32_t drawCount = 0;
+    uint32_t jointCount = 0;
+    uint32_t vertexAttribCount[MAX_SEMANTICS] = {};
 
-    // optimize
-    // do we need to optmize per primitive ?
-    /// optmizations like overdraw clearly can alter across primitives. but can vertex cache & vertex fetch do it ?
-    if (indexType == INDEX_TYPE_UINT16)
+    // Find number of traditional draw calls required to draw this piece of geometry
+    // Find total index count, total vertex count
+    for (uint32_t j = 0; j < data->meshes_count; ++j)
     {
-        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXCACHE)
-        {
-            uint16_t* src = (uint16_t*)geomData->pShadow->pIndices + indexOffset;
-            meshopt_optimizeVertexCache(src, src, indexCount, *vertexCount);
-        }
-        // we can only run this if position data is not packed
-        if ((optimizationFlags & MESH_OPTIMIZATION_FLAG_OVERDRAW) && posAttributeIdx >= 0)
+        const cgltf_mesh* mesh = &data->meshes[j];
+        const uint32_t    meshExtrasLength = (uint32_t)(mesh->extras.end_offset - mesh->extras.start_offset);
+        if (glTFParams->pReadExtrasCallback && meshExtrasLength)
         {
-            uint16_t* src = (uint16_t*)geomData->pShadow->pIndices + indexOffset;
-            float*    pos = (float*)((uint8_t*)geomData->pShadow->pAttributes[posAttributeIdx] +
-                                  vertexOffset * geomData->pShadow->mVertexStrides[posAttributeIdx]);
-
-            const float kThreshold = 1.01f;
-            meshopt_optimizeOverdraw(src, src, indexCount, pos, *vertexCount, geomData->pShadow->mVertexStrides[posAttributeIdx],
-                                     kThreshold);
+            glTFParams->pReadExtrasCallback(j, (uint32_t)data->meshes_count, data->json + mesh->extras.start_offset, meshExtrasLength,
+                                            glTFParams->pCallbackUserData);
         }
 
-        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXFETCH)
+        for (uint32_t p = 0; p < mesh->primitives_count; ++p)
         {
-            uint16_t* indices = (uint16_t*)geomData->pShadow->pIndices + indexOffset;
-            newVertCount = (uint32_t)meshopt_optimizeVertexFetchRemap(remap, indices, indexCount, *vertexCount);
-            meshopt_remapIndexBuffer(indices, indices, indexCount, remap);
+            const cgltf_primitive* prim = &mesh->primitives[p];
+            indexCount += (uint32_t)(prim->indices->count);
+            vertexCount += (uint32_t)(prim->attributes[0].data->count);
+            ++drawCount;
 
-            for (size_t i = 0; i < MAX_SEMANTICS; i++)
+            for (uint32_t k = 0; k < prim->attributes_count; ++k)
             {
-                if (!geomData->pShadow->mVertexStrides[i])
-                    continue;
-
-                uint8_t* buffer = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
-                meshopt_remapVertexBuffer(buffer, buffer, *vertexCount, geomData->pShadow->mVertexStrides[i], remap);
+                const uint32_t semanticIdx =
+                    (uint32_t)util_cgltf_attrib_type_to_semantic(prim->attributes[k].type, prim->attributes[k].index);
+                ASSERT(semanticIdx < MAX_SEMANTICS);
+                vertexAttribs[semanticIdx] = &prim->attributes[k];
+                vertexAttribCount[semanticIdx] += (uint32_t)prim->attributes[k].data->count;
             }
         }
     }
-    else
-    {
-        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXCACHE)
-        {
-            uint32_t* src = (uint32_t*)geomData->pShadow->pIndices + indexOffset;
-            meshopt_optimizeVertexCache(src, src, indexCount, *vertexCount);
-        }
-
-        // we can only run this if position data is not packed
-        if ((optimizationFlags & MESH_OPTIMIZATION_FLAG_OVERDRAW) && posAttributeIdx >= 0)
-        {
-            uint32_t* src = (uint32_t*)geomData->pShadow->pIndices + indexOffset;
-            float*    pos = (float*)((uint8_t*)geomData->pShadow->pAttributes[posAttributeIdx] +
-                                  vertexOffset * geomData->pShadow->mVertexStrides[posAttributeIdx]);
-
-            const float kThreshold = 1.01f;
-            meshopt_optimizeOverdraw(src, src, indexCount, pos, *vertexCount, geomData->pShadow->mVertexStrides[posAttributeIdx],
-                                     kThreshold);
-        }
-
-        if (optimizationFlags & MESH_OPTIMIZATION_FLAG_VERTEXFETCH)
-        {
-            uint32_t* indices = (uint32_t*)geomData->pShadow->pIndices + indexOffset;
-            newVertCount = (uint32_t)meshopt_optimizeVertexFetchRemap(remap, indices, indexCount, *vertexCount);
-            meshopt_remapIndexBuffer(indices, indices, indexCount, remap);
-
-            for (size_t i = 0; i < MAX_SEMANTICS; i++)
-            {
-                if (!geomData->pShadow->mVertexStrides[i])
-                    continue;
 
-                uint8_t* buffer = (uint8_t*)geomData->pShadow->pAttributes[i] + vertexOffset * geomData->pShadow->mVertexStrides[i];
-                meshopt_remapVertexBuffer(buffer, buffer, *vertexCount, geomData->pShadow->mVertexStrides[i], remap);
-            }
-        }
+    // Request the size that the user will need to load it's custom fields
+    uint32_t userDataSize = 0;
+    if (glTFParams->pWriteExtrasCallback)
+        glTFParams->pWriteExtrasCallback(&userDataSize, NULL, glTFParams->pCallbackUserData);
+
+    PackingFunction vertexPacking[MAX_SEMANTICS] = {};
+    uint32_t        vertexAttrStrides[MAX_SEMANTICS] = {};
+
+    for (uint32_t j = 0; j < data->skins_count; ++j)
+        jointCount += (uint32_t)data->skins[j].joints_count;
+
+    // Determine index stride
+    // This depends on vertex count rather than the stride specified in gltf
+    // since gltf assumes we have index buffer per primitive which is non optimal
+    const uint32_t indexStride =
+        !glTFParams->mProcessMeshlets ? (vertexCount > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t)) : sizeof(uint32_t);
+
+    uint32_t totalGeomSize = 0;
+    totalGeomSize += round_up(sizeof(Geometry), 16);
+    // Every level of detail has its own draw arguments for each primitive, the level table follows them
+    const uint32_t lodCount = min(glTFParams->mLodCount, (uint32_t)GEOMETRY_MAX_LODS - 1);
+    // Strand levels of detail of ProcessTFX are the first strands of the level 0 ranges, used when the mesh isn't simplified.
+    // Optimizing the mesh would reorder the indices and vertices.
+    uint32_t       strandLodCount = 0;
+    if (tressFXExtras.mLodCount > 1 && lodCount == 0)
+    {
+        if (glTFParams->mOptimizationFlags != MESH_OPTIMIZATION_FLAG_OFF || drawCount != 1 || tressFXExtras.mVertexCountPerStrand < 2)
+            LOGF(eWARNING, "Ignoring the strand levels of detail of %s, they need one primitive without mesh optimization", fileName);
+        else
+            strandLodCount = tressFXExtras.mLodCount - 1;
     }
+    const uint32_t tableLodCount = max(lodCount, strandLodCount);
+    totalGeomSize += round_up(drawCount * (tableLodCount + 1) * sizeof(IndirectDrawIndexArguments), 16);
+    if (tableLodCount > 0)
+        totalGeomSize += round_up((tableLodCount + 1) * sizeof(GeometryLod), 16);
 
-    *vertexCount = newVertCount;
-    meshopt_FreeScratchMemory();
-    tf_free(remap);
-}
+    uint32_t totalGeomDataSize = 0;
+    totalGeomDataSize += round_up(sizeof(GeometryData), 16);
+    totalGeomDataSize += round_up(jointCount * sizeof(mat4), 16);
+    totalGeomDataSize += round_up(jointCount * sizeof(uint32_t), 16);
+    totalGeomDataSize += round_up(userDataSize, 16);
 
-bool ProcessGLTF(AssetPipelineParams* assetParams, ProcessGLTFParams* glTFParams)
-{
-    VertexLayout* pVertexLayout = glTFParams->pVertexLayout;
-    ASSERT(pVertexLayout);
+    Geometry* geom = (Geometry*)tf_calloc(1, totalGeomSize);
+    ASSERT(geom);
 
-    bool error = false;
+    GeometryData* geomData = (GeometryData*)tf_calloc(1, totalGeomDataSize);
+    ASSERT(geomData);
 
-    // Get all gltf files
-    bstring* gltfFiles = NULL;
-    uint32_t gltfFileCount = 0;
+    geom->pDrawArgs = (IndirectDrawIndexArguments*)(geom + 1); //-V1027
 
-    if (assetParams->mPathMode == PROCESS_MODE_FILE)
+    if (jointCount > 0)
     {
-        arrpush(gltfFiles, bdynfromcstr(assetParams->mInFilePath));
+        geomData->pInverseBindPoses = (mat4*)(geomData + 1); // -V1027
+        geomData->pJointRemaps =
+            (uint32_t*)((uint8_t*)geomData->pInverseBindPoses + round_up(jointCount * sizeof(*geomData->pInverseBindPoses), 16));
     }
-    else
+
+    uint8_t* pUserData =
+        jointCount > 0 ? ((uint8_t*)geomData->pJointRemaps + round_up(jointCount * sizeof(uint32_t), 16)) : (uint8_t*)(geomData + 1);
+    if (userDataSize > 0)
     {
-        DirectorySearch(assetParams->mRDInput, NULL, "gltf", OnGLTFFind, (void*)&gltfFiles,
-                        assetParams->mPathMode == PROCESS_MODE_DIRECTORY_RECURSIVE);
+        geomData->pUserData = pUserData;
+        geomData->mUserDataSize = userDataSize;
+        glTFParams->pWriteExtrasCallback(&userDataSize, pUserData, glTFParams->pCallbackUserData);
     }
 
-    gltfFileCount = (uint32_t)arrlenu(gltfFiles);
-
-    for (uint32_t i = 0; i < gltfFileCount; ++i)
+    // Determine vertex stride for each binding
+    for (uint32_t attrIdx = 0; attrIdx < pVertexLayout->mAttribCount; ++attrIdx)
     {
-        const char* fileName = (char*)gltfFiles[i].data;
-
-        char newFileName[FS_MAX_PATH] = { 0 };
-        if (assetParams->mOutSubdir)
-        {
-            char extractedFileName[FS_MAX_PATH] = {};
-            fsGetPathFileName(fileName, extractedFileName);
-
-            strcat(extractedFileName, ".bin");
-            fsAppendPathComponent(assetParams->mOutSubdir, extractedFileName, newFileName);
-        }
-        else
-        {
-            fsReplacePathExtension(fileName, "bin", newFileName);
-        }
+        const VertexAttrib*    attr = &pVertexLayout->mAttribs[attrIdx];
+        const cgltf_attribute* cgltfAttr = vertexAttribs[attr->mSemantic];
 
-        if (!assetParams->mSettings.force && fsFileExist(assetParams->mRDOutput, newFileName))
+        if (!cgltfAttr)
         {
-            time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, fileName);
-            if (assetParams->mAdditionalModifiedTime != 0)
-                lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
-            time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, newFileName);
-
-            if (lastModified < lastProcessed)
+            if (glTFParams->mIgnoreMissingAttributes)
+                continue; // This attribute is not in the GLTF file, just ignore it
+            else
             {
-                LOGF(eINFO, "Skipping %s", fileName);
+                LOGF(eERROR, "Missing attribute at index %u of pVertexLayout", attrIdx);
+                error = true;
                 continue;
             }
         }
 
-        LOGF(eINFO, "Converting %s to TF custom binary file", fileName);
+        const uint32_t dstFormatSize = TinyImageFormat_BitSizeOfBlock(attr->mFormat) >> 3;
+        const uint32_t srcFormatSize = (uint32_t)cgltfAttr->data->stride; //-V522
 
-        FileStream file = {};
-        if (!fsOpenStreamFromPath(assetParams->mRDInput, fileName, FM_READ, &file))
-        {
-            LOGF(eERROR, "Failed to open gltf file %s", fileName);
-            error = true;
-            continue;
-        }
-
-        ssize_t fileSize = fsGetStreamFileSize(&file);
-        void*   fileData = tf_malloc(fileSize);
-
-        fsReadFromStream(&file, fileData, fileSize);
-
-        cgltf_options options = {};
-        cgltf_data*   data = NULL;
-        options.memory_alloc = [](void* user, cgltf_size size)
-        {
-            UNREF_PARAM(user);
-            return tf_malloc(size);
-        };
-        options.memory_free = [](void* user, void* ptr)
-        {
-            UNREF_PARAM(user);
-            tf_free(ptr);
-        };
-        options.rd = assetParams->mRDInput;
-        cgltf_result result = cgltf_parse(&options, fileData, fileSize, &data);
-        fsCloseStream(&file);
-
-        if (cgltf_result_success != result)
-        {
-            LOGF(eERROR, "Failed to parse gltf file %s with error %u", fileName, (uint32_t)result);
-            tf_free(fileData);
-            error = true;
-            continue;
-        }
+        const uint32_t thisAttrStride = dstFormatSize ? dstFormatSize : srcFormatSize;
+        ASSERT(vertexAttrStrides[attr->mSemantic] == 0);
+        vertexAttrStrides[attr->mSemantic] = thisAttrStride;
 
-#if defined(FORGE_DEBUG)
-        result = cgltf_validate(data);
-        if (cgltf_result_success != result)
-        {
-            LOGF(eWARNING, "GLTF validation finished with error %u for file %s", (uint32_t)result, fileName);
-        }
-#endif
+        // Compare vertex attrib format to the gltf attrib type
+        // Select a packing function if dst format is packed version
+        // Texcoords - Pack float2 to half2
+        // Directions - Pack float3 to float2 to unorm2x16 (Normal, Tangent)
+        // Position - No packing yet
+        const TinyImageFormat srcFormat = util_cgltf_type_to_image_format(cgltfAttr->data->type, cgltfAttr->data->component_type);
+        const TinyImageFormat dstFormat = attr->mFormat == TinyImageFormat_UNDEFINED ? srcFormat : attr->mFormat;
 
-        // Load buffers located in separate files (.bin) using our file system
-        for (uint32_t j = 0; j < data->buffers_count; ++j)
+        if (dstFormat != srcFormat)
         {
-            const char* uri = data->buffers[j].uri;
-
-            if (!uri || data->buffers[j].data)
+            // Select appropriate packing function which will be used when filling the vertex buffer
+            switch (cgltfAttr->type)
             {
-                continue;
+            case cgltf_attribute_type_texcoord:
+            {
+                if (sizeof(uint32_t) == dstFormatSize && sizeof(float[2]) == srcFormatSize)
+                    vertexPacking[attr->mSemantic] = util_pack_float2_to_half2;
+                // #TODO: Add more variations if needed
+                break;
             }
-
-            if (strncmp(uri, "data:", 5) != 0 && !strstr(uri, "://"))
+            case cgltf_attribute_type_normal:
+            case cgltf_attribute_type_tangent:
             {
-                char parent[FS_MAX_PATH] = { 0 };
-                fsGetParentPath(fileName, parent);
-                char path[FS_MAX_PATH] = { 0 };
-                fsAppendPathComponent(parent, uri, path);
-                FileStream fs = {};
-                if (fsOpenStreamFromPath(assetParams->mRDInput, path, FM_READ, &fs))
+                if (sizeof(uint32_t) == dstFormatSize && (sizeof(float[3]) == srcFormatSize || sizeof(float[4]) == srcFormatSize))
+                    vertexPacking[attr->mSemantic] = util_pack_float3_direction_to_half2;
+                // #TODO: Add more variations if needed
+                break;
+            }
+            case cgltf_attribute_type_joints:
+            {
+                if (srcFormatSize == sizeof(uint8_t) * 4 && dstFormatSize == sizeof(uint16_t) * 4)
+                    vertexPacking[attr->mSemantic] = util_unpack_uint8_to_uint16_joints;
+                else
                 {
-                    ASSERT(fsGetStreamFileSize(&fs) >= (ssize_t)data->buffers[j].size);
-                    data->buffers[j].data = tf_malloc(data->buffers[j].size);
-                    fsReadFromStream(&fs, data->buffers[j].data, data->buffers[j].size);
-                    fsCloseStream(&fs);
+                    LOGF(eERROR, "Joint size doesn't match");
+                    ASSERT(false);
                 }
+                break;
+            }
+            default:
+                break;
             }
         }
+    }
 
-        result = cgltf_load_buffers(&options, data, fileName);
-        if (cgltf_result_success != result)
-        {
-            LOGF(eERROR, "Failed to load buffers from gltf file %s with error %u", fileName, (uint32_t)result);
-            tf_free(fileData);
-            continue;
-        }
+    uint32_t shadowSize = 0;
+    shadowSize += sizeof(GeometryData::ShadowData);
+    shadowSize += indexCount * indexStride;
 
-        cgltf_attribute* vertexAttribs[MAX_SEMANTICS] = {};
+    for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+    {
+        // Only copy attribute count if we care about this attribute
+        if (vertexAttrStrides[s] == 0)
+            vertexAttribCount[s] = 0;
 
-        uint32_t indexCount = 0;
-        uint32_t vertexCount = 0;
-        uint32_t drawCount = 0;
-        uint32_t jointCount = 0;
-        uint32_t vertexAttribCount[MAX_SEMANTICS] = {};
+        shadowSize += vertexAttrStrides[s] * vertexAttribCount[s];
+    }
 
-        // Find number of traditional draw calls required to draw this piece of geometry
-        // Find total index count, total vertex count
-        for (uint32_t j = 0; j < data->meshes_count; ++j)
-        {
-            const cgltf_mesh* mesh = &data->meshes[j];
-            const uint32_t    meshExtrasLength = (uint32_t)(mesh->extras.end_offset - mesh->extras.start_offset);
-            if (glTFParams->pReadExtrasCallback && meshExtrasLength)
-            {
-                glTFParams->pReadExtrasCallback(j, (uint32_t)data->meshes_count, data->json + mesh->extras.start_offset, meshExtrasLength,
-                                                glTFParams->pCallbackUserData);
-            }
+    geomData->pShadow = (GeometryData::ShadowData*)tf_calloc(1, shadowSize);
+    geomData->pShadow->pIndices = geomData->pShadow + 1;
 
-            for (uint32_t p = 0; p < mesh->primitives_count; ++p)
-            {
-                const cgltf_primitive* prim = &mesh->primitives[p];
-                indexCount += (uint32_t)(prim->indices->count);
-                vertexCount += (uint32_t)(prim->attributes[0].data->count);
-                ++drawCount;
+    // Same strides as the ones used in the GPU
+    for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+    {
+        geomData->pShadow->mVertexStrides[s] = vertexAttrStrides[s];
+        geomData->pShadow->mAttributeCount[s] = vertexAttribCount[s];
+    }
 
-                for (uint32_t k = 0; k < prim->attributes_count; ++k)
-                {
-                    const uint32_t semanticIdx =
-                        (uint32_t)util_cgltf_attrib_type_to_semantic(prim->attributes[k].type, prim->attributes[k].index);
-                    ASSERT(semanticIdx < MAX_SEMANTICS);
-                    vertexAttribs[semanticIdx] = &prim->attributes[k];
-                    vertexAttribCount[semanticIdx] += (uint32_t)prim->attributes[k].data->count;
-                }
-            }
-        }
+    geomData->pShadow->pAttributes[SEMANTIC_POSITION] = (uint8_t*)geomData->pShadow->pIndices + (indexCount * indexStride);
 
-        // Request the size that the user will need to load it's custom fields
-        uint32_t userDataSize = 0;
-        if (glTFParams->pWriteExtrasCallback)
-            glTFParams->pWriteExtrasCallback(&userDataSize, NULL, glTFParams->pCallbackUserData);
+    for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
+        geomData->pShadow->pAttributes[s] = (uint8_t*)geomData->pShadow->pAttributes[s - 1] +
+                                            geomData->pShadow->mVertexStrides[s - 1] * geomData->pShadow->mAttributeCount[s - 1];
 
-        PackingFunction vertexPacking[MAX_SEMANTICS] = {};
-        uint32_t        vertexAttrStrides[MAX_SEMANTICS] = {};
+    ASSERT(((const char*)geomData->pShadow) + shadowSize ==
+           ((char*)geomData->pShadow->pAttributes[MAX_SEMANTICS - 1] +
+            geomData->pShadow->mVertexStrides[MAX_SEMANTICS - 1] * geomData->pShadow->mAttributeCount[MAX_SEMANTICS - 1]));
 
-        for (uint32_t j = 0; j < data->skins_count; ++j)
-            jointCount += (uint32_t)data->skins[j].joints_count;
+    COMPILE_ASSERT(TF_ARRAY_COUNT(geomData->pShadow->mVertexStrides) == TF_ARRAY_COUNT(geomData->pShadow->pAttributes));
+    for (uint32_t j = 1; j < TF_ARRAY_COUNT(geomData->pShadow->mVertexStrides); ++j)
+    {
+        // If the attribute is not present in the gltf file we just don't save anything
+        if (geomData->pShadow->mVertexStrides[j] == 0)
+            geomData->pShadow->pAttributes[j] = nullptr;
+    }
 
-        // Determine index stride
-        // This depends on vertex count rather than the stride specified in gltf
-        // since gltf assumes we have index buffer per primitive which is non optimal
-        const uint32_t indexStride =
-            !glTFParams->mProcessMeshlets ? (vertexCount > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t)) : sizeof(uint32_t);
+    geom->mDrawArgCount = drawCount;
+    geom->mIndexType = (sizeof(uint16_t) == indexStride) ? INDEX_TYPE_UINT16 : INDEX_TYPE_UINT32;
+    geomData->mJointCount = jointCount;
 
-        uint32_t totalGeomSize = 0;
-        totalGeomSize += round_up(sizeof(Geometry), 16);
-        totalGeomSize += round_up(drawCount * sizeof(IndirectDrawIndexArguments), 16);
+    indexCount = 0;
+    vertexCount = 0;
+    drawCount = 0;
 
-        uint32_t totalGeomDataSize = 0;
-        totalGeomDataSize += round_up(sizeof(GeometryData), 16);
-        totalGeomDataSize += round_up(jointCount * sizeof(mat4), 16);
-        totalGeomDataSize += round_up(jointCount * sizeof(uint32_t), 16);
-        totalGeomDataSize += round_up(userDataSize, 16);
+    // Load the remap joint indices generated in the offline process
+    uint32_t remapCount = 0;
+    for (uint32_t j = 0; j < data->skins_count; ++j)
+    {
+        const cgltf_skin* skin = &data->skins[j];
+        uint32_t          extrasSize = (uint32_t)(skin->extras.end_offset - skin->extras.start_offset);
+        if (extrasSize)
+        {
+            const char* jointRemaps = (const char*)data->json + skin->extras.start_offset;
+            jsmn_parser parser = {};
+            jsmntok_t*  tokens = (jsmntok_t*)tf_malloc((skin->joints_count + 1) * sizeof(jsmntok_t));
+            jsmn_parse(&parser, (const char*)jointRemaps, extrasSize, tokens, skin->joints_count + 1);
+            ASSERT(tokens[0].size == (int)skin->joints_count + 1);
+            cgltf_accessor_unpack_floats(skin->inverse_bind_matrices, (cgltf_float*)geomData->pInverseBindPoses,
+                                         skin->joints_count * sizeof(float[16]) / sizeof(float));
+            for (uint32_t r = 0; r < skin->joints_count; ++r)
+                geomData->pJointRemaps[remapCount + r] = atoi(jointRemaps + tokens[1 + r].start);
+            tf_free(tokens);
+        }
 
-        Geometry* geom = (Geometry*)tf_calloc(1, totalGeomSize);
-        ASSERT(geom);
+        remapCount += (uint32_t)skin->joints_count;
+    }
 
-        GeometryData* geomData = (GeometryData*)tf_calloc(1, totalGeomDataSize);
-        ASSERT(geomData);
+    geomData->mHair.mVertexCountPerStrand = tressFXExtras.mVertexCountPerStrand;
+    geomData->mHair.mGuideCountPerStrand = tressFXExtras.mGuideCount;
+    geomData->mHair.mGuidesFirst = tressFXExtras.mGuidesFirst;
+    geomData->mHair.mQuantizedPositions = tressFXExtras.mQuantizedPositions;
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        geomData->mHair.mPositionMin[c] = tressFXExtras.mPositionMin[c];
+        geomData->mHair.mPositionExtent[c] = tressFXExtras.mPositionMax[c] - tressFXExtras.mPositionMin[c];
+    }
 
-        geom->pDrawArgs = (IndirectDrawIndexArguments*)(geom + 1); //-V1027
+    const bool optimize = glTFParams->mOptimizationFlags != MESH_OPTIMIZATION_FLAG_OFF;
 
-        if (jointCount > 0)
-        {
-            geomData->pInverseBindPoses = (mat4*)(geomData + 1); // -V1027
-            geomData->pJointRemaps =
-                (uint32_t*)((uint8_t*)geomData->pInverseBindPoses + round_up(jointCount * sizeof(*geomData->pInverseBindPoses), 16));
-        }
+    GLTFPrimitiveTask*     pPrimTasks = (GLTFPrimitiveTask*)tf_calloc(max(geom->mDrawArgCount, 1u), sizeof(GLTFPrimitiveTask));
+    AssetPipelineTaskGroup group = {};
+    uint32_t               primCount = 0;
+    uint32_t               uncompactedVertexCount = 0;
+    bool                   validPrimitives = true;
 
-        uint8_t* pUserData =
-            jointCount > 0 ? ((uint8_t*)geomData->pJointRemaps + round_up(jointCount * sizeof(uint32_t), 16)) : (uint8_t*)(geomData + 1);
-        if (userDataSize > 0)
-        {
-            geomData->pUserData = pUserData;
-            geomData->mUserDataSize = userDataSize;
-            glTFParams->pWriteExtrasCallback(&userDataSize, pUserData, glTFParams->pCallbackUserData);
-        }
+    // The mesh optimizations read float positions
+    if (optimize && tressFXExtras.mQuantizedPositions)
+    {
+        LOGF(eERROR, "Cannot optimize %s, its TressFX positions are 16 bit.", fileName);
+        validPrimitives = false;
+    }
 
-        // Determine vertex stride for each binding
-        for (uint32_t attrIdx = 0; attrIdx < pVertexLayout->mAttribCount; ++attrIdx)
+    for (uint32_t j = 0; j < data->meshes_count; ++j)
+    {
+        for (uint32_t p = 0; p < data->meshes[j].primitives_count; ++p)
         {
-            const VertexAttrib*    attr = &pVertexLayout->mAttribs[attrIdx];
-            const cgltf_attribute* cgltfAttr = vertexAttribs[attr->mSemantic];
-
-            if (!cgltfAttr)
+            const cgltf_primitive* prim = &data->meshes[j].primitives[p];
+            GLTFPrimitiveTask*     pPrimTask = &pPrimTasks[primCount];
+
+            pPrimTask->pAssetParams = assetParams;
+            pPrimTask->pFileName = fileName;
+            pPrimTask->pGLTFParams = glTFParams;
+            pPrimTask->pPrimitive = prim;
+            pPrimTask->pGeomData = geomData;
+            pPrimTask->pVertexPacking = vertexPacking;
+            pPrimTask->mIndexType = (IndexType)geom->mIndexType;
+            pPrimTask->mIndexOffset = indexCount;
+            pPrimTask->mVertexOffset = uncompactedVertexCount;
+            pPrimTask->mLodCount = lodCount;
+            pPrimTask->pScratchPool = pTask->pScratchPool;
+            pPrimTask->pGroup = &group;
+
+            for (uint32_t a = 0; a < prim->attributes_count; ++a)
             {
-                if (glTFParams->mIgnoreMissingAttributes)
-                    continue; // This attribute is not in the GLTF file, just ignore it
-                else
-                {
-                    LOGF(eERROR, "Missing attribute at index %u of pVertexLayout", attrIdx);
-                    error = true;
-                    continue;
-                }
+                if (util_cgltf_attrib_type_to_semantic(prim->attributes[a].type, prim->attributes[a].index) == SEMANTIC_POSITION)
+                    pPrimTask->pPositionAttr = &prim->attributes[a];
             }
 
-            const uint32_t dstFormatSize = TinyImageFormat_BitSizeOfBlock(attr->mFormat) >> 3;
-            const uint32_t srcFormatSize = (uint32_t)cgltfAttr->data->stride; //-V522
-
-            const uint32_t thisAttrStride = dstFormatSize ? dstFormatSize : srcFormatSize;
-            ASSERT(vertexAttrStrides[attr->mSemantic] == 0);
-            vertexAttrStrides[attr->mSemantic] = thisAttrStride;
-
-            // Compare vertex attrib format to the gltf attrib type
-            // Select a packing function if dst format is packed version
-            // Texcoords - Pack float2 to half2
-            // Directions - Pack float3 to float2 to unorm2x16 (Normal, Tangent)
-            // Position - No packing yet
-            const TinyImageFormat srcFormat = util_cgltf_type_to_image_format(cgltfAttr->data->type, cgltfAttr->data->component_type);
-            const TinyImageFormat dstFormat = attr->mFormat == TinyImageFormat_UNDEFINED ? srcFormat : attr->mFormat;
-
-            if (dstFormat != srcFormat)
+            if (glTFParams->mProcessMeshlets)
             {
-                // Select appropriate packing function which will be used when filling the vertex buffer
-                switch (cgltfAttr->type)
+                if (indexStride != 4)
                 {
-                case cgltf_attribute_type_texcoord:
-                {
-                    if (sizeof(uint32_t) == dstFormatSize && sizeof(float[2]) == srcFormatSize)
-                        vertexPacking[attr->mSemantic] = util_pack_float2_to_half2;
-                    // #TODO: Add more variations if needed
-                    break;
+                    LOGF(eERROR, "Cannot create meshlet when index type isn't 32-bit.");
+                    validPrimitives = false;
                 }
-                case cgltf_attribute_type_normal:
-                case cgltf_attribute_type_tangent:
+                else if (!pPrimTask->pPositionAttr || pPrimTask->pPositionAttr->data->stride != 12)
                 {
-                    if (sizeof(uint32_t) == dstFormatSize && (sizeof(float[3]) == srcFormatSize || sizeof(float[4]) == srcFormatSize))
-                        vertexPacking[attr->mSemantic] = util_pack_float3_direction_to_half2;
-                    // #TODO: Add more variations if needed
-                    break;
+                    LOGF(eERROR, "Cannot create meshlet when positions attribute is missing or layout is not float3.");
+                    validPrimitives = false;
                 }
-                case cgltf_attribute_type_joints:
+            }
+
+            if (lodCount > 0)
+            {
+                const cgltf_attribute* pos_attr = pPrimTask->pPositionAttr;
+                if (!pos_attr || pos_attr->data->type != cgltf_type_vec3 || pos_attr->data->component_type != cgltf_component_type_r_32f ||
+                    geomData->pShadow->mVertexStrides[SEMANTIC_POSITION] < sizeof(float[3]) || vertexPacking[SEMANTIC_POSITION])
                 {
-                    if (srcFormatSize == sizeof(uint8_t) * 4 && dstFormatSize == sizeof(uint16_t) * 4)
-                        vertexPacking[attr->mSemantic] = util_unpack_uint8_to_uint16_joints;
-                    else
-                    {
-                        LOGF(eERROR, "Joint size doesn't match");
-                        ASSERT(false);
-                    }
-                    break;
-                }
-                default:
-                    break;
+                    LOGF(eERROR, "Cannot create levels of detail when positions attribute is missing or layout is not float3.");
+                    validPrimitives = false;
                 }
             }
+
+            indexCount += (uint32_t)(prim->indices->count);
+            uncompactedVertexCount += (uint32_t)(prim->attributes[0].data->count);
+            ++primCount;
         }
+    }
+
+    // Primitives only run concurrently when each one fills its own range of every vertex buffer. When some primitive misses an
+    // attribute the ranges of that buffer overlap, so primitives are processed in order directly at their compacted offsets.
+    bool parallelPrimitives = pTask->mThreadSystem != NULL && primCount > 1 && validPrimitives;
+    for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+    {
+        if (geomData->pShadow->mVertexStrides[s] && geomData->pShadow->mAttributeCount[s] != uncompactedVertexCount)
+            parallelPrimitives = false;
+    }
+    // Meshlets read the positions with the stride of the gltf accessor
+    if (glTFParams->mProcessMeshlets && geomData->pShadow->mVertexStrides[SEMANTIC_POSITION] != sizeof(float3))
+        parallelPrimitives = false;
 
-        uint32_t shadowSize = 0;
-        shadowSize += sizeof(GeometryData::ShadowData);
-        shadowSize += indexCount * indexStride;
+    if (parallelPrimitives)
+    {
+        // The calling thread might be a worker of the same thread system (one task per file)
+        BeginAssetPipelineTaskGroup(&group, primCount);
+        threadSystemAddTaskGroup(pTask->mThreadSystem, ProcessGLTFPrimitiveTask, primCount, pPrimTasks);
+        WaitAssetPipelineTaskGroup(pTask->mThreadSystem, &group);
+    }
 
+    if (optimize)
+    {
         for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
         {
-            // Only copy attribute count if we care about this attribute
-            if (vertexAttrStrides[s] == 0)
-                vertexAttribCount[s] = 0;
-
-            shadowSize += vertexAttrStrides[s] * vertexAttribCount[s];
+            geomData->pShadow->mAttributeCount[s] = 0;
         }
+    }
 
-        geomData->pShadow = (GeometryData::ShadowData*)tf_calloc(1, shadowSize);
-        geomData->pShadow->pIndices = geomData->pShadow + 1;
+    indexCount = 0;
+    uint32_t compactedEnd = 0;
+    for (uint32_t i = 0; i < primCount && validPrimitives; ++i)
+    {
+        GLTFPrimitiveTask*     pPrimTask = &pPrimTasks[i];
+        const cgltf_primitive* prim = pPrimTask->pPrimitive;
+        const uint32_t         primVertexCount = (uint32_t)prim->attributes[0].data->count;
 
-        // Same strides as the ones used in the GPU
-        for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+        if (!parallelPrimitives)
         {
-            geomData->pShadow->mVertexStrides[s] = vertexAttrStrides[s];
-            geomData->pShadow->mAttributeCount[s] = vertexAttribCount[s];
+            pPrimTask->mVertexOffset = vertexCount;
+            ProcessGLTFPrimitive(pPrimTask);
         }
 
-        geomData->pShadow->pAttributes[SEMANTIC_POSITION] = (uint8_t*)geomData->pShadow->pIndices + (indexCount * indexStride);
+        pTask->mPackTime += pPrimTask->mPackTime;
+        pTask->mOptimizeTime += pPrimTask->mOptimizeTime;
+        pTask->mLodTime += pPrimTask->mLodTime;
+        pTask->mMeshletTime += pPrimTask->mMeshletTime;
+        pPrimTask->mCompactedVertexOffset = vertexCount;
 
-        for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
-            geomData->pShadow->pAttributes[s] = (uint8_t*)geomData->pShadow->pAttributes[s - 1] +
-                                                geomData->pShadow->mVertexStrides[s - 1] * geomData->pShadow->mAttributeCount[s - 1];
+        /************************************************************************/
+        // Move the optimized vertices to their compacted offset
+        /************************************************************************/
+        if (optimize)
+        {
+            for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+            {
+                const uint32_t stride = geomData->pShadow->mVertexStrides[s];
+                if (stride > 0)
+                {
+                    // Move every vertex of the range, the ones past the optimized count are also written by the serial path
+                    uint8_t* pAttribute = (uint8_t*)geomData->pShadow->pAttributes[s];
+                    if (pPrimTask->mVertexOffset != vertexCount)
+                        memmove(pAttribute + (uint64_t)vertexCount * stride, pAttribute + (uint64_t)pPrimTask->mVertexOffset * stride,
+                                (size_t)primVertexCount * stride);
 
-        ASSERT(((const char*)geomData->pShadow) + shadowSize ==
-               ((char*)geomData->pShadow->pAttributes[MAX_SEMANTICS - 1] +
-                geomData->pShadow->mVertexStrides[MAX_SEMANTICS - 1] * geomData->pShadow->mAttributeCount[MAX_SEMANTICS - 1]));
+                    geomData->pShadow->mAttributeCount[s] += pPrimTask->mOptimizedVertexCount;
+                }
+            }
+        }
+        compactedEnd = max(compactedEnd, vertexCount + primVertexCount);
+
+        /************************************************************************/
+        // Fill draw arguments for this primitive
+        /************************************************************************/
+        geom->pDrawArgs[drawCount].mIndexCount = (uint32_t)prim->indices->count;
+        geom->pDrawArgs[drawCount].mInstanceCount = 1;
+        geom->pDrawArgs[drawCount].mStartIndex = indexCount;
+        geom->pDrawArgs[drawCount].mStartInstance = 0;
+        // Since we already offset indices when creating the index buffer, vertex offset will be zero
+        // With this approach, we can draw everything in one draw call or use the traditional draw per subset without the
+        // need for changing shader code
+        geom->pDrawArgs[drawCount].mVertexOffset = 0;
+
+        if (glTFParams->mProcessMeshlets)
+        {
+            AppendPrimitiveMeshlets(&geom->meshlets, &pPrimTask->mLevels[0], vertexCount);
+        }
 
-        COMPILE_ASSERT(TF_ARRAY_COUNT(geomData->pShadow->mVertexStrides) == TF_ARRAY_COUNT(geomData->pShadow->pAttributes));
-        for (uint32_t j = 1; j < TF_ARRAY_COUNT(geomData->pShadow->mVertexStrides); ++j)
+        if (sizeof(uint16_t) == indexStride)
         {
-            // If the attribute is not present in the gltf file we just don't save anything
-            if (geomData->pShadow->mVertexStrides[j] == 0)
-                geomData->pShadow->pAttributes[j] = nullptr;
+            for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
+                ((uint16_t*)geomData->pShadow->pIndices)[indexCount + idx] += (uint16_t)vertexCount;
+        }
+        else
+        {
+            for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
+                ((uint32_t*)geomData->pShadow->pIndices)[indexCount + idx] += vertexCount;
         }
 
-        geom->mDrawArgCount = drawCount;
-        geom->mIndexType = (sizeof(uint16_t) == indexStride) ? INDEX_TYPE_UINT16 : INDEX_TYPE_UINT32;
-        geomData->mJointCount = jointCount;
+        indexCount += (uint32_t)(prim->indices->count);
+        vertexCount += pPrimTask->mOptimizedVertexCount;
 
-        indexCount = 0;
-        vertexCount = 0;
-        drawCount = 0;
+        ++drawCount;
+    }
 
-        // Load the remap joint indices generated in the offline process
-        uint32_t remapCount = 0;
-        for (uint32_t j = 0; j < data->skins_count; ++j)
+    // Primitives processed in order never write past the last compacted range, clear what the moves left behind there
+    if (parallelPrimitives && optimize)
+    {
+        for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
         {
-            const cgltf_skin* skin = &data->skins[j];
-            uint32_t          extrasSize = (uint32_t)(skin->extras.end_offset - skin->extras.start_offset);
-            if (extrasSize)
-            {
-                const char* jointRemaps = (const char*)data->json + skin->extras.start_offset;
-                jsmn_parser parser = {};
-                jsmntok_t*  tokens = (jsmntok_t*)tf_malloc((skin->joints_count + 1) * sizeof(jsmntok_t));
-                jsmn_parse(&parser, (const char*)jointRemaps, extrasSize, tokens, skin->joints_count + 1);
-                ASSERT(tokens[0].size == (int)skin->joints_count + 1);
-                cgltf_accessor_unpack_floats(skin->inverse_bind_matrices, (cgltf_float*)geomData->pInverseBindPoses,
-                                             skin->joints_count * sizeof(float[16]) / sizeof(float));
-                for (uint32_t r = 0; r < skin->joints_count; ++r)
-                    geomData->pJointRemaps[remapCount + r] = atoi(jointRemaps + tokens[1 + r].start);
-                tf_free(tokens);
-            }
-
-            remapCount += (uint32_t)skin->joints_count;
+            const uint32_t stride = geomData->pShadow->mVertexStrides[s];
+            if (stride > 0)
+                memset((uint8_t*)geomData->pShadow->pAttributes[s] + (uint64_t)compactedEnd * stride, 0,
+                       (size_t)(uncompactedVertexCount - compactedEnd) * stride);
         }
+    }
 
-        // Load the tressfx specific data generated in the offline process
-        if (stricmp(data->asset.generator, "tressfx") == 0)
+    /************************************************************************/
+    // Append the simplified levels after the full resolution indices and meshlets
+    /************************************************************************/
+    if (lodCount > 0 && validPrimitives)
+    {
+        uint32_t lodIndexCount = 0;
+        for (uint32_t i = 0; i < primCount; ++i)
         {
-            // { "mVertexCountPerStrand" : "16", "mGuideCountPerStrand" : "3456" }
-            uint32_t    extrasSize = (uint32_t)(data->asset.extras.end_offset - data->asset.extras.start_offset);
-            const char* json = data->json + data->asset.extras.start_offset;
-            jsmn_parser parser = {};
-            jsmntok_t   tokens[5] = {};
-            jsmn_parse(&parser, (const char*)json, extrasSize, tokens, TF_ARRAY_COUNT(tokens));
-            geomData->mHair.mVertexCountPerStrand = atoi(json + tokens[2].start);
-            geomData->mHair.mGuideCountPerStrand = atoi(json + tokens[4].start);
+            for (uint32_t l = 1; l <= lodCount; ++l)
+                lodIndexCount += (uint32_t)arrlenu(pPrimTasks[i].mLevels[l].pIndices);
         }
 
-        if (glTFParams->mOptimizationFlags != MESH_OPTIMIZATION_FLAG_OFF)
+        // The vertex attributes follow the indices in the shadow buffer, make room for the new indices in front of them
+        if (lodIndexCount > 0)
         {
+            const uint32_t            indexSize = indexCount * indexStride;
+            const uint32_t            lodIndexSize = lodIndexCount * indexStride;
+            GeometryData::ShadowData* pOldShadow = geomData->pShadow;
+            GeometryData::ShadowData* pNewShadow = (GeometryData::ShadowData*)tf_calloc(1, shadowSize + lodIndexSize);
+            *pNewShadow = *pOldShadow;
+            pNewShadow->pIndices = pNewShadow + 1;
+            memcpy(pNewShadow->pIndices, pOldShadow->pIndices, indexSize);
+
+            const uint8_t* pOldAttributes = (const uint8_t*)pOldShadow->pIndices + indexSize;
+            uint8_t*       pNewAttributes = (uint8_t*)pNewShadow->pIndices + indexSize + lodIndexSize;
+            memcpy(pNewAttributes, pOldAttributes, shadowSize - sizeof(GeometryData::ShadowData) - indexSize);
             for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
             {
-                geomData->pShadow->mAttributeCount[s] = 0;
+                if (pOldShadow->pAttributes[s])
+                    pNewShadow->pAttributes[s] = pNewAttributes + ((const uint8_t*)pOldShadow->pAttributes[s] - pOldAttributes);
             }
+
+            tf_free(pOldShadow);
+            geomData->pShadow = pNewShadow;
+            shadowSize += lodIndexSize;
         }
 
-        for (uint32_t j = 0; j < data->meshes_count; ++j)
+        geom->mLodCount = lodCount + 1;
+        geom->pLods = (GeometryLod*)((uint8_t*)geom->pDrawArgs + round_up(geom->mLodCount * primCount * sizeof(*geom->pDrawArgs), 16));
+        geom->pLods[0].mDrawArgOffset = 0;
+        geom->pLods[0].mMeshletOffset = 0;
+        geom->pLods[0].mMeshletCount = (uint32_t)geom->meshlets.mMeshletCount;
+        geom->pLods[0].mError = 0.0f;
+
+        for (uint32_t l = 1; l <= lodCount; ++l)
         {
-            for (uint32_t p = 0; p < data->meshes[j].primitives_count; ++p)
-            {
-                const cgltf_primitive* prim = &data->meshes[j].primitives[p];
+            GeometryLod* pLod = &geom->pLods[l];
+            pLod->mDrawArgOffset = l * primCount;
+            pLod->mMeshletOffset = (uint32_t)geom->meshlets.mMeshletCount;
+            pLod->mError = 0.0f;
 
-                /************************************************************************/
-                // Fill index buffer for this primitive
-                /************************************************************************/
-                if (sizeof(uint16_t) == indexStride)
-                {
-                    uint16_t* dst = (uint16_t*)geomData->pShadow->pIndices;
-                    for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
-                        dst[indexCount + idx] = (uint16_t)cgltf_accessor_read_index(prim->indices, idx);
-                }
-                else
-                {
-                    uint32_t* dst = (uint32_t*)geomData->pShadow->pIndices;
-                    for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
-                        dst[indexCount + idx] = (uint32_t)cgltf_accessor_read_index(prim->indices, idx);
-                }
+            for (uint32_t i = 0; i < primCount; ++i)
+            {
+                GLTFPrimitiveTask*          pPrimTask = &pPrimTasks[i];
+                GLTFPrimitiveLevel*         pLevel = &pPrimTask->mLevels[l];
+                IndirectDrawIndexArguments* pDrawArgs = &geom->pDrawArgs[pLod->mDrawArgOffset + i];
+                const uint32_t              levelIndexCount = (uint32_t)arrlenu(pLevel->pIndices);
 
-                /************************************************************************/
-                // Fill vertex buffers for this primitive
-                /************************************************************************/
-                cgltf_attribute* pos_attr = NULL;
-                for (uint32_t a = 0; a < prim->attributes_count; ++a)
+                if (pLevel->pIndices)
                 {
-                    cgltf_attribute* attr = &prim->attributes[a];
-                    const uint32_t   semanticIdx = (uint32_t)util_cgltf_attrib_type_to_semantic(attr->type, attr->index);
-                    ASSERT(semanticIdx < TF_ARRAY_COUNT(geomData->pShadow->pAttributes));
-
-                    if (semanticIdx == SEMANTIC_POSITION)
-                        pos_attr = attr;
-
-                    // TODO: this should probably be an ASSERT, we don't want to loose data when using pShadow
-                    if (geomData->pShadow->mVertexStrides[semanticIdx] != 0)
+                    const uint32_t offset = pPrimTask->mCompactedVertexOffset;
+                    if (sizeof(uint16_t) == indexStride)
                     {
-                        const uint32_t stride = geomData->pShadow->mVertexStrides[semanticIdx];
-
-                        const uint8_t* src =
-                            (uint8_t*)attr->data->buffer_view->buffer->data + attr->data->offset + attr->data->buffer_view->offset;
-                        uint8_t* dst = (uint8_t*)geomData->pShadow->pAttributes[semanticIdx] + (uint64_t)vertexCount * stride;
-
-                        // For now we just copy attributes to it's own buffer, in case of interleaved attributes we pack them in the
-                        // ResourceLoader during load
-                        // TODO: Consider adding an option to make the attributes interleaved here in the AssetPipeline so that we don't
-                        // have to do it in runtime.
-                        //       The inconvenience in that case would be that in order to get the pShadow data we would have to unpack the
-                        //       interleaved attributes, another option would be to store interleaved buffers AND pShadow buffers (duplicate
-                        //       some data). If we duplicate data would be better to only store pShadow data for the meshes that require it
-                        //       rather than all of them, that would require more configuration parameters per mesh while running the
-                        //       AssetPipeline.
-                        if (vertexPacking[semanticIdx])
-                            vertexPacking[semanticIdx]((uint32_t)attr->data->count, (uint32_t)attr->data->stride, stride, 0, src, dst);
-                        else
-                            memcpy(dst, src, attr->data->count * attr->data->stride);
+                        for (uint32_t idx = 0; idx < levelIndexCount; ++idx)
+                            ((uint16_t*)geomData->pShadow->pIndices)[indexCount + idx] = (uint16_t)(pLevel->pIndices[idx] + offset);
                     }
-                }
-
-                /************************************************************************/
-                // Optimize mesh
-                /************************************************************************/
-                uint32_t optimizedVertexCount = (uint32_t)prim->attributes[0].data->count;
-                if (glTFParams->mOptimizationFlags != MESH_OPTIMIZATION_FLAG_OFF)
-                {
-                    geomOptimize(geomData, MESH_OPTIMIZATION_FLAG_ALL, (IndexType)geom->mIndexType, indexCount,
-                                 (uint32_t)(prim->indices->count), vertexCount, &optimizedVertexCount);
-
-                    for (uint32_t s = 0; s < MAX_SEMANTICS; ++s)
+                    else
                     {
-                        if (geomData->pShadow->mVertexStrides[s] > 0)
-                        {
-                            geomData->pShadow->mAttributeCount[s] += optimizedVertexCount;
-                        }
+                        for (uint32_t idx = 0; idx < levelIndexCount; ++idx)
+                            ((uint32_t*)geomData->pShadow->pIndices)[indexCount + idx] = pLevel->pIndices[idx] + offset;
                     }
-                }
 
-                /************************************************************************/
-                // Fill draw arguments for this primitive
-                /************************************************************************/
-                geom->pDrawArgs[drawCount].mIndexCount = (uint32_t)prim->indices->count;
-                geom->pDrawArgs[drawCount].mInstanceCount = 1;
-                geom->pDrawArgs[drawCount].mStartIndex = indexCount;
-                geom->pDrawArgs[drawCount].mStartInstance = 0;
-                // Since we already offset indices when creating the index buffer, vertex offset will be zero
-                // With this approach, we can draw everything in one draw call or use the traditional draw per subset without the
-                // need for changing shader code
-                geom->pDrawArgs[drawCount].mVertexOffset = 0;
-
-                if (glTFParams->mProcessMeshlets)
+                    pDrawArgs->mIndexCount = levelIndexCount;
+                    pDrawArgs->mInstanceCount = 1;
+                    pDrawArgs->mStartIndex = indexCount;
+                    pDrawArgs->mStartInstance = 0;
+                    pDrawArgs->mVertexOffset = 0;
+                    indexCount += levelIndexCount;
+                    arrfree(pLevel->pIndices);
+                }
+                else
                 {
-                    if (indexStride != 4)
-                    {
-                        LOGF(eERROR, "Cannot create meshlet when index type isn't 32-bit.");
-                        error = true;
-                        break;
-                    }
-
-                    if (!pos_attr || pos_attr->data->stride != 12)
-                    {
-                        LOGF(eERROR, "Cannot create meshlet when positions attribute is missing or layout is not float3.");
-                        error = true;
-                        break;
-                    }
-
-                    float3* positions =
-                        (float3*)((uint8_t*)geomData->pShadow->pAttributes[SEMANTIC_POSITION] + vertexCount * pos_attr->data->stride);
-
-                    const uint64_t maxVertices = (uint64_t)glTFParams->mNumMaxVertices;
-                    const uint64_t maxTriangles = (uint64_t)glTFParams->mNumMaxTriangles;
-                    // 0.0 had better results overall
-                    const float    coneWeight = 0.0f;
-
-                    Meshlet*     subMeshlets = NULL;
-                    MeshletData* meshletsData = NULL;
-                    // indices for positions
-                    uint*        meshletVertices = NULL;
-                    uint8_t*     meshletTriangles = NULL;
-
-                    buildMeshlets((uint32_t*)geomData->pShadow->pIndices + indexCount, prim->indices->count, positions,
-                                  pos_attr->data->count, pos_attr->data->stride, maxVertices, maxTriangles, coneWeight, &meshletVertices,
-                                  &meshletTriangles, &subMeshlets, &meshletsData);
-
-                    arrsetlen(geom->meshlets.mVertices, geom->meshlets.mVertexCount + arrlenu(meshletVertices));
-                    for (uint64_t index_id = 0; index_id < arrlenu(meshletVertices); ++index_id)
-                    {
-                        geom->meshlets.mVertices[geom->meshlets.mVertexCount + index_id] = meshletVertices[index_id] + vertexCount;
-                    }
-
-                    arrsetlen(geom->meshlets.mTriangles, geom->meshlets.mTriangleCount + arrlenu(meshletTriangles));
-                    memcpy(geom->meshlets.mTriangles + geom->meshlets.mTriangleCount, meshletTriangles,
-                           arrlenu(meshletTriangles) * sizeof *meshletTriangles);
+                    // This primitive couldn't be simplified further, draw the indices of the previous level
+                    *pDrawArgs = geom->pDrawArgs[pLod->mDrawArgOffset - primCount + i];
+                }
 
-                    arrsetlen(geom->meshlets.mMeshletsData, geom->meshlets.mMeshletCount + arrlenu(subMeshlets));
-                    memcpy((void*)(geom->meshlets.mMeshletsData + geom->meshlets.mMeshletCount), meshletsData, //-V595
-                           arrlenu(subMeshlets) * sizeof *meshletsData);
+                pLod->mError = max(pLod->mError, pLevel->mError);
 
-                    arrsetlen(geom->meshlets.mMeshlets, geom->meshlets.mMeshletCount + arrlenu(subMeshlets));
-                    memcpy(geom->meshlets.mMeshlets + geom->meshlets.mMeshletCount, subMeshlets,
-                           arrlenu(subMeshlets) * sizeof *subMeshlets);
+                if (glTFParams->mProcessMeshlets && glTFParams->mLodMeshlets)
+                {
+                    AppendPrimitiveMeshlets(&geom->meshlets, pLevel, pPrimTask->mCompactedVertexOffset);
+                }
+            }
 
-                    for (uint64_t meshlet_id = 0; meshlet_id < arrlenu(subMeshlets); ++meshlet_id)
-                    {
-                        geom->meshlets.mMeshlets[geom->meshlets.mMeshletCount + meshlet_id].triangleOffset +=
-                            (uint)geom->meshlets.mTriangleCount;
-                        geom->meshlets.mMeshlets[geom->meshlets.mMeshletCount + meshlet_id].vertexOffset +=
-                            (uint)geom->meshlets.mVertexCount;
-                    }
+            pLod->mMeshletCount = (uint32_t)geom->meshlets.mMeshletCount - pLod->mMeshletOffset;
+        }
+    }
+    else if (strandLodCount > 0 && validPrimitives)
+    {
+        // Strands are ordered guides first and spread over the asset, a level is the first strands of the level 0 indices and vertices
+        const uint32_t strandIndexCount = 6 * (tressFXExtras.mVertexCountPerStrand - 1);
+        geom->mLodCount = strandLodCount + 1;
+        geom->pLods = (GeometryLod*)((uint8_t*)geom->pDrawArgs + round_up(geom->mLodCount * primCount * sizeof(*geom->pDrawArgs), 16));
+        for (uint32_t l = 0; l <= strandLodCount; ++l)
+        {
+            GeometryLod* pLod = &geom->pLods[l];
+            pLod->mDrawArgOffset = l;
+            pLod->mMeshletOffset = 0;
+            pLod->mMeshletCount = l == 0 ? (uint32_t)geom->meshlets.mMeshletCount : 0;
+            pLod->mError = 0.0f;
+
+            geom->pDrawArgs[l] = geom->pDrawArgs[0];
+            geom->pDrawArgs[l].mIndexCount = min(tressFXExtras.mLodStrandCounts[l] * strandIndexCount, geom->pDrawArgs[0].mIndexCount);
+        }
+    }
 
-                    geom->meshlets.mVertexCount += arrlenu(meshletVertices);
-                    geom->meshlets.mTriangleCount += arrlenu(meshletTriangles);
-                    geom->meshlets.mMeshletCount += arrlenu(subMeshlets);
+    tf_free(pPrimTasks);
 
-                    arrfree(subMeshlets);
-                    arrfree(meshletsData);
-                    arrfree(meshletVertices);
-                    arrfree(meshletTriangles);
-                }
+    geom->mIndexCount = indexCount;
+    geom->mVertexCount = vertexCount;
 
-                if (sizeof(uint16_t) == indexStride)
-                {
-                    for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
-                        ((uint16_t*)geomData->pShadow->pIndices)[indexCount + idx] += (uint16_t)vertexCount;
-                }
-                else
-                {
-                    for (uint32_t idx = 0; idx < prim->indices->count; ++idx)
-                        ((uint32_t*)geomData->pShadow->pIndices)[indexCount + idx] += vertexCount;
-                }
+    // The bounds of all levels share the quantization range so they are quantized once every level appended its meshlets
+    if (glTFParams->mQuantizeMeshletData && geom->meshlets.mMeshletCount)
+        QuantizeMeshletData(geom);
 
-                indexCount += (uint32_t)(prim->indices->count);
-                vertexCount += optimizedVertexCount;
+    scope = BeginAssetPipelineScope(assetParams, "glTF write", fileName);
+    uint64_t outputSize = 0;
 
-                ++drawCount;
-            }
+    // Tighten the vertex attribute buffers
+    if (glTFParams->mOptimizationFlags != MESH_OPTIMIZATION_FLAG_OFF)
+    {
+        size_t largestSizedAttribute = 0;
+        for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
+        {
+            largestSizedAttribute =
+                max(largestSizedAttribute, (size_t)geomData->pShadow->mVertexStrides[s] * geomData->pShadow->mAttributeCount[s]);
         }
+        void* tempStagingBuffer = tf_malloc(largestSizedAttribute);
 
-        geom->mIndexCount = indexCount;
-        geom->mVertexCount = vertexCount;
-
-        // Tighten the vertex attribute buffers
-        if (glTFParams->mOptimizationFlags != MESH_OPTIMIZATION_FLAG_OFF)
+        for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
         {
-            size_t largestSizedAttribute = 0;
-            for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
+            size_t size = (size_t)geomData->pShadow->mVertexStrides[s] * geomData->pShadow->mAttributeCount[s];
+            if (size > 0)
             {
-                largestSizedAttribute =
-                    max(largestSizedAttribute, (size_t)geomData->pShadow->mVertexStrides[s] * geomData->pShadow->mAttributeCount[s]);
+                memcpy(tempStagingBuffer, geomData->pShadow->pAttributes[s], size);
             }
-            void* tempStagingBuffer = tf_malloc(largestSizedAttribute);
-
-            for (uint32_t s = SEMANTIC_POSITION + 1; s < MAX_SEMANTICS; ++s)
-            {
-                size_t size = (size_t)geomData->pShadow->mVertexStrides[s] * geomData->pShadow->mAttributeCount[s];
-                if (size > 0)
-                {
-                    memcpy(tempStagingBuffer, geomData->pShadow->pAttributes[s], size);
-                }
 
-                geomData->pShadow->pAttributes[s] = (uint8_t*)geomData->pShadow->pAttributes[s - 1] +
-                                                    geomData->pShadow->mVertexStrides[s - 1] * geomData->pShadow->mAttributeCount[s - 1];
+            geomData->pShadow->pAttributes[s] = (uint8_t*)geomData->pShadow->pAttributes[s - 1] +
+                                                geomData->pShadow->mVertexStrides[s - 1] * geomData->pShadow->mAttributeCount[s - 1];
 
-                if (size > 0)
-                {
-                    memcpy(geomData->pShadow->pAttributes[s], tempStagingBuffer, size);
-                }
+            if (size > 0)
+            {
+                memcpy(geomData->pShadow->pAttributes[s], tempStagingBuffer, size);
             }
-
-            tf_free(tempStagingBuffer);
         }
 
-        for (uint32_t j = 0; j < TF_ARRAY_COUNT(geom->mVertexStrides); ++j)
-            ASSERT(geom->mVertexStrides[j] == 0);
+        tf_free(tempStagingBuffer);
+    }
+
+    for (uint32_t j = 0; j < TF_ARRAY_COUNT(geom->mVertexStrides); ++j)
+        ASSERT(geom->mVertexStrides[j] == 0);
 
-        CreateDirectoryForFile(assetParams->mRDOutput, newFileName);
+    CreateDirectoryForFile(assetParams->mRDOutput, newFileName);
+
+    FileStream fStream = {};
+    if (!validPrimitives)
+    {
+        // The invalid primitives were reported while collecting them, don't write an output without their meshlets or levels of detail
+        error = true;
+    }
+    else if (!fsOpenStreamFromPath(assetParams->mRDOutput, newFileName, FM_WRITE_ALLOW_READ, &fStream))
+    {
+        LOGF(eERROR, "Couldn't open file '%s' for write.", newFileName);
+        error = true;
+    }
+    else
+    {
+        // Write null values to file since the pointers are set afterwars
+        GeometryData::ShadowData* pTempShadow = geomData->pShadow;
+        void*                     pTempUserData = geomData->pUserData;
+        geomData->pShadow = NULL;
+        geomData->pUserData = NULL;
 
-        FileStream fStream = {};
-        if (!fsOpenStreamFromPath(assetParams->mRDOutput, newFileName, FM_WRITE_ALLOW_READ, &fStream))
+        if (glTFParams->mWritePackedFormat)
         {
-            LOGF(eERROR, "Couldn't open file '%s' for write.", newFileName);
-            error = true;
+            if (!WriteGeometryPackedFile(&fStream, glTFParams, geom, totalGeomSize, geomData, totalGeomDataSize, pTempShadow,
+                                         shadowSize, &pTask->mStreamSize, &pTask->mEncodedStreamSize))
+            {
+                LOGF(eERROR, "Failed to write stream '%s'.", newFileName);
+                error = true;
+            }
         }
         else
         {
+            const Geometry                 geomHeader = GetGeometryToWrite(geom);
+            const GeometryData::ShadowData shadowHeader = GetShadowDataToWrite(pTempShadow);
+
             fsWriteToStream(&fStream, GEOMETRY_FILE_MAGIC_STR, sizeof(GEOMETRY_FILE_MAGIC_STR));
 
             fsWriteToStream(&fStream, &totalGeomSize, sizeof(uint32_t));
-            fsWriteToStream(&fStream, geom, totalGeomSize);
+            fsWriteToStream(&fStream, &geomHeader, sizeof(geomHeader));
+            fsWriteToStream(&fStream, geom + 1, totalGeomSize - sizeof(geomHeader));
 
-            // Write null values to file since the pointers are set afterwars
-            GeometryData::ShadowData* pTempShadow = geomData->pShadow;
-            void*                     pTempUserData = geomData->pUserData;
-            geomData->pShadow = NULL;
-            geomData->pUserData = NULL;
             fsWriteToStream(&fStream, &totalGeomDataSize, sizeof(uint32_t));
             fsWriteToStream(&fStream, geomData, totalGeomDataSize);
-            geomData->pShadow = pTempShadow;
-            geomData->pUserData = pTempUserData;
 
             fsWriteToStream(&fStream, &shadowSize, sizeof(uint32_t));
-            fsWriteToStream(&fStream, geomData->pShadow, shadowSize);
-
-            if (geom->meshlets.mMeshletCount)
-            {
-                if (fsWriteToStream(&fStream, geom->meshlets.mMeshlets, sizeof(*geom->meshlets.mMeshlets) * geom->meshlets.mMeshletCount) !=
-                        sizeof(*geom->meshlets.mMeshlets) * geom->meshlets.mMeshletCount ||
-                    fsWriteToStream(&fStream, geom->meshlets.mMeshletsData,
-                                    sizeof(*geom->meshlets.mMeshletsData) * geom->meshlets.mMeshletCount) !=
-                        sizeof(*geom->meshlets.mMeshletsData) * geom->meshlets.mMeshletCount ||
-                    fsWriteToStream(&fStream, geom->meshlets.mVertices, sizeof(*geom->meshlets.mVertices) * geom->meshlets.mVertexCount) !=
-                        sizeof(*geom->meshlets.mVertices) * geom->meshlets.mVertexCount ||
-                    fsWriteToStream(&fStream, geom->meshlets.mTriangles,
-                                    sizeof(*geom->meshlets.mTriangles) * geom->meshlets.mTriangleCount) !=
-                        sizeof(*geom->meshlets.mTriangles) * geom->meshlets.mTriangleCount)
-                {
-                    LOGF(eERROR, "Failed to write stream '%s'.", newFileName);
-                    error = true;
-                }
-            }
+            fsWriteToStream(&fStream, &shadowHeader, sizeof(shadowHeader));
+            fsWriteToStream(&fStream, pTempShadow + 1, shadowSize - sizeof(shadowHeader));
+        }
+
+        geomData->pShadow = pTempShadow;
+        geomData->pUserData = pTempUserData;
 
-            if (!fsCloseStream(&fStream))
+        size_t      meshletDataSize = 0;
+        const void* pMeshletData = GetMeshletDataToWrite(geom, &meshletDataSize);
+        if (!glTFParams->mWritePackedFormat && geom->meshlets.mMeshletCount)
+        {
+            if (fsWriteToStream(&fStream, geom->meshlets.mMeshlets, sizeof(*geom->meshlets.mMeshlets) * geom->meshlets.mMeshletCount) !=
+                    sizeof(*geom->meshlets.mMeshlets) * geom->meshlets.mMeshletCount ||
+                fsWriteToStream(&fStream, pMeshletData, meshletDataSize) != meshletDataSize ||
+                fsWriteToStream(&fStream, geom->meshlets.mVertices, sizeof(*geom->meshlets.mVertices) * geom->meshlets.mVertexCount) !=
+                    sizeof(*geom->meshlets.mVertices) * geom->meshlets.mVertexCount ||
+                fsWriteToStream(&fStream, geom->meshlets.mTriangles,
+                                sizeof(*geom->meshlets.mTriangles) * geom->meshlets.mTriangleCount) !=
+                    sizeof(*geom->meshlets.mTriangles) * geom->meshlets.mTriangleCount)
             {
-                LOGF(eERROR, "Failed to close write stream for file '%s'.", newFileName);
+                LOGF(eERROR, "Failed to write stream '%s'.", newFileName);
                 error = true;
             }
         }
 
-        tf_free(geomData->pShadow);
-        tf_free(geomData);
+        outputSize = (uint64_t)max(fsGetStreamSeekPosition(&fStream), (ssize_t)0);
+        if (!fsCloseStream(&fStream))
+        {
+            LOGF(eERROR, "Failed to close write stream for file '%s'.", newFileName);
+            error = true;
+        }
+    }
+
+    const uint64_t geometryBytes = (uint64_t)totalGeomSize + totalGeomDataSize + shadowSize;
+    pTask->mWriteTime = EndAssetPipelineScope(assetParams, &scope, geometryBytes, outputSize);
+    EndAssetPipelineScope(assetParams, &fileScope, inputSize, error ? 0 : outputSize);
+
+    tf_free(geomData->pShadow);
+    tf_free(geomData);
+
+    if (geom->meshlets.mMeshletCount)
+    {
+        arrfree(geom->meshlets.mMeshlets);
+        arrfree(geom->meshlets.mMeshletsData);
+        arrfree(geom->meshlets.mVertices);
+        arrfree(geom->meshlets.mTriangles);
+    }
+    tf_free(geom->pMeshletsDataQuantized);
+
+    tf_free(geom);
+
+    data->file_data = fileData;
+    cgltf_free(data);
+
+    if (buildHash && !error)
+    {
+        BuildCacheStore(assetParams, newFileName, buildHash);
+    }
+    pTask->mError = error;
+}
+
+static void ProcessGLTFFileTask(void* pUser, uint64_t) { ProcessGLTFFile((GLTFFileTask*)pUser); }
+
+bool ProcessGLTF(AssetPipelineParams* assetParams, ProcessGLTFParams* glTFParams)
+{
+    ASSERT(glTFParams->pVertexLayout);
+
+    bool error = false;
+
+    // Get all gltf files
+    bstring* gltfFiles = NULL;
+    uint32_t gltfFileCount = 0;
+
+    if (assetParams->mPathMode == PROCESS_MODE_FILE)
+    {
+        arrpush(gltfFiles, bdynfromcstr(assetParams->mInFilePath));
+    }
+    else
+    {
+        InputDirectorySearch(assetParams, "gltf", OnGLTFFind, (void*)&gltfFiles);
+    }
+
+    gltfFileCount = (uint32_t)arrlenu(gltfFiles);
+
+    ThreadSystem threadSystem = AcquireAssetPipelineThreadSystem(assetParams, "ProcessGLTF");
+
+    MeshoptScratchPool scratchPool = {};
+    InitMeshoptScratchPool(&scratchPool);
+
+    GLTFFileTask* pTasks = (GLTFFileTask*)tf_calloc(max(gltfFileCount, 1u), sizeof(GLTFFileTask));
+    for (uint32_t i = 0; i < gltfFileCount; ++i)
+    {
+        pTasks[i].pAssetParams = assetParams;
+        pTasks[i].pGLTFParams = glTFParams;
+        pTasks[i].mThreadSystem = threadSystem;
+        pTasks[i].pScratchPool = &scratchPool;
+        pTasks[i].pInFileName = (const char*)gltfFiles[i].data;
+    }
 
-        if (geom->meshlets.mMeshletCount)
+    // The extras callbacks and their user data aren't required to be thread safe, convert one file at a time when they are set.
+    // Primitives of each file still use the worker threads.
+    const bool    hasCallbacks = glTFParams->pReadExtrasCallback || glTFParams->pWriteExtrasCallback;
+    ThreadSystem  fileThreadSystem = hasCallbacks ? NULL : threadSystem;
+    const int64_t startTime = getUSec(false);
+    threadSystemAddTaskGroup(fileThreadSystem, ProcessGLTFFileTask, gltfFileCount, pTasks);
+    while (threadSystemAssist(fileThreadSystem))
+        ;
+    threadSystemWaitIdle(threadSystem);
+    const int64_t totalTime = getUSec(false) - startTime;
+
+    ReleaseAssetPipelineThreadSystem(assetParams, &threadSystem);
+    ExitMeshoptScratchPool(&scratchPool);
+
+    uint32_t processedCount = 0;
+    int64_t  stageTimes[6] = {};
+    uint64_t streamSize = 0;
+    uint64_t encodedStreamSize = 0;
+    for (uint32_t i = 0; i < gltfFileCount; ++i)
+    {
+        const GLTFFileTask* pTask = &pTasks[i];
+        error |= pTask->mError;
+        RecordAssetPipelineAsset(assetParams, pTask->pInFileName, !pTask->mSkipped && !pTask->mError);
+        if (!pTask->mSkipped)
         {
-            arrfree(geom->meshlets.mMeshlets);
-            arrfree(geom->meshlets.mMeshletsData);
-            arrfree(geom->meshlets.mVertices);
-            arrfree(geom->meshlets.mTriangles);
+            ++processedCount;
+            stageTimes[0] += pTask->mLoadTime;
+            stageTimes[1] += pTask->mPackTime;
+            stageTimes[2] += pTask->mOptimizeTime;
+            stageTimes[3] += pTask->mLodTime;
+            stageTimes[4] += pTask->mMeshletTime;
+            stageTimes[5] += pTask->mWriteTime;
+
+            LOGF(eINFO, "%s: load %.2f ms, pack %.2f ms, optimize %.2f ms, lods %.2f ms, meshlets %.2f ms, write %.2f ms",
+                 pTask->pInFileName, pTask->mLoadTime / 1000.0, pTask->mPackTime / 1000.0, pTask->mOptimizeTime / 1000.0,
+                 pTask->mLodTime / 1000.0, pTask->mMeshletTime / 1000.0, pTask->mWriteTime / 1000.0);
+
+            streamSize += pTask->mStreamSize;
+            encodedStreamSize += pTask->mEncodedStreamSize;
         }
+    }
+    tf_free(pTasks);
 
-        tf_free(geom);
+    LOGF(eINFO,
+         "Processed %u of %u glTF files in %.2f ms with %u threads (summed over files: load %.2f ms, pack %.2f ms, optimize %.2f ms, "
+         "lods %.2f ms, meshlets %.2f ms, write %.2f ms)",
+         processedCount, gltfFileCount, totalTime / 1000.0, assetParams->mSettings.threadCount, stageTimes[0] / 1000.0,
+         stageTimes[1] / 1000.0, stageTimes[2] / 1000.0, stageTimes[3] / 1000.0, stageTimes[4] / 1000.0, stageTimes[5] / 1000.0);
 
-        data->file_data = fileData;
-        cgltf_free(data);
+    if (glTFParams->mCompressStreams && streamSize)
+    {
+        LOGF(eINFO, "Encoded index and vertex streams from %llu to %llu bytes (%.1f%%)", (unsigned long long)streamSize,
+             (unsigned long long)encodedStreamSize, 100.0 * (double)encodedStreamSize / (double)streamSize);
     }
 
     if (gltfFiles)
@@ -2332,6 +4522,11 @@ bool WriteZip(AssetPipelineParams* assetParams, WriteZipParams* zipParams)
 
     size_t collectibleCount = arrlenu(collectibles);
 
+    AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, "Zip", zipParams->mZipFileName);
+    uint64_t           inputSize = 0;
+    for (size_t i = 0; i < collectibleCount; ++i)
+        inputSize += GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDInput, collectibles[i]);
+
     struct BunyArLibEntryCreateDesc* filesDesc = (struct BunyArLibEntryCreateDesc*)tf_malloc(collectibleCount * sizeof *filesDesc);
 
     for (size_t i = 0; i < collectibleCount; ++i)
@@ -2352,6 +4547,9 @@ bool WriteZip(AssetPipelineParams* assetParams, WriteZipParams* zipParams)
     archiveCreateDesc.threadPoolSize = -1;
 
     bool archiveIsCreated = bunyArLibCreate(assetParams->mRDOutput, zipParams->mZipFileName, &archiveCreateDesc);
+    RecordAssetPipelineAsset(assetParams, zipParams->mZipFileName, archiveIsCreated);
+    EndAssetPipelineScope(assetParams, &scope, inputSize,
+                          GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDOutput, zipParams->mZipFileName));
 
     tf_free(filesDesc);
 
@@ -2367,9 +4565,11 @@ bool ZipAllAssets(AssetPipelineParams* assetParams, WriteZipParams* zipParams)
     // TODO: we should check that none of the existing assets have been cooked
     if (!assetParams->mSettings.force && fsFileExist(assetParams->mRDOutput, zipParams->mZipFileName))
     {
+        RecordAssetPipelineAsset(assetParams, zipParams->mZipFileName, false);
         return false;
     }
 
+    AssetPipelineScope  scope = BeginAssetPipelineScope(assetParams, "Zip", zipParams->mZipFileName);
     BunyArLibCreateDesc archiveCreateDesc = { 0 };
 
     struct BunyArLibEntryCreateDesc entry = BUNYAR_LIB_FUNC_CREATE_DEFAULT_ENTRY_DESC;
@@ -2409,6 +4609,10 @@ bool ZipAllAssets(AssetPipelineParams* assetParams, WriteZipParams* zipParams)
     archiveCreateDesc.threadPoolSize = -1;
 
     bool success = bunyArLibCreate(assetParams->mRDOutput, zipParams->mZipFileName, &archiveCreateDesc);
+    RecordAssetPipelineAsset(assetParams, zipParams->mZipFileName, success);
+    // Inputs are whole directories, only the archive is measured
+    EndAssetPipelineScope(assetParams, &scope, 0,
+                          GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDOutput, zipParams->mZipFileName));
 
     arrfree(archiveCreateDesc.entries);
 
@@ -2507,7 +4711,7 @@ void OnDiscoverAnimation(ResourceDirectory resourceDir, const char* filename, vo
         ReleaseSkeletonAndAnimationParams(&skeletonAndAnims, 1);
 }
 
-int AssetPipelineRun(AssetPipelineParams* assetParams)
+static int RunAssetPipelineProcess(AssetPipelineParams* assetParams)
 {
     if (assetParams->mProcessType == PROCESS_ANIMATIONS)
     {
@@ -2528,8 +4732,7 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
         else
         {
             BeginAssetPipelineSection("DiscoverAnimations");
-            DirectorySearch(assetParams->mRDInput, NULL, "gltf", OnDiscoverAnimation, (void*)&discoveredAnimations,
-                            assetParams->mPathMode == PROCESS_MODE_DIRECTORY_RECURSIVE);
+            InputDirectorySearch(assetParams, "gltf", OnDiscoverAnimation, (void*)&discoveredAnimations);
             EndAssetPipelineSection("DiscoverAnimations");
         }
 
@@ -2552,7 +4755,52 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
 
     if (assetParams->mProcessType == PROCESS_TFX)
     {
-        ProcessTressFXParams tfxParams;
+        bool                 error = false;
+        ProcessTressFXParams tfxParams = {};
+        tfxParams.mLodStrandRatio = TRESSFX_DEFAULT_LOD_STRAND_RATIO;
+
+        for (int32_t i = 0; i < assetParams->mFlagsCount; ++i)
+        {
+            const char* flag = assetParams->mFlags[i];
+            const bool  hasValue = i + 1 < assetParams->mFlagsCount;
+
+            if ((strcmp(flag, "--fhc") == 0 || strcmp(flag, "-followhaircount") == 0) && hasValue)
+                tfxParams.mFollowHairCount = (uint32_t)atoi(assetParams->mFlags[++i]);
+            else if ((strcmp(flag, "--tsf") == 0 || strcmp(flag, "-tipseparationfactor") == 0) && hasValue)
+                tfxParams.mTipSeperationFactor = (float)atof(assetParams->mFlags[++i]);
+            else if ((strcmp(flag, "--maxradius") == 0 || strcmp(flag, "-maxradius") == 0) && hasValue)
+                tfxParams.mMaxRadiusAroundGuideHair = (float)atof(assetParams->mFlags[++i]);
+            else if (strcmp(flag, "--lods") == 0 && hasValue)
+            {
+                const int lodCount = atoi(assetParams->mFlags[++i]);
+                if (lodCount < 0 || lodCount >= GEOMETRY_MAX_LODS)
+                {
+                    LOGF(eERROR, "Number of levels of detail should be between 0 and %d.", GEOMETRY_MAX_LODS - 1);
+                    error = true;
+                }
+                tfxParams.mLodCount = (uint32_t)max(lodCount, 0);
+            }
+            else if (strcmp(flag, "--lodratio") == 0 && hasValue)
+            {
+                tfxParams.mLodStrandRatio = (float)atof(assetParams->mFlags[++i]);
+                if (tfxParams.mLodStrandRatio <= 0.0f || tfxParams.mLodStrandRatio >= 1.0f)
+                {
+                    LOGF(eERROR, "Strand ratio between levels of detail should be larger than 0 and smaller than 1.");
+                    error = true;
+                }
+            }
+            else if (strcmp(flag, "--quantize") == 0)
+                tfxParams.mQuantizePositions = true;
+            else
+            {
+                LOGF(eERROR, "Unrecognized flag %s.", flag);
+                error = true;
+            }
+        }
+
+        if (error)
+            return 1;
+
         BeginAssetPipelineSection("ProcessTFX");
         bool result = ProcessTFX(assetParams, &tfxParams);
         EndAssetPipelineSection("ProcessTFX");
@@ -2567,25 +4815,87 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
         MeshOptimizerFlags meshOptimizerFlags = MESH_OPTIMIZATION_FLAG_OFF;
 
         bool processMeshlets = false;
+        bool writePackedFormat = false;
+        bool compressStreams = false;
+        int  quantizationBits = 0;
+        bool quantizeMeshletData = false;
+
+        // 0 uses the defaults of ProcessGLTFParams
+        bool  lodMeshlets = false;
+        int   lodCount = 0;
+        float lodIndexRatio = 0.0f;
+        float lodTargetError = 0.0f;
         /// Recommended number of vertices and triangles are from
         /// https://gpuopen.com/learn/mesh_shaders/mesh_shaders-optimization_and_best_practices/
         int  numMeshletVertices = 128;
         int  numMeshletTriangles = 256;
 
-        for (int32_t i = 0; i < assetParams->mFlagsCount; ++i)
-        {
-            if (strcmp(assetParams->mFlags[i], "--hair") == 0)
-                isHair = true;
-            else if (strcmp(assetParams->mFlags[i], "--optimize") == 0)
-                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_ALL;
-            else if (strcmp(assetParams->mFlags[i], "--optimizecache") == 0)
-                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_VERTEXCACHE;
-            else if (strcmp(assetParams->mFlags[i], "--optimizeoverdraw") == 0)
-                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_OVERDRAW;
-            else if (strcmp(assetParams->mFlags[i], "--optimizefetch") == 0)
-                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_VERTEXFETCH;
-            else if (strcmp(assetParams->mFlags[i], "--meshlets") == 0)
-                processMeshlets = true;
+        for (int32_t i = 0; i < assetParams->mFlagsCount; ++i)
+        {
+            if (strcmp(assetParams->mFlags[i], "--hair") == 0)
+                isHair = true;
+            else if (strcmp(assetParams->mFlags[i], "--optimize") == 0)
+                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_ALL;
+            else if (strcmp(assetParams->mFlags[i], "--optimizecache") == 0)
+                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_VERTEXCACHE;
+            else if (strcmp(assetParams->mFlags[i], "--optimizeoverdraw") == 0)
+                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_OVERDRAW;
+            else if (strcmp(assetParams->mFlags[i], "--optimizefetch") == 0)
+                meshOptimizerFlags |= MESH_OPTIMIZATION_FLAG_VERTEXFETCH;
+            else if (strcmp(assetParams->mFlags[i], "--meshlets") == 0)
+                processMeshlets = true;
+            else if (strcmp(assetParams->mFlags[i], "--packed") == 0)
+                writePackedFormat = true;
+            else if (strcmp(assetParams->mFlags[i], "--compress") == 0)
+                compressStreams = true;
+            else if (strcmp(assetParams->mFlags[i], "--quantize") == 0)
+            {
+                i++;
+                quantizationBits = atoi(assetParams->mFlags[i]);
+
+                if (quantizationBits < 1 || quantizationBits > 24)
+                {
+                    LOGF(eERROR, "Number of quantization bits should be between 1 and 24.");
+                    error = true;
+                }
+            }
+            else if (strcmp(assetParams->mFlags[i], "--lodmeshlets") == 0)
+                lodMeshlets = true;
+            else if (strcmp(assetParams->mFlags[i], "--meshletquantize") == 0)
+                quantizeMeshletData = true;
+            else if (strcmp(assetParams->mFlags[i], "--lods") == 0)
+            {
+                i++;
+                lodCount = atoi(assetParams->mFlags[i]);
+
+                if (lodCount < 0 || lodCount >= GEOMETRY_MAX_LODS)
+                {
+                    LOGF(eERROR, "Number of levels of detail should be between 0 and %d.", GEOMETRY_MAX_LODS - 1);
+                    error = true;
+                }
+            }
+            else if (strcmp(assetParams->mFlags[i], "--lodratio") == 0)
+            {
+                i++;
+                lodIndexRatio = (float)atof(assetParams->mFlags[i]);
+
+                if (lodIndexRatio <= 0.0f || lodIndexRatio >= 1.0f)
+                {
+                    LOGF(eERROR, "Index ratio between levels of detail should be larger than 0 and smaller than 1.");
+                    error = true;
+                }
+            }
+            else if (strcmp(assetParams->mFlags[i], "--loderror") == 0)
+            {
+                i++;
+                lodTargetError = (float)atof(assetParams->mFlags[i]);
+
+                if (lodTargetError <= 0.0f)
+                {
+                    LOGF(eERROR, "Level of detail error target should be larger than 0.");
+                    error = true;
+                }
+            }
             else if (strcmp(assetParams->mFlags[i], "--meshletnumvertices") == 0)
             {
                 i++;
@@ -2612,6 +4922,18 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
             }
         }
 
+        if (compressStreams && !writePackedFormat)
+        {
+            LOGF(eERROR, "--compress requires --packed.");
+            error = true;
+        }
+
+        if (quantizationBits && !compressStreams)
+        {
+            LOGF(eERROR, "--quantize requires --compress.");
+            error = true;
+        }
+
         if (error)
             return 1;
 
@@ -2678,6 +5000,15 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
         glTFParams.mNumMaxVertices = numMeshletVertices;
         glTFParams.mNumMaxTriangles = numMeshletTriangles;
         glTFParams.mOptimizationFlags = meshOptimizerFlags;
+        glTFParams.mWritePackedFormat = writePackedFormat;
+        glTFParams.mCompressStreams = compressStreams;
+        glTFParams.mQuantizationBits = (uint32_t)quantizationBits;
+        glTFParams.mLodCount = (uint32_t)lodCount;
+        glTFParams.mLodIndexRatio = lodIndexRatio;
+        glTFParams.mLodMeshlets = lodMeshlets;
+        glTFParams.mQuantizeMeshletData = quantizeMeshletData;
+        for (uint32_t i = 0; i < TF_ARRAY_COUNT(glTFParams.mLodTargetErrors); ++i)
+            glTFParams.mLodTargetErrors[i] = lodTargetError;
 
         BeginAssetPipelineSection("ProcessGLTF");
         bool result = ProcessGLTF(assetParams, &glTFParams);
@@ -2685,9 +5016,15 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
         return result;
     }
 
-    if (assetParams->mProcessType == PROCESS_TEXTURES)
+    if (assetParams->mProcessType == PROCESS_TEXTURES || assetParams->mProcessType == PROCESS_PACK_TEXTURES)
     {
+        // PackTextures takes the same flags as ProcessTextures plus its own
+        const bool            pack = assetParams->mProcessType == PROCESS_PACK_TEXTURES;
         ProcessTexturesParams texturesParams = {};
+        PackTexturesParams    packParams = {};
+        packParams.mMode = TEXTURE_PACK_ARRAY;
+        packParams.pOutName = "TexturePack";
+        packParams.mPadding = TEXTURE_PACK_DEFAULT_PADDING;
 
         texturesParams.mInExt = assetParams->mInExt;
         texturesParams.mCompression = COMPRESSION_NONE;
@@ -2754,6 +5091,16 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
             {
                 texturesParams.mContainer = CONTAINER_KTX;
             }
+            else if (STRCMP(flag, "--out-ktx2"))
+            {
+                texturesParams.mContainer = CONTAINER_KTX2;
+                texturesParams.mSupercompressionLevel = KTX2_DEFAULT_SUPERCOMPRESSION_LEVEL;
+            }
+            else if (STRCMP(flag, "--out-ktx2-raw"))
+            {
+                texturesParams.mContainer = CONTAINER_KTX2;
+                texturesParams.mSupercompressionLevel = 0;
+            }
             else if (STRCMP(flag, "--out-dds"))
             {
                 texturesParams.mContainer = CONTAINER_DDS;
@@ -2839,6 +5186,14 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
             {
                 texturesParams.mGenerateMipmaps = MIPMAP_DEFAULT;
             }
+            else if (STRCMP(flag, "--mipfilter-box"))
+            {
+                texturesParams.mMipmapFilter = MIPMAP_FILTER_BOX;
+            }
+            else if (STRCMP(flag, "--mipfilter-kaiser"))
+            {
+                texturesParams.mMipmapFilter = MIPMAP_FILTER_KAISER;
+            }
             else if (STRCMP(flag, "--vmf"))
             {
                 texturesParams.pRoughnessFilePath = assetParams->mFlags[++i];
@@ -2847,6 +5202,26 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
             {
                 texturesParams.mInputLinearColorSpace = true;
             }
+            else if (pack && STRCMP(flag, "--array"))
+            {
+                packParams.mMode = TEXTURE_PACK_ARRAY;
+            }
+            else if (pack && STRCMP(flag, "--atlas"))
+            {
+                packParams.mMode = TEXTURE_PACK_ATLAS;
+            }
+            else if (pack && STRCMP(flag, "--name") && i + 1 < assetParams->mFlagsCount)
+            {
+                packParams.pOutName = assetParams->mFlags[++i];
+            }
+            else if (pack && STRCMP(flag, "--filter") && i + 1 < assetParams->mFlagsCount)
+            {
+                packParams.pFilter = assetParams->mFlags[++i];
+            }
+            else if (pack && STRCMP(flag, "--padding") && i + 1 < assetParams->mFlagsCount)
+            {
+                packParams.mPadding = (uint32_t)atoi(assetParams->mFlags[++i]);
+            }
             else
             {
                 LOGF(eERROR, "Unrecognized flag %s.", flag);
@@ -2861,9 +5236,23 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
             error = true;
         }
 
+        if (pack && texturesParams.pRoughnessFilePath)
+        {
+            LOGF(eERROR, "vMF textures can't be packed.");
+            error = true;
+        }
+
         if (error)
             return 1;
 
+        if (pack)
+        {
+            BeginAssetPipelineSection("PackTextures");
+            bool result = PackTextures(assetParams, &texturesParams, &packParams);
+            EndAssetPipelineSection("PackTextures");
+            return result;
+        }
+
         BeginAssetPipelineSection("ProcessTextures");
         bool result = ProcessTextures(assetParams, &texturesParams);
         EndAssetPipelineSection("ProcessTextures");
@@ -2925,3 +5314,685 @@ int AssetPipelineRun(AssetPipelineParams* assetParams)
     ASSERT(false);
     return 0;
 }
+
+int AssetPipelineRun(AssetPipelineParams* assetParams)
+{
+    ASSERT(!assetParams->mSettings.useSharedBuildCache || assetParams->mSettings.useBuildCache);
+    assetParams->pBuildCache = assetParams->mSettings.useBuildCache ? LoadBuildCache(assetParams) : NULL;
+
+    // Names of AssetPipelineProcess for the profile
+    static const char* processNames[] = { "ProcessAnimations", "ProcessTFX", "ProcessGLTF",  "ProcessTextures",
+                                          "WriteZip",          "ZipAllAssets", "PackTextures" };
+    const char*        inputPath = assetParams->mPathMode == PROCESS_MODE_FILE ? assetParams->mInFilePath : assetParams->mInDir;
+    AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, processNames[assetParams->mProcessType], inputPath);
+
+    const int result = RunAssetPipelineProcess(assetParams);
+
+    EndAssetPipelineScope(assetParams, &scope, 0, 0);
+
+    if (assetParams->pBuildCache)
+    {
+        SaveAndFreeBuildCache(assetParams, assetParams->pBuildCache);
+        assetParams->pBuildCache = NULL;
+    }
+    return result;
+}
+
+/************************************************************************/
+// Self tests
+/************************************************************************/
+#define LOD_TEST_FILE_NAME    "LodTest.gltf"
+#define LOD_TEST_BUFFER_NAME  "LodTestBuffer.bin"
+#define LOD_TEST_LEVEL_COUNT  3
+#define LOD_TEST_TARGET_ERROR 0.05f
+
+// Square grids of vertices displaced by a smooth height field, they simplify well without collapsing. Different sizes so that the
+// primitives reach their levels at different index counts.
+static const uint32_t gLodTestGridSizes[] = { 64, 41 };
+
+static uint32_t GetLodTestGridIndexCount(uint32_t size) { return (size - 1) * (size - 1) * 6; }
+
+// Writes a glTF with one mesh made of the grids, the positions and indices of every grid follow each other in a separate buffer file
+static bool WriteLodTestGLTF(ResourceDirectory resourceDir)
+{
+    FileStream buffer = {};
+    if (!fsOpenStreamFromPath(resourceDir, LOD_TEST_BUFFER_NAME, FM_WRITE, &buffer))
+    {
+        LOGF(eERROR, "glTF lods: couldn't open '%s' for write", LOD_TEST_BUFFER_NAME);
+        return false;
+    }
+
+    bstring primitives = bempty();
+    bstring views = bempty();
+    bstring accessors = bempty();
+    uint32_t bufferSize = 0;
+    bool     written = true;
+    for (uint32_t g = 0; g < TF_ARRAY_COUNT(gLodTestGridSizes); ++g)
+    {
+        const uint32_t size = gLodTestGridSizes[g];
+        const uint32_t vertexCount = size * size;
+        const uint32_t indexCount = GetLodTestGridIndexCount(size);
+        const float    offsetX = 1.5f * (float)g;
+
+        float*    pPositions = (float*)tf_malloc(vertexCount * 3 * sizeof(float));
+        uint32_t* pIndices = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+        for (uint32_t z = 0; z < size; ++z)
+        {
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                const float u = (float)x / (float)(size - 1);
+                const float v = (float)z / (float)(size - 1);
+                float*      pPosition = &pPositions[(z * size + x) * 3];
+                pPosition[0] = offsetX + u;
+                pPosition[1] = 0.1f * sinf(3.0f * u) * cosf(2.0f * v);
+                pPosition[2] = v;
+            }
+        }
+        uint32_t* pIndex = pIndices;
+        for (uint32_t z = 0; z + 1 < size; ++z)
+        {
+            for (uint32_t x = 0; x + 1 < size; ++x)
+            {
+                const uint32_t corner = z * size + x;
+                const uint32_t quad[6] = { corner, corner + size, corner + 1, corner + 1, corner + size, corner + size + 1 };
+                memcpy(pIndex, quad, sizeof(quad));
+                pIndex += 6;
+            }
+        }
+
+        const uint32_t positionsSize = vertexCount * 3 * sizeof(float);
+        const uint32_t indicesSize = indexCount * sizeof(uint32_t);
+        written = written && fsWriteToStream(&buffer, pPositions, positionsSize) == positionsSize &&
+                  fsWriteToStream(&buffer, pIndices, indicesSize) == indicesSize;
+        tf_free(pPositions);
+        tf_free(pIndices);
+
+        bformata(&primitives, "%s{ \"attributes\": { \"POSITION\": %u }, \"indices\": %u }", g ? ", " : "", 2 * g, 2 * g + 1);
+        bformata(&views,
+                 "%s{ \"buffer\": 0, \"byteOffset\": %u, \"byteLength\": %u }, "
+                 "{ \"buffer\": 0, \"byteOffset\": %u, \"byteLength\": %u }",
+                 g ? ", " : "", bufferSize, positionsSize, bufferSize + positionsSize, indicesSize);
+        bformata(&accessors,
+                 "%s{ \"bufferView\": %u, \"componentType\": 5126, \"count\": %u, \"type\": \"VEC3\", \"min\": [ %f, -0.1, 0.0 ], "
+                 "\"max\": [ %f, 0.1, 1.0 ] }, { \"bufferView\": %u, \"componentType\": 5125, \"count\": %u, \"type\": \"SCALAR\" }",
+                 g ? ", " : "", 2 * g, vertexCount, offsetX, offsetX + 1.0f, 2 * g + 1, indexCount);
+        bufferSize += positionsSize + indicesSize;
+    }
+    fsCloseStream(&buffer);
+
+    bstring json = bempty();
+    bformata(&json,
+             "{\n  \"asset\": { \"version\": \"2.0\" },\n  \"scene\": 0,\n  \"scenes\": [ { \"nodes\": [ 0 ] } ],\n"
+             "  \"nodes\": [ { \"mesh\": 0 } ],\n  \"meshes\": [ { \"primitives\": [ %s ] } ],\n"
+             "  \"buffers\": [ { \"uri\": \"%s\", \"byteLength\": %u } ],\n  \"bufferViews\": [ %s ],\n  \"accessors\": [ %s ]\n}\n",
+             (const char*)primitives.data, LOD_TEST_BUFFER_NAME, bufferSize, (const char*)views.data, (const char*)accessors.data);
+    bdestroy(&primitives);
+    bdestroy(&views);
+    bdestroy(&accessors);
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, LOD_TEST_FILE_NAME, FM_WRITE, &file))
+    {
+        LOGF(eERROR, "glTF lods: couldn't open '%s' for write", LOD_TEST_FILE_NAME);
+        bdestroy(&json);
+        return false;
+    }
+    written = written && fsWriteToStream(&file, json.data, (size_t)json.slen) == (size_t)json.slen;
+    fsCloseStream(&file);
+    bdestroy(&json);
+
+    if (!written)
+        LOGF(eERROR, "glTF lods: couldn't write the test glTF");
+    return written;
+}
+
+
+// Sections of a geometry file written by ProcessGLTF without the packed format, copied to allocations so that they are aligned
+typedef struct LodTestGeometry
+{
+    Geometry*                 pGeom;
+    uint32_t                  mGeomSize;
+    GeometryData::ShadowData* pShadow;
+    uint32_t                  mShadowSize;
+    Meshlet*                  pMeshlets;
+    uint32_t*                 pMeshletVertices;
+    uint8_t*                  pMeshletTriangles;
+    void*                     pSections[4];
+} LodTestGeometry;
+
+// Returns false when the file isn't a geometry file or its sections don't match their sizes
+static bool LoadLodTestGeometry(const uint8_t* pFile, size_t fileSize, LodTestGeometry* pOut)
+{
+    if (fileSize < sizeof(GEOMETRY_FILE_MAGIC_STR) || memcmp(pFile, GEOMETRY_FILE_MAGIC_STR, sizeof(GEOMETRY_FILE_MAGIC_STR)) != 0)
+        return false;
+
+    // Geometry, GeometryData and shadow data, each one after its size
+    const uint8_t* pCursor = pFile + sizeof(GEOMETRY_FILE_MAGIC_STR);
+    const uint8_t* pEnd = pFile + fileSize;
+    uint32_t       sectionSizes[3] = {};
+    for (uint32_t s = 0; s < TF_ARRAY_COUNT(sectionSizes); ++s)
+    {
+        if ((size_t)(pEnd - pCursor) < sizeof(uint32_t))
+            return false;
+        memcpy(&sectionSizes[s], pCursor, sizeof(uint32_t));
+        pCursor += sizeof(uint32_t);
+        if ((size_t)(pEnd - pCursor) < sectionSizes[s])
+            return false;
+        pOut->pSections[s] = tf_malloc(max(sectionSizes[s], 1u));
+        memcpy(pOut->pSections[s], pCursor, sectionSizes[s]);
+        pCursor += sectionSizes[s];
+    }
+    if (sectionSizes[0] < sizeof(Geometry) || sectionSizes[2] < sizeof(GeometryData::ShadowData))
+        return false;
+
+    pOut->pGeom = (Geometry*)pOut->pSections[0];
+    pOut->mGeomSize = sectionSizes[0];
+    pOut->pShadow = (GeometryData::ShadowData*)pOut->pSections[2];
+    pOut->mShadowSize = sectionSizes[2];
+
+    // The meshlets, their bounds, vertices and triangles end the file
+    const GeometryMeshlets* pMeshlets = &pOut->pGeom->meshlets;
+    const size_t            dataStride = pOut->pGeom->mMeshletDataQuantized ? sizeof(MeshletDataQuantized) : sizeof(MeshletData);
+    const size_t            meshletsSize = (size_t)pMeshlets->mMeshletCount * (sizeof(Meshlet) + dataStride);
+    const size_t            verticesSize = (size_t)pMeshlets->mVertexCount * sizeof(uint32_t);
+    const size_t            remainingSize = (size_t)(pEnd - pCursor);
+    if (remainingSize != meshletsSize + verticesSize + pMeshlets->mTriangleCount)
+        return false;
+
+    pOut->pSections[3] = tf_malloc(max(remainingSize, (size_t)1));
+    memcpy(pOut->pSections[3], pCursor, remainingSize);
+    pOut->pMeshlets = (Meshlet*)pOut->pSections[3];
+    pOut->pMeshletVertices = (uint32_t*)((uint8_t*)pOut->pSections[3] + meshletsSize);
+    pOut->pMeshletTriangles = (uint8_t*)pOut->pMeshletVertices + verticesSize;
+    return true;
+}
+
+static void FreeLodTestGeometry(LodTestGeometry* pGeometry)
+{
+    for (uint32_t s = 0; s < TF_ARRAY_COUNT(pGeometry->pSections); ++s)
+        tf_free(pGeometry->pSections[s]);
+    *pGeometry = {};
+}
+
+static uint32_t ReadLodTestIndex(const void* pIndices, uint32_t indexType, uint32_t index)
+{
+    return indexType == INDEX_TYPE_UINT16 ? ((const uint16_t*)pIndices)[index] : ((const uint32_t*)pIndices)[index];
+}
+
+// Checks the draw arguments, the level table and the meshlet ranges of every level, returns the number of problems logged
+static uint32_t ValidateLodTestGeometry(const LodTestGeometry* pGeometry, const char* name)
+{
+    const Geometry* pGeom = pGeometry->pGeom;
+    const uint32_t  drawArgCount = pGeom->mDrawArgCount;
+    const uint32_t  lodCount = pGeom->mLodCount;
+    const size_t    lodTableOffset = sizeof(Geometry) + round_up(lodCount * drawArgCount * sizeof(IndirectDrawIndexArguments), 16);
+    if (drawArgCount != TF_ARRAY_COUNT(gLodTestGridSizes) || lodCount != LOD_TEST_LEVEL_COUNT + 1 ||
+        lodTableOffset + lodCount * sizeof(GeometryLod) > pGeometry->mGeomSize)
+    {
+        LOGF(eERROR, "glTF lods: %s has %u draw arguments and %u levels, expected %u and %u", name, drawArgCount, lodCount,
+             (uint32_t)TF_ARRAY_COUNT(gLodTestGridSizes), LOD_TEST_LEVEL_COUNT + 1);
+        return 1;
+    }
+
+    const uint32_t indexStride = pGeom->mIndexType == INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    if (sizeof(GeometryData::ShadowData) + (size_t)pGeom->mIndexCount * indexStride > pGeometry->mShadowSize)
+    {
+        LOGF(eERROR, "glTF lods: %s has %u indices, more than its shadow data holds", name, pGeom->mIndexCount);
+        return 1;
+    }
+
+    const IndirectDrawIndexArguments* pDrawArgs = (const IndirectDrawIndexArguments*)(pGeom + 1);
+    const GeometryLod*                pLods = (const GeometryLod*)((const uint8_t*)pGeom + lodTableOffset);
+    const void*                       pIndices = pGeometry->pShadow + 1;
+    const GeometryMeshlets*           pMeshlets = &pGeom->meshlets;
+
+    uint32_t errorCount = 0;
+    uint32_t minVertices[TF_ARRAY_COUNT(gLodTestGridSizes)] = {};
+    uint32_t maxVertices[TF_ARRAY_COUNT(gLodTestGridSizes)] = {};
+    uint32_t levelIndexCounts[GEOMETRY_MAX_LODS] = {};
+    uint32_t nextStartIndex = 0;
+    uint32_t nextMeshlet = 0;
+    for (uint32_t l = 0; l < lodCount; ++l)
+    {
+        const GeometryLod* pLod = &pLods[l];
+        if (pLod->mDrawArgOffset != l * drawArgCount)
+        {
+            LOGF(eERROR, "glTF lods: %s level %u starts at draw argument %u instead of %u", name, l, pLod->mDrawArgOffset,
+                 l * drawArgCount);
+            ++errorCount;
+            continue;
+        }
+        if (l == 0 ? pLod->mError != 0.0f : !(pLod->mError >= 0.0f && pLod->mError <= LOD_TEST_TARGET_ERROR))
+        {
+            LOGF(eERROR, "glTF lods: %s level %u has error %f, the target is %f", name, l, pLod->mError, LOD_TEST_TARGET_ERROR);
+            ++errorCount;
+        }
+
+        // Level 0 draws the primitives one after the other, the next levels draw at most the indices of the previous one
+        for (uint32_t d = 0; d < drawArgCount; ++d)
+        {
+            const IndirectDrawIndexArguments* pArgs = &pDrawArgs[pLod->mDrawArgOffset + d];
+            const uint32_t                    maxIndexCount =
+                l == 0 ? GetLodTestGridIndexCount(gLodTestGridSizes[d]) : pDrawArgs[pLod->mDrawArgOffset - drawArgCount + d].mIndexCount;
+            const bool validRange = pArgs->mIndexCount > 0 && pArgs->mIndexCount % 3 == 0 && pArgs->mIndexCount <= maxIndexCount &&
+                                    (uint64_t)pArgs->mStartIndex + pArgs->mIndexCount <= pGeom->mIndexCount &&
+                                    pArgs->mInstanceCount == 1 && pArgs->mVertexOffset == 0;
+            if (!validRange || (l == 0 && (pArgs->mIndexCount != maxIndexCount || pArgs->mStartIndex != nextStartIndex)))
+            {
+                LOGF(eERROR, "glTF lods: %s level %u primitive %u draws %u indices from %u", name, l, d, pArgs->mIndexCount,
+                     pArgs->mStartIndex);
+                ++errorCount;
+                continue;
+            }
+
+            // Levels share the vertices of their primitive
+            if (l == 0)
+            {
+                nextStartIndex += pArgs->mIndexCount;
+                minVertices[d] = UINT32_MAX;
+                for (uint32_t i = 0; i < pArgs->mIndexCount; ++i)
+                {
+                    const uint32_t index = ReadLodTestIndex(pIndices, pGeom->mIndexType, pArgs->mStartIndex + i);
+                    minVertices[d] = min(minVertices[d], index);
+                    maxVertices[d] = max(maxVertices[d], index);
+                }
+            }
+            uint32_t outsideCount = 0;
+            for (uint32_t i = 0; i < pArgs->mIndexCount; ++i)
+            {
+                const uint32_t index = ReadLodTestIndex(pIndices, pGeom->mIndexType, pArgs->mStartIndex + i);
+                outsideCount += index >= pGeom->mVertexCount || index < minVertices[d] || index > maxVertices[d] ? 1 : 0;
+            }
+            if (outsideCount)
+            {
+                LOGF(eERROR, "glTF lods: %s level %u primitive %u has %u indices outside of the vertices of the primitive", name, l, d,
+                     outsideCount);
+                ++errorCount;
+            }
+            levelIndexCounts[l] += pArgs->mIndexCount;
+        }
+
+        // The meshlets of the levels follow each other and hold the triangles of their level
+        const bool validMeshletRange = pLod->mMeshletOffset == nextMeshlet && pLod->mMeshletCount > 0 &&
+                                       (uint64_t)pLod->mMeshletOffset + pLod->mMeshletCount <= pMeshlets->mMeshletCount;
+        uint32_t   invalidMeshletCount = 0;
+        uint32_t   meshletTriangleCount = 0;
+        for (uint32_t m = 0; validMeshletRange && m < pLod->mMeshletCount; ++m)
+        {
+            const Meshlet* pMeshlet = &pGeometry->pMeshlets[pLod->mMeshletOffset + m];
+            bool           valid = (uint64_t)pMeshlet->vertexOffset + pMeshlet->vertexCount <= pMeshlets->mVertexCount &&
+                         (uint64_t)pMeshlet->triangleOffset + pMeshlet->triangleCount * 3 <= pMeshlets->mTriangleCount;
+            for (uint32_t v = 0; valid && v < pMeshlet->vertexCount; ++v)
+                valid = pGeometry->pMeshletVertices[pMeshlet->vertexOffset + v] < pGeom->mVertexCount;
+            for (uint32_t t = 0; valid && t < pMeshlet->triangleCount * 3; ++t)
+                valid = pGeometry->pMeshletTriangles[pMeshlet->triangleOffset + t] < pMeshlet->vertexCount;
+            invalidMeshletCount += valid ? 0 : 1;
+            meshletTriangleCount += pMeshlet->triangleCount;
+        }
+        if (!validMeshletRange || invalidMeshletCount || meshletTriangleCount * 3 != levelIndexCounts[l])
+        {
+            LOGF(eERROR, "glTF lods: %s level %u has meshlets %u to %u (%u invalid) with %u triangles for %u indices", name, l,
+                 pLod->mMeshletOffset, pLod->mMeshletOffset + pLod->mMeshletCount, invalidMeshletCount, meshletTriangleCount,
+                 levelIndexCounts[l]);
+            ++errorCount;
+        }
+        nextMeshlet = pLod->mMeshletOffset + pLod->mMeshletCount;
+
+        LOGF(eINFO, "glTF lods: %s level %u draws %u indices with %u meshlets, error %f", name, l, levelIndexCounts[l],
+             pLod->mMeshletCount, pLod->mError);
+    }
+
+    if (nextMeshlet != pMeshlets->mMeshletCount)
+    {
+        LOGF(eERROR, "glTF lods: %s has %llu meshlets, its levels use %u", name, (unsigned long long)pMeshlets->mMeshletCount, nextMeshlet);
+        ++errorCount;
+    }
+    if (levelIndexCounts[lodCount - 1] >= levelIndexCounts[0])
+    {
+        LOGF(eERROR, "glTF lods: %s wasn't simplified, its last level draws %u of %u indices", name, levelIndexCounts[lodCount - 1],
+             levelIndexCounts[0]);
+        ++errorCount;
+    }
+    return errorCount;
+}
+
+bool TestGLTFLods(AssetPipelineParams* assetParams)
+{
+    if (!WriteLodTestGLTF(assetParams->mRDInput))
+        return true;
+
+    VertexLayout vertexLayout = {};
+    vertexLayout.mAttribCount = 1;
+    vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+    vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
+    vertexLayout.mAttribs[0].mBinding = 0;
+    vertexLayout.mAttribs[0].mLocation = 0;
+    vertexLayout.mAttribs[0].mOffset = 0;
+
+    // Same settings as --lods 3 --loderror 0.05 --lodmeshlets
+    ProcessGLTFParams glTFParams = {};
+    glTFParams.pVertexLayout = &vertexLayout;
+    glTFParams.mIgnoreMissingAttributes = true;
+    glTFParams.mProcessMeshlets = true;
+    glTFParams.mNumMaxVertices = 64;
+    glTFParams.mNumMaxTriangles = 124;
+    glTFParams.mOptimizationFlags = MESH_OPTIMIZATION_FLAG_ALL;
+    glTFParams.mLodCount = LOD_TEST_LEVEL_COUNT;
+    glTFParams.mLodIndexRatio = 0.5f;
+    glTFParams.mLodMeshlets = true;
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(glTFParams.mLodTargetErrors); ++i)
+        glTFParams.mLodTargetErrors[i] = LOD_TEST_TARGET_ERROR;
+
+    // On the calling thread and on worker threads, the two outputs have to be identical
+    const char* subdirs[2] = { "LodTestSerial", "LodTestThreaded" };
+    const uint  threadCounts[2] = { 0, assetParams->mSettings.threadCount };
+    uint8_t*    ppFiles[2] = {};
+    size_t      fileSizes[2] = {};
+    bool        error = false;
+    for (uint32_t run = 0; run < TF_ARRAY_COUNT(subdirs) && !error; ++run)
+    {
+        AssetPipelineParams params = *assetParams;
+        params.mPathMode = PROCESS_MODE_FILE;
+        params.mInFilePath = LOD_TEST_FILE_NAME;
+        params.mInExt = "gltf";
+        params.mOutSubdir = subdirs[run];
+        params.mSettings.force = true;
+        params.mSettings.threadCount = threadCounts[run];
+        params.mThreadSystem = NULL;
+        params.pBuildCache = NULL;
+        params.pStats = NULL;
+        error = ProcessGLTF(&params, &glTFParams);
+
+        char       outFileName[FS_MAX_PATH] = {};
+        FileStream file = {};
+        fsAppendPathComponent(subdirs[run], "LodTest.bin", outFileName);
+        if (!error && fsOpenStreamFromPath(assetParams->mRDOutput, outFileName, FM_READ, &file))
+        {
+            fileSizes[run] = (size_t)max(fsGetStreamFileSize(&file), (ssize_t)0);
+            ppFiles[run] = (uint8_t*)tf_malloc(max(fileSizes[run], (size_t)1));
+            error = fsReadFromStream(&file, ppFiles[run], fileSizes[run]) != fileSizes[run];
+            fsCloseStream(&file);
+        }
+        else
+        {
+            error = true;
+        }
+
+        LodTestGeometry geometry = {};
+        if (error)
+        {
+            LOGF(eERROR, "glTF lods: couldn't process %s into %s", LOD_TEST_FILE_NAME, outFileName);
+        }
+        else if (!LoadLodTestGeometry(ppFiles[run], fileSizes[run], &geometry))
+        {
+            LOGF(eERROR, "glTF lods: %s isn't a geometry file or its sections don't match their sizes", outFileName);
+            error = true;
+        }
+        else
+        {
+            error = ValidateLodTestGeometry(&geometry, outFileName) > 0;
+        }
+        FreeLodTestGeometry(&geometry);
+    }
+
+    if (!error && (fileSizes[0] != fileSizes[1] || memcmp(ppFiles[0], ppFiles[1], fileSizes[0]) != 0))
+    {
+        LOGF(eERROR, "glTF lods: the outputs of the calling thread and of %u threads differ", threadCounts[1]);
+        error = true;
+    }
+
+    tf_free(ppFiles[0]);
+    tf_free(ppFiles[1]);
+    return error;
+}
+
+#define DECODE_BENCHMARK_GRID_SIZE         512
+#define DECODE_BENCHMARK_RUN_COUNT         8
+#define DECODE_BENCHMARK_QUANTIZATION_BITS 15
+
+typedef struct DecodeBenchmarkStream
+{
+    const char*    pName;
+    const uint8_t* pData;
+    uint32_t       mCount;
+    uint32_t       mStride;
+    bool           mIndices;
+    // Exponential filter applied before encoding like --quantize, 0 to encode the data as it is
+    uint32_t       mQuantizationBits;
+    uint32_t       mAttribOffsets[2];
+    uint32_t       mAttribSizes[2];
+    uint32_t       mAttribCount;
+} DecodeBenchmarkStream;
+
+// Grid displaced by the same height field as the glTF lods test, split in a position binding and a normal + uv binding and optimized
+// like MESH_OPTIMIZATION_FLAG_ALL so that the codecs see the vertex order of a processed file
+static void GenerateDecodeBenchmarkMesh(uint32_t size, float** ppPositions, float** ppAttributes, uint32_t** ppIndices)
+{
+    const uint32_t vertexCount = size * size;
+    const uint32_t indexCount = GetLodTestGridIndexCount(size);
+    float*         pPositions = (float*)tf_malloc(vertexCount * 3 * sizeof(float));
+    float*         pAttributes = (float*)tf_malloc(vertexCount * 5 * sizeof(float));
+    uint32_t*      pIndices = (uint32_t*)tf_malloc(indexCount * sizeof(uint32_t));
+
+    const float scale = 1.0f / (float)(size - 1);
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            const uint32_t v = y * size + x;
+            const float    u = x * scale;
+            const float    w = y * scale;
+            const float    dhdu = 0.1f * 3.0f * cosf(u * 3.0f) * cosf(w * 2.0f);
+            const float    dhdw = -0.1f * 2.0f * sinf(u * 3.0f) * sinf(w * 2.0f);
+            const float    length = sqrtf(dhdu * dhdu + 1.0f + dhdw * dhdw);
+            pPositions[v * 3 + 0] = u;
+            pPositions[v * 3 + 1] = 0.1f * sinf(u * 3.0f) * cosf(w * 2.0f);
+            pPositions[v * 3 + 2] = w;
+            pAttributes[v * 5 + 0] = -dhdu / length;
+            pAttributes[v * 5 + 1] = 1.0f / length;
+            pAttributes[v * 5 + 2] = -dhdw / length;
+            pAttributes[v * 5 + 3] = u;
+            pAttributes[v * 5 + 4] = w;
+        }
+    }
+
+    uint32_t index = 0;
+    for (uint32_t y = 0; y + 1 < size; ++y)
+    {
+        for (uint32_t x = 0; x + 1 < size; ++x)
+        {
+            const uint32_t v = y * size + x;
+            const uint32_t quad[6] = { v, v + size, v + 1, v + 1, v + size, v + size + 1 };
+            memcpy(pIndices + index, quad, sizeof(quad));
+            index += 6;
+        }
+    }
+
+    uint32_t* pRemap = (uint32_t*)tf_malloc(vertexCount * sizeof(uint32_t));
+    meshopt_optimizeVertexCache(pIndices, pIndices, indexCount, vertexCount);
+    meshopt_optimizeVertexFetchRemap(pRemap, pIndices, indexCount, vertexCount);
+    meshopt_remapIndexBuffer(pIndices, pIndices, indexCount, pRemap);
+    meshopt_remapVertexBuffer(pPositions, pPositions, vertexCount, 3 * sizeof(float), pRemap);
+    meshopt_remapVertexBuffer(pAttributes, pAttributes, vertexCount, 5 * sizeof(float), pRemap);
+    tf_free(pRemap);
+
+    *ppPositions = pPositions;
+    *ppAttributes = pAttributes;
+    *ppIndices = pIndices;
+}
+
+// The index codec keeps the triangles in order but can rotate the vertices of each of them. The vertex codec is lossless and the
+// exponential filter shares the largest frexp exponent of the components of an attribute between them, zero counts as exponent 0.
+static bool IsDecodeBenchmarkOutputValid(const DecodeBenchmarkStream* pStream, const uint8_t* pDecoded)
+{
+    if (pStream->mIndices)
+    {
+        const uint32_t* pSrc = (const uint32_t*)pStream->pData;
+        const uint32_t* pDst = (const uint32_t*)pDecoded;
+        for (uint32_t t = 0; t < pStream->mCount; t += 3)
+        {
+            bool rotated = false;
+            for (uint32_t r = 0; r < 3 && !rotated; ++r)
+                rotated = pDst[t] == pSrc[t + r] && pDst[t + 1] == pSrc[t + (r + 1) % 3] && pDst[t + 2] == pSrc[t + (r + 2) % 3];
+            if (!rotated)
+                return false;
+        }
+        return true;
+    }
+
+    if (!pStream->mQuantizationBits)
+        return memcmp(pDecoded, pStream->pData, (size_t)pStream->mCount * pStream->mStride) == 0;
+
+    for (uint32_t v = 0; v < pStream->mCount; ++v)
+    {
+        for (uint32_t a = 0; a < pStream->mAttribCount; ++a)
+        {
+            const float*   pSrc = (const float*)(pStream->pData + (size_t)v * pStream->mStride + pStream->mAttribOffsets[a]);
+            const float*   pDst = (const float*)(pDecoded + (size_t)v * pStream->mStride + pStream->mAttribOffsets[a]);
+            const uint32_t componentCount = pStream->mAttribSizes[a] / sizeof(float);
+            int            maxExponent = INT_MIN;
+            for (uint32_t c = 0; c < componentCount; ++c)
+            {
+                int exponent = 0;
+                frexpf(pSrc[c], &exponent);
+                maxExponent = max(maxExponent, exponent);
+            }
+            for (uint32_t c = 0; c < componentCount; ++c)
+            {
+                if (fabsf(pDst[c] - pSrc[c]) > ldexpf(1.0f, maxExponent - (int)pStream->mQuantizationBits))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Encodes the stream the way WriteGeometryPackedFile does, then decodes it DECODE_BENCHMARK_RUN_COUNT times the way
+// loadGeometryPackedFormat does and compares the fastest run with copying the raw data, which is what the ResourceLoader does for
+// streams that aren't encoded
+static bool RunDecodeBenchmarkStream(const DecodeBenchmarkStream* pStream, uint64_t* pRawSize, uint64_t* pEncodedSize)
+{
+    const size_t rawSize = (size_t)pStream->mCount * pStream->mStride;
+    uint8_t*     pSource = (uint8_t*)tf_malloc(rawSize);
+    uint8_t*     pDecoded = (uint8_t*)tf_malloc(rawSize);
+    uint8_t*     pStaging = (uint8_t*)tf_malloc(rawSize);
+    memcpy(pSource, pStream->pData, rawSize);
+
+    size_t   bound = 0;
+    uint8_t* pEncoded = NULL;
+    size_t   encodedSize = 0;
+    if (pStream->mIndices)
+    {
+        bound = meshopt_encodeIndexBufferBound(pStream->mCount, pStream->mCount);
+        pEncoded = (uint8_t*)tf_malloc(bound);
+        encodedSize = meshopt_encodeIndexBuffer(pEncoded, bound, (const uint32_t*)pSource, pStream->mCount);
+    }
+    else
+    {
+        if (pStream->mQuantizationBits)
+            EncodePackedVertexFilterExp(pSource, pStream->mCount, pStream->mStride, pStream->mAttribOffsets, pStream->mAttribSizes,
+                                        pStream->mAttribCount, pStream->mQuantizationBits);
+        bound = meshopt_encodeVertexBufferBound(pStream->mCount, pStream->mStride);
+        pEncoded = (uint8_t*)tf_malloc(bound);
+        encodedSize = meshopt_encodeVertexBuffer(pEncoded, bound, pSource, pStream->mCount, pStream->mStride);
+    }
+
+    int64_t decodeTime = INT64_MAX;
+    int64_t copyTime = INT64_MAX;
+    bool    error = false;
+    for (uint32_t run = 0; run < DECODE_BENCHMARK_RUN_COUNT && !error; ++run)
+    {
+        int64_t startTime = getUSec(false);
+        memcpy(pStaging, pStream->pData, rawSize);
+        copyTime = min(copyTime, getUSec(false) - startTime);
+
+        startTime = getUSec(false);
+        if (pStream->mIndices)
+            error = 0 != meshopt_decodeIndexBuffer(pStaging, pStream->mCount, pStream->mStride, pEncoded, encodedSize);
+        else if (!pStream->mQuantizationBits)
+            error = 0 != meshopt_decodeVertexBuffer(pStaging, pStream->mCount, pStream->mStride, pEncoded, encodedSize);
+        else
+        {
+            error = 0 != meshopt_decodeVertexBuffer(pDecoded, pStream->mCount, pStream->mStride, pEncoded, encodedSize);
+            meshopt_decodeFilterExp(pDecoded, pStream->mCount, pStream->mStride);
+            memcpy(pStaging, pDecoded, rawSize);
+        }
+        decodeTime = min(decodeTime, getUSec(false) - startTime);
+    }
+
+    error = error || !IsDecodeBenchmarkOutputValid(pStream, pStaging);
+    if (error)
+    {
+        LOGF(eERROR, "Decode benchmark: %s didn't decode to its source data", pStream->pName);
+    }
+    else
+    {
+        // Reading the encoded stream saves (raw - encoded) bytes of IO and costs (decode - copy) of loader thread time, it pays off as
+        // long as reading is slower than the ratio of the two
+        const double mb = 1.0 / (1024.0 * 1024.0);
+        const double decodeSeconds = max(decodeTime, (int64_t)1) / 1e6;
+        const double copySeconds = max(copyTime, (int64_t)1) / 1e6;
+        const double savedMB = (double)(rawSize - min(encodedSize, rawSize)) * mb;
+        bstring      breakEven = bempty();
+        if (decodeSeconds <= copySeconds)
+            bcatliteral(&breakEven, "always faster");
+        else
+            bformata(&breakEven, "faster below %.0f MB/s of read bandwidth", savedMB / (decodeSeconds - copySeconds));
+        LOGF(eINFO, "Decode benchmark: %-28s %7.2f MB -> %6.2f MB (%5.1f%%), decode %6.3f ms (%6.0f MB/s), copy %6.3f ms (%6.0f MB/s), %s",
+             pStream->pName, rawSize * mb, encodedSize * mb, 100.0 * encodedSize / rawSize, decodeSeconds * 1e3,
+             rawSize * mb / decodeSeconds, copySeconds * 1e3, rawSize * mb / copySeconds, (const char*)breakEven.data);
+        bdestroy(&breakEven);
+    }
+
+    *pRawSize += rawSize;
+    *pEncodedSize += encodedSize;
+    tf_free(pEncoded);
+    tf_free(pStaging);
+    tf_free(pDecoded);
+    tf_free(pSource);
+    return error;
+}
+
+bool TestMeshDecode(AssetPipelineParams* assetParams)
+{
+    UNREF_PARAM(assetParams);
+
+    float*    pPositions = NULL;
+    float*    pAttributes = NULL;
+    uint32_t* pIndices = NULL;
+    GenerateDecodeBenchmarkMesh(DECODE_BENCHMARK_GRID_SIZE, &pPositions, &pAttributes, &pIndices);
+
+    const uint32_t              vertexCount = DECODE_BENCHMARK_GRID_SIZE * DECODE_BENCHMARK_GRID_SIZE;
+    const uint32_t              indexCount = GetLodTestGridIndexCount(DECODE_BENCHMARK_GRID_SIZE);
+    const uint32_t              bits = DECODE_BENCHMARK_QUANTIZATION_BITS;
+    const DecodeBenchmarkStream streams[] = {
+        { "indices", (const uint8_t*)pIndices, indexCount, sizeof(uint32_t), true, 0, {}, {}, 0 },
+        { "positions", (const uint8_t*)pPositions, vertexCount, 12, false, 0, { 0 }, { 12 }, 1 },
+        { "normals + uvs", (const uint8_t*)pAttributes, vertexCount, 20, false, 0, { 0, 12 }, { 12, 8 }, 2 },
+        { "positions --quantize", (const uint8_t*)pPositions, vertexCount, 12, false, bits, { 0 }, { 12 }, 1 },
+        { "normals + uvs --quantize", (const uint8_t*)pAttributes, vertexCount, 20, false, bits, { 0, 12 }, { 12, 8 }, 2 },
+    };
+
+    // Totals of the streams a file would hold with --compress and with --compress --quantize
+    uint64_t rawSizes[2] = {};
+    uint64_t encodedSizes[2] = {};
+    bool     error = false;
+    for (uint32_t s = 0; s < TF_ARRAY_COUNT(streams); ++s)
+    {
+        const uint32_t variant = streams[s].mQuantizationBits ? 1 : 0;
+        error = RunDecodeBenchmarkStream(&streams[s], &rawSizes[variant], &encodedSizes[variant]) || error;
+        if (streams[s].mIndices)
+        {
+            rawSizes[1] += rawSizes[0];
+            encodedSizes[1] += encodedSizes[0];
+        }
+    }
+
+    LOGF(eINFO, "Decode benchmark: %u vertices, %u indices, --compress reads %.1f%% of the raw streams, --compress --quantize %u %.1f%%",
+         vertexCount, indexCount, 100.0 * encodedSizes[0] / rawSizes[0], bits, 100.0 * encodedSizes[1] / rawSizes[1]);
+
+    tf_free(pIndices);
+    tf_free(pAttributes);
+    tf_free(pPositions);
+    return error;
+}
@@ -30,7 +30,9 @@
 
 #include "../../../Resources/ResourceLoader/Interfaces/IResourceLoader.h"
 #include "../../../Utilities/Interfaces/IFileSystem.h"
+#include "../../../Utilities/Interfaces/IThread.h"
 #include "../../../Utilities/Interfaces/IToolFileSystem.h"
+#include "../../../Utilities/Threading/ThreadSystem.h"
 
 #include "AssetPipelineConfig.h"
 
@@ -63,8 +65,46 @@ struct ProcessAssetsSettings
     bool quiet;               // Only output warnings.
     bool force;               // Force all assets to be processed.
     uint minLastModifiedTime; // Force all assets older than this to be processed.
+    uint threadCount;         // Worker threads of the processes that support it (ProcessTextures, ProcessGLTF), 0 uses the calling thread.
+    bool useBuildCache;       // Detect stale outputs with the content hashes of the build cache database instead of modification times.
+    bool useSharedBuildCache; // Also fetch/store outputs by hash in AssetPipelineParams::mRDSharedBuildCache, requires useBuildCache.
 };
 
+// Content hash build cache
+// The database in the output directory stores, for each output file, the hash of the input contents and processing settings it was
+// built from. Outputs are skipped when that hash didn't change, unlike modification times this survives checkouts and file copies and
+// notices settings changes. With the shared cache outputs are also stored under their hash in a directory that other machines or
+// checkouts can point to, they copy the output from there instead of processing the input again.
+#define BUILD_CACHE_DATABASE_FILE_NAME "AssetPipelineBuildCache.txt"
+#define BUILD_CACHE_HASH_SEED          0xcbf29ce484222325ull
+
+typedef struct BuildCache BuildCache;
+
+// Results of DirectorySearch shared between the steps of a manifest (see AssetPipelineCmd -manifest), so that every input directory
+// is only scanned once per run. Steps invalidate the scans of their output directory once they ran.
+typedef struct DirectoryScanCache DirectoryScanCache;
+
+// Filled by the processes when AssetPipelineParams::pStats is set
+typedef struct AssetPipelineStats
+{
+    uint32_t mCheckedCount; // Assets looked at
+    uint32_t mRebuiltCount; // Assets that were processed again, the others were up to date
+    bstring* pRebuiltFiles; // stbds array with the names of the rebuilt assets
+} AssetPipelineStats;
+
+// Wall time, CPU time and bytes of the stages of every processed file, filled when AssetPipelineParams::pProfile is set. Written as a
+// JSON report and as a Chrome trace (see AssetPipelineCmd --report and --trace).
+typedef struct AssetPipelineProfile AssetPipelineProfile;
+
+// One stage of one file, see BeginAssetPipelineScope
+typedef struct AssetPipelineScope
+{
+    const char* pStage;
+    const char* pFileName;
+    int64_t     mStartTime;
+    int64_t     mStartCpuTime;
+} AssetPipelineScope;
+
 enum AssetPipelineProcess
 {
     PROCESS_ANIMATIONS,
@@ -73,6 +113,7 @@ enum AssetPipelineProcess
     PROCESS_TEXTURES,
     PROCESS_WRITE_ZIP,
     PROCESS_WRITE_ZIP_ALL,
+    PROCESS_PACK_TEXTURES,
 };
 
 struct AssetPipelineProcessCommand
@@ -108,6 +149,20 @@ struct AssetPipelineParams
 
     // TODO looks like this directory is always set to nothing
     ResourceDirectory mRDZipWrite;
+
+    // Directory of the shared build cache, only used with ProcessAssetsSettings::useSharedBuildCache
+    ResourceDirectory mRDSharedBuildCache;
+    // Loaded by AssetPipelineRun when ProcessAssetsSettings::useBuildCache is set, NULL otherwise
+    BuildCache*       pBuildCache;
+
+    // Optional, worker threads shared by several runs. Processes that support threads create their own when NULL
+    ThreadSystem          mThreadSystem;
+    // Optional, DirectorySearch results shared by several runs
+    DirectoryScanCache*   pDirectoryScanCache;
+    // Optional, receives which assets were rebuilt
+    AssetPipelineStats*   pStats;
+    // Optional, receives the time spent in the stages of every file
+    AssetPipelineProfile* pProfile;
 };
 
 struct SkeletonAndAnimations
@@ -154,7 +209,8 @@ typedef enum ASTC
 typedef enum TextureContainer
 {
     CONTAINER_DDS,
-    CONTAINER_KTX
+    CONTAINER_KTX,
+    CONTAINER_KTX2
 #ifdef PROSPERO_GNF
     ,
     CONTAINER_GNF_ORBIS,
@@ -166,6 +222,9 @@ typedef enum TextureContainer
 #endif
 } TextureContainer;
 
+// zstd level of --out-ktx2, decompression speed doesn't depend on it so favor the ratio
+#define KTX2_DEFAULT_SUPERCOMPRESSION_LEVEL 19
+
 typedef enum TextureMipmap
 {
     MIPMAP_DEFAULT,
@@ -184,7 +243,21 @@ typedef struct ProcessedTextureData
     uint32_t mFormat;
 } ProcessedTextureData;
 
+typedef enum TextureMipmapFilter
+{
+    // stb_image_resize default filter for 8 bit formats, MIPMAP_FILTER_BOX for 16/32 bit float formats
+    MIPMAP_FILTER_DEFAULT,
+    // 2x2 average
+    MIPMAP_FILTER_BOX,
+    // Kaiser windowed sinc, sharper than the box filter
+    MIPMAP_FILTER_KAISER,
+} TextureMipmapFilter;
+
 void GenerateMipmaps(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextDesc);
+// Box and Kaiser filters run SSE/AVX2/NEON kernels selected at runtime on R8-R8G8B8A8 UNORM/SRGB, 16 bit and 32 bit float formats,
+// sRGB color channels are filtered in linear space
+void GenerateMipmapsWithFilter(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextDesc,
+                               TextureMipmapFilter filter);
 
 typedef void (*GenerateMipmapsCallback)(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextureDesc,
                                         uint32_t channelsCount, void* pUserData);
@@ -193,11 +266,14 @@ typedef struct ProcessTexturesParams
 {
     const char*             mInExt;
     TextureContainer        mContainer;
+    // zstd level used to supercompress the mips of KTX2 textures, 0 stores them uncompressed
+    int                     mSupercompressionLevel;
     TextureCompression      mCompression;
     ASTC                    mOverrideASTC;
     DXT                     mOverrideBC;
     bool                    mInputLinearColorSpace;
     TextureMipmap           mGenerateMipmaps;
+    TextureMipmapFilter     mMipmapFilter; // Filter of MIPMAP_DEFAULT
     GenerateMipmapsCallback pGenerateMipmapsCallback;
     void*                   pCallbackUserData;
 
@@ -209,13 +285,45 @@ typedef struct ProcessTexturesParams
     ProcessedTextureData** ppOutProcessedTextureData;
 } ProcessTexturesParams;
 
+typedef enum TexturePackMode
+{
+    // One layer per input, inputs need the same size
+    TEXTURE_PACK_ARRAY,
+    // Inputs placed side by side in one 2D texture
+    TEXTURE_PACK_ATLAS,
+} TexturePackMode;
+
+// Default pixels around every atlas entry, 4 keeps 3 mip levels free of bleeding from the neighbours
+#define TEXTURE_PACK_DEFAULT_PADDING 4
+
+typedef struct PackTexturesParams
+{
+    TexturePackMode mMode;
+    // Name of the packed texture (.tex) and of its lookup table (.json) in the output directory, without extension
+    const char*     pOutName;
+    // Only the input files whose name matches are packed, '*' matches any characters and '?' one character. NULL packs every file.
+    const char*     pFilter;
+    // Atlas only, edge pixels of every entry replicated around it. Generated mips stop at the level where the padding is 1 pixel.
+    uint32_t        mPadding;
+} PackTexturesParams;
+
 struct ProcessTressFXParams
 {
     uint32_t mFollowHairCount;
     float    mMaxRadiusAroundGuideHair;
     float    mTipSeperationFactor;
+    // Strand levels of detail after the full one, up to GEOMETRY_MAX_LODS - 1. Levels are prefixes of the vertex and index buffers,
+    // the strands are stored guides first and then the follow hairs of every guide in order. A level is picked at load time with
+    // GeometryLoadDesc::mStrandLod.
+    uint32_t mLodCount;
+    // Fraction of the strands kept by each level relative to the previous one
+    float    mLodStrandRatio;
+    // Positions stored as 16 bit unorm relative to the bounds written in the asset extras
+    bool     mQuantizePositions;
 };
 
+#define TRESSFX_DEFAULT_LOD_STRAND_RATIO 0.5f
+
 struct WriteZipParams
 {
     const char* mFilters[MAX_FILTERS];
@@ -283,6 +391,21 @@ struct ProcessGLTFParams
     int  mNumMaxVertices;
     int  mNumMaxTriangles;
     MeshOptimizerFlags mOptimizationFlags;
+    bool               mWritePackedFormat; // Write GeometryPackedFileHeader containers that can be memory mapped and uploaded without parsing
+    // Encode the index and vertex sections of the packed format with the meshoptimizer codecs, requires mWritePackedFormat.
+    // When mQuantizationBits is not 0, bindings made only of 32 bit floats keep that many mantissa bits (1 to 24) so they encode better.
+    bool     mCompressStreams;
+    uint32_t mQuantizationBits;
+
+    // Level of detail chain stored in Geometry::pLods, each primitive is simplified into mLodCount levels after the full resolution one.
+    // Level i targets mLodIndexRatio^i of the primitive indices (0 uses 0.5) and stops earlier when the simplification error would
+    // exceed mLodTargetErrors[i - 1], relative to the mesh extents (0 uses 0.01).
+    uint32_t mLodCount;
+    float    mLodIndexRatio;
+    float    mLodTargetErrors[GEOMETRY_MAX_LODS - 1];
+    bool     mLodMeshlets; // Also build meshlets for the simplified levels, requires mProcessMeshlets
+    // Store the meshlet bounds and normal cones as MeshletDataQuantized (16 bytes instead of 48), requires mProcessMeshlets
+    bool     mQuantizeMeshletData;
 
     // Callbacks to process custom data fields in the gltf file
     // (fields custom to a project or generated by a custom tool/plugin)
@@ -298,15 +421,87 @@ void ReleaseSkeletonAndAnimationParams(SkeletonAndAnimations* pStbdsArray);
 
 void CreateDirectoryForFile(ResourceDirectory resourceDir, const char* filename);
 
+// 64 bit FNV-1a, stable across platforms so hashes can be shared between machines
+uint64_t BuildCacheHash(uint64_t hash, const void* pData, size_t size);
+// Accumulates the contents of the file into pHash, returns false if the file couldn't be read
+bool     BuildCacheHashFile(ResourceDirectory resourceDir, const char* fileName, uint64_t* pHash);
+// Returns true if outFileName was built from the same hash, copies it from the shared cache when it's there but not in the output
+bool     BuildCacheIsUpToDate(AssetPipelineParams* assetParams, const char* outFileName, uint64_t hash);
+// Records that outFileName was successfully built from hash
+void     BuildCacheStore(AssetPipelineParams* assetParams, const char* outFileName, uint64_t hash);
+
 typedef void (*OnFind)(ResourceDirectory resourceDir, const char* fileName, void* pUserData);
 void DirectorySearch(ResourceDirectory resourceDir, const char* subDir, const char* ext, OnFind onFindCallback, void* pUserData,
                      bool recursive);
+// DirectorySearch of the input directory of assetParams, answered from AssetPipelineParams::pDirectoryScanCache when possible
+void InputDirectorySearch(AssetPipelineParams* assetParams, const char* ext, OnFind onFindCallback, void* pUserData);
+
+// Byte compares every file of expectedDir and its subdirectories with the file of the same path in actualDir, returns true when a file
+// differs or only exists in one of them. pFileCount receives the number of compared files.
+bool CompareAssetPipelineOutputs(ResourceDirectory expectedDir, ResourceDirectory actualDir, uint32_t* pFileCount);
+
+DirectoryScanCache* CreateDirectoryScanCache();
+// Drops the scans of directory and its subdirectories, called after writing to it
+void                InvalidateDirectoryScanCache(DirectoryScanCache* pCache, const char* directory);
+void                GetDirectoryScanCacheStats(const DirectoryScanCache* pCache, uint32_t* pHitCount, uint32_t* pMissCount);
+void                DestroyDirectoryScanCache(DirectoryScanCache* pCache);
+
+// Uses AssetPipelineParams::mThreadSystem when set, otherwise creates threadCount threads (ProcessAssetsSettings). NULL when no thread
+// could be created, the ThreadSystem functions then run tasks on the calling thread.
+ThreadSystem AcquireAssetPipelineThreadSystem(AssetPipelineParams* assetParams, const char* threadName);
+void         ReleaseAssetPipelineThreadSystem(AssetPipelineParams* assetParams, ThreadSystem* pThreadSystem);
+
+// Tasks that a task adds to its own thread system. threadSystemWaitIdle would never return there since the waiting task keeps its
+// thread busy, WaitAssetPipelineTaskGroup runs the queued tasks on the calling thread and then sleeps until the last task of the group
+// calls EndAssetPipelineTask.
+typedef struct AssetPipelineTaskGroup
+{
+    Mutex             mMutex;
+    ConditionVariable mDone;
+    uint32_t          mRemaining;
+} AssetPipelineTaskGroup;
+
+void BeginAssetPipelineTaskGroup(AssetPipelineTaskGroup* pGroup, uint32_t taskCount);
+void EndAssetPipelineTask(AssetPipelineTaskGroup* pGroup);
+// Also releases the group, works without threadSystem when the tasks ran on the calling thread
+void WaitAssetPipelineTaskGroup(ThreadSystem threadSystem, AssetPipelineTaskGroup* pGroup);
+
+// Records an asset in AssetPipelineParams::pStats, only call from the thread that called the process
+void RecordAssetPipelineAsset(AssetPipelineParams* assetParams, const char* fileName, bool rebuilt);
+
+AssetPipelineProfile* CreateAssetPipelineProfile();
+void                  DestroyAssetPipelineProfile(AssetPipelineProfile* pProfile);
+// Scopes can begin and end on any thread, stage has to outlive the profile and fileName is copied when the scope ends
+AssetPipelineScope    BeginAssetPipelineScope(AssetPipelineParams* assetParams, const char* stage, const char* fileName);
+// Records the scope in AssetPipelineParams::pProfile, returns the microseconds elapsed since it began even without a profile
+int64_t  EndAssetPipelineScope(AssetPipelineParams* assetParams, const AssetPipelineScope* pScope, uint64_t bytesIn, uint64_t bytesOut);
+// Size of the file for the bytes of a scope, 0 without a profile so that files are only opened when profiling
+uint64_t GetAssetPipelineProfileFileSize(AssetPipelineParams* assetParams, ResourceDirectory resourceDir, const char* fileName);
+// Totals per stage and every scope from the slowest, parallelism of a stage is its summed time over the time between its first start
+// and its last end
+bool     WriteAssetPipelineProfileReport(AssetPipelineProfile* pProfile, ResourceDirectory resourceDir, const char* fileName);
+// Chrome trace event format, can be opened in chrome://tracing or Perfetto
+bool     WriteAssetPipelineProfileTrace(AssetPipelineProfile* pProfile, ResourceDirectory resourceDir, const char* fileName);
+// Writes pString quoted and escaped
+void     WriteJsonString(FileStream* pFile, const char* pString);
 
 bool ProcessTFX(AssetPipelineParams* assetParams, ProcessTressFXParams* tfxParams);
 bool ProcessGLTF(AssetPipelineParams* assetParams, ProcessGLTFParams* glTFParams);
 bool ProcessTextures(AssetPipelineParams* assetParams, ProcessTexturesParams* texturesParams);
+// Packs the input textures in one texture array or atlas with a JSON table from input file names to array layers or UV rectangles.
+// Container, compression and mips come from texturesParams.
+bool PackTextures(AssetPipelineParams* assetParams, ProcessTexturesParams* texturesParams, PackTexturesParams* packParams);
 bool WriteZip(AssetPipelineParams* assetParams, WriteZipParams* zipParams);
 bool ZipAllAssets(AssetPipelineParams* assetParams, WriteZipParams* zipParams);
 
 // Error code 0 means success, see AssetPipelineErrorCode for other codes
 int AssetPipelineRun(AssetPipelineParams* assetParams);
+
+// Self tests and benchmarks of the -test command, they return true on error like the processes. AssetPipelineParams::mRDOutput is a
+// scratch directory and mSettings.threadCount the most worker threads a test may use.
+typedef bool (*AssetPipelineTestFunc)(AssetPipelineParams* assetParams);
+
+bool TestMipmapFilters(AssetPipelineParams* assetParams);
+bool TestCompressionScaling(AssetPipelineParams* assetParams);
+bool TestGLTFLods(AssetPipelineParams* assetParams);
+bool TestMeshDecode(AssetPipelineParams* assetParams);
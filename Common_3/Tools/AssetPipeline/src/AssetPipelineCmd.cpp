@@ -23,14 +23,36 @@
  */
 
 #include "../../../Utilities/Interfaces/ILog.h"
+#include "../../../Utilities/Interfaces/IThread.h"
+#include "../../../Utilities/Interfaces/ITime.h"
+#include "../../../Utilities/ThirdParty/OpenSource/Nothings/stb_ds.h"
 
 #include "AssetPipeline.h"
 
+#include "../../../Utilities/Interfaces/IMemory.h" //NOTE: this should be the last include in a .cpp
+
 const char* gApplicationName = "AssetPipeline";
 
 const AssetPipelineProcessCommand gAssetPipelineCommands[] = {
     { "-pa", PROCESS_ANIMATIONS }, { "-ptfx", PROCESS_TFX },      { "-pgltf", PROCESS_GLTF },
     { "-pt", PROCESS_TEXTURES },   { "-pwz", PROCESS_WRITE_ZIP }, { "-pwza", PROCESS_WRITE_ZIP_ALL },
+    { "-ppt", PROCESS_PACK_TEXTURES },
+};
+
+typedef struct AssetPipelineTest
+{
+    const char*           pName;
+    const char*           pDescription;
+    AssetPipelineTestFunc pFunc;
+} AssetPipelineTest;
+
+const AssetPipelineTest gAssetPipelineTests[] = {
+    { "mipfilters", "SIMD mipmap kernels against the scalar ones on every format of the box and Kaiser filters", TestMipmapFilters },
+    { "compressscaling", "BC1, BC7 and ASTC 4x4 compression time of a 2048x2048 mip chain on 1 to --threads threads, outputs compared",
+      TestCompressionScaling },
+    { "gltflods", "Processes a generated glTF with --lods --lodmeshlets and checks the draw arguments, levels and meshlets of every level",
+      TestGLTFLods },
+    { "meshdecode", "Decode throughput of the --compress index and vertex codecs against the read size they save", TestMeshDecode },
 };
 
 void PrintHelp()
@@ -43,6 +65,12 @@ void PrintHelp()
     printf("\n\t\t--fhc | -followhaircount\t\t: Number of follow hairs around loaded guide hairs procedually\n");
     printf("\t\t--tsf | -tipseparationfactor\t: Separation factor for the follow hairs\n");
     printf("\t\t--maxradius | -maxradius\t\t: Max radius of the random distribution to generate follow hairs\n");
+    printf("\t\t--lods [count]\t\t: Strand levels of detail, each one is the first strands of the vertex and index buffers, up to %d. "
+           "Loaded with GeometryLoadDesc::mStrandLod\n",
+           GEOMETRY_MAX_LODS - 1);
+    printf("\t\t--lodratio [ratio]\t: Fraction of the strands kept by each level relative to the previous one | default %.1f\n",
+           TRESSFX_DEFAULT_LOD_STRAND_RATIO);
+    printf("\t\t--quantize\t\t: Stores positions as 16 bit unorm relative to their bounds\n");
     printf("\n\t%s\t(GLTF to bin)\tProcessGLTF\n", gAssetPipelineCommands[PROCESS_GLTF].mCommandString);
     printf("\n\t\t--hair\t\t: Processes the mesh as a hair mesh\n");
     printf("\n\t\t--optimize\t\t: Enables all supported mesh optimization techniques\n");
@@ -53,12 +81,32 @@ void PrintHelp()
            "and 256 respectively\n");
     printf("\n\t\t--meshletnumvertices [num]\t\t: Overrides maximum number of vertices in each meshlet\n");
     printf("\n\t\t--meshletnumtriangles [num]\t\t: Overrides maximum number of triangles in each meshlet\n");
-    printf("\n\t%s\t(PNG/DDS/KTX to DDS/KTX)\tProcess Textures\n", gAssetPipelineCommands[PROCESS_TEXTURES].mCommandString);
+    printf("\n\t\t--packed\t\t: Writes the versioned packed format, index and vertex data is stored in the GPU layout\n");
+    printf("\n\t\t--compress\t\t: Encodes the index and vertex data of the packed format with the meshoptimizer codecs\n");
+    printf("\n\t\t--quantize [bits]\t\t: Keeps bits (1 to 24) of mantissa for float vertex data, requires --compress\n");
+    printf("\n\t\t--lods [count]\t\t: Generates count simplified levels of detail per mesh, up to %d\n", GEOMETRY_MAX_LODS - 1);
+    printf("\n\t\t--lodratio [ratio]\t\t: Fraction of the indices kept by each level relative to the previous one | default 0.5\n");
+    printf("\n\t\t--loderror [error]\t\t: Maximum simplification error relative to the mesh extents | default 0.01\n");
+    printf("\n\t\t--lodmeshlets\t\t: Also generates meshlets for the levels of detail, requires --meshlets\n");
+    printf("\n\t\t--meshletquantize\t\t: Stores meshlet bounds and cones quantized to 16 bytes per meshlet, requires --meshlets\n");
+    printf("\n\t%s\t(PNG/DDS/KTX to DDS/KTX/KTX2)\tProcess Textures\n", gAssetPipelineCommands[PROCESS_TEXTURES].mCommandString);
+    printf("\n\t\t--out-ktx2\t Write KTX2 textures with zstd supercompressed mips | --out-ktx2-raw stores the mips uncompressed\n");
     printf("\n\t\t--astc\t\t Perform ASTC compression | default astc4x4 | overrides --astc4x4 --astc8x8 \n");
     printf("\n\t\t--bc\t\t Perform DXT BC compression | default bc3 | overrides --bc1 --bc3 --bc4 --bc5 --bc7\n");
     printf("\n\t\t--genmips\t Generate mip maps if not existing \n");
+    printf("\n\t\t--mipfilter-box\t Generate mip maps with a box filter (SIMD) \n");
+    printf("\n\t\t--mipfilter-kaiser\t Generate mip maps with a Kaiser filter (SIMD) \n");
     printf("\n\t\t--in-linear\t\t Specify input Color space as Linear \n");
     printf("\n\t\t--vmf [RoughnessFileName]\t\t Create vMF filtered normal mipmaps using given roughness texture \n");
+    printf("\n\t%s\t(textures to one DDS/KTX/KTX2 + JSON)\tPack Textures\n", gAssetPipelineCommands[PROCESS_PACK_TEXTURES].mCommandString);
+    printf("\n\t\tTakes the flags of %s, writes a lookup table from input names to layers or UV rectangles\n",
+           gAssetPipelineCommands[PROCESS_TEXTURES].mCommandString);
+    printf("\n\t\t--array\t\t One layer per texture, the textures need the same size | default\n");
+    printf("\n\t\t--atlas\t\t Textures placed side by side in one 2D texture\n");
+    printf("\n\t\t--name [name]\t Name of the packed texture and lookup table | default TexturePack\n");
+    printf("\n\t\t--filter [pattern]\t Only pack the files whose name matches, supports * and ?\n");
+    printf("\n\t\t--padding [pixels]\t Edge pixels replicated around atlas entries, mips stop at 1 pixel | default %d\n",
+           TEXTURE_PACK_DEFAULT_PADDING);
     printf("\n\t%s\t(filtered zip)\tProcessWriteZip\n", gAssetPipelineCommands[PROCESS_WRITE_ZIP].mCommandString);
     printf("\n\t\t--filter [extension filters]\t: Only zip files with the chosen extensions\n");
     printf("\n\t%s\t(folder to zip)\tProcessWriteZipAll\n", gAssetPipelineCommands[PROCESS_WRITE_ZIP_ALL].mCommandString);
@@ -69,36 +117,57 @@ void PrintHelp()
     printf("\n\t--output [path]\t\t\t: Choose output folder\n");
     printf("\n\t--quiet\t\t\t: Print only error messages\n");
     printf("\n\t--force\t\t\t: Force all assets to be processed\n");
+    printf("\n\t--threads [count]\t: Process independent assets on worker threads | 0 uses one thread per CPU core\n");
+    printf("\n\t--build-cache\t\t: Skip outputs whose input contents and settings hashes didn't change instead of comparing modification "
+           "times (ProcessTextures, ProcessGLTF) | database stored in the output folder as %s\n",
+           BUILD_CACHE_DATABASE_FILE_NAME);
+    printf("\n\t--verify-threads\t: Processes every asset on worker threads, then on the calling thread into [output]_serial, fails when "
+           "the outputs aren't identical | implies --force\n");
+    printf("\n\t--cache-dir [path]\t: Share outputs by hash with other machines/checkouts through this folder | implies --build-cache\n");
+    printf("\n\t--report [path]\t\t: Writes a JSON report of the wall time, CPU time and bytes in and out of every stage and file\n");
+    printf("\n\t--trace [path]\t\t: Writes the stages of every file as a Chrome trace (chrome://tracing, Perfetto)\n");
+    printf("\nManifest:\n");
+    printf("\n\t-manifest [file] [options]\t: Runs every step of the manifest file in one process, one step per line:\n");
+    printf("\t\t<step name> [dependency names] : <command> [flags]\n");
+    printf("\t\tSteps run after the steps they depend on and are skipped when one of them fails, '#' starts a comment\n");
+    printf("\n\t\t--summary [path]\t: Writes a JSON summary of the time and rebuilt assets of every step\n");
+    printf("\n\t\t--threads [count]\t: Worker threads shared by all the steps | 0 uses one thread per CPU core\n");
+    printf("\n\t\t--report [path], --trace [path]\t: Profile of all the steps, see the common options\n");
+    printf("\n\t\t--quiet, --force, --build-cache\t: Apply to every step\n");
+    printf("\nTests:\n");
+    printf("\n\t-test [options]\t: Runs the self tests and benchmarks, fails when one of them fails:\n");
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(gAssetPipelineTests); ++i)
+        printf("\t\t%s\t: %s\n", gAssetPipelineTests[i].pName, gAssetPipelineTests[i].pDescription);
+    printf("\n\t\t--filter [name]\t: Only runs the tests whose name contains name\n");
+    printf("\n\t\t--output [path]\t: Scratch folder of the tests | default AssetPipelineTests\n");
+    printf("\n\t\t--threads [count]\t: Most worker threads used by the tests | 0 uses one thread per CPU core\n");
+    printf("\n\t\t--quiet\t: Print only error messages\n");
 }
 
-int AssetPipelineCmd(int argc, char** argv)
+// Arguments of one command, the paths point to the arguments or to the buffers of this structure
+typedef struct AssetPipelineCommand
 {
-    if (argc == 1)
-    {
-        PrintHelp();
-        return 0;
-    }
-
-    if (stricmp(argv[1], "-h") == 0 || stricmp(argv[1], "-help") == 0)
-    {
-        PrintHelp();
-        return 0;
-    }
-
-    if (argc < 2)
-    {
-        printf("Invalid command.\n");
-        return 0;
-    }
+    AssetPipelineParams mParams;
+    const char*         pInput;
+    const char*         pOutput;
+    const char*         pSharedBuildCacheDir;
+    const char*         pReportPath;
+    const char*         pTracePath;
+    bool                mValidCommand;
+    bool                mVerifyThreads;
 
-    if (!initMemAlloc(gApplicationName))
-        return EXIT_FAILURE;
+    char mFilePath[FS_MAX_PATH];
+    char mFileName[FS_MAX_PATH];
+    char mExt[FS_MAX_PATH];
+} AssetPipelineCommand;
 
-    const char* input = "";
-    const char* output = "";
+// argv[0] is the command, the rest are its options and flags
+static bool ParseAssetPipelineCommand(int argc, char** argv, AssetPipelineCommand* pCommand)
+{
+    AssetPipelineParams& params = pCommand->mParams;
+    const char*          input = "";
 
-    // Parse commands, fill params
-    AssetPipelineParams params = {};
+    params = {};
     params.mSettings.force = false;
     params.mSettings.quiet = false;
     params.mInFilePath = input;
@@ -109,13 +178,18 @@ int AssetPipelineCmd(int argc, char** argv)
     params.mRDInput = RD_MIDDLEWARE_1;
     params.mRDOutput = RD_MIDDLEWARE_2;
     params.mRDZipWrite = RD_MIDDLEWARE_3;
+    params.mRDSharedBuildCache = RD_MIDDLEWARE_4;
+
+    pCommand->pOutput = "";
+    pCommand->pSharedBuildCacheDir = "";
+    pCommand->pReportPath = NULL;
+    pCommand->pTracePath = NULL;
+    pCommand->mValidCommand = false;
+    pCommand->mVerifyThreads = false;
 
-    char filePath[FS_MAX_PATH] = { 0 };
     char fileNameWithoutExt[FS_MAX_PATH] = { 0 };
-    char fileName[FS_MAX_PATH] = { 0 };
-    char iext[FS_MAX_PATH] = { 0 };
 
-    for (int i = 2; i < argc; ++i)
+    for (int i = 1; i < argc; ++i)
     {
         const char* arg = argv[i];
 
@@ -132,33 +206,33 @@ int AssetPipelineCmd(int argc, char** argv)
             if (params.mPathMode == PROCESS_MODE_DIRECTORY_RECURSIVE)
             {
                 LOGF(eERROR, "--recursive flag not allowed on single file mode");
-                return 1;
+                return false;
             }
 
             i++;
             params.mPathMode = PROCESS_MODE_FILE;
             fsGetPathFileName(argv[i], fileNameWithoutExt);
-            fsGetPathExtension(argv[i], iext);
-            params.mInExt = iext;
-            fsAppendPathExtension(fileNameWithoutExt, iext, fileName);
-            params.mInFilePath = fileName;
+            fsGetPathExtension(argv[i], pCommand->mExt);
+            params.mInExt = pCommand->mExt;
+            fsAppendPathExtension(fileNameWithoutExt, pCommand->mExt, pCommand->mFileName);
+            params.mInFilePath = pCommand->mFileName;
 
-            fsGetParentPath(argv[i], filePath);
-            input = filePath;
+            fsGetParentPath(argv[i], pCommand->mFilePath);
+            input = pCommand->mFilePath;
         }
         else if (STRCMP(arg, "--recursive"))
         {
             if (params.mPathMode == PROCESS_MODE_FILE)
             {
                 LOGF(eERROR, "--recursive flag not allowed on single file mode");
-                return 1;
+                return false;
             }
 
             params.mPathMode = PROCESS_MODE_DIRECTORY_RECURSIVE;
         }
         else if (STRCMP(arg, "--output"))
         {
-            output = argv[++i];
+            pCommand->pOutput = argv[++i];
         }
         else if (STRCMP(arg, "--quiet"))
         {
@@ -168,18 +242,430 @@ int AssetPipelineCmd(int argc, char** argv)
         {
             params.mSettings.force = true;
         }
+        else if (STRCMP(arg, "--threads") && i + 1 < argc)
+        {
+            const int threadCount = atoi(argv[++i]);
+            params.mSettings.threadCount = threadCount > 0 ? (uint)threadCount : getNumCPUCores();
+        }
+        else if (STRCMP(arg, "--build-cache"))
+        {
+            params.mSettings.useBuildCache = true;
+        }
+        else if (STRCMP(arg, "--verify-threads"))
+        {
+            pCommand->mVerifyThreads = true;
+        }
+        else if (STRCMP(arg, "--cache-dir") && i + 1 < argc)
+        {
+            params.mSettings.useBuildCache = true;
+            params.mSettings.useSharedBuildCache = true;
+            pCommand->pSharedBuildCacheDir = argv[++i];
+        }
+        else if (STRCMP(arg, "--report") && i + 1 < argc)
+        {
+            pCommand->pReportPath = argv[++i];
+        }
+        else if (STRCMP(arg, "--trace") && i + 1 < argc)
+        {
+            pCommand->pTracePath = argv[++i];
+        }
         else
         {
             params.mFlags[params.mFlagsCount++] = argv[i];
         }
     }
 
+    pCommand->pInput = input;
     params.mInDir = input;
-    params.mOutDir = output;
+    params.mOutDir = pCommand->pOutput;
+
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(gAssetPipelineCommands); ++i)
+    {
+        if (STRCMP(argv[0], gAssetPipelineCommands[i].mCommandString))
+        {
+            params.mProcessType = gAssetPipelineCommands[i].mProcessType;
+            pCommand->mValidCommand = true;
+            break;
+        }
+    }
+
+    return true;
+}
+
+// Requires the file system, sets the resource directories of the command before running it
+static int RunAssetPipelineCommand(AssetPipelineCommand* pCommand)
+{
+    AssetPipelineParams* pParams = &pCommand->mParams;
+
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, pParams->mRDInput, pCommand->pInput);
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, pParams->mRDOutput, pCommand->pOutput);
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, pParams->mRDSharedBuildCache, pCommand->pSharedBuildCacheDir);
+
+    // Make sure output folder exists before starting the pipeline
+    if (!fsCreateDirectory(pParams->mRDOutput, "", true) ||
+        (pParams->mSettings.useSharedBuildCache && !fsCreateDirectory(pParams->mRDSharedBuildCache, "", true)))
+    {
+        LOGF(eERROR, "Couldn't create output directory '%s'.", pCommand->pOutput);
+        return ASSET_PIPELINE_GENERAL_FAILURE;
+    }
+
+    return AssetPipelineRun(pParams);
+}
+
+// Runs the command on worker threads, then on the calling thread into "<output>_serial" and compares every output file of the two runs.
+// Uses RD_MIDDLEWARE_5 for the second output, the manifest only needs it before its steps run.
+static int VerifyAssetPipelineThreads(AssetPipelineCommand* pCommand)
+{
+    AssetPipelineParams* pParams = &pCommand->mParams;
+    const char*          threadedOutput = pCommand->pOutput;
+    const uint           threadCount = pParams->mSettings.threadCount ? pParams->mSettings.threadCount : getNumCPUCores();
+
+    // Both runs have to write every output
+    pParams->mSettings.force = true;
+    pParams->mSettings.useBuildCache = false;
+    pParams->mSettings.useSharedBuildCache = false;
+    pParams->mSettings.threadCount = threadCount;
+    int ret = RunAssetPipelineCommand(pCommand);
+    if (ret != ASSET_PIPELINE_SUCCESS)
+        return ret;
+
+    // Sibling of the output folder, a trailing separator would put it inside
+    char   serialOutput[FS_MAX_PATH] = {};
+    size_t length = strlen(threadedOutput);
+    while (length && (threadedOutput[length - 1] == '/' || threadedOutput[length - 1] == '\\'))
+        --length;
+    snprintf(serialOutput, sizeof(serialOutput), "%.*s_serial", (int)length, threadedOutput);
+
+    // A manifest shares its thread system with the steps
+    const ResourceDirectory threadedDir = pParams->mRDOutput;
+    ThreadSystem            threadSystem = pParams->mThreadSystem;
+    pCommand->pOutput = serialOutput;
+    pParams->mOutDir = serialOutput;
+    pParams->mRDOutput = RD_MIDDLEWARE_5;
+    pParams->mThreadSystem = NULL;
+    pParams->mSettings.threadCount = 0;
+    ret = RunAssetPipelineCommand(pCommand);
+    pCommand->pOutput = threadedOutput;
+    pParams->mOutDir = threadedOutput;
+    pParams->mRDOutput = threadedDir;
+    pParams->mThreadSystem = threadSystem;
+    if (ret != ASSET_PIPELINE_SUCCESS)
+        return ret;
+
+    uint32_t fileCount = 0;
+    if (CompareAssetPipelineOutputs(RD_MIDDLEWARE_5, threadedDir, &fileCount))
+    {
+        LOGF(eERROR, "Outputs of %u threads differ from the outputs of the calling thread in '%s'", threadCount, serialOutput);
+        return ASSET_PIPELINE_GENERAL_FAILURE;
+    }
+
+    LOGF(eINFO, "%u output files are identical with %u threads and on the calling thread", fileCount, threadCount);
+    return ASSET_PIPELINE_SUCCESS;
+}
+
+// Points resourceDir to the parent folder of path, pFileName receives the file name with its extension
+static void SetResourceDirForPath(ResourceDirectory resourceDir, const char* path, char* pFileName)
+{
+    char parent[FS_MAX_PATH] = {};
+    char name[FS_MAX_PATH] = {};
+    char ext[FS_MAX_PATH] = {};
+    fsGetParentPath(path, parent);
+    fsGetPathFileName(path, name);
+    fsGetPathExtension(path, ext);
+    fsAppendPathExtension(name, ext, pFileName);
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, resourceDir, parent);
+}
+
+// Writes the report and the trace of the profile to the paths that are set
+static void WriteProfile(AssetPipelineProfile* pProfile, const char* reportPath, const char* tracePath)
+{
+    const ResourceDirectory profileDir = RD_MIDDLEWARE_6;
+    char                    fileName[FS_MAX_PATH] = {};
+    if (reportPath)
+    {
+        SetResourceDirForPath(profileDir, reportPath, fileName);
+        if (WriteAssetPipelineProfileReport(pProfile, profileDir, fileName))
+            LOGF(eINFO, "Wrote profile report '%s'", reportPath);
+    }
+    if (tracePath)
+    {
+        SetResourceDirForPath(profileDir, tracePath, fileName);
+        if (WriteAssetPipelineProfileTrace(pProfile, profileDir, fileName))
+            LOGF(eINFO, "Wrote profile trace '%s'", tracePath);
+    }
+}
+
+/************************************************************************/
+// Manifest
+/************************************************************************/
+typedef enum ManifestStepStatus
+{
+    MANIFEST_STEP_PENDING,
+    MANIFEST_STEP_SUCCEEDED,
+    MANIFEST_STEP_FAILED,
+    MANIFEST_STEP_SKIPPED,
+} ManifestStepStatus;
+
+static const char* gManifestStepStatusNames[] = { "pending", "succeeded", "failed", "skipped" };
+
+typedef struct ManifestStep
+{
+    const char*        pName;
+    char**             ppDependencies; // stbds array, names of the steps that have to succeed first
+    char**             ppArgs;         // stbds array, command followed by its options and flags
+    uint32_t           mLine;
+    ManifestStepStatus mStatus;
+    int64_t            mTime; // Microseconds
+    AssetPipelineStats mStats;
+} ManifestStep;
+
+// Splits the line in place into whitespace separated tokens, double quotes group tokens with spaces
+static void TokenizeManifestLine(char* pLine, char*** pppTokens)
+{
+    char* pCursor = pLine;
+    while (*pCursor)
+    {
+        while (*pCursor == ' ' || *pCursor == '\t' || *pCursor == '\r')
+            ++pCursor;
+        if (!*pCursor || *pCursor == '#')
+            break;
+
+        const bool quoted = *pCursor == '"';
+        char*      pToken = quoted ? ++pCursor : pCursor;
+        while (*pCursor && (quoted ? *pCursor != '"' : (*pCursor != ' ' && *pCursor != '\t' && *pCursor != '\r')))
+            ++pCursor;
+        if (*pCursor)
+            *pCursor++ = 0;
+        arrpush(*pppTokens, pToken);
+    }
+}
+
+// pText is modified and referenced by the steps
+static bool ParseManifest(char* pText, ManifestStep** ppSteps)
+{
+    uint32_t lineIndex = 0;
+    char*    pLine = pText;
+    while (pLine)
+    {
+        char* pLineEnd = strchr(pLine, '\n');
+        if (pLineEnd)
+            *pLineEnd++ = 0;
+        ++lineIndex;
+
+        char** ppTokens = NULL;
+        TokenizeManifestLine(pLine, &ppTokens);
+        pLine = pLineEnd;
+
+        if (!ppTokens)
+            continue;
+
+        ManifestStep step = {};
+        step.pName = ppTokens[0];
+        step.mLine = lineIndex;
+
+        // "name dep0 dep1 : command", the colon can also end the last name
+        uint32_t token = 0;
+        bool     separator = false;
+        for (const uint32_t count = (uint32_t)arrlenu(ppTokens); token < count && !separator; ++token)
+        {
+            char*        pToken = ppTokens[token];
+            const size_t length = strlen(pToken);
+            separator = length && pToken[length - 1] == ':';
+            if (separator)
+                pToken[length - 1] = 0;
+            if (token && pToken[0])
+                arrpush(step.ppDependencies, pToken);
+        }
+
+        if (!separator || !step.pName[0] || token == arrlenu(ppTokens))
+        {
+            LOGF(eERROR, "Manifest line %u: expected '<step name> [dependencies] : <command> [flags]'.", lineIndex);
+            arrfree(step.ppDependencies);
+            arrfree(ppTokens);
+            return false;
+        }
+
+        for (uint32_t i = token; i < (uint32_t)arrlenu(ppTokens); ++i)
+            arrpush(step.ppArgs, ppTokens[i]);
+        arrfree(ppTokens);
+
+        for (uint32_t i = 0; i < (uint32_t)arrlenu(*ppSteps); ++i)
+        {
+            if (strcmp((*ppSteps)[i].pName, step.pName) == 0)
+            {
+                LOGF(eERROR, "Manifest line %u: step '%s' is already defined on line %u.", lineIndex, step.pName, (*ppSteps)[i].mLine);
+                arrfree(step.ppDependencies);
+                arrfree(step.ppArgs);
+                return false;
+            }
+        }
+
+        arrpush(*ppSteps, step);
+    }
+
+    return true;
+}
+
+static int32_t FindManifestStep(const ManifestStep* pSteps, const char* pName)
+{
+    for (uint32_t i = 0; i < (uint32_t)arrlenu(pSteps); ++i)
+    {
+        if (strcmp(pSteps[i].pName, pName) == 0)
+            return (int32_t)i;
+    }
+    return -1;
+}
+
+// Steps in the order of the manifest, each one after its dependencies. Fails on unknown dependencies and cycles.
+static bool SortManifestSteps(const ManifestStep* pSteps, uint32_t* pOrder)
+{
+    const uint32_t stepCount = (uint32_t)arrlenu(pSteps);
+    bool*          pSorted = (bool*)tf_calloc(max(stepCount, 1u), sizeof(bool));
+    bool           valid = true;
+
+    for (uint32_t i = 0; valid && i < stepCount; ++i)
+    {
+        for (uint32_t d = 0; valid && d < (uint32_t)arrlenu(pSteps[i].ppDependencies); ++d)
+        {
+            if (FindManifestStep(pSteps, pSteps[i].ppDependencies[d]) < 0)
+            {
+                LOGF(eERROR, "Manifest line %u: step '%s' depends on unknown step '%s'.", pSteps[i].mLine, pSteps[i].pName,
+                     pSteps[i].ppDependencies[d]);
+                valid = false;
+            }
+        }
+    }
+
+    for (uint32_t sortedCount = 0; valid && sortedCount < stepCount; ++sortedCount)
+    {
+        int32_t next = -1;
+        for (uint32_t i = 0; next < 0 && i < stepCount; ++i)
+        {
+            bool ready = !pSorted[i];
+            for (uint32_t d = 0; ready && d < (uint32_t)arrlenu(pSteps[i].ppDependencies); ++d)
+                ready = pSorted[FindManifestStep(pSteps, pSteps[i].ppDependencies[d])];
+            if (ready)
+                next = (int32_t)i;
+        }
+
+        if (next < 0)
+        {
+            LOGF(eERROR, "Manifest steps have circular dependencies.");
+            valid = false;
+            break;
+        }
+
+        pSorted[next] = true;
+        pOrder[sortedCount] = (uint32_t)next;
+    }
+
+    tf_free(pSorted);
+    return valid;
+}
+
+static void WriteManifestSummary(ResourceDirectory resourceDir, const char* fileName, const char* manifestPath,
+                                 const ManifestStep* pSteps, int64_t totalTime, uint32_t threadCount, const DirectoryScanCache* pScanCache)
+{
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, fileName, FM_WRITE, &file))
+    {
+        LOGF(eERROR, "Couldn't open manifest summary '%s' for write", fileName);
+        return;
+    }
+
+    uint32_t scanHits = 0;
+    uint32_t scanMisses = 0;
+    GetDirectoryScanCacheStats(pScanCache, &scanHits, &scanMisses);
+
+    char text[256] = {};
+    fsWriteToStream(&file, "{\n  \"manifest\": ", strlen("{\n  \"manifest\": "));
+    WriteJsonString(&file, manifestPath);
+    int size = snprintf(text, sizeof(text),
+                        ",\n  \"timeMs\": %.3f,\n  \"threads\": %u,\n  \"directoryScans\": { \"cached\": %u, \"scanned\": %u },\n"
+                        "  \"steps\": [",
+                        totalTime / 1000.0, threadCount, scanHits, scanMisses);
+    fsWriteToStream(&file, text, (size_t)size);
+
+    for (uint32_t i = 0; i < (uint32_t)arrlenu(pSteps); ++i)
+    {
+        const ManifestStep* pStep = &pSteps[i];
+        const char* stepStart = i ? ",\n    { \"name\": " : "\n    { \"name\": ";
+        fsWriteToStream(&file, stepStart, strlen(stepStart));
+        WriteJsonString(&file, pStep->pName);
+        fsWriteToStream(&file, ", \"command\": ", strlen(", \"command\": "));
+        WriteJsonString(&file, pStep->ppArgs[0]);
+        size = snprintf(text, sizeof(text), ", \"status\": \"%s\", \"timeMs\": %.3f, \"checked\": %u, \"rebuilt\": %u, \"rebuiltFiles\": [",
+                        gManifestStepStatusNames[pStep->mStatus], pStep->mTime / 1000.0, pStep->mStats.mCheckedCount,
+                        pStep->mStats.mRebuiltCount);
+        fsWriteToStream(&file, text, (size_t)size);
+        for (uint32_t f = 0; f < (uint32_t)arrlenu(pStep->mStats.pRebuiltFiles); ++f)
+        {
+            if (f)
+                fsWriteToStream(&file, ", ", 2);
+            WriteJsonString(&file, (const char*)pStep->mStats.pRebuiltFiles[f].data);
+        }
+        fsWriteToStream(&file, "] }", 3);
+    }
+
+    fsWriteToStream(&file, "\n  ]\n}\n", strlen("\n  ]\n}\n"));
+    fsCloseStream(&file);
+}
+
+static bool ReadManifestFile(ResourceDirectory resourceDir, const char* fileName, char** ppText)
+{
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(resourceDir, fileName, FM_READ, &file))
+        return false;
+
+    const ssize_t fileSize = fsGetStreamFileSize(&file);
+    *ppText = (char*)tf_malloc((size_t)max(fileSize, (ssize_t)0) + 1);
+    (*ppText)[fsReadFromStream(&file, *ppText, (size_t)max(fileSize, (ssize_t)0))] = 0;
+    fsCloseStream(&file);
+    return true;
+}
+
+// Runs the steps of the manifest one after the other. Steps share the worker threads and the directory scans, they can't run
+// concurrently since each of them points the input and output resource directories to its own paths.
+static int RunManifest(int argc, char** argv)
+{
+    const char* manifestPath = argc > 2 ? argv[2] : "";
+    const char* summaryPath = NULL;
+    const char* reportPath = NULL;
+    const char* tracePath = NULL;
+    const char* unknownOption = NULL;
+    uint        threadCount = 0;
+    bool        quiet = false;
+    bool        force = false;
+    bool        useBuildCache = false;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        if (STRCMP(argv[i], "--summary") && i + 1 < argc)
+            summaryPath = argv[++i];
+        else if (STRCMP(argv[i], "--report") && i + 1 < argc)
+            reportPath = argv[++i];
+        else if (STRCMP(argv[i], "--trace") && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (STRCMP(argv[i], "--threads") && i + 1 < argc)
+        {
+            const int count = atoi(argv[++i]);
+            threadCount = count > 0 ? (uint)count : getNumCPUCores();
+        }
+        else if (STRCMP(argv[i], "--quiet"))
+            quiet = true;
+        else if (STRCMP(argv[i], "--force"))
+            force = true;
+        else if (STRCMP(argv[i], "--build-cache"))
+            useBuildCache = true;
+        else
+            unknownOption = unknownOption ? unknownOption : argv[i];
+    }
+
+    if (!initMemAlloc(gApplicationName))
+        return EXIT_FAILURE;
 
     FileSystemInitDesc fsDesc = {};
     fsDesc.pAppName = gApplicationName;
-
     if (!initFileSystem(&fsDesc))
     {
         LOGF(eERROR, "Filesystem failed to initialize.");
@@ -187,35 +673,309 @@ int AssetPipelineCmd(int argc, char** argv)
         return 1;
     }
 
-    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, params.mRDInput, input);
-    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, params.mRDOutput, output);
+    const ResourceDirectory manifestDir = RD_MIDDLEWARE_5;
+    const ResourceDirectory summaryDir = RD_MIDDLEWARE_6;
+    char                    manifestFileName[FS_MAX_PATH] = {};
+    SetResourceDirForPath(manifestDir, manifestPath, manifestFileName);
     fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_LOG, "");
 
-    LogLevel logLevel = params.mSettings.quiet ? eWARNING : DEFAULT_LOG_LEVEL;
-    initLog(gApplicationName, logLevel);
+    initLog(gApplicationName, quiet ? eWARNING : DEFAULT_LOG_LEVEL);
+    if (unknownOption)
+        LOGF(eWARNING, "Ignoring unknown manifest option %s", unknownOption);
 
-    bool runAssetPipeline = false;
-    for (uint32_t i = 0; i < TF_ARRAY_COUNT(gAssetPipelineCommands); ++i)
+    int           ret = ASSET_PIPELINE_SUCCESS;
+    char*         pText = NULL;
+    ManifestStep* pSteps = NULL;
+    uint32_t*     pOrder = NULL;
+
+    if (!ReadManifestFile(manifestDir, manifestFileName, &pText))
+    {
+        LOGF(eERROR, "Couldn't open manifest '%s'.", manifestPath);
+        ret = ASSET_PIPELINE_GENERAL_FAILURE;
+    }
+    else if (ParseManifest(pText, &pSteps))
+    {
+        pOrder = (uint32_t*)tf_calloc(max((uint32_t)arrlenu(pSteps), 1u), sizeof(uint32_t));
+        if (!SortManifestSteps(pSteps, pOrder))
+            ret = ASSET_PIPELINE_GENERAL_FAILURE;
+    }
+    else
     {
-        if (STRCMP(argv[1], gAssetPipelineCommands[i].mCommandString))
+        ret = ASSET_PIPELINE_GENERAL_FAILURE;
+    }
+
+    if (ret == ASSET_PIPELINE_SUCCESS)
+    {
+        ThreadSystemInitDesc threadSystemDesc = gThreadSystemInitDescDefault;
+        threadSystemDesc.threadCount = threadCount;
+        threadSystemDesc.threadName = "AssetPipeline";
+        ThreadSystem threadSystem = NULL;
+        if (!threadSystemInit(&threadSystem, &threadSystemDesc))
         {
-            params.mProcessType = gAssetPipelineCommands[i].mProcessType;
-            runAssetPipeline = true;
-            break;
+            LOGF(eWARNING, "Failed to create %u worker threads, processing on the calling thread", threadCount);
+            threadSystem = NULL;
+        }
+
+        DirectoryScanCache*   pScanCache = CreateDirectoryScanCache();
+        AssetPipelineProfile* pProfile = reportPath || tracePath ? CreateAssetPipelineProfile() : NULL;
+        const uint32_t        stepCount = (uint32_t)arrlenu(pSteps);
+        const int64_t         startTime = getUSec(false);
+
+        for (uint32_t o = 0; o < stepCount; ++o)
+        {
+            ManifestStep* pStep = &pSteps[pOrder[o]];
+
+            pStep->mStatus = MANIFEST_STEP_SUCCEEDED;
+            for (uint32_t d = 0; d < (uint32_t)arrlenu(pStep->ppDependencies); ++d)
+            {
+                if (pSteps[FindManifestStep(pSteps, pStep->ppDependencies[d])].mStatus != MANIFEST_STEP_SUCCEEDED)
+                    pStep->mStatus = MANIFEST_STEP_SKIPPED;
+            }
+
+            if (pStep->mStatus == MANIFEST_STEP_SKIPPED)
+            {
+                LOGF(eWARNING, "Skipping step '%s', one of its dependencies didn't succeed", pStep->pName);
+                ret = ASSET_PIPELINE_GENERAL_FAILURE;
+                continue;
+            }
+
+            AssetPipelineCommand command = {};
+            if (!ParseAssetPipelineCommand((int)arrlen(pStep->ppArgs), pStep->ppArgs, &command) || !command.mValidCommand)
+            {
+                LOGF(eERROR, "Manifest line %u: invalid command '%s'.", pStep->mLine, pStep->ppArgs[0]);
+                pStep->mStatus = MANIFEST_STEP_FAILED;
+                ret = ASSET_PIPELINE_GENERAL_FAILURE;
+                continue;
+            }
+
+            AssetPipelineParams* pParams = &command.mParams;
+            pParams->mSettings.quiet |= quiet;
+            pParams->mSettings.force |= force;
+            pParams->mSettings.useBuildCache |= useBuildCache;
+            pParams->mSettings.threadCount = threadSystem ? threadCount : pParams->mSettings.threadCount;
+            pParams->mThreadSystem = threadSystem;
+            pParams->pDirectoryScanCache = pScanCache;
+            pParams->pStats = &pStep->mStats;
+            pParams->pProfile = pProfile;
+            if (command.pReportPath || command.pTracePath)
+                LOGF(eWARNING, "Manifest line %u: --report and --trace are options of the manifest, not of its steps.", pStep->mLine);
+
+            LOGF(eINFO, "Running step '%s'", pStep->pName);
+            const int64_t stepStart = getUSec(false);
+            const int     stepResult = command.mVerifyThreads ? VerifyAssetPipelineThreads(&command) : RunAssetPipelineCommand(&command);
+            pStep->mTime = getUSec(false) - stepStart;
+            pStep->mStatus = stepResult == ASSET_PIPELINE_SUCCESS ? MANIFEST_STEP_SUCCEEDED : MANIFEST_STEP_FAILED;
+            if (stepResult != ASSET_PIPELINE_SUCCESS)
+                ret = ASSET_PIPELINE_GENERAL_FAILURE;
+
+            // Outputs of this step might be the inputs of the next ones
+            InvalidateDirectoryScanCache(pScanCache, fsGetResourceDirectory(pParams->mRDOutput));
+        }
+
+        const int64_t totalTime = getUSec(false) - startTime;
+        threadSystemExit(&threadSystem, &gThreadSystemExitDescDefault);
+
+        for (uint32_t i = 0; i < stepCount; ++i)
+        {
+            LOGF(eINFO, "Step '%s': %s in %.2f ms, rebuilt %u of %u assets", pSteps[i].pName, gManifestStepStatusNames[pSteps[i].mStatus],
+                 pSteps[i].mTime / 1000.0, pSteps[i].mStats.mRebuiltCount, pSteps[i].mStats.mCheckedCount);
         }
+        LOGF(eINFO, "Manifest '%s': %u steps in %.2f ms", manifestPath, stepCount, totalTime / 1000.0);
+
+        if (summaryPath)
+        {
+            char summaryFileName[FS_MAX_PATH] = {};
+            SetResourceDirForPath(summaryDir, summaryPath, summaryFileName);
+            WriteManifestSummary(summaryDir, summaryFileName, manifestPath, pSteps, totalTime, threadCount, pScanCache);
+        }
+
+        if (pProfile)
+            WriteProfile(pProfile, reportPath, tracePath);
+
+        DestroyAssetPipelineProfile(pProfile);
+        DestroyDirectoryScanCache(pScanCache);
     }
 
-    // ...
+    for (uint32_t i = 0; i < (uint32_t)arrlenu(pSteps); ++i)
+    {
+        for (uint32_t f = 0; f < (uint32_t)arrlenu(pSteps[i].mStats.pRebuiltFiles); ++f)
+            bdestroy(&pSteps[i].mStats.pRebuiltFiles[f]);
+        arrfree(pSteps[i].mStats.pRebuiltFiles);
+        arrfree(pSteps[i].ppDependencies);
+        arrfree(pSteps[i].ppArgs);
+    }
+    arrfree(pSteps);
+    tf_free(pOrder);
+    tf_free(pText);
 
-    int ret = 0;
+    exitLog();
+    exitFileSystem();
+    exitMemAlloc();
+
+    return ret;
+}
 
-    if (runAssetPipeline)
+static int RunTests(int argc, char** argv)
+{
+    const char* filter = "";
+    const char* outputPath = "AssetPipelineTests";
+    const char* unknownOption = NULL;
+    uint        threadCount = getNumCPUCores();
+    bool        quiet = false;
+
+    for (int i = 2; i < argc; ++i)
     {
-        // Make sure output folder exists before starting the pipeline
-        if (fsCreateDirectory(params.mRDOutput, "", true))
+        if (STRCMP(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+        else if (STRCMP(argv[i], "--output") && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (STRCMP(argv[i], "--threads") && i + 1 < argc)
         {
-            ret = AssetPipelineRun(&params);
+            const int count = atoi(argv[++i]);
+            threadCount = count > 0 ? (uint)count : getNumCPUCores();
         }
+        else if (STRCMP(argv[i], "--quiet"))
+            quiet = true;
+        else
+            unknownOption = unknownOption ? unknownOption : argv[i];
+    }
+
+    if (!initMemAlloc(gApplicationName))
+        return EXIT_FAILURE;
+
+    FileSystemInitDesc fsDesc = {};
+    fsDesc.pAppName = gApplicationName;
+    if (!initFileSystem(&fsDesc))
+    {
+        LOGF(eERROR, "Filesystem failed to initialize.");
+        exitMemAlloc();
+        return 1;
+    }
+
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_LOG, "");
+    initLog(gApplicationName, quiet ? eWARNING : DEFAULT_LOG_LEVEL);
+    if (unknownOption)
+        LOGF(eWARNING, "Ignoring unknown test option %s", unknownOption);
+
+    AssetPipelineParams params = {};
+    params.mRDInput = RD_MIDDLEWARE_1;
+    params.mRDOutput = RD_MIDDLEWARE_2;
+    params.mRDZipWrite = RD_MIDDLEWARE_3;
+    params.mRDSharedBuildCache = RD_MIDDLEWARE_4;
+    params.mInDir = outputPath;
+    params.mOutDir = outputPath;
+    params.mInFilePath = "";
+    params.mInExt = "";
+    params.mSettings.quiet = quiet;
+    params.mSettings.threadCount = threadCount;
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, params.mRDInput, outputPath);
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, params.mRDOutput, outputPath);
+
+    int      ret = ASSET_PIPELINE_SUCCESS;
+    uint32_t runCount = 0;
+    uint32_t failedCount = 0;
+    if (!fsCreateDirectory(params.mRDOutput, "", true))
+    {
+        LOGF(eERROR, "Couldn't create test directory '%s'.", outputPath);
+        ret = ASSET_PIPELINE_GENERAL_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < TF_ARRAY_COUNT(gAssetPipelineTests) && ret == ASSET_PIPELINE_SUCCESS; ++i)
+    {
+        const AssetPipelineTest* pTest = &gAssetPipelineTests[i];
+        if (!strstr(pTest->pName, filter))
+            continue;
+
+        LOGF(eINFO, "Running test '%s'", pTest->pName);
+        const int64_t startTime = getUSec(false);
+        const bool    failed = pTest->pFunc(&params);
+        LOGF(failed ? eERROR : eINFO, "Test '%s' %s in %.2f ms", pTest->pName, failed ? "failed" : "passed",
+             (getUSec(false) - startTime) / 1000.0);
+        ++runCount;
+        failedCount += failed ? 1 : 0;
+    }
+
+    if (ret == ASSET_PIPELINE_SUCCESS)
+    {
+        LOGF(failedCount ? eERROR : eINFO, "%u of %u tests passed", runCount - failedCount, runCount);
+        ret = failedCount || !runCount ? ASSET_PIPELINE_GENERAL_FAILURE : ASSET_PIPELINE_SUCCESS;
+    }
+
+    exitLog();
+    exitFileSystem();
+    exitMemAlloc();
+
+    return ret;
+}
+
+int AssetPipelineCmd(int argc, char** argv)
+{
+    if (argc == 1)
+    {
+        PrintHelp();
+        return 0;
+    }
+
+    if (stricmp(argv[1], "-h") == 0 || stricmp(argv[1], "-help") == 0)
+    {
+        PrintHelp();
+        return 0;
+    }
+
+    if (argc < 2)
+    {
+        printf("Invalid command.\n");
+        return 0;
+    }
+
+    if (stricmp(argv[1], "-manifest") == 0)
+    {
+        return RunManifest(argc, argv);
+    }
+
+    if (stricmp(argv[1], "-test") == 0)
+    {
+        return RunTests(argc, argv);
+    }
+
+    if (!initMemAlloc(gApplicationName))
+        return EXIT_FAILURE;
+
+    // Parse commands, fill params
+    AssetPipelineCommand command = {};
+    if (!ParseAssetPipelineCommand(argc - 1, argv + 1, &command))
+    {
+        exitMemAlloc();
+        return 1;
+    }
+
+    FileSystemInitDesc fsDesc = {};
+    fsDesc.pAppName = gApplicationName;
+
+    if (!initFileSystem(&fsDesc))
+    {
+        LOGF(eERROR, "Filesystem failed to initialize.");
+        exitMemAlloc();
+        return 1;
+    }
+
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_LOG, "");
+
+    LogLevel logLevel = command.mParams.mSettings.quiet ? eWARNING : DEFAULT_LOG_LEVEL;
+    initLog(gApplicationName, logLevel);
+
+    int ret = 0;
+
+    if (command.mValidCommand)
+    {
+        AssetPipelineProfile* pProfile = command.pReportPath || command.pTracePath ? CreateAssetPipelineProfile() : NULL;
+        command.mParams.pProfile = pProfile;
+
+        ret = command.mVerifyThreads ? VerifyAssetPipelineThreads(&command) : RunAssetPipelineCommand(&command);
+
+        if (pProfile)
+            WriteProfile(pProfile, command.pReportPath, command.pTracePath);
+        DestroyAssetPipelineProfile(pProfile);
     }
     else
     {
@@ -25,7 +25,11 @@
 #include "../../../OS/Interfaces/IOperatingSystem.h"
 #include "../../../Utilities/Interfaces/IFileSystem.h"
 #include "../../../Utilities/Interfaces/ILog.h"
+#include "../../../Utilities/Interfaces/IThread.h"
+#include "../../../Utilities/Interfaces/ITime.h"
 #include "../../../Utilities/Interfaces/IToolFileSystem.h"
+#include "../../../Utilities/Threading/Atomics.h"
+#include "../../../Utilities/Threading/ThreadSystem.h"
 
 #include "AssetPipeline.h"
 
@@ -39,6 +43,9 @@
 #include "../../../Resources/ResourceLoader/ThirdParty/OpenSource/tinydds/tinydds.h"
 #include "../../../Resources/ResourceLoader/ThirdParty/OpenSource/tinyktx/tinyktx.h"
 
+// zstd (KTX2 supercompression)
+#include "../../../Utilities/ThirdParty/OpenSource/zstd/zstd.h"
+
 // ISPC texcomp
 #include "../../ThirdParty/OpenSource/ISPCTextureCompressor/ispc_texcomp/ispc_texcomp.h"
 
@@ -58,7 +65,7 @@
 
 #define IS_POWER_OF_TWO(x) ((x) != 0 && ((x) & ((x)-1)) == 0)
 
-const char* gExtensions[] = { "dds", "ktx"
+const char* gExtensions[] = { "dds", "ktx", "ktx2"
 #ifdef PROSPERO_GNF
                               ,
                               "gnf", "gnf"
@@ -160,6 +167,8 @@ typedef struct CompressImageDescriptor
     TextureCompression mCompression;
     ASTC               mASTCCompression;
     DXT                mDXTCompression;
+    // Optional, large surfaces are split in rows of blocks compressed by the workers of this thread system
+    ThreadSystem       mThreadSystem;
 } CompressImageDescriptor;
 
 uint8_t* ResizeImage(uint8_t* ppData, const uint32_t width, const uint32_t height, const uint32_t newWidth, const uint32_t newHeight,
@@ -505,6 +514,103 @@ bool LoadTextureData(ResourceDirectory resourceDir, const char* pFilepath, const
     return success;
 }
 
+typedef void (*BCCompressionFunc)(const rgba_surface* src, uint8_t* dst);
+
+// Minimum number of block rows compressed by a task, smaller surfaces are compressed by a single task
+#define COMPRESS_MIN_BLOCK_ROWS_PER_TASK 16
+
+// Rows of blocks of a surface compressed by one task. Blocks are written in row order so the output is identical to compressing the
+// whole surface with a single call.
+typedef struct CompressBlockRowsTask
+{
+    BCCompressionFunc       pBCCompress;
+    astc_enc_settings*      pASTCSettings;
+    rgba_surface            mInput;
+    uint8_t*                pOutput;
+    AssetPipelineTaskGroup* pGroup; // NULL when the tasks run on the calling thread
+} CompressBlockRowsTask;
+
+static void CompressBlockRowsTaskFunc(void* pUser, uint64_t)
+{
+    CompressBlockRowsTask* pTask = (CompressBlockRowsTask*)pUser;
+    if (pTask->pASTCSettings)
+        CompressBlocksASTC(&pTask->mInput, pTask->pOutput, pTask->pASTCSettings);
+    else
+        pTask->pBCCompress(&pTask->mInput, pTask->pOutput);
+    if (pTask->pGroup)
+        EndAssetPipelineTask(pTask->pGroup);
+}
+
+// One slice of one mip, compressed once the outputs of all the mips are allocated. The height is a multiple of the block height.
+typedef struct CompressSurface
+{
+    rgba_surface mInput;
+    uint32_t     mMip;
+    uint32_t     mOutputOffset;
+    uint32_t     mBytesPerBlockRow;
+    bool         mPadded; // mInput.ptr was allocated to pad the mip to whole blocks
+} CompressSurface;
+
+// Compresses the block rows of all the surfaces in one group of tasks, so that small mips are compressed concurrently with the rows of
+// the large ones instead of after them. Frees the padded surfaces.
+static void CompressSurfaces(ThreadSystem threadSystem, BCCompressionFunc pBCCompress, astc_enc_settings* pASTCSettings,
+                             uint32_t blockHeight, CompressSurface* pSurfaces, uint8_t* ppOutCompressed[MAX_MIPLEVELS])
+{
+    const uint32_t surfaceCount = (uint32_t)arrlenu(pSurfaces);
+    uint32_t       blockRowCount = 0;
+    for (uint32_t s = 0; s < surfaceCount; ++s)
+        blockRowCount += pSurfaces[s].mInput.height / blockHeight;
+
+    uint32_t rowsPerTask = max(blockRowCount, 1u);
+    if (threadSystem)
+    {
+        ThreadSystemInfo info = {};
+        threadSystemGetInfo(threadSystem, &info);
+        // A few tasks per thread to balance rows that compress slower than others
+        const uint32_t taskCount = (uint32_t)(info.threadCount + 1) * 4;
+        rowsPerTask = max((blockRowCount + taskCount - 1) / taskCount, (uint32_t)COMPRESS_MIN_BLOCK_ROWS_PER_TASK);
+    }
+
+    AssetPipelineTaskGroup group = {};
+    CompressBlockRowsTask* pTasks = NULL;
+    for (uint32_t s = 0; s < surfaceCount; ++s)
+    {
+        const CompressSurface* pSurface = &pSurfaces[s];
+        const uint32_t         blockRows = pSurface->mInput.height / blockHeight;
+        for (uint32_t firstRow = 0; firstRow < blockRows; firstRow += rowsPerTask)
+        {
+            CompressBlockRowsTask task = { pBCCompress, pASTCSettings, pSurface->mInput, NULL, NULL };
+            task.mInput.ptr = pSurface->mInput.ptr + (size_t)firstRow * blockHeight * pSurface->mInput.stride;
+            task.mInput.height = min(rowsPerTask, blockRows - firstRow) * blockHeight;
+            task.pOutput = ppOutCompressed[pSurface->mMip] + pSurface->mOutputOffset + (size_t)firstRow * pSurface->mBytesPerBlockRow;
+            arrpush(pTasks, task);
+        }
+    }
+
+    const uint32_t taskCount = (uint32_t)arrlenu(pTasks);
+    if (!threadSystem || taskCount == 1)
+    {
+        for (uint32_t t = 0; t < taskCount; ++t)
+            CompressBlockRowsTaskFunc(&pTasks[t], 0);
+    }
+    else
+    {
+        // The calling thread might be a worker of the same thread system (one task per file)
+        BeginAssetPipelineTaskGroup(&group, taskCount);
+        for (uint32_t t = 0; t < taskCount; ++t)
+            pTasks[t].pGroup = &group;
+        threadSystemAddTaskGroup(threadSystem, CompressBlockRowsTaskFunc, taskCount, pTasks);
+        WaitAssetPipelineTaskGroup(threadSystem, &group);
+    }
+    arrfree(pTasks);
+
+    for (uint32_t s = 0; s < surfaceCount; ++s)
+    {
+        if (pSurfaces[s].mPadded)
+            tf_free(pSurfaces[s].mInput.ptr);
+    }
+}
+
 bool ASTCCompression(uint8_t* ppData[MAX_MIPLEVELS], uint8_t* ppOutCompressed[MAX_MIPLEVELS], uint32_t* pCompressedSize,
                      CompressImageDescriptor* pDesc, TextureDesc* pTexDesc)
 {
@@ -546,6 +652,9 @@ bool ASTCCompression(uint8_t* ppData[MAX_MIPLEVELS], uint8_t* ppOutCompressed[MA
     uint32_t adjustedHeight = pTexDesc->mHeight;
     uint32_t slices = pTexDesc->mArraySize;
 
+    // Outputs are reallocated per slice, the surfaces are compressed once all of them are known
+    CompressSurface* pSurfaces = NULL;
+
     for (uint32_t i = 0; i < pTexDesc->mMipLevels; ++i)
     {
         uint32_t width = max(1u, (pTexDesc->mWidth >> i));
@@ -608,21 +717,22 @@ bool ASTCCompression(uint8_t* ppData[MAX_MIPLEVELS], uint8_t* ppOutCompressed[MA
                 ppOutCompressed[i] = (uint8_t*)tf_realloc(ppOutCompressed[i], pCompressedSize[i]);
             }
 
-            rgba_surface input;
-            input.width = width;
-            input.height = height;
-            input.stride = width * channels;
-            input.ptr = pData;
-
-            CompressBlocksASTC(&input, ppOutCompressed[i] + compressed_offset, &astcEncSettings);
-
-            if (padded)
-            {
-                tf_free(pData);
-            }
+            CompressSurface surface = {};
+            surface.mInput.width = width;
+            surface.mInput.height = height;
+            surface.mInput.stride = width * channels;
+            surface.mInput.ptr = pData;
+            surface.mMip = i;
+            surface.mOutputOffset = compressed_offset;
+            surface.mBytesPerBlockRow = xblocks * bytesPerBlock;
+            surface.mPadded = padded;
+            arrpush(pSurfaces, surface);
         }
     }
 
+    CompressSurfaces(pDesc->mThreadSystem, NULL, &astcEncSettings, blockSizeY, pSurfaces, ppOutCompressed);
+    arrfree(pSurfaces);
+
     // Set image size to padding size
     pTexDesc->mWidth = adjustedWidth;
     pTexDesc->mHeight = adjustedHeight;
@@ -630,8 +740,6 @@ bool ASTCCompression(uint8_t* ppData[MAX_MIPLEVELS], uint8_t* ppOutCompressed[MA
     return true;
 }
 
-typedef void (*BCCompressionFunc)(const rgba_surface* src, uint8_t* dst);
-
 #define DECLARE_COMPRESS_FUNCTION_BC6H(profile)                              \
     void CompressBlocksBC6H_##profile(const rgba_surface* src, uint8_t* dst) \
     {                                                                        \
@@ -724,6 +832,9 @@ bool BCCompression(uint8_t* ppData[MAX_MIPLEVELS], uint8_t* ppOutCompressed[MAX_
     uint32_t adjustedHeight = pTexDesc->mHeight;
     uint32_t slices = pTexDesc->mArraySize;
 
+    // Outputs are reallocated per slice, the surfaces are compressed once all of them are known
+    CompressSurface* pSurfaces = NULL;
+
     for (uint32_t i = 0; i < pTexDesc->mMipLevels; ++i)
     {
         uint32_t width = max(1u, (pTexDesc->mWidth >> i));
@@ -801,21 +912,22 @@ bool BCCompression(uint8_t* ppData[MAX_MIPLEVELS], uint8_t* ppOutCompressed[MAX_
                 }
             }
 
-            rgba_surface input;
-            input.width = width;
-            input.height = height;
-            input.stride = width * requiredInputChannels;
-            input.ptr = pData;
-
-            bcCompress(&input, ppOutCompressed[i] + compressed_offset);
-
-            if (padded)
-            {
-                tf_free(pData);
-            }
+            CompressSurface surface = {};
+            surface.mInput.width = width;
+            surface.mInput.height = height;
+            surface.mInput.stride = width * requiredInputChannels;
+            surface.mInput.ptr = pData;
+            surface.mMip = i;
+            surface.mOutputOffset = compressed_offset;
+            surface.mBytesPerBlockRow = xblocks * bytesPerBlock;
+            surface.mPadded = padded;
+            arrpush(pSurfaces, surface);
         }
     }
 
+    CompressSurfaces(pDesc->mThreadSystem, bcCompress, NULL, blockSize, pSurfaces, ppOutCompressed);
+    arrfree(pSurfaces);
+
     // Set image size to padding size
     pTexDesc->mWidth = adjustedWidth;
     pTexDesc->mHeight = adjustedHeight;
@@ -845,7 +957,438 @@ bool CompressImageData(uint8_t* ppData[MAX_MIPLEVELS], uint8_t* ppOutCompressed[
     }
 }
 
-void GenerateMipmaps(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextDesc)
+/************************************************************************/
+// Mipmap filter kernels
+/************************************************************************/
+// MIPMAP_FILTER_BOX/KAISER filter in linear float RGBA: each source row is decoded, padded with its edge pixels and filtered
+// horizontally into a ring of rows that the vertical pass combines. Only the two passes depend on the instruction set, the SIMD
+// versions accumulate the taps in the same order with separate multiplies and adds as the scalar one so they produce the same bits.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MIP_KERNELS_SSE
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__clang__) || defined(__GNUC__)
+#define MIP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MIP_TARGET_AVX2
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MIP_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#define MIP_FILTER_MAX_TAPS 8
+// Windowed sinc over 4 source pixels on each side, alpha as in nvtt
+#define KAISER_FILTER_TAPS  8
+#define KAISER_FILTER_ALPHA 4.0
+
+// Pixels are float4, pSrc is the padded source row: destination pixel x reads source pixels 2x + tap
+typedef void (*MipHorizontalPassFunc)(const float* pSrc, float* pDst, uint32_t dstWidth, const float* pWeights, uint32_t taps);
+typedef void (*MipVerticalPassFunc)(const float* const* ppRows, float* pDst, uint32_t floatCount, const float* pWeights, uint32_t taps);
+
+typedef struct MipFilterKernels
+{
+    const char*           pName;
+    MipHorizontalPassFunc pHorizontalPass;
+    MipVerticalPassFunc   pVerticalPass;
+} MipFilterKernels;
+
+typedef enum MipPixelType
+{
+    MIP_PIXEL_UNORM8,
+    MIP_PIXEL_SRGB8,
+    MIP_PIXEL_HALF,
+    MIP_PIXEL_FLOAT,
+} MipPixelType;
+
+static void MipHorizontalPassScalar(const float* pSrc, float* pDst, uint32_t dstWidth, const float* pWeights, uint32_t taps)
+{
+    for (uint32_t x = 0; x < dstWidth; ++x)
+    {
+        const float* pPixels = pSrc + x * 8;
+        float        acc[4] = {};
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                acc[c] = acc[c] + pWeights[t] * pPixels[t * 4 + c];
+            }
+        }
+        memcpy(pDst + x * 4, acc, sizeof(acc));
+    }
+}
+
+static void MipVerticalPassScalar(const float* const* ppRows, float* pDst, uint32_t floatCount, const float* pWeights, uint32_t taps)
+{
+    for (uint32_t i = 0; i < floatCount; ++i)
+    {
+        float acc = 0.0f;
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            acc = acc + pWeights[t] * ppRows[t][i];
+        }
+        pDst[i] = acc;
+    }
+}
+
+#if defined(MIP_KERNELS_SSE)
+static void MipHorizontalPassSSE(const float* pSrc, float* pDst, uint32_t dstWidth, const float* pWeights, uint32_t taps)
+{
+    for (uint32_t x = 0; x < dstWidth; ++x)
+    {
+        const float* pPixels = pSrc + x * 8;
+        __m128       acc = _mm_setzero_ps();
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(pWeights[t]), _mm_loadu_ps(pPixels + t * 4)));
+        }
+        _mm_storeu_ps(pDst + x * 4, acc);
+    }
+}
+
+static void MipVerticalPassSSE(const float* const* ppRows, float* pDst, uint32_t floatCount, const float* pWeights, uint32_t taps)
+{
+    for (uint32_t i = 0; i < floatCount; i += 4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(pWeights[t]), _mm_loadu_ps(ppRows[t] + i)));
+        }
+        _mm_storeu_ps(pDst + i, acc);
+    }
+}
+
+// Two destination pixels per iteration, their taps are 2 pixels apart in the source row
+MIP_TARGET_AVX2 static void MipHorizontalPassAVX2(const float* pSrc, float* pDst, uint32_t dstWidth, const float* pWeights, uint32_t taps)
+{
+    uint32_t x = 0;
+    for (; x + 2 <= dstWidth; x += 2)
+    {
+        const float* pPixels = pSrc + x * 8;
+        __m256       acc = _mm256_setzero_ps();
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            const __m256 pixels =
+                _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pPixels + t * 4)), _mm_loadu_ps(pPixels + t * 4 + 8), 1);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(pWeights[t]), pixels));
+        }
+        _mm256_storeu_ps(pDst + x * 4, acc);
+    }
+    if (x < dstWidth)
+    {
+        MipHorizontalPassSSE(pSrc + x * 8, pDst + x * 4, dstWidth - x, pWeights, taps);
+    }
+}
+
+MIP_TARGET_AVX2 static void MipVerticalPassAVX2(const float* const* ppRows, float* pDst, uint32_t floatCount, const float* pWeights,
+                                                uint32_t taps)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= floatCount; i += 8)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(pWeights[t]), _mm256_loadu_ps(ppRows[t] + i)));
+        }
+        _mm256_storeu_ps(pDst + i, acc);
+    }
+    for (; i < floatCount; i += 4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(pWeights[t]), _mm_loadu_ps(ppRows[t] + i)));
+        }
+        _mm_storeu_ps(pDst + i, acc);
+    }
+}
+
+static bool CpuSupportsAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    // The OS has to save the ymm registers too
+    __cpuid(info, 1);
+    const int osxsaveAndAvx = (1 << 27) | (1 << 28);
+    if ((info[2] & osxsaveAndAvx) != osxsaveAndAvx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#if defined(MIP_KERNELS_NEON)
+static void MipHorizontalPassNEON(const float* pSrc, float* pDst, uint32_t dstWidth, const float* pWeights, uint32_t taps)
+{
+    for (uint32_t x = 0; x < dstWidth; ++x)
+    {
+        const float* pPixels = pSrc + x * 8;
+        float32x4_t  acc = vdupq_n_f32(0.0f);
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            acc = vaddq_f32(acc, vmulq_f32(vdupq_n_f32(pWeights[t]), vld1q_f32(pPixels + t * 4)));
+        }
+        vst1q_f32(pDst + x * 4, acc);
+    }
+}
+
+static void MipVerticalPassNEON(const float* const* ppRows, float* pDst, uint32_t floatCount, const float* pWeights, uint32_t taps)
+{
+    for (uint32_t i = 0; i < floatCount; i += 4)
+    {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            acc = vaddq_f32(acc, vmulq_f32(vdupq_n_f32(pWeights[t]), vld1q_f32(ppRows[t] + i)));
+        }
+        vst1q_f32(pDst + i, acc);
+    }
+}
+#endif
+
+static const MipFilterKernels gMipFilterKernelsScalar = { "scalar", MipHorizontalPassScalar, MipVerticalPassScalar };
+
+static const MipFilterKernels* GetMipFilterKernels()
+{
+#if defined(MIP_KERNELS_SSE)
+    static const MipFilterKernels sse = { "SSE", MipHorizontalPassSSE, MipVerticalPassSSE };
+    static const MipFilterKernels avx2 = { "AVX2", MipHorizontalPassAVX2, MipVerticalPassAVX2 };
+    static const bool             supportsAVX2 = CpuSupportsAVX2();
+    return supportsAVX2 ? &avx2 : &sse;
+#elif defined(MIP_KERNELS_NEON)
+    static const MipFilterKernels neon = { "NEON", MipHorizontalPassNEON, MipVerticalPassNEON };
+    return &neon;
+#else
+    return &gMipFilterKernelsScalar;
+#endif
+}
+
+static bool GetMipPixelType(TinyImageFormat format, MipPixelType* pType)
+{
+    switch (format)
+    {
+    case TinyImageFormat_R8_UNORM:
+    case TinyImageFormat_R8G8_UNORM:
+    case TinyImageFormat_R8G8B8_UNORM:
+    case TinyImageFormat_R8G8B8A8_UNORM:
+    case TinyImageFormat_B8G8R8A8_UNORM:
+        *pType = MIP_PIXEL_UNORM8;
+        return true;
+    case TinyImageFormat_R8G8B8_SRGB:
+    case TinyImageFormat_R8G8B8A8_SRGB:
+    case TinyImageFormat_B8G8R8A8_SRGB:
+        *pType = MIP_PIXEL_SRGB8;
+        return true;
+    case TinyImageFormat_R16_SFLOAT:
+    case TinyImageFormat_R16G16_SFLOAT:
+    case TinyImageFormat_R16G16B16_SFLOAT:
+    case TinyImageFormat_R16G16B16A16_SFLOAT:
+        *pType = MIP_PIXEL_HALF;
+        return true;
+    case TinyImageFormat_R32_SFLOAT:
+    case TinyImageFormat_R32G32_SFLOAT:
+    case TinyImageFormat_R32G32B32_SFLOAT:
+    case TinyImageFormat_R32G32B32A32_SFLOAT:
+        *pType = MIP_PIXEL_FLOAT;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static uint32_t GetMipPixelTypeSize(MipPixelType type)
+{
+    switch (type)
+    {
+    case MIP_PIXEL_HALF:
+        return sizeof(uint16_t);
+    case MIP_PIXEL_FLOAT:
+        return sizeof(float);
+    default:
+        return sizeof(uint8_t);
+    }
+}
+
+// Decodes a row to linear float4 pixels and replicates the edge pixels into the padding on both sides
+static void DecodeMipRow(const uint8_t* pSrc, uint32_t width, MipPixelType type, uint32_t channels, uint32_t padding, float* pDst)
+{
+    float* pPixels = pDst + padding * 4;
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        float* pPixel = pPixels + x * 4;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            if (c >= channels)
+            {
+                pPixel[c] = 0.0f;
+                continue;
+            }
+
+            const uint32_t index = x * channels + c;
+            switch (type)
+            {
+            case MIP_PIXEL_UNORM8:
+                pPixel[c] = pSrc[index] / 255.0f;
+                break;
+            case MIP_PIXEL_SRGB8:
+                // Alpha is always linear
+                pPixel[c] = c < 3 ? stbir__srgb_uchar_to_linear_float[pSrc[index]] : pSrc[index] / 255.0f;
+                break;
+            case MIP_PIXEL_HALF:
+            {
+                half value;
+                memcpy(&value.sh, pSrc + index * sizeof(uint16_t), sizeof(uint16_t));
+                pPixel[c] = (float)value;
+                break;
+            }
+            case MIP_PIXEL_FLOAT:
+                memcpy(&pPixel[c], pSrc + index * sizeof(float), sizeof(float));
+                break;
+            }
+        }
+    }
+
+    for (uint32_t p = 0; p < padding; ++p)
+    {
+        memcpy(pDst + p * 4, pPixels, 4 * sizeof(float));
+        memcpy(pPixels + (width + p) * 4, pPixels + (width - 1) * 4, 4 * sizeof(float));
+    }
+}
+
+static void EncodeMipRow(const float* pSrc, uint32_t width, MipPixelType type, uint32_t channels, uint8_t* pDst)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            const float    value = pSrc[x * 4 + c];
+            const uint32_t index = x * channels + c;
+            switch (type)
+            {
+            case MIP_PIXEL_UNORM8:
+                pDst[index] = (uint8_t)(clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+                break;
+            case MIP_PIXEL_SRGB8:
+                pDst[index] = c < 3 ? stbir__linear_to_srgb_uchar(value) : (uint8_t)(clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+                break;
+            case MIP_PIXEL_HALF:
+            {
+                const half encoded(value);
+                memcpy(pDst + index * sizeof(uint16_t), &encoded.sh, sizeof(uint16_t));
+                break;
+            }
+            case MIP_PIXEL_FLOAT:
+                memcpy(pDst + index * sizeof(float), &value, sizeof(float));
+                break;
+            }
+        }
+    }
+}
+
+static double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (uint32_t k = 1; term > sum * 1e-12; ++k)
+    {
+        const double halfXOverK = x / (2.0 * k);
+        term *= halfXOverK * halfXOverK;
+        sum += term;
+    }
+    return sum;
+}
+
+// Weights of the 2:1 downsample, tap t samples the source pixel 2x + t - (taps / 2 - 1) of destination pixel x
+static uint32_t GetMipFilterWeights(TextureMipmapFilter filter, float* pWeights)
+{
+    if (filter == MIPMAP_FILTER_KAISER)
+    {
+        double weights[KAISER_FILTER_TAPS] = {};
+        double sum = 0.0;
+        for (uint32_t t = 0; t < KAISER_FILTER_TAPS; ++t)
+        {
+            // Distance to the destination pixel center in destination pixels, the window spans the taps
+            const double x = (t - (KAISER_FILTER_TAPS - 1) * 0.5) * 0.5;
+            const double window = x / (KAISER_FILTER_TAPS * 0.25);
+            const double sinc = x == 0.0 ? 1.0 : sin(PI * x) / (PI * x);
+            weights[t] = sinc * BesselI0(KAISER_FILTER_ALPHA * sqrt(1.0 - window * window)) / BesselI0(KAISER_FILTER_ALPHA);
+            sum += weights[t];
+        }
+        for (uint32_t t = 0; t < KAISER_FILTER_TAPS; ++t)
+        {
+            pWeights[t] = (float)(weights[t] / sum);
+        }
+        return KAISER_FILTER_TAPS;
+    }
+
+    pWeights[0] = 0.5f;
+    pWeights[1] = 0.5f;
+    return 2;
+}
+
+static void FilterMipLevel(const MipFilterKernels* pKernels, const uint8_t* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst,
+                           uint32_t dstWidth, uint32_t dstHeight, MipPixelType type, uint32_t channels, const float* pWeights,
+                           uint32_t taps)
+{
+    const uint32_t padding = taps / 2;
+    const uint32_t srcRowSize = srcWidth * channels * GetMipPixelTypeSize(type);
+    const uint32_t dstRowSize = dstWidth * channels * GetMipPixelTypeSize(type);
+    const uint32_t dstFloatCount = dstWidth * 4;
+
+    float* pPaddedRow = (float*)tf_malloc((srcWidth + 2 * padding) * 4 * sizeof(float));
+    float* pRing = (float*)tf_malloc(taps * dstFloatCount * sizeof(float));
+    float* pOutRow = (float*)tf_malloc(dstFloatCount * sizeof(float));
+
+    // Source row held by each row of the ring, rows of a window map to different slots since they are consecutive
+    int64_t      ringRows[MIP_FILTER_MAX_TAPS];
+    const float* ppRows[MIP_FILTER_MAX_TAPS];
+    for (uint32_t t = 0; t < taps; ++t)
+    {
+        ringRows[t] = -1;
+    }
+
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            const int64_t  row = max(min((int64_t)2 * y + t - (padding - 1), (int64_t)srcHeight - 1), (int64_t)0);
+            const uint32_t slot = (uint32_t)(row % taps);
+            float*         pRingRow = pRing + slot * dstFloatCount;
+            if (ringRows[slot] != row)
+            {
+                // Tap 0 of pixel 0 is one pixel into the padding
+                DecodeMipRow(pSrc + row * srcRowSize, srcWidth, type, channels, padding, pPaddedRow);
+                pKernels->pHorizontalPass(pPaddedRow + 4, pRingRow, dstWidth, pWeights, taps);
+                ringRows[slot] = row;
+            }
+            ppRows[t] = pRingRow;
+        }
+
+        pKernels->pVerticalPass(ppRows, pOutRow, dstFloatCount, pWeights, taps);
+        EncodeMipRow(pOutRow, dstWidth, type, channels, pDst + y * dstRowSize);
+    }
+
+    tf_free(pOutRow);
+    tf_free(pRing);
+    tf_free(pPaddedRow);
+}
+
+static void GenerateMipmapsStb(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextDesc)
 {
     uint32_t width = pTextDesc->mWidth;
     uint32_t height = pTextDesc->mHeight;
@@ -880,6 +1423,68 @@ void GenerateMipmaps(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, T
     pTextDesc->mMipLevels = numLevels;
 }
 
+static void GenerateFilteredMipmaps(const MipFilterKernels* pKernels, TextureMipmapFilter filter, MipPixelType type,
+                                    uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextDesc)
+{
+    float          weights[MIP_FILTER_MAX_TAPS] = {};
+    const uint32_t taps = GetMipFilterWeights(filter, weights);
+
+    uint32_t width = pTextDesc->mWidth;
+    uint32_t height = pTextDesc->mHeight;
+    uint32_t numLevels = max((uint32_t)log2(width), (uint32_t)log2(height)) + 1u;
+    uint32_t channels = TinyImageFormat_ChannelCount(pTextDesc->mFormat);
+    uint32_t pixelSize = channels * GetMipPixelTypeSize(type);
+
+    for (uint32_t i = 1; i < numLevels; ++i)
+    {
+        uint32_t prevWidth = max(width >> (i - 1u), 1u);
+        uint32_t prevHeight = max(height >> (i - 1u), 1u);
+        uint32_t mipWidth = max(width >> i, 1u);
+        uint32_t mipHeight = max(height >> i, 1u);
+
+        ppData[i] = (uint8_t*)tf_malloc(mipWidth * mipHeight * pixelSize);
+        pImageDataSize[i] = mipWidth * mipHeight * pixelSize;
+
+        FilterMipLevel(pKernels, ppData[i - 1], prevWidth, prevHeight, ppData[i], mipWidth, mipHeight, type, channels, weights, taps);
+    }
+
+    pTextDesc->mMipLevels = numLevels;
+}
+
+void GenerateMipmapsWithFilter(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextDesc,
+                               TextureMipmapFilter filter)
+{
+    MipPixelType type = MIP_PIXEL_UNORM8;
+    const bool   supportedFormat = GetMipPixelType(pTextDesc->mFormat, &type);
+
+    // stb_image_resize is only used with 8 bit channels here, float formats get the box filter by default
+    if (filter == MIPMAP_FILTER_DEFAULT && supportedFormat && (type == MIP_PIXEL_HALF || type == MIP_PIXEL_FLOAT))
+    {
+        filter = MIPMAP_FILTER_BOX;
+    }
+    if (filter != MIPMAP_FILTER_DEFAULT && !supportedFormat)
+    {
+        LOGF(eWARNING, "Mipmap filter isn't supported for format %s, using the default filter", TinyImageFormat_Name(pTextDesc->mFormat));
+        filter = MIPMAP_FILTER_DEFAULT;
+    }
+    if (filter == MIPMAP_FILTER_DEFAULT)
+    {
+        GenerateMipmapsStb(ppData, pImageDataSize, pTextDesc);
+        return;
+    }
+
+    const MipFilterKernels* pKernels = GetMipFilterKernels();
+    GenerateFilteredMipmaps(pKernels, filter, type, ppData, pImageDataSize, pTextDesc);
+
+    LOGF(eINFO, "Generated %u mips with the %s filter (%s kernels)", pTextDesc->mMipLevels - 1,
+         filter == MIPMAP_FILTER_KAISER ? "kaiser" : "box", pKernels->pName);
+}
+
+void GenerateMipmaps(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextDesc)
+{
+    GenerateMipmapsWithFilter(ppData, pImageDataSize, pTextDesc, MIPMAP_FILTER_DEFAULT);
+}
+
 void GenerateVMFFilteredMipmaps(uint8_t* ppData[MAX_MIPLEVELS], uint32_t* pImageDataSize, TextureDesc* pTextureDesc, uint32_t channelCount,
                                 void* pUserData)
 {
@@ -1024,221 +1629,1093 @@ void onTextureFound(ResourceDirectory resourceDir, const char* filename, void* p
     arrpush(*fileNames, bdynfromcstr(filename));
 }
 
-bool ProcessTextures(AssetPipelineParams* assetParams, ProcessTexturesParams* texturesParams)
+// Writes a KTX2 file, ppMips holds all the layers of each mip. Mips are zstd supercompressed when zstdLevel isn't zero.
+// The data format descriptor only describes the texel block, loaders are expected to use vkFormat.
+static bool WriteKTX2Image(FileStream* pFile, uint32_t width, uint32_t height, uint32_t depth, uint32_t slices, uint32_t mipLevels,
+                           TinyImageFormat format, bool cubemap, const uint32_t* pMipSizes, const void* const* ppMips, int zstdLevel)
 {
-    // TODO:
-    //  - Texture arrays
-    //  - Cubemaps
-    //  - HDR texture support
-
-    bool     error = false;
-    // Get all image files
-    bstring* inputImgFileNames = NULL;
-
-    if (assetParams->mPathMode == PROCESS_MODE_FILE)
+    const TinyImageFormat_VkFormat vkFormat = TinyImageFormat_ToVkFormat(format);
+    if (vkFormat == TIF_VK_FORMAT_UNDEFINED || mipLevels == 0 || mipLevels > KTX2_MAX_LEVELS)
     {
-        arrpush(inputImgFileNames, bdynfromcstr(assetParams->mInFilePath));
+        return false;
+    }
+
+    const uint32_t blockBytes = TinyImageFormat_BitSizeOfBlock(format) / 8;
+    const uint32_t channelCount = max(1u, TinyImageFormat_ChannelCount(format));
+    const bool     supercompressed = zstdLevel != 0;
+
+    KTX2Header header = {};
+    memcpy(header.mIdentifier, gKTX2Identifier, sizeof(gKTX2Identifier));
+    header.mVkFormat = (uint32_t)vkFormat;
+    header.mTypeSize = TinyImageFormat_IsCompressed(format) ? 1 : (blockBytes % channelCount ? blockBytes : blockBytes / channelCount);
+    header.mPixelWidth = width;
+    header.mPixelHeight = height;
+    header.mPixelDepth = depth > 1 ? depth : 0;
+    header.mLayerCount = slices > 1 ? slices : 0;
+    header.mFaceCount = cubemap ? 6 : 1;
+    header.mLevelCount = mipLevels;
+    header.mSupercompressionScheme = supercompressed ? KTX2_SUPERCOMPRESSION_ZSTD : KTX2_SUPERCOMPRESSION_NONE;
+
+    // Basic data format descriptor without samples
+    uint32_t dfd[7] = {};
+    dfd[0] = sizeof(dfd);
+    dfd[2] = 2u | (24u << 16); // version 1.3, descriptor block size
+    dfd[3] = (1u << 8) | ((TinyImageFormat_IsSRGB(format) ? 2u : 1u) << 16); // BT709 primaries, sRGB or linear transfer
+    dfd[4] = (TinyImageFormat_WidthOfBlock(format) - 1) | ((TinyImageFormat_HeightOfBlock(format) - 1) << 8) |
+             ((TinyImageFormat_DepthOfBlock(format) - 1) << 16);
+    dfd[5] = supercompressed ? 0 : blockBytes;
+
+    header.mDfdByteOffset = (uint32_t)(sizeof(KTX2Header) + sizeof(KTX2Level) * mipLevels);
+    header.mDfdByteLength = sizeof(dfd);
+
+    const void* ppLevelData[KTX2_MAX_LEVELS] = {};
+    uint8_t*    ppCompressed[KTX2_MAX_LEVELS] = {};
+    KTX2Level   levels[KTX2_MAX_LEVELS] = {};
+    bool        success = true;
+
+    ZSTD_CCtx* pCtx = supercompressed ? ZSTD_createCCtx() : NULL;
+    success = !supercompressed || pCtx;
+    for (uint32_t mip = 0; mip < mipLevels && success; ++mip)
+    {
+        levels[mip].mUncompressedByteLength = pMipSizes[mip];
+        if (!supercompressed)
+        {
+            ppLevelData[mip] = ppMips[mip];
+            levels[mip].mByteLength = pMipSizes[mip];
+            continue;
+        }
+
+        const size_t bound = ZSTD_compressBound(pMipSizes[mip]);
+        ppCompressed[mip] = (uint8_t*)tf_malloc(bound);
+        const size_t size = ZSTD_compressCCtx(pCtx, ppCompressed[mip], bound, ppMips[mip], pMipSizes[mip], zstdLevel);
+        success = !ZSTD_isError(size);
+        ppLevelData[mip] = ppCompressed[mip];
+        levels[mip].mByteLength = size;
+    }
+    ZSTD_freeCCtx(pCtx);
+
+    // Mips are stored from the smallest one, uncompressed mips are aligned to the texel block and 4 bytes
+    uint64_t       offset = header.mDfdByteOffset + header.mDfdByteLength;
+    const uint64_t blockAlignment = blockBytes % 4 == 0 ? blockBytes : (blockBytes % 2 == 0 ? blockBytes * 2 : blockBytes * 4);
+    const uint64_t alignment = supercompressed ? 1 : max((uint64_t)1, blockAlignment);
+    for (uint32_t mip = mipLevels; mip-- > 0;)
+    {
+        levels[mip].mByteOffset = round_up_64(offset, alignment);
+        offset = levels[mip].mByteOffset + levels[mip].mByteLength;
+    }
+
+    if (success)
+    {
+        static const uint8_t padding[16] = {};
+        uint64_t             written = 0;
+        written += fsWriteToStream(pFile, &header, sizeof(header));
+        written += fsWriteToStream(pFile, levels, sizeof(KTX2Level) * mipLevels);
+        written += fsWriteToStream(pFile, dfd, sizeof(dfd));
+        for (uint32_t mip = mipLevels; mip-- > 0 && success;)
+        {
+            written += fsWriteToStream(pFile, padding, (size_t)(levels[mip].mByteOffset - written));
+            written += fsWriteToStream(pFile, ppLevelData[mip], (size_t)levels[mip].mByteLength);
+            success = written == levels[mip].mByteOffset + levels[mip].mByteLength;
+        }
+    }
+
+    for (uint32_t mip = 0; mip < mipLevels; ++mip)
+    {
+        tf_free(ppCompressed[mip]);
+    }
+    return success;
+}
+
+// One input file of ProcessTextures, files are independent so each one is processed by its own task
+typedef struct TextureFileTask
+{
+    AssetPipelineParams*   pAssetParams;
+    ProcessTexturesParams* pTexturesParams;
+    ThreadSystem           mThreadSystem;
+    const char*            pInFileName;
+    ProcessedTextureData   mOutData;
+    bool                   mHasOutData;
+    bool                   mSkipped;
+    bool                   mError;
+    // Microseconds spent in each stage
+    int64_t                mLoadTime;
+    int64_t                mMipsTime;
+    int64_t                mCompressTime;
+    int64_t                mWriteTime;
+} TextureFileTask;
+
+// Build cache hash of everything the output of ProcessTextureFile depends on
+static bool HashTextureInputs(const AssetPipelineParams* assetParams, const ProcessTexturesParams* pParams, const char* inFileName,
+                              const char* inExtension, uint64_t* pOutHash)
+{
+    const int32_t settings[] = {
+        (int32_t)pParams->mContainer,           pParams->mSupercompressionLevel,   (int32_t)pParams->mCompression,
+        (int32_t)pParams->mOverrideASTC,        (int32_t)pParams->mOverrideBC,     (int32_t)pParams->mInputLinearColorSpace,
+        (int32_t)pParams->mGenerateMipmaps,     (int32_t)pParams->mMipmapFilter,   pParams->pRoughnessFilePath != NULL,
+    };
+    // Custom mipmap callbacks can't be hashed, callers bump mAdditionalModifiedTime when they change like with the modification time
+    // checks
+    const int64_t additionalModifiedTime = (int64_t)assetParams->mAdditionalModifiedTime;
+
+    uint64_t hash = BuildCacheHash(BUILD_CACHE_HASH_SEED, "ProcessTextures", strlen("ProcessTextures"));
+    hash = BuildCacheHash(hash, settings, sizeof(settings));
+    hash = BuildCacheHash(hash, &additionalModifiedTime, sizeof(additionalModifiedTime));
+    hash = BuildCacheHash(hash, inExtension, strlen(inExtension));
+    if (!BuildCacheHashFile(assetParams->mRDInput, inFileName, &hash))
+    {
+        return false;
+    }
+    if (pParams->pRoughnessFilePath && !BuildCacheHashFile(assetParams->mRDInput, pParams->pRoughnessFilePath, &hash))
+    {
+        return false;
+    }
+
+    *pOutHash = hash;
+    return true;
+}
+
+// Bytes of the mips of a texture for the profile
+static uint64_t GetMipDataSize(const uint32_t* pMipSizes, uint32_t mipLevels)
+{
+    uint64_t size = 0;
+    for (uint32_t mip = 0; mip < min(mipLevels, (uint32_t)MAX_MIPLEVELS); ++mip)
+        size += pMipSizes[mip];
+    return size;
+}
+
+// Writes the mips in the container of pTexturesParams, ppMips holds all the layers of each mip
+static bool WriteTextureContainer(FileStream* pFile, const char* outFileName, const ProcessTexturesParams* pTexturesParams,
+                                  const TextureDesc* pDesc, TinyImageFormat outFormat, uint32_t* pMipSizes, uint8_t** ppMips)
+{
+    bool error = false;
+
+    const bool     isCubemap = (pDesc->mDescriptors & DESCRIPTOR_TYPE_TEXTURE_CUBE) == DESCRIPTOR_TYPE_TEXTURE_CUBE;
+    // Array size in the disk image needs to be 1 since we'll already multiply it by 6 when loading the texture in runtime
+    const uint32_t arraySize = isCubemap ? pDesc->mArraySize / 6 : pDesc->mArraySize;
+    // Write .ktx file
+    if (pTexturesParams->mContainer == CONTAINER_KTX)
+    {
+        TinyKtx_Format outKtxFormat = TinyImageFormat_ToTinyKtxFormat(outFormat);
+        if (!TinyKtx_WriteImage(&ktxWriteCallbacks, pFile, pDesc->mWidth, pDesc->mHeight, pDesc->mDepth, arraySize, pDesc->mMipLevels,
+                                outKtxFormat, isCubemap, pMipSizes, (const void**)ppMips))
+        {
+            LOGF(eERROR, "Couldn't create ktx file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
+            error = true;
+        }
+    }
+    // Write .ktx2 file
+    else if (pTexturesParams->mContainer == CONTAINER_KTX2)
+    {
+        if (!WriteKTX2Image(pFile, pDesc->mWidth, pDesc->mHeight, pDesc->mDepth, arraySize, pDesc->mMipLevels, outFormat, isCubemap,
+                            pMipSizes, (const void* const*)ppMips, pTexturesParams->mSupercompressionLevel))
+        {
+            LOGF(eERROR, "Couldn't create ktx2 file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
+            error = true;
+        }
+    }
+    // Write .dds file
+    else if (pTexturesParams->mContainer == CONTAINER_DDS)
+    {
+        TinyDDS_Format outDDSFormat = TinyImageFormat_ToTinyDDSFormat(outFormat);
+        if (!TinyDDS_WriteImage(&ddsWriteCallbacks, pFile, pDesc->mWidth, pDesc->mHeight, pDesc->mDepth, arraySize, pDesc->mMipLevels,
+                                outDDSFormat, isCubemap, false, pMipSizes, (const void**)ppMips))
+        {
+            LOGF(eERROR, "Couldn't create dds file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
+            error = true;
+        }
+    }
+#ifdef XBOX_SCARLETT_DDS
+    else if (pTexturesParams->mContainer == CONTAINER_SCARLETT_DDS)
+    {
+        extern bool swizzleAndWriteDds(TinyDDS_WriteCallbacks const* callbacks, void* user, uint32_t width, uint32_t height,
+                                       uint32_t depth, uint32_t slices, uint32_t mipmaplevels, TinyDDS_Format format, bool cubemap,
+                                       uint32_t const* mipmapsizes, void const** mipmaps);
+
+        TinyDDS_Format outDDSFormat = TinyImageFormat_ToTinyDDSFormat(outFormat);
+        if (!swizzleAndWriteDds(&ddsWriteCallbacks, pFile, pDesc->mWidth, pDesc->mHeight, pDesc->mDepth, pDesc->mArraySize,
+                                pDesc->mMipLevels, outDDSFormat, isCubemap, pMipSizes, (const void**)ppMips))
+        {
+            LOGF(eERROR, "Couldn't create Scarlett dds file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
+            error = true;
+        }
+    }
+#endif
+#ifdef PROSPERO_GNF
+    else if (pTexturesParams->mContainer == CONTAINER_GNF_ORBIS || pTexturesParams->mContainer == CONTAINER_GNF_PROSPERO)
+    {
+        extern bool writeGnfTexture(FileStream * outFile, uint32_t width, uint32_t height, uint32_t depth, uint32_t slices,
+                                    uint32_t mipmaplevels, TinyImageFormat format, bool cubemap, TextureContainer outTexContainer,
+                                    uint32_t tilingQuality, uint32_t const* mipmapsizes, void const** mipmaps);
+
+        if (!writeGnfTexture(pFile, pDesc->mWidth, pDesc->mHeight, pDesc->mDepth, pDesc->mArraySize, pDesc->mMipLevels, outFormat,
+                             isCubemap, pTexturesParams->mContainer, 1, pMipSizes, (const void**)ppMips))
+        {
+            LOGF(eERROR, "Couldn't create gnf file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
+            error = true;
+        }
+    }
+#endif
+    else
+    {
+        ASSERT(false && "No supported output extension");
+    }
+
+    return !error;
+}
+
+static void ProcessTextureFile(TextureFileTask* pTask)
+{
+    AssetPipelineParams*  assetParams = pTask->pAssetParams;
+    TinyImageFormat       outFormat = TinyImageFormat_UNDEFINED;
+    ProcessTexturesParams copyTextureParams = *pTask->pTexturesParams;
+    bool                  useVMF = copyTextureParams.pRoughnessFilePath != NULL;
+    bool                  error = false;
+
+    const char* inFileName = pTask->pInFileName;
+
+    char inExtension[FS_MAX_PATH] = { 0 };
+    fsGetPathExtension(inFileName, inExtension);
+
+    char outFileName[FS_MAX_PATH] = { 0 };
+
+    if (assetParams->mOutSubdir)
+    {
+        char fileName[FS_MAX_PATH] = {};
+        fsGetPathFileName(inFileName, fileName);
+
+        strcat(fileName, ".tex");
+
+        fsAppendPathComponent(assetParams->mOutSubdir, fileName, outFileName);
+    }
+    else
+    {
+        fsReplacePathExtension(inFileName, "tex", outFileName);
+    }
+
+    // With the build cache compare content hashes, a failed hash leaves buildHash at 0 so the output isn't recorded
+    uint64_t buildHash = 0;
+    if (assetParams->pBuildCache)
+    {
+        if (HashTextureInputs(assetParams, &copyTextureParams, inFileName, inExtension, &buildHash) && !assetParams->mSettings.force &&
+            BuildCacheIsUpToDate(assetParams, outFileName, buildHash))
+        {
+            LOGF(eINFO, "Skipping %s", inFileName);
+            pTask->mSkipped = true;
+            return;
+        }
+    }
+    // If input file newer than output file redo compression
+    else if (!assetParams->mSettings.force && fsFileExist(assetParams->mRDOutput, outFileName))
+    {
+        time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, inFileName);
+        if (assetParams->mAdditionalModifiedTime != 0)
+            lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
+
+        time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, outFileName);
+
+        if (lastModified < lastProcessed)
+        {
+            LOGF(eINFO, "Skipping %s", inFileName);
+            pTask->mSkipped = true;
+            return;
+        }
+    }
+
+    LOGF(eINFO, "Converting texture %s from .%s to .%s with output container : %s", inFileName, copyTextureParams.mInExt, "tex",
+         gExtensions[copyTextureParams.mContainer]);
+
+    const uint64_t     inputSize = GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDInput, inFileName);
+    AssetPipelineScope fileScope = BeginAssetPipelineScope(assetParams, "Texture", inFileName);
+    AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, "Texture load", inFileName);
+
+    /////////////////////////////////
+    // Load raw image data
+    ////////////////////////////////
+    InputTextureData inputTextureData = {};
+    if (!LoadTextureData(assetParams->mRDInput, inFileName, inExtension, &copyTextureParams, &inputTextureData))
+    {
+        pTask->mError = true;
+        return;
+    }
+
+    /////////////////////////////////
+    // vMF
+    /////////////////////////////////
+    vec3* rData = nullptr;
+
+    if (useVMF)
+    {
+        InputTextureData inputRoughnessTextureData = {};
+        if (!LoadTextureData(assetParams->mRDInput, copyTextureParams.pRoughnessFilePath, inExtension, &copyTextureParams,
+                             &inputRoughnessTextureData))
+        {
+            pTask->mError = true;
+            return;
+        }
+
+        rData = (vec3*)tf_malloc(inputTextureData.mDesc.mWidth * inputTextureData.mDesc.mHeight * sizeof(vec3));
+
+        if (!GenerateVMFLayer(&inputTextureData, &inputRoughnessTextureData, rData))
+        {
+            error = true;
+        }
+
+        // Release rougness texture data
+        for (size_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
+        {
+            tf_free(inputRoughnessTextureData.pData[mip]);
+            inputRoughnessTextureData.pData[mip] = NULL;
+            inputRoughnessTextureData.mDataSize[mip] = 0;
+        }
+
+        copyTextureParams.pCallbackUserData = rData;
+        copyTextureParams.mGenerateMipmaps = TextureMipmap::MIPMAP_CUSTOM;
+        copyTextureParams.pGenerateMipmapsCallback = GenerateVMFFilteredMipmaps;
+
+        if (copyTextureParams.mCompression == COMPRESSION_BC && copyTextureParams.mOverrideBC == DXT_NONE)
+        {
+            LOGF(eINFO, "Using DXT_BC5 compression for vMF output");
+            copyTextureParams.mOverrideBC = DXT_BC5;
+        }
+    }
+
+    const uint64_t loadedSize = GetMipDataSize(inputTextureData.mDataSize, inputTextureData.mDesc.mMipLevels);
+    pTask->mLoadTime = EndAssetPipelineScope(assetParams, &scope, inputSize, loadedSize);
+    scope = BeginAssetPipelineScope(assetParams, "Texture mips", inFileName);
+
+    /////////////////////////////////
+    // Generate mipmaps
+    /////////////////////////////////
+    if (copyTextureParams.mGenerateMipmaps == MIPMAP_CUSTOM)
+    {
+        ASSERT(copyTextureParams.pGenerateMipmapsCallback && "MIPMAP_CUSTOM requires pGenerateMipmapsCallback to be set");
+        if (inputTextureData.pData[0])
+        {
+            uint32_t channels = TinyImageFormat_ChannelCount(inputTextureData.mDesc.mFormat);
+            copyTextureParams.pGenerateMipmapsCallback(inputTextureData.pData, inputTextureData.mDataSize, &inputTextureData.mDesc,
+                                                       channels, copyTextureParams.pCallbackUserData);
+        }
+    }
+
+    if (copyTextureParams.mGenerateMipmaps == MIPMAP_DEFAULT && inputTextureData.mDesc.mMipLevels <= 1 &&
+        !inputTextureData.isCompressed)
+    {
+        if (inputTextureData.pData[0])
+        {
+            GenerateMipmapsWithFilter(inputTextureData.pData, inputTextureData.mDataSize, &inputTextureData.mDesc,
+                                      copyTextureParams.mMipmapFilter);
+        }
+    }
+
+    if (useVMF)
+    {
+        tf_free(rData);
+    }
+
+    const uint64_t rawSize = GetMipDataSize(inputTextureData.mDataSize, inputTextureData.mDesc.mMipLevels);
+    pTask->mMipsTime = EndAssetPipelineScope(assetParams, &scope, inputTextureData.mDataSize[0], rawSize);
+
+    const bool compress = !inputTextureData.isCompressed && copyTextureParams.mCompression != TextureCompression::COMPRESSION_NONE;
+    const bool astc = copyTextureParams.mCompression == TextureCompression::COMPRESSION_ASTC;
+    scope = BeginAssetPipelineScope(assetParams, compress ? (astc ? "Texture ASTC" : "Texture BC") : "Texture copy", inFileName);
+
+    /////////////////////////////////
+    // Compress
+    /////////////////////////////////
+    CompressImageDescriptor compressDesc = {};
+
+    if (inputTextureData.isCompressed)
+    {
+        outFormat = inputTextureData.mDesc.mFormat;
+        LOGF(eWARNING, "Input texture '%s' is already compressed {%s}, copy texture to destination", inFileName,
+             TinyImageFormat_Name(outFormat));
     }
     else
     {
-        DirectorySearch(assetParams->mRDInput, NULL, texturesParams->mInExt, onTextureFound, (void*)&inputImgFileNames,
-                        assetParams->mPathMode == PROCESS_MODE_DIRECTORY_RECURSIVE);
+        outFormat = GetOutputTextureFormat(&copyTextureParams, &inputTextureData.mDesc, &compressDesc);
+    }
+    compressDesc.mThreadSystem = pTask->mThreadSystem;
+
+    uint8_t* pCompressedData[MAX_MIPLEVELS] = { NULL };
+    uint32_t compressedDataSize[MAX_MIPLEVELS] = { 0 };
+
+    if (outFormat == TinyImageFormat_UNDEFINED)
+    {
+        LOGF(eERROR, "Undefined Image format");
+        pTask->mError = true;
+        return;
+    }
+
+    if (compress)
+    {
+        // Process raw image data
+        if (!CompressImageData(inputTextureData.pData, pCompressedData, compressedDataSize, &compressDesc, &inputTextureData.mDesc))
+        {
+            LOGF(eERROR, "Failed to compress texture %s", inFileName);
+            error = true;
+        }
+
+        // Free raw image data, can be released once image is compressed
+        if (inputTextureData.pData[0])
+        {
+            // Release image data
+            for (uint32_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
+            {
+                stbi_image_free(inputTextureData.pData[mip]);
+                inputTextureData.pData[mip] = NULL;
+            }
+        }
+    }
+    else
+    {
+        // Set raw pImageData as out data
+        for (uint32_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
+        {
+            pCompressedData[mip] = inputTextureData.pData[mip];
+            compressedDataSize[mip] = inputTextureData.mDataSize[mip];
+        }
+    }
+
+    const uint64_t compressedSize = GetMipDataSize(compressedDataSize, inputTextureData.mDesc.mMipLevels);
+    pTask->mCompressTime = EndAssetPipelineScope(assetParams, &scope, rawSize, compressedSize);
+    scope = BeginAssetPipelineScope(assetParams, "Texture write", inFileName);
+
+    /////////////////////////////////
+    // Write output
+    /////////////////////////////////
+
+    // Remove old file
+    if (!error)
+    {
+        fsRemoveFile(assetParams->mRDOutput, outFileName);
+    }
+
+    // Make sure output folder exists
+    {
+        char assetPath[FS_MAX_PATH] = {};
+        fsGetParentPath(outFileName, assetPath);
+        fsCreateDirectory(assetParams->mRDOutput, assetPath, true);
+    }
+
+    FileStream outFile = {};
+    const bool outFileOpened = fsOpenStreamFromPath(assetParams->mRDOutput, outFileName, FM_WRITE, &outFile);
+    if (!outFileOpened)
+    {
+        LOGF(eERROR, "Could not open file '%s' for write.", outFileName);
+        error = true;
+    }
+
+    if (!WriteTextureContainer(&outFile, outFileName, &copyTextureParams, &inputTextureData.mDesc, outFormat, compressedDataSize,
+                               pCompressedData))
+    {
+        error = true;
+    }
+
+    // Close out file stream
+    const uint64_t outputSize = outFileOpened ? (uint64_t)max(fsGetStreamSeekPosition(&outFile), (ssize_t)0) : 0;
+    fsCloseStream(&outFile);
+
+    if (pCompressedData[0])
+    {
+        for (size_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
+        {
+            tf_free(pCompressedData[mip]);
+            pCompressedData[mip] = NULL;
+            compressedDataSize[mip] = 0;
+        }
+    }
+
+    // Pushed to ppOutProcessedTextureData in input order once all the files are processed
+    if (copyTextureParams.ppOutProcessedTextureData)
+    {
+        ProcessedTextureData outData = {};
+        outData.mOutputFilePath = bdynfromcstr(outFileName);
+        outData.mWidth = inputTextureData.mDesc.mWidth;
+        outData.mHeight = inputTextureData.mDesc.mHeight;
+        outData.mDepth = inputTextureData.mDesc.mDepth;
+        outData.mArraySize = inputTextureData.mDesc.mArraySize;
+        outData.mMipLevels = inputTextureData.mDesc.mMipLevels;
+        outData.mFormat = (uint32_t)inputTextureData.mDesc.mFormat;
+        pTask->mOutData = outData;
+        pTask->mHasOutData = true;
+    }
+
+    // Remove the output file if it was created but process textures failed.
+    if (error)
+    {
+        fsRemoveFile(assetParams->mRDOutput, outFileName);
+    }
+    else if (buildHash)
+    {
+        BuildCacheStore(assetParams, outFileName, buildHash);
+    }
+
+    pTask->mWriteTime = EndAssetPipelineScope(assetParams, &scope, compressedSize, outputSize);
+    EndAssetPipelineScope(assetParams, &fileScope, inputSize, error ? 0 : outputSize);
+    pTask->mError = error;
+
+    LOGF(eINFO, "Texture %s: load %.2f ms, mips %.2f ms, compress %.2f ms, write %.2f ms", inFileName, pTask->mLoadTime / 1000.0,
+         pTask->mMipsTime / 1000.0, pTask->mCompressTime / 1000.0, pTask->mWriteTime / 1000.0);
+}
+
+static void ProcessTextureFileTask(void* pUser, uint64_t) { ProcessTextureFile((TextureFileTask*)pUser); }
+
+bool ProcessTextures(AssetPipelineParams* assetParams, ProcessTexturesParams* texturesParams)
+{
+    // TODO:
+    //  - Texture arrays
+    //  - Cubemaps
+    //  - HDR texture support
+
+    bool     error = false;
+    // Get all image files
+    bstring* inputImgFileNames = NULL;
+
+    if (assetParams->mPathMode == PROCESS_MODE_FILE)
+    {
+        arrpush(inputImgFileNames, bdynfromcstr(assetParams->mInFilePath));
+    }
+    else
+    {
+        InputDirectorySearch(assetParams, texturesParams->mInExt, onTextureFound, (void*)&inputImgFileNames);
+    }
+
+    uint32_t imgFileCount = (uint32_t)arrlenu(inputImgFileNames);
+
+    ThreadSystem threadSystem = AcquireAssetPipelineThreadSystem(assetParams, "ProcessTextures");
+
+    TextureFileTask* pTasks = (TextureFileTask*)tf_calloc(max(imgFileCount, 1u), sizeof(TextureFileTask));
+    for (uint32_t i = 0; i < imgFileCount; ++i)
+    {
+        pTasks[i].pAssetParams = assetParams;
+        pTasks[i].pTexturesParams = texturesParams;
+        pTasks[i].mThreadSystem = threadSystem;
+        pTasks[i].pInFileName = (const char*)inputImgFileNames[i].data;
+    }
+
+    // The calling thread processes files too until the queue is empty
+    const int64_t startTime = getUSec(false);
+    threadSystemAddTaskGroup(threadSystem, ProcessTextureFileTask, imgFileCount, pTasks);
+    while (threadSystemAssist(threadSystem))
+        ;
+    threadSystemWaitIdle(threadSystem);
+    const int64_t totalTime = getUSec(false) - startTime;
+
+    ReleaseAssetPipelineThreadSystem(assetParams, &threadSystem);
+
+    uint32_t processedCount = 0;
+    int64_t  stageTimes[4] = {};
+    for (uint32_t i = 0; i < imgFileCount; ++i)
+    {
+        const TextureFileTask* pTask = &pTasks[i];
+        error |= pTask->mError;
+        RecordAssetPipelineAsset(assetParams, pTask->pInFileName, !pTask->mSkipped && !pTask->mError);
+        if (pTask->mHasOutData)
+        {
+            arrpush(*texturesParams->ppOutProcessedTextureData, pTask->mOutData);
+        }
+        if (!pTask->mSkipped)
+        {
+            ++processedCount;
+            stageTimes[0] += pTask->mLoadTime;
+            stageTimes[1] += pTask->mMipsTime;
+            stageTimes[2] += pTask->mCompressTime;
+            stageTimes[3] += pTask->mWriteTime;
+        }
+    }
+    tf_free(pTasks);
+
+    LOGF(eINFO,
+         "Processed %u of %u textures in %.2f ms with %u threads (summed over files: load %.2f ms, mips %.2f ms, compress %.2f ms, "
+         "write %.2f ms)",
+         processedCount, imgFileCount, totalTime / 1000.0, assetParams->mSettings.threadCount, stageTimes[0] / 1000.0,
+         stageTimes[1] / 1000.0, stageTimes[2] / 1000.0, stageTimes[3] / 1000.0);
+
+    if (inputImgFileNames)
+    {
+        for (uint32_t i = 0; i < imgFileCount; ++i)
+        {
+            bdestroy(&inputImgFileNames[i]);
+        }
+
+        arrfree(inputImgFileNames);
+        inputImgFileNames = NULL;
+    }
+
+    return error;
+}
+
+/************************************************************************/
+// Texture packing
+/************************************************************************/
+#define TEXTURE_PACK_MAX_SIZE 16384u
+
+// One input of PackTextures, loaded and given its mips in array mode by its own task
+typedef struct PackTextureTask
+{
+    AssetPipelineParams*  pAssetParams;
+    // Copy per file since LoadTextureData changes the BC override of 3 channel images
+    ProcessTexturesParams mTexturesParams;
+    const char*           pInFileName;
+    bool                  mGenerateMipmaps;
+    InputTextureData      mData;
+    bool                  mError;
+} PackTextureTask;
+
+// Rectangle of an input in the packed texture, in pixels of the top level
+typedef struct PackTextureEntry
+{
+    uint32_t mLayer;
+    uint32_t mX;
+    uint32_t mY;
+    uint32_t mWidth;
+    uint32_t mHeight;
+} PackTextureEntry;
+
+typedef struct PackAtlasSlot
+{
+    uint32_t mIndex;
+    uint32_t mHeight;
+} PackAtlasSlot;
+
+// Tallest first, then in input order so that the layout only depends on the inputs
+static int ComparePackAtlasSlots(const void* pLhs, const void* pRhs)
+{
+    const PackAtlasSlot* pA = (const PackAtlasSlot*)pLhs;
+    const PackAtlasSlot* pB = (const PackAtlasSlot*)pRhs;
+    if (pA->mHeight != pB->mHeight)
+        return pA->mHeight > pB->mHeight ? -1 : 1;
+    return pA->mIndex < pB->mIndex ? -1 : (pA->mIndex > pB->mIndex ? 1 : 0);
+}
+
+static int ComparePackFileNames(const void* pLhs, const void* pRhs)
+{
+    return strcmp((const char*)((const bstring*)pLhs)->data, (const char*)((const bstring*)pRhs)->data);
+}
+
+// '*' matches any characters and '?' one character, a mismatch after a '*' retries one character further
+static bool MatchPackFilter(const char* pPattern, const char* pName)
+{
+    const char* pStar = NULL;
+    const char* pStarName = NULL;
+    while (*pName)
+    {
+        if (*pPattern == '*')
+        {
+            pStar = pPattern++;
+            pStarName = pName;
+        }
+        else if (*pPattern == '?' || *pPattern == *pName)
+        {
+            ++pPattern;
+            ++pName;
+        }
+        else if (pStar)
+        {
+            pPattern = pStar + 1;
+            pName = ++pStarName;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (*pPattern == '*')
+        ++pPattern;
+    return *pPattern == '\0';
+}
+
+static uint32_t AlignPackSize(uint32_t size, uint32_t alignment) { return (size + alignment - 1) / alignment * alignment; }
+
+// Places the slots in rows of atlasWidth pixels, returns the height of the atlas or UINT32_MAX when a slot is wider than the atlas
+static uint32_t PackAtlasShelves(PackTextureEntry* pEntries, const PackAtlasSlot* pSlots, uint32_t count, uint32_t atlasWidth,
+                                 uint32_t padding, uint32_t alignment)
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t shelfHeight = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        PackTextureEntry* pEntry = &pEntries[pSlots[i].mIndex];
+        const uint32_t    slotWidth = AlignPackSize(pEntry->mWidth + 2 * padding, alignment);
+        if (slotWidth > atlasWidth)
+        {
+            return UINT32_MAX;
+        }
+        if (x + slotWidth > atlasWidth)
+        {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        pEntry->mX = x + padding;
+        pEntry->mY = y + padding;
+        x += slotWidth;
+        shelfHeight = max(shelfHeight, pSlots[i].mHeight);
+    }
+    return y + shelfHeight;
+}
+
+// Copies the image to its rectangle of the atlas and replicates its edge pixels over the padding
+static void BlitAtlasEntry(uint8_t* pAtlas, uint32_t atlasWidth, const uint8_t* pSrc, const PackTextureEntry* pEntry, uint32_t padding,
+                           uint32_t pixelSize)
+{
+    const int32_t   pad = (int32_t)padding;
+    const int32_t   width = (int32_t)pEntry->mWidth;
+    const int32_t   height = (int32_t)pEntry->mHeight;
+    const ptrdiff_t stride = (ptrdiff_t)pixelSize;
+    for (int32_t y = -pad; y < height + pad; ++y)
+    {
+        const uint8_t* pSrcRow = pSrc + (size_t)clamp(y, 0, height - 1) * pEntry->mWidth * pixelSize;
+        uint8_t*       pDstRow = pAtlas + ((size_t)((int32_t)pEntry->mY + y) * atlasWidth + pEntry->mX) * pixelSize;
+        for (int32_t x = -pad; x < 0; ++x)
+            memcpy(pDstRow + x * stride, pSrcRow, pixelSize);
+        memcpy(pDstRow, pSrcRow, pEntry->mWidth * pixelSize);
+        for (int32_t x = width; x < width + pad; ++x)
+            memcpy(pDstRow + x * stride, pSrcRow + (width - 1) * stride, pixelSize);
+    }
+}
+
+static void LoadPackTextureTask(void* pUser, uint64_t)
+{
+    PackTextureTask*     pTask = (PackTextureTask*)pUser;
+    AssetPipelineParams* assetParams = pTask->pAssetParams;
+    InputTextureData*    pData = &pTask->mData;
+    const char*          inFileName = pTask->pInFileName;
+
+    char inExtension[FS_MAX_PATH] = { 0 };
+    fsGetPathExtension(inFileName, inExtension);
+
+    const uint64_t     inputSize = GetAssetPipelineProfileFileSize(assetParams, assetParams->mRDInput, inFileName);
+    AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, "Pack load", inFileName);
+
+    if (!LoadTextureData(assetParams->mRDInput, inFileName, inExtension, &pTask->mTexturesParams, pData) || !pData->pData[0])
+    {
+        pTask->mError = true;
+        return;
+    }
+    if (pData->isCompressed || pData->mDesc.mDepth > 1 || pData->mDesc.mArraySize > 1)
+    {
+        LOGF(eERROR, "Can't pack texture '%s', only uncompressed 2D textures can be packed", inFileName);
+        pTask->mError = true;
+        return;
+    }
+
+    // Mips of the input are dropped, the packed texture gets its own
+    for (uint32_t mip = 1; mip < pData->mDesc.mMipLevels; ++mip)
+    {
+        tf_free(pData->pData[mip]);
+        pData->pData[mip] = NULL;
+        pData->mDataSize[mip] = 0;
+    }
+    pData->mDesc.mMipLevels = 1;
+
+    if (pTask->mGenerateMipmaps)
+    {
+        GenerateMipmapsWithFilter(pData->pData, pData->mDataSize, &pData->mDesc, pTask->mTexturesParams.mMipmapFilter);
+    }
+
+    EndAssetPipelineScope(assetParams, &scope, inputSize, GetMipDataSize(pData->mDataSize, pData->mDesc.mMipLevels));
+}
+
+// Build cache hash of the packed texture, the names are hashed too so that adding or removing an input rebuilds it
+static bool HashPackTexturesInputs(const AssetPipelineParams* assetParams, const ProcessTexturesParams* pParams,
+                                   const PackTexturesParams* pPackParams, const bstring* pFileNames, uint32_t fileCount,
+                                   uint64_t* pOutHash)
+{
+    const int32_t settings[] = {
+        (int32_t)pParams->mContainer,    pParams->mSupercompressionLevel, (int32_t)pParams->mCompression,
+        (int32_t)pParams->mOverrideASTC, (int32_t)pParams->mOverrideBC,   (int32_t)pParams->mInputLinearColorSpace,
+        (int32_t)pParams->mGenerateMipmaps, (int32_t)pParams->mMipmapFilter, (int32_t)pPackParams->mMode,
+        (int32_t)pPackParams->mPadding,
+    };
+    const int64_t additionalModifiedTime = (int64_t)assetParams->mAdditionalModifiedTime;
+
+    uint64_t hash = BuildCacheHash(BUILD_CACHE_HASH_SEED, "PackTextures", strlen("PackTextures"));
+    hash = BuildCacheHash(hash, settings, sizeof(settings));
+    hash = BuildCacheHash(hash, &additionalModifiedTime, sizeof(additionalModifiedTime));
+    for (uint32_t i = 0; i < fileCount; ++i)
+    {
+        const char* fileName = (const char*)pFileNames[i].data;
+        hash = BuildCacheHash(hash, fileName, strlen(fileName) + 1);
+        if (!BuildCacheHashFile(assetParams->mRDInput, fileName, &hash))
+        {
+            return false;
+        }
+    }
+
+    *pOutHash = hash;
+    return true;
+}
+
+static bool WritePackTexturesLookup(AssetPipelineParams* assetParams, const char* lookupFileName, const char* textureFileName,
+                                    const PackTexturesParams* pPackParams, const TextureDesc* pDesc, TinyImageFormat format,
+                                    const bstring* pFileNames, const PackTextureEntry* pEntries, uint32_t count)
+{
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(assetParams->mRDOutput, lookupFileName, FM_WRITE, &file))
+    {
+        LOGF(eERROR, "Could not open file '%s' for write.", lookupFileName);
+        return false;
+    }
+
+    fsWriteToStream(&file, "{\n  \"texture\": ", strlen("{\n  \"texture\": "));
+    WriteJsonString(&file, textureFileName);
+    char text[512] = {};
+    int  size = snprintf(text, sizeof(text),
+                         ",\n  \"mode\": \"%s\",\n  \"format\": \"%s\",\n  \"width\": %u,\n  \"height\": %u,\n  \"layers\": %u,\n"
+                         "  \"mipLevels\": %u,\n  \"entries\": [",
+                         pPackParams->mMode == TEXTURE_PACK_ARRAY ? "array" : "atlas", TinyImageFormat_Name(format), pDesc->mWidth,
+                         pDesc->mHeight, pDesc->mArraySize, pDesc->mMipLevels);
+    fsWriteToStream(&file, text, (size_t)size);
+
+    // UVs are relative to the written size, compression can pad the texture to a multiple of the block size
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const PackTextureEntry* pEntry = &pEntries[i];
+        const char*             entryStart = i ? ",\n    { \"name\": " : "\n    { \"name\": ";
+        fsWriteToStream(&file, entryStart, strlen(entryStart));
+        WriteJsonString(&file, (const char*)pFileNames[i].data);
+        size = snprintf(text, sizeof(text),
+                        ", \"layer\": %u, \"x\": %u, \"y\": %u, \"width\": %u, \"height\": %u, \"uv\": [ %.8f, %.8f, %.8f, %.8f ] }",
+                        pEntry->mLayer, pEntry->mX, pEntry->mY, pEntry->mWidth, pEntry->mHeight, (double)pEntry->mX / pDesc->mWidth,
+                        (double)pEntry->mY / pDesc->mHeight, (double)(pEntry->mX + pEntry->mWidth) / pDesc->mWidth,
+                        (double)(pEntry->mY + pEntry->mHeight) / pDesc->mHeight);
+        fsWriteToStream(&file, text, (size_t)size);
+    }
+    fsWriteToStream(&file, "\n  ]\n}\n", strlen("\n  ]\n}\n"));
+
+    fsCloseStream(&file);
+    return true;
+}
+
+// Lays the inputs out in an atlas and copies them to it, the mips of the atlas are generated afterwards
+static bool ComposeTextureAtlas(PackTextureTask* pTasks, PackTextureEntry* pEntries, uint32_t count, uint32_t padding,
+                                uint32_t alignment, InputTextureData* pOut)
+{
+    PackAtlasSlot* pSlots = (PackAtlasSlot*)tf_malloc(count * sizeof(PackAtlasSlot));
+    uint32_t       maxSlotWidth = alignment;
+    uint64_t       usedArea = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        pEntries[i].mWidth = pTasks[i].mData.mDesc.mWidth;
+        pEntries[i].mHeight = pTasks[i].mData.mDesc.mHeight;
+        usedArea += (uint64_t)pEntries[i].mWidth * pEntries[i].mHeight;
+        pSlots[i].mIndex = i;
+        pSlots[i].mHeight = AlignPackSize(pEntries[i].mHeight + 2 * padding, alignment);
+        maxSlotWidth = max(maxSlotWidth, AlignPackSize(pEntries[i].mWidth + 2 * padding, alignment));
+    }
+    qsort(pSlots, count, sizeof(PackAtlasSlot), ComparePackAtlasSlots);
+
+    // Power of two width with the smallest area, the squarer atlas on ties
+    uint32_t bestWidth = 0;
+    uint64_t bestArea = UINT64_MAX;
+    uint32_t bestSide = UINT32_MAX;
+    for (uint32_t width = 1; width <= TEXTURE_PACK_MAX_SIZE; width *= 2)
+    {
+        if (width < maxSlotWidth)
+            continue;
+        const uint32_t height = PackAtlasShelves(pEntries, pSlots, count, width, padding, alignment);
+        if (height > TEXTURE_PACK_MAX_SIZE)
+            continue;
+        const uint64_t area = (uint64_t)width * height;
+        if (area < bestArea || (area == bestArea && max(width, height) < bestSide))
+        {
+            bestWidth = width;
+            bestArea = area;
+            bestSide = max(width, height);
+        }
     }
-
-    uint32_t imgFileCount = (uint32_t)arrlenu(inputImgFileNames);
-
-    for (uint32_t i = 0; i < imgFileCount; ++i)
+    if (!bestWidth)
     {
-        TinyImageFormat       outFormat = TinyImageFormat_UNDEFINED;
-        ProcessTexturesParams copyTextureParams = *texturesParams;
-        bool                  useVMF = copyTextureParams.pRoughnessFilePath != NULL;
+        LOGF(eERROR, "Packed textures don't fit in a %ux%u atlas", TEXTURE_PACK_MAX_SIZE, TEXTURE_PACK_MAX_SIZE);
+        tf_free(pSlots);
+        return false;
+    }
+    const uint32_t atlasHeight = PackAtlasShelves(pEntries, pSlots, count, bestWidth, padding, alignment);
+    tf_free(pSlots);
 
-        const char* inFileName = (char*)inputImgFileNames[i].data;
+    const TinyImageFormat format = pTasks[0].mData.mDesc.mFormat;
+    const uint32_t        pixelSize = TinyImageFormat_BitSizeOfBlock(format) / 8;
 
-        char inExtension[FS_MAX_PATH] = { 0 };
-        fsGetPathExtension(inFileName, inExtension);
+    pOut->mDesc = pTasks[0].mData.mDesc;
+    pOut->mDesc.mWidth = bestWidth;
+    pOut->mDesc.mHeight = atlasHeight;
+    pOut->mDesc.mMipLevels = 1;
+    pOut->mDataSize[0] = bestWidth * atlasHeight * pixelSize;
+    pOut->pData[0] = (uint8_t*)tf_calloc(1, pOut->mDataSize[0]);
 
-        char outFileName[FS_MAX_PATH] = { 0 };
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        BlitAtlasEntry(pOut->pData[0], bestWidth, pTasks[i].mData.pData[0], &pEntries[i], padding, pixelSize);
+    }
 
-        if (assetParams->mOutSubdir)
-        {
-            char fileName[FS_MAX_PATH] = {};
-            fsGetPathFileName(inFileName, fileName);
+    LOGF(eINFO, "Packed %u textures in a %ux%u atlas, %.1f%% of it used", count, bestWidth, atlasHeight,
+         100.0 * usedArea / bestArea);
+    return true;
+}
 
-            strcat(fileName, ".tex");
+// Loads, packs, compresses and writes the inputs and the lookup table, returns true on error
+static bool PackTextureFiles(AssetPipelineParams* assetParams, ProcessTexturesParams* texturesParams, PackTexturesParams* packParams,
+                             const bstring* pFileNames, uint32_t count, const char* outFileName, const char* lookupFileName)
+{
+    const bool atlas = packParams->mMode == TEXTURE_PACK_ATLAS;
+    const bool generateMipmaps = texturesParams->mGenerateMipmaps == MIPMAP_DEFAULT;
 
-            fsAppendPathComponent(assetParams->mOutSubdir, fileName, outFileName);
-        }
-        else
-        {
-            fsReplacePathExtension(inFileName, "tex", outFileName);
-        }
+    // Generated atlas mips stop once the padding is down to one pixel. Slots are aligned so that at every level they start on a pixel and
+    // on a compression block.
+    uint32_t atlasMipLevels = 1;
+    for (uint32_t padding = packParams->mPadding; generateMipmaps && padding > 1; padding /= 2)
+        ++atlasMipLevels;
+    const uint32_t alignment = 4u << (atlasMipLevels - 1);
 
-        // If input file newer than output file redo compression
-        if (!assetParams->mSettings.force && fsFileExist(assetParams->mRDOutput, outFileName))
-        {
-            time_t lastModified = fsGetLastModifiedTime(assetParams->mRDInput, inFileName);
-            if (assetParams->mAdditionalModifiedTime != 0)
-                lastModified = max(lastModified, assetParams->mAdditionalModifiedTime);
+    LOGF(eINFO, "Packing %u textures into %s as %s", count, outFileName, atlas ? "an atlas" : "a texture array");
 
-            time_t lastProcessed = fsGetLastModifiedTime(assetParams->mRDOutput, outFileName);
+    AssetPipelineScope packScope = BeginAssetPipelineScope(assetParams, "Pack", outFileName);
+    AssetPipelineScope scope = BeginAssetPipelineScope(assetParams, "Pack inputs", outFileName);
 
-            if (lastModified < lastProcessed)
-            {
-                LOGF(eINFO, "Skipping %s", inFileName);
-                continue;
-            }
-        }
+    // Inputs are loaded in parallel, in array mode their mips are generated by the same task
+    ThreadSystem     threadSystem = AcquireAssetPipelineThreadSystem(assetParams, "PackTextures");
+    PackTextureTask* pTasks = (PackTextureTask*)tf_calloc(count, sizeof(PackTextureTask));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        pTasks[i].pAssetParams = assetParams;
+        pTasks[i].mTexturesParams = *texturesParams;
+        pTasks[i].pInFileName = (const char*)pFileNames[i].data;
+        pTasks[i].mGenerateMipmaps = generateMipmaps && !atlas;
+    }
+    threadSystemAddTaskGroup(threadSystem, LoadPackTextureTask, count, pTasks);
+    while (threadSystemAssist(threadSystem))
+        ;
+    threadSystemWaitIdle(threadSystem);
 
-        LOGF(eINFO, "Converting texture %s from .%s to .%s with output container : %s", inFileName, copyTextureParams.mInExt, "tex",
-             gExtensions[copyTextureParams.mContainer]);
+    bool error = false;
+    for (uint32_t i = 0; i < count; ++i)
+        error |= pTasks[i].mError;
 
-        /////////////////////////////////
-        // Load raw image data
-        ////////////////////////////////
-        InputTextureData inputTextureData = {};
-        if (!LoadTextureData(assetParams->mRDInput, inFileName, inExtension, &copyTextureParams, &inputTextureData))
+    const TextureDesc* pFirstDesc = &pTasks[0].mData.mDesc;
+    for (uint32_t i = 1; !error && i < count; ++i)
+    {
+        const TextureDesc* pDesc = &pTasks[i].mData.mDesc;
+        if (pDesc->mFormat != pFirstDesc->mFormat)
         {
+            LOGF(eERROR, "Can't pack '%s' with format %s and '%s' with format %s", pTasks[0].pInFileName,
+                 TinyImageFormat_Name(pFirstDesc->mFormat), pTasks[i].pInFileName, TinyImageFormat_Name(pDesc->mFormat));
             error = true;
-            continue;
         }
-
-        /////////////////////////////////
-        // vMF
-        /////////////////////////////////
-        vec3* rData = nullptr;
-
-        if (useVMF)
+        else if (!atlas && (pDesc->mWidth != pFirstDesc->mWidth || pDesc->mHeight != pFirstDesc->mHeight))
         {
-            InputTextureData inputRoughnessTextureData = {};
-            if (!LoadTextureData(assetParams->mRDInput, copyTextureParams.pRoughnessFilePath, inExtension, &copyTextureParams,
-                                 &inputRoughnessTextureData))
-            {
-                error = true;
-                continue;
-            }
-
-            rData = (vec3*)tf_malloc(inputTextureData.mDesc.mWidth * inputTextureData.mDesc.mHeight * sizeof(vec3));
-
-            if (!GenerateVMFLayer(&inputTextureData, &inputRoughnessTextureData, rData))
-            {
-                error = true;
-            }
-
-            // Release rougness texture data
-            for (size_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
-            {
-                tf_free(inputRoughnessTextureData.pData[mip]);
-                inputRoughnessTextureData.pData[mip] = NULL;
-                inputRoughnessTextureData.mDataSize[mip] = 0;
-            }
-
-            copyTextureParams.pCallbackUserData = rData;
-            copyTextureParams.mGenerateMipmaps = TextureMipmap::MIPMAP_CUSTOM;
-            copyTextureParams.pGenerateMipmapsCallback = GenerateVMFFilteredMipmaps;
-
-            if (copyTextureParams.mCompression == COMPRESSION_BC && copyTextureParams.mOverrideBC == DXT_NONE)
-            {
-                LOGF(eINFO, "Using DXT_BC5 compression for vMF output");
-                copyTextureParams.mOverrideBC = DXT_BC5;
-            }
+            LOGF(eERROR, "Can't pack '%s' of %ux%u in an array of %ux%u textures", pTasks[i].pInFileName, pDesc->mWidth, pDesc->mHeight,
+                 pFirstDesc->mWidth, pFirstDesc->mHeight);
+            error = true;
         }
+    }
 
-        /////////////////////////////////
-        // Generate mipmaps
-        /////////////////////////////////
-        if (copyTextureParams.mGenerateMipmaps == MIPMAP_CUSTOM)
+    InputTextureData  packed = {};
+    PackTextureEntry* pEntries = (PackTextureEntry*)tf_calloc(count, sizeof(PackTextureEntry));
+    if (!error && atlas)
+    {
+        error = !ComposeTextureAtlas(pTasks, pEntries, count, packParams->mPadding, alignment, &packed);
+        if (!error && generateMipmaps)
         {
-            ASSERT(copyTextureParams.pGenerateMipmapsCallback && "MIPMAP_CUSTOM requires pGenerateMipmapsCallback to be set");
-            if (inputTextureData.pData[0])
+            GenerateMipmapsWithFilter(packed.pData, packed.mDataSize, &packed.mDesc, texturesParams->mMipmapFilter);
+            for (uint32_t mip = atlasMipLevels; mip < packed.mDesc.mMipLevels; ++mip)
             {
-                uint32_t channels = TinyImageFormat_ChannelCount(inputTextureData.mDesc.mFormat);
-                copyTextureParams.pGenerateMipmapsCallback(inputTextureData.pData, inputTextureData.mDataSize, &inputTextureData.mDesc,
-                                                           channels, copyTextureParams.pCallbackUserData);
+                tf_free(packed.pData[mip]);
+                packed.pData[mip] = NULL;
+                packed.mDataSize[mip] = 0;
             }
+            packed.mDesc.mMipLevels = min(packed.mDesc.mMipLevels, atlasMipLevels);
         }
-
-        if (copyTextureParams.mGenerateMipmaps == MIPMAP_DEFAULT && inputTextureData.mDesc.mMipLevels <= 1 &&
-            !inputTextureData.isCompressed)
+    }
+    else if (!error)
+    {
+        // The compressors and the containers expect the layers of a mip to be consecutive
+        packed.mDesc = *pFirstDesc;
+        packed.mDesc.mArraySize = count;
+        for (uint32_t mip = 0; mip < packed.mDesc.mMipLevels; ++mip)
         {
-            if (inputTextureData.pData[0])
-            {
-                GenerateMipmaps(inputTextureData.pData, inputTextureData.mDataSize, &inputTextureData.mDesc);
-            }
+            const uint32_t layerSize = pTasks[0].mData.mDataSize[mip];
+            packed.mDataSize[mip] = layerSize * count;
+            packed.pData[mip] = (uint8_t*)tf_malloc(packed.mDataSize[mip]);
+            for (uint32_t i = 0; i < count; ++i)
+                memcpy(packed.pData[mip] + (size_t)layerSize * i, pTasks[i].mData.pData[mip], layerSize);
         }
-
-        if (useVMF)
+        for (uint32_t i = 0; i < count; ++i)
         {
-            tf_free(rData);
+            pEntries[i].mLayer = i;
+            pEntries[i].mWidth = pFirstDesc->mWidth;
+            pEntries[i].mHeight = pFirstDesc->mHeight;
         }
+    }
 
-        /////////////////////////////////
-        // Compress
-        /////////////////////////////////
-        CompressImageDescriptor compressDesc = {};
+    // Load settings of the inputs, the BC override of 3 channel images is the same for all of them since their formats match
+    ProcessTexturesParams compressParams = pTasks[0].mTexturesParams;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        for (uint32_t mip = 0; mip < MAX_MIPLEVELS; ++mip)
+            tf_free(pTasks[i].mData.pData[mip]);
+    }
+    tf_free(pTasks);
 
-        if (inputTextureData.isCompressed)
-        {
-            outFormat = inputTextureData.mDesc.mFormat;
-            LOGF(eWARNING, "Input texture '%s' is already compressed {%s}, copy texture to destination", inFileName,
-                 TinyImageFormat_Name(outFormat));
-        }
-        else
-        {
-            outFormat = GetOutputTextureFormat(&copyTextureParams, &inputTextureData.mDesc, &compressDesc);
-        }
+    const uint64_t rawSize = GetMipDataSize(packed.mDataSize, packed.mDesc.mMipLevels);
+    EndAssetPipelineScope(assetParams, &scope, 0, rawSize);
+
+    /////////////////////////////////
+    // Compress
+    /////////////////////////////////
+    uint8_t*        pCompressedData[MAX_MIPLEVELS] = { NULL };
+    uint32_t        compressedDataSize[MAX_MIPLEVELS] = { 0 };
+    TinyImageFormat outFormat = TinyImageFormat_UNDEFINED;
+    if (!error)
+    {
+        const bool compress = compressParams.mCompression != TextureCompression::COMPRESSION_NONE;
+        const bool astc = compressParams.mCompression == TextureCompression::COMPRESSION_ASTC;
+        scope = BeginAssetPipelineScope(assetParams, compress ? (astc ? "Pack ASTC" : "Pack BC") : "Pack copy", outFileName);
 
-        uint8_t* pCompressedData[MAX_MIPLEVELS] = { NULL };
-        uint32_t compressedDataSize[MAX_MIPLEVELS] = { 0 };
+        CompressImageDescriptor compressDesc = {};
+        outFormat = GetOutputTextureFormat(&compressParams, &packed.mDesc, &compressDesc);
+        compressDesc.mThreadSystem = threadSystem;
 
         if (outFormat == TinyImageFormat_UNDEFINED)
         {
             LOGF(eERROR, "Undefined Image format");
             error = true;
-            continue;
         }
-
-        if (!inputTextureData.isCompressed && copyTextureParams.mCompression != TextureCompression::COMPRESSION_NONE)
+        else if (compress)
         {
-            // Process raw image data
-            if (!CompressImageData(inputTextureData.pData, pCompressedData, compressedDataSize, &compressDesc, &inputTextureData.mDesc))
+            if (!CompressImageData(packed.pData, pCompressedData, compressedDataSize, &compressDesc, &packed.mDesc))
             {
-                LOGF(eERROR, "Failed to compress texture %s", inFileName);
+                LOGF(eERROR, "Failed to compress texture %s", outFileName);
                 error = true;
             }
-
-            // Free raw image data, can be released once image is compressed
-            if (inputTextureData.pData[0])
-            {
-                // Release image data
-                for (uint32_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
-                {
-                    stbi_image_free(inputTextureData.pData[mip]);
-                    inputTextureData.pData[mip] = NULL;
-                }
-            }
         }
         else
         {
-            // Set raw pImageData as out data
-            for (uint32_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
+            for (uint32_t mip = 0; mip < packed.mDesc.mMipLevels; ++mip)
             {
-                pCompressedData[mip] = inputTextureData.pData[mip];
-                compressedDataSize[mip] = inputTextureData.mDataSize[mip];
+                pCompressedData[mip] = packed.pData[mip];
+                compressedDataSize[mip] = packed.mDataSize[mip];
+                packed.pData[mip] = NULL;
             }
         }
 
-        /////////////////////////////////
-        // Write output
-        /////////////////////////////////
+        EndAssetPipelineScope(assetParams, &scope, rawSize, GetMipDataSize(compressedDataSize, packed.mDesc.mMipLevels));
+    }
+    ReleaseAssetPipelineThreadSystem(assetParams, &threadSystem);
 
-        // Remove old file
-        if (!error)
-        {
-            fsRemoveFile(assetParams->mRDOutput, outFileName);
-        }
+    for (uint32_t mip = 0; mip < MAX_MIPLEVELS; ++mip)
+        tf_free(packed.pData[mip]);
+
+    /////////////////////////////////
+    // Write output
+    /////////////////////////////////
+    uint64_t outputSize = 0;
+    if (!error)
+    {
+        scope = BeginAssetPipelineScope(assetParams, "Pack write", outFileName);
 
-        // Make sure output folder exists
+        fsRemoveFile(assetParams->mRDOutput, outFileName);
         {
             char assetPath[FS_MAX_PATH] = {};
             fsGetParentPath(outFileName, assetPath);
@@ -1251,115 +2728,463 @@ bool ProcessTextures(AssetPipelineParams* assetParams, ProcessTexturesParams* te
             LOGF(eERROR, "Could not open file '%s' for write.", outFileName);
             error = true;
         }
+        else
+        {
+            error = !WriteTextureContainer(&outFile, outFileName, &compressParams, &packed.mDesc, outFormat, compressedDataSize,
+                                           pCompressedData);
+            outputSize = (uint64_t)max(fsGetStreamSeekPosition(&outFile), (ssize_t)0);
+            fsCloseStream(&outFile);
+        }
 
-        // Write .ktx file
-        const bool     isCubemap = (inputTextureData.mDesc.mDescriptors & DESCRIPTOR_TYPE_TEXTURE_CUBE) == DESCRIPTOR_TYPE_TEXTURE_CUBE;
-        // Array size in the disk image needs to be 1 since we'll already multiply it by 6 when loading the texture in runtime
-        const uint32_t arraySize = isCubemap ? inputTextureData.mDesc.mArraySize / 6 : inputTextureData.mDesc.mArraySize;
-        if (copyTextureParams.mContainer == CONTAINER_KTX)
+        if (!error)
         {
-            TinyKtx_Format outKtxFormat = TinyImageFormat_ToTinyKtxFormat(outFormat);
-            if (!TinyKtx_WriteImage(&ktxWriteCallbacks, &outFile, inputTextureData.mDesc.mWidth, inputTextureData.mDesc.mHeight,
-                                    inputTextureData.mDesc.mDepth, arraySize, inputTextureData.mDesc.mMipLevels, outKtxFormat, isCubemap,
-                                    compressedDataSize, (const void**)pCompressedData))
-            {
-                LOGF(eERROR, "Couldn't create ktx file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
-                error = true;
-            }
+            error = !WritePackTexturesLookup(assetParams, lookupFileName, outFileName, packParams, &packed.mDesc, outFormat, pFileNames,
+                                             pEntries, count);
         }
-        // Write .dds file
-        else if (copyTextureParams.mContainer == CONTAINER_DDS)
+
+        EndAssetPipelineScope(assetParams, &scope, GetMipDataSize(compressedDataSize, packed.mDesc.mMipLevels), outputSize);
+    }
+
+    for (uint32_t mip = 0; mip < MAX_MIPLEVELS; ++mip)
+        tf_free(pCompressedData[mip]);
+    tf_free(pEntries);
+
+    EndAssetPipelineScope(assetParams, &packScope, rawSize, error ? 0 : outputSize);
+
+    if (!error)
+    {
+        LOGF(eINFO, "Packed %u textures into %s: %ux%u, %u layers, %u mips, %s", count, outFileName, packed.mDesc.mWidth,
+             packed.mDesc.mHeight, packed.mDesc.mArraySize, packed.mDesc.mMipLevels, TinyImageFormat_Name(outFormat));
+    }
+    return error;
+}
+
+bool PackTextures(AssetPipelineParams* assetParams, ProcessTexturesParams* texturesParams, PackTexturesParams* packParams)
+{
+    ASSERT(packParams->pOutName);
+
+    // Get the image files matching the filter, sorted so that layers and the layout don't depend on the file system
+    bstring* inputImgFileNames = NULL;
+    if (assetParams->mPathMode == PROCESS_MODE_FILE)
+    {
+        arrpush(inputImgFileNames, bdynfromcstr(assetParams->mInFilePath));
+    }
+    else
+    {
+        InputDirectorySearch(assetParams, texturesParams->mInExt, onTextureFound, (void*)&inputImgFileNames);
+    }
+
+    for (uint32_t i = 0; packParams->pFilter && i < (uint32_t)arrlenu(inputImgFileNames);)
+    {
+        char fileName[FS_MAX_PATH] = {};
+        char extension[FS_MAX_PATH] = {};
+        fsGetPathFileName((const char*)inputImgFileNames[i].data, fileName);
+        fsGetPathExtension((const char*)inputImgFileNames[i].data, extension);
+        if (extension[0] != '\0')
         {
-            TinyDDS_Format outDDSFormat = TinyImageFormat_ToTinyDDSFormat(outFormat);
-            if (!TinyDDS_WriteImage(&ddsWriteCallbacks, &outFile, inputTextureData.mDesc.mWidth, inputTextureData.mDesc.mHeight,
-                                    inputTextureData.mDesc.mDepth, arraySize, inputTextureData.mDesc.mMipLevels, outDDSFormat, isCubemap,
-                                    false, compressedDataSize, (const void**)pCompressedData))
-            {
-                LOGF(eERROR, "Couldn't create dds file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
-                error = true;
-            }
+            strcat(fileName, ".");
+            strcat(fileName, extension);
         }
-#ifdef XBOX_SCARLETT_DDS
-        else if (copyTextureParams.mContainer == CONTAINER_SCARLETT_DDS)
+
+        if (MatchPackFilter(packParams->pFilter, fileName))
         {
-            extern bool swizzleAndWriteDds(TinyDDS_WriteCallbacks const* callbacks, void* user, uint32_t width, uint32_t height,
-                                           uint32_t depth, uint32_t slices, uint32_t mipmaplevels, TinyDDS_Format format, bool cubemap,
-                                           uint32_t const* mipmapsizes, void const** mipmaps);
+            ++i;
+            continue;
+        }
+        bdestroy(&inputImgFileNames[i]);
+        arrdel(inputImgFileNames, i);
+    }
 
-            TinyDDS_Format outDDSFormat = TinyImageFormat_ToTinyDDSFormat(outFormat);
-            if (!swizzleAndWriteDds(&ddsWriteCallbacks, &outFile, inputTextureData.mDesc.mWidth, inputTextureData.mDesc.mHeight,
-                                    inputTextureData.mDesc.mDepth, inputTextureData.mDesc.mArraySize, inputTextureData.mDesc.mMipLevels,
-                                    outDDSFormat, isCubemap, compressedDataSize, (const void**)pCompressedData))
-            {
-                LOGF(eERROR, "Couldn't create Scarlett dds file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
-                error = true;
-            }
+    const uint32_t imgFileCount = (uint32_t)arrlenu(inputImgFileNames);
+    if (!imgFileCount)
+    {
+        LOGF(eERROR, "No texture to pack into %s", packParams->pOutName);
+        arrfree(inputImgFileNames);
+        return true;
+    }
+    qsort(inputImgFileNames, imgFileCount, sizeof(bstring), ComparePackFileNames);
+
+    char outFileName[FS_MAX_PATH] = { 0 };
+    char lookupFileName[FS_MAX_PATH] = { 0 };
+    {
+        char fileName[FS_MAX_PATH] = {};
+        snprintf(fileName, sizeof(fileName), "%s.tex", packParams->pOutName);
+        if (assetParams->mOutSubdir)
+            fsAppendPathComponent(assetParams->mOutSubdir, fileName, outFileName);
+        else
+            strcpy(outFileName, fileName);
+        fsReplacePathExtension(outFileName, "json", lookupFileName);
+    }
+
+    bool     error = false;
+    bool     skipped = false;
+    uint64_t buildHash = 0;
+    if (assetParams->pBuildCache)
+    {
+        skipped = HashPackTexturesInputs(assetParams, texturesParams, packParams, inputImgFileNames, imgFileCount, &buildHash) &&
+                  !assetParams->mSettings.force && BuildCacheIsUpToDate(assetParams, outFileName, buildHash) &&
+                  BuildCacheIsUpToDate(assetParams, lookupFileName, buildHash);
+    }
+    // If an input file is newer than the packed texture redo the packing
+    else if (!assetParams->mSettings.force && fsFileExist(assetParams->mRDOutput, outFileName) &&
+             fsFileExist(assetParams->mRDOutput, lookupFileName))
+    {
+        time_t lastModified = assetParams->mAdditionalModifiedTime;
+        for (uint32_t i = 0; i < imgFileCount; ++i)
+            lastModified = max(lastModified, fsGetLastModifiedTime(assetParams->mRDInput, (const char*)inputImgFileNames[i].data));
+
+        skipped = lastModified < fsGetLastModifiedTime(assetParams->mRDOutput, outFileName);
+    }
+
+    if (skipped)
+    {
+        LOGF(eINFO, "Skipping %s", outFileName);
+    }
+    else
+    {
+        error = PackTextureFiles(assetParams, texturesParams, packParams, inputImgFileNames, imgFileCount, outFileName, lookupFileName);
+        if (error)
+        {
+            fsRemoveFile(assetParams->mRDOutput, outFileName);
+            fsRemoveFile(assetParams->mRDOutput, lookupFileName);
         }
-#endif
-#ifdef PROSPERO_GNF
-        else if (copyTextureParams.mContainer == CONTAINER_GNF_ORBIS || copyTextureParams.mContainer == CONTAINER_GNF_PROSPERO)
+        else if (buildHash)
         {
-            extern bool writeGnfTexture(FileStream * outFile, uint32_t width, uint32_t height, uint32_t depth, uint32_t slices,
-                                        uint32_t mipmaplevels, TinyImageFormat format, bool cubemap, TextureContainer outTexContainer,
-                                        uint32_t tilingQuality, uint32_t const* mipmapsizes, void const** mipmaps);
-
-            if (!writeGnfTexture(&outFile, inputTextureData.mDesc.mWidth, inputTextureData.mDesc.mHeight, inputTextureData.mDesc.mDepth,
-                                 inputTextureData.mDesc.mArraySize, inputTextureData.mDesc.mMipLevels, outFormat, isCubemap,
-                                 copyTextureParams.mContainer, 1, compressedDataSize, (const void**)pCompressedData))
-            {
-                LOGF(eERROR, "Couldn't create gnf file '%s' with format '%s'", outFileName, TinyImageFormat_Name(outFormat));
-                error = true;
-            }
+            BuildCacheStore(assetParams, outFileName, buildHash);
+            BuildCacheStore(assetParams, lookupFileName, buildHash);
         }
-#endif
-        else
+    }
+
+    for (uint32_t i = 0; i < imgFileCount; ++i)
+    {
+        RecordAssetPipelineAsset(assetParams, (const char*)inputImgFileNames[i].data, !skipped && !error);
+        bdestroy(&inputImgFileNames[i]);
+    }
+    arrfree(inputImgFileNames);
+
+    return error;
+}
+
+/************************************************************************/
+// Self tests
+/************************************************************************/
+static uint32_t TextureTestRandom(uint32_t* pState)
+{
+    // xorshift32, the inputs only need to be reproducible
+    uint32_t x = *pState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pState = x;
+    return x;
+}
+
+static void FillMipFilterTestImage(uint8_t* pData, uint32_t valueCount, MipPixelType type, uint32_t seed)
+{
+    for (uint32_t i = 0; i < valueCount; ++i)
+    {
+        const uint32_t random = TextureTestRandom(&seed);
+        // Float formats get values outside of [0, 1] to cover HDR inputs
+        const float    value = (random >> 8) * (1.0f / 16777216.0f) * 10.0f - 2.0f;
+        switch (type)
+        {
+        case MIP_PIXEL_UNORM8:
+        case MIP_PIXEL_SRGB8:
+            pData[i] = (uint8_t)random;
+            break;
+        case MIP_PIXEL_HALF:
         {
-            ASSERT(false && "No supported output extension");
+            const half encoded(value);
+            memcpy(pData + i * sizeof(uint16_t), &encoded.sh, sizeof(uint16_t));
+            break;
         }
+        case MIP_PIXEL_FLOAT:
+            memcpy(pData + i * sizeof(float), &value, sizeof(float));
+            break;
+        }
+    }
+}
+
+static float DecodeMipFilterTestValue(const uint8_t* pData, uint32_t index, MipPixelType type)
+{
+    switch (type)
+    {
+    case MIP_PIXEL_HALF:
+    {
+        half value;
+        memcpy(&value.sh, pData + index * sizeof(uint16_t), sizeof(uint16_t));
+        return (float)value;
+    }
+    case MIP_PIXEL_FLOAT:
+    {
+        float value = 0.0f;
+        memcpy(&value, pData + index * sizeof(float), sizeof(float));
+        return value;
+    }
+    default:
+        return pData[index];
+    }
+}
+
+// Returns the number of values further apart than the tolerance of the format: one step for 8 bit channels since values close to a
+// rounding boundary can round both ways, one ulp for 16 bit floats and a relative 1e-5 for 32 bit floats since compilers can fuse
+// the multiply-adds of the scalar path
+static uint32_t CompareMipFilterTestLevels(const uint8_t* pKernel, const uint8_t* pScalar, uint32_t valueCount, MipPixelType type,
+                                           float* pMaxError)
+{
+    uint32_t mismatchCount = 0;
+    for (uint32_t i = 0; i < valueCount; ++i)
+    {
+        const float kernel = DecodeMipFilterTestValue(pKernel, i, type);
+        const float scalar = DecodeMipFilterTestValue(pScalar, i, type);
+        const float error = fabsf(kernel - scalar);
+        const float tolerance = type == MIP_PIXEL_FLOAT  ? 1e-5f * max(1.0f, fabsf(scalar))
+                                : type == MIP_PIXEL_HALF ? 1e-3f * max(1.0f, fabsf(scalar))
+                                                         : 1.0f;
+        *pMaxError = max(*pMaxError, error);
+        mismatchCount += error > tolerance ? 1 : 0;
+    }
+    return mismatchCount;
+}
 
-        // Close out file stream
-        fsCloseStream(&outFile);
+bool TestMipmapFilters(AssetPipelineParams* assetParams)
+{
+    UNREF_PARAM(assetParams);
+
+    // Formats of GetMipPixelType
+    const TinyImageFormat formats[] = {
+        TinyImageFormat_R8_UNORM, TinyImageFormat_R8G8_UNORM, TinyImageFormat_R8G8B8_UNORM, TinyImageFormat_R8G8B8A8_UNORM,
+        TinyImageFormat_B8G8R8A8_UNORM, TinyImageFormat_R8G8B8_SRGB, TinyImageFormat_R8G8B8A8_SRGB, TinyImageFormat_B8G8R8A8_SRGB,
+        TinyImageFormat_R16_SFLOAT, TinyImageFormat_R16G16_SFLOAT, TinyImageFormat_R16G16B16_SFLOAT, TinyImageFormat_R16G16B16A16_SFLOAT,
+        TinyImageFormat_R32_SFLOAT, TinyImageFormat_R32G32_SFLOAT, TinyImageFormat_R32G32B32_SFLOAT, TinyImageFormat_R32G32B32A32_SFLOAT
+    };
+    const TextureMipmapFilter filters[] = { MIPMAP_FILTER_BOX, MIPMAP_FILTER_KAISER };
+    // Odd sizes so that the edge padding and the last pixels of the SIMD loops are covered, one row images for the vertical clamping
+    const uint32_t            sizes[][2] = { { 37, 23 }, { 64, 1 }, { 1, 19 } };
+
+    // Every kernel set this CPU can run is compared against the scalar path, not only the one GetMipFilterKernels picks
+    const MipFilterKernels* ppKernels[2] = {};
+    uint32_t                kernelCount = 0;
+#if defined(MIP_KERNELS_SSE)
+    static const MipFilterKernels sse = { "SSE", MipHorizontalPassSSE, MipVerticalPassSSE };
+    static const MipFilterKernels avx2 = { "AVX2", MipHorizontalPassAVX2, MipVerticalPassAVX2 };
+    ppKernels[kernelCount++] = &sse;
+    if (CpuSupportsAVX2())
+    {
+        ppKernels[kernelCount++] = &avx2;
+    }
+#elif defined(MIP_KERNELS_NEON)
+    static const MipFilterKernels neon = { "NEON", MipHorizontalPassNEON, MipVerticalPassNEON };
+    ppKernels[kernelCount++] = &neon;
+#endif
+    if (!kernelCount)
+    {
+        LOGF(eINFO, "Mipmap filters: no SIMD kernels on this platform, nothing to compare");
+        return false;
+    }
 
-        if (pCompressedData[0])
+    bool error = false;
+    for (uint32_t k = 0; k < kernelCount; ++k)
+    {
+        for (uint32_t f = 0; f < TF_ARRAY_COUNT(formats); ++f)
         {
-            for (size_t mip = 0; mip < inputTextureData.mDesc.mMipLevels; ++mip)
+            MipPixelType type = MIP_PIXEL_UNORM8;
+            if (!GetMipPixelType(formats[f], &type))
             {
-                tf_free(pCompressedData[mip]);
-                pCompressedData[mip] = NULL;
-                compressedDataSize[mip] = 0;
+                LOGF(eERROR, "Mipmap filters: %s isn't supported by the filters", TinyImageFormat_Name(formats[f]));
+                error = true;
+                continue;
             }
-        }
 
-        if (copyTextureParams.ppOutProcessedTextureData)
-        {
-            ProcessedTextureData outData = {};
-            outData.mOutputFilePath = bdynfromcstr(outFileName);
-            outData.mWidth = inputTextureData.mDesc.mWidth;
-            outData.mHeight = inputTextureData.mDesc.mHeight;
-            outData.mDepth = inputTextureData.mDesc.mDepth;
-            outData.mArraySize = inputTextureData.mDesc.mArraySize;
-            outData.mMipLevels = inputTextureData.mDesc.mMipLevels;
-            outData.mFormat = (uint32_t)inputTextureData.mDesc.mFormat;
-            arrpush(*copyTextureParams.ppOutProcessedTextureData, outData);
+            for (uint32_t filter = 0; filter < TF_ARRAY_COUNT(filters); ++filter)
+            {
+                for (uint32_t s = 0; s < TF_ARRAY_COUNT(sizes); ++s)
+                {
+                    TextureDesc desc = {};
+                    desc.mWidth = sizes[s][0];
+                    desc.mHeight = sizes[s][1];
+                    desc.mFormat = formats[f];
+
+                    const uint32_t channels = TinyImageFormat_ChannelCount(formats[f]);
+                    const uint32_t valueCount = desc.mWidth * desc.mHeight * channels;
+                    uint8_t*       ppMips[MAX_MIPLEVELS] = {};
+                    uint32_t       mipSizes[MAX_MIPLEVELS] = {};
+                    mipSizes[0] = valueCount * GetMipPixelTypeSize(type);
+                    ppMips[0] = (uint8_t*)tf_malloc(mipSizes[0]);
+                    FillMipFilterTestImage(ppMips[0], valueCount, type, 0x9E3779B9u ^ (f << 8) ^ s);
+                    GenerateFilteredMipmaps(&gMipFilterKernelsScalar, filters[filter], type, ppMips, mipSizes, &desc);
+
+                    // Each level is filtered from the same scalar source so that differences don't add up along the chain
+                    float          weights[MIP_FILTER_MAX_TAPS] = {};
+                    const uint32_t taps = GetMipFilterWeights(filters[filter], weights);
+                    uint32_t       mismatchCount = 0;
+                    float          maxError = 0.0f;
+                    uint8_t*       pKernelMip = (uint8_t*)tf_malloc(mipSizes[1]);
+                    for (uint32_t mip = 1; mip < desc.mMipLevels; ++mip)
+                    {
+                        const uint32_t srcWidth = max(desc.mWidth >> (mip - 1), 1u);
+                        const uint32_t srcHeight = max(desc.mHeight >> (mip - 1), 1u);
+                        const uint32_t dstWidth = max(desc.mWidth >> mip, 1u);
+                        const uint32_t dstHeight = max(desc.mHeight >> mip, 1u);
+                        FilterMipLevel(ppKernels[k], ppMips[mip - 1], srcWidth, srcHeight, pKernelMip, dstWidth, dstHeight, type,
+                                       channels, weights, taps);
+                        mismatchCount +=
+                            CompareMipFilterTestLevels(pKernelMip, ppMips[mip], dstWidth * dstHeight * channels, type, &maxError);
+                    }
+
+                    if (mismatchCount)
+                    {
+                        LOGF(eERROR, "Mipmap filters: %s %s %ux%u %s, %u values differ from the scalar path, max error %f",
+                             ppKernels[k]->pName, filters[filter] == MIPMAP_FILTER_KAISER ? "kaiser" : "box", sizes[s][0], sizes[s][1],
+                             TinyImageFormat_Name(formats[f]), mismatchCount, maxError);
+                        error = true;
+                    }
+
+                    tf_free(pKernelMip);
+                    for (uint32_t i = 0; i < desc.mMipLevels; ++i)
+                    {
+                        tf_free(ppMips[i]);
+                    }
+                }
+            }
         }
 
-        // Remove the output file if it was created but process textures failed.
-        if (error)
+        LOGF(eINFO, "Mipmap filters: %s kernels compared against the scalar path on %u formats", ppKernels[k]->pName,
+             (uint32_t)TF_ARRAY_COUNT(formats));
+    }
+
+    return error;
+}
+
+#define COMPRESSION_SCALING_TEST_SIZE 2048
+
+typedef struct CompressionScalingFormat
+{
+    const char*        pName;
+    TextureCompression mCompression;
+    DXT                mDXTCompression;
+    ASTC               mASTCCompression;
+} CompressionScalingFormat;
+
+// Compresses the mip chain of desc with threadCount workers (0 on the calling thread), returns the time in microseconds or -1 on error
+static int64_t RunCompressionScalingTest(const CompressionScalingFormat* pFormat, uint8_t* ppMips[MAX_MIPLEVELS], const TextureDesc* pDesc,
+                                         uint32_t threadCount, uint8_t* ppOutCompressed[MAX_MIPLEVELS], uint32_t* pCompressedSizes)
+{
+    ThreadSystem threadSystem = NULL;
+    if (threadCount)
+    {
+        ThreadSystemInitDesc threadSystemDesc = gThreadSystemInitDescDefault;
+        threadSystemDesc.threadCount = threadCount;
+        threadSystemDesc.threadName = "CompressionScaling";
+        if (!threadSystemInit(&threadSystem, &threadSystemDesc))
         {
-            fsRemoveFile(assetParams->mRDOutput, outFileName);
+            LOGF(eERROR, "Compression scaling: failed to create %u threads", threadCount);
+            return -1;
         }
     }
 
-    if (inputImgFileNames)
+    CompressImageDescriptor compressDesc = {};
+    compressDesc.mCompression = pFormat->mCompression;
+    compressDesc.mDXTCompression = pFormat->mDXTCompression;
+    compressDesc.mASTCCompression = pFormat->mASTCCompression;
+    compressDesc.mThreadSystem = threadSystem;
+
+    // Compression pads the size of the description to whole blocks
+    TextureDesc   desc = *pDesc;
+    const int64_t startTime = getUSec(false);
+    const bool    success = CompressImageData(ppMips, ppOutCompressed, pCompressedSizes, &compressDesc, &desc);
+    const int64_t time = getUSec(false) - startTime;
+
+    if (threadSystem)
+        threadSystemExit(&threadSystem, &gThreadSystemExitDescDefault);
+    return success ? time : -1;
+}
+
+bool TestCompressionScaling(AssetPipelineParams* assetParams)
+{
+    const CompressionScalingFormat formats[] = {
+        { "BC1", COMPRESSION_BC, DXT_BC1, ASTC_NONE },
+        { "BC7", COMPRESSION_BC, DXT_BC7, ASTC_NONE },
+        { "ASTC 4x4", COMPRESSION_ASTC, DXT_NONE, ASTC_4x4 },
+    };
+
+    // Noise is the slowest input for the block searches, the mips are filtered from it like --mipfilter box
+    TextureDesc desc = {};
+    desc.mWidth = COMPRESSION_SCALING_TEST_SIZE;
+    desc.mHeight = COMPRESSION_SCALING_TEST_SIZE;
+    desc.mArraySize = 1;
+    desc.mFormat = TinyImageFormat_R8G8B8A8_UNORM;
+    uint8_t* ppMips[MAX_MIPLEVELS] = {};
+    uint32_t mipSizes[MAX_MIPLEVELS] = {};
+    mipSizes[0] = desc.mWidth * desc.mHeight * 4;
+    ppMips[0] = (uint8_t*)tf_malloc(mipSizes[0]);
+    FillMipFilterTestImage(ppMips[0], mipSizes[0], MIP_PIXEL_UNORM8, 0x9E3779B9u);
+    GenerateFilteredMipmaps(GetMipFilterKernels(), MIPMAP_FILTER_BOX, MIP_PIXEL_UNORM8, ppMips, mipSizes, &desc);
+
+    // The calling thread, then powers of two up to the thread count of the command line
+    const uint32_t maxThreadCount = max(assetParams->mSettings.threadCount, 1u);
+    uint32_t       threadCounts[34] = {};
+    uint32_t       runCount = 1;
+    for (uint32_t threads = 1; threads < maxThreadCount; threads *= 2)
+        threadCounts[runCount++] = threads;
+    threadCounts[runCount++] = maxThreadCount;
+
+    bool error = false;
+    for (uint32_t f = 0; f < TF_ARRAY_COUNT(formats); ++f)
     {
-        for (uint32_t i = 0; i < imgFileCount; ++i)
+        uint8_t* ppSerial[MAX_MIPLEVELS] = {};
+        uint32_t serialSizes[MAX_MIPLEVELS] = {};
+        int64_t  serialTime = 0;
+        for (uint32_t r = 0; r < runCount; ++r)
         {
-            bdestroy(&inputImgFileNames[i]);
+            uint8_t*      ppCompressed[MAX_MIPLEVELS] = {};
+            uint32_t      compressedSizes[MAX_MIPLEVELS] = {};
+            const int64_t time = RunCompressionScalingTest(&formats[f], ppMips, &desc, threadCounts[r], ppCompressed, compressedSizes);
+            if (time < 0)
+            {
+                LOGF(eERROR, "Compression scaling: %s failed with %u threads", formats[f].pName, threadCounts[r]);
+                error = true;
+                break;
+            }
+
+            // Block rows are written at the offsets of the serial path, the outputs have to be identical
+            uint32_t differentMips = 0;
+            for (uint32_t mip = 0; r && mip < desc.mMipLevels; ++mip)
+            {
+                differentMips += compressedSizes[mip] != serialSizes[mip] ||
+                                 memcmp(ppCompressed[mip], ppSerial[mip], compressedSizes[mip]) != 0;
+            }
+            if (differentMips)
+            {
+                LOGF(eERROR, "Compression scaling: %s with %u threads differs from the calling thread in %u of %u mips", formats[f].pName,
+                     threadCounts[r], differentMips, desc.mMipLevels);
+                error = true;
+            }
+
+            if (!r)
+                serialTime = time;
+            LOGF(eINFO, "Compression scaling: %-8s %ux%u %u mips, %2u threads %9.1f ms, %5.2fx the calling thread", formats[f].pName,
+                 desc.mWidth, desc.mHeight, desc.mMipLevels, threadCounts[r], time / 1000.0, (double)serialTime / (double)max(time, (int64_t)1));
+
+            for (uint32_t mip = 0; mip < MAX_MIPLEVELS; ++mip)
+            {
+                if (!r)
+                {
+                    ppSerial[mip] = ppCompressed[mip];
+                    serialSizes[mip] = compressedSizes[mip];
+                }
+                else
+                {
+                    tf_free(ppCompressed[mip]);
+                }
+            }
         }
 
-        arrfree(inputImgFileNames);
-        inputImgFileNames = NULL;
+        for (uint32_t mip = 0; mip < MAX_MIPLEVELS; ++mip)
+            tf_free(ppSerial[mip]);
     }
 
+    for (uint32_t mip = 0; mip < desc.mMipLevels; ++mip)
+        tf_free(ppMips[mip]);
     return error;
 }
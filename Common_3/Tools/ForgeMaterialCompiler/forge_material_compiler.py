@@ -26,6 +26,7 @@ Forge Material Compiler
 
 import os, sys, argparse
 import string
+import struct
 from enum import Enum
 
 class TextureFlags(Enum):
@@ -197,11 +198,72 @@ def build_material_header(mat):
     header = "{0} {1} {2} {3} {4} {5} {6}".format(len(mat.shader_sets), len(mat.texture_sets), len(mat.material_sets), total_num_shaders, total_num_textures, max_shader_bindings, max_textures_in_set)
     return ":FMC " + header
 
+# Binary compiled material, needs to match with the FMB structs in ResourceLoader.cpp
+FMB_MAGIC = b'@FMB'
+FMB_VERSION = 1
+FMB_INVALID_IDX = 0xFFFFFFFF
+
+class StringTable:
+    def __init__(self):
+        self.offsets = {}
+        self.data = bytearray()
+
+    def add(self, name : str):
+        if name not in self.offsets:
+            self.offsets[name] = len(self.data)
+            self.data += name.encode('utf-8') + b'\0'
+        return self.offsets[name]
+
+def build_binary_material(mat, unique_shader_sets, unique_texture_idxs):
+    strings = StringTable()
+
+    shader_name_offsets = []
+    binding_name_offsets = []
+    shader_set_records = bytearray()
+    for shader_set in mat.shader_sets:
+        shader_idxs = [ FMB_INVALID_IDX ] * len(shader_set.shaders)
+        for index, name in enumerate(shader_set.shaders):
+            if name:
+                shader_idxs[index] = len(shader_name_offsets)
+                shader_name_offsets += [ strings.add(name + shader_set.shader_extension(index)) ]
+
+        first_binding = len(binding_name_offsets)
+        binding_name_offsets += [ strings.add(binding) for binding in shader_set.bindings ]
+        shader_set_records += struct.pack('<9I', unique_shader_sets.index(shader_set.name), *shader_idxs, first_binding, len(shader_set.bindings))
+
+    texture_set_records = bytearray()
+    texture_records = bytearray()
+    num_textures = 0
+    for texture_set in mat.texture_sets:
+        texture_set_records += struct.pack('<2I', num_textures, len(texture_set.textures))
+        for texture in texture_set.textures:
+            texture_records += struct.pack('<3I', strings.add(texture.name), texture.combined_flags, unique_texture_idxs.index(texture.unique_name))
+            num_textures += 1
+
+    material_set_records = bytearray()
+    for material_set in mat.material_sets:
+        material_set_records += struct.pack('<3I', strings.add(material_set.name), material_set.shader_set_idx, material_set.texture_set_idx)
+
+    max_shader_bindings = max([ len(shader_set.bindings) for shader_set in mat.shader_sets ])
+    max_textures_in_set = max([ len(texture_set.textures) for texture_set in mat.texture_sets ])
+
+    out = bytearray(struct.pack('<4s10I', FMB_MAGIC, FMB_VERSION, len(mat.shader_sets), len(mat.texture_sets), len(mat.material_sets),
+        len(shader_name_offsets), num_textures, len(binding_name_offsets), max_shader_bindings, max_textures_in_set, len(strings.data)))
+    out += shader_set_records
+    out += texture_set_records
+    out += texture_records
+    out += material_set_records
+    out += struct.pack('<{0}I'.format(len(shader_name_offsets)), *shader_name_offsets)
+    out += struct.pack('<{0}I'.format(len(binding_name_offsets)), *binding_name_offsets)
+    out += strings.data
+    return out
+
 def get_args():
     parser = argparse.ArgumentParser()
     parser.add_argument('-d', '--directory', help='input directory', required=True)
     parser.add_argument('-o', '--output', help='output directory', required=True)
     parser.add_argument('--verbose', default=False, action='store_true')
+    parser.add_argument('--text', default=False, action='store_true', help='output the text material format instead of the binary one')
     # TODO: Add incremental compilation
     #parser.add_argument('--incremental', default=False, action='store_true')
     args = parser.parse_args()
@@ -216,6 +278,7 @@ def main():
     in_directory = args.directory
     out_directory = args.output
     verbose = args.verbose
+    output_text = args.text
 
     all_mat_filenames = []
     for f in os.listdir(in_directory): 
@@ -279,6 +342,12 @@ def main():
 
     # 3. Output compiled materials that reference resources using unique ids (indexes in the unique resource arrays from previous step)
     for mat in all_materials:
+        output_filepath = make_full_filepath(out_directory, mat.filename)
+        if not output_text:
+            with open(output_filepath, "wb") as out_file:
+                out_file.write(build_binary_material(mat, unique_shader_sets, unique_texture_idxs))
+            continue
+
         lines = [ build_material_header(mat) ]
 
         # shader sets
@@ -307,7 +376,6 @@ def main():
             lines += [ "t {0}".format(material_set.texture_set_idx) ]
 
         lines += [ "" ]
-        output_filepath = make_full_filepath(out_directory, mat.filename)
         with open(output_filepath, "w", newline='') as out_file:
             out_file.write("\n".join(lines))
 
@@ -54,6 +54,7 @@ if not 'FSL_COMPILER_IOS' in os.environ:
 from utils import *
 import generators, compilers
 from compilers import compile_binary
+from shader_library import pack_shader_library, SHADER_LIBRARY_FILENAME
 
 def get_args():
     parser = argparse.ArgumentParser()
@@ -69,6 +70,7 @@ def get_args():
     parser.add_argument('--rootSignature', default=None)
     parser.add_argument('--incremental', default=False, action='store_true')
     parser.add_argument('--mp', type=int, default=-1)
+    parser.add_argument('--library', default=False, action='store_true', help='Pack the compiled binaries of each language into a shader library (requires --compile)')
     parser.add_argument('--reloadServerPort', type=int, default=6543,
                         help='Port written to `reload-server.txt` which is used by the device to recompile shaders on a ReloadServer running on this port')
     parser.add_argument('--cache-args', action='store_true', help='Cache arguments used to invoke `fsl.py` and also generate `reload-server.txt` used by ReloadServer client application') 
@@ -210,6 +212,14 @@ def main():
                 if ret != 0: 
                     exit_code = ret
 
+    if args.compile:
+        for platform in platforms:
+            bin_dir = os.path.join(args.binaryDestination, platform.name)
+            # An existing library is repacked even without --library, the runtime would otherwise keep loading the old binaries from it
+            has_library = os.path.exists(os.path.join(bin_dir, SHADER_LIBRARY_FILENAME))
+            if (args.library and exit_code == 0) or has_library:
+                exit_code = pack_shader_library(bin_dir, args.verbose) or exit_code
+
     if args.reloadServerPort and args.cache_args and not args.fsl_input.endswith('ShaderList.txt'):        
         reload_server_dir = os.path.sep.join(os.path.abspath(__file__).split(os.path.sep)[:-3] + ['Tools', 'ReloadServer'])
         sys.path.append(reload_server_dir)
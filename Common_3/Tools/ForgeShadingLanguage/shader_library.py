@@ -0,0 +1,134 @@
+# Copyright (c) 2017-2024 The Forge Interactive Inc.
+# 
+# This file is part of The-Forge
+# (see https://github.com/ConfettiFX/The-Forge).
+# 
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+# 
+#   http://www.apache.org/licenses/LICENSE-2.0
+# 
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+Packs the FSL binaries of a platform binary directory into a single shader library,
+so the runtime looks up shaders in one memory mapped file instead of opening a file per shader.
+"""
+
+import os, sys, struct, argparse
+
+SHADER_LIBRARY_FILENAME = 'ShaderLibrary.fsllib'
+SHADER_LIBRARY_VERSION = 1
+SHADER_LIBRARY_ALIGNMENT = 16
+
+# Needs to match:
+#
+# struct FSLLibraryHeader
+# {
+#     char     mMagic[4];
+#     uint32_t mVersion;
+#     uint32_t mEntryCount;
+#     uint32_t mNamesSize;
+# };
+#
+# struct FSLLibraryEntry
+# {
+#     uint64_t mNameHash;
+#     uint32_t mNameOffset;
+#     uint32_t mNameSize;
+#     uint64_t mOffset;
+#     uint64_t mSize;
+# };
+#
+# Entries are sorted by name hash, then name. Names are the binary paths relative to the platform directory,
+# the blobs are the unmodified '@FSL' binaries so their derivative offsets stay relative to the blob.
+HEADER_FORMAT = '=4sIII'
+ENTRY_FORMAT = '=QIIQQ'
+
+def shader_name_hash(name: bytes):
+    # 64 bit FNV-1a, needs to match shaderLibraryNameHash in ResourceLoader.cpp
+    h = 0xcbf29ce484222325
+    for c in name:
+        h ^= c
+        h = (h * 0x100000001b3) & 0xffffffffffffffff
+    return h
+
+def collect_shader_binaries(bin_dir):
+    binaries = []
+    for root, _, files in os.walk(bin_dir):
+        for filename in files:
+            if filename == SHADER_LIBRARY_FILENAME:
+                continue
+            filepath = os.path.join(root, filename)
+            with open(filepath, 'rb') as f:
+                code = f.read()
+            # Only FSL binaries, other files keep being loaded from disk
+            if not code.startswith(b'@FSL'):
+                continue
+            name = os.path.relpath(filepath, bin_dir).replace(os.sep, '/').encode('utf-8')
+            binaries += [(shader_name_hash(name), name, code)]
+    binaries.sort(key=lambda b: (b[0], b[1]))
+    return binaries
+
+def pack_shader_library(bin_dir, verbose=False):
+    binaries = collect_shader_binaries(bin_dir)
+    dst = os.path.join(bin_dir, SHADER_LIBRARY_FILENAME)
+    if not binaries:
+        if os.path.exists(dst):
+            os.remove(dst)
+        return 0
+
+    names = b''.join(name for _, name, _ in binaries)
+    header_size = struct.calcsize(HEADER_FORMAT) + struct.calcsize(ENTRY_FORMAT) * len(binaries)
+    align = lambda offset: (offset + SHADER_LIBRARY_ALIGNMENT - 1) & ~(SHADER_LIBRARY_ALIGNMENT - 1)
+
+    entries = b''
+    name_offset = 0
+    data_offset = align(header_size + len(names))
+    for name_hash, name, code in binaries:
+        entries += struct.pack(ENTRY_FORMAT, name_hash, name_offset, len(name), data_offset, len(code))
+        name_offset += len(name)
+        data_offset = align(data_offset + len(code))
+
+    # Write next to the destination and rename so a running app never maps a partially written library,
+    # fsl.py processes compiling into the same directory each use their own temporary file
+    tmp = '{}.{}.tmp'.format(dst, os.getpid())
+    with open(tmp, 'wb') as library:
+        library.write(struct.pack(HEADER_FORMAT, b'@FSB', SHADER_LIBRARY_VERSION, len(binaries), len(names)))
+        library.write(entries)
+        library.write(names)
+        for _, _, code in binaries:
+            library.write(b'\0' * (align(library.tell()) - library.tell()))
+            library.write(code)
+    os.replace(tmp, dst)
+
+    if verbose:
+        print('FSL: Packed {} shaders into {}'.format(len(binaries), dst))
+    return 0
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('binaryDirectories', help='platform binary directories to pack', nargs='+')
+    parser.add_argument('--verbose', default=False, action='store_true')
+    args = parser.parse_args()
+    exit_code = 0
+    for bin_dir in args.binaryDirectories:
+        if not os.path.isdir(bin_dir):
+            print(__file__+': error FSL: Cannot open binary directory \''+bin_dir+'\'')
+            exit_code = 1
+            continue
+        exit_code = pack_shader_library(bin_dir, args.verbose) or exit_code
+    return exit_code
+
+if __name__ == '__main__':
+    sys.exit(main())
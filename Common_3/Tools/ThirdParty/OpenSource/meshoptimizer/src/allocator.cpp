@@ -1,16 +1,17 @@
 // This file is part of meshoptimizer library; see meshoptimizer.h for version/license details
-#include "../../../../../../Utilities/Interfaces/ILog.h"
+#include "../../../../../Utilities/Interfaces/ILog.h"
 #include "meshoptimizer.h"
 
-#include "../../../../../../Utilities/Math/MathTypes.h"
+#include "../../../../../Utilities/Math/MathTypes.h"
 
 #define MEM_MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN_ALLOC_ALIGNMENT (MEM_MAX(VECTORMATH_MIN_ALIGN, MIN_MALLOC_ALIGNMENT))
 
-static size_t buffer_length = 0;
-static size_t current_offset = 0;
-static size_t current_buffer = 0;
-static uint8_t* buffer[8]; //Scratch-Pad memory
+// Per thread so that meshes can be optimized concurrently, each thread sets its own scratch memory
+static thread_local size_t buffer_length = 0;
+static thread_local size_t current_offset = 0;
+static thread_local size_t current_buffer = 0;
+static thread_local uint8_t* buffer[8]; //Scratch-Pad memory
 
 void* Allocate(size_t size)
 {
@@ -58,8 +59,6 @@ void meshopt_SetScratchMemory(size_t size, void* memory)
 	current_buffer = 0;
 	current_offset = 0;
 	buffer[0] = (uint8_t*)memory;
-
-	meshopt_setAllocator();
 }
 
 void meshopt_FreeScratchMemory()
@@ -70,6 +69,31 @@ void meshopt_FreeScratchMemory()
 	}
 }
 
+void* meshopt_ReleaseScratchMemory(size_t* size)
+{
+	// keep the largest block so that it can be set again, the smaller ones were outgrown
+	if (current_buffer > 0)
+	{
+		uint8_t* temp = buffer[0];
+		buffer[0] = buffer[current_buffer];
+		buffer[current_buffer] = temp;
+
+		for (uint32_t i = 1; i <= current_buffer; i++)
+		{
+			tf_free(buffer[i]);
+		}
+	}
+
+	void* memory = buffer[0];
+	*size = buffer_length;
+
+	buffer[0] = NULL;
+	buffer_length = 0;
+	current_buffer = 0;
+	current_offset = 0;
+	return memory;
+}
+
 //void meshopt_setAllocator(void* (*allocate)(size_t), void (*deallocate)(void*))
 void meshopt_setAllocator()
 {
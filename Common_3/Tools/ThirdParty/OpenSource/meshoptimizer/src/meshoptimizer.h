@@ -8,7 +8,7 @@
  */
 #pragma once
 
-#include "../../../../../../Utilities/Interfaces/ILog.h"
+#include "../../../../../Utilities/Interfaces/ILog.h"
 #include <stddef.h>
 #include <math.h>
 
@@ -518,8 +518,11 @@ MESHOPTIMIZER_EXPERIMENTAL void meshopt_spatialSortTriangles(unsigned int* desti
 //MESHOPTIMIZER_API void meshopt_setAllocator(void* (*allocate)(size_t), void (*deallocate)(void*));
 MESHOPTIMIZER_API void meshopt_setAllocator();
 
+/* Sets the scratch memory of the calling thread, meshopt_setAllocator must be called once before any thread uses it */
 MESHOPTIMIZER_API void meshopt_SetScratchMemory(size_t size, void* memory);
 MESHOPTIMIZER_API void meshopt_FreeScratchMemory();
+/* Hands the scratch memory of the calling thread back to the caller instead of freeing it, returns the largest block and its size */
+MESHOPTIMIZER_API void* meshopt_ReleaseScratchMemory(size_t* size);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -265,7 +265,9 @@ static void uiSetWidgetAllocatorPlotBufferChunkAllocatorData(UIWidget* pWidget,
     uint32_t nValues = (uint32_t)pPlotWidget->mSize[0];
     int64_t* values = pPlotWidget->pValues;
 
-    uint32_t unusedChunkCount = (uint32_t)arrlenu(data->mUnusedChunks);
+    uint32_t     unusedChunkCount = getBufferChunkAllocatorUnusedChunks(data, NULL, 0);
+    BufferChunk* unusedChunks = unusedChunkCount ? (BufferChunk*)tf_malloc(sizeof(BufferChunk) * unusedChunkCount) : NULL;
+    unusedChunkCount = min(unusedChunkCount, getBufferChunkAllocatorUnusedChunks(data, unusedChunks, unusedChunkCount));
 
     values[0] = (int64_t)data->mSize;
     ++values;
@@ -280,7 +282,7 @@ static void uiSetWidgetAllocatorPlotBufferChunkAllocatorData(UIWidget* pWidget,
 
     for (uint32_t ci = 0; ci < unusedChunkCount; ++ci)
     {
-        BufferChunk* freeChunk = data->mUnusedChunks + ci;
+        BufferChunk* freeChunk = unusedChunks + ci;
 
         if (ci == 0 && freeChunk->mOffset == 0)
             floatingOccupiedChunks -= 1;
@@ -322,6 +324,8 @@ static void uiSetWidgetAllocatorPlotBufferChunkAllocatorData(UIWidget* pWidget,
         }
     }
 
+    tf_free(unusedChunks);
+
     *fragmentCount = floatingOccupiedChunks;
 
     // fill remaining space as occupied
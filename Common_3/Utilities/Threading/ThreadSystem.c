@@ -108,10 +108,11 @@ static struct ThreadSystemTask getTask(struct ThreadSystemData* t, uint64_t tid)
             break;
         }
 
-        if (t->stop)
+        // threadSystemAssist only runs queued tasks, it doesn't wait for new ones
+        if (t->stop || tid == UINT64_MAX)
             break;
 
-        if (!idleSet && tid != UINT64_MAX)
+        if (!idleSet)
         {
             idleSet = true;
             ++t->idleThreadCount;